@@ -35,16 +35,48 @@ if(NOT VCPKG_TOOLCHAIN)
     set(VCPKG_TARGET_TRIPLET ${_VCPKG_TARGET_TRIPLET_ARCH}-${_VCPKG_TARGET_TRIPLET_PLAT} CACHE STRING "Vcpkg target triplet (ex. x86-windows)")
     set(_VCPKG_INSTALLED_DIR ${CMAKE_CURRENT_LIST_DIR}/../../installed)
     set(_VCPKG_TOOLCHAIN_DIR ${CMAKE_CURRENT_LIST_DIR})
+    set(_VCPKG_ROOT_DIR ${CMAKE_CURRENT_LIST_DIR}/../..)
+
+    # A triplet with VCPKG_BUILD_TYPE installs only one configuration; builds of the other configuration use it too
+    set(_VCPKG_RELEASE_DIR ${_VCPKG_INSTALLED_DIR}/${VCPKG_TARGET_TRIPLET})
+    set(_VCPKG_DEBUG_DIR ${_VCPKG_INSTALLED_DIR}/${VCPKG_TARGET_TRIPLET}/debug)
+    if(NOT EXISTS ${_VCPKG_DEBUG_DIR}/lib AND EXISTS ${_VCPKG_RELEASE_DIR}/lib)
+        set(_VCPKG_DEBUG_DIR ${_VCPKG_RELEASE_DIR})
+    elseif(NOT EXISTS ${_VCPKG_RELEASE_DIR}/lib AND EXISTS ${_VCPKG_DEBUG_DIR}/lib)
+        set(_VCPKG_RELEASE_DIR ${_VCPKG_DEBUG_DIR})
+    endif()
 
     if(CMAKE_BUILD_TYPE MATCHES "^Debug$" OR NOT DEFINED CMAKE_BUILD_TYPE)
         list(APPEND CMAKE_PREFIX_PATH
-            ${_VCPKG_INSTALLED_DIR}/${VCPKG_TARGET_TRIPLET}/debug
+            ${_VCPKG_DEBUG_DIR}
         )
     endif()
     list(APPEND CMAKE_PREFIX_PATH
-        ${_VCPKG_INSTALLED_DIR}/${VCPKG_TARGET_TRIPLET}
+        ${_VCPKG_RELEASE_DIR}
     )
 
+    # The index vcpkg keeps of the installed packages points find_package() straight at their config files
+    set(_VCPKG_PACKAGE_INDEX ${_VCPKG_INSTALLED_DIR}/vcpkg/triplets/${VCPKG_TARGET_TRIPLET}/cmake-index.cmake)
+    if(EXISTS ${_VCPKG_PACKAGE_INDEX})
+        set(VCPKG_INDEX_PACKAGES)
+        include(${_VCPKG_PACKAGE_INDEX})
+        foreach(_VCPKG_PACKAGE IN LISTS VCPKG_INDEX_PACKAGES)
+            foreach(_VCPKG_CONFIG IN LISTS VCPKG_INDEX_${_VCPKG_PACKAGE}_CONFIGS)
+                string(REGEX REPLACE "=.*$" "" _VCPKG_CONFIG_NAME "${_VCPKG_CONFIG}")
+                string(REGEX REPLACE "^[^=]*=" "" _VCPKG_CONFIG_DIR "${_VCPKG_CONFIG}")
+                if(NOT DEFINED ${_VCPKG_CONFIG_NAME}_DIR)
+                    set(${_VCPKG_CONFIG_NAME}_DIR ${_VCPKG_INSTALLED_DIR}/${VCPKG_TARGET_TRIPLET}/${_VCPKG_CONFIG_DIR})
+                endif()
+            endforeach()
+        endforeach()
+    endif()
+
+    # With VCPKG_USE_SYMBOL_STORE set, vcpkg keeps the PDBs of installed DLLs in a symbol store: the applocal step below
+    # deploys them with the DLLs, and debuggers find the others through VCPKG_SYMBOL_PATH
+    if(EXISTS ${_VCPKG_INSTALLED_DIR}/vcpkg/symbols)
+        set(VCPKG_SYMBOL_PATH "srv*${_VCPKG_INSTALLED_DIR}/vcpkg/symbols")
+    endif()
+
     include_directories(${_VCPKG_INSTALLED_DIR}/${VCPKG_TARGET_TRIPLET}/include)
 
     set(CMAKE_PROGRAM_PATH ${CMAKE_PROGRAM_PATH} ${_VCPKG_INSTALLED_DIR}/${VCPKG_TARGET_TRIPLET}/tools)
@@ -54,13 +86,20 @@ if(NOT VCPKG_TOOLCHAIN)
         function(add_executable name)
             _add_executable(${ARGV})
             if(NOT "IMPORTED" IN_LIST ARGV)
+            if(EXISTS ${_VCPKG_ROOT_DIR}/vcpkg.exe)
+            add_custom_command(TARGET ${name} POST_BUILD
+                COMMAND ${_VCPKG_ROOT_DIR}/vcpkg.exe applocal $<TARGET_FILE:${name}>
+                    "$<$<CONFIG:Debug>:${_VCPKG_DEBUG_DIR}>$<$<NOT:$<CONFIG:Debug>>:${_VCPKG_RELEASE_DIR}>/bin"
+            )
+            else()
             add_custom_command(TARGET ${name} POST_BUILD
                 COMMAND powershell -noprofile -executionpolicy UnRestricted -file ${_VCPKG_TOOLCHAIN_DIR}/msbuild/applocal.ps1
                     -targetBinary $<TARGET_FILE:${name}>
-                    -installedDir "${_VCPKG_INSTALLED_DIR}/${VCPKG_TARGET_TRIPLET}$<$<CONFIG:Debug>:/debug>/bin"
+                    -installedDir "$<$<CONFIG:Debug>:${_VCPKG_DEBUG_DIR}>$<$<NOT:$<CONFIG:Debug>>:${_VCPKG_RELEASE_DIR}>/bin"
                     -OutVariable out
             )
             endif()
+            endif()
         endfunction()
     endif()
     set(VCPKG_TOOLCHAIN ON)
@@ -1,7 +1,25 @@
+# When the build was started by vcpkg and the source was extracted through its source cache, the files the patches
+# produce are kept in downloads/patched, so that later builds from a fresh extraction link them in instead of patching.
 function(vcpkg_apply_patches)
     cmake_parse_arguments(_ap "" "SOURCE_PATH" "PATCHES" ${ARGN})
 
     find_program(GIT git)
+    # Serialized with the other triplets of the port, which apply the same patches to the same source tree
+    file(LOCK ${_ap_SOURCE_PATH}.lock GUARD FUNCTION)
+    if(VCPKG_EXE)
+        execute_process(
+            COMMAND ${VCPKG_EXE} internal_patch_cache restore ${_ap_SOURCE_PATH} ${_ap_PATCHES}
+            OUTPUT_VARIABLE _ap_RESTORE_OUTPUT
+            OUTPUT_STRIP_TRAILING_WHITESPACE
+            RESULT_VARIABLE _ap_RESTORE_RESULT
+        )
+        if(_ap_RESTORE_RESULT EQUAL 0)
+            message(STATUS "Applying patches done: ${_ap_RESTORE_OUTPUT}")
+            return()
+        endif()
+    endif()
+
+    set(_ap_ALL_APPLIED ON)
     set(PATCHNUM 0)
     foreach(PATCH ${_ap_PATCHES})
         message(STATUS "Applying patch ${PATCH}")
@@ -16,9 +34,14 @@ function(vcpkg_apply_patches)
 
         if(error_code)
             message(STATUS "Applying patch failed. This is expected if this patch was previously applied.")
+            set(_ap_ALL_APPLIED OFF)
         endif()
 
         message(STATUS "Applying patch ${PATCH} done")
         math(EXPR PATCHNUM "${PATCHNUM}+1")
     endforeach()
+
+    if(VCPKG_EXE AND _ap_ALL_APPLIED)
+        execute_process(COMMAND ${VCPKG_EXE} internal_patch_cache store ${_ap_SOURCE_PATH} ${_ap_PATCHES} OUTPUT_QUIET)
+    endif()
 endfunction()
@@ -1,17 +1,24 @@
 function(vcpkg_build_cmake)
-    message(STATUS "Build ${TARGET_TRIPLET}-rel")
-    vcpkg_execute_required_process(
-        COMMAND ${CMAKE_COMMAND} --build . --config Release -- /p:VCPkgLocalAppDataDisabled=true /m
-        WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel
-        LOGNAME build-${TARGET_TRIPLET}-rel
-    )
-    message(STATUS "Build ${TARGET_TRIPLET}-rel done")
+    # Only the configurations the triplet builds were configured
+    vcpkg_build_configurations(_bc_CONFIGS)
+    if(RELEASE IN_LIST _bc_CONFIGS)
+        vcpkg_get_build_tool_jobs_options(_bc_RELEASE_OPTIONS ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel)
+    endif()
+    if(DEBUG IN_LIST _bc_CONFIGS)
+        vcpkg_get_build_tool_jobs_options(_bc_DEBUG_OPTIONS ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg)
+    endif()
+    vcpkg_describe_build_configurations(_bc_NAMES)
+    vcpkg_get_configuration_jobs(_bc_JOBS)
 
-    message(STATUS "Build ${TARGET_TRIPLET}-dbg")
-    vcpkg_execute_required_process(
-        COMMAND ${CMAKE_COMMAND} --build . --config Debug -- /p:VCPkgLocalAppDataDisabled=true /m
-        WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg
-        LOGNAME build-${TARGET_TRIPLET}-dbg
+    message(STATUS "Build ${_bc_NAMES}")
+    vcpkg_execute_build_configurations(
+        COMMAND_RELEASE ${CMAKE_COMMAND} --build . --config Release -- ${_bc_RELEASE_OPTIONS}
+        WORKING_DIRECTORY_RELEASE ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel
+        LOGNAME_RELEASE build-${TARGET_TRIPLET}-rel
+        COMMAND_DEBUG ${CMAKE_COMMAND} --build . --config Debug -- ${_bc_DEBUG_OPTIONS}
+        WORKING_DIRECTORY_DEBUG ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg
+        LOGNAME_DEBUG build-${TARGET_TRIPLET}-dbg
+        JOBS ${_bc_JOBS}
     )
-    message(STATUS "Build ${TARGET_TRIPLET}-dbg done")
+    message(STATUS "Build ${_bc_NAMES} done")
 endfunction()
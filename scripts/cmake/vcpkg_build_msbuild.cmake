@@ -1,7 +1,8 @@
 #.rst:
 # .. command:: vcpkg_build_msbuild
 #
-#  Build a msbuild-based project.
+#  Build a msbuild-based project. Only the configurations the triplet builds
+#  (see ``VCPKG_BUILD_TYPE``) are built.
 #
 #  ::
 #  vcpkg_build_msbuild(PROJECT_PATH <sln_project_path>
@@ -48,25 +49,49 @@ function(vcpkg_build_msbuild)
         set(_csc_PLATFORM ${TRIPLET_SYSTEM_ARCH})
     endif()
 
-    message(STATUS "Building ${_csc_PROJECT_PATH} for Release")
-    file(MAKE_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel)
-    vcpkg_execute_required_process(
-        COMMAND msbuild ${_csc_PROJECT_PATH} ${_csc_OPTIONS} ${_csc_OPTIONS_RELEASE}
-            /p:Configuration=${_csc_RELEASE_CONFIGURATION}
-            /p:Platform=${_csc_PLATFORM}
-            /p:VCPkgLocalAppDataDisabled=true
-        WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel
-        LOGNAME build-${TARGET_TRIPLET}-rel
-    )
+    # The configurations are built one after the other, each with the whole share of jobs; started by vcpkg, msbuild
+    # builds with as many jobs as it got tokens for
+    set(_csc_JOBS ${VCPKG_BUILD_JOBS})
+    if(VCPKG_EXE)
+        set(_csc_JOBS_OPTION /m:@VCPKG_JOBS@)
+    elseif(_csc_JOBS)
+        set(_csc_JOBS_OPTION /m:${_csc_JOBS})
+    else()
+        set(_csc_JOBS_OPTION)
+    endif()
+    # The projects keep their own debug information format, so compilations writing into a shared PDB are not cached
+    vcpkg_compiler_cache_msbuild_options(_csc_COMPILER_CACHE_OPTIONS)
+
+    vcpkg_build_configurations(_csc_CONFIGS)
+    if(RELEASE IN_LIST _csc_CONFIGS)
+        message(STATUS "Building ${_csc_PROJECT_PATH} for Release")
+        file(MAKE_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel)
+        vcpkg_execute_required_process(
+            COMMAND msbuild ${_csc_PROJECT_PATH} ${_csc_OPTIONS} ${_csc_OPTIONS_RELEASE}
+                /p:Configuration=${_csc_RELEASE_CONFIGURATION}
+                /p:Platform=${_csc_PLATFORM}
+                /p:VCPkgLocalAppDataDisabled=true
+                ${_csc_JOBS_OPTION}
+                ${_csc_COMPILER_CACHE_OPTIONS}
+            WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel
+            LOGNAME build-${TARGET_TRIPLET}-rel
+            JOBS ${_csc_JOBS}
+        )
+    endif()
 
-    message(STATUS "Building ${_csc_PROJECT_PATH} for Debug")
-    file(MAKE_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg)
-    vcpkg_execute_required_process(
-        COMMAND msbuild ${_csc_PROJECT_PATH} ${_csc_OPTIONS} ${_csc_OPTIONS_DEBUG}
-            /p:Configuration=${_csc_DEBUG_CONFIGURATION}
-            /p:Platform=${_csc_PLATFORM}
-            /p:VCPkgLocalAppDataDisabled=true
-        WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg
-        LOGNAME build-${TARGET_TRIPLET}-dbg
-    )
+    if(DEBUG IN_LIST _csc_CONFIGS)
+        message(STATUS "Building ${_csc_PROJECT_PATH} for Debug")
+        file(MAKE_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg)
+        vcpkg_execute_required_process(
+            COMMAND msbuild ${_csc_PROJECT_PATH} ${_csc_OPTIONS} ${_csc_OPTIONS_DEBUG}
+                /p:Configuration=${_csc_DEBUG_CONFIGURATION}
+                /p:Platform=${_csc_PLATFORM}
+                /p:VCPkgLocalAppDataDisabled=true
+                ${_csc_JOBS_OPTION}
+                ${_csc_COMPILER_CACHE_OPTIONS}
+            WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg
+            LOGNAME build-${TARGET_TRIPLET}-dbg
+            JOBS ${_csc_JOBS}
+        )
+    endif()
 endfunction()
\ No newline at end of file
@@ -2,10 +2,13 @@ include(vcpkg_download_distfile)
 include(vcpkg_extract_source_archive)
 include(vcpkg_execute_required_process)
 include(vcpkg_execute_required_process_repeat)
+include(vcpkg_execute_build_configurations)
 include(vcpkg_find_acquire_program)
 include(vcpkg_build_cmake)
 include(vcpkg_build_msbuild)
 include(vcpkg_install_cmake)
+include(vcpkg_configure_seed)
 include(vcpkg_configure_cmake)
 include(vcpkg_apply_patches)
 include(vcpkg_copy_pdbs)
+include(vcpkg_compiler_cache)
@@ -0,0 +1,99 @@
+# Builds go through a compiler cache when the triplet sets VCPKG_COMPILER_CACHE to one, e.g. clcache, sccache or
+# ccache: a name found on the PATH, or a full path. Rebuilding a port after a change to its portfile then only
+# recompiles the sources whose preprocessed contents or flags changed.
+#
+# All ports and triplets share the cache in VCPKG_COMPILER_CACHE_DIR, an absolute path, or downloads/compiler-cache by
+# default. clcache (and any cache named otherwise) stands in for cl.exe; sccache and ccache are launchers, which only
+# generators that support CMAKE_<LANG>_COMPILER_LAUNCHER can use.
+
+# Called by ports.cmake once the triplet is read. Points the cache at its directory through the environment, which
+# every process of the build inherits.
+function(vcpkg_enable_compiler_cache)
+    if(NOT VCPKG_COMPILER_CACHE)
+        return()
+    endif()
+
+    if(IS_ABSOLUTE "${VCPKG_COMPILER_CACHE}" AND EXISTS "${VCPKG_COMPILER_CACHE}")
+        set(_ecc_PROGRAM "${VCPKG_COMPILER_CACHE}")
+    else()
+        unset(_ecc_PROGRAM CACHE)
+        find_program(_ecc_PROGRAM NAMES ${VCPKG_COMPILER_CACHE})
+    endif()
+    if(NOT _ecc_PROGRAM)
+        message(WARNING "Compiler cache ${VCPKG_COMPILER_CACHE} was not found; building without it")
+        return()
+    endif()
+
+    # The default must match the one vcpkg reports the statistics of
+    if(NOT VCPKG_COMPILER_CACHE_DIR)
+        set(VCPKG_COMPILER_CACHE_DIR ${DOWNLOADS}/compiler-cache)
+    endif()
+    file(MAKE_DIRECTORY ${VCPKG_COMPILER_CACHE_DIR})
+    file(TO_NATIVE_PATH "${VCPKG_COMPILER_CACHE_DIR}" _ecc_NATIVE_DIR)
+    file(TO_NATIVE_PATH "${CURRENT_BUILDTREES_DIR}" _ecc_NATIVE_BASEDIR)
+    set(ENV{CLCACHE_DIR} "${_ecc_NATIVE_DIR}")
+    set(ENV{CCACHE_DIR} "${_ecc_NATIVE_DIR}")
+    set(ENV{SCCACHE_DIR} "${_ecc_NATIVE_DIR}")
+    # Paths below the build trees of the port are hashed relative to it, so that the cache still hits after the vcpkg
+    # root moved
+    set(ENV{CLCACHE_BASEDIR} "${_ecc_NATIVE_BASEDIR}")
+    set(ENV{CCACHE_BASEDIR} "${_ecc_NATIVE_BASEDIR}")
+
+    get_filename_component(_ecc_NAME "${_ecc_PROGRAM}" NAME_WE)
+    string(TOLOWER "${_ecc_NAME}" _ecc_NAME)
+    if(_ecc_NAME MATCHES "sccache|^ccache")
+        set(VCPKG_COMPILER_CACHE_KIND launcher PARENT_SCOPE)
+    else()
+        set(VCPKG_COMPILER_CACHE_KIND compiler PARENT_SCOPE)
+    endif()
+    set(VCPKG_COMPILER_CACHE_PROGRAM "${_ecc_PROGRAM}" PARENT_SCOPE)
+    message(STATUS "Compiling through ${_ecc_PROGRAM}")
+endfunction()
+
+# The options vcpkg_configure_cmake passes to cmake for the GENERATOR
+function(vcpkg_compiler_cache_cmake_options VAR GENERATOR)
+    set(${VAR} "" PARENT_SCOPE)
+    if(NOT VCPKG_COMPILER_CACHE_PROGRAM)
+        return()
+    endif()
+
+    if(GENERATOR MATCHES "^Visual Studio")
+        # Compilers are substituted when msbuild runs, see vcpkg_compiler_cache_msbuild_options
+        if(VCPKG_COMPILER_CACHE_KIND STREQUAL launcher)
+            message(WARNING "${VCPKG_COMPILER_CACHE_PROGRAM} is a compiler launcher, which the ${GENERATOR} generator cannot use; building without it")
+        endif()
+    elseif(VCPKG_COMPILER_CACHE_KIND STREQUAL launcher)
+        set(${VAR}
+            "-DCMAKE_C_COMPILER_LAUNCHER=${VCPKG_COMPILER_CACHE_PROGRAM}"
+            "-DCMAKE_CXX_COMPILER_LAUNCHER=${VCPKG_COMPILER_CACHE_PROGRAM}"
+            PARENT_SCOPE)
+    else()
+        set(${VAR}
+            "-DCMAKE_C_COMPILER=${VCPKG_COMPILER_CACHE_PROGRAM}"
+            "-DCMAKE_CXX_COMPILER=${VCPKG_COMPILER_CACHE_PROGRAM}"
+            PARENT_SCOPE)
+    endif()
+endfunction()
+
+# The msbuild properties that make it run the cache instead of cl.exe
+function(vcpkg_compiler_cache_msbuild_options VAR)
+    set(${VAR} "" PARENT_SCOPE)
+    if(NOT VCPKG_COMPILER_CACHE_PROGRAM OR NOT VCPKG_COMPILER_CACHE_KIND STREQUAL compiler)
+        return()
+    endif()
+
+    get_filename_component(_cmo_NAME "${VCPKG_COMPILER_CACHE_PROGRAM}" NAME)
+    get_filename_component(_cmo_DIR "${VCPKG_COMPILER_CACHE_PROGRAM}" DIRECTORY)
+    file(TO_NATIVE_PATH "${_cmo_DIR}" _cmo_NATIVE_DIR)
+    set(${VAR} /p:CLToolExe=${_cmo_NAME} /p:CLToolPath=${_cmo_NATIVE_DIR} PARENT_SCOPE)
+endfunction()
+
+# The compiler option for debug information: /Z7 when the builds go through a cache, which cannot cache compilations
+# that all write into the same PDB as /Zi does. The linker still gathers the debug information into a PDB.
+function(vcpkg_compiler_cache_debug_information_option VAR)
+    if(VCPKG_COMPILER_CACHE_PROGRAM)
+        set(${VAR} /Z7 PARENT_SCOPE)
+    else()
+        set(${VAR} /Zi PARENT_SCOPE)
+    endif()
+endfunction()
@@ -1,17 +1,56 @@
-find_program(vcpkg_configure_cmake_NINJA ninja)
+# Empties BUILD_DIRECTORY before it is configured with the INPUTS and the OPTIONS, unless the build is incremental
+# (VCPKG_INCREMENTAL is set, by the portfile or by vcpkg install --incremental) and the directory was last configured
+# with the same INPUTS. Then cmake configures the existing tree again, and the build tool rebuilds only what the new
+# configuration changed. When the OPTIONS changed too, the CMake cache goes, so that removed options do not linger.
+function(vcpkg_prepare_configure_directory BUILD_DIRECTORY INPUTS OPTIONS)
+    string(SHA1 _pcd_OPTIONS_HASH "${OPTIONS}")
+    set(_pcd_STAMP_FILE ${BUILD_DIRECTORY}/vcpkg-configure-inputs.txt)
+    set(_pcd_STAMP "${INPUTS}options ${_pcd_OPTIONS_HASH}\n")
+
+    set(_pcd_RECORDED)
+    set(_pcd_INCREMENTAL "$ENV{VCPKG_INCREMENTAL}")
+    if((VCPKG_INCREMENTAL OR _pcd_INCREMENTAL) AND EXISTS ${_pcd_STAMP_FILE})
+        file(READ ${_pcd_STAMP_FILE} _pcd_RECORDED)
+    endif()
+
+    string(LENGTH "${INPUTS}" _pcd_INPUTS_LENGTH)
+    string(SUBSTRING "${_pcd_RECORDED}" 0 ${_pcd_INPUTS_LENGTH} _pcd_RECORDED_INPUTS)
+    if(_pcd_RECORDED STREQUAL _pcd_STAMP)
+        message(STATUS "Reusing ${BUILD_DIRECTORY}")
+    elseif(_pcd_RECORDED AND _pcd_RECORDED_INPUTS STREQUAL INPUTS)
+        message(STATUS "Reusing ${BUILD_DIRECTORY} with new options")
+        file(REMOVE ${BUILD_DIRECTORY}/CMakeCache.txt)
+    else()
+        file(REMOVE_RECURSE ${BUILD_DIRECTORY})
+    endif()
+
+    # Written before configuring: a configuration that fails is retried in the same tree
+    file(MAKE_DIRECTORY ${BUILD_DIRECTORY})
+    file(WRITE ${_pcd_STAMP_FILE} "${_pcd_STAMP}")
+endfunction()
 function(vcpkg_configure_cmake)
-    cmake_parse_arguments(_csc "" "SOURCE_PATH;GENERATOR" "OPTIONS;OPTIONS_DEBUG;OPTIONS_RELEASE" ${ARGN})
+    cmake_parse_arguments(_csc "PREFER_NINJA;UNITY_BUILD" "SOURCE_PATH;GENERATOR" "OPTIONS;OPTIONS_DEBUG;OPTIONS_RELEASE" ${ARGN})
+
+    # Ninja schedules every target of the port at once, and takes its jobs from vcpkg like msbuild does. Ports opt in
+    # with PREFER_NINJA, triplets with VCPKG_PREFER_NINJA. It compiles with the environment vcpkg builds in, so it is
+    # only used for desktop x86 and x64.
+    set(_csc_NINJA OFF)
+    if(NOT _csc_GENERATOR AND (_csc_PREFER_NINJA OR VCPKG_PREFER_NINJA)
+        AND NOT TRIPLET_SYSTEM_NAME MATCHES "uwp" AND TRIPLET_SYSTEM_ARCH MATCHES "^x(86|64)$")
+        vcpkg_find_acquire_program(NINJA)
+        set(_csc_NINJA ON)
+    endif()
 
     if(_csc_GENERATOR)
         set(GENERATOR ${_csc_GENERATOR})
+    elseif(_csc_NINJA)
+        set(GENERATOR "Ninja")
     elseif(TRIPLET_SYSTEM_NAME MATCHES "uwp" AND TRIPLET_SYSTEM_ARCH MATCHES "x86")
         set(GENERATOR "Visual Studio 14 2015")
     elseif(TRIPLET_SYSTEM_NAME MATCHES "uwp" AND TRIPLET_SYSTEM_ARCH MATCHES "x64")
         set(GENERATOR "Visual Studio 14 2015 Win64")
     elseif(TRIPLET_SYSTEM_NAME MATCHES "uwp" AND TRIPLET_SYSTEM_ARCH MATCHES "arm")
         set(GENERATOR "Visual Studio 14 2015 ARM")
-    # elseif(NOT vcpkg_configure_cmake_NINJA MATCHES "NOTFOUND")
-    #     set(GENERATOR "Ninja")
     elseif(TRIPLET_SYSTEM_ARCH MATCHES "x86")
         set(GENERATOR "Visual Studio 14 2015")
     elseif(TRIPLET_SYSTEM_ARCH MATCHES "x64")
@@ -20,8 +59,15 @@ function(vcpkg_configure_cmake)
         set(GENERATOR "Visual Studio 14 2015 ARM")
     endif()
 
-    file(REMOVE_RECURSE ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg)
+    # A port choosing its own compilers or toolset is identified from scratch
+    set(_csc_SEED ON)
+    if(_csc_OPTIONS MATCHES "CMAKE_[A-Z]*_COMPILER|CMAKE_GENERATOR_TOOLSET|(^|;)-T")
+        set(_csc_SEED OFF)
+    endif()
 
+    if(_csc_NINJA)
+        list(APPEND _csc_OPTIONS -DCMAKE_MAKE_PROGRAM=${NINJA})
+    endif()
     if(DEFINED VCPKG_CMAKE_SYSTEM_NAME)
         list(APPEND _csc_OPTIONS -DCMAKE_SYSTEM_NAME=${VCPKG_CMAKE_SYSTEM_NAME})
     endif()
@@ -33,29 +79,50 @@ function(vcpkg_configure_cmake)
     elseif(DEFINED VCPKG_LIBRARY_LINKAGE AND VCPKG_LIBRARY_LINKAGE STREQUAL static)
         list(APPEND _csc_OPTIONS -DBUILD_SHARED_LIBS=OFF)
     endif()
+
+    # A unity build compiles the sources of each target in batches of VCPKG_UNITY_BUILD_BATCH_SIZE (default: 8) files,
+    # parsing the headers they share once per batch. Triplets opt in with VCPKG_UNITY_BUILD, and ports with UNITY_BUILD
+    # once their sources are known to compile together. ports.cmake records it in BUILD_INFO, for `vcpkg stats`.
+    if(_csc_UNITY_BUILD AND VCPKG_UNITY_BUILD)
+        if(CMAKE_VERSION VERSION_LESS 3.16)
+            message(STATUS "Not using a unity build: it requires CMake 3.16")
+        else()
+            set(_csc_UNITY_BUILD_BATCH_SIZE 8)
+            if(VCPKG_UNITY_BUILD_BATCH_SIZE)
+                set(_csc_UNITY_BUILD_BATCH_SIZE ${VCPKG_UNITY_BUILD_BATCH_SIZE})
+            endif()
+            message(STATUS "Using a unity build in batches of ${_csc_UNITY_BUILD_BATCH_SIZE} files")
+            list(APPEND _csc_OPTIONS -DCMAKE_UNITY_BUILD=ON -DCMAKE_UNITY_BUILD_BATCH_SIZE=${_csc_UNITY_BUILD_BATCH_SIZE})
+            set(_VCPKG_UNITY_BUILD ON PARENT_SCOPE)
+        endif()
+    endif()
     
 
+    vcpkg_compiler_cache_cmake_options(_csc_COMPILER_CACHE_OPTIONS ${GENERATOR})
+    list(APPEND _csc_OPTIONS ${_csc_COMPILER_CACHE_OPTIONS})
+    vcpkg_compiler_cache_debug_information_option(_csc_DEBUG_INFORMATION)
+
     list(APPEND _csc_OPTIONS
         "-DCMAKE_CXX_FLAGS= /DWIN32 /D_WINDOWS /W3 /utf-8 /GR /EHsc"
         "-DCMAKE_C_FLAGS= /DWIN32 /D_WINDOWS /W3 /utf-8"
     )
     if(DEFINED VCPKG_CRT_LINKAGE AND VCPKG_CRT_LINKAGE STREQUAL dynamic)
         list(APPEND _csc_OPTIONS_DEBUG
-            "-DCMAKE_CXX_FLAGS_DEBUG=/D_DEBUG /MDd /Zi /Ob0 /Od /RTC1"
-            "-DCMAKE_C_FLAGS_DEBUG=/D_DEBUG /MDd /Zi /Ob0 /Od /RTC1"
+            "-DCMAKE_CXX_FLAGS_DEBUG=/D_DEBUG /MDd ${_csc_DEBUG_INFORMATION} /Ob0 /Od /RTC1"
+            "-DCMAKE_C_FLAGS_DEBUG=/D_DEBUG /MDd ${_csc_DEBUG_INFORMATION} /Ob0 /Od /RTC1"
         )
         list(APPEND _csc_OPTIONS_RELEASE
-            "-DCMAKE_CXX_FLAGS_RELEASE=/MD /O2 /Oi /Gy /DNDEBUG /Zi"
-            "-DCMAKE_C_FLAGS_RELEASE=/MD /O2 /Oi /Gy /DNDEBUG /Zi"
+            "-DCMAKE_CXX_FLAGS_RELEASE=/MD /O2 /Oi /Gy /DNDEBUG ${_csc_DEBUG_INFORMATION}"
+            "-DCMAKE_C_FLAGS_RELEASE=/MD /O2 /Oi /Gy /DNDEBUG ${_csc_DEBUG_INFORMATION}"
         )
     elseif(DEFINED VCPKG_CRT_LINKAGE AND VCPKG_CRT_LINKAGE STREQUAL static)
         list(APPEND _csc_OPTIONS_DEBUG
-            "-DCMAKE_CXX_FLAGS_DEBUG=/D_DEBUG /MTd /Zi /Ob0 /Od /RTC1"
-            "-DCMAKE_C_FLAGS_DEBUG=/D_DEBUG /MTd /Zi /Ob0 /Od /RTC1"
+            "-DCMAKE_CXX_FLAGS_DEBUG=/D_DEBUG /MTd ${_csc_DEBUG_INFORMATION} /Ob0 /Od /RTC1"
+            "-DCMAKE_C_FLAGS_DEBUG=/D_DEBUG /MTd ${_csc_DEBUG_INFORMATION} /Ob0 /Od /RTC1"
         )
         list(APPEND _csc_OPTIONS_RELEASE
-            "-DCMAKE_CXX_FLAGS_RELEASE=/MT /O2 /Oi /Gy /DNDEBUG /Zi"
-            "-DCMAKE_C_FLAGS_RELEASE=/MT /O2 /Oi /Gy /DNDEBUG /Zi"
+            "-DCMAKE_CXX_FLAGS_RELEASE=/MT /O2 /Oi /Gy /DNDEBUG ${_csc_DEBUG_INFORMATION}"
+            "-DCMAKE_C_FLAGS_RELEASE=/MT /O2 /Oi /Gy /DNDEBUG ${_csc_DEBUG_INFORMATION}"
         )
     endif()
     list(APPEND _csc_OPTIONS_RELEASE
@@ -63,33 +130,61 @@ function(vcpkg_configure_cmake)
         "-DCMAKE_EXE_LINKER_FLAGS_RELEASE=/DEBUG /INCREMENTAL:NO /OPT:REF /OPT:ICF"
     )
 
-    message(STATUS "Configuring ${TARGET_TRIPLET}-rel")
-    file(MAKE_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel)
-    vcpkg_execute_required_process(
-        COMMAND ${CMAKE_COMMAND} ${_csc_SOURCE_PATH} ${_csc_OPTIONS} ${_csc_OPTIONS_RELEASE}
+    # Whatever else a build tree depends on: a change of any of them requires configuring from scratch
+    file(SHA1 ${CMAKE_TRIPLET_FILE} _csc_TRIPLET_HASH)
+    set(_csc_INPUTS
+        "source ${_csc_SOURCE_PATH}\n"
+        "generator ${GENERATOR}\n"
+        "cmake ${CMAKE_VERSION}\n"
+        "compiler $ENV{VCINSTALLDIR} $ENV{VisualStudioVersion} ${VCPKG_COMPILER_CACHE_PROGRAM}\n"
+        "triplet ${_csc_TRIPLET_HASH}\n"
+    )
+    string(CONCAT _csc_INPUTS ${_csc_INPUTS})
+
+    # The same inputs but the sources, whatever port they come from
+    set(_csc_SEED_DIR)
+    if(_csc_SEED)
+        string(REPLACE "source ${_csc_SOURCE_PATH}\n" "" _csc_SEED_INPUTS "${_csc_INPUTS}")
+        vcpkg_configure_seed_directory(_csc_SEED_DIR "${_csc_SEED_INPUTS}")
+    endif()
+
+    # Only the build trees of the configurations the triplet builds are prepared
+    vcpkg_build_configurations(_csc_CONFIGS)
+    vcpkg_describe_build_configurations(_csc_NAMES)
+    message(STATUS "Configuring ${_csc_NAMES}")
+    if(RELEASE IN_LIST _csc_CONFIGS)
+        vcpkg_prepare_configure_directory(${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel "${_csc_INPUTS}" "${_csc_OPTIONS};${_csc_OPTIONS_RELEASE}")
+        vcpkg_seed_configure_directory(_csc_SEED_OPTIONS_RELEASE "${_csc_SEED_DIR}" ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel)
+    endif()
+    if(DEBUG IN_LIST _csc_CONFIGS)
+        vcpkg_prepare_configure_directory(${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg "${_csc_INPUTS}" "${_csc_OPTIONS};${_csc_OPTIONS_DEBUG}")
+        vcpkg_seed_configure_directory(_csc_SEED_OPTIONS_DEBUG "${_csc_SEED_DIR}" ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg)
+    endif()
+    vcpkg_execute_build_configurations(
+        COMMAND_RELEASE ${CMAKE_COMMAND} ${_csc_SEED_OPTIONS_RELEASE} ${_csc_SOURCE_PATH} ${_csc_OPTIONS} ${_csc_OPTIONS_RELEASE}
             -G ${GENERATOR}
             -DCMAKE_VERBOSE_MAKEFILE=ON
             -DCMAKE_BUILD_TYPE=Release
             -DCMAKE_TOOLCHAIN_FILE=${CMAKE_TRIPLET_FILE}
             -DCMAKE_PREFIX_PATH=${CURRENT_INSTALLED_DIR}
             -DCMAKE_INSTALL_PREFIX=${CURRENT_PACKAGES_DIR}
-        WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel
-        LOGNAME config-${TARGET_TRIPLET}-rel
-    )
-    message(STATUS "Configuring ${TARGET_TRIPLET}-rel done")
-
-    message(STATUS "Configuring ${TARGET_TRIPLET}-dbg")
-    file(MAKE_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg)
-    vcpkg_execute_required_process(
-        COMMAND ${CMAKE_COMMAND} ${_csc_SOURCE_PATH} ${_csc_OPTIONS} ${_csc_OPTIONS_DEBUG}
+        WORKING_DIRECTORY_RELEASE ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel
+        LOGNAME_RELEASE config-${TARGET_TRIPLET}-rel
+        COMMAND_DEBUG ${CMAKE_COMMAND} ${_csc_SEED_OPTIONS_DEBUG} ${_csc_SOURCE_PATH} ${_csc_OPTIONS} ${_csc_OPTIONS_DEBUG}
             -G ${GENERATOR}
             -DCMAKE_VERBOSE_MAKEFILE=ON
             -DCMAKE_BUILD_TYPE=Debug
             -DCMAKE_TOOLCHAIN_FILE=${CMAKE_TRIPLET_FILE}
             -DCMAKE_PREFIX_PATH=${CURRENT_INSTALLED_DIR}/debug\\\\\\\;${CURRENT_INSTALLED_DIR}
             -DCMAKE_INSTALL_PREFIX=${CURRENT_PACKAGES_DIR}/debug
-        WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg
-        LOGNAME config-${TARGET_TRIPLET}-dbg
+        WORKING_DIRECTORY_DEBUG ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg
+        LOGNAME_DEBUG config-${TARGET_TRIPLET}-dbg
     )
-    message(STATUS "Configuring ${TARGET_TRIPLET}-dbg done")
+    if(RELEASE IN_LIST _csc_CONFIGS)
+        vcpkg_update_configure_seed("${_csc_SEED_DIR}" ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel)
+    endif()
+    if(DEBUG IN_LIST _csc_CONFIGS)
+        vcpkg_update_configure_seed("${_csc_SEED_DIR}" ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg)
+    endif()
+    message(STATUS "Configuring ${_csc_NAMES} done")
 endfunction()
\ No newline at end of file
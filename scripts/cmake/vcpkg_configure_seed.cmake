@@ -0,0 +1,121 @@
+# vcpkg_configure_cmake seeds the build trees it configures from scratch with what configuring other ports with the same
+# compiler, generator and triplet found out, kept in downloads/configure-seeds/<key>:
+#  - the compiler identification CMake writes to CMakeFiles/<version>/, which CMake then loads instead of identifying
+#    and testing the compilers again;
+#  - the results of check_include_file for the headers of the CRT and the Windows SDK, given to cmake as an initial
+#    cache (-C checks.cmake). Only those of VCPKG_CONFIGURE_SEED_HEADERS stored under the conventional name
+#    HAVE_<HEADER>_H are recorded. Other probes depend on CMAKE_REQUIRED_INCLUDES, CMAKE_REQUIRED_LIBRARIES and
+#    CMAKE_REQUIRED_DEFINITIONS and on what is installed, which differ from port to port: HAVE_SSL_CTX_NEW found by a
+#    port that links OpenSSL would break the link of one that does not.
+# The key covers the inputs of the build trees (cmake version, generator, compiler and triplet file) and the recorded
+# headers, so a change of any of them starts a new seed. Set VCPKG_CONFIGURE_SEED to OFF in the triplet or the portfile
+# to configure without it.
+
+# The headers every port finds or misses alike, whatever it links and whatever is installed
+set(VCPKG_CONFIGURE_SEED_HEADERS
+    assert.h ctype.h direct.h errno.h fcntl.h float.h inttypes.h io.h limits.h locale.h malloc.h math.h memory.h
+    process.h signal.h stdarg.h stdbool.h stddef.h stdint.h stdio.h stdlib.h string.h strings.h sys/stat.h
+    sys/time.h sys/types.h time.h unistd.h wchar.h windows.h winsock2.h ws2tcpip.h
+)
+
+# Sets VAR to the seed directory for the INPUTS, or to nothing when seeding is off
+function(vcpkg_configure_seed_directory VAR INPUTS)
+    if(DEFINED VCPKG_CONFIGURE_SEED AND NOT VCPKG_CONFIGURE_SEED)
+        set(${VAR} "" PARENT_SCOPE)
+        return()
+    endif()
+    string(SHA1 _csd_KEY "${INPUTS}headers ${VCPKG_CONFIGURE_SEED_HEADERS}\n")
+    set(${VAR} ${DOWNLOADS}/configure-seeds/${_csd_KEY} PARENT_SCOPE)
+endfunction()
+
+# Gives BUILD_DIRECTORY, unless it was configured before, the compiler identification of SEED_DIR, and sets VAR to the
+# cmake options that load the recorded probe results
+function(vcpkg_seed_configure_directory VAR SEED_DIR BUILD_DIRECTORY)
+    set(${VAR} "" PARENT_SCOPE)
+    if(NOT SEED_DIR OR EXISTS ${BUILD_DIRECTORY}/CMakeCache.txt OR NOT EXISTS ${SEED_DIR}/checks.cmake)
+        return()
+    endif()
+
+    file(GLOB _scd_PLATFORM_FILES ${SEED_DIR}/CMake*.cmake)
+    file(COPY ${_scd_PLATFORM_FILES} DESTINATION ${BUILD_DIRECTORY}/CMakeFiles/${CMAKE_VERSION})
+    # checks.cmake sets CMAKE_PLATFORM_INFO_INITIALIZED, without which cmake discards CMakeFiles/<version>
+    set(${VAR} -C ${SEED_DIR}/checks.cmake PARENT_SCOPE)
+endfunction()
+
+# The conventional result variable of "Have include <header>" for a header of VCPKG_CONFIGURE_SEED_HEADERS, or nothing
+function(vcpkg_configure_seed_variable VAR PROBED)
+    string(TOLOWER "${PROBED}" _csv_HEADER)
+    if(NOT _csv_HEADER IN_LIST VCPKG_CONFIGURE_SEED_HEADERS)
+        set(${VAR} "" PARENT_SCOPE)
+        return()
+    endif()
+    string(TOUPPER "HAVE_${PROBED}" _csv_NAME)
+    string(REGEX REPLACE "[^A-Z0-9_]" "_" _csv_NAME "${_csv_NAME}")
+    set(${VAR} ${_csv_NAME} PARENT_SCOPE)
+endfunction()
+
+# Adds to SEED_DIR what configuring BUILD_DIRECTORY found out. Concurrent builds may update the same seed: each writes
+# a file of its own and renames it into place, so the last one wins and the others' new results wait for the next port.
+function(vcpkg_update_configure_seed SEED_DIR BUILD_DIRECTORY)
+    set(_ucs_PLATFORM_DIR ${BUILD_DIRECTORY}/CMakeFiles/${CMAKE_VERSION})
+    if(NOT SEED_DIR OR NOT EXISTS ${BUILD_DIRECTORY}/CMakeCache.txt OR NOT EXISTS ${_ucs_PLATFORM_DIR}/CMakeSystem.cmake)
+        return()
+    endif()
+    get_filename_component(_ucs_BUILD_NAME ${BUILD_DIRECTORY} NAME)
+    set(_ucs_TMP_SUFFIX "${PORT}-${_ucs_BUILD_NAME}.tmp")
+
+    if(NOT EXISTS ${SEED_DIR})
+        set(_ucs_TMP_DIR "${SEED_DIR}.${_ucs_TMP_SUFFIX}")
+        file(REMOVE_RECURSE ${_ucs_TMP_DIR})
+        file(GLOB _ucs_PLATFORM_FILES ${_ucs_PLATFORM_DIR}/CMake*.cmake)
+        file(COPY ${_ucs_PLATFORM_FILES} DESTINATION ${_ucs_TMP_DIR})
+        execute_process(COMMAND ${CMAKE_COMMAND} -E rename ${_ucs_TMP_DIR} ${SEED_DIR} RESULT_VARIABLE _ucs_RESULT OUTPUT_QUIET ERROR_QUIET)
+        file(REMOVE_RECURSE ${_ucs_TMP_DIR})
+    endif()
+
+    # Recorded results, one set() per line
+    set(_ucs_NAMES)
+    if(EXISTS ${SEED_DIR}/checks.cmake)
+        file(STRINGS ${SEED_DIR}/checks.cmake _ucs_LINES REGEX "^set\\(HAVE_")
+        foreach(_ucs_LINE ${_ucs_LINES})
+            string(REGEX REPLACE "^set\\(([A-Z0-9_]+) .*" "\\1" _ucs_NAME "${_ucs_LINE}")
+            list(APPEND _ucs_NAMES ${_ucs_NAME})
+            set(_ucs_ENTRY_${_ucs_NAME} "${_ucs_LINE}")
+        endforeach()
+    endif()
+
+    # In CMakeCache.txt each entry follows its help string
+    set(_ucs_CHANGED OFF)
+    set(_ucs_HELP)
+    file(STRINGS ${BUILD_DIRECTORY}/CMakeCache.txt _ucs_CACHE_LINES REGEX "^(//Have include |HAVE_[A-Z0-9_]+:INTERNAL=)")
+    foreach(_ucs_LINE ${_ucs_CACHE_LINES})
+        if(_ucs_LINE MATCHES "^//(Have include (.+))$")
+            set(_ucs_HELP "${CMAKE_MATCH_1}")
+            vcpkg_configure_seed_variable(_ucs_EXPECTED "${CMAKE_MATCH_2}")
+        elseif(_ucs_HELP AND _ucs_EXPECTED AND _ucs_LINE MATCHES "^(HAVE_[A-Z0-9_]+):INTERNAL=(1?)$")
+            set(_ucs_NAME ${CMAKE_MATCH_1})
+            if(_ucs_NAME STREQUAL _ucs_EXPECTED AND NOT DEFINED _ucs_ENTRY_${_ucs_NAME})
+                list(APPEND _ucs_NAMES ${_ucs_NAME})
+                set(_ucs_ENTRY_${_ucs_NAME} "set(${_ucs_NAME} \"${CMAKE_MATCH_2}\" CACHE INTERNAL \"${_ucs_HELP}\")")
+                set(_ucs_CHANGED ON)
+            endif()
+            set(_ucs_HELP)
+        else()
+            set(_ucs_HELP)
+        endif()
+    endforeach()
+
+    if(EXISTS ${SEED_DIR}/checks.cmake AND NOT _ucs_CHANGED)
+        return()
+    endif()
+
+    list(SORT _ucs_NAMES)
+    set(_ucs_CONTENTS "set(CMAKE_PLATFORM_INFO_INITIALIZED 1 CACHE INTERNAL \"\")\n")
+    foreach(_ucs_NAME ${_ucs_NAMES})
+        string(APPEND _ucs_CONTENTS "${_ucs_ENTRY_${_ucs_NAME}}\n")
+    endforeach()
+    set(_ucs_TMP_FILE "${SEED_DIR}/checks.cmake.${_ucs_TMP_SUFFIX}")
+    file(WRITE ${_ucs_TMP_FILE} "${_ucs_CONTENTS}")
+    execute_process(COMMAND ${CMAKE_COMMAND} -E rename ${_ucs_TMP_FILE} ${SEED_DIR}/checks.cmake RESULT_VARIABLE _ucs_RESULT OUTPUT_QUIET ERROR_QUIET)
+    file(REMOVE ${_ucs_TMP_FILE})
+endfunction()
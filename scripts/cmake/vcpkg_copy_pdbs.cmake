@@ -8,7 +8,15 @@ function(vcpkg_copy_pdbs)
         set(${OUTVAR} ${MSG} PARENT_SCOPE)
     endfunction()
 
-    if(VCPKG_LIBRARY_LINKAGE STREQUAL dynamic)
+    # vcpkg reads the debug records of all the DLLs itself, in parallel, rather than running dumpbin for each one
+    if(VCPKG_LIBRARY_LINKAGE STREQUAL dynamic AND VCPKG_EXE)
+        execute_process(COMMAND ${VCPKG_EXE} internal_copy_pdbs ${CURRENT_PACKAGES_DIR}/bin ${CURRENT_PACKAGES_DIR}/debug/bin
+            RESULT_VARIABLE error_code
+        )
+        if(error_code)
+            message(FATAL_ERROR "Could not copy the pdb files of ${PORT}")
+        endif()
+    elseif(VCPKG_LIBRARY_LINKAGE STREQUAL dynamic)
         file(GLOB_RECURSE DLLS ${CURRENT_PACKAGES_DIR}/bin/*.dll ${CURRENT_PACKAGES_DIR}/debug/bin/*.dll)
 
         set(DLLS_WITHOUT_MATCHING_PDBS)
@@ -4,9 +4,25 @@ function(vcpkg_download_distfile VAR)
     set(multipleValuesArgs URLS)
     cmake_parse_arguments(vcpkg_download_distfile "" "${oneValueArgs}" "${multipleValuesArgs}" ${ARGN})
     set(downloaded_file_path ${DOWNLOADS}/${vcpkg_download_distfile_FILENAME})
+    # Written by vcpkg and by this script once the file matched the hash; stale as soon as the file is modified.
+    # vcpkg appends the size of the file, which this script cannot read, and checks it as well.
+    set(verified_stamp_path ${downloaded_file_path}.verified)
+    # Several ports or triplets may need the same file at the same time; only one of them downloads it
+    file(LOCK ${downloaded_file_path}.lock GUARD FUNCTION)
 
     function(test_hash FILE_KIND CUSTOM_ERROR_ADVICE)
         message(STATUS "Testing integrity of ${FILE_KIND}...")
+        file(TIMESTAMP ${downloaded_file_path} file_time "%Y-%m-%dT%H:%M:%S" UTC)
+        set(expected_stamp "${vcpkg_download_distfile_SHA512} ${file_time}\n")
+        if(EXISTS ${verified_stamp_path})
+            file(READ ${verified_stamp_path} verified_stamp)
+            string(FIND "${verified_stamp}" "${vcpkg_download_distfile_SHA512} ${file_time} " sized_stamp_position)
+            if("${verified_stamp}" STREQUAL "${expected_stamp}" OR sized_stamp_position EQUAL 0)
+                message(STATUS "Testing integrity of ${FILE_KIND}... OK (verified earlier)")
+                return()
+            endif()
+        endif()
+
         file(SHA512 ${downloaded_file_path} FILE_HASH)
         if(NOT "${FILE_HASH}" STREQUAL "${vcpkg_download_distfile_SHA512}")
             message(FATAL_ERROR
@@ -16,6 +32,7 @@ function(vcpkg_download_distfile VAR)
                 "      Actual hash: [ ${FILE_HASH} ]\n"
                 "${CUSTOM_ERROR_ADVICE}\n")
         endif()
+        file(WRITE ${verified_stamp_path} "${expected_stamp}")
         message(STATUS "Testing integrity of ${FILE_KIND}... OK")
     endfunction()
 
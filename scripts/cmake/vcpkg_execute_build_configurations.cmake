@@ -0,0 +1,170 @@
+# Usage: vcpkg_execute_build_configurations(COMMAND_RELEASE <cmd> [<args>...] WORKING_DIRECTORY_RELEASE </path/to/dir> LOGNAME_RELEASE <my_log_name>
+#                                           COMMAND_DEBUG <cmd> [<args>...] WORKING_DIRECTORY_DEBUG </path/to/dir> LOGNAME_DEBUG <my_log_name>
+#                                           [JOBS <n>])
+#
+# Runs the release and the debug command as vcpkg_execute_required_process would, or only the one of the configuration
+# the triplet builds (see vcpkg_build_configurations). When the build was started by vcpkg, both commands run at the
+# same time, unless VCPKG_PARALLEL_CONFIGURATIONS is set to OFF by the triplet or the portfile, and each one takes up to
+# JOBS job tokens (default 1).
+function(vcpkg_execute_build_configurations)
+    cmake_parse_arguments(_ebc "" "WORKING_DIRECTORY_RELEASE;WORKING_DIRECTORY_DEBUG;LOGNAME_RELEASE;LOGNAME_DEBUG;JOBS" "COMMAND_RELEASE;COMMAND_DEBUG" ${ARGN})
+    vcpkg_build_configurations(_ebc_CONFIGS)
+
+    # The commands are never expanded into the arguments of another function, which would split arguments containing escaped semicolons
+    if(VCPKG_EXE)
+        vcpkg_parallel_configurations(_ebc_PARALLEL)
+        if(_ebc_PARALLEL)
+            string(REPLACE ";" "," _ebc_BATCHES "${_ebc_CONFIGS}")
+        else()
+            set(_ebc_BATCHES ${_ebc_CONFIGS})
+        endif()
+
+        foreach(_ebc_BATCH ${_ebc_BATCHES})
+            string(REPLACE "," ";" _ebc_BATCH_CONFIGS ${_ebc_BATCH})
+            if(VCPKG_TRACE_PHASES_FILE)
+                string(TIMESTAMP _ebc_START "%Y-%m-%dT%H:%M:%S" UTC)
+            endif()
+
+            set(_ebc_PROCESS_FILES)
+            foreach(CONFIG ${_ebc_BATCH_CONFIGS})
+                vcpkg_write_process_file(_ebc_PROCESS_FILE ${_ebc_LOGNAME_${CONFIG}} "${_ebc_WORKING_DIRECTORY_${CONFIG}}" "${_ebc_JOBS}" _ebc_COMMAND_${CONFIG})
+                list(APPEND _ebc_PROCESS_FILES ${_ebc_PROCESS_FILE})
+            endforeach()
+            vcpkg_run_process_files(_ebc_EXIT_CODES ${_ebc_PROCESS_FILES})
+
+            if(VCPKG_TRACE_PHASES_FILE)
+                string(TIMESTAMP _ebc_END "%Y-%m-%dT%H:%M:%S" UTC)
+            endif()
+            set(_ebc_FAILED OFF)
+            foreach(CONFIG ${_ebc_BATCH_CONFIGS})
+                list(GET _ebc_EXIT_CODES 0 _ebc_RESULT_${CONFIG})
+                list(REMOVE_AT _ebc_EXIT_CODES 0)
+                if(_ebc_RESULT_${CONFIG})
+                    set(_ebc_FAILED ON)
+                endif()
+                if(VCPKG_TRACE_PHASES_FILE)
+                    file(APPEND ${VCPKG_TRACE_PHASES_FILE} "${_ebc_LOGNAME_${CONFIG}} ${_ebc_START} ${_ebc_END}\n")
+                endif()
+            endforeach()
+            if(_ebc_FAILED)
+                break()
+            endif()
+        endforeach()
+    else()
+        foreach(CONFIG ${_ebc_CONFIGS})
+            if(VCPKG_TRACE_PHASES_FILE)
+                string(TIMESTAMP _ebc_START "%Y-%m-%dT%H:%M:%S" UTC)
+            endif()
+            execute_process(
+                COMMAND ${_ebc_COMMAND_${CONFIG}}
+                OUTPUT_FILE ${CURRENT_BUILDTREES_DIR}/${_ebc_LOGNAME_${CONFIG}}-out.log
+                ERROR_FILE ${CURRENT_BUILDTREES_DIR}/${_ebc_LOGNAME_${CONFIG}}-err.log
+                RESULT_VARIABLE _ebc_RESULT_${CONFIG}
+                WORKING_DIRECTORY ${_ebc_WORKING_DIRECTORY_${CONFIG}})
+            if(VCPKG_TRACE_PHASES_FILE)
+                string(TIMESTAMP _ebc_END "%Y-%m-%dT%H:%M:%S" UTC)
+                file(APPEND ${VCPKG_TRACE_PHASES_FILE} "${_ebc_LOGNAME_${CONFIG}} ${_ebc_START} ${_ebc_END}\n")
+            endif()
+            if(_ebc_RESULT_${CONFIG})
+                break()
+            endif()
+        endforeach()
+    endif()
+
+    file(TO_NATIVE_PATH "${CURRENT_BUILDTREES_DIR}" NATIVE_BUILDTREES_DIR)
+    foreach(CONFIG ${_ebc_CONFIGS})
+        if(_ebc_RESULT_${CONFIG})
+            message(FATAL_ERROR
+                "  Command failed: ${_ebc_COMMAND_${CONFIG}}\n"
+                "  Working Directory: ${_ebc_WORKING_DIRECTORY_${CONFIG}}\n"
+                "  See logs for more information:\n"
+                "    ${NATIVE_BUILDTREES_DIR}\\${_ebc_LOGNAME_${CONFIG}}-out.log\n"
+                "    ${NATIVE_BUILDTREES_DIR}\\${_ebc_LOGNAME_${CONFIG}}-err.log\n")
+        endif()
+    endforeach()
+endfunction()
+
+# Usage: vcpkg_build_configurations(<VAR>)
+# Sets VAR to the configurations the triplet builds: RELEASE and DEBUG, or only the one named by VCPKG_BUILD_TYPE
+# (release or debug) when the triplet or the portfile sets it
+function(vcpkg_build_configurations VAR)
+    if(NOT VCPKG_BUILD_TYPE)
+        set(${VAR} RELEASE DEBUG PARENT_SCOPE)
+    elseif(VCPKG_BUILD_TYPE STREQUAL "release")
+        set(${VAR} RELEASE PARENT_SCOPE)
+    elseif(VCPKG_BUILD_TYPE STREQUAL "debug")
+        set(${VAR} DEBUG PARENT_SCOPE)
+    else()
+        message(FATAL_ERROR "VCPKG_BUILD_TYPE must be release or debug, but is ${VCPKG_BUILD_TYPE}")
+    endif()
+endfunction()
+
+# Usage: vcpkg_describe_build_configurations(<VAR>)
+# Sets VAR to the names of the build trees of the configurations the triplet builds, for messages
+function(vcpkg_describe_build_configurations VAR)
+    vcpkg_build_configurations(_dbc_CONFIGS)
+    set(_dbc_NAME_RELEASE ${TARGET_TRIPLET}-rel)
+    set(_dbc_NAME_DEBUG ${TARGET_TRIPLET}-dbg)
+    set(_dbc_NAMES)
+    foreach(_dbc_CONFIG ${_dbc_CONFIGS})
+        list(APPEND _dbc_NAMES ${_dbc_NAME_${_dbc_CONFIG}})
+    endforeach()
+    string(REPLACE ";" " and " _dbc_NAMES "${_dbc_NAMES}")
+    set(${VAR} "${_dbc_NAMES}" PARENT_SCOPE)
+endfunction()
+
+# Usage: vcpkg_parallel_configurations(<VAR>)
+# Sets VAR to whether vcpkg_execute_build_configurations runs the release and debug commands at the same time
+function(vcpkg_parallel_configurations VAR)
+    vcpkg_build_configurations(_pc_CONFIGS)
+    list(LENGTH _pc_CONFIGS _pc_COUNT)
+    if(VCPKG_EXE AND _pc_COUNT GREATER 1 AND (NOT DEFINED VCPKG_PARALLEL_CONFIGURATIONS OR VCPKG_PARALLEL_CONFIGURATIONS))
+        set(${VAR} ON PARENT_SCOPE)
+    else()
+        set(${VAR} OFF PARENT_SCOPE)
+    endif()
+endfunction()
+
+# Usage: vcpkg_get_configuration_jobs(<VAR>)
+# Sets VAR to the number of jobs each configuration may build with: the share of the machine vcpkg gave to this port
+# (VCPKG_BUILD_JOBS), split between the configurations that run at the same time. Empty when vcpkg gave no share.
+function(vcpkg_get_configuration_jobs VAR)
+    if(NOT VCPKG_BUILD_JOBS)
+        set(${VAR} "" PARENT_SCOPE)
+        return()
+    endif()
+
+    set(_gcj_JOBS ${VCPKG_BUILD_JOBS})
+    vcpkg_parallel_configurations(_gcj_PARALLEL)
+    if(_gcj_PARALLEL)
+        math(EXPR _gcj_JOBS "(${VCPKG_BUILD_JOBS} + 1) / 2")
+    endif()
+    set(${VAR} ${_gcj_JOBS} PARENT_SCOPE)
+endfunction()
+
+# Usage: vcpkg_get_build_tool_jobs_options(<VAR> <build directory>)
+# Sets VAR to the options limiting the native build tool of a configured CMake build directory to its share of jobs,
+# to be passed after "cmake --build <dir> --". When the build was started by vcpkg, the share is the number of job
+# tokens the process got, substituted for @VCPKG_JOBS@ by vcpkg.
+function(vcpkg_get_build_tool_jobs_options VAR BUILD_DIRECTORY)
+    if(VCPKG_EXE)
+        set(_gbt_JOBS @VCPKG_JOBS@)
+    else()
+        vcpkg_get_configuration_jobs(_gbt_JOBS)
+    endif()
+    file(STRINGS ${BUILD_DIRECTORY}/CMakeCache.txt _gbt_GENERATOR REGEX "^CMAKE_GENERATOR:INTERNAL=")
+    if(_gbt_GENERATOR MATCHES "Ninja")
+        if(_gbt_JOBS)
+            set(${VAR} -j${_gbt_JOBS} PARENT_SCOPE)
+        else()
+            set(${VAR} "" PARENT_SCOPE)
+        endif()
+    else()
+        vcpkg_compiler_cache_msbuild_options(_gbt_COMPILER_CACHE_OPTIONS)
+        if(_gbt_JOBS)
+            set(${VAR} /p:VCPkgLocalAppDataDisabled=true /m:${_gbt_JOBS} ${_gbt_COMPILER_CACHE_OPTIONS} PARENT_SCOPE)
+        else()
+            set(${VAR} /p:VCPkgLocalAppDataDisabled=true /m ${_gbt_COMPILER_CACHE_OPTIONS} PARENT_SCOPE)
+        endif()
+    endif()
+endfunction()
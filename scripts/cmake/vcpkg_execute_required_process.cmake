@@ -1,14 +1,31 @@
-# Usage: vcpkg_execute_required_process(COMMAND <cmd> [<args>...] WORKING_DIRECTORY </path/to/dir> LOGNAME <my_log_name>)
+# Usage: vcpkg_execute_required_process(COMMAND <cmd> [<args>...] WORKING_DIRECTORY </path/to/dir> LOGNAME <my_log_name> [JOBS <n>])
+#
+# When the build was started by vcpkg, the command runs once it got job tokens from the pool vcpkg shares between
+# every build on the machine: at least one, up to JOBS (default 1). Arguments containing @VCPKG_JOBS@ get the number of tokens.
 function(vcpkg_execute_required_process)
-    cmake_parse_arguments(vcpkg_execute_required_process "" "WORKING_DIRECTORY;LOGNAME" "COMMAND" ${ARGN})
+    cmake_parse_arguments(vcpkg_execute_required_process "" "WORKING_DIRECTORY;LOGNAME;JOBS" "COMMAND" ${ARGN})
     #debug_message("vcpkg_execute_required_process(${vcpkg_execute_required_process_COMMAND})")
-    execute_process(
-        COMMAND ${vcpkg_execute_required_process_COMMAND}
-        OUTPUT_FILE ${CURRENT_BUILDTREES_DIR}/${vcpkg_execute_required_process_LOGNAME}-out.log
-        ERROR_FILE ${CURRENT_BUILDTREES_DIR}/${vcpkg_execute_required_process_LOGNAME}-err.log
-        RESULT_VARIABLE error_code
-        WORKING_DIRECTORY ${vcpkg_execute_required_process_WORKING_DIRECTORY})
+    if(VCPKG_TRACE_PHASES_FILE)
+        string(TIMESTAMP vcpkg_execute_required_process_start "%Y-%m-%dT%H:%M:%S" UTC)
+    endif()
+    if(VCPKG_EXE)
+        vcpkg_write_process_file(_erp_PROCESS_FILE ${vcpkg_execute_required_process_LOGNAME} "${vcpkg_execute_required_process_WORKING_DIRECTORY}"
+            "${vcpkg_execute_required_process_JOBS}" vcpkg_execute_required_process_COMMAND)
+        vcpkg_run_process_files(error_code ${_erp_PROCESS_FILE})
+    else()
+        execute_process(
+            COMMAND ${vcpkg_execute_required_process_COMMAND}
+            OUTPUT_FILE ${CURRENT_BUILDTREES_DIR}/${vcpkg_execute_required_process_LOGNAME}-out.log
+            ERROR_FILE ${CURRENT_BUILDTREES_DIR}/${vcpkg_execute_required_process_LOGNAME}-err.log
+            RESULT_VARIABLE error_code
+            WORKING_DIRECTORY ${vcpkg_execute_required_process_WORKING_DIRECTORY})
+    endif()
     #debug_message("error_code=${error_code}")
+    if(VCPKG_TRACE_PHASES_FILE)
+        # Read back by vcpkg --trace-file: "<logname> <start> <end>" as UTC times
+        string(TIMESTAMP vcpkg_execute_required_process_end "%Y-%m-%dT%H:%M:%S" UTC)
+        file(APPEND ${VCPKG_TRACE_PHASES_FILE} "${vcpkg_execute_required_process_LOGNAME} ${vcpkg_execute_required_process_start} ${vcpkg_execute_required_process_end}\n")
+    endif()
     file(TO_NATIVE_PATH "${CURRENT_BUILDTREES_DIR}" NATIVE_BUILDTREES_DIR)
     if(error_code)
         message(FATAL_ERROR
@@ -19,3 +36,38 @@ function(vcpkg_execute_required_process)
             "    ${NATIVE_BUILDTREES_DIR}\\${vcpkg_execute_required_process_LOGNAME}-err.log\n")
     endif()
 endfunction()
+
+# Usage: vcpkg_write_process_file(<VAR> <logname> <working directory> <jobs> <command variable>)
+# Writes the file vcpkg internal_run_parallel reads a process from, one line each: the logs, the working directory,
+# the number of jobs (default 1), then each argument. Sets VAR to its path. The command is passed by variable name,
+# since expanding it into the arguments of this function would split arguments containing escaped semicolons.
+function(vcpkg_write_process_file VAR LOGNAME WORKING_DIRECTORY JOBS COMMAND_VARIABLE)
+    if(NOT JOBS)
+        set(JOBS 1)
+    endif()
+    set(_wpf_LINES "${CURRENT_BUILDTREES_DIR}/${LOGNAME}-out.log\n${CURRENT_BUILDTREES_DIR}/${LOGNAME}-err.log\n${WORKING_DIRECTORY}\n${JOBS}\n")
+    foreach(_wpf_ARG IN LISTS ${COMMAND_VARIABLE})
+        string(APPEND _wpf_LINES "${_wpf_ARG}\n")
+    endforeach()
+    set(_wpf_PROCESS_FILE ${CURRENT_BUILDTREES_DIR}/${LOGNAME}.process)
+    file(WRITE ${_wpf_PROCESS_FILE} "${_wpf_LINES}")
+    set(${VAR} ${_wpf_PROCESS_FILE} PARENT_SCOPE)
+endfunction()
+
+# Usage: vcpkg_run_process_files(<VAR> <process file>...)
+# Runs the processes written by vcpkg_write_process_file at the same time and removes the files. Sets VAR to their
+# exit codes, in order.
+function(vcpkg_run_process_files VAR)
+    execute_process(
+        COMMAND ${VCPKG_EXE} internal_run_parallel ${ARGN}
+        OUTPUT_VARIABLE _rpf_EXIT_CODES
+        RESULT_VARIABLE _rpf_RESULT)
+    file(REMOVE ${ARGN})
+    string(REGEX MATCHALL "[0-9]+" _rpf_EXIT_CODES "${_rpf_EXIT_CODES}")
+    list(LENGTH _rpf_EXIT_CODES _rpf_EXIT_CODE_COUNT)
+    list(LENGTH ARGN _rpf_PROCESS_COUNT)
+    if(_rpf_RESULT OR NOT _rpf_EXIT_CODE_COUNT EQUAL _rpf_PROCESS_COUNT)
+        message(FATAL_ERROR "  Command failed: ${VCPKG_EXE} internal_run_parallel ${ARGN}\n")
+    endif()
+    set(${VAR} ${_rpf_EXIT_CODES} PARENT_SCOPE)
+endfunction()
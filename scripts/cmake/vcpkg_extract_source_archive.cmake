@@ -1,5 +1,7 @@
 include(vcpkg_execute_required_process)
 
+# When the build was started by vcpkg, archives are extracted through its source cache in downloads/extracted: each
+# archive is decompressed once, and every later extraction hard links the cached files into the working directory.
 function(vcpkg_extract_source_archive ARCHIVE)
     if(NOT ARGC EQUAL 2)
         set(WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/src)
@@ -8,11 +10,18 @@ function(vcpkg_extract_source_archive ARCHIVE)
     endif()
 
     get_filename_component(ARCHIVE_FILENAME ${ARCHIVE} NAME)
+    # Triplets of a port are built concurrently: the first one extracts, the others wait and reuse its extraction
+    file(MAKE_DIRECTORY ${WORKING_DIRECTORY})
+    file(LOCK ${WORKING_DIRECTORY}.lock GUARD FUNCTION)
     if(NOT EXISTS ${WORKING_DIRECTORY}/${ARCHIVE_FILENAME}.extracted)
         message(STATUS "Extracting source ${ARCHIVE}")
-        file(MAKE_DIRECTORY ${WORKING_DIRECTORY})
+        if(VCPKG_EXE)
+            set(_vesa_COMMAND ${VCPKG_EXE} internal_extract ${ARCHIVE} ${WORKING_DIRECTORY})
+        else()
+            set(_vesa_COMMAND ${CMAKE_COMMAND} -E tar xjf ${ARCHIVE})
+        endif()
         vcpkg_execute_required_process(
-            COMMAND ${CMAKE_COMMAND} -E tar xjf ${ARCHIVE}
+            COMMAND ${_vesa_COMMAND}
             WORKING_DIRECTORY ${WORKING_DIRECTORY}
             LOGNAME extract
         )
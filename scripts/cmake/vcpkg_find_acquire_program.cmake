@@ -36,6 +36,12 @@ function(vcpkg_find_acquire_program VAR)
     set(URL "http://download.qt.io/official_releases/jom/jom_1_1_1.zip")
     set(ARCHIVE "jom_1_1_1.zip")
     set(HASH 23a26dc7e29979bec5dcd3bfcabf76397b93ace64f5d46f2254d6420158bac5eff1c1a8454e3427e7a2fe2c233c5f2cffc87b376772399e12e40b51be2c065f4)
+  elseif(VAR MATCHES "NINJA")
+    set(PROGNAME ninja)
+    set(PATHS ${DOWNLOADS}/tools/ninja)
+    set(URL "https://github.com/ninja-build/ninja/releases/download/v1.7.2/ninja-win.zip")
+    set(ARCHIVE "ninja-win.zip")
+    set(HASH cccab9281b274c564f9ad77a2115be1f19be67d7b2ee14a55d1db1b27f3b68db8e76076e4f804b61eb8e573e26a8ecc9985675a8dcf03fd7a77b7f57234f1393)
   else()
     message(FATAL "unknown tool ${VAR} -- unable to acquire.")
   endif()
@@ -1,17 +1,25 @@
 function(vcpkg_install_cmake)
-    message(STATUS "Package ${TARGET_TRIPLET}-rel")
-    vcpkg_execute_required_process(
-        COMMAND ${CMAKE_COMMAND} --build . --config Release --target install
-        WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel
-        LOGNAME package-${TARGET_TRIPLET}-rel
-    )
-    message(STATUS "Package ${TARGET_TRIPLET}-rel done")
+    # Only the configurations the triplet builds were configured
+    vcpkg_build_configurations(_ic_CONFIGS)
+    if(RELEASE IN_LIST _ic_CONFIGS)
+        vcpkg_get_build_tool_jobs_options(_ic_RELEASE_OPTIONS ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel)
+    endif()
+    if(DEBUG IN_LIST _ic_CONFIGS)
+        vcpkg_get_build_tool_jobs_options(_ic_DEBUG_OPTIONS ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg)
+    endif()
+    vcpkg_describe_build_configurations(_ic_NAMES)
+    vcpkg_get_configuration_jobs(_ic_JOBS)
 
-    message(STATUS "Package ${TARGET_TRIPLET}-dbg")
-    vcpkg_execute_required_process(
-        COMMAND ${CMAKE_COMMAND} --build . --config Debug --target install
-        WORKING_DIRECTORY ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg
-        LOGNAME package-${TARGET_TRIPLET}-dbg
+    # Builds whatever vcpkg_build_cmake did not, so it gets the same share of jobs
+    message(STATUS "Package ${_ic_NAMES}")
+    vcpkg_execute_build_configurations(
+        COMMAND_RELEASE ${CMAKE_COMMAND} --build . --config Release --target install -- ${_ic_RELEASE_OPTIONS}
+        WORKING_DIRECTORY_RELEASE ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-rel
+        LOGNAME_RELEASE package-${TARGET_TRIPLET}-rel
+        COMMAND_DEBUG ${CMAKE_COMMAND} --build . --config Debug --target install -- ${_ic_DEBUG_OPTIONS}
+        WORKING_DIRECTORY_DEBUG ${CURRENT_BUILDTREES_DIR}/${TARGET_TRIPLET}-dbg
+        LOGNAME_DEBUG package-${TARGET_TRIPLET}-dbg
+        JOBS ${_ic_JOBS}
     )
-    message(STATUS "Package ${TARGET_TRIPLET}-dbg done")
+    message(STATUS "Package ${_ic_NAMES} done")
 endfunction()
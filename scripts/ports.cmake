@@ -21,9 +21,21 @@ set(VCPKG_ROOT_DIR ${VCPKG_ROOT_DIR_CANDIDATE})
 
 list(APPEND CMAKE_MODULE_PATH ${VCPKG_ROOT_DIR}/scripts/cmake)
 set(CURRENT_INSTALLED_DIR ${VCPKG_ROOT_DIR}/installed/${TARGET_TRIPLET} CACHE PATH "Location to install final packages")
+# The ports listed in Host-Depends are installed for the triplet of the machine: portfiles run their tools from
+# ${CURRENT_HOST_INSTALLED_DIR}/tools, and only build tools of their own when TARGET_TRIPLET is HOST_TRIPLET
+if(NOT DEFINED HOST_TRIPLET)
+    set(HOST_TRIPLET ${TARGET_TRIPLET})
+endif()
+set(CURRENT_HOST_INSTALLED_DIR ${VCPKG_ROOT_DIR}/installed/${HOST_TRIPLET} CACHE PATH "Location of the installed host tools")
 set(DOWNLOADS ${VCPKG_ROOT_DIR}/downloads CACHE PATH "Location to download sources and tools")
-set(PACKAGES_DIR ${VCPKG_ROOT_DIR}/packages CACHE PATH "Location to store package images")
-set(BUILDTREES_DIR ${VCPKG_ROOT_DIR}/buildtrees CACHE PATH "Location to perform actual extract+config+build")
+# The scratch directories may live on a faster volume than the root; vcpkg passes %VCPKG_SCRATCH_ROOT% down
+if(DEFINED ENV{VCPKG_SCRATCH_ROOT} AND NOT "$ENV{VCPKG_SCRATCH_ROOT}" STREQUAL "")
+    file(TO_CMAKE_PATH "$ENV{VCPKG_SCRATCH_ROOT}" VCPKG_SCRATCH_DIR)
+else()
+    set(VCPKG_SCRATCH_DIR ${VCPKG_ROOT_DIR})
+endif()
+set(PACKAGES_DIR ${VCPKG_SCRATCH_DIR}/packages CACHE PATH "Location to store package images")
+set(BUILDTREES_DIR ${VCPKG_SCRATCH_DIR}/buildtrees CACHE PATH "Location to perform actual extract+config+build")
 
 if(PORT)
     set(CURRENT_BUILDTREES_DIR ${BUILDTREES_DIR}/${PORT})
@@ -32,8 +44,13 @@ endif()
 
 
 if(CMD MATCHES "^BUILD$")
-    string(REGEX REPLACE "([^-]*)-([^-]*)" "\\1" TRIPLET_SYSTEM_ARCH ${TARGET_TRIPLET})
-    string(REGEX REPLACE "([^-]*)-([^-]*)" "\\2" TRIPLET_SYSTEM_NAME ${TARGET_TRIPLET})
+    # vcpkg passes both, read from its catalogue of the triplets directory
+    if(NOT DEFINED TRIPLET_SYSTEM_ARCH)
+        string(REGEX REPLACE "([^-]*)-([^-]*)" "\\1" TRIPLET_SYSTEM_ARCH ${TARGET_TRIPLET})
+    endif()
+    if(NOT DEFINED TRIPLET_SYSTEM_NAME)
+        string(REGEX REPLACE "([^-]*)-([^-]*)" "\\2" TRIPLET_SYSTEM_NAME ${TARGET_TRIPLET})
+    endif()
 
     set(CMAKE_TRIPLET_FILE ${VCPKG_ROOT_DIR}/triplets/${TARGET_TRIPLET}.cmake)
     if(NOT EXISTS ${CMAKE_TRIPLET_FILE})
@@ -55,6 +72,7 @@ if(CMD MATCHES "^BUILD$")
     endif()
 
     message(STATUS "CURRENT_INSTALLED_DIR=${CURRENT_INSTALLED_DIR}")
+    message(STATUS "CURRENT_HOST_INSTALLED_DIR=${CURRENT_HOST_INSTALLED_DIR}")
     message(STATUS "DOWNLOADS=${DOWNLOADS}")
 
     message(STATUS "CURRENT_PACKAGES_DIR=${CURRENT_PACKAGES_DIR}")
@@ -64,18 +82,45 @@ if(CMD MATCHES "^BUILD$")
     unset(PACKAGES_DIR)
     unset(BUILDTREES_DIR)
 
+    # The previous package is renamed into the trash, which vcpkg empties in the background; it is only deleted here
+    # when it cannot be moved
+    if(EXISTS ${CURRENT_PACKAGES_DIR})
+        string(RANDOM LENGTH 8 _VCPKG_TRASH_SUFFIX)
+        file(MAKE_DIRECTORY ${VCPKG_SCRATCH_DIR}/trash)
+        execute_process(COMMAND ${CMAKE_COMMAND} -E rename ${CURRENT_PACKAGES_DIR} ${VCPKG_SCRATCH_DIR}/trash/${PORT}_${TARGET_TRIPLET}.${_VCPKG_TRASH_SUFFIX}
+            RESULT_VARIABLE _VCPKG_TRASH_RESULT OUTPUT_QUIET ERROR_QUIET)
+        unset(_VCPKG_TRASH_SUFFIX)
+        unset(_VCPKG_TRASH_RESULT)
+    endif()
     file(REMOVE_RECURSE ${CURRENT_PACKAGES_DIR})
     if(EXISTS ${CURRENT_PACKAGES_DIR})
         message(FATAL_ERROR "Unable to remove directory: ${CURRENT_PACKAGES_DIR}\n  Files are likely in use.")
     endif()
     file(MAKE_DIRECTORY ${CURRENT_BUILDTREES_DIR} ${CURRENT_PACKAGES_DIR})
 
+    # vcpkg builds the triplets of a port concurrently. That is safe for portfiles that prepare their sources through
+    # vcpkg_extract_source_archive and vcpkg_apply_patches, which lock the source tree, and build out of it. Portfiles
+    # that run their own commands or modify the sources may do so in the shared source tree, so their triplets take turns.
+    file(READ ${CURRENT_PORT_DIR}/portfile.cmake _VCPKG_PORTFILE_CONTENTS)
+    if(_VCPKG_PORTFILE_CONTENTS MATCHES "execute_process|vcpkg_execute_required_process|vcpkg_build_msbuild|file\\((WRITE|APPEND|RENAME|REMOVE)[^)]*\\\${SOURCE_PATH}|DESTINATION \\\${SOURCE_PATH}")
+        file(LOCK ${CURRENT_BUILDTREES_DIR}/port.lock GUARD PROCESS)
+    endif()
+    unset(_VCPKG_PORTFILE_CONTENTS)
+
     include(${CMAKE_TRIPLET_FILE})
+    include(vcpkg_compiler_cache)
+    vcpkg_enable_compiler_cache()
     include(${CURRENT_PORT_DIR}/portfile.cmake)
 
     set(BUILD_INFO_FILE_PATH ${CURRENT_PACKAGES_DIR}/BUILD_INFO)
     file(WRITE  ${BUILD_INFO_FILE_PATH} "CRTLinkage: ${VCPKG_CRT_LINKAGE}\n")
     file(APPEND ${BUILD_INFO_FILE_PATH} "LibraryLinkage: ${VCPKG_LIBRARY_LINKAGE}")
+    if(VCPKG_BUILD_TYPE)
+        file(APPEND ${BUILD_INFO_FILE_PATH} "\nBuildType: ${VCPKG_BUILD_TYPE}")
+    endif()
+    if(_VCPKG_UNITY_BUILD)
+        file(APPEND ${BUILD_INFO_FILE_PATH} "\nUnityBuild: ON")
+    endif()
 elseif(CMD MATCHES "^CREATE$")
     file(TO_NATIVE_PATH ${VCPKG_ROOT_DIR} NATIVE_VCPKG_ROOT_DIR)
     file(TO_NATIVE_PATH ${DOWNLOADS} NATIVE_DOWNLOADS)
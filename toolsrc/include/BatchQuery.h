@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace vcpkg { namespace BatchQuery
+{
+    // The framing of "vcpkg batch", apart from the loaded state it answers from
+
+    // Splits a query into words at spaces and tabs; double quotes group words, for patterns and paths with spaces
+    std::vector<std::string> split_query(const std::string& query);
+
+    // The first option among words, a split query, that its command does not take, or an empty string. Checked before
+    // the query runs, as vcpkg_cmd_arguments exits on such options.
+    std::string find_invalid_option(const std::vector<std::string>& words);
+
+    // "<status> <n>\n" followed by output, n being its number of lines. A last line without a newline is terminated,
+    // so that the reader of the batch finds the next result where the count says.
+    std::string format_result(const std::string& status, const std::string& output);
+}}
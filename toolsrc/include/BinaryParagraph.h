@@ -3,6 +3,7 @@
 #include <unordered_map>
 #include "SourceParagraph.h"
 #include "package_spec.h"
+#include "Paragraphs.h"
 
 namespace vcpkg
 {
@@ -10,6 +11,7 @@ namespace vcpkg
     {
         BinaryParagraph();
         explicit BinaryParagraph(std::unordered_map<std::string, std::string> fields);
+        explicit BinaryParagraph(const Paragraphs::paragraph_view& fields);
         BinaryParagraph(const SourceParagraph& spgh, const triplet& target_triplet);
 
         std::string displayname() const;
@@ -23,6 +25,8 @@ namespace vcpkg
         std::string description;
         std::string maintainer;
         std::vector<std::string> depends;
+        std::string abi;
+        bool header_only = false;
     };
 
     std::ostream& operator<<(std::ostream& os, const BinaryParagraph& pgh);
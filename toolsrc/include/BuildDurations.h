@@ -0,0 +1,29 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace BuildDurations
+{
+    // Milliseconds a build of each package took on this machine, by "<port>:<triplet>"
+    using duration_map = std::map<std::string, long long>;
+
+    duration_map load(const vcpkg_paths& paths);
+
+    // Merges the measured durations into the ones on disk, averaging each one with the previous record.
+    // The file is only a scheduling hint: failing to write it, or losing to a concurrent vcpkg, is not an error.
+    void record(const vcpkg_paths& paths, const duration_map& measured);
+
+    // plan is in topological order and dependents[i] lists the entries after i that depend on it.
+    // Returns, for each entry, its duration plus the longest chain of dependents that cannot start before it is done.
+    std::vector<long long> critical_paths(const std::vector<long long>& durations, const std::vector<std::vector<size_t>>& dependents);
+
+    // Simulates building the plan job_count entries at a time, starting the ready entry with the longest critical path
+    // first, the way the install command schedules builds. Returns the time the last entry finishes.
+    long long estimate_makespan(const std::vector<long long>& durations, const std::vector<std::vector<size_t>>& dependents, size_t job_count);
+
+    // "1h 02m 03s", "2m 03s", "3s"
+    std::string format_duration(long long milliseconds);
+}}
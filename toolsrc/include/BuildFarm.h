@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "InstallLock.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace BuildFarm
+{
+    // Builds are farmed out to other machines through a directory they all share, %VCPKG_BUILD_FARM%, and the binary
+    // cache, which must be shared as well. install queues each port it would build as <farm>/queue/<abi>/, holding the
+    // plan of the port and its dependencies with their ABI hashes (an install lock file) and their port directories.
+    // `vcpkg farm-worker`, run on each machine of the farm from a vcpkg root with the same triplets and scripts, claims
+    // a queued build by moving it to <farm>/running/, installs the dependencies from the binary cache, builds the port,
+    // stores the package in the binary cache and moves the build to <farm>/done/ with its log and result. install then
+    // restores the package from the binary cache and installs it itself: the status database never leaves the machine.
+
+    // The directory %VCPKG_BUILD_FARM% names, or an empty path when builds are not farmed out
+    fs::path get_farm_dir();
+
+    // The file of a queued build holding its plan
+    fs::path plan_file(const fs::path& build_dir);
+
+    enum class remote_result
+    {
+        SUCCEEDED,
+        FAILED,
+        LOST // Its worker stopped sending heartbeats; the port should be built here
+    };
+
+    // Queues the build of the last package of plan, unless a build of the same ABI is queued or running already, and
+    // waits for it. The log of the worker goes to on_line once the build is done.
+    remote_result build_remotely(const vcpkg_paths& paths, const fs::path& farm_dir, const InstallLock::locked_plan& plan, const std::function<void(const std::string&)>& on_line);
+
+    // Worker side. Claims the oldest queued build and returns its directory under running/, or an empty path when
+    // nothing is queued.
+    fs::path claim(const fs::path& farm_dir);
+
+    // Moves a claimed build to done/, recording whether it succeeded
+    void finish(const fs::path& farm_dir, const fs::path& build_dir, bool succeeded);
+
+    // Tells the machine waiting for a claimed build that its worker is alive, for as long as it exists
+    class heartbeat
+    {
+    public:
+        explicit heartbeat(const fs::path& build_dir);
+        heartbeat(const heartbeat&) = delete;
+        heartbeat& operator=(const heartbeat&) = delete;
+        ~heartbeat();
+
+    private:
+        struct state;
+        std::unique_ptr<state> m_state;
+    };
+}}
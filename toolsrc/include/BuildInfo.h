@@ -58,6 +58,8 @@ namespace vcpkg
 
         std::string crt_linkage;
         std::string library_linkage;
+        std::string build_type; // release or debug when the triplet builds only that configuration; empty for both
+        bool unity_build;       // vcpkg_configure_cmake compiled the port as a unity build (VCPKG_UNITY_BUILD)
     };
 
     BuildInfo read_build_info(const fs::path& filepath);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace BuildResources
+{
+    // What the last build of a package on this machine used, counting every process the build started
+    struct build_resources
+    {
+        long long wall_ms;
+        long long cpu_ms;
+        uint64_t peak_memory_bytes;
+        uint64_t read_bytes;
+        uint64_t write_bytes;
+        bool unity_build;
+        // Wall time of the last build the other way, unity build or not, or 0 if the package was never built that way
+        long long other_wall_ms;
+    };
+
+    // By "<port>:<triplet>"
+    using resource_map = std::map<std::string, build_resources>;
+
+    resource_map load(const vcpkg_paths& paths);
+
+    // Replaces the records of the measured packages, keeping the wall time of a previous build the other way in
+    // other_wall_ms. Like the build durations, failing to write them is not an error.
+    void record(const vcpkg_paths& paths, const resource_map& measured);
+
+    // "512 B", "1.5 KiB", "20.0 MiB", "3.2 GiB"
+    std::string format_bytes(uint64_t bytes);
+}}
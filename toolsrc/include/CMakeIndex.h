@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "BinaryParagraph.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace CMakeIndex
+{
+    // installed/vcpkg/triplets/<triplet>/cmake-index.cmake tells scripts/buildsystems/vcpkg.cmake what each installed
+    // package of the triplet provides, relative to installed/<triplet>:
+    //   VCPKG_INDEX_PACKAGES                     the ports in the index
+    //   VCPKG_INDEX_<port>_CONFIGS               <Name>=<dir> for each <Name>Config.cmake or <name>-config.cmake under share/
+    //   VCPKG_INDEX_<port>_INCLUDE_DIR           include, when the port installs headers
+    //   VCPKG_INDEX_<port>_LIBRARIES             the libs directly in lib/
+    //   VCPKG_INDEX_<port>_DEBUG_LIBRARIES       the libs directly in debug/lib/
+    // The toolchain sets <Name>_DIR from the configs, so find_package() opens the config file without searching for it.
+    // Packages installed before the index existed are not in it until reinstalled; find_package() still searches for them.
+
+    // listed_paths are the package's listfile entries, relative to installed/
+    void add_package(const vcpkg_paths& paths, const BinaryParagraph& pgh, const std::vector<std::string>& listed_paths);
+
+    void remove_packages(const vcpkg_paths& paths, const std::vector<const BinaryParagraph*>& pghs);
+}}
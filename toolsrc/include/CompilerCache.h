@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "vcpkg_paths.h"
+#include "package_spec.h"
+
+namespace vcpkg { namespace CompilerCache
+{
+    // A compiler cache a triplet builds through, as set by VCPKG_COMPILER_CACHE and VCPKG_COMPILER_CACHE_DIR
+    struct compiler_cache
+    {
+        std::string program; // As written in the triplet: a name looked up on the PATH, or a path
+        fs::path dir;
+    };
+
+    struct cache_stats
+    {
+        bool measured;
+        long long hits;
+        long long misses;
+    };
+
+    // The distinct compiler caches used by the triplets of specs
+    std::vector<compiler_cache> find_compiler_caches(const vcpkg_paths& paths, const std::vector<package_spec>& specs);
+
+    // Reads the "cache hits" and "cache misses" counters out of the statistics printed by clcache -s, ccache -s or
+    // sccache --show-stats. measured is false if neither was found.
+    cache_stats parse_stats(const std::string& output);
+
+    // Asks the cache for its statistics, with its directory set as the builds set it
+    cache_stats query_stats(const compiler_cache& cache);
+
+    // "sccache: 120 hits, 30 misses (80% hit rate)", comparing the statistics from before and after the builds
+    std::string format_stats_since(const compiler_cache& cache, const cache_stats& before, const cache_stats& after);
+}}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "StatusParagraphs.h"
+#include "package_spec.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace DiskBudget
+{
+    // downloads/, buildtrees/ and packages/ are kept under a size budget by evicting what was used least recently. An
+    // entry is a distfile (with its .verified stamp and .part file), the build trees of a port, or the package of a spec
+    // (directory or archive). Installs append "<time> <entry>" to installed/vcpkg/access-log for each entry they use;
+    // entries the log does not know are as recent as their last write time. The packages and distfiles of installed
+    // packages, and everything the running installs planned to use, are never evicted.
+
+    // Records that entries, given as paths under downloads/, buildtrees/ or packages/, were just used. The log is only a
+    // hint: failing to write it is not an error.
+    void record_access(const vcpkg_paths& paths, const std::vector<fs::path>& entries);
+
+    // "512", "300K", "20M", "1.5G" or "2T", in powers of 1024. False for anything else.
+    bool parse_size(const std::string& text, uintmax_t& bytes);
+
+    // The budget %VCPKG_DISK_BUDGET% sets for install to enforce once it is done, or 0 when there is none
+    uintmax_t get_budget();
+
+    // Records the plan of a running install or build in installed/vcpkg/plans/<pid> while it lives, so that collections
+    // in other processes keep what it is about to use
+    class pending_plan
+    {
+    public:
+        pending_plan(const vcpkg_paths& paths, const std::vector<package_spec>& plan);
+        pending_plan(const pending_plan&) = delete;
+        pending_plan& operator=(const pending_plan&) = delete;
+        ~pending_plan();
+
+    private:
+        fs::path m_file;
+    };
+
+    struct entry
+    {
+        std::string name; // e.g. "packages/zlib_x86-windows"
+        uintmax_t size = 0;
+        long long last_access = 0; // Ticks of the file time clock
+        bool is_protected = false;
+    };
+
+    // The entries to evict for the total size of entries to fit budget, least recently used first. Protected entries are
+    // never chosen, so the rest may still exceed budget.
+    std::vector<size_t> select_evictions(const std::vector<entry>& entries, uintmax_t budget);
+
+    struct collection
+    {
+        uintmax_t total_size = 0; // Before eviction
+        uintmax_t evicted_size = 0;
+        size_t evicted_count = 0;
+    };
+
+    // Evicts least recently used entries until the rest fits budget, printing each; entries in use are skipped. With
+    // dry_run, only prints what it would evict. status_db must hold the packages of every triplet, as database_load_check(paths) does.
+    collection collect(const vcpkg_paths& paths, const StatusParagraphs& status_db, uintmax_t budget, bool dry_run);
+}}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "BinaryParagraph.h"
+#include "StatusParagraphs.h"
+#include "StatusSnapshot.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace FilesIndex
+{
+    struct owned_file
+    {
+        std::string package; // name:triplet
+        std::string path; // relative to installed/, as it appears in the package's listfile
+    };
+
+    // Maps every file listed by an installed package back to that package.
+    // Entries are kept sorted by reversed path, so exact and suffix lookups are binary searches.
+    class files_index
+    {
+    public:
+        // Rebuilds the index from the listfiles if it does not describe exactly the installed packages
+        static files_index load(const vcpkg_paths& paths, const StatusParagraphs& status_db);
+        static files_index load(const vcpkg_paths& paths, const status_snapshot& status_db);
+
+        std::vector<owned_file> find_exact(const std::string& path) const;
+        std::vector<owned_file> find_suffix(const std::string& suffix) const;
+        // Ignores ASCII case, as the file system does
+        std::vector<owned_file> find_substring(const std::string& substring) const;
+
+        struct entry
+        {
+            const char* path_begin;
+            const char* path_end;
+            const char* package_begin;
+            const char* package_end;
+        };
+
+    private:
+        // installed_listfiles is only called when the index has to be rebuilt; it returns the displayname and listfile of
+        // every installed package
+        static files_index load(const vcpkg_paths& paths, const std::set<std::string>& installed_names,
+                                const std::function<std::vector<std::pair<std::string, fs::path>>()>& installed_listfiles);
+
+        std::unique_ptr<std::string> text; // Heap allocated so that entries survive moves
+        std::vector<entry> entries;
+    };
+
+    // Keep an existing index in sync with installs and removals. Without an index they do nothing;
+    // the next load builds it from the listfiles.
+    void add_package_files(const vcpkg_paths& paths, const BinaryParagraph& pgh, const std::vector<std::string>& listed_paths);
+    void remove_package_files(const vcpkg_paths& paths, const std::vector<const BinaryParagraph*>& pghs);
+}}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "package_spec.h"
+#include "vcpkg_Graphs.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace InstallLock
+{
+    // An install plan as `install --write-lock` records it: every package in build order, with its ABI hash (which
+    // covers the contents of its port, its triplet, the build scripts and the hashes of its dependencies) and the
+    // packages of the plan it depends on. `install --lock` runs it as is, without reading any CONTROL file; the
+    // recorded hashes are the binary cache keys of the packages.
+    struct locked_plan
+    {
+        std::vector<package_spec> plan;
+        Graphs::Graph<package_spec> dependency_graph;
+        std::unordered_map<package_spec, std::string> abis;
+    };
+
+    // abis must hold the hash of every package of plan
+    void write(const fs::path& lock_file, const std::vector<package_spec>& plan, const Graphs::Graph<package_spec>& dependency_graph,
+               const std::unordered_map<package_spec, std::string>& abis);
+
+    // Exits with an error when lock_file cannot be read or was not written by write()
+    locked_plan read(const fs::path& lock_file);
+}}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace vcpkg { namespace Listfile
+{
+    namespace fs = std::tr2::sys;
+
+    enum class entry_type : char
+    {
+        unknown, // Text listfiles do not say
+        file,
+        directory
+    };
+
+    struct listed_entry
+    {
+        std::string path; // Relative to installed/, e.g. x86-windows/include/zlib.h
+        entry_type type;
+    };
+
+    // Writes the listfile of an installed package in the compact format: each path is stored as the length of the prefix
+    // it shares with the previous one and the rest of it, so entries should be sorted. The listfile is replaced whole, or
+    // left as it was and false returned if it could not be written.
+    bool write(const fs::path& listfile, const std::vector<listed_entry>& entries);
+
+    // Calls f with every entry of a listfile in the compact or in the text format, in the order they are listed. path is
+    // the same buffer from one call to the next. Returns false if the listfile could not be read.
+    bool for_each_entry(const fs::path& listfile, const std::function<void(const std::string& path, entry_type type)>& f);
+}}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "BinaryParagraph.h"
+#include "StatusParagraphs.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace MSBuildProps
+{
+    // installed/vcpkg/msbuild/<triplet>/<port>.props links the libs of one installed package and of every package it
+    // depends on, debug or release after $(VcpkgConfiguration). A project that imports the files of the packages it uses,
+    // through $(VcpkgPackageProps) of vcpkg.targets, links those libs instead of every lib of installed/<triplet>/lib.
+    // The files exist once `vcpkg integrate install` has written them, and install and remove keep them up to date.
+
+    // Writes the file of every installed package of status_db and removes the files of packages no longer installed
+    void write_all(const vcpkg_paths& paths, const StatusParagraphs& status_db);
+
+    // Writes the file of pgh, whose dependencies status_db must hold, once `vcpkg integrate install` has written them all
+    void add_package(const vcpkg_paths& paths, const BinaryParagraph& pgh, const StatusParagraphs& status_db);
+
+    void remove_package(const vcpkg_paths& paths, const BinaryParagraph& pgh);
+}}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "expected.h"
+#include "package_spec.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace PackageArchive
+{
+    // When %VCPKG_COMPRESS_PACKAGES% is set, a package is kept in packages/ as packages/<spec>.pack once it is built
+    // rather than as the packages/<spec> directory, and installed straight out of the archive.
+    //
+    // Each file is deflated on its own, or stored when that does not make it smaller; an index at the end of the
+    // archive, as in a zip file, locates any of them without reading the others, so CONTROL is read without touching
+    // the rest and the files are extracted concurrently.
+    bool is_enabled();
+
+    fs::path archive_path(const vcpkg_paths& paths, const package_spec& spec);
+
+    struct entry
+    {
+        std::string path; // Relative to the package directory, with forward slashes
+        bool is_directory;
+        uint8_t method; // 0: stored, 1: deflated
+        uint32_t crc;
+        uint64_t offset;
+        uint64_t stored_size;
+        uint64_t size;
+    };
+
+    // Replaces archive with one holding everything below package_dir; false if a file could not be read or written
+    bool pack(const fs::path& package_dir, const fs::path& archive);
+
+    class reader
+    {
+    public:
+        static expected<reader> open(const fs::path& archive);
+
+        // Directories come before their contents
+        const std::vector<entry>& entries() const { return m_entries; }
+        const entry* find(const std::string& path) const;
+
+        // Replaces out with the contents of the file e; false if they do not match what was archived.
+        // Safe to call from several threads at once.
+        bool read(const entry& e, std::string& out) const;
+
+    private:
+        Files::mapped_file m_file;
+        std::vector<entry> m_entries;
+    };
+
+    expected<std::string> read_file(const fs::path& archive, const std::string& path);
+
+    // The CONTROL file of the built package for spec, from packages/<spec> or else its archive
+    expected<std::string> read_control_file(const vcpkg_paths& paths, const package_spec& spec);
+
+    // Replaces packages/<spec> with its archive when compression is enabled. The directory is kept, with a warning,
+    // if the archive cannot be written.
+    void compress_package(const vcpkg_paths& paths, const package_spec& spec);
+}}
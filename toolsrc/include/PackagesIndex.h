@@ -0,0 +1,42 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "BinaryParagraph.h"
+#include "package_spec.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace PackagesIndex
+{
+    // The binary paragraph of every built package in packages/, whether kept as a directory or as an archive, ordered
+    // by package directory name. Packages whose CONTROL file (or archive) has the size and last write time recorded in
+    // the packages index are not opened; the index is rewritten whenever a package was changed or removed since.
+    std::vector<BinaryParagraph> load_binary_paragraphs(const vcpkg_paths& paths);
+
+    // Read-only snapshot of the packages index, for looking up many packages without reading their CONTROL files
+    class packages_index
+    {
+    public:
+        // Reads the index as it is; entries are checked against packages/ when they are looked up
+        static packages_index load(const vcpkg_paths& paths);
+
+        // The paragraph recorded for spec, or null when there is none or the package changed since it was recorded.
+        // Safe to call from several threads at once.
+        const BinaryParagraph* find(const vcpkg_paths& paths, const package_spec& spec) const;
+
+        struct entry
+        {
+            std::string control_size;
+            std::string control_mtime;
+            BinaryParagraph binary;
+        };
+
+    private:
+        std::map<std::string, entry> entries; // By package directory name
+    };
+
+    // Records the package whose CONTROL file was just written for bpgh, so the next reader need not parse it. The entry
+    // is appended to the index; load_binary_paragraphs drops the ones it replaces.
+    void add_package(const vcpkg_paths& paths, const BinaryParagraph& bpgh);
+}}
@@ -1,11 +1,63 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace vcpkg { namespace Paragraphs
 {
     namespace fs = std::tr2::sys;
+
+    // [begin, end) range of characters inside the text owned by a parsed_paragraphs
+    struct text_range
+    {
+        const char* begin;
+        const char* end;
+
+        size_t size() const { return static_cast<size_t>(end - begin); }
+        std::string to_string() const { return std::string(begin, end); }
+        bool operator==(const std::string& s) const { return s.size() == size() && s.compare(0, s.size(), begin, size()) == 0; }
+    };
+
+    struct field_view
+    {
+        text_range name;
+        text_range value;
+    };
+
+    struct paragraph_view
+    {
+        const field_view* begin;
+        const field_view* end;
+
+        // Returns nullptr if the field is not present
+        const text_range* find(const std::string& fieldname) const;
+
+        std::unordered_map<std::string, std::string> to_map() const;
+    };
+
+    // Owns the text that was parsed; every field of every paragraph is a view into it.
+    // Field storage is flat: one vector of fields for all paragraphs.
+    class parsed_paragraphs
+    {
+    public:
+        size_t size() const { return paragraph_ends.size(); }
+        bool empty() const { return paragraph_ends.empty(); }
+        paragraph_view operator[](size_t i) const;
+
+    private:
+        friend parsed_paragraphs parse_paragraph_views(std::string text);
+
+        std::unique_ptr<std::string> text; // Heap allocated so that views survive moves
+        std::vector<field_view> fields;
+        std::vector<size_t> paragraph_ends;
+    };
+
+    parsed_paragraphs parse_paragraph_views(std::string text);
+    parsed_paragraphs get_paragraph_views(const fs::path& control_path);
+
     std::vector<std::unordered_map<std::string, std::string>> get_paragraphs(const fs::path& control_path);
     std::vector<std::unordered_map<std::string, std::string>> parse_paragraphs(const std::string& str);
 }}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "SourceParagraph.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace PortsIndex
+{
+    namespace fs = std::tr2::sys;
+
+    // Returns the source paragraph of every port in ports_dir, ordered by port directory name.
+    // CONTROL files whose size and last write time match the ones recorded in index_file are not opened;
+    // their paragraphs are served from the index, which is rewritten whenever a port was added, changed or removed.
+    // Passing an empty index_file parses every CONTROL file and persists nothing.
+    std::vector<SourceParagraph> load_source_paragraphs(const fs::path& ports_dir, const fs::path& index_file);
+
+    std::vector<SourceParagraph> load_source_paragraphs(const vcpkg_paths& paths);
+
+    // Inverted index from the lowercase words of the name, description and maintainer of every port to the ports they
+    // appear in. Words are the runs of ASCII letters and digits.
+    class search_index
+    {
+    public:
+        explicit search_index(std::vector<SourceParagraph> source_paragraphs);
+
+        // In the order they were given
+        const std::vector<SourceParagraph>& source_paragraphs() const { return ports; }
+
+        // The ports matching every term, best match first, ties by name. A term matches a port whose name contains it,
+        // or, when it is a single word, a port with a word starting with it. Matching is ASCII case-insensitive.
+        // Names rank above descriptions and maintainers, and whole names and words above prefixes.
+        std::vector<const SourceParagraph*> search(const std::vector<std::string>& terms) const;
+
+    private:
+        struct posting
+        {
+            uint32_t port;
+            bool in_name;
+        };
+
+        struct word_postings
+        {
+            std::string word;
+            std::vector<posting> postings; // One per port, by port
+        };
+
+        std::vector<SourceParagraph> ports;
+        std::vector<std::string> lowercase_names; // By port
+        std::vector<word_postings> words; // Sorted by word, so that the words with a given prefix are contiguous
+    };
+}}
@@ -26,6 +26,8 @@ namespace vcpkg
         std::string description;
         std::string maintainer;
         std::vector<dependency> depends;
+        std::vector<dependency> host_depends; // Ports whose tools the build runs, built for the host triplet
+        bool header_only = false; // Nothing is compiled: no toolchain environment, no binary checks
     };
 
     std::vector<std::string> filter_dependencies(const std::vector<vcpkg::dependency>& deps, const triplet& t);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "expected.h"
+#include "Paragraphs.h"
+#include "StatusParagraphs.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace StatusBinarySnapshot
+{
+    // status.bin holds what the status file of the same database holds in a form that is used where it is mapped: fixed-size
+    // records, a hash table by name:triplet, the records each package depends on, and the text of every paragraph.
+    // It is stamped with the size and last write time of the status file it mirrors and ignored once they change: the
+    // status file stays the source of truth. Both are only written under the exclusive lock of the status database.
+
+    // Writes the snapshot of status_db, which must hold what the status file holds; does nothing without a status file
+    void write(const status_database_files& db, const StatusParagraphs& status_db);
+
+    // Writes the status file back from the snapshot, for a root that lost its status file but kept the snapshot.
+    // Returns false when there is no snapshot to restore it from.
+    bool restore_status_file(const status_database_files& db);
+
+    class snapshot
+    {
+    public:
+        static const size_t npos = static_cast<size_t>(-1);
+
+        // Fails when there is no snapshot, or it is of another version, damaged or older than the status file
+        static expected<snapshot> open(const status_database_files& db);
+
+        snapshot() = default;
+
+        size_t size() const { return m_record_count; }
+
+        std::string displayname(size_t i) const; // name:triplet
+        want_t want(size_t i) const;
+        install_state_t state(size_t i) const;
+
+        // The paragraph of record i as the status file has it
+        Paragraphs::text_range paragraph_text(size_t i) const;
+
+        // The records of the packages record i depends on; dependencies missing from the database have none
+        std::vector<size_t> dependencies(size_t i) const;
+
+        // The record of name:triplet, or npos
+        size_t find(const std::string& displayname) const;
+
+    private:
+        const char* record(size_t i) const;
+
+        Files::mapped_file m_file;
+        size_t m_record_count = 0;
+        size_t m_bucket_count = 0;
+        const char* m_records = nullptr;
+        const char* m_buckets = nullptr;
+        const char* m_dependencies = nullptr;
+        const char* m_strings = nullptr;
+    };
+}}
@@ -27,6 +27,7 @@ namespace vcpkg
     {
         StatusParagraph();
         explicit StatusParagraph(const std::unordered_map<std::string, std::string>& fields);
+        explicit StatusParagraph(const Paragraphs::paragraph_view& fields);
 
         BinaryParagraph package;
         want_t want;
@@ -35,6 +36,9 @@ namespace vcpkg
 
     std::ostream& operator<<(std::ostream& os, const StatusParagraph& pgh);
 
+    // Parses the value of a Status field, e.g. "install ok installed"
+    void parse_status_field(const std::string& status_field, want_t* want, install_state_t* state);
+
     std::string to_string(install_state_t f);
 
     std::string to_string(want_t f);
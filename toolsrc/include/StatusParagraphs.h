@@ -1,6 +1,7 @@
 #pragma once
 #include "StatusParagraph.h"
 #include <memory>
+#include <unordered_map>
 
 namespace vcpkg
 {
@@ -19,6 +20,9 @@ namespace vcpkg
 
         iterator insert(std::unique_ptr<StatusParagraph>);
 
+        // Packages wanted for install on target_triplet whose Depends list names `name`
+        std::vector<const StatusParagraph*> find_dependents(const std::string& name, const triplet& target_triplet) const;
+
         friend std::ostream& operator<<(std::ostream&, const StatusParagraphs&);
 
         auto end()
@@ -42,7 +46,21 @@ namespace vcpkg
         }
 
     private:
+        size_t* find_index(const std::string& name, const triplet& target_triplet);
+        const size_t* find_index(const std::string& name, const triplet& target_triplet) const;
+        iterator to_iterator(size_t index);
+        const_iterator to_iterator(size_t index) const;
+        void add_reverse_dependencies(size_t index);
+        void remove_reverse_dependencies(size_t index);
+
+        // Insertion-ordered store, so that serialization is deterministic
         std::vector<std::unique_ptr<StatusParagraph>> paragraphs;
+
+        // name -> triplet -> position in paragraphs
+        std::unordered_map<std::string, std::unordered_map<triplet, size_t>> index;
+
+        // triplet -> dependency name -> positions in paragraphs of the packages that depend on it
+        std::unordered_map<triplet, std::unordered_map<std::string, std::vector<size_t>>> reverse_dependencies;
     };
 
     std::ostream& operator<<(std::ostream&, const StatusParagraphs&);
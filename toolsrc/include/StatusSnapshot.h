@@ -0,0 +1,52 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "Paragraphs.h"
+#include "StatusParagraph.h"
+#include "StatusBinarySnapshot.h"
+
+namespace vcpkg
+{
+    // Read-only view of the status database for commands that do not modify it. The status file, the legacy update files
+    // and the journal are only split into paragraphs; the StatusParagraph of an entry is built the first time it is needed.
+    class status_snapshot
+    {
+    public:
+        // The fields every reader needs, taken from the raw paragraph without decoding the rest of it
+        struct entry
+        {
+            Paragraphs::paragraph_view fields; // Empty for the records of the binary snapshots
+            std::string displayname; // name:triplet
+            want_t want;
+            install_state_t state;
+        };
+
+        // Later sources, and later paragraphs within a source, replace earlier ones for the same package
+        explicit status_snapshot(std::vector<Paragraphs::parsed_paragraphs> sources);
+
+        // The records of bases come first, in their order, and are only parsed when their paragraph is asked for. The
+        // bases must not hold the same package twice, as the snapshots of different triplets do not.
+        status_snapshot(std::vector<StatusBinarySnapshot::snapshot> bases, std::vector<Paragraphs::parsed_paragraphs> sources);
+
+        status_snapshot(status_snapshot&&) = default;
+        status_snapshot& operator=(status_snapshot&&) = default;
+
+        size_t size() const { return entries.size(); }
+        const entry& operator[](size_t i) const { return entries[i]; }
+
+        const StatusParagraph& paragraph(size_t i) const;
+
+    private:
+        void add_sources();
+
+        // The record of base_of(i) for entry i is at i - base_offsets[base_of(i)]
+        size_t base_of(size_t i) const;
+
+        std::vector<StatusBinarySnapshot::snapshot> bases;
+        std::vector<size_t> base_offsets;
+        std::vector<Paragraphs::parsed_paragraphs> sources;
+        std::vector<entry> entries;
+        mutable std::vector<std::unique_ptr<StatusParagraph>> decoded;
+    };
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "package_spec.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace SymbolStore
+{
+    // With %VCPKG_USE_SYMBOL_STORE% set, the PDBs of the DLLs and executables of a package are not installed next to them.
+    // Each is kept once in installed/vcpkg/symbols, in the layout of a symbol server, <name>.pdb/<GUID><age>/<name>.pdb,
+    // which debuggers search when given srv*<dir>; `vcpkg applocal` deploys the PDB of each DLL it deploys from there.
+    // The PDBs of static libraries, which the linker reads, are installed as before. The PDBs each package uses are
+    // listed in its <package>.symbols file next to its listfile; a PDB goes once no package lists it.
+    bool is_enabled();
+
+    // Stores the PDBs that the images in packages/<spec> refer to, unless the store has them already, lists them in the
+    // package's .symbols file, and returns their paths relative to the package directory for the install to skip
+    std::unordered_set<std::string> store_package_pdbs(const vcpkg_paths& paths, const BinaryParagraph& bpgh);
+
+    // Deletes the .symbols files of the removed packages, and the stored PDBs no other package lists
+    void remove_package_pdbs(const vcpkg_paths& paths, const std::vector<const BinaryParagraph*>& removed);
+
+    struct collection
+    {
+        uintmax_t removed_size = 0;
+        size_t removed_count = 0;
+    };
+
+    // Deletes the stored PDBs that no package lists, such as those stored before packages listed them. With dry_run,
+    // only counts them.
+    collection collect_unlisted_pdbs(const vcpkg_paths& paths, bool dry_run);
+
+    // The store of the vcpkg root that contains dir, e.g. an installed bin directory, or an empty path
+    fs::path find_store_above(const fs::path& dir);
+
+    // The stored PDB that image refers to, or an empty path if the store does not have it
+    fs::path find_pdb(const fs::path& store_dir, const fs::path& image);
+}}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Stopwatch.h"
+
+namespace vcpkg { namespace Timings
+{
+    // Time spent in the hot paths of vcpkg, aggregated by name over the whole run and over all threads. Nothing is
+    // recorded until enable() is called (by --timings), so a timer costs a flag test otherwise.
+    void enable();
+
+    bool is_enabled();
+
+    void record(const char* name, std::chrono::nanoseconds elapsed);
+
+    struct totals
+    {
+        std::string name;
+        size_t count;
+        std::chrono::nanoseconds total;
+        std::chrono::nanoseconds max;
+    };
+
+    // Largest total first
+    std::vector<totals> get_totals();
+
+    void print_summary();
+
+    // Records the time from construction to destruction under name, which must outlive the timer (a string literal)
+    class scoped_timer
+    {
+    public:
+        explicit scoped_timer(const char* name);
+        ~scoped_timer();
+
+        scoped_timer(const scoped_timer&) = delete;
+        scoped_timer& operator=(const scoped_timer&) = delete;
+
+    private:
+        const char* m_name;
+        Stopwatch m_stopwatch;
+    };
+}}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "vcpkg_paths.h"
+
+namespace vcpkg { namespace Trash
+{
+    // Directories that are no longer needed, such as the packages/ directory of a port about to be rebuilt, are renamed
+    // into trash/ rather than deleted: a rename takes no time however large the directory is, and the deletion happens
+    // later, off the path of the build. ports.cmake moves the packages/ directory it starts from there as well.
+
+    // Moves directory into the trash. Returns false when it could not be moved, for instance because one of its files is
+    // in use; it is then left where it is. Returns true when there is no such directory.
+    bool move_to_trash(const vcpkg_paths& paths, const fs::path& directory);
+
+    // Deletes what is in the trash before returning
+    void empty(const vcpkg_paths& paths);
+
+    // Starts deleting what is in the trash on a background thread with low CPU and I/O priority; does nothing when it was
+    // started before. What is still there when vcpkg exits is deleted by the next command that starts it.
+    void empty_in_background(const vcpkg_paths& paths);
+}}
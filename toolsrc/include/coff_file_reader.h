@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <string>
 #include <vector>
 #include "MachineType.h"
 #include <filesystem>
@@ -10,14 +12,41 @@ namespace vcpkg {namespace COFFFileReader
     struct dll_info
     {
         MachineType machine_type;
+        bool has_exports;
+        bool is_app_container;
     };
 
     struct lib_info
     {
         std::vector<MachineType> machine_types;
+
+        // /DEFAULTLIB directives of the .drectve sections of all members, without quotes or .lib extension
+        std::vector<std::string> default_libs;
+
+        // Whether some members are anonymous objects other than /bigobj ones, such as those of /GL compiles, which hold
+        // intermediate code and directives that cannot be read
+        bool has_ltcg_objects;
+    };
+
+    // Where the linker wrote the debug information of an executable or DLL, from its CodeView debug record
+    struct pdb_reference
+    {
+        std::string path; // As given to the linker, usually absolute
+        std::string guid; // 16 bytes; the PDB that was written with the image records the same
+        uint32_t age;
     };
 
     dll_info read_dll(const fs::path path);
 
+    // Returns false if the image has no CodeView debug record, e.g. when it was linked without /DEBUG, or if path is not
+    // an image at all
+    bool read_pdb_reference(const fs::path path, pdb_reference& reference);
+
+    // Reads the GUID out of the information stream of a PDB. Returns false if path is not a PDB in the MSF 7.00 format.
+    bool read_pdb_guid(const fs::path path, std::string& guid);
+
+    // Names of the DLLs that an executable or DLL imports, directly or through delay loading, as written in the image
+    std::vector<std::string> read_dll_imports(const fs::path path);
+
     lib_info read_lib(const fs::path path);
 }}
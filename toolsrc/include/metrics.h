@@ -1,11 +1,14 @@
 #pragma once
 
 #include <string>
+#include <filesystem>
 
 namespace vcpkg
 {
     void SetSendMetrics(bool should_send_metrics);
     void SetPrintMetrics(bool should_print_metrics);
+    // Whether Flush will print or send anything; the user information is only needed then
+    bool ShouldReportMetrics();
     void SetUserInformation(const std::string& user_id, const std::string& first_use_time);
     void InitUserInformation(std::string& user_id, std::string& first_use_time);
 
@@ -15,5 +18,12 @@ namespace vcpkg
     bool GetCompiledMetricsEnabled();
 
     void Upload(const std::string& payload);
+
+    // Sends the events Flush spooled into spool_dir, oldest first, in gzip-compressed batches of up to 500 per request.
+    // Sent events are removed; the others stay for the next upload.
+    void UploadSpool(const std::tr2::sys::path& spool_dir);
+
+    // Adds the event of this invocation to the spool in %TEMP%\vcpkg-metrics. Starts the uploader on it at most once
+    // every ten minutes across all vcpkg processes.
     void Flush();
 }
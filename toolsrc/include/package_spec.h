@@ -6,8 +6,12 @@
 
 namespace vcpkg
 {
+    // Interned like triplet: a package_spec is a pointer to its name, triplet and precomputed hash, shared by every copy
     struct package_spec
     {
+        // The empty spec
+        package_spec();
+
         static expected<package_spec> from_string(const std::string& spec_as_string, const triplet& default_target_triplet);
 
         static expected<package_spec> from_name_and_triplet(const std::string& name, const triplet& target_triplet);
@@ -18,9 +22,18 @@ namespace vcpkg
 
         std::string dir() const;
 
+        size_t hash_code() const;
+
     private:
-        std::string m_name;
-        triplet m_target_triplet;
+        struct interned;
+
+        explicit package_spec(const interned* data);
+
+        static const interned* intern(const std::string& name, const triplet& target_triplet);
+
+        friend std::string to_string(const package_spec& spec);
+
+        const interned* m_data;
     };
 
     std::string to_string(const package_spec& spec);
@@ -39,10 +52,7 @@ namespace std
     {
         size_t operator()(const vcpkg::package_spec& value) const
         {
-            size_t hash = 17;
-            hash = hash * 31 + std::hash<std::string>()(value.name());
-            hash = hash * 31 + std::hash<vcpkg::triplet>()(value.target_triplet());
-            return hash;
+            return value.hash_code();
         }
     };
 
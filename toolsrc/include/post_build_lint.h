@@ -4,5 +4,7 @@
 
 namespace vcpkg
 {
-    void perform_all_checks(const package_spec& spec, const vcpkg_paths& paths);
+    // Returns the number of errors found; the caller decides whether to abort. The package of a header-only port is only
+    // checked for its layout and for holding no binaries at all.
+    size_t perform_all_checks(const package_spec& spec, const vcpkg_paths& paths, bool header_only = false);
 }
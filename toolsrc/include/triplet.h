@@ -4,8 +4,13 @@
 
 namespace vcpkg
 {
+    // Triplets are interned: each distinct name is parsed once, and a triplet is a pointer to the shared parts, so copying,
+    // comparing and hashing one never touches a string
     struct triplet
     {
+        // The empty triplet
+        triplet();
+
         static triplet from_canonical_name(const std::string& triplet_as_string);
 
         static const triplet X86_WINDOWS;
@@ -16,12 +21,20 @@ namespace vcpkg
 
         const std::string& canonical_name() const;
 
-        std::string architecture() const;
+        const std::string& architecture() const;
+
+        const std::string& system() const;
 
-        std::string system() const;
+        size_t hash_code() const;
 
     private:
-        std::string m_canonical_name;
+        struct interned;
+
+        explicit triplet(const interned* data);
+
+        static const interned* intern(const std::string& canonical_name);
+
+        const interned* m_data;
     };
 
     bool operator==(const triplet& left, const triplet& right);
@@ -42,10 +55,7 @@ namespace std
     {
         size_t operator()(const vcpkg::triplet& t) const
         {
-            std::hash<std::string> hasher;
-            size_t hash = 17;
-            hash = hash * 31 + hasher(t.canonical_name());
-            return hash;
+            return t.hash_code();
         }
     };
 
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <filesystem>
+#include <unordered_set>
 #include "package_spec.h"
 #include "BinaryParagraph.h"
 #include "StatusParagraphs.h"
+#include "StatusSnapshot.h"
+#include "vcpkg_Files.h"
 #include "vcpkg_paths.h"
 
 namespace vcpkg
@@ -12,8 +15,51 @@ namespace vcpkg
 
     extern bool g_do_dry_run;
 
+    // Guards what installed/vcpkg holds for every triplet: the files index, and the single status database of older
+    // versions while it is split. Readers hold it shared and writers exclusively, each for a single read or update.
+    // It is never held while waiting for another lock. The database of each triplet has a lock of its own.
+    Files::file_lock lock_status_database(const vcpkg_paths& paths, Files::file_lock::mode m);
+
+    // Held by commands that change installed/<triplet> for as long as they run, so that concurrent installs into
+    // the same triplet take turns while installs into different triplets proceed in parallel. Acquired in
+    // triplet name order; the status database must be loaded after they are held, since another process may
+    // have changed it while this one waited.
+    std::vector<Files::file_lock> lock_triplets(const vcpkg_paths& paths, const std::vector<package_spec>& specs);
+
+    // Loads the databases of every triplet
     StatusParagraphs database_load_check(const vcpkg_paths& paths);
 
-    void install_package(const vcpkg_paths& paths, const BinaryParagraph& binary_paragraph, StatusParagraphs& status_db);
+    // Loads the databases of triplets alone: packages of other triplets are missing from what it returns, and their
+    // databases are neither read nor locked
+    StatusParagraphs database_load_check(const vcpkg_paths& paths, const std::vector<triplet>& triplets);
+
+    // For commands that only read the database: unlike database_load_check, nothing is decoded up front and nothing is
+    // ever compacted or rewritten (but for the one-time split of the database of an older version), so concurrent
+    // readers do not contend on the status files
+    status_snapshot load_status_snapshot(const vcpkg_paths& paths);
+
+    // Journal records are "R <payload size> <crc32 of payload>\n<payload>", where the payload is a serialized
+    // StatusParagraph
+    std::string make_status_journal_record(const StatusParagraph& p);
+
+    // Appends the payloads of the records in journal to paragraphs, one paragraph each. Returns false if the journal
+    // ends in a torn or corrupted record; everything before it is still read.
+    bool parse_status_journal(const std::string& journal, std::string& paragraphs);
+
+    enum class install_file_mode
+    {
+        copy,
+        // Hard link files from packages/ into installed/, copying when that is not possible (e.g. across volumes)
+        hard_link
+    };
+
+    // skipped_files are paths relative to the package directory, such as PDBs kept elsewhere, that are not installed.
+    // A package kept compressed is installed whole.
+    void install_package(const vcpkg_paths& paths, const BinaryParagraph& binary_paragraph, StatusParagraphs& status_db, install_file_mode mode = install_file_mode::copy,
+                         const std::unordered_set<std::string>& skipped_files = std::unordered_set<std::string>());
     void deinstall_package(const vcpkg_paths& paths, const package_spec& spec, StatusParagraphs& status_db);
+
+    // Removes all of specs, dependents before their dependencies. Fails without removing anything
+    // if a package outside of specs still depends on one of them.
+    void deinstall_packages(const vcpkg_paths& paths, const std::vector<package_spec>& specs, StatusParagraphs& status_db);
 } // namespace vcpkg
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "package_spec.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg {namespace BinaryCache
+{
+    // Directory holding one archive per ABI hash, taken from %VCPKG_BINARY_CACHE%. When only a remote cache is configured
+    // (%VCPKG_BINARY_CACHE_URL% or %VCPKG_BINARY_CACHE_NUGET%), downloads/binarycache holds the local copies. Empty when caching is disabled.
+    fs::path get_cache_dir(const vcpkg_paths& paths);
+
+    // Hashes everything that determines the contents of packages/<spec>: the port directory, the triplet file,
+    // the build scripts and (recursively) the ABI hashes of the port's dependencies. Results are memoized in abi_cache.
+    const std::string& compute_abi_hash(const vcpkg_paths& paths, const package_spec& spec, std::unordered_map<package_spec, std::string>& abi_cache);
+
+    // Starts fetching the archives for abis from the remote cache in the background, so that restores overlap with
+    // the builds that are still needed. try_restore() waits for a fetch that is already in flight.
+    void prefetch(const vcpkg_paths& paths, const fs::path& cache_dir, const std::vector<std::string>& abis);
+
+    // Replaces packages/<spec> with the cached archive for abi, fetching it from the remote cache on a local miss.
+    // Returns false on a cache miss.
+    bool try_restore(const vcpkg_paths& paths, const fs::path& cache_dir, const package_spec& spec, const std::string& abi);
+
+    // Archives packages/<spec> into cache_dir; the upload to the remote cache continues in the background.
+    void store(const vcpkg_paths& paths, const fs::path& cache_dir, const package_spec& spec, const std::string& abi);
+
+    // Blocks until every prefetch and upload started by this process has finished
+    void wait_for_background_transfers();
+}}
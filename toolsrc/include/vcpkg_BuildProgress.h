@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "package_spec.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg {namespace BuildProgress
+{
+    // Where the messages of the build script of one package go. They are printed as they come, after prefix, when the
+    // build is the only one running or logs are tailed; otherwise they are held and only printed if the build fails.
+    class build_output
+    {
+    public:
+        build_output(std::string prefix, bool live);
+
+        void line(const std::string& text);
+        void print_held();
+
+    private:
+        std::string prefix;
+        bool live;
+        std::vector<std::string> held;
+    };
+
+    // The packages an install is building, shown on the status line of the console: "[done/total] <spec> <phase> <elapsed>"
+    // for each one. The phase is the build step whose process file is in buildtrees/<port>, or the one set by the worker.
+    // With tail_logs, refresh() also prints the lines appended to the step logs of each build since the last call.
+    // Only set_phase may be called from the workers.
+    class tracker
+    {
+    public:
+        tracker(const vcpkg_paths& paths, size_t total, bool tail_logs);
+
+        void started(const package_spec& spec);
+        void set_phase(const package_spec& spec, const std::string& phase);
+        void finished(const package_spec& spec);
+        void refresh();
+
+    private:
+        struct running_build
+        {
+            package_spec spec;
+            std::chrono::steady_clock::time_point start;
+            std::map<std::string, uintmax_t> log_offsets; // By file name, up to the end of the last whole line printed
+        };
+
+        std::vector<std::string> current_steps(const running_build& build) const;
+        void tail_logs_of(running_build& build, bool last_time);
+
+        const vcpkg_paths& paths;
+        const size_t total;
+        const bool tail_logs;
+        size_t finished_count;
+        std::map<std::string, running_build> running; // By spec, which orders the status line
+
+        std::mutex phases_mutex;
+        std::map<std::string, std::string> phases; // Guarded by phases_mutex
+    };
+}}
@@ -15,6 +15,22 @@ namespace vcpkg {namespace Checks
         exit_with_message(Strings::format(errorMessageTemplate, errorMessageArgs...).c_str());
     }
 
+    // While one lives on a thread, exit_with_message there throws Parallel::task_failed once the message is printed, as
+    // it does on the threads of the pool, instead of ending the process. For the callers that report a failure and go on.
+    class failures_throw
+    {
+    public:
+        failures_throw();
+        ~failures_throw();
+        failures_throw(const failures_throw&) = delete;
+        failures_throw& operator=(const failures_throw&) = delete;
+
+    private:
+        bool m_previous;
+    };
+
+    bool failures_throw_on_this_thread();
+
     _declspec(noreturn) void throw_with_message(const char* errorMessage);
 
     template <class...Args>
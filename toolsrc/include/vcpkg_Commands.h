@@ -2,6 +2,9 @@
 
 #include "vcpkg_cmd_arguments.h"
 #include "vcpkg_paths.h"
+#include "vcpkg.h"
+#include "FilesIndex.h"
+#include "PortsIndex.h"
 
 namespace vcpkg
 {
@@ -11,11 +14,17 @@ namespace vcpkg
     void print_example(const char* command_and_arguments);
     std::string create_example_string(const char* command_and_arguments);
     void update_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+    void upgrade_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
 
     void build_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet);
     void build_external_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet);
     void install_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet);
     void remove_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet);
+    void export_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet);
+    void verify_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet);
+
+    // Builds (up to --jobs at a time) and installs specs together with any of their dependencies that are not installed yet
+    void install_specs(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const std::vector<package_spec>& specs, StatusParagraphs& status_db, install_file_mode mode, bool dry_run, bool tail_logs);
 
     void edit_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
     void create_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
@@ -24,9 +33,24 @@ namespace vcpkg
     void list_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
     void import_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
     void owns_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+    void server_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+    void batch_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+
+    // The output of search, list, owns and cache for already loaded data, shared with "vcpkg server" and "vcpkg batch"
+    void print_available_packages(const PortsIndex::search_index& ports, const std::vector<std::string>& command_arguments);
+    void print_installed_packages(const status_snapshot& status_db, const std::vector<std::string>& command_arguments);
+    void print_owned_files(const FilesIndex::files_index& index, const std::string& pattern, const std::unordered_set<std::string>& options);
+    void print_cached_packages(const std::vector<BinaryParagraph>& binary_paragraphs, const std::vector<std::string>& command_arguments);
     void internal_test_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+    void internal_extract_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+    void internal_patch_cache_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+    void internal_copy_pdbs_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
 
     void cache_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+    void stats_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+    void gc_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+    void farm_worker_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
+    void internal_farm_build_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
 
     void integrate_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
 
@@ -38,6 +62,8 @@ namespace vcpkg
     void version_command(const vcpkg_cmd_arguments& args);
     void contact_command(const vcpkg_cmd_arguments& args);
     void hash_command(const vcpkg_cmd_arguments& args);
+    void applocal_command(const vcpkg_cmd_arguments& args);
+    void internal_run_parallel_command(const vcpkg_cmd_arguments& args);
 
     using command_type_a = void(*)(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet);
     using command_type_b = void(*)(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths);
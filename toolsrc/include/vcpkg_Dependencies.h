@@ -4,12 +4,24 @@
 #include "StatusParagraphs.h"
 #include <unordered_set>
 #include "vcpkg_paths.h"
+#include "vcpkg_Graphs.h"
 
 namespace vcpkg {namespace Dependencies
 {
+    // Edges point from a package to each of its not-yet-installed dependencies
+    Graphs::Graph<package_spec> create_dependency_graph(const vcpkg_paths& paths, const std::vector<package_spec>& specs, const StatusParagraphs& status_db);
+
     std::vector<package_spec> create_dependency_ordered_install_plan(const vcpkg_paths& paths, const std::vector<package_spec>& specs, const StatusParagraphs& status_db);
 
     std::unordered_set<package_spec> get_unmet_dependencies(const vcpkg_paths& paths, const std::vector<package_spec>& specs, const StatusParagraphs& status_db);
 
-    std::vector<std::string> get_unmet_package_build_dependencies(const vcpkg_paths& paths, const package_spec& spec);
+    struct port_dependencies
+    {
+        std::vector<std::string> build; // Of the triplet of the port
+        // The packages of the host triplet whose tools the port runs while it builds (Host-Depends in its CONTROL file)
+        std::vector<package_spec> host;
+    };
+
+    // Both lists come from a single read of the CONTROL file of the port of spec
+    port_dependencies get_port_dependencies(const vcpkg_paths& paths, const package_spec& spec);
 }}
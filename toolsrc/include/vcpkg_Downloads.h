@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "package_spec.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg {namespace Downloads
+{
+    struct distfile
+    {
+        std::vector<std::string> urls;
+        std::string filename;
+        std::string sha512;
+    };
+
+    struct cmake_command
+    {
+        std::string name; // Lowercase, as CMake commands are case-insensitive
+        std::vector<std::string> arguments;
+    };
+
+    // Enough of the CMake language to read the arguments of top level commands: comments, quoted, unquoted and bracket
+    // arguments. Variables are not expanded.
+    std::vector<cmake_command> parse_cmake_commands(const std::string& contents);
+
+    // Extracts the vcpkg_download_distfile() calls of a portfile. Variables are expanded from plain set() calls in the
+    // same file; calls that still depend on other variables are skipped and left to the portfile itself.
+    std::vector<distfile> parse_distfiles(const std::string& portfile_contents);
+
+    // True if downloads/<filename> was already checked against sha512 and has not been modified since, going by its last
+    // write time and size: the file is not read. The stamp is shared with vcpkg_download_distfile.cmake, which skips its
+    // own rehash in that case.
+    bool is_verified(const vcpkg_paths& paths, const distfile& file);
+
+    // Downloads to downloads/<filename>, resuming an earlier partial download and racing all mirrors for the
+    // first response. The file is hashed as it is written and only moved into place once its hash matches.
+    bool download(const vcpkg_paths& paths, const distfile& file);
+
+    // Plain single-source transfers, used for the remote binary cache. Both return false on any failure, including
+    // HTTP error statuses; download_file only replaces destination once the whole body has been received.
+    bool download_file(const std::string& url, const fs::path& destination);
+    bool upload_file(const std::string& url, const fs::path& file);
+
+    // Fetches the distfiles of every port in specs in parallel. Failures are reported but not fatal:
+    // the port script retries the download itself.
+    void prefetch(const vcpkg_paths& paths, const std::vector<package_spec>& specs);
+}}
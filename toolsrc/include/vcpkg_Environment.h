@@ -14,4 +14,9 @@ namespace vcpkg {namespace Environment
         ensure_cmake_on_path(paths);
         ensure_git_on_path(paths);
     }
+
+    // The environment block of this process as "vcvarsall.bat <architecture>" would leave it, for System::process_execute,
+    // or an empty string if vcvarsall cannot be run. What vcvarsall changes is captured once per architecture and kept in
+    // installed/vcpkg/vcvars/ until vcvarsall.bat changes; it is applied to the current environment on every call.
+    std::wstring get_vcvars_environment(const vcpkg_paths& paths, const std::string& architecture);
 }}
@@ -2,6 +2,9 @@
 
 #include "expected.h"
 #include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
 
 namespace vcpkg {namespace Files
 {
@@ -13,5 +16,68 @@ namespace vcpkg {namespace Files
 
     expected<std::string> get_contents(const std::tr2::sys::path& file_path) noexcept;
 
+    // Reads the files at once on the I/O threads of the pool; element i holds the contents of file_paths[i]
+    std::vector<expected<std::string>> get_contents_of_all(const std::vector<std::tr2::sys::path>& file_paths);
+
+    enum class durability
+    {
+        replace_only, // Readers see the old contents or the new ones; a crash of the machine may leave either, or an empty file
+        flushed       // The new contents are on disk before they replace the old ones
+    };
+
+    // Writes contents beside file_path, under a name of this process, and renames the file over file_path. Creates the
+    // parent directory if needed. On failure file_path is left as it was.
+    std::error_code write_contents_atomically(const std::tr2::sys::path& file_path, const std::string& contents, durability d = durability::replace_only) noexcept;
+
     std::tr2::sys::path find_file_recursively_up(const std::tr2::sys::path& starting_dir, const std::string& filename);
+
+    // Read-only view of the whole contents of a file, mapped into memory for as long as the object lives
+    class mapped_file
+    {
+    public:
+        static expected<mapped_file> open(const std::tr2::sys::path& file_path) noexcept;
+
+        mapped_file() = default;
+        mapped_file(mapped_file&& other) noexcept;
+        mapped_file& operator=(mapped_file&& other) noexcept;
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        ~mapped_file();
+
+        const char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+    private:
+        void close() noexcept;
+
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+        const char* m_data = nullptr;
+        size_t m_size = 0;
+    };
+
+    // Advisory lock on lock_file, which is created if needed, shared between processes. The constructor blocks until
+    // the lock is granted. The lock is released on destruction, or by the system if the process dies while holding it.
+    // Locks are held per object: a process must not take a second lock on a file it already holds exclusively.
+    class file_lock
+    {
+    public:
+        enum class mode
+        {
+            shared,
+            exclusive
+        };
+
+        file_lock(const std::tr2::sys::path& lock_file, mode m);
+        file_lock(file_lock&& other) noexcept;
+        file_lock& operator=(file_lock&& other) noexcept;
+        file_lock(const file_lock&) = delete;
+        file_lock& operator=(const file_lock&) = delete;
+        ~file_lock();
+
+    private:
+        void release() noexcept;
+
+        void* m_file = nullptr;
+    };
 }}
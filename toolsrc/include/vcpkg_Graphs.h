@@ -1,6 +1,9 @@
 #pragma once
 
+#include <sstream>
+#include <stdexcept>
 #include <unordered_map>
+#include <vector>
 
 namespace vcpkg { namespace Graphs
 {
@@ -16,39 +19,70 @@ namespace vcpkg { namespace Graphs
         FULLY_EXPLORED
     };
 
+    // Vertices are interned to dense ids in the order they are first added, and edges are kept per id, so that sorting
+    // never hashes a V. Everything else is derived from the ids, which makes every result independent of hashing order.
     template <class V>
     class Graph
     {
-        static void find_topological_sort_internal(V vertex,
-                                                   ExplorationStatus& status,
-                                                   const std::unordered_map<V, std::vector<V>>& adjacency_list,
-                                                   std::unordered_map<V, ExplorationStatus>& exploration_status,
-                                                   std::vector<V>& sorted)
+        // Compressed sparse rows: the neighbours of vertex i are targets[offsets[i]] up to targets[offsets[i + 1]]
+        struct csr
         {
-            status = ExplorationStatus::PARTIALLY_EXPLORED;
+            std::vector<size_t> offsets;
+            std::vector<size_t> targets;
+        };
 
-            for (V neighbour : adjacency_list.at(vertex))
+        csr to_csr() const
+        {
+            csr rows;
+            rows.offsets.reserve(this->edges.size() + 1);
+            rows.offsets.push_back(0);
+            for (const std::vector<size_t>& neighbours : this->edges)
             {
-                ExplorationStatus& neighbour_status = exploration_status[neighbour];
-                if (neighbour_status == ExplorationStatus::NOT_EXPLORED)
-                {
-                    find_topological_sort_internal(neighbour, neighbour_status, adjacency_list, exploration_status, sorted);
-                }
-                else if (neighbour_status == ExplorationStatus::PARTIALLY_EXPLORED)
-                {
-                    throw std::runtime_error("cycle in graph");
-                }
+                rows.targets.insert(rows.targets.end(), neighbours.begin(), neighbours.end());
+                rows.offsets.push_back(rows.targets.size());
+            }
+            return rows;
+        }
+
+        size_t intern(const V& v)
+        {
+            const auto it = this->ids.find(v);
+            if (it != this->ids.end())
+            {
+                return it->second;
             }
 
-            status = ExplorationStatus::FULLY_EXPLORED;
-            sorted.push_back(vertex);
+            const size_t id = this->by_id.size();
+            this->ids.emplace(v, id);
+            this->by_id.push_back(v);
+            this->edges.emplace_back();
+            this->adjacency_cache.clear();
+            return id;
+        }
+
+        // stack holds the path being explored, from a root down to `from`, which has an edge to `to`
+        [[noreturn]] void throw_cycle(const std::vector<std::pair<size_t, size_t>>& stack, const size_t to) const
+        {
+            std::ostringstream message;
+            message << "cycle in graph: ";
+            size_t first = 0;
+            while (stack[first].first != to)
+            {
+                ++first;
+            }
+            for (size_t i = first; i < stack.size(); ++i)
+            {
+                message << this->by_id[stack[i].first] << " -> ";
+            }
+            message << this->by_id[to];
+            throw std::runtime_error(message.str());
         }
 
     public:
 
         void add_vertex(V v)
         {
-            this->vertices[v];
+            intern(v);
         }
 
         // TODO: Change with iterators
@@ -56,36 +90,83 @@ namespace vcpkg { namespace Graphs
         {
             for (const V& v : vs)
             {
-                this->vertices[v];
+                intern(v);
             }
         }
 
         void add_edge(V u, V v)
         {
-            this->vertices[v];
-            this->vertices[u].push_back(v);
+            const size_t from = intern(u);
+            const size_t to = intern(v);
+            this->edges[from].push_back(to);
+            this->adjacency_cache.clear();
         }
 
+        // Every vertex comes after all the vertices it has edges to. The vertices without incoming edges are visited in
+        // the order they were added, and so are the edges of each vertex, so the same graph always gives the same order.
+        // Throws std::runtime_error naming the vertices of the cycle if there is one.
         std::vector<V> find_topological_sort() const
         {
-            std::unordered_map<V, int> indegrees = count_indegrees();
+            const csr rows = to_csr();
+            const size_t vertex_count = this->by_id.size();
+
+            std::vector<int> indegrees(vertex_count);
+            for (const size_t target : rows.targets)
+            {
+                ++indegrees[target];
+            }
 
             std::vector<V> sorted;
-            sorted.reserve(indegrees.size());
+            sorted.reserve(vertex_count);
+            std::vector<ExplorationStatus> exploration_status(vertex_count, ExplorationStatus::NOT_EXPLORED);
 
-            std::unordered_map<V, ExplorationStatus> exploration_status;
-            exploration_status.reserve(indegrees.size());
+            // Explicit depth-first stack of (vertex, position of the next edge to follow), so that long chains of
+            // dependencies cannot exhaust the call stack
+            std::vector<std::pair<size_t, size_t>> stack;
 
-            for (auto& pair : indegrees)
-            {
-                if (pair.second == 0) // Starting from vertices with indegree == 0. Not required.
+            auto explore_from = [&](const size_t root)
                 {
-                    V vertex = pair.first;
-                    ExplorationStatus& status = exploration_status[vertex];
-                    if (status == ExplorationStatus::NOT_EXPLORED)
+                    exploration_status[root] = ExplorationStatus::PARTIALLY_EXPLORED;
+                    stack.emplace_back(root, rows.offsets[root]);
+                    while (!stack.empty())
                     {
-                        find_topological_sort_internal(vertex, status, this->vertices, exploration_status, sorted);
+                        const size_t vertex = stack.back().first;
+                        size_t& next_edge = stack.back().second;
+                        if (next_edge == rows.offsets[vertex + 1])
+                        {
+                            exploration_status[vertex] = ExplorationStatus::FULLY_EXPLORED;
+                            sorted.push_back(this->by_id[vertex]);
+                            stack.pop_back();
+                            continue;
+                        }
+
+                        const size_t neighbour = rows.targets[next_edge++];
+                        if (exploration_status[neighbour] == ExplorationStatus::NOT_EXPLORED)
+                        {
+                            exploration_status[neighbour] = ExplorationStatus::PARTIALLY_EXPLORED;
+                            stack.emplace_back(neighbour, rows.offsets[neighbour]);
+                        }
+                        else if (exploration_status[neighbour] == ExplorationStatus::PARTIALLY_EXPLORED)
+                        {
+                            throw_cycle(stack, neighbour);
+                        }
                     }
+                };
+
+            for (size_t id = 0; id < vertex_count; ++id)
+            {
+                if (indegrees[id] == 0) // Starting from vertices with indegree == 0. Not required.
+                {
+                    explore_from(id);
+                }
+            }
+
+            // Whatever is left is only reachable through a cycle
+            for (size_t id = 0; id < vertex_count; ++id)
+            {
+                if (exploration_status[id] == ExplorationStatus::NOT_EXPLORED)
+                {
+                    explore_from(id);
                 }
             }
 
@@ -95,25 +176,47 @@ namespace vcpkg { namespace Graphs
         std::unordered_map<V, int> count_indegrees() const
         {
             std::unordered_map<V, int> indegrees;
+            indegrees.reserve(this->by_id.size());
 
-            for (auto& pair : this->vertices)
+            for (const V& v : this->by_id)
+            {
+                indegrees[v];
+            }
+            for (const std::vector<size_t>& neighbours : this->edges)
             {
-                indegrees[pair.first];
-                for (V neighbour : pair.second)
+                for (const size_t neighbour : neighbours)
                 {
-                    ++indegrees[neighbour];
+                    ++indegrees[this->by_id[neighbour]];
                 }
             }
 
             return indegrees;
         }
 
+        // Built on first use after a change to the graph
         const std::unordered_map<V, std::vector<V>>& adjacency_list() const
         {
-            return this->vertices;
+            if (this->adjacency_cache.size() != this->by_id.size())
+            {
+                this->adjacency_cache.clear();
+                this->adjacency_cache.reserve(this->by_id.size());
+                for (size_t id = 0; id < this->by_id.size(); ++id)
+                {
+                    std::vector<V>& neighbours = this->adjacency_cache[this->by_id[id]];
+                    neighbours.reserve(this->edges[id].size());
+                    for (const size_t neighbour : this->edges[id])
+                    {
+                        neighbours.push_back(this->by_id[neighbour]);
+                    }
+                }
+            }
+            return this->adjacency_cache;
         }
 
     private:
-        std::unordered_map<V, std::vector<V>> vertices;
+        std::unordered_map<V, size_t> ids;
+        std::vector<V> by_id;
+        std::vector<std::vector<size_t>> edges; // By id, in the order they were added
+        mutable std::unordered_map<V, std::vector<V>> adjacency_cache;
     };
 }}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace vcpkg {namespace Gzip
+{
+    // A gzip stream (RFC 1952) holding data, compressed with LZ77 and the fixed Huffman codes of deflate.
+    // Meant for the repetitive text vcpkg sends over the network, where it already does most of what the
+    // dynamic codes would; anything that reads gzip can read it.
+    std::string compress(const std::string& data);
+
+    // The raw deflate stream (RFC 1951) that compress() wraps
+    std::string deflate(const std::string& data);
+
+    // Replaces out with the data of a raw deflate stream, which may use any of the block types. Returns false if the
+    // stream is corrupt or truncated.
+    bool inflate(const char* data, size_t size, std::string& out);
+
+    uint32_t crc32(const std::string& data);
+}}
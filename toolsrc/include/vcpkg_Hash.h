@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include "expected.h"
+
+namespace vcpkg {namespace Hash
+{
+    // Algorithm names are CNG identifiers, e.g. L"SHA256" or L"SHA512". Results are lowercase hex strings.
+    std::string get_string_hash(const std::string& s, const std::wstring& hash_type);
+
+    expected<std::string> get_file_hash(const std::tr2::sys::path& path, const std::wstring& hash_type) noexcept;
+
+    // Hashes data that arrives in pieces, such as a download, without reading it back from disk
+    class streaming_hash
+    {
+    public:
+        explicit streaming_hash(const std::wstring& hash_type);
+        ~streaming_hash();
+
+        streaming_hash(const streaming_hash&) = delete;
+        streaming_hash& operator=(const streaming_hash&) = delete;
+
+        void add_bytes(const void* data, size_t size);
+
+        // Ends the hash; add_bytes must not be called afterwards
+        std::string get_hash();
+
+    private:
+        struct impl;
+        std::unique_ptr<impl> m_impl;
+    };
+
+    // Hashes the files in parallel; results are in the order of paths
+    std::vector<expected<std::string>> get_file_hashes(const std::vector<std::tr2::sys::path>& paths, const std::wstring& hash_type);
+
+    // XXH64 with seed 0, as 16 lowercase hex digits. Not cryptographic: it only detects accidental changes, at memory speed.
+    std::string get_string_xxh64(const std::string& s);
+
+    struct file_digest
+    {
+        uint64_t size;
+        std::string xxh64;
+    };
+
+    expected<file_digest> get_file_xxh64(const std::tr2::sys::path& path) noexcept;
+}}
@@ -0,0 +1,38 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include "BinaryParagraph.h"
+#include "StatusParagraphs.h"
+#include "vcpkg_paths.h"
+
+namespace vcpkg {namespace ImportGraph
+{
+    struct dll_node
+    {
+        fs::path path;
+        std::string size;
+        std::string mtime;
+        std::vector<std::string> imports;
+        bool has_imports = false;
+    };
+
+    // The DLLs of one bin directory, keyed by lowercase file name since the loader matches DLL names case-insensitively
+    using graph = std::map<std::string, dll_node>;
+
+    // Lists the DLLs in bin_dir and fills in the imports recorded in its graph file for the ones that have not changed
+    // since. Returns false if bin_dir has no graph file usable by this version.
+    bool load(const fs::path& bin_dir, graph& dlls);
+
+    // Records the imports of every DLL of dlls that has them in the graph file of bin_dir
+    void store(const fs::path& bin_dir, const graph& dlls);
+
+    // DLLs of dlls that roots need, directly or through other DLLs of dlls, in the order they are reached.
+    // Imports are read from the files for the DLLs that lack them, setting changed.
+    std::vector<const dll_node*> closure(graph& dlls, const std::vector<std::string>& roots, bool& changed);
+
+    // Writes the imports of the DLLs that pgh installed, resolved against the bin directories of its triplet,
+    // next to its listfile. Then merges the records of every installed package of the triplet into the graph files
+    // of installed/<triplet>/bin and installed/<triplet>/debug/bin, which "vcpkg applocal" reads.
+    void add_package(const vcpkg_paths& paths, const BinaryParagraph& pgh, const StatusParagraphs& status_db);
+}}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+namespace vcpkg {namespace JobTokens
+{
+    // Tokens of the job pool shared by every vcpkg process of the session: one token per hardware thread.
+    // Each process started for a build holds at least one token while it runs, and build tools are told to use
+    // as many jobs as their process holds tokens, so the whole machine runs about one job per hardware thread.
+    class token_set
+    {
+    public:
+        // Blocks until one token is free, then takes up to wanted tokens in total without waiting for more.
+        // Taking the rest only when free means two processes can never wait on each other for tokens.
+        static token_set acquire(size_t wanted);
+
+        token_set(token_set&& other) noexcept;
+        token_set& operator=(token_set&& other) noexcept;
+        token_set(const token_set&) = delete;
+        token_set& operator=(const token_set&) = delete;
+        ~token_set();
+
+        size_t count() const { return m_count; }
+
+    private:
+        token_set(void* semaphore, size_t count) : m_semaphore(semaphore), m_count(count) {}
+        void release() noexcept;
+
+        void* m_semaphore = nullptr;
+        size_t m_count = 0;
+    };
+}}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace vcpkg { namespace Parallel
+{
+    // All the parallel work of the process runs on one pool, started on first use: a thread per core but one for
+    // computation, each taking from its own queue first and from the others' when it runs dry, and a separate lane of
+    // threads for work that mostly blocks on the file system or the network, so that it never holds up a core.
+    // A thread waiting for a task_group runs queued computation tasks itself instead of blocking, so groups may be
+    // waited for from inside tasks.
+    // Console output goes through System::print and System::println, which any thread may call.
+
+    enum class lane
+    {
+        cpu,
+        io
+    };
+
+    // The number of threads that run tasks of l, not counting threads helping while they wait
+    size_t concurrency(lane l);
+
+    // True on the threads of the pool
+    bool on_pool_thread();
+
+    // Thrown by Checks::exit_with_message on a thread of the pool, once the message is printed: the task's group is
+    // cancelled and the thread waiting for it outside the pool exits the process with EXIT_FAILURE, unless a
+    // Checks::failures_throw lives on that thread, in which case wait() rethrows it.
+    struct task_failed
+    {
+    };
+
+    namespace details
+    {
+        struct task_node;
+        struct group_state;
+    }
+
+    class task
+    {
+    public:
+        task() = default;
+
+    private:
+        friend class task_group;
+        std::shared_ptr<details::task_node> m_node;
+    };
+
+    // Tasks run by a group, in any order on any thread of their lane, except that a task only starts once the tasks it
+    // runs after have completed. The first exception a task throws cancels the group: the tasks that have not started
+    // by then are skipped, and wait() rethrows it.
+    class task_group
+    {
+    public:
+        task_group();
+        task_group(const task_group&) = delete;
+        task_group& operator=(const task_group&) = delete;
+        // Waits for the tasks still running, ignoring their failure
+        ~task_group();
+
+        task run(std::function<void()> f, lane l = lane::cpu, const std::vector<task>& after = std::vector<task>());
+
+        void cancel();
+        bool is_cancelled() const;
+
+        void wait();
+
+    private:
+        std::shared_ptr<details::group_state> m_state;
+    };
+
+    // Calls f(i) for every i in [0, count) from the calling thread and the pool; returns once all calls have completed.
+    // If a call throws, the indices not yet started are skipped and the exception is rethrown.
+    template <class F>
+    void for_each_index(const size_t count, const F& f, const lane l = lane::cpu)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        task_group group;
+        auto drain = [&]()
+        {
+            for (size_t i = next++; i < count && !group.is_cancelled(); i = next++)
+            {
+                f(i);
+            }
+        };
+
+        // The calling thread drains the indices as well: helpers that only start once it is done find none left
+        const size_t helper_count = std::min(concurrency(l), count - 1);
+        for (size_t i = 0; i < helper_count; ++i)
+        {
+            group.run(drain, l);
+        }
+
+        try
+        {
+            drain();
+        }
+        catch (...)
+        {
+            // The helpers see the cancellation before their next index; the group waits for them as it goes away
+            group.cancel();
+            throw;
+        }
+        group.wait();
+    }
+}}
@@ -0,0 +1,22 @@
+#pragma once
+#include <istream>
+#include <string>
+#include <vector>
+#include "vcpkg_paths.h"
+
+namespace vcpkg {namespace Server
+{
+    // Runs "vcpkg server": keeps the status database, the files index and the ports loaded, reloading each of them
+    // when its directory changes, and answers the commands forwarded by forward_if_running() until interrupted
+    void run(const vcpkg_paths& paths);
+
+    // Runs "vcpkg batch": answers the queries, one per line, with the state of "vcpkg server", loaded once and reloaded
+    // as the server reloads it. A query is a list, search, owns or cache command line, without "vcpkg"; double quotes
+    // group words. The result of each query, in order, is a line "ok <n>" or "error <n>" followed by n lines of output.
+    // Blank lines are skipped.
+    void run_batch(const vcpkg_paths& paths, std::istream& queries);
+
+    // If a server is running for this vcpkg root, has it run command with arguments (options included), prints its
+    // output and exits. Returns when no server is listening, so the caller falls back to running the command itself.
+    void forward_if_running(const vcpkg_paths& paths, const std::string& command, const std::vector<std::string>& arguments);
+}}
@@ -65,8 +65,30 @@ namespace vcpkg {namespace Strings
 
     std::string utf16_to_utf8(const std::wstring& w);
 
+    // Finds a pattern ignoring ASCII case, without allocating per search. Construct one per pattern and reuse it
+    // across the strings to search.
+    class case_insensitive_ascii_searcher
+    {
+    public:
+        explicit case_insensitive_ascii_searcher(const std::string& pattern);
+
+        // The first match in [begin, end), or end. An empty pattern matches at begin.
+        const char* find(const char* begin, const char* end) const;
+
+        bool is_found_in(const std::string& s) const
+        {
+            const char* const end = s.data() + s.size();
+            return find(s.data(), end) != end || lowercase_pattern.empty();
+        }
+
+    private:
+        std::string lowercase_pattern;
+    };
+
     std::string::const_iterator case_insensitive_ascii_find(const std::string& s, const std::string& pattern);
 
+    bool case_insensitive_ascii_equals(const std::string& left, const char* right);
+
     std::string ascii_to_lowercase(const std::string& input);
 
     std::string join(const std::vector<std::string>& v, const std::string& delimiter);
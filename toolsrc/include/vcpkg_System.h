@@ -3,6 +3,8 @@
 #include "vcpkg_Strings.h"
 
 #include <filesystem>
+#include <cstdint>
+#include <functional>
 
 namespace vcpkg {namespace System
 {
@@ -21,6 +23,7 @@ namespace vcpkg {namespace System
         return cmd_execute(cmd_line.c_str());
     }
 
+    // Runs cmd_line through cmd.exe and collects what it writes to stdout and stderr
     exit_code_and_output cmd_execute_and_capture_output(const wchar_t* cmd_line);
 
     inline exit_code_and_output cmd_execute_and_capture_output(const std::wstring& cmd_line)
@@ -28,6 +31,30 @@ namespace vcpkg {namespace System
         return cmd_execute_and_capture_output(cmd_line.c_str());
     }
 
+    // What a program and every process it started used, as accounted by the job object they ran in
+    struct resource_usage
+    {
+        bool measured; // False when the program could not be put in a job, e.g. under a job that forbids nesting before Windows 8
+        long long cpu_ms; // User and kernel time, summed over the processes
+        uint64_t peak_memory_bytes; // Largest private memory committed by all the processes together at any one time
+        uint64_t read_bytes;
+        uint64_t write_bytes;
+        uint32_t process_count;
+    };
+
+    // Starts the program named by the first token of command_line with CreateProcessW, without going through cmd.exe, so the
+    // command line cannot use redirections, && or shell builtins. The child's stdout and stderr are read through one pipe in
+    // large chunks and on_line, if set, is called with each line (without its line break) as it arrives; stdin is NUL.
+    // Several children may run at once from different threads: each one only inherits its own handles.
+    // Returns the exit code of the program, or -1 if it could not be started. If usage is set, the program runs in a job
+    // object and usage receives the resources the process tree used. A non-empty environment is the environment block
+    // (NAME=VALUE strings, each null terminated, followed by a null) the program gets instead of this process's.
+    int process_execute(const std::wstring& command_line, const std::function<void(const std::string&)>& on_line, const std::tr2::sys::path& working_directory = std::tr2::sys::path(),
+                        resource_usage* usage = nullptr, const std::wstring& environment = std::wstring());
+
+    // Like process_execute, collecting everything the program wrote to stdout and stderr
+    exit_code_and_output process_execute_and_capture_output(const std::wstring& command_line, const std::tr2::sys::path& working_directory = std::tr2::sys::path());
+
     enum class color
     {
         success = 10,
@@ -64,14 +91,25 @@ namespace vcpkg {namespace System
         return println(c, Strings::format(messageTemplate, messageArgs...).c_str());
     }
 
-    struct Stopwatch2
+    // While an async_console exists, print and println queue their message and return at once, and a single thread
+    // writes the messages to the console in order, so that concurrent builds wait neither on the console nor on each
+    // other. The last one to go away writes out what is left, and so does exit().
+    class async_console
     {
-        int64_t start_time, end_time, freq;
+    public:
+        async_console();
+        ~async_console();
 
-        void start();
-        void stop();
-        double microseconds() const;
+        async_console(const async_console&) = delete;
+        async_console& operator=(const async_console&) = delete;
     };
 
+    // Shown under the output while an async_console exists and stdout is a console, and redrawn after each message.
+    // An empty line removes it.
+    void set_status_line(const std::string& line);
+
+    // Writes out the queued messages and takes the status line off the screen, for output that does not go through print
+    void flush_console();
+
     std::wstring wdupenv_str(const wchar_t* varname) noexcept;
 }}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vcpkg { namespace Trace
+{
+    namespace fs = std::tr2::sys;
+
+    // Starts recording spans; they are written as Chrome trace_event JSON to trace_file by flush()
+    void enable(const fs::path& trace_file);
+
+    bool is_enabled();
+
+    // Microseconds since tracing was enabled
+    long long now_us();
+
+    void record_span(const std::string& name, const std::string& category, long long start_us, long long end_us);
+
+    // Named numbers shown with a span, such as the resources a build used
+    using span_args = std::vector<std::pair<std::string, long long>>;
+
+    void record_span(const std::string& name, const std::string& category, long long start_us, long long end_us, const span_args& args);
+
+    // Imports "<phase> <start> <end>" lines (UTC, YYYY-MM-DDThh:mm:ss) written by vcpkg_execute_required_process
+    void record_cmake_phases(const fs::path& phases_file, const std::string& port);
+
+    void flush();
+
+    // Records a span from construction to destruction; does nothing while tracing is disabled
+    class scoped_span
+    {
+    public:
+        scoped_span(const std::string& name, const std::string& category);
+        ~scoped_span();
+
+        scoped_span(const scoped_span&) = delete;
+        scoped_span& operator=(const scoped_span&) = delete;
+
+    private:
+        std::string m_name;
+        std::string m_category;
+        long long m_start_us;
+    };
+}}
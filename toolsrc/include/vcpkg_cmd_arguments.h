@@ -14,10 +14,16 @@ namespace vcpkg
         static vcpkg_cmd_arguments create_from_arg_sequence(const std::string* arg_begin, const std::string* arg_end);
 
         std::unique_ptr<std::string> vcpkg_root_dir;
+        std::unique_ptr<std::string> scratch_root_dir;
         std::unique_ptr<std::string> target_triplet;
+        std::unique_ptr<std::string> jobs;
+        std::unique_ptr<std::string> trace_file;
+        std::unique_ptr<std::string> lock_file;
+        std::unique_ptr<std::string> write_lock_file;
         opt_bool debug = opt_bool::unspecified;
         opt_bool sendmetrics = opt_bool::unspecified;
         opt_bool printmetrics = opt_bool::unspecified;
+        opt_bool timings = opt_bool::unspecified;
 
         std::string command;
         std::vector<std::string> command_arguments;
@@ -1,5 +1,8 @@
 #pragma once
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "expected.h"
 #include "package_spec.h"
 #include "BinaryParagraph.h"
@@ -8,6 +11,35 @@ namespace vcpkg
 {
     namespace fs = std::tr2::sys;
 
+    // What triplets/<name>.cmake sets
+    struct triplet_properties
+    {
+        std::string architecture;       // VCPKG_TARGET_ARCHITECTURE, or the part of the name before the first dash
+        std::string cmake_system_name;  // VCPKG_CMAKE_SYSTEM_NAME; empty for desktop Windows
+        std::string crt_linkage;        // VCPKG_CRT_LINKAGE
+        std::string library_linkage;    // VCPKG_LIBRARY_LINKAGE
+        std::string compiler_cache;     // VCPKG_COMPILER_CACHE; empty when builds do not go through a compiler cache
+        std::string compiler_cache_dir; // VCPKG_COMPILER_CACHE_DIR; empty for downloads/compiler-cache
+    };
+
+    // By canonical triplet name
+    using triplet_catalogue = std::unordered_map<std::string, triplet_properties>;
+
+    // The files of one status database. Each triplet has its own under installed/vcpkg/triplets/<triplet>/, with the
+    // listfiles of its packages, so that installs into different triplets neither rewrite nor lock each other's.
+    struct status_database_files
+    {
+        fs::path dir;
+        fs::path status_file;
+        fs::path status_journal;
+        fs::path status_lock;
+        fs::path status_snapshot;
+        fs::path info;
+        // Journals of packages brought in from elsewhere, e.g. by extracting an export, one file each: read after the
+        // journal, and folded into the status file by the next load. The legacy database has none.
+        fs::path imports;
+    };
+
     struct vcpkg_paths
     {
         static expected<vcpkg_paths> create(const fs::path& vcpkg_root_dir);
@@ -16,9 +48,21 @@ namespace vcpkg
         fs::path port_dir(const package_spec& spec) const;
         fs::path build_info_file_path(const package_spec& spec) const;
         fs::path listfile_path(const BinaryParagraph& pgh) const;
+        fs::path importsfile_path(const BinaryParagraph& pgh) const;
+        fs::path hashesfile_path(const BinaryParagraph& pgh) const;
+        fs::path symbolsfile_path(const BinaryParagraph& pgh) const;
+        fs::path triplet_lock_path(const triplet& t) const;
+        status_database_files status_shard(const triplet& t) const;
+
+        // The single database older versions kept for every triplet directly in installed/vcpkg, split on first use
+        status_database_files legacy_status_database() const;
 
         bool is_valid_triplet(const triplet& t) const;
 
+        // The triplets/ directory is scanned and its files parsed on first use, once for this object and all its copies
+        const triplet_catalogue& triplets_catalogue() const;
+        const triplet_properties* find_triplet(const triplet& t) const;
+
         fs::path root;
         fs::path packages;
         fs::path buildtrees;
@@ -26,15 +70,47 @@ namespace vcpkg
         fs::path ports;
         fs::path installed;
         fs::path triplets;
+        fs::path trash;
 
         fs::path buildsystems;
         fs::path buildsystems_msbuild_targets;
 
         fs::path vcpkg_dir;
+        fs::path vcpkg_dir_shards;
         fs::path vcpkg_dir_status_file;
+        fs::path vcpkg_dir_status_journal;
+        fs::path vcpkg_dir_status_lock;
+        fs::path vcpkg_dir_status_snapshot;
+        fs::path vcpkg_dir_ports_index;
+        fs::path vcpkg_dir_files_index;
+        fs::path vcpkg_dir_packages_index;
+        fs::path vcpkg_dir_packages_index_lock;
         fs::path vcpkg_dir_info;
         fs::path vcpkg_dir_updates;
+        fs::path vcpkg_dir_build_durations;
+        fs::path vcpkg_dir_build_resources;
+        fs::path vcpkg_dir_lint_cache;
+        fs::path vcpkg_dir_tool_versions;
+        fs::path vcpkg_dir_vcvars;
+        fs::path vcpkg_dir_access_log;
+        fs::path vcpkg_dir_plans;
+        fs::path vcpkg_dir_msbuild;
+        fs::path vcpkg_dir_symbols;
+        fs::path vcpkg_dir_symbols_lock;
 
         fs::path ports_cmake;
+
+        // The triplet of this machine, %VCPKG_HOST_TRIPLET% or else the desktop triplet of its architecture. The tools a
+        // port runs while it builds (Host-Depends) are built once for it and shared by the builds of every triplet.
+        triplet host_triplet;
+
+    private:
+        struct lazy_triplet_catalogue
+        {
+            std::once_flag once;
+            triplet_catalogue catalogue;
+        };
+
+        std::shared_ptr<lazy_triplet_catalogue> m_triplet_catalogue = std::make_shared<lazy_triplet_catalogue>();
     };
 }
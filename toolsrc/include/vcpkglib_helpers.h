@@ -1,6 +1,7 @@
 #pragma once
 
 #include <unordered_map>
+#include "Paragraphs.h"
 
 namespace vcpkg {namespace details
 {
@@ -10,5 +11,8 @@ namespace vcpkg {namespace details
     std::string required_field(const std::unordered_map<std::string, std::string>& fields, const std::string& fieldname);
     std::string remove_required_field(std::unordered_map<std::string, std::string>* fields, const std::string& fieldname);
 
+    std::string optional_field(const Paragraphs::paragraph_view& fields, const std::string& fieldname);
+    std::string required_field(const Paragraphs::paragraph_view& fields, const std::string& fieldname);
+
     std::string shorten_description(const std::string& desc);
 }}
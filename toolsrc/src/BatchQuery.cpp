@@ -0,0 +1,67 @@
+#include "BatchQuery.h"
+#include <algorithm>
+
+namespace vcpkg { namespace BatchQuery
+{
+    std::vector<std::string> split_query(const std::string& query)
+    {
+        std::vector<std::string> words;
+        std::string word;
+        bool in_word = false;
+        bool quoted = false;
+        for (const char c : query)
+        {
+            if (c == '"')
+            {
+                quoted = !quoted;
+                in_word = true;
+            }
+            else if ((c == ' ' || c == '\t' || c == '\r') && !quoted)
+            {
+                if (in_word)
+                {
+                    words.push_back(std::move(word));
+                    word.clear();
+                    in_word = false;
+                }
+            }
+            else
+            {
+                word.push_back(c);
+                in_word = true;
+            }
+        }
+        if (in_word)
+        {
+            words.push_back(std::move(word));
+        }
+        return words;
+    }
+
+    std::string find_invalid_option(const std::vector<std::string>& words)
+    {
+        if (words.empty())
+        {
+            return std::string();
+        }
+
+        const bool takes_options = words[0] == "owns";
+        const auto invalid_option = std::find_if(words.begin() + 1, words.end(), [&](const std::string& word)
+            {
+                return word.compare(0, 2, "--") == 0 && !(takes_options && (word == "--exact" || word == "--suffix"));
+            });
+        return invalid_option != words.end() ? *invalid_option : std::string();
+    }
+
+    std::string format_result(const std::string& status, const std::string& output)
+    {
+        const bool unterminated = !output.empty() && output.back() != '\n';
+        const size_t line_count = static_cast<size_t>(std::count(output.begin(), output.end(), '\n')) + (unterminated ? 1 : 0);
+        std::string result = status + " " + std::to_string(line_count) + "\n" + output;
+        if (unterminated)
+        {
+            result.push_back('\n');
+        }
+        return result;
+    }
+}}
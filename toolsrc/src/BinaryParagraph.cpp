@@ -20,6 +20,8 @@ namespace vcpkg
         static const std::string DESCRIPTION = "Description";
         static const std::string MAINTAINER = "Maintainer";
         static const std::string DEPENDS = "Depends";
+        static const std::string ABI = "Abi";
+        static const std::string HEADER_ONLY = "Header-Only";
     }
 
     static const std::vector<std::string>& get_list_of_valid_fields()
@@ -32,7 +34,9 @@ namespace vcpkg
 
             BinaryParagraphOptionalField::DESCRIPTION,
             BinaryParagraphOptionalField::MAINTAINER,
-            BinaryParagraphOptionalField::DEPENDS
+            BinaryParagraphOptionalField::DEPENDS,
+            BinaryParagraphOptionalField::ABI,
+            BinaryParagraphOptionalField::HEADER_ONLY
         };
 
         return valid_fields;
@@ -40,23 +44,37 @@ namespace vcpkg
 
     BinaryParagraph::BinaryParagraph() = default;
 
-    BinaryParagraph::BinaryParagraph(std::unordered_map<std::string, std::string> fields)
+    // Fields is either the owning map or a view into the parsed text; only lookups are needed
+    template <class Fields>
+    static void parse_binary_paragraph(const Fields& fields, BinaryParagraph* pgh)
     {
-        const std::string name = details::remove_required_field(&fields, BinaryParagraphRequiredField::PACKAGE);
-        const std::string architecture = details::remove_required_field(&fields, BinaryParagraphRequiredField::ARCHITECTURE);
+        const std::string name = details::required_field(fields, BinaryParagraphRequiredField::PACKAGE);
+        const std::string architecture = details::required_field(fields, BinaryParagraphRequiredField::ARCHITECTURE);
         const triplet target_triplet = triplet::from_canonical_name(architecture);
 
-        this->spec = package_spec::from_name_and_triplet(name, target_triplet).get_or_throw();
-        this->version = details::remove_required_field(&fields, BinaryParagraphRequiredField::VERSION);
+        pgh->spec = package_spec::from_name_and_triplet(name, target_triplet).get_or_throw();
+        pgh->version = details::required_field(fields, BinaryParagraphRequiredField::VERSION);
 
-        this->description = details::remove_optional_field(&fields, BinaryParagraphOptionalField::DESCRIPTION);
-        this->maintainer = details::remove_optional_field(&fields, BinaryParagraphOptionalField::MAINTAINER);
+        pgh->description = details::optional_field(fields, BinaryParagraphOptionalField::DESCRIPTION);
+        pgh->maintainer = details::optional_field(fields, BinaryParagraphOptionalField::MAINTAINER);
+        pgh->abi = details::optional_field(fields, BinaryParagraphOptionalField::ABI);
+        pgh->header_only = details::optional_field(fields, BinaryParagraphOptionalField::HEADER_ONLY) == "yes";
 
-        std::string multi_arch = details::remove_required_field(&fields, BinaryParagraphRequiredField::MULTI_ARCH);
+        std::string multi_arch = details::required_field(fields, BinaryParagraphRequiredField::MULTI_ARCH);
         Checks::check_exit(multi_arch == "same", "Multi-Arch must be 'same' but was %s", multi_arch);
 
-        std::string deps = details::remove_optional_field(&fields, BinaryParagraphOptionalField::DEPENDS);
-        this->depends = parse_depends(deps);
+        std::string deps = details::optional_field(fields, BinaryParagraphOptionalField::DEPENDS);
+        pgh->depends = parse_depends(deps);
+    }
+
+    BinaryParagraph::BinaryParagraph(std::unordered_map<std::string, std::string> fields)
+    {
+        parse_binary_paragraph(fields, this);
+    }
+
+    BinaryParagraph::BinaryParagraph(const Paragraphs::paragraph_view& fields)
+    {
+        parse_binary_paragraph(fields, this);
     }
 
     BinaryParagraph::BinaryParagraph(const SourceParagraph& spgh, const triplet& target_triplet)
@@ -66,6 +84,7 @@ namespace vcpkg
         this->description = spgh.description;
         this->maintainer = spgh.maintainer;
         this->depends = filter_dependencies(spgh.depends, target_triplet);
+        this->header_only = spgh.header_only;
     }
 
     std::string BinaryParagraph::displayname() const
@@ -106,6 +125,10 @@ namespace vcpkg
             os << "Maintainer: " << p.maintainer << "\n";
         if (!p.description.empty())
             os << "Description: " << p.description << "\n";
+        if (!p.abi.empty())
+            os << "Abi: " << p.abi << "\n";
+        if (p.header_only)
+            os << "Header-Only: yes\n";
         return os;
     }
 }
@@ -0,0 +1,150 @@
+#include "BuildDurations.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <set>
+#include <sstream>
+
+namespace vcpkg { namespace BuildDurations
+{
+    duration_map load(const vcpkg_paths& paths)
+    {
+        duration_map durations;
+        const expected<std::string> contents = Files::get_contents(paths.vcpkg_dir_build_durations);
+        const std::string* text = contents.get();
+        if (text == nullptr)
+        {
+            return durations;
+        }
+
+        size_t pos = 0;
+        while (pos < text->size())
+        {
+            size_t end = text->find('\n', pos);
+            if (end == std::string::npos)
+                end = text->size();
+            const std::string line = text->substr(pos, end - pos);
+            pos = end + 1;
+
+            const size_t space = line.find(' ');
+            if (space == std::string::npos || space == 0)
+                continue;
+
+            try
+            {
+                const long long milliseconds = std::stoll(line.substr(space + 1));
+                if (milliseconds >= 0)
+                    durations[line.substr(0, space)] = milliseconds;
+            }
+            catch (const std::exception&)
+            {
+                // Not written by us; skip the line
+            }
+        }
+        return durations;
+    }
+
+    void record(const vcpkg_paths& paths, const duration_map& measured)
+    {
+        if (measured.empty())
+        {
+            return;
+        }
+
+        duration_map durations = load(paths);
+        for (auto&& kv : measured)
+        {
+            auto it = durations.find(kv.first);
+            if (it == durations.end())
+                durations.emplace(kv.first, kv.second);
+            else
+                it->second = (it->second + kv.second) / 2;
+        }
+
+        // One "<port>:<triplet> <milliseconds>" line per package
+        const fs::path& file = paths.vcpkg_dir_build_durations;
+        std::ostringstream os;
+        for (auto&& kv : durations)
+        {
+            os << kv.first << ' ' << kv.second << '\n';
+        }
+
+        Files::write_contents_atomically(file, os.str());
+    }
+
+    std::vector<long long> critical_paths(const std::vector<long long>& durations, const std::vector<std::vector<size_t>>& dependents)
+    {
+        std::vector<long long> paths(durations.size());
+        for (size_t i = durations.size(); i-- != 0;)
+        {
+            long long longest_after = 0;
+            for (const size_t dependent : dependents[i])
+            {
+                longest_after = std::max(longest_after, paths[dependent]);
+            }
+            paths[i] = durations[i] + longest_after;
+        }
+        return paths;
+    }
+
+    long long estimate_makespan(const std::vector<long long>& durations, const std::vector<std::vector<size_t>>& dependents, const size_t job_count)
+    {
+        const std::vector<long long> priorities = critical_paths(durations, dependents);
+
+        std::vector<size_t> unmet_dependency_count(durations.size());
+        for (const std::vector<size_t>& of_one : dependents)
+        {
+            for (const size_t dependent : of_one)
+            {
+                ++unmet_dependency_count[dependent];
+            }
+        }
+
+        // Longest critical path first, then plan order, as in the install command
+        std::set<std::pair<long long, size_t>> ready;
+        for (size_t i = 0; i < durations.size(); ++i)
+        {
+            if (unmet_dependency_count[i] == 0)
+                ready.emplace(-priorities[i], i);
+        }
+
+        // (finish time, plan index), earliest first
+        using running_build = std::pair<long long, size_t>;
+        std::priority_queue<running_build, std::vector<running_build>, std::greater<running_build>> running;
+        long long now = 0;
+        while (!ready.empty() || !running.empty())
+        {
+            while (!ready.empty() && running.size() < std::max(size_t(1), job_count))
+            {
+                const size_t i = ready.begin()->second;
+                ready.erase(ready.begin());
+                running.emplace(now + durations[i], i);
+            }
+
+            const running_build finished = running.top();
+            running.pop();
+            now = finished.first;
+            for (const size_t dependent : dependents[finished.second])
+            {
+                if (--unmet_dependency_count[dependent] == 0)
+                    ready.emplace(-priorities[dependent], dependent);
+            }
+        }
+        return now;
+    }
+
+    std::string format_duration(const long long milliseconds)
+    {
+        const long long seconds = (milliseconds + 500) / 1000;
+        const int h = static_cast<int>(seconds / 3600);
+        const int m = static_cast<int>(seconds / 60 % 60);
+        const int s = static_cast<int>(seconds % 60);
+        if (h != 0)
+            return Strings::format("%dh %02dm %02ds", h, m, s);
+        if (m != 0)
+            return Strings::format("%dm %02ds", m, s);
+        return Strings::format("%ds", s);
+    }
+}}
@@ -0,0 +1,220 @@
+#include "BuildFarm.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include "vcpkg_System.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <Windows.h>
+
+namespace vcpkg { namespace BuildFarm
+{
+    static const std::string PLAN_FILE = "plan.lock";
+    static const std::string LOG_FILE = "log";
+    static const std::string RESULT_FILE = "result";
+    static const std::string HEARTBEAT_FILE = "heartbeat";
+    static const std::string RESULT_SUCCEEDED = "succeeded";
+
+    static const auto POLL_INTERVAL = std::chrono::seconds(2);
+    static const auto HEARTBEAT_INTERVAL = std::chrono::seconds(30);
+    // Measured on this machine from the last time the heartbeat changed, so that the clocks of the machines do not matter
+    static const auto HEARTBEAT_TIMEOUT = std::chrono::minutes(5);
+
+    static fs::path incoming_dir(const fs::path& farm_dir) { return farm_dir / "incoming"; }
+    static fs::path queue_dir(const fs::path& farm_dir) { return farm_dir / "queue"; }
+    static fs::path running_dir(const fs::path& farm_dir) { return farm_dir / "running"; }
+    static fs::path done_dir(const fs::path& farm_dir) { return farm_dir / "done"; }
+
+    fs::path get_farm_dir()
+    {
+        return System::wdupenv_str(L"VCPKG_BUILD_FARM");
+    }
+
+    fs::path plan_file(const fs::path& build_dir)
+    {
+        return build_dir / PLAN_FILE;
+    }
+
+    static std::string unique_suffix()
+    {
+        wchar_t computer_name[MAX_COMPUTERNAME_LENGTH + 1];
+        DWORD size = MAX_COMPUTERNAME_LENGTH + 1;
+        const std::string machine = GetComputerNameW(computer_name, &size) ? Strings::utf16_to_utf8(std::wstring(computer_name, size)) : std::string("unknown");
+        return Strings::format("%s.%d", machine, static_cast<int>(GetCurrentProcessId()));
+    }
+
+    // Writes the build of plan to incoming/ and moves it to queue/<name>; a build of that name queued first is kept
+    static void queue_build(const vcpkg_paths& paths, const fs::path& farm_dir, const InstallLock::locked_plan& plan, const std::string& name)
+    {
+        const fs::path staging = incoming_dir(farm_dir) / (name + "." + unique_suffix());
+        std::error_code ec;
+        fs::remove_all(staging, ec);
+        fs::create_directories(staging / "ports", ec);
+        fs::create_directories(queue_dir(farm_dir), ec);
+
+        InstallLock::write(plan_file(staging), plan.plan, plan.dependency_graph, plan.abis);
+        std::set<std::string> ports;
+        for (const package_spec& spec : plan.plan)
+        {
+            if (ports.insert(spec.name()).second)
+            {
+                fs::copy(paths.port_dir(spec), staging / "ports" / spec.name(), fs::copy_options::recursive, ec);
+            }
+        }
+
+        fs::rename(staging, queue_dir(farm_dir) / name, ec);
+        if (ec)
+        {
+            fs::remove_all(staging, ec);
+        }
+    }
+
+    static std::string read_file_or_empty(const fs::path& file)
+    {
+        const expected<std::string> contents = Files::get_contents(file);
+        return contents.get() != nullptr ? *contents.get() : std::string();
+    }
+
+    remote_result build_remotely(const vcpkg_paths& paths, const fs::path& farm_dir, const InstallLock::locked_plan& plan, const std::function<void(const std::string&)>& on_line)
+    {
+        const std::string name = plan.abis.at(plan.plan.back());
+        const fs::path queued = queue_dir(farm_dir) / name;
+        const fs::path running = running_dir(farm_dir) / name;
+        const fs::path done = done_dir(farm_dir) / name;
+
+        if (!fs::exists(queued) && !fs::exists(running) && !fs::exists(done))
+        {
+            queue_build(paths, farm_dir, plan, name);
+        }
+
+        std::string last_heartbeat;
+        auto last_heartbeat_change = std::chrono::steady_clock::now();
+        int vanished_polls = 0;
+        for (;;)
+        {
+            if (fs::exists(done / RESULT_FILE))
+            {
+                const bool succeeded = read_file_or_empty(done / RESULT_FILE) == RESULT_SUCCEEDED;
+                std::istringstream log(read_file_or_empty(done / LOG_FILE));
+                std::string line;
+                while (std::getline(log, line))
+                {
+                    on_line(line);
+                }
+
+                std::error_code ec;
+                fs::remove_all(done, ec);
+                return succeeded ? remote_result::SUCCEEDED : remote_result::FAILED;
+            }
+
+            const bool is_running = fs::exists(running);
+            const bool is_queued = !is_running && fs::exists(queued);
+            vanished_polls = is_running || is_queued || fs::exists(done) ? 0 : vanished_polls + 1;
+            if (is_running)
+            {
+                const std::string heartbeat = read_file_or_empty(running / HEARTBEAT_FILE);
+                if (heartbeat != last_heartbeat)
+                {
+                    last_heartbeat = heartbeat;
+                    last_heartbeat_change = std::chrono::steady_clock::now();
+                }
+                else if (std::chrono::steady_clock::now() - last_heartbeat_change > HEARTBEAT_TIMEOUT)
+                {
+                    return remote_result::LOST;
+                }
+            }
+            else if (vanished_polls == 2)
+            {
+                // Another install waiting for the same build took its result: the package is in the binary cache. A build
+                // is only taken for gone when seen nowhere twice, as it may be moved between two of the checks above.
+                return remote_result::SUCCEEDED;
+            }
+            else
+            {
+                // Queued builds wait for as long as the farm is busy
+                last_heartbeat_change = std::chrono::steady_clock::now();
+            }
+
+            std::this_thread::sleep_for(POLL_INTERVAL);
+        }
+    }
+
+    fs::path claim(const fs::path& farm_dir)
+    {
+        // Oldest first, by the time the build was queued
+        std::vector<std::pair<long long, fs::path>> queued;
+        std::error_code ec;
+        for (auto it = fs::directory_iterator(queue_dir(farm_dir), ec); !ec && it != fs::directory_iterator(); ++it)
+        {
+            std::error_code time_ec;
+            const auto mtime = fs::last_write_time(it->path(), time_ec);
+            queued.emplace_back(time_ec ? 0 : static_cast<long long>(mtime.time_since_epoch().count()), it->path());
+        }
+        std::sort(queued.begin(), queued.end());
+
+        fs::create_directories(running_dir(farm_dir), ec);
+        for (auto&& entry : queued)
+        {
+            // Only one of the workers racing for a build manages to move it
+            const fs::path claimed = running_dir(farm_dir) / entry.second.filename();
+            std::error_code rename_ec;
+            fs::rename(entry.second, claimed, rename_ec);
+            if (!rename_ec)
+            {
+                return claimed;
+            }
+        }
+        return fs::path();
+    }
+
+    void finish(const fs::path& farm_dir, const fs::path& build_dir, const bool succeeded)
+    {
+        std::ofstream(build_dir / RESULT_FILE, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc) << (succeeded ? RESULT_SUCCEEDED : std::string("failed"));
+
+        // The build tree and the ports are of no use to the machine waiting for the result
+        std::error_code ec;
+        fs::remove_all(build_dir / "ports", ec);
+        fs::create_directories(done_dir(farm_dir), ec);
+        const fs::path done = done_dir(farm_dir) / build_dir.filename();
+        fs::remove_all(done, ec);
+        fs::rename(build_dir, done, ec);
+    }
+
+    struct heartbeat::state
+    {
+        std::mutex mutex;
+        std::condition_variable stop_requested;
+        bool stop = false;
+        std::thread beater;
+    };
+
+    heartbeat::heartbeat(const fs::path& build_dir) : m_state(std::make_unique<state>())
+    {
+        state& s = *m_state;
+        s.beater = std::thread([&s, build_dir]()
+            {
+                std::unique_lock<std::mutex> lock(s.mutex);
+                for (long long beat = 0; !s.stop; ++beat)
+                {
+                    std::ofstream(build_dir / HEARTBEAT_FILE, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc) << beat;
+                    s.stop_requested.wait_for(lock, HEARTBEAT_INTERVAL, [&]() { return s.stop; });
+                }
+            });
+    }
+
+    heartbeat::~heartbeat()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            m_state->stop = true;
+        }
+        m_state->stop_requested.notify_one();
+        m_state->beater.join();
+    }
+}}
@@ -26,11 +26,19 @@ namespace vcpkg
         static const std::string LIBRARY_LINKAGE = "LibraryLinkage";
     }
 
+    namespace BuildInfoOptionalField
+    {
+        static const std::string BUILD_TYPE = "BuildType";
+        static const std::string UNITY_BUILD = "UnityBuild";
+    }
+
     BuildInfo BuildInfo::create(const std::unordered_map<std::string, std::string>& pgh)
     {
         BuildInfo build_info;
         build_info.crt_linkage = details::required_field(pgh, BuildInfoRequiredField::CRT_LINKAGE);
         build_info.library_linkage = details::required_field(pgh, BuildInfoRequiredField::LIBRARY_LINKAGE);
+        build_info.build_type = details::optional_field(pgh, BuildInfoOptionalField::BUILD_TYPE);
+        build_info.unity_build = details::optional_field(pgh, BuildInfoOptionalField::UNITY_BUILD) == "ON";
 
         return build_info;
     }
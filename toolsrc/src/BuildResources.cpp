@@ -0,0 +1,92 @@
+#include "BuildResources.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include <sstream>
+
+namespace vcpkg { namespace BuildResources
+{
+    resource_map load(const vcpkg_paths& paths)
+    {
+        resource_map resources;
+        const expected<std::string> contents = Files::get_contents(paths.vcpkg_dir_build_resources);
+        const std::string* text = contents.get();
+        if (text == nullptr)
+        {
+            return resources;
+        }
+
+        std::istringstream lines(*text);
+        for (std::string line; std::getline(lines, line);)
+        {
+            std::istringstream fields(line);
+            std::string spec;
+            build_resources r = {};
+            if (fields >> spec >> r.wall_ms >> r.cpu_ms >> r.peak_memory_bytes >> r.read_bytes >> r.write_bytes)
+            {
+                // Records written before unity builds were tracked end here
+                std::string mode;
+                if (fields >> mode >> r.other_wall_ms)
+                {
+                    r.unity_build = mode == "unity";
+                }
+                else
+                {
+                    r.other_wall_ms = 0;
+                }
+                resources[spec] = r;
+            }
+        }
+        return resources;
+    }
+
+    void record(const vcpkg_paths& paths, const resource_map& measured)
+    {
+        if (measured.empty())
+        {
+            return;
+        }
+
+        resource_map resources = load(paths);
+        for (auto&& kv : measured)
+        {
+            build_resources r = kv.second;
+            const auto previous = resources.find(kv.first);
+            if (previous != resources.end())
+            {
+                r.other_wall_ms = previous->second.unity_build != r.unity_build ? previous->second.wall_ms : previous->second.other_wall_ms;
+            }
+            resources[kv.first] = r;
+        }
+
+        // One "<port>:<triplet> <wall ms> <cpu ms> <peak memory> <bytes read> <bytes written> <unity|regular> <other wall ms>"
+        // line per package
+        const fs::path& file = paths.vcpkg_dir_build_resources;
+        std::ostringstream os;
+        for (auto&& kv : resources)
+        {
+            const build_resources& r = kv.second;
+            os << kv.first << ' ' << r.wall_ms << ' ' << r.cpu_ms << ' ' << r.peak_memory_bytes << ' ' << r.read_bytes << ' ' << r.write_bytes
+               << ' ' << (r.unity_build ? "unity" : "regular") << ' ' << r.other_wall_ms << '\n';
+        }
+
+        Files::write_contents_atomically(file, os.str());
+    }
+
+    std::string format_bytes(const uint64_t bytes)
+    {
+        if (bytes < 1024)
+        {
+            return std::to_string(bytes) + " B";
+        }
+
+        static const char* const UNITS[] = {"KiB", "MiB", "GiB", "TiB"};
+        double value = static_cast<double>(bytes) / 1024;
+        size_t unit = 0;
+        while (value >= 1024 && unit + 1 < sizeof(UNITS) / sizeof(UNITS[0]))
+        {
+            value /= 1024;
+            ++unit;
+        }
+        return Strings::format("%.1f %s", value, UNITS[unit]);
+    }
+}}
@@ -0,0 +1,160 @@
+#include "CMakeIndex.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include <map>
+#include <sstream>
+
+namespace vcpkg { namespace CMakeIndex
+{
+    static const std::string PACKAGE_MARKER = "# package ";
+
+    static fs::path index_file(const vcpkg_paths& paths, const triplet& t)
+    {
+        return paths.status_shard(t).dir / "cmake-index.cmake";
+    }
+
+    static bool ends_with(const std::string& s, const std::string& suffix)
+    {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // The find_package() name a config file answers to, or an empty string when the file is not a config file
+    static std::string config_package_name(const std::string& filename)
+    {
+        static const std::string CAMEL_CASE_SUFFIX = "Config.cmake";
+        static const std::string LOWER_CASE_SUFFIX = "-config.cmake";
+        if (ends_with(filename, LOWER_CASE_SUFFIX))
+        {
+            return filename.substr(0, filename.size() - LOWER_CASE_SUFFIX.size());
+        }
+        if (ends_with(filename, CAMEL_CASE_SUFFIX))
+        {
+            return filename.substr(0, filename.size() - CAMEL_CASE_SUFFIX.size());
+        }
+        return std::string();
+    }
+
+    static std::string make_block(const BinaryParagraph& pgh, const std::vector<std::string>& listed_paths)
+    {
+        const std::string prefix = pgh.spec.target_triplet().canonical_name() + "/";
+        std::string configs;
+        std::string libraries;
+        std::string debug_libraries;
+        bool has_headers = false;
+        for (const std::string& path : listed_paths)
+        {
+            if (path.compare(0, prefix.size(), prefix) != 0)
+            {
+                continue;
+            }
+
+            const std::string relative = path.substr(prefix.size());
+            const size_t separator = relative.rfind('/');
+            if (separator == std::string::npos)
+            {
+                continue;
+            }
+
+            const std::string dir = relative.substr(0, separator);
+            const std::string filename = relative.substr(separator + 1);
+            if (dir.compare(0, 8, "include/") == 0 || dir == "include")
+            {
+                has_headers = true;
+            }
+            else if (dir.compare(0, 6, "share/") == 0)
+            {
+                const std::string name = config_package_name(filename);
+                if (!name.empty())
+                {
+                    configs.append(configs.empty() ? "" : ";").append(name).append("=").append(dir);
+                }
+            }
+            else if ((dir == "lib" || dir == "debug/lib") && ends_with(Strings::ascii_to_lowercase(filename), ".lib"))
+            {
+                std::string& libs = dir == "lib" ? libraries : debug_libraries;
+                libs.append(libs.empty() ? "" : ";").append(relative);
+            }
+        }
+
+        const std::string& name = pgh.spec.name();
+        std::string block = PACKAGE_MARKER + name + "\n";
+        block.append(Strings::format("list(APPEND VCPKG_INDEX_PACKAGES %s)\n", name));
+        block.append(Strings::format("set(VCPKG_INDEX_%s_CONFIGS \"%s\")\n", name, configs));
+        block.append(Strings::format("set(VCPKG_INDEX_%s_INCLUDE_DIR \"%s\")\n", name, has_headers ? "include" : ""));
+        block.append(Strings::format("set(VCPKG_INDEX_%s_LIBRARIES \"%s\")\n", name, libraries));
+        block.append(Strings::format("set(VCPKG_INDEX_%s_DEBUG_LIBRARIES \"%s\")\n", name, debug_libraries));
+        return block;
+    }
+
+    // The block of each port in the index file, by port name
+    static std::map<std::string, std::string> read_blocks(const fs::path& file)
+    {
+        std::map<std::string, std::string> blocks;
+        const expected<std::string> contents = Files::get_contents(file);
+        if (contents.get() == nullptr)
+        {
+            return blocks;
+        }
+
+        std::istringstream lines(*contents.get());
+        std::string line;
+        std::string* block = nullptr;
+        while (std::getline(lines, line))
+        {
+            if (line.compare(0, PACKAGE_MARKER.size(), PACKAGE_MARKER) == 0)
+            {
+                block = &blocks[line.substr(PACKAGE_MARKER.size())];
+            }
+            if (block != nullptr && !line.empty())
+            {
+                block->append(line).push_back('\n');
+            }
+        }
+        return blocks;
+    }
+
+    // Configures may be reading the file: it is replaced as a whole
+    static void write_blocks(const fs::path& file, const triplet& t, const std::map<std::string, std::string>& blocks)
+    {
+        std::string contents = Strings::format("# Written by vcpkg: what the packages installed for %s provide, relative to installed/%s\n", t.canonical_name(), t.canonical_name());
+        for (auto&& kv : blocks)
+        {
+            contents.append("\n").append(kv.second);
+        }
+        Files::write_contents_atomically(file, contents);
+    }
+
+    void add_package(const vcpkg_paths& paths, const BinaryParagraph& pgh, const std::vector<std::string>& listed_paths)
+    {
+        const fs::path file = index_file(paths, pgh.spec.target_triplet());
+        std::map<std::string, std::string> blocks = read_blocks(file);
+        blocks[pgh.spec.name()] = make_block(pgh, listed_paths);
+        write_blocks(file, pgh.spec.target_triplet(), blocks);
+    }
+
+    void remove_packages(const vcpkg_paths& paths, const std::vector<const BinaryParagraph*>& pghs)
+    {
+        std::map<std::string, std::vector<const BinaryParagraph*>> by_triplet;
+        for (const BinaryParagraph* pgh : pghs)
+        {
+            by_triplet[pgh->spec.target_triplet().canonical_name()].push_back(pgh);
+        }
+
+        for (auto&& kv : by_triplet)
+        {
+            const triplet t = triplet::from_canonical_name(kv.first);
+            const fs::path file = index_file(paths, t);
+            if (!fs::exists(file))
+            {
+                continue;
+            }
+
+            std::map<std::string, std::string> blocks = read_blocks(file);
+            for (const BinaryParagraph* pgh : kv.second)
+            {
+                blocks.erase(pgh->spec.name());
+            }
+            write_blocks(file, t, blocks);
+        }
+    }
+}}
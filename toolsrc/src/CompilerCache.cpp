@@ -0,0 +1,138 @@
+#include "CompilerCache.h"
+#include "vcpkg_System.h"
+#include "vcpkg_Strings.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace vcpkg { namespace CompilerCache
+{
+    std::vector<compiler_cache> find_compiler_caches(const vcpkg_paths& paths, const std::vector<package_spec>& specs)
+    {
+        std::vector<compiler_cache> caches;
+        for (const package_spec& spec : specs)
+        {
+            const triplet_properties* properties = paths.find_triplet(spec.target_triplet());
+            if (properties == nullptr || properties->compiler_cache.empty())
+                continue;
+
+            // Must match the default of vcpkg_enable_compiler_cache
+            const fs::path dir = properties->compiler_cache_dir.empty() ? paths.downloads / "compiler-cache" : fs::path(properties->compiler_cache_dir);
+            const auto same = std::find_if(caches.begin(), caches.end(), [&](const compiler_cache& c)
+                {
+                    return c.program == properties->compiler_cache && c.dir == dir;
+                });
+            if (same == caches.end())
+                caches.push_back({properties->compiler_cache, dir});
+        }
+        return caches;
+    }
+
+    cache_stats parse_stats(const std::string& output)
+    {
+        cache_stats stats = {false, 0, 0};
+        bool misses_on_next_line = false; // clcache lists the total of its misses on the line after "cache misses"
+
+        std::istringstream lines(output);
+        for (std::string line; std::getline(lines, line);)
+        {
+            line = Strings::ascii_to_lowercase(line);
+            const size_t first = line.find_first_not_of(" \t");
+            const size_t last = line.find_last_not_of(" \t\r");
+            if (first == std::string::npos)
+                continue;
+            line = line.substr(first, last - first + 1);
+
+            // The counter is the last field, after spaces or a colon
+            const size_t number_start = line.find_last_of(" \t:") + 1;
+            bool has_number = number_start < line.size() && std::all_of(line.begin() + number_start, line.end(), [](const char c) { return c >= '0' && c <= '9'; });
+            long long number = 0;
+            if (has_number)
+            {
+                try
+                {
+                    number = std::stoll(line.substr(number_start));
+                }
+                catch (const std::out_of_range&)
+                {
+                    // Not a counter anyone could have reached
+                    has_number = false;
+                }
+            }
+
+            const bool was_misses_heading = misses_on_next_line;
+            misses_on_next_line = false;
+
+            // sccache also breaks its counters down by language, as "cache hits (c/c++)"
+            if (line.compare(0, 12, "cache hits (") == 0 || line.compare(0, 14, "cache misses (") == 0)
+                continue;
+
+            if (line.compare(0, 9, "cache hit") == 0)
+            {
+                // ccache counts direct and preprocessed hits separately; "cache hit rate" is not a counter
+                if (has_number)
+                {
+                    stats.hits += number;
+                    stats.measured = true;
+                }
+            }
+            else if (line.compare(0, 10, "cache miss") == 0)
+            {
+                if (has_number)
+                {
+                    stats.misses += number;
+                    stats.measured = true;
+                }
+                else
+                {
+                    misses_on_next_line = true;
+                }
+            }
+            else if (was_misses_heading && has_number && line.compare(0, 5, "total") == 0)
+            {
+                stats.misses += number;
+                stats.measured = true;
+            }
+        }
+        return stats;
+    }
+
+    static bool is_sccache(const compiler_cache& cache)
+    {
+        const std::string name = Strings::ascii_to_lowercase(fs::path(cache.program).stem().generic_string());
+        return name.find("sccache") != std::string::npos;
+    }
+
+    cache_stats query_stats(const compiler_cache& cache)
+    {
+        const std::wstring dir = cache.dir.wstring();
+        const std::wstring command = Strings::wformat(LR"(cmd.exe /c "set "CLCACHE_DIR=%s" && set "CCACHE_DIR=%s" && set "SCCACHE_DIR=%s" && "%s" %s")",
+                                                      dir, dir, dir, Strings::utf8_to_utf16(cache.program), is_sccache(cache) ? L"--show-stats" : L"-s");
+        const System::exit_code_and_output result = System::process_execute_and_capture_output(command);
+        if (result.exit_code != 0)
+        {
+            return {false, 0, 0};
+        }
+        return parse_stats(result.output);
+    }
+
+    std::string format_stats_since(const compiler_cache& cache, const cache_stats& before, const cache_stats& after)
+    {
+        long long hits = after.hits;
+        long long misses = after.misses;
+        // sccache forgets its counters when its server stops, which it does when idle
+        if (before.measured && before.hits <= after.hits && before.misses <= after.misses)
+        {
+            hits -= before.hits;
+            misses -= before.misses;
+        }
+
+        const std::string name = fs::path(cache.program).stem().generic_string();
+        if (hits + misses == 0)
+        {
+            return Strings::format("%s: no compilations went through the cache", name);
+        }
+        return Strings::format("%s: %s hits, %s misses (%d%% hit rate)", name, std::to_string(hits), std::to_string(misses),
+                               static_cast<int>(hits * 100 / (hits + misses)));
+    }
+}}
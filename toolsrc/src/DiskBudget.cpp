@@ -0,0 +1,464 @@
+#include "DiskBudget.h"
+#include "BuildResources.h"
+#include "Trash.h"
+#include "vcpkg_Downloads.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include "vcpkg_System.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <Windows.h>
+
+namespace vcpkg { namespace DiskBudget
+{
+    static const std::vector<std::string> DOWNLOAD_SUFFIXES = {".verified", ".part"};
+    static const std::string PACKAGE_SUFFIX = ".pack";
+
+    static bool ends_with(const std::string& s, const std::string& suffix)
+    {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // The entry path belongs to: "<downloads|buildtrees|packages>/<name>", without the suffixes of the files that go
+    // with a distfile or of a package archive
+    static std::string entry_name(const fs::path& path)
+    {
+        const std::string area = path.parent_path().filename().string();
+        std::string name = path.filename().string();
+        if (area == "downloads")
+        {
+            for (const std::string& suffix : DOWNLOAD_SUFFIXES)
+            {
+                if (ends_with(name, suffix))
+                {
+                    name.resize(name.size() - suffix.size());
+                    break;
+                }
+            }
+        }
+        else if (area == "packages" && ends_with(name, PACKAGE_SUFFIX))
+        {
+            name.resize(name.size() - PACKAGE_SUFFIX.size());
+        }
+        return area + "/" + name;
+    }
+
+    static long long now()
+    {
+        return std::chrono::system_clock::now().time_since_epoch().count();
+    }
+
+    // The latest access of each entry; later lines win
+    static std::unordered_map<std::string, long long> read_access_log(const vcpkg_paths& paths)
+    {
+        std::unordered_map<std::string, long long> accesses;
+        const expected<std::string> contents = Files::get_contents(paths.vcpkg_dir_access_log);
+        const std::string* text = contents.get();
+        if (text == nullptr)
+        {
+            return accesses;
+        }
+
+        size_t pos = 0;
+        while (pos < text->size())
+        {
+            size_t end = text->find('\n', pos);
+            if (end == std::string::npos)
+                end = text->size();
+            const std::string line = text->substr(pos, end - pos);
+            pos = end + 1;
+
+            const size_t space = line.find(' ');
+            if (space == std::string::npos || space + 1 == line.size())
+                continue;
+
+            try
+            {
+                long long& last_access = accesses[line.substr(space + 1)];
+                last_access = std::max(last_access, std::stoll(line.substr(0, space)));
+            }
+            catch (const std::exception&)
+            {
+                // Torn by a concurrent append; skip the line
+            }
+        }
+        return accesses;
+    }
+
+    static void write_access_log(const vcpkg_paths& paths, const std::map<std::string, long long>& accesses)
+    {
+        const fs::path& file = paths.vcpkg_dir_access_log;
+        std::ostringstream os;
+        for (auto&& kv : accesses)
+        {
+            os << kv.second << ' ' << kv.first << '\n';
+        }
+
+        // Accesses appended by other processes meanwhile are lost; their entries fall back to their last write time
+        Files::write_contents_atomically(file, os.str());
+    }
+
+    void record_access(const vcpkg_paths& paths, const std::vector<fs::path>& entries)
+    {
+        static std::mutex log_mutex;
+
+        if (entries.empty())
+        {
+            return;
+        }
+
+        std::string lines;
+        const std::string time = std::to_string(now());
+        for (const fs::path& path : entries)
+        {
+            lines.append(time).append(1, ' ').append(entry_name(path)).append(1, '\n');
+        }
+
+        // One write per call, so that lines from concurrent processes seldom interleave
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::error_code ec;
+        fs::create_directories(paths.vcpkg_dir, ec);
+        std::ofstream os(paths.vcpkg_dir_access_log, std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+        os.write(lines.data(), lines.size());
+    }
+
+    bool parse_size(const std::string& text, uintmax_t& bytes)
+    {
+        static const std::string UNITS = "KMGT";
+
+        size_t parsed = 0;
+        double value;
+        try
+        {
+            value = std::stod(text, &parsed);
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+
+        if (value < 0 || parsed == 0)
+        {
+            return false;
+        }
+
+        std::string unit = text.substr(parsed);
+        if (unit.size() == 2 && (unit[1] == 'B' || unit[1] == 'b'))
+        {
+            unit.resize(1);
+        }
+
+        if (unit.size() == 1)
+        {
+            const size_t exponent = UNITS.find(static_cast<char>(toupper(static_cast<unsigned char>(unit[0]))));
+            if (exponent == std::string::npos)
+            {
+                return false;
+            }
+            for (size_t i = 0; i <= exponent; ++i)
+            {
+                value *= 1024;
+            }
+        }
+        else if (!unit.empty())
+        {
+            return false;
+        }
+
+        bytes = static_cast<uintmax_t>(value);
+        return true;
+    }
+
+    uintmax_t get_budget()
+    {
+        const std::wstring text = System::wdupenv_str(L"VCPKG_DISK_BUDGET");
+        uintmax_t budget = 0;
+        if (!text.empty() && !parse_size(Strings::utf16_to_utf8(text), budget))
+        {
+            System::println(System::color::warning, "Warning: ignoring VCPKG_DISK_BUDGET=%s, which is not a size such as 20G", Strings::utf16_to_utf8(text));
+            return 0;
+        }
+        return budget;
+    }
+
+    pending_plan::pending_plan(const vcpkg_paths& paths, const std::vector<package_spec>& plan)
+    {
+        std::error_code ec;
+        fs::create_directories(paths.vcpkg_dir_plans, ec);
+        m_file = paths.vcpkg_dir_plans / std::to_string(GetCurrentProcessId());
+
+        std::ofstream os(m_file, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        for (const package_spec& spec : plan)
+        {
+            os << to_string(spec) << '\n';
+        }
+    }
+
+    pending_plan::~pending_plan()
+    {
+        std::error_code ec;
+        fs::remove(m_file, ec);
+    }
+
+    static bool is_process_running(const DWORD pid)
+    {
+        const HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+        if (process == nullptr)
+        {
+            return GetLastError() == ERROR_ACCESS_DENIED;
+        }
+
+        DWORD exit_code = 0;
+        const bool running = GetExitCodeProcess(process, &exit_code) && exit_code == STILL_ACTIVE;
+        CloseHandle(process);
+        return running;
+    }
+
+    // The specs planned by running installs; the plans of processes that are gone are removed
+    static std::vector<package_spec> load_pending_plans(const vcpkg_paths& paths)
+    {
+        std::vector<package_spec> specs;
+        std::error_code ec;
+        for (auto it = fs::directory_iterator(paths.vcpkg_dir_plans, ec); !ec && it != fs::directory_iterator(); ++it)
+        {
+            const fs::path& plan_file = it->path();
+            DWORD pid = 0;
+            try
+            {
+                pid = static_cast<DWORD>(std::stoul(plan_file.filename().string()));
+            }
+            catch (const std::exception&)
+            {
+                continue;
+            }
+
+            if (!is_process_running(pid))
+            {
+                std::error_code remove_ec;
+                fs::remove(plan_file, remove_ec);
+                continue;
+            }
+
+            const expected<std::string> contents = Files::get_contents(plan_file);
+            if (contents.get() == nullptr)
+            {
+                continue;
+            }
+
+            std::istringstream lines(*contents.get());
+            std::string line;
+            while (std::getline(lines, line))
+            {
+                const expected<package_spec> spec = package_spec::from_string(line, paths.host_triplet);
+                if (spec.get() != nullptr)
+                {
+                    specs.push_back(*spec.get());
+                }
+            }
+        }
+        return specs;
+    }
+
+    static std::unordered_set<std::string> load_protected_entries(const vcpkg_paths& paths, const StatusParagraphs& status_db)
+    {
+        std::unordered_set<std::string> protected_entries;
+        std::unordered_set<std::string> ports;
+        for (auto&& pgh : status_db)
+        {
+            if (pgh->state == install_state_t::installed)
+            {
+                protected_entries.insert("packages/" + pgh->package.spec.dir());
+                ports.insert(pgh->package.spec.name());
+            }
+        }
+
+        for (const package_spec& spec : load_pending_plans(paths))
+        {
+            protected_entries.insert("packages/" + spec.dir());
+            protected_entries.insert("buildtrees/" + spec.name());
+            ports.insert(spec.name());
+        }
+
+        for (const std::string& port : ports)
+        {
+            const expected<std::string> portfile = Files::get_contents(paths.ports / port / "portfile.cmake");
+            if (portfile.get() == nullptr)
+            {
+                continue;
+            }
+
+            for (const Downloads::distfile& file : Downloads::parse_distfiles(*portfile.get()))
+            {
+                protected_entries.insert("downloads/" + file.filename);
+            }
+        }
+        return protected_entries;
+    }
+
+    static uintmax_t size_on_disk(const fs::path& path)
+    {
+        std::error_code ec;
+        if (!fs::is_directory(path, ec))
+        {
+            const uintmax_t size = fs::file_size(path, ec);
+            return ec ? 0 : size;
+        }
+
+        uintmax_t size = 0;
+        for (auto it = fs::recursive_directory_iterator(path, ec); !ec && it != fs::recursive_directory_iterator(); ++it)
+        {
+            if (fs::is_regular_file(it->status()))
+            {
+                std::error_code size_ec;
+                const uintmax_t file_size = fs::file_size(it->path(), size_ec);
+                size += size_ec ? 0 : file_size;
+            }
+        }
+        return size;
+    }
+
+    std::vector<size_t> select_evictions(const std::vector<entry>& entries, const uintmax_t budget)
+    {
+        uintmax_t total_size = 0;
+        std::vector<size_t> candidates;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            total_size += entries[i].size;
+            if (!entries[i].is_protected)
+            {
+                candidates.push_back(i);
+            }
+        }
+
+        std::stable_sort(candidates.begin(), candidates.end(), [&](const size_t a, const size_t b)
+            {
+                return entries[a].last_access < entries[b].last_access;
+            });
+
+        std::vector<size_t> evictions;
+        for (const size_t i : candidates)
+        {
+            if (total_size <= budget)
+            {
+                break;
+            }
+            evictions.push_back(i);
+            total_size -= entries[i].size;
+        }
+        return evictions;
+    }
+
+    collection collect(const vcpkg_paths& paths, const StatusParagraphs& status_db, const uintmax_t budget, const bool dry_run)
+    {
+        const std::unordered_set<std::string> protected_entries = load_protected_entries(paths, status_db);
+        std::unordered_map<std::string, long long> accesses = read_access_log(paths);
+
+        // Entries in name order, with the files and directories each is made of
+        std::map<std::string, std::vector<fs::path>> files_of;
+        for (const fs::path& area : {paths.downloads, paths.buildtrees, paths.packages})
+        {
+            std::error_code ec;
+            for (auto it = fs::directory_iterator(area, ec); !ec && it != fs::directory_iterator(); ++it)
+            {
+                const bool is_directory = fs::is_directory(it->status());
+                // The directories of downloads/ hold the tools vcpkg acquired and the caches it keeps; only distfiles go.
+                // buildtrees/ holds nothing but the build trees of ports.
+                if ((area == paths.downloads && is_directory) || (area == paths.buildtrees && !is_directory))
+                {
+                    continue;
+                }
+                files_of[entry_name(it->path())].push_back(it->path());
+            }
+        }
+
+        std::vector<entry> entries;
+        std::vector<const std::vector<fs::path>*> entry_files;
+        for (auto&& kv : files_of)
+        {
+            entry e;
+            e.name = kv.first;
+            e.is_protected = protected_entries.find(kv.first) != protected_entries.end();
+            for (const fs::path& path : kv.second)
+            {
+                e.size += size_on_disk(path);
+                std::error_code ec;
+                const auto mtime = fs::last_write_time(path, ec);
+                if (!ec)
+                {
+                    e.last_access = std::max(e.last_access, static_cast<long long>(mtime.time_since_epoch().count()));
+                }
+            }
+            const auto access = accesses.find(kv.first);
+            if (access != accesses.end())
+            {
+                e.last_access = std::max(e.last_access, access->second);
+            }
+            entries.push_back(std::move(e));
+            entry_files.push_back(&kv.second);
+        }
+
+        collection result;
+        for (const entry& e : entries)
+        {
+            result.total_size += e.size;
+        }
+
+        for (const size_t i : select_evictions(entries, budget))
+        {
+            const entry& e = entries[i];
+            if (dry_run)
+            {
+                System::println("Would remove %s (%s)", e.name, BuildResources::format_bytes(e.size));
+                result.evicted_size += e.size;
+                ++result.evicted_count;
+                continue;
+            }
+
+            // Directories are renamed away first, so that one in use is left whole rather than half deleted
+            bool removed = true;
+            for (const fs::path& path : *entry_files[i])
+            {
+                std::error_code ec;
+                if (fs::is_directory(path, ec) ? !Trash::move_to_trash(paths, path) : !fs::remove(path, ec) && fs::exists(path))
+                {
+                    removed = false;
+                }
+            }
+
+            if (!removed)
+            {
+                System::println(System::color::warning, "Could not remove all of %s; some of its files are in use", e.name);
+                continue;
+            }
+
+            System::println("Removed %s (%s)", e.name, BuildResources::format_bytes(e.size));
+            result.evicted_size += e.size;
+            ++result.evicted_count;
+            accesses.erase(e.name);
+        }
+
+        if (!dry_run)
+        {
+            Trash::empty(paths);
+
+            // Keep the log to the entries that are still there
+            std::map<std::string, long long> remaining;
+            for (auto&& kv : accesses)
+            {
+                if (files_of.find(kv.first) != files_of.end())
+                {
+                    remaining.insert(kv);
+                }
+            }
+            write_access_log(paths, remaining);
+        }
+
+        return result;
+    }
+}}
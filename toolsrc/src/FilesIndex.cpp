@@ -0,0 +1,336 @@
+#include "FilesIndex.h"
+#include "Listfile.h"
+#include "vcpkg.h"
+#include "vcpkg_Files.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+
+namespace vcpkg { namespace FilesIndex
+{
+    // Layout: the header line, one line per indexed package, an empty line,
+    // then one "<path>\t<package>" line per listed file in reversed path order
+    static const std::string INDEX_HEADER = "vcpkg-files-index-v1";
+
+    using entry = files_index::entry;
+
+    static int compare_reversed(const char* a_begin, const char* a_end, const char* b_begin, const char* b_end)
+    {
+        while (a_end != a_begin && b_end != b_begin)
+        {
+            --a_end;
+            --b_end;
+            if (*a_end != *b_end)
+            {
+                return *a_end < *b_end ? -1 : 1;
+            }
+        }
+
+        if (a_end != a_begin)
+        {
+            return 1;
+        }
+        return b_end != b_begin ? -1 : 0;
+    }
+
+    static bool entry_less(const entry& a, const entry& b)
+    {
+        const int c = compare_reversed(a.path_begin, a.path_end, b.path_begin, b.path_end);
+        if (c != 0)
+        {
+            return c < 0;
+        }
+        return std::lexicographical_compare(a.package_begin, a.package_end, b.package_begin, b.package_end);
+    }
+
+    static bool package_is(const entry& e, const std::string& package)
+    {
+        return package.size() == static_cast<size_t>(e.package_end - e.package_begin) && package.compare(0, package.size(), e.package_begin, package.size()) == 0;
+    }
+
+    // Appends the "<path>\t<package>" lines of [cur, end) to entries; returns false if a line is malformed
+    static bool parse_entries(const char* cur, const char* const end, std::vector<entry>& entries)
+    {
+        while (cur != end)
+        {
+            const char* line_end = std::find(cur, end, '\n');
+            const char* tab = std::find(cur, line_end, '\t');
+            if (tab == line_end)
+            {
+                return false;
+            }
+
+            entries.push_back({cur, tab, tab + 1, line_end});
+            cur = line_end == end ? end : line_end + 1;
+        }
+
+        return true;
+    }
+
+    static bool parse_index(const std::string& text, std::set<std::string>& packages, std::vector<entry>& entries)
+    {
+        const char* cur = text.data();
+        const char* const end = text.data() + text.size();
+
+        auto next_line = [&]() -> std::string
+        {
+            const char* line_end = std::find(cur, end, '\n');
+            std::string line(cur, line_end);
+            cur = line_end == end ? end : line_end + 1;
+            return line;
+        };
+
+        if (next_line() != INDEX_HEADER)
+        {
+            return false;
+        }
+
+        for (std::string package = next_line(); !package.empty(); package = next_line())
+        {
+            packages.insert(std::move(package));
+        }
+
+        return parse_entries(cur, end, entries);
+    }
+
+    // entries must already be sorted
+    static std::string serialize_index(const std::set<std::string>& packages, const std::vector<entry>& entries)
+    {
+        std::string text = INDEX_HEADER + "\n";
+        for (const std::string& package : packages)
+        {
+            text.append(package).push_back('\n');
+        }
+        text.push_back('\n');
+
+        for (const entry& e : entries)
+        {
+            text.append(e.path_begin, e.path_end).push_back('\t');
+            text.append(e.package_begin, e.package_end).push_back('\n');
+        }
+
+        return text;
+    }
+
+    static void write_index_file(const vcpkg_paths& paths, const std::string& text)
+    {
+        // Losing the index only costs a rebuild from the listfiles, so failures are not reported
+        std::error_code ec;
+        const fs::path tmp_file = paths.vcpkg_dir / "files-index.tmp";
+        {
+            std::ofstream os(tmp_file, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+            os.write(text.data(), text.size());
+            os.flush();
+            if (os.fail())
+            {
+                os.close();
+                fs::remove(tmp_file, ec);
+                return;
+            }
+        }
+
+        fs::remove(paths.vcpkg_dir_files_index, ec);
+        fs::rename(tmp_file, paths.vcpkg_dir_files_index, ec);
+    }
+
+    static expected<std::string> read_index_file(const vcpkg_paths& paths)
+    {
+        const Files::file_lock lock = lock_status_database(paths, Files::file_lock::mode::shared);
+        return Files::get_contents(paths.vcpkg_dir_files_index);
+    }
+
+    static void append_listed_paths(std::string& lines, const std::string& package, const std::vector<std::string>& listed_paths)
+    {
+        for (const std::string& path : listed_paths)
+        {
+            lines.append(path).push_back('\t');
+            lines.append(package).push_back('\n');
+        }
+    }
+
+    files_index files_index::load(const vcpkg_paths& paths, const std::set<std::string>& installed_names,
+                                  const std::function<std::vector<std::pair<std::string, fs::path>>()>& installed_listfiles)
+    {
+        files_index index;
+        expected<std::string> contents = read_index_file(paths);
+        if (std::string* text = contents.get())
+        {
+            index.text = std::make_unique<std::string>(std::move(*text));
+            std::set<std::string> packages;
+            if (parse_index(*index.text, packages, index.entries) && packages == installed_names)
+            {
+                return index;
+            }
+            index.entries.clear();
+        }
+
+        std::string lines;
+        for (auto&& installed : installed_listfiles())
+        {
+            std::vector<std::string> listed_paths;
+            Listfile::for_each_entry(installed.second, [&](const std::string& path, Listfile::entry_type)
+            {
+                listed_paths.push_back(path);
+            });
+
+            append_listed_paths(lines, installed.first, listed_paths);
+        }
+
+        std::vector<entry> entries;
+        parse_entries(lines.data(), lines.data() + lines.size(), entries);
+        std::sort(entries.begin(), entries.end(), entry_less);
+
+        index.text = std::make_unique<std::string>(serialize_index(installed_names, entries));
+        {
+            // Should a package be installed meanwhile, the index it wrote is replaced here, but its name is then
+            // missing from the packages of the index and the next load rebuilds it
+            const Files::file_lock lock = lock_status_database(paths, Files::file_lock::mode::exclusive);
+            write_index_file(paths, *index.text);
+        }
+
+        std::set<std::string> packages;
+        parse_index(*index.text, packages, index.entries);
+        return index;
+    }
+
+    files_index files_index::load(const vcpkg_paths& paths, const StatusParagraphs& status_db)
+    {
+        std::vector<std::pair<std::string, fs::path>> installed;
+        std::set<std::string> installed_names;
+        for (auto&& pgh : status_db)
+        {
+            if (pgh->state == install_state_t::installed)
+            {
+                installed.emplace_back(pgh->package.displayname(), paths.listfile_path(pgh->package));
+                installed_names.insert(pgh->package.displayname());
+            }
+        }
+
+        return load(paths, installed_names, [&]() { return installed; });
+    }
+
+    files_index files_index::load(const vcpkg_paths& paths, const status_snapshot& status_db)
+    {
+        std::set<std::string> installed_names;
+        for (size_t i = 0; i < status_db.size(); ++i)
+        {
+            if (status_db[i].state == install_state_t::installed)
+            {
+                installed_names.insert(status_db[i].displayname);
+            }
+        }
+
+        // Only decode the paragraphs (for their listfile names) when the index is out of date
+        return load(paths, installed_names, [&]()
+                          {
+                              std::vector<std::pair<std::string, fs::path>> installed;
+                              for (size_t i = 0; i < status_db.size(); ++i)
+                              {
+                                  if (status_db[i].state == install_state_t::installed)
+                                  {
+                                      installed.emplace_back(status_db[i].displayname, paths.listfile_path(status_db.paragraph(i).package));
+                                  }
+                              }
+                              return installed;
+                          });
+    }
+
+    static owned_file to_owned_file(const entry& e)
+    {
+        return {std::string(e.package_begin, e.package_end), std::string(e.path_begin, e.path_end)};
+    }
+
+    std::vector<owned_file> files_index::find_suffix(const std::string& suffix) const
+    {
+        // Compares only the last suffix.size() characters, which keeps the entries partitioned around the matches
+        auto compare_suffix = [&](const entry& e)
+        {
+            const size_t path_size = static_cast<size_t>(e.path_end - e.path_begin);
+            const char* path_begin = path_size > suffix.size() ? e.path_end - suffix.size() : e.path_begin;
+            return compare_reversed(path_begin, e.path_end, suffix.data(), suffix.data() + suffix.size());
+        };
+
+        auto first = std::partition_point(entries.begin(), entries.end(), [&](const entry& e) { return compare_suffix(e) < 0; });
+        auto last = std::partition_point(first, entries.end(), [&](const entry& e) { return compare_suffix(e) == 0; });
+
+        std::vector<owned_file> output;
+        std::transform(first, last, std::back_inserter(output), to_owned_file);
+        return output;
+    }
+
+    std::vector<owned_file> files_index::find_exact(const std::string& path) const
+    {
+        std::vector<owned_file> output = find_suffix(path);
+        output.erase(std::remove_if(output.begin(), output.end(), [&](const owned_file& f) { return f.path != path; }), output.end());
+        return output;
+    }
+
+    std::vector<owned_file> files_index::find_substring(const std::string& substring) const
+    {
+        std::vector<owned_file> output;
+        const Strings::case_insensitive_ascii_searcher searcher(substring);
+        for (const entry& e : entries)
+        {
+            if (searcher.find(e.path_begin, e.path_end) != e.path_end || substring.empty())
+            {
+                output.push_back(to_owned_file(e));
+            }
+        }
+        return output;
+    }
+
+    void add_package_files(const vcpkg_paths& paths, const BinaryParagraph& pgh, const std::vector<std::string>& listed_paths)
+    {
+        const Files::file_lock lock = lock_status_database(paths, Files::file_lock::mode::exclusive);
+        expected<std::string> contents = Files::get_contents(paths.vcpkg_dir_files_index);
+        const std::string* text = contents.get();
+        std::set<std::string> packages;
+        std::vector<entry> entries;
+        if (text == nullptr || !parse_index(*text, packages, entries))
+        {
+            return;
+        }
+
+        const std::string package = pgh.displayname();
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const entry& e) { return package_is(e, package); }), entries.end());
+        packages.insert(package);
+
+        std::string lines;
+        append_listed_paths(lines, package, listed_paths);
+        const size_t old_size = entries.size();
+        parse_entries(lines.data(), lines.data() + lines.size(), entries);
+        std::sort(entries.begin() + old_size, entries.end(), entry_less);
+        std::inplace_merge(entries.begin(), entries.begin() + old_size, entries.end(), entry_less);
+
+        write_index_file(paths, serialize_index(packages, entries));
+    }
+
+    void remove_package_files(const vcpkg_paths& paths, const std::vector<const BinaryParagraph*>& pghs)
+    {
+        const Files::file_lock lock = lock_status_database(paths, Files::file_lock::mode::exclusive);
+        expected<std::string> contents = Files::get_contents(paths.vcpkg_dir_files_index);
+        const std::string* text = contents.get();
+        std::set<std::string> packages;
+        std::vector<entry> entries;
+        if (text == nullptr || !parse_index(*text, packages, entries))
+        {
+            return;
+        }
+
+        std::set<std::string> removed;
+        for (const BinaryParagraph* pgh : pghs)
+        {
+            removed.insert(pgh->displayname());
+            packages.erase(pgh->displayname());
+        }
+
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const entry& e)
+                                     {
+                                         return removed.find(std::string(e.package_begin, e.package_end)) != removed.end();
+                                     }), entries.end());
+
+        write_index_file(paths, serialize_index(packages, entries));
+    }
+}}
@@ -0,0 +1,111 @@
+#include "InstallLock.h"
+#include "Paragraphs.h"
+#include "vcpkglib_helpers.h"
+#include "vcpkg_Checks.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include <fstream>
+
+namespace vcpkg { namespace InstallLock
+{
+    // Bump when the layout changes; a lock file of another version is rejected rather than guessed at
+    static const std::string LOCK_VERSION = "1";
+
+    namespace LockField
+    {
+        static const std::string LOCK_VERSION = "Install-Lock-Version";
+        static const std::string PACKAGE = "Package";
+        static const std::string ABI = "Abi";
+        static const std::string DEPENDS = "Depends";
+    }
+
+    void write(const fs::path& lock_file, const std::vector<package_spec>& plan, const Graphs::Graph<package_spec>& dependency_graph,
+               const std::unordered_map<package_spec, std::string>& abis)
+    {
+        const std::unordered_map<package_spec, std::vector<package_spec>>& dependencies = dependency_graph.adjacency_list();
+
+        std::string contents = LockField::LOCK_VERSION + ": " + LOCK_VERSION + "\n";
+        for (const package_spec& spec : plan)
+        {
+            contents.append("\n");
+            contents.append(Strings::format("%s: %s\n", LockField::PACKAGE, to_string(spec)));
+            contents.append(Strings::format("%s: %s\n", LockField::ABI, abis.at(spec)));
+
+            const std::vector<package_spec>& depends = dependencies.at(spec);
+            if (!depends.empty())
+            {
+                std::string line = to_string(depends[0]);
+                for (size_t i = 1; i < depends.size(); ++i)
+                {
+                    line.append(", ").append(to_string(depends[i]));
+                }
+                contents.append(Strings::format("%s: %s\n", LockField::DEPENDS, line));
+            }
+        }
+
+        std::ofstream os(lock_file, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        os << contents;
+        os.flush();
+        Checks::check_exit(!os.fail(), "Error: could not write the lock file %s", lock_file.generic_string());
+    }
+
+    static package_spec parse_spec(const fs::path& lock_file, const std::string& spec_as_string)
+    {
+        // Every spec is written with its triplet, so the default never applies
+        const expected<package_spec> spec = package_spec::from_string(spec_as_string, triplet::X86_WINDOWS);
+        Checks::check_exit(spec.get() != nullptr && spec_as_string.find(':') != std::string::npos,
+                           "Error: %s lists an invalid package: %s", lock_file.generic_string(), spec_as_string);
+        return *spec.get();
+    }
+
+    locked_plan read(const fs::path& lock_file)
+    {
+        const expected<std::string> contents = Files::get_contents(lock_file);
+        Checks::check_exit(contents.get() != nullptr, "Error: could not read the lock file %s", lock_file.generic_string());
+
+        std::vector<std::unordered_map<std::string, std::string>> pghs;
+        try
+        {
+            pghs = Paragraphs::parse_paragraphs(*contents.get());
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+        Checks::check_exit(!pghs.empty() && details::optional_field(pghs[0], LockField::LOCK_VERSION) == LOCK_VERSION,
+                           "Error: %s is not a lock file written by this version of vcpkg", lock_file.generic_string());
+
+        locked_plan locked;
+        for (size_t i = 1; i < pghs.size(); ++i)
+        {
+            const package_spec spec = parse_spec(lock_file, details::required_field(pghs[i], LockField::PACKAGE));
+            const std::string abi = details::required_field(pghs[i], LockField::ABI);
+            Checks::check_exit(!abi.empty() && locked.abis.emplace(spec, abi).second, "Error: %s lists %s twice or without its ABI hash", lock_file.generic_string(), spec);
+
+            locked.plan.push_back(spec);
+            locked.dependency_graph.add_vertex(spec);
+            const std::string depends = details::optional_field(pghs[i], LockField::DEPENDS);
+            size_t pos = 0;
+            while (pos < depends.size())
+            {
+                size_t end = depends.find(',', pos);
+                if (end == std::string::npos)
+                    end = depends.size();
+                const size_t first = depends.find_first_not_of(' ', pos);
+                const size_t last = depends.find_last_not_of(' ', end - 1);
+                pos = end + 1;
+                if (first == std::string::npos || first >= end)
+                    continue;
+                const std::string dependency = depends.substr(first, last - first + 1);
+
+                // The plan is in build order: what a package depends on comes before it
+                const package_spec dependency_spec = parse_spec(lock_file, dependency);
+                Checks::check_exit(locked.abis.find(dependency_spec) != locked.abis.end(), "Error: %s lists %s after %s, which depends on it",
+                                   lock_file.generic_string(), dependency_spec, spec);
+                locked.dependency_graph.add_edge(spec, dependency_spec);
+            }
+        }
+
+        Checks::check_exit(!locked.plan.empty(), "Error: the lock file %s holds no package", lock_file.generic_string());
+        return locked;
+    }
+}}
@@ -0,0 +1,131 @@
+#include "Listfile.h"
+#include <algorithm>
+#include <cstring>
+#include "vcpkg_Files.h"
+
+namespace vcpkg { namespace Listfile
+{
+    // A text listfile starts with its triplet, which never starts like this
+    static const char MAGIC[8] = {'V', 'C', 'P', 'K', 'G', 'L', 'S', '1'};
+
+    static const char TYPE_FILE = 'f';
+    static const char TYPE_DIRECTORY = 'd';
+
+    static void append_varint(std::string& out, size_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static bool read_varint(const char*& pos, const char* end, size_t& value)
+    {
+        value = 0;
+        for (int shift = 0; pos != end && shift < 64; shift += 7)
+        {
+            const uint8_t byte = static_cast<uint8_t>(*pos++);
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool write(const fs::path& listfile, const std::vector<listed_entry>& entries)
+    {
+        // Entry: shared prefix length, suffix length, type, suffix
+        std::string out(MAGIC, sizeof(MAGIC));
+        const std::string* previous = nullptr;
+        for (const listed_entry& entry : entries)
+        {
+            size_t shared = 0;
+            if (previous != nullptr)
+            {
+                const size_t limit = std::min(previous->size(), entry.path.size());
+                while (shared < limit && (*previous)[shared] == entry.path[shared])
+                {
+                    ++shared;
+                }
+            }
+
+            append_varint(out, shared);
+            append_varint(out, entry.path.size() - shared);
+            out.push_back(entry.type == entry_type::directory ? TYPE_DIRECTORY : TYPE_FILE);
+            out.append(entry.path, shared, std::string::npos);
+            previous = &entry.path;
+        }
+
+        return !Files::write_contents_atomically(listfile, out);
+    }
+
+    static bool for_each_compact_entry(const char* pos, const char* end, const std::function<void(const std::string& path, entry_type type)>& f)
+    {
+        std::string path;
+        while (pos != end)
+        {
+            size_t shared;
+            size_t suffix_size;
+            if (!read_varint(pos, end, shared) || !read_varint(pos, end, suffix_size) || shared > path.size()
+                || pos == end || static_cast<size_t>(end - pos - 1) < suffix_size)
+            {
+                return false;
+            }
+
+            const entry_type type = *pos++ == TYPE_DIRECTORY ? entry_type::directory : entry_type::file;
+            path.resize(shared);
+            path.append(pos, suffix_size);
+            pos += suffix_size;
+            f(path, type);
+        }
+        return true;
+    }
+
+    static void for_each_text_entry(const char* pos, const char* end, const std::function<void(const std::string& path, entry_type type)>& f)
+    {
+        std::string path;
+        while (pos != end)
+        {
+            const char* line_end = static_cast<const char*>(memchr(pos, '\n', end - pos));
+            if (line_end == nullptr)
+            {
+                line_end = end;
+            }
+
+            path.assign(pos, line_end);
+            pos = line_end == end ? end : line_end + 1;
+            if (!path.empty() && path.back() == '\r')
+            {
+                path.pop_back();
+            }
+            if (!path.empty())
+            {
+                f(path, entry_type::unknown);
+            }
+        }
+    }
+
+    bool for_each_entry(const fs::path& listfile, const std::function<void(const std::string& path, entry_type type)>& f)
+    {
+        const expected<Files::mapped_file> mapped = Files::mapped_file::open(listfile);
+        const Files::mapped_file* file = mapped.get();
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        const char* begin = file->data();
+        const char* end = begin + file->size();
+        if (file->size() >= sizeof(MAGIC) && memcmp(begin, MAGIC, sizeof(MAGIC)) == 0)
+        {
+            return for_each_compact_entry(begin + sizeof(MAGIC), end, f);
+        }
+
+        for_each_text_entry(begin, end, f);
+        return true;
+    }
+}}
@@ -0,0 +1,166 @@
+#include "MSBuildProps.h"
+#include "Listfile.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <unordered_set>
+
+namespace vcpkg { namespace MSBuildProps
+{
+    static fs::path props_dir(const vcpkg_paths& paths, const triplet& t)
+    {
+        return paths.vcpkg_dir_msbuild / t.canonical_name();
+    }
+
+    // Relative to installed/<triplet>, with backslashes as $(VcpkgRoot) has them
+    struct package_libs
+    {
+        std::vector<std::string> debug;
+        std::vector<std::string> release;
+    };
+
+    // Only the libs directly in lib/ and debug/lib/: those in subdirectories such as lib/manual-link are linked by hand
+    static package_libs read_libs(const vcpkg_paths& paths, const BinaryParagraph& pgh)
+    {
+        const std::string prefix = pgh.spec.target_triplet().canonical_name() + "/";
+        package_libs libs;
+        Listfile::for_each_entry(paths.listfile_path(pgh), [&](const std::string& path, const Listfile::entry_type type)
+            {
+                if (type == Listfile::entry_type::directory || path.compare(0, prefix.size(), prefix) != 0)
+                {
+                    return;
+                }
+
+                std::string relative = path.substr(prefix.size());
+                const size_t separator = relative.rfind('/');
+                const std::string dir = separator == std::string::npos ? std::string() : relative.substr(0, separator);
+                const std::string lowercase = Strings::ascii_to_lowercase(relative);
+                if ((dir != "lib" && dir != "debug/lib") || lowercase.size() < 4 || lowercase.compare(lowercase.size() - 4, 4, ".lib") != 0)
+                {
+                    return;
+                }
+
+                std::replace(relative.begin(), relative.end(), '/', '\\');
+                (dir == "lib" ? libs.release : libs.debug).push_back(std::move(relative));
+            });
+        return libs;
+    }
+
+    // pgh and the installed packages it depends on, each before the packages it depends on, as static libs are linked
+    static std::vector<const BinaryParagraph*> dependency_closure(const BinaryParagraph& pgh, const StatusParagraphs& status_db)
+    {
+        std::vector<const BinaryParagraph*> closure;
+        std::unordered_set<std::string> visited;
+        std::function<void(const BinaryParagraph&)> visit = [&](const BinaryParagraph& p)
+            {
+                if (!visited.insert(p.spec.name()).second)
+                {
+                    return;
+                }
+
+                for (const std::string& dependency : p.depends)
+                {
+                    const auto it = status_db.find(dependency, p.spec.target_triplet());
+                    if (it != status_db.end() && (*it)->state == install_state_t::installed)
+                    {
+                        visit((*it)->package);
+                    }
+                }
+                closure.push_back(&p);
+            };
+        visit(pgh);
+
+        // Dependencies were added before their dependents
+        std::reverse(closure.begin(), closure.end());
+        return closure;
+    }
+
+    static std::string make_props_file(const BinaryParagraph& pgh, const std::string& debug_libs, const std::string& release_libs)
+    {
+        return Strings::format(R"###(<Project ToolsVersion="4.0" xmlns="http://schemas.microsoft.com/developer/msbuild/2003">
+  <!-- Written by vcpkg: the libs of %s and of the packages it depends on -->
+  <PropertyGroup>
+    <VcpkgLinkDeclaredPackages>true</VcpkgLinkDeclaredPackages>
+  </PropertyGroup>
+  <ItemDefinitionGroup Condition="'$(VcpkgEnabled)' == 'true'">
+    <Link>
+      <AdditionalDependencies Condition="'$(VcpkgConfiguration)' == 'Debug'">%s%%(AdditionalDependencies)</AdditionalDependencies>
+      <AdditionalDependencies Condition="'$(VcpkgConfiguration)' == 'Release'">%s%%(AdditionalDependencies)</AdditionalDependencies>
+    </Link>
+  </ItemDefinitionGroup>
+</Project>
+)###", pgh.displayname(), debug_libs, release_libs);
+    }
+
+    // Returns the file written
+    static fs::path write_package(const vcpkg_paths& paths, const BinaryParagraph& pgh, const StatusParagraphs& status_db)
+    {
+        std::string debug_libs;
+        std::string release_libs;
+        for (const BinaryParagraph* p : dependency_closure(pgh, status_db))
+        {
+            const package_libs libs = read_libs(paths, *p);
+            for (const std::string& lib : libs.debug)
+            {
+                debug_libs.append("$(VcpkgRoot)").append(lib).push_back(';');
+            }
+            for (const std::string& lib : libs.release)
+            {
+                release_libs.append("$(VcpkgRoot)").append(lib).push_back(';');
+            }
+        }
+
+        // Builds may be reading the file: it is replaced as a whole
+        const fs::path props_file = props_dir(paths, pgh.spec.target_triplet()) / (pgh.spec.name() + ".props");
+        Files::write_contents_atomically(props_file, make_props_file(pgh, debug_libs, release_libs));
+        return props_file;
+    }
+
+    void write_all(const vcpkg_paths& paths, const StatusParagraphs& status_db)
+    {
+        std::error_code ec;
+        fs::create_directories(paths.vcpkg_dir_msbuild, ec);
+
+        std::set<fs::path> written;
+        for (const std::unique_ptr<StatusParagraph>& pkg : status_db)
+        {
+            if (pkg->state == install_state_t::installed)
+            {
+                written.insert(write_package(paths, pkg->package, status_db));
+            }
+        }
+
+        std::vector<fs::path> stale;
+        for (auto dir = fs::directory_iterator(paths.vcpkg_dir_msbuild, ec); !ec && dir != fs::directory_iterator(); dir.increment(ec))
+        {
+            std::error_code file_ec;
+            for (auto file = fs::directory_iterator(dir->path(), file_ec); !file_ec && file != fs::directory_iterator(); file.increment(file_ec))
+            {
+                if (written.find(file->path()) == written.end())
+                {
+                    stale.push_back(file->path());
+                }
+            }
+        }
+        for (const fs::path& file : stale)
+        {
+            fs::remove(file, ec);
+        }
+    }
+
+    void add_package(const vcpkg_paths& paths, const BinaryParagraph& pgh, const StatusParagraphs& status_db)
+    {
+        if (fs::exists(paths.vcpkg_dir_msbuild))
+        {
+            write_package(paths, pgh, status_db);
+        }
+    }
+
+    void remove_package(const vcpkg_paths& paths, const BinaryParagraph& pgh)
+    {
+        std::error_code ec;
+        fs::remove(props_dir(paths, pgh.spec.target_triplet()) / (pgh.spec.name() + ".props"), ec);
+    }
+}}
@@ -0,0 +1,271 @@
+#include "PackageArchive.h"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include "vcpkg_Gzip.h"
+#include "vcpkg_Parallel.h"
+#include "vcpkg_System.h"
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+namespace vcpkg { namespace PackageArchive
+{
+    // Followed by the index offset and the entry count in the last 24 bytes of an archive
+    static const char MAGIC[8] = {'V', 'C', 'P', 'K', 'G', 'P', 'K', '1'};
+    static constexpr size_t TRAILER_SIZE = 8 + 8 + sizeof(MAGIC);
+    static constexpr size_t ENTRY_HEADER_SIZE = 1 + 1 + 2 + 4 + 8 + 8 + 8;
+
+    static void append_le(std::string& out, const uint64_t value, const int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+        {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    static uint64_t read_le(const char* data, const int bytes)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+        {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    bool is_enabled()
+    {
+        static const bool enabled = !System::wdupenv_str(L"VCPKG_COMPRESS_PACKAGES").empty();
+        return enabled;
+    }
+
+    fs::path archive_path(const vcpkg_paths& paths, const package_spec& spec)
+    {
+        return paths.packages / (spec.dir() + ".pack");
+    }
+
+    bool pack(const fs::path& package_dir, const fs::path& archive)
+    {
+        const size_t prefix_length = package_dir.generic_u8string().size() + 1;
+        std::vector<entry> entries;
+        std::vector<fs::path> sources; // Of each entry; empty for directories
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(package_dir, ec); !ec && it != fs::recursive_directory_iterator(); ++it)
+        {
+            const fs::file_status status = it->status(ec);
+            if (ec || !(fs::is_directory(status) || fs::is_regular_file(status)))
+                return false;
+            entries.push_back({it->path().generic_u8string().substr(prefix_length), fs::is_directory(status), 0, 0, 0, 0, 0});
+            sources.push_back(fs::is_directory(status) ? fs::path() : it->path());
+        }
+        if (ec)
+            return false;
+
+        // Written next to the final location, then renamed, so that readers never observe a partial archive
+        const fs::path tmp_archive = archive.parent_path() / Strings::format("%s.%d.tmp", archive.filename().u8string(), static_cast<int>(GetCurrentProcessId()));
+        std::ofstream out(tmp_archive, std::ios_base::binary | std::ios_base::trunc);
+
+        // Files are compressed concurrently and appended in the order they finish; the index says where each one went
+        std::mutex out_mutex;
+        uint64_t written = 0; // Guarded by out_mutex
+        std::atomic<bool> failed(!out);
+        Parallel::for_each_index(entries.size(), [&](const size_t i)
+            {
+                if (entries[i].is_directory || failed)
+                    return;
+
+                const expected<std::string> contents = Files::get_contents(sources[i]);
+                const std::string* data = contents.get();
+                if (data == nullptr)
+                {
+                    failed = true;
+                    return;
+                }
+
+                std::string deflated = Gzip::deflate(*data);
+                entry& e = entries[i];
+                e.crc = Gzip::crc32(*data);
+                e.size = data->size();
+                e.method = deflated.size() < data->size() ? 1 : 0;
+                const std::string& stored = e.method == 1 ? deflated : *data;
+                e.stored_size = stored.size();
+
+                std::lock_guard<std::mutex> lock(out_mutex);
+                e.offset = written;
+                out.write(stored.data(), stored.size());
+                written += stored.size();
+            });
+
+        std::string index;
+        for (const entry& e : entries)
+        {
+            index.push_back(e.is_directory ? '\0' : '\1');
+            index.push_back(static_cast<char>(e.method));
+            append_le(index, e.path.size(), 2);
+            append_le(index, e.crc, 4);
+            append_le(index, e.offset, 8);
+            append_le(index, e.stored_size, 8);
+            append_le(index, e.size, 8);
+            index.append(e.path);
+        }
+        append_le(index, written, 8);
+        append_le(index, entries.size(), 8);
+        index.append(MAGIC, sizeof(MAGIC));
+        out.write(index.data(), index.size());
+        out.close();
+
+        if (failed || out.fail())
+        {
+            fs::remove(tmp_archive, ec);
+            return false;
+        }
+
+        fs::remove(archive, ec);
+        fs::rename(tmp_archive, archive, ec);
+        if (ec)
+        {
+            fs::remove(tmp_archive, ec);
+            return false;
+        }
+        return true;
+    }
+
+    expected<reader> reader::open(const fs::path& archive)
+    {
+        expected<Files::mapped_file> file = Files::mapped_file::open(archive);
+        if (!file.get())
+        {
+            return file.error_code();
+        }
+
+        reader r;
+        r.m_file = std::move(file).get_or_throw();
+        const char* const data = r.m_file.data();
+        const size_t size = r.m_file.size();
+        if (size < TRAILER_SIZE || memcmp(data + size - sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0)
+        {
+            return std::errc::invalid_argument;
+        }
+
+        const uint64_t index_offset = read_le(data + size - TRAILER_SIZE, 8);
+        const uint64_t entry_count = read_le(data + size - TRAILER_SIZE + 8, 8);
+        const size_t index_end = size - TRAILER_SIZE;
+        if (index_offset > index_end)
+        {
+            return std::errc::invalid_argument;
+        }
+
+        size_t pos = static_cast<size_t>(index_offset);
+        for (uint64_t i = 0; i < entry_count; ++i)
+        {
+            if (index_end - pos < ENTRY_HEADER_SIZE)
+            {
+                return std::errc::invalid_argument;
+            }
+
+            entry e;
+            e.is_directory = data[pos] == '\0';
+            e.method = static_cast<uint8_t>(data[pos + 1]);
+            const size_t path_length = static_cast<size_t>(read_le(data + pos + 2, 2));
+            e.crc = static_cast<uint32_t>(read_le(data + pos + 4, 4));
+            e.offset = read_le(data + pos + 8, 8);
+            e.stored_size = read_le(data + pos + 16, 8);
+            e.size = read_le(data + pos + 24, 8);
+            pos += ENTRY_HEADER_SIZE;
+            if (index_end - pos < path_length || e.offset > index_offset || e.stored_size > index_offset - e.offset)
+            {
+                return std::errc::invalid_argument;
+            }
+            e.path.assign(data + pos, path_length);
+            pos += path_length;
+            r.m_entries.push_back(std::move(e));
+        }
+
+        return std::move(r);
+    }
+
+    const entry* reader::find(const std::string& path) const
+    {
+        for (const entry& e : this->m_entries)
+        {
+            if (!e.is_directory && e.path == path)
+                return &e;
+        }
+        return nullptr;
+    }
+
+    bool reader::read(const entry& e, std::string& out) const
+    {
+        const char* const stored = this->m_file.data() + e.offset;
+        const size_t stored_size = static_cast<size_t>(e.stored_size);
+        if (e.method == 0)
+        {
+            out.assign(stored, stored_size);
+        }
+        else
+        {
+            out.reserve(static_cast<size_t>(e.size));
+            if (e.method != 1 || !Gzip::inflate(stored, stored_size, out))
+                return false;
+        }
+        return out.size() == e.size && Gzip::crc32(out) == e.crc;
+    }
+
+    expected<std::string> read_file(const fs::path& archive, const std::string& path)
+    {
+        const expected<reader> r = reader::open(archive);
+        const reader* opened = r.get();
+        if (opened == nullptr)
+        {
+            return r.error_code();
+        }
+
+        const entry* e = opened->find(path);
+        if (e == nullptr)
+        {
+            return std::errc::no_such_file_or_directory;
+        }
+
+        std::string contents;
+        if (!opened->read(*e, contents))
+        {
+            return std::errc::invalid_argument;
+        }
+        return std::move(contents);
+    }
+
+    expected<std::string> read_control_file(const vcpkg_paths& paths, const package_spec& spec)
+    {
+        expected<std::string> contents = Files::get_contents(paths.package_dir(spec) / "CONTROL");
+        if (contents.get() != nullptr)
+        {
+            return contents;
+        }
+
+        const fs::path archive = archive_path(paths, spec);
+        if (!fs::exists(archive))
+        {
+            return contents;
+        }
+        return read_file(archive, "CONTROL");
+    }
+
+    void compress_package(const vcpkg_paths& paths, const package_spec& spec)
+    {
+        if (!is_enabled())
+        {
+            return;
+        }
+
+        const fs::path package_dir = paths.package_dir(spec);
+        if (!pack(package_dir, archive_path(paths, spec)))
+        {
+            System::println(System::color::warning, "Warning: failed to compress %s; keeping it as a directory", package_dir.generic_string());
+            return;
+        }
+
+        std::error_code ec;
+        fs::remove_all(package_dir, ec);
+    }
+}}
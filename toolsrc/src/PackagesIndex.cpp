@@ -0,0 +1,279 @@
+#include "PackagesIndex.h"
+#include "PackageArchive.h"
+#include "Paragraphs.h"
+#include "vcpkglib_helpers.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include <fstream>
+#include <sstream>
+
+namespace vcpkg { namespace PackagesIndex
+{
+    // Bump when the layout of an index entry changes; an index with another version is discarded
+    static const std::string INDEX_VERSION = "1";
+
+    namespace IndexField
+    {
+        static const std::string INDEX_VERSION = "Packages-Index-Version";
+        static const std::string PACKAGE_DIR = "Package-Dir";
+        static const std::string CONTROL_SIZE = "Control-Size";
+        static const std::string CONTROL_MTIME = "Control-Mtime";
+    }
+
+    using index_entry = packages_index::entry;
+
+    // Serializes writers of the index, in this process and others
+    static Files::file_lock lock_index(const vcpkg_paths& paths)
+    {
+        std::error_code ec;
+        fs::create_directories(paths.vcpkg_dir, ec);
+        return Files::file_lock(paths.vcpkg_dir_packages_index_lock, Files::file_lock::mode::exclusive);
+    }
+
+    // The file vouching for the CONTROL file of a package: the CONTROL file itself, or the archive it is kept in
+    static fs::path control_stamp_file(const fs::path& package_dir, const fs::path& archive)
+    {
+        const fs::path control_file = package_dir / "CONTROL";
+        return fs::exists(control_file) ? control_file : archive;
+    }
+
+    static bool read_stamp(const fs::path& file, index_entry& entry)
+    {
+        std::error_code ec;
+        const uintmax_t size = fs::file_size(file, ec);
+        if (ec)
+        {
+            return false;
+        }
+        const auto mtime = fs::last_write_time(file, ec);
+        if (ec)
+        {
+            return false;
+        }
+
+        entry.control_size = std::to_string(size);
+        entry.control_mtime = std::to_string(mtime.time_since_epoch().count());
+        return true;
+    }
+
+    // recorded_count receives the number of entries in the file, which is larger than that of the map returned when
+    // a package was recorded more than once
+    static std::map<std::string, index_entry> read_index(const fs::path& index_file, size_t& recorded_count)
+    {
+        std::map<std::string, index_entry> entries;
+        recorded_count = 0;
+
+        const expected<std::string> contents = Files::get_contents(index_file);
+        const std::string* text = contents.get();
+        if (text == nullptr)
+        {
+            return entries;
+        }
+
+        try
+        {
+            std::vector<std::unordered_map<std::string, std::string>> pghs = Paragraphs::parse_paragraphs(*text);
+            if (pghs.empty() || details::optional_field(pghs[0], IndexField::INDEX_VERSION) != INDEX_VERSION)
+            {
+                return entries;
+            }
+
+            for (size_t i = 1; i < pghs.size(); ++i)
+            {
+                std::unordered_map<std::string, std::string>& fields = pghs[i];
+
+                const std::string package_dir = details::remove_optional_field(&fields, IndexField::PACKAGE_DIR);
+                index_entry entry;
+                entry.control_size = details::remove_optional_field(&fields, IndexField::CONTROL_SIZE);
+                entry.control_mtime = details::remove_optional_field(&fields, IndexField::CONTROL_MTIME);
+                if (package_dir.empty() || entry.control_size.empty() || entry.control_mtime.empty())
+                {
+                    // Cut short by a writer that did not finish appending it: the index fields are written last
+                    continue;
+                }
+
+                // Entries are appended, so a later one for the same package replaces the earlier
+                entry.binary = BinaryParagraph(std::move(fields));
+                entries[package_dir] = std::move(entry);
+                ++recorded_count;
+            }
+        }
+        catch (std::runtime_error const&)
+        {
+            entries.clear();
+        }
+
+        return entries;
+    }
+
+    static const std::string INDEX_HEADER = IndexField::INDEX_VERSION + ": " + INDEX_VERSION + "\n";
+
+    // The fields of the index come after those of the binary paragraph, so that an entry cut short anywhere misses one
+    // of them or has a stamp that matches no CONTROL file
+    static void write_entry(std::ostream& os, const std::string& package_dir, const index_entry& entry)
+    {
+        os << "\n";
+        os << entry.binary;
+        os << IndexField::PACKAGE_DIR << ": " << package_dir << "\n";
+        os << IndexField::CONTROL_SIZE << ": " << entry.control_size << "\n";
+        os << IndexField::CONTROL_MTIME << ": " << entry.control_mtime << "\n";
+    }
+
+    static void write_index(const fs::path& index_file, const std::map<std::string, index_entry>& entries)
+    {
+        // The index is only a cache: failing to write it costs parsing the CONTROL files next time, nothing more
+        std::ostringstream os;
+        os << INDEX_HEADER;
+        for (auto&& kv : entries)
+        {
+            write_entry(os, kv.first, kv.second);
+        }
+
+        Files::write_contents_atomically(index_file, os.str());
+    }
+
+    static bool parse_control_file(const expected<std::string>& contents, BinaryParagraph& binary)
+    {
+        const std::string* text = contents.get();
+        if (text == nullptr)
+        {
+            return false;
+        }
+
+        try
+        {
+            const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(*text);
+            if (pghs.size() != 1)
+            {
+                return false;
+            }
+
+            binary = BinaryParagraph(pghs[0]);
+            return true;
+        }
+        catch (std::runtime_error const&)
+        {
+            return false;
+        }
+    }
+
+    std::vector<BinaryParagraph> load_binary_paragraphs(const vcpkg_paths& paths)
+    {
+        size_t recorded_count;
+        std::map<std::string, index_entry> previous = read_index(paths.vcpkg_dir_packages_index, recorded_count);
+
+        std::map<std::string, index_entry> current;
+        size_t reused_entries = 0;
+        bool has_changes = false;
+
+        std::error_code ec;
+        for (auto it = fs::directory_iterator(paths.packages, ec); !ec && it != fs::directory_iterator(); ++it)
+        {
+            const fs::path& path = it->path();
+
+            // Packages kept compressed are packages/<spec>.pack; the directory wins while both exist
+            const bool is_archive = path.extension() == ".pack";
+            const std::string package_dir = is_archive ? path.stem().string() : path.filename().string();
+            if (is_archive && fs::is_directory(paths.packages / package_dir))
+            {
+                continue;
+            }
+
+            const fs::path stamp_file = is_archive ? path : path / "CONTROL";
+            index_entry entry;
+            if (!read_stamp(stamp_file, entry))
+            {
+                continue;
+            }
+
+            auto cached = previous.find(package_dir);
+            if (cached != previous.end() && cached->second.control_size == entry.control_size && cached->second.control_mtime == entry.control_mtime)
+            {
+                current.emplace(package_dir, std::move(cached->second));
+                ++reused_entries;
+                continue;
+            }
+
+            const expected<std::string> contents = is_archive ? PackageArchive::read_file(path, "CONTROL") : Files::get_contents(stamp_file);
+            if (parse_control_file(contents, entry.binary))
+            {
+                current.emplace(package_dir, std::move(entry));
+                has_changes = true;
+            }
+        }
+
+        // Also compacts away the entries that add_package appended for packages recorded before
+        if (has_changes || reused_entries != previous.size() || recorded_count != previous.size())
+        {
+            // A package recorded by a concurrent build meanwhile is dropped here; it is parsed again on the next load
+            const Files::file_lock lock = lock_index(paths);
+            write_index(paths.vcpkg_dir_packages_index, current);
+        }
+
+        std::vector<BinaryParagraph> output;
+        output.reserve(current.size());
+        for (auto&& kv : current)
+        {
+            output.push_back(std::move(kv.second.binary));
+        }
+
+        return output;
+    }
+
+    packages_index packages_index::load(const vcpkg_paths& paths)
+    {
+        packages_index index;
+        size_t recorded_count;
+        index.entries = read_index(paths.vcpkg_dir_packages_index, recorded_count);
+        return index;
+    }
+
+    const BinaryParagraph* packages_index::find(const vcpkg_paths& paths, const package_spec& spec) const
+    {
+        auto it = this->entries.find(spec.dir());
+        if (it == this->entries.end())
+        {
+            return nullptr;
+        }
+
+        index_entry stamp;
+        if (!read_stamp(control_stamp_file(paths.package_dir(spec), PackageArchive::archive_path(paths, spec)), stamp)
+            || stamp.control_size != it->second.control_size || stamp.control_mtime != it->second.control_mtime)
+        {
+            return nullptr;
+        }
+
+        return &it->second.binary;
+    }
+
+    void add_package(const vcpkg_paths& paths, const BinaryParagraph& bpgh)
+    {
+        const package_spec& spec = bpgh.spec;
+        index_entry entry;
+        if (!read_stamp(paths.package_dir(spec) / "CONTROL", entry))
+        {
+            return;
+        }
+        entry.binary = bpgh;
+
+        // Appended rather than rewriting the whole index, which would make an install of many packages quadratic
+        const Files::file_lock lock = lock_index(paths);
+        std::error_code ec;
+        const bool has_header = fs::file_size(paths.vcpkg_dir_packages_index, ec) >= INDEX_HEADER.size() && !ec;
+        std::ostringstream os;
+        if (!has_header)
+        {
+            os << INDEX_HEADER;
+        }
+        else
+        {
+            // Ends the last entry should a writer have died appending it, so that it cannot run into this one
+            os << "\n";
+        }
+        write_entry(os, spec.dir(), entry);
+
+        const std::string text = os.str();
+        std::ofstream index(paths.vcpkg_dir_packages_index, std::ios_base::out | std::ios_base::binary | (has_header ? std::ios_base::app : std::ios_base::trunc));
+        index.write(text.data(), text.size());
+    }
+}}
@@ -1,17 +1,20 @@
 #include "Paragraphs.h"
 #include "vcpkg_Files.h"
+#include "Timings.h"
+#include <cstring>
 
 namespace vcpkg { namespace Paragraphs
 {
     struct Parser
     {
-        Parser(const char* c, const char* e) : cur(c), end(e)
+        // Multi-line values are normalized in place, so the buffer must be writable
+        Parser(char* c, char* e) : cur(c), end(e)
         {
         }
 
     private:
-        const char* cur;
-        const char* const end;
+        char* cur;
+        char* const end;
 
         void peek(char& ch) const
         {
@@ -50,9 +53,11 @@ namespace vcpkg { namespace Paragraphs
             return ch == '\r' || ch == '\n' || ch == 0;
         }
 
-        void get_fieldvalue(char& ch, std::string& fieldvalue)
+        void get_fieldvalue(char& ch, text_range& fieldvalue)
         {
-            fieldvalue.clear();
+            // The value is compacted towards its start: it never grows, so out never overtakes cur
+            char* const begin_fieldvalue = cur;
+            char* out = cur;
 
             auto beginning_of_line = cur;
             do
@@ -61,7 +66,11 @@ namespace vcpkg { namespace Paragraphs
                 while (!is_lineend(ch))
                     next(ch);
 
-                fieldvalue.append(beginning_of_line, cur);
+                const size_t line_length = static_cast<size_t>(cur - beginning_of_line);
+                if (out != beginning_of_line)
+                    memmove(out, beginning_of_line, line_length);
+                out += line_length;
+                fieldvalue = {begin_fieldvalue, out};
 
                 if (ch == '\r')
                     next(ch);
@@ -90,48 +99,48 @@ namespace vcpkg { namespace Paragraphs
 
                 // First nonspace is not a newline. This continues the current field value.
                 // We forcibly convert all newlines into single '\n' for ease of text handling later on.
-                fieldvalue.push_back('\n');
+                *out++ = '\n';
             }
             while (true);
         }
 
-        void get_fieldname(char& ch, std::string& fieldname)
+        void get_fieldname(char& ch, text_range& fieldname)
         {
             auto begin_fieldname = cur;
             while (is_alphanum(ch) || ch == '-')
                 next(ch);
             Checks::check_throw(ch == ':', "Expected ':'");
-            fieldname = std::string(begin_fieldname, cur);
+            fieldname = {begin_fieldname, cur};
 
             // skip ': '
             next(ch);
             skip_spaces(ch);
         }
 
-        void get_paragraph(char& ch, std::unordered_map<std::string, std::string>& fields)
+        void get_paragraph(char& ch, std::vector<field_view>& fields)
         {
-            fields.clear();
-            std::string fieldname;
-            std::string fieldvalue;
+            const size_t paragraph_begin = fields.size();
             do
             {
-                get_fieldname(ch, fieldname);
+                field_view field;
+                get_fieldname(ch, field.name);
 
-                auto it = fields.find(fieldname);
-                Checks::check_throw(it == fields.end(), "Duplicate field");
+                for (size_t i = paragraph_begin; i < fields.size(); ++i)
+                {
+                    const text_range& existing = fields[i].name;
+                    Checks::check_throw(existing.size() != field.name.size() || memcmp(existing.begin, field.name.begin, existing.size()) != 0, "Duplicate field");
+                }
 
-                get_fieldvalue(ch, fieldvalue);
+                get_fieldvalue(ch, field.value);
 
-                fields.emplace(fieldname, fieldvalue);
+                fields.push_back(field);
             }
             while (!is_lineend(ch));
         }
 
     public:
-        std::vector<std::unordered_map<std::string, std::string>> get_paragraphs()
+        void get_paragraphs(std::vector<field_view>& fields, std::vector<size_t>& paragraph_ends)
         {
-            std::vector<std::unordered_map<std::string, std::string>> paragraphs;
-
             char ch;
             peek(ch);
 
@@ -143,14 +152,59 @@ namespace vcpkg { namespace Paragraphs
                     continue;
                 }
 
-                paragraphs.emplace_back();
-                get_paragraph(ch, paragraphs.back());
+                get_paragraph(ch, fields);
+                paragraph_ends.push_back(fields.size());
             }
-
-            return paragraphs;
         }
     };
 
+    const text_range* paragraph_view::find(const std::string& fieldname) const
+    {
+        for (const field_view* field = this->begin; field != this->end; ++field)
+        {
+            if (field->name == fieldname)
+            {
+                return &field->value;
+            }
+        }
+
+        return nullptr;
+    }
+
+    std::unordered_map<std::string, std::string> paragraph_view::to_map() const
+    {
+        std::unordered_map<std::string, std::string> fields;
+        for (const field_view* field = this->begin; field != this->end; ++field)
+        {
+            fields.emplace(field->name.to_string(), field->value.to_string());
+        }
+
+        return fields;
+    }
+
+    paragraph_view parsed_paragraphs::operator[](size_t i) const
+    {
+        const size_t begin = i == 0 ? 0 : this->paragraph_ends[i - 1];
+        const field_view* fields_begin = this->fields.data();
+        return {fields_begin + begin, fields_begin + this->paragraph_ends[i]};
+    }
+
+    parsed_paragraphs parse_paragraph_views(std::string text)
+    {
+        const Timings::scoped_timer timer("parse_paragraphs");
+        parsed_paragraphs result;
+        result.text = std::make_unique<std::string>(std::move(text));
+        std::string& buffer = *result.text;
+        char* const begin = buffer.empty() ? nullptr : &buffer[0];
+        Parser(begin, begin + buffer.size()).get_paragraphs(result.fields, result.paragraph_ends);
+        return result;
+    }
+
+    parsed_paragraphs get_paragraph_views(const fs::path& control_path)
+    {
+        return parse_paragraph_views(Files::get_contents(control_path).get_or_throw());
+    }
+
     std::vector<std::unordered_map<std::string, std::string>> get_paragraphs(const fs::path& control_path)
     {
         return parse_paragraphs(Files::get_contents(control_path).get_or_throw());
@@ -158,6 +212,15 @@ namespace vcpkg { namespace Paragraphs
 
     std::vector<std::unordered_map<std::string, std::string>> parse_paragraphs(const std::string& str)
     {
-        return Parser(str.c_str(), str.c_str() + str.size()).get_paragraphs();
+        const parsed_paragraphs views = parse_paragraph_views(str);
+
+        std::vector<std::unordered_map<std::string, std::string>> paragraphs;
+        paragraphs.reserve(views.size());
+        for (size_t i = 0; i < views.size(); ++i)
+        {
+            paragraphs.push_back(views[i].to_map());
+        }
+
+        return paragraphs;
     }
 }}
@@ -0,0 +1,359 @@
+#include "PortsIndex.h"
+#include "Paragraphs.h"
+#include "vcpkglib_helpers.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+namespace vcpkg { namespace PortsIndex
+{
+    // Bump when the layout of an index entry changes; an index with another version is discarded
+    static const std::string INDEX_VERSION = "1";
+
+    namespace IndexField
+    {
+        static const std::string INDEX_VERSION = "Ports-Index-Version";
+        static const std::string PORT_DIR = "Port-Dir";
+        static const std::string CONTROL_SIZE = "Control-Size";
+        static const std::string CONTROL_MTIME = "Control-Mtime";
+    }
+
+    struct index_entry
+    {
+        std::string control_size;
+        std::string control_mtime;
+        SourceParagraph source;
+    };
+
+    static std::map<std::string, index_entry> read_index(const fs::path& index_file)
+    {
+        std::map<std::string, index_entry> entries;
+
+        const expected<std::string> contents = Files::get_contents(index_file);
+        const std::string* text = contents.get();
+        if (text == nullptr)
+        {
+            return entries;
+        }
+
+        try
+        {
+            std::vector<std::unordered_map<std::string, std::string>> pghs = Paragraphs::parse_paragraphs(*text);
+            if (pghs.empty() || details::optional_field(pghs[0], IndexField::INDEX_VERSION) != INDEX_VERSION)
+            {
+                return entries;
+            }
+
+            for (size_t i = 1; i < pghs.size(); ++i)
+            {
+                std::unordered_map<std::string, std::string>& fields = pghs[i];
+
+                const std::string port_dir = details::remove_optional_field(&fields, IndexField::PORT_DIR);
+                index_entry entry;
+                entry.control_size = details::remove_optional_field(&fields, IndexField::CONTROL_SIZE);
+                entry.control_mtime = details::remove_optional_field(&fields, IndexField::CONTROL_MTIME);
+                if (port_dir.empty() || entry.control_size.empty() || entry.control_mtime.empty())
+                {
+                    // Not written by us; start over
+                    entries.clear();
+                    return entries;
+                }
+
+                entry.source = SourceParagraph(std::move(fields));
+                entries.emplace(port_dir, std::move(entry));
+            }
+        }
+        catch (std::runtime_error const&)
+        {
+            entries.clear();
+        }
+
+        return entries;
+    }
+
+    static void write_field(std::ostream& os, const std::string& name, const std::string& value)
+    {
+        if (value.empty())
+        {
+            return;
+        }
+
+        // Continuation lines keep their leading whitespace through parsing, so values round-trip as they are
+        os << name << ": " << value << "\n";
+    }
+
+    static std::string serialize_depends(const std::vector<dependency>& depends)
+    {
+        std::vector<std::string> out;
+        for (const dependency& dep : depends)
+        {
+            out.push_back(dep.qualifier.empty() ? dep.name : Strings::format("%s [%s]", dep.name, dep.qualifier));
+        }
+        return Strings::join(out, ", ");
+    }
+
+    static void write_index(const fs::path& index_file, const std::map<std::string, index_entry>& entries)
+    {
+        // The index is only a cache: failing to write it costs a full rescan next time, nothing more
+        std::ostringstream os;
+        os << IndexField::INDEX_VERSION << ": " << INDEX_VERSION << "\n";
+        for (auto&& kv : entries)
+        {
+            const index_entry& entry = kv.second;
+            os << "\n";
+            write_field(os, IndexField::PORT_DIR, kv.first);
+            write_field(os, IndexField::CONTROL_SIZE, entry.control_size);
+            write_field(os, IndexField::CONTROL_MTIME, entry.control_mtime);
+            write_field(os, "Source", entry.source.name);
+            write_field(os, "Version", entry.source.version);
+            write_field(os, "Description", entry.source.description);
+            write_field(os, "Maintainer", entry.source.maintainer);
+            write_field(os, "Build-Depends", serialize_depends(entry.source.depends));
+        }
+
+        Files::write_contents_atomically(index_file, os.str());
+    }
+
+    std::vector<SourceParagraph> load_source_paragraphs(const fs::path& ports_dir, const fs::path& index_file)
+    {
+        std::map<std::string, index_entry> previous;
+        if (!index_file.empty())
+        {
+            previous = read_index(index_file);
+        }
+
+        std::map<std::string, index_entry> current;
+        size_t reused_entries = 0;
+
+        // The CONTROL files that changed are read together once the directory has been scanned
+        std::vector<std::pair<std::string, index_entry>> changed;
+        std::vector<fs::path> changed_control_files;
+
+        for (auto it = fs::directory_iterator(ports_dir); it != fs::directory_iterator(); ++it)
+        {
+            const fs::path& path = it->path();
+            const fs::path control_file = path / "CONTROL";
+
+            std::error_code ec;
+            const uintmax_t size = fs::file_size(control_file, ec);
+            if (ec)
+            {
+                continue;
+            }
+            const auto mtime = fs::last_write_time(control_file, ec);
+            if (ec)
+            {
+                continue;
+            }
+
+            const std::string port_dir = path.filename().string();
+            index_entry entry;
+            entry.control_size = std::to_string(size);
+            entry.control_mtime = std::to_string(mtime.time_since_epoch().count());
+
+            auto cached = previous.find(port_dir);
+            if (cached != previous.end() && cached->second.control_size == entry.control_size && cached->second.control_mtime == entry.control_mtime)
+            {
+                current.emplace(port_dir, std::move(cached->second));
+                ++reused_entries;
+                continue;
+            }
+
+            changed.emplace_back(port_dir, std::move(entry));
+            changed_control_files.push_back(control_file);
+        }
+
+        bool has_changes = false;
+        std::vector<expected<std::string>> changed_contents = Files::get_contents_of_all(changed_control_files);
+        for (size_t i = 0; i < changed.size(); ++i)
+        {
+            const std::string* contents = changed_contents[i].get();
+            if (contents == nullptr)
+            {
+                continue;
+            }
+
+            try
+            {
+                auto pghs = Paragraphs::parse_paragraphs(*contents);
+                if (pghs.empty())
+                {
+                    continue;
+                }
+
+                changed[i].second.source = SourceParagraph(pghs[0]);
+                current.emplace(changed[i].first, std::move(changed[i].second));
+                has_changes = true;
+            }
+            catch (std::runtime_error const&)
+            {
+            }
+        }
+
+        if (!index_file.empty() && (has_changes || reused_entries != previous.size()))
+        {
+            write_index(index_file, current);
+        }
+
+        std::vector<SourceParagraph> output;
+        output.reserve(current.size());
+        for (auto&& kv : current)
+        {
+            output.push_back(std::move(kv.second.source));
+        }
+
+        return output;
+    }
+
+    std::vector<SourceParagraph> load_source_paragraphs(const vcpkg_paths& paths)
+    {
+        return load_source_paragraphs(paths.ports, paths.vcpkg_dir_ports_index);
+    }
+
+    // Scores of a match, summed over the terms of a query
+    namespace MatchScore
+    {
+        static const int WHOLE_NAME = 100;
+        static const int NAME_WORD = 80;
+        static const int NAME_PREFIX = 70;
+        static const int NAME_WORD_PREFIX = 60;
+        static const int IN_NAME = 40;
+        static const int WORD = 20;
+        static const int WORD_PREFIX = 10;
+    }
+
+    static bool is_word_char(const char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+    }
+
+    static std::vector<std::string> split_words(const std::string& text)
+    {
+        std::vector<std::string> words;
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            if (!is_word_char(text[pos]))
+            {
+                ++pos;
+                continue;
+            }
+
+            size_t end = pos;
+            while (end < text.size() && is_word_char(text[end]))
+            {
+                ++end;
+            }
+            words.push_back(Strings::ascii_to_lowercase(text.substr(pos, end - pos)));
+            pos = end;
+        }
+        return words;
+    }
+
+    search_index::search_index(std::vector<SourceParagraph> source_paragraphs) : ports(std::move(source_paragraphs))
+    {
+        std::unordered_map<std::string, std::vector<posting>> postings_by_word;
+        lowercase_names.reserve(ports.size());
+        for (uint32_t port = 0; port < ports.size(); ++port)
+        {
+            const SourceParagraph& pgh = ports[port];
+            lowercase_names.push_back(Strings::ascii_to_lowercase(pgh.name));
+
+            auto add = [&](const std::string& text, const bool in_name)
+                {
+                    for (std::string& word : split_words(text))
+                    {
+                        // The name is added first, so a later occurrence in the same port never improves on it
+                        std::vector<posting>& postings = postings_by_word[std::move(word)];
+                        if (postings.empty() || postings.back().port != port)
+                            postings.push_back({port, in_name});
+                    }
+                };
+            add(pgh.name, true);
+            add(pgh.description, false);
+            add(pgh.maintainer, false);
+        }
+
+        words.reserve(postings_by_word.size());
+        for (auto&& kv : postings_by_word)
+        {
+            words.push_back({kv.first, std::move(kv.second)});
+        }
+        std::sort(words.begin(), words.end(), [](const word_postings& left, const word_postings& right) { return left.word < right.word; });
+    }
+
+    std::vector<const SourceParagraph*> search_index::search(const std::vector<std::string>& terms) const
+    {
+        // Total score of the ports that matched every term so far
+        std::vector<int> scores(ports.size(), 0);
+        std::vector<int> term_scores(ports.size());
+        for (const std::string& term : terms)
+        {
+            const std::string lowercase_term = Strings::ascii_to_lowercase(term);
+            std::fill(term_scores.begin(), term_scores.end(), 0);
+
+            for (size_t port = 0; port < ports.size(); ++port)
+            {
+                const std::string& name = lowercase_names[port];
+                const size_t found = name.find(lowercase_term);
+                if (found == std::string::npos)
+                    continue;
+                if (name.size() == lowercase_term.size())
+                    term_scores[port] = MatchScore::WHOLE_NAME;
+                else
+                    term_scores[port] = found == 0 ? MatchScore::NAME_PREFIX : MatchScore::IN_NAME;
+            }
+
+            const std::vector<std::string> term_words = split_words(lowercase_term);
+            if (term_words.size() == 1 && term_words[0] == lowercase_term)
+            {
+                const auto first = std::lower_bound(words.cbegin(), words.cend(), lowercase_term,
+                                                    [](const word_postings& entry, const std::string& word) { return entry.word < word; });
+                for (auto it = first; it != words.cend() && it->word.compare(0, lowercase_term.size(), lowercase_term) == 0; ++it)
+                {
+                    const bool whole_word = it->word.size() == lowercase_term.size();
+                    for (const posting& p : it->postings)
+                    {
+                        const int score = p.in_name
+                                              ? (whole_word ? MatchScore::NAME_WORD : MatchScore::NAME_WORD_PREFIX)
+                                              : (whole_word ? MatchScore::WORD : MatchScore::WORD_PREFIX);
+                        term_scores[p.port] = std::max(term_scores[p.port], score);
+                    }
+                }
+            }
+
+            const bool first_term = &term == &terms.front();
+            for (size_t port = 0; port < ports.size(); ++port)
+            {
+                if (term_scores[port] == 0 || (!first_term && scores[port] == 0))
+                    scores[port] = 0;
+                else
+                    scores[port] += term_scores[port];
+            }
+        }
+
+        std::vector<uint32_t> matches;
+        for (uint32_t port = 0; port < ports.size(); ++port)
+        {
+            if (scores[port] != 0)
+                matches.push_back(port);
+        }
+        std::sort(matches.begin(), matches.end(), [&](const uint32_t left, const uint32_t right)
+                  {
+                      if (scores[left] != scores[right])
+                          return scores[left] > scores[right];
+                      return lowercase_names[left] < lowercase_names[right];
+                  });
+
+        std::vector<const SourceParagraph*> output;
+        output.reserve(matches.size());
+        for (const uint32_t port : matches)
+        {
+            output.push_back(&ports[port]);
+        }
+        return output;
+    }
+}}
@@ -1,6 +1,7 @@
 #include "SourceParagraph.h"
 #include "vcpkglib_helpers.h"
 #include "vcpkg_System.h"
+#include "vcpkg_Checks.h"
 #include "vcpkg_Maps.h"
 #include "triplet.h"
 
@@ -18,6 +19,8 @@ namespace vcpkg
         static const std::string DESCRIPTION = "Description";
         static const std::string MAINTAINER = "Maintainer";
         static const std::string BUILD_DEPENDS = "Build-Depends";
+        static const std::string HOST_DEPENDS = "Host-Depends";
+        static const std::string HEADER_ONLY = "Header-Only";
     }
 
     static const std::vector<std::string>& get_list_of_valid_fields()
@@ -29,7 +32,9 @@ namespace vcpkg
 
             SourceParagraphOptionalField::DESCRIPTION,
             SourceParagraphOptionalField::MAINTAINER,
-            SourceParagraphOptionalField::BUILD_DEPENDS
+            SourceParagraphOptionalField::BUILD_DEPENDS,
+            SourceParagraphOptionalField::HOST_DEPENDS,
+            SourceParagraphOptionalField::HEADER_ONLY
         };
 
         return valid_fields;
@@ -47,6 +52,14 @@ namespace vcpkg
         std::string deps = details::remove_optional_field(&fields, SourceParagraphOptionalField::BUILD_DEPENDS);
         this->depends = expand_qualified_dependencies(parse_depends(deps));
 
+        std::string host_deps = details::remove_optional_field(&fields, SourceParagraphOptionalField::HOST_DEPENDS);
+        this->host_depends = expand_qualified_dependencies(parse_depends(host_deps));
+
+        const std::string header_only = details::remove_optional_field(&fields, SourceParagraphOptionalField::HEADER_ONLY);
+        Checks::check_exit(header_only.empty() || header_only == "yes" || header_only == "no",
+                           "Error: Header-Only of %s must be 'yes' or 'no' but was %s", this->name, header_only);
+        this->header_only = header_only == "yes";
+
         if (!fields.empty())
         {
             const std::vector<std::string> remaining_fields = Maps::extract_keys(fields);
@@ -0,0 +1,330 @@
+#include "StatusBinarySnapshot.h"
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+
+namespace vcpkg { namespace StatusBinarySnapshot
+{
+    // Bump when the layout changes; a snapshot of another version is written again
+    static const uint32_t VERSION = 1;
+    static const char MAGIC[8] = {'V', 'C', 'P', 'K', 'G', 'S', 'T', 'S'};
+
+    // Header: magic, version, record count, bucket count, dependency count, status file size, status file last write time.
+    // Then the records, the buckets (record + 1, 0 when empty), the dependencies (records) and the strings.
+    static constexpr size_t HEADER_SIZE = sizeof(MAGIC) + 4 + 4 + 4 + 4 + 8 + 8;
+
+    // Displayname offset and size, paragraph offset and size, first dependency, dependency count, want, state, hash
+    static constexpr size_t RECORD_SIZE = 4 * 6 + 1 + 1 + 2 + 4;
+
+    static void append_le(std::string& out, const uint64_t value, const int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+        {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    static uint64_t read_le(const char* data, const int bytes)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+        {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    // FNV-1a
+    static uint32_t hash_displayname(const char* data, const size_t size)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    static bool read_status_stamp(const status_database_files& db, uint64_t& size, uint64_t& mtime)
+    {
+        std::error_code ec;
+        size = fs::file_size(db.status_file, ec);
+        if (ec)
+        {
+            return false;
+        }
+        const auto last_write_time = fs::last_write_time(db.status_file, ec);
+        if (ec)
+        {
+            return false;
+        }
+        mtime = static_cast<uint64_t>(last_write_time.time_since_epoch().count());
+        return true;
+    }
+
+    void write(const status_database_files& db, const StatusParagraphs& status_db)
+    {
+        uint64_t status_size;
+        uint64_t status_mtime;
+        if (!read_status_stamp(db, status_size, status_mtime))
+        {
+            return;
+        }
+
+        std::vector<const StatusParagraph*> pghs;
+        std::unordered_map<std::string, size_t> record_of;
+        for (auto&& pgh : status_db)
+        {
+            record_of.emplace(pgh->package.displayname(), pghs.size());
+            pghs.push_back(pgh.get());
+        }
+
+        size_t bucket_count = 1;
+        while (bucket_count < 2 * pghs.size())
+        {
+            bucket_count *= 2;
+        }
+
+        std::string records;
+        std::vector<uint32_t> buckets(bucket_count);
+        std::string dependencies;
+        uint32_t dependency_count = 0;
+        std::string strings;
+        for (size_t i = 0; i < pghs.size(); ++i)
+        {
+            const StatusParagraph& pgh = *pghs[i];
+            const std::string displayname = pgh.package.displayname();
+            std::ostringstream paragraph;
+            paragraph << pgh;
+
+            const uint32_t first_dependency = dependency_count;
+            for (const std::string& dependency : pgh.package.depends)
+            {
+                const auto it = record_of.find(dependency + ":" + pgh.package.spec.target_triplet().canonical_name());
+                if (it != record_of.end())
+                {
+                    append_le(dependencies, it->second, 4);
+                    ++dependency_count;
+                }
+            }
+
+            const uint32_t hash = hash_displayname(displayname.data(), displayname.size());
+            append_le(records, strings.size(), 4);
+            append_le(records, displayname.size(), 4);
+            strings.append(displayname);
+            append_le(records, strings.size(), 4);
+            append_le(records, paragraph.str().size(), 4);
+            strings.append(paragraph.str());
+            append_le(records, first_dependency, 4);
+            append_le(records, dependency_count - first_dependency, 4);
+            append_le(records, static_cast<uint64_t>(pgh.want), 1);
+            append_le(records, static_cast<uint64_t>(pgh.state), 1);
+            append_le(records, 0, 2);
+            append_le(records, hash, 4);
+
+            size_t bucket = hash & (bucket_count - 1);
+            while (buckets[bucket] != 0)
+            {
+                bucket = (bucket + 1) & (bucket_count - 1);
+            }
+            buckets[bucket] = static_cast<uint32_t>(i + 1);
+        }
+
+        std::string header(MAGIC, sizeof(MAGIC));
+        append_le(header, VERSION, 4);
+        append_le(header, pghs.size(), 4);
+        append_le(header, bucket_count, 4);
+        append_le(header, dependency_count, 4);
+        append_le(header, status_size, 8);
+        append_le(header, status_mtime, 8);
+
+        std::string bucket_bytes;
+        for (const uint32_t bucket : buckets)
+        {
+            append_le(bucket_bytes, bucket, 4);
+        }
+
+        // The snapshot is only a shortcut: failing to write it costs parsing the status file next time, nothing more
+        std::ostringstream os;
+        os << header << records << bucket_bytes << dependencies << strings;
+        Files::write_contents_atomically(db.status_snapshot, os.str());
+    }
+
+    expected<snapshot> snapshot::open(const status_database_files& db)
+    {
+        uint64_t status_size;
+        uint64_t status_mtime;
+        if (!read_status_stamp(db, status_size, status_mtime))
+        {
+            return std::errc::no_such_file_or_directory;
+        }
+
+        expected<Files::mapped_file> mapped = Files::mapped_file::open(db.status_snapshot);
+        Files::mapped_file* file = mapped.get();
+        if (file == nullptr)
+        {
+            return mapped.error_code();
+        }
+
+        const char* data = file->data();
+        const size_t size = file->size();
+        if (size < HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || read_le(data + 8, 4) != VERSION)
+        {
+            return std::errc::invalid_argument;
+        }
+        if (read_le(data + 24, 8) != status_size || read_le(data + 32, 8) != status_mtime)
+        {
+            return std::errc::invalid_argument;
+        }
+
+        const uint64_t record_count = read_le(data + 12, 4);
+        const uint64_t bucket_count = read_le(data + 16, 4);
+        const uint64_t dependency_count = read_le(data + 20, 4);
+        const uint64_t strings_begin = HEADER_SIZE + record_count * RECORD_SIZE + bucket_count * 4 + dependency_count * 4;
+        if (strings_begin > size || bucket_count == 0 || (bucket_count & (bucket_count - 1)) != 0 || bucket_count <= record_count)
+        {
+            return std::errc::invalid_argument;
+        }
+
+        snapshot result;
+        result.m_record_count = static_cast<size_t>(record_count);
+        result.m_bucket_count = static_cast<size_t>(bucket_count);
+        result.m_records = data + HEADER_SIZE;
+        result.m_buckets = result.m_records + record_count * RECORD_SIZE;
+        result.m_dependencies = result.m_buckets + bucket_count * 4;
+        result.m_strings = data + strings_begin;
+
+        // Checked once here, so that the accessors can trust every offset
+        const uint64_t strings_size = size - strings_begin;
+        for (size_t i = 0; i < result.m_record_count; ++i)
+        {
+            const char* r = result.record(i);
+            if (read_le(r, 4) + read_le(r + 4, 4) > strings_size || read_le(r + 8, 4) + read_le(r + 12, 4) > strings_size
+                || read_le(r + 16, 4) + read_le(r + 20, 4) > dependency_count)
+            {
+                return std::errc::invalid_argument;
+            }
+        }
+        for (uint64_t i = 0; i < dependency_count; ++i)
+        {
+            if (read_le(result.m_dependencies + i * 4, 4) >= record_count)
+            {
+                return std::errc::invalid_argument;
+            }
+        }
+        for (uint64_t i = 0; i < bucket_count; ++i)
+        {
+            if (read_le(result.m_buckets + i * 4, 4) > record_count)
+            {
+                return std::errc::invalid_argument;
+            }
+        }
+
+        result.m_file = std::move(*file);
+        return std::move(result);
+    }
+
+    const char* snapshot::record(size_t i) const
+    {
+        return this->m_records + i * RECORD_SIZE;
+    }
+
+    std::string snapshot::displayname(size_t i) const
+    {
+        const char* r = this->record(i);
+        return std::string(this->m_strings + read_le(r, 4), static_cast<size_t>(read_le(r + 4, 4)));
+    }
+
+    want_t snapshot::want(size_t i) const
+    {
+        return static_cast<want_t>(read_le(this->record(i) + 24, 1));
+    }
+
+    install_state_t snapshot::state(size_t i) const
+    {
+        return static_cast<install_state_t>(read_le(this->record(i) + 25, 1));
+    }
+
+    Paragraphs::text_range snapshot::paragraph_text(size_t i) const
+    {
+        const char* r = this->record(i);
+        const char* begin = this->m_strings + read_le(r + 8, 4);
+        return {begin, begin + read_le(r + 12, 4)};
+    }
+
+    std::vector<size_t> snapshot::dependencies(size_t i) const
+    {
+        const char* r = this->record(i);
+        const size_t first = static_cast<size_t>(read_le(r + 16, 4));
+        const size_t count = static_cast<size_t>(read_le(r + 20, 4));
+        std::vector<size_t> result;
+        result.reserve(count);
+        for (size_t d = first; d < first + count; ++d)
+        {
+            result.push_back(static_cast<size_t>(read_le(this->m_dependencies + d * 4, 4)));
+        }
+        return result;
+    }
+
+    size_t snapshot::find(const std::string& displayname) const
+    {
+        if (this->m_record_count == 0)
+        {
+            return npos;
+        }
+
+        const uint32_t hash = hash_displayname(displayname.data(), displayname.size());
+        for (size_t bucket = hash & (this->m_bucket_count - 1);; bucket = (bucket + 1) & (this->m_bucket_count - 1))
+        {
+            const size_t entry = static_cast<size_t>(read_le(this->m_buckets + bucket * 4, 4));
+            if (entry == 0)
+            {
+                return npos;
+            }
+
+            const char* r = this->record(entry - 1);
+            if (read_le(r + 28, 4) == hash && read_le(r + 4, 4) == displayname.size()
+                && displayname.compare(0, displayname.size(), this->m_strings + read_le(r, 4), displayname.size()) == 0)
+            {
+                return entry - 1;
+            }
+        }
+    }
+
+    bool restore_status_file(const status_database_files& db)
+    {
+        // Without a status file there is no stamp to check the snapshot against; what it holds was the status file once
+        expected<Files::mapped_file> mapped = Files::mapped_file::open(db.status_snapshot);
+        const Files::mapped_file* file = mapped.get();
+        if (file == nullptr || file->size() < HEADER_SIZE || memcmp(file->data(), MAGIC, sizeof(MAGIC)) != 0 || read_le(file->data() + 8, 4) != VERSION)
+        {
+            return false;
+        }
+
+        const char* data = file->data();
+        const uint64_t record_count = read_le(data + 12, 4);
+        const uint64_t strings_begin = HEADER_SIZE + record_count * RECORD_SIZE + read_le(data + 16, 4) * 4 + read_le(data + 20, 4) * 4;
+        if (strings_begin > file->size())
+        {
+            return false;
+        }
+
+        std::string contents;
+        for (uint64_t i = 0; i < record_count; ++i)
+        {
+            const char* r = data + HEADER_SIZE + i * RECORD_SIZE;
+            const uint64_t offset = read_le(r + 8, 4);
+            const uint64_t length = read_le(r + 12, 4);
+            if (strings_begin + offset + length > file->size())
+            {
+                return false;
+            }
+            contents.append(data + strings_begin + offset, static_cast<size_t>(length)).push_back('\n');
+        }
+
+        return !Files::write_contents_atomically(db.status_file, contents, Files::durability::flushed);
+    }
+}}
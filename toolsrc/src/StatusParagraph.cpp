@@ -22,11 +22,8 @@ namespace vcpkg
         return os;
     }
 
-    StatusParagraph::StatusParagraph(const std::unordered_map<std::string, std::string>& fields)
-        : package(fields)
+    void parse_status_field(const std::string& status_field, want_t* want, install_state_t* state)
     {
-        std::string status_field = required_field(fields, BinaryParagraphRequiredField::STATUS);
-
         auto b = status_field.begin();
         auto mark = b;
         auto e = status_field.end();
@@ -35,7 +32,7 @@ namespace vcpkg
         while (b != e && *b != ' ')
             ++b;
 
-        want = [](const std::string& text)
+        *want = [](const std::string& text)
             {
                 if (text == "unknown")
                     return want_t::unknown;
@@ -54,7 +51,7 @@ namespace vcpkg
             return;
         b += 4;
 
-        state = [](const std::string& text)
+        *state = [](const std::string& text)
             {
                 if (text == "not-installed")
                     return install_state_t::not_installed;
@@ -66,6 +63,18 @@ namespace vcpkg
             }(std::string(b, e));
     }
 
+    StatusParagraph::StatusParagraph(const std::unordered_map<std::string, std::string>& fields)
+        : package(fields), want(want_t::error), state(install_state_t::error)
+    {
+        parse_status_field(required_field(fields, BinaryParagraphRequiredField::STATUS), &this->want, &this->state);
+    }
+
+    StatusParagraph::StatusParagraph(const Paragraphs::paragraph_view& fields)
+        : package(fields), want(want_t::error), state(install_state_t::error)
+    {
+        parse_status_field(required_field(fields, BinaryParagraphRequiredField::STATUS), &this->want, &this->state);
+    }
+
     std::string to_string(install_state_t f)
     {
         switch (f)
@@ -9,24 +9,86 @@ namespace vcpkg
     StatusParagraphs::StatusParagraphs(std::vector<std::unique_ptr<StatusParagraph>>&& ps)
         : paragraphs(std::move(ps))
     {
-    };
+        // Later paragraphs for the same package take precedence, matching the order of find()
+        for (size_t i = 0; i < paragraphs.size(); ++i)
+        {
+            const package_spec& spec = paragraphs[i]->package.spec;
+            index[spec.name()][spec.target_triplet()] = i;
+        }
+
+        for (size_t i = 0; i < paragraphs.size(); ++i)
+        {
+            const package_spec& spec = paragraphs[i]->package.spec;
+            if (*find_index(spec.name(), spec.target_triplet()) == i)
+            {
+                add_reverse_dependencies(i);
+            }
+        }
+    }
+
+    size_t* StatusParagraphs::find_index(const std::string& name, const triplet& target_triplet)
+    {
+        auto by_name = index.find(name);
+        if (by_name == index.end())
+        {
+            return nullptr;
+        }
+
+        auto by_triplet = by_name->second.find(target_triplet);
+        if (by_triplet == by_name->second.end())
+        {
+            return nullptr;
+        }
+
+        return &by_triplet->second;
+    }
+
+    const size_t* StatusParagraphs::find_index(const std::string& name, const triplet& target_triplet) const
+    {
+        return const_cast<StatusParagraphs*>(this)->find_index(name, target_triplet);
+    }
+
+    StatusParagraphs::iterator StatusParagraphs::to_iterator(size_t i)
+    {
+        return begin() + static_cast<ptrdiff_t>(paragraphs.size() - 1 - i);
+    }
+
+    StatusParagraphs::const_iterator StatusParagraphs::to_iterator(size_t i) const
+    {
+        return begin() + static_cast<ptrdiff_t>(paragraphs.size() - 1 - i);
+    }
+
+    void StatusParagraphs::add_reverse_dependencies(size_t i)
+    {
+        const BinaryParagraph& package = paragraphs[i]->package;
+        auto& by_name = reverse_dependencies[package.spec.target_triplet()];
+        for (const std::string& dependency : package.depends)
+        {
+            by_name[dependency].push_back(i);
+        }
+    }
+
+    void StatusParagraphs::remove_reverse_dependencies(size_t i)
+    {
+        const BinaryParagraph& package = paragraphs[i]->package;
+        auto& by_name = reverse_dependencies[package.spec.target_triplet()];
+        for (const std::string& dependency : package.depends)
+        {
+            std::vector<size_t>& dependents = by_name[dependency];
+            dependents.erase(std::remove(dependents.begin(), dependents.end(), i), dependents.end());
+        }
+    }
 
     StatusParagraphs::const_iterator StatusParagraphs::find(const std::string& name, const triplet& target_triplet) const
     {
-        return std::find_if(begin(), end(), [&](const std::unique_ptr<StatusParagraph>& pgh)
-                            {
-                                const package_spec& spec = pgh->package.spec;
-                                return spec.name() == name && spec.target_triplet() == target_triplet;
-                            });
+        const size_t* i = find_index(name, target_triplet);
+        return i == nullptr ? end() : to_iterator(*i);
     }
 
     StatusParagraphs::iterator StatusParagraphs::find(const std::string& name, const triplet& target_triplet)
     {
-        return std::find_if(begin(), end(), [&](const std::unique_ptr<StatusParagraph>& pgh)
-                            {
-                                const package_spec& spec = pgh->package.spec;
-                                return spec.name() == name && spec.target_triplet() == target_triplet;
-                            });
+        const size_t* i = find_index(name, target_triplet);
+        return i == nullptr ? end() : to_iterator(*i);
     }
 
     StatusParagraphs::iterator StatusParagraphs::find_installed(const std::string& name, const triplet& target_triplet)
@@ -44,18 +106,51 @@ namespace vcpkg
     {
         Checks::check_throw(pgh != nullptr, "Inserted null paragraph");
         const package_spec& spec = pgh->package.spec;
-        auto ptr = find(spec.name(), spec.target_triplet());
-        if (ptr == end())
+        const size_t* i = find_index(spec.name(), spec.target_triplet());
+        if (i == nullptr)
         {
+            index[spec.name()][spec.target_triplet()] = paragraphs.size();
             paragraphs.push_back(std::move(pgh));
+            add_reverse_dependencies(paragraphs.size() - 1);
             return paragraphs.rbegin();
         }
 
         // consume data from provided pgh.
+        const size_t position = *i;
+        remove_reverse_dependencies(position);
+        auto ptr = to_iterator(position);
         **ptr = std::move(*pgh);
+        add_reverse_dependencies(position);
         return ptr;
     }
 
+    std::vector<const StatusParagraph*> StatusParagraphs::find_dependents(const std::string& name, const triplet& target_triplet) const
+    {
+        std::vector<const StatusParagraph*> dependents;
+
+        auto by_triplet = reverse_dependencies.find(target_triplet);
+        if (by_triplet == reverse_dependencies.end())
+        {
+            return dependents;
+        }
+
+        auto by_name = by_triplet->second.find(name);
+        if (by_name == by_triplet->second.end())
+        {
+            return dependents;
+        }
+
+        for (const size_t i : by_name->second)
+        {
+            if (paragraphs[i]->want == want_t::install)
+            {
+                dependents.push_back(paragraphs[i].get());
+            }
+        }
+
+        return dependents;
+    }
+
     std::ostream& vcpkg::operator<<(std::ostream& os, const StatusParagraphs& l)
     {
         for (auto& pgh : l.paragraphs)
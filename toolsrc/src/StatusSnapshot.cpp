@@ -0,0 +1,100 @@
+#include "StatusSnapshot.h"
+#include <algorithm>
+#include <unordered_map>
+#include "vcpkglib_helpers.h"
+
+namespace vcpkg
+{
+    namespace StatusSnapshotField
+    {
+        static const std::string PACKAGE = "Package";
+        static const std::string ARCHITECTURE = "Architecture";
+        static const std::string STATUS = "Status";
+    }
+
+    status_snapshot::status_snapshot(std::vector<Paragraphs::parsed_paragraphs> sources) : sources(std::move(sources))
+    {
+        this->add_sources();
+    }
+
+    status_snapshot::status_snapshot(std::vector<StatusBinarySnapshot::snapshot> bases, std::vector<Paragraphs::parsed_paragraphs> sources)
+        : bases(std::move(bases)), sources(std::move(sources))
+    {
+        for (const StatusBinarySnapshot::snapshot& base : this->bases)
+        {
+            this->base_offsets.push_back(this->entries.size());
+            for (size_t i = 0; i < base.size(); ++i)
+            {
+                this->entries.push_back({Paragraphs::paragraph_view{nullptr, nullptr}, base.displayname(i), base.want(i), base.state(i)});
+            }
+        }
+        this->add_sources();
+    }
+
+    size_t status_snapshot::base_of(size_t i) const
+    {
+        return static_cast<size_t>(std::upper_bound(this->base_offsets.cbegin(), this->base_offsets.cend(), i) - this->base_offsets.cbegin()) - 1;
+    }
+
+    void status_snapshot::add_sources()
+    {
+        // Packages of the binary snapshots are found through their hash tables, the others through this one
+        std::unordered_map<std::string, size_t> index;
+        for (const Paragraphs::parsed_paragraphs& source : this->sources)
+        {
+            for (size_t i = 0; i < source.size(); ++i)
+            {
+                const Paragraphs::paragraph_view fields = source[i];
+
+                const std::string displayname = details::required_field(fields, StatusSnapshotField::PACKAGE) + ":" + details::required_field(fields, StatusSnapshotField::ARCHITECTURE);
+                entry e{fields, displayname, want_t::error, install_state_t::error};
+                parse_status_field(details::required_field(fields, StatusSnapshotField::STATUS), &e.want, &e.state);
+
+                size_t base_entry = StatusBinarySnapshot::snapshot::npos;
+                for (size_t b = 0; b < this->bases.size() && base_entry == StatusBinarySnapshot::snapshot::npos; ++b)
+                {
+                    const size_t record = this->bases[b].find(e.displayname);
+                    if (record != StatusBinarySnapshot::snapshot::npos)
+                    {
+                        base_entry = this->base_offsets[b] + record;
+                    }
+                }
+                if (base_entry != StatusBinarySnapshot::snapshot::npos)
+                {
+                    this->entries[base_entry] = std::move(e);
+                    continue;
+                }
+
+                const auto inserted = index.emplace(e.displayname, this->entries.size());
+                if (inserted.second)
+                {
+                    this->entries.push_back(std::move(e));
+                }
+                else
+                {
+                    this->entries[inserted.first->second] = std::move(e);
+                }
+            }
+        }
+
+        this->decoded.resize(this->entries.size());
+    }
+
+    const StatusParagraph& status_snapshot::paragraph(size_t i) const
+    {
+        if (!this->decoded[i])
+        {
+            if (this->entries[i].fields.begin == nullptr)
+            {
+                const size_t b = this->base_of(i);
+                const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(this->bases[b].paragraph_text(i - this->base_offsets[b]).to_string());
+                this->decoded[i] = std::make_unique<StatusParagraph>(pghs[0]);
+            }
+            else
+            {
+                this->decoded[i] = std::make_unique<StatusParagraph>(this->entries[i].fields);
+            }
+        }
+        return *this->decoded[i];
+    }
+}
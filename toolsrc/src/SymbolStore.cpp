@@ -0,0 +1,289 @@
+#include "SymbolStore.h"
+#include "coff_file_reader.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Parallel.h"
+#include "vcpkg_Strings.h"
+#include "vcpkg_System.h"
+#include <Windows.h>
+
+namespace vcpkg { namespace SymbolStore
+{
+    bool is_enabled()
+    {
+        static const bool enabled = !System::wdupenv_str(L"VCPKG_USE_SYMBOL_STORE").empty();
+        return enabled;
+    }
+
+    static bool is_image(const fs::path& file)
+    {
+        const std::string extension = file.extension().generic_string();
+        return Strings::case_insensitive_ascii_equals(extension, ".dll") || Strings::case_insensitive_ascii_equals(extension, ".exe");
+    }
+
+    // As symbol servers name the directory of a PDB: the fields of the GUID in hexadecimal, then the age
+    static std::string signature_directory(const std::string& guid, const uint32_t age)
+    {
+        const unsigned char* g = reinterpret_cast<const unsigned char*>(guid.data());
+        const uint32_t data1 = g[0] | g[1] << 8 | g[2] << 16 | static_cast<uint32_t>(g[3]) << 24;
+        const uint32_t data2 = g[4] | g[5] << 8;
+        const uint32_t data3 = g[6] | g[7] << 8;
+        return Strings::format("%08X%04X%04X%02X%02X%02X%02X%02X%02X%02X%02X%X", data1, data2, data3, g[8], g[9], g[10], g[11], g[12], g[13], g[14], g[15], age);
+    }
+
+    static fs::path stored_path(const fs::path& store_dir, const COFFFileReader::pdb_reference& reference)
+    {
+        const fs::path name = fs::path(Strings::utf8_to_utf16(reference.path)).filename();
+        return store_dir / name / signature_directory(reference.guid, reference.age) / name;
+    }
+
+    // Linked when possible, as packages/ is renamed away rather than written over; the rename makes a PDB appear whole
+    static bool store_file(const fs::path& pdb, const fs::path& destination)
+    {
+        std::error_code ec;
+        if (fs::exists(destination, ec))
+        {
+            return true;
+        }
+
+        fs::create_directories(destination.parent_path(), ec);
+        const fs::path tmp = destination.parent_path() / Strings::format("%s.%d.tmp", destination.filename().u8string(), static_cast<int>(GetCurrentProcessId()));
+        fs::remove(tmp, ec);
+        fs::create_hard_link(pdb, tmp, ec);
+        if (ec)
+        {
+            ec.clear();
+            fs::copy_file(pdb, tmp, ec);
+        }
+        if (!ec)
+        {
+            fs::rename(tmp, destination, ec);
+        }
+
+        // Another install may have stored the same PDB in the meantime
+        const bool stored = fs::exists(destination);
+        fs::remove(tmp, ec);
+        return stored;
+    }
+
+    // The stored PDB as listed in .symbols files, relative to the store
+    static std::string stored_name(const COFFFileReader::pdb_reference& reference)
+    {
+        const std::string name = fs::path(Strings::utf8_to_utf16(reference.path)).filename().u8string();
+        return name + "/" + signature_directory(reference.guid, reference.age) + "/" + name;
+    }
+
+    static void read_symbolsfile(const fs::path& symbolsfile, std::unordered_set<std::string>& listed)
+    {
+        const expected<std::string> contents = Files::get_contents(symbolsfile);
+        const std::string* text = contents.get();
+        if (text == nullptr)
+            return;
+
+        size_t begin = 0;
+        while (begin < text->size())
+        {
+            size_t end = text->find('\n', begin);
+            if (end == std::string::npos)
+                end = text->size();
+            if (end > begin)
+                listed.insert(text->substr(begin, end - begin));
+            begin = end + 1;
+        }
+    }
+
+    // The PDBs listed by the .symbols files of every triplet
+    static std::unordered_set<std::string> listed_pdbs(const vcpkg_paths& paths)
+    {
+        std::unordered_set<std::string> listed;
+        std::error_code ec;
+        for (auto shard = fs::directory_iterator(paths.vcpkg_dir_shards, ec); !ec && shard != fs::directory_iterator(); shard.increment(ec))
+        {
+            std::error_code info_ec;
+            for (auto it = fs::directory_iterator(shard->path() / "info", info_ec); !info_ec && it != fs::directory_iterator(); it.increment(info_ec))
+            {
+                if (it->path().extension() == ".symbols")
+                {
+                    read_symbolsfile(it->path(), listed);
+                }
+            }
+        }
+        return listed;
+    }
+
+    // Deletes a stored PDB, and its signature and name directories once they are empty
+    static void remove_stored_pdb(const fs::path& pdb)
+    {
+        std::error_code ec;
+        fs::remove(pdb, ec);
+        for (const fs::path& dir : {pdb.parent_path(), pdb.parent_path().parent_path()})
+        {
+            if (!fs::is_directory(dir, ec) || fs::directory_iterator(dir, ec) != fs::directory_iterator())
+                break;
+            fs::remove(dir, ec);
+        }
+    }
+
+    std::unordered_set<std::string> store_package_pdbs(const vcpkg_paths& paths, const BinaryParagraph& bpgh)
+    {
+        const fs::path package_dir = paths.package_dir(bpgh.spec);
+        std::vector<fs::path> images;
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(package_dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+        {
+            if (fs::is_regular_file(it->status()) && is_image(it->path()))
+            {
+                images.push_back(it->path());
+            }
+        }
+
+        // vcpkg_copy_pdbs put the PDB of each image next to it; one that was not written with the image is installed
+        std::vector<fs::path> pdbs(images.size());
+        std::vector<COFFFileReader::pdb_reference> references(images.size());
+        Parallel::for_each_index(images.size(), [&](const size_t i)
+            {
+                COFFFileReader::pdb_reference& reference = references[i];
+                if (!COFFFileReader::read_pdb_reference(images[i], reference))
+                    return;
+
+                const fs::path pdb = images[i].parent_path() / fs::path(Strings::utf8_to_utf16(reference.path)).filename();
+                std::string guid;
+                if (COFFFileReader::read_pdb_guid(pdb, guid) && guid == reference.guid)
+                    pdbs[i] = pdb;
+            }, Parallel::lane::io);
+
+        // Listed before they are stored, so a removal that runs once the lock is released never sees a PDB no package lists
+        std::string symbolsfile;
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            if (!pdbs[i].empty())
+            {
+                symbolsfile += stored_name(references[i]) + "\n";
+            }
+        }
+
+        const Files::file_lock lock(paths.vcpkg_dir_symbols_lock, Files::file_lock::mode::shared);
+        const fs::path symbolsfile_path = paths.symbolsfile_path(bpgh);
+        if (symbolsfile.empty())
+        {
+            fs::remove(symbolsfile_path, ec);
+            return std::unordered_set<std::string>();
+        }
+        ec = Files::write_contents_atomically(symbolsfile_path, symbolsfile);
+        if (ec)
+        {
+            System::println(System::color::warning, "Warning: could not write %s: %s; the PDBs of %s are installed with it",
+                            symbolsfile_path.generic_string(), ec.message(), bpgh.displayname());
+            return std::unordered_set<std::string>();
+        }
+
+        const size_t prefix_length = package_dir.generic_u8string().size();
+        std::vector<std::string> stored(images.size());
+        Parallel::for_each_index(images.size(), [&](const size_t i)
+            {
+                if (!pdbs[i].empty() && store_file(pdbs[i], stored_path(paths.vcpkg_dir_symbols, references[i])))
+                    stored[i] = pdbs[i].generic_u8string().substr(prefix_length + 1);
+            }, Parallel::lane::io);
+
+        std::unordered_set<std::string> skipped;
+        for (std::string& relative : stored)
+        {
+            if (!relative.empty())
+            {
+                skipped.insert(std::move(relative));
+            }
+        }
+        return skipped;
+    }
+
+    void remove_package_pdbs(const vcpkg_paths& paths, const std::vector<const BinaryParagraph*>& removed)
+    {
+        std::vector<fs::path> symbolsfiles;
+        std::error_code ec;
+        for (const BinaryParagraph* pgh : removed)
+        {
+            if (fs::exists(paths.symbolsfile_path(*pgh), ec))
+                symbolsfiles.push_back(paths.symbolsfile_path(*pgh));
+        }
+        if (symbolsfiles.empty())
+            return;
+
+        const Files::file_lock lock(paths.vcpkg_dir_symbols_lock, Files::file_lock::mode::exclusive);
+        std::unordered_set<std::string> unlisted;
+        for (const fs::path& symbolsfile : symbolsfiles)
+        {
+            read_symbolsfile(symbolsfile, unlisted);
+            fs::remove(symbolsfile, ec);
+        }
+        if (unlisted.empty())
+            return;
+
+        for (const std::string& pdb : listed_pdbs(paths))
+        {
+            unlisted.erase(pdb);
+        }
+        for (const std::string& pdb : unlisted)
+        {
+            remove_stored_pdb(paths.vcpkg_dir_symbols / Strings::utf8_to_utf16(pdb));
+        }
+    }
+
+    collection collect_unlisted_pdbs(const vcpkg_paths& paths, const bool dry_run)
+    {
+        collection result;
+        std::error_code ec;
+        if (!fs::is_directory(paths.vcpkg_dir_symbols, ec))
+            return result;
+
+        const Files::file_lock lock(paths.vcpkg_dir_symbols_lock, Files::file_lock::mode::exclusive);
+        const std::unordered_set<std::string> listed = listed_pdbs(paths);
+        const size_t prefix_length = paths.vcpkg_dir_symbols.generic_u8string().size();
+        std::vector<fs::path> unlisted;
+        for (auto it = fs::recursive_directory_iterator(paths.vcpkg_dir_symbols, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+        {
+            // Leftovers of an interrupted store_file are swept with the PDBs
+            if (fs::is_regular_file(it->status()) && listed.find(it->path().generic_u8string().substr(prefix_length + 1)) == listed.end())
+            {
+                unlisted.push_back(it->path());
+            }
+        }
+
+        for (const fs::path& pdb : unlisted)
+        {
+            std::error_code size_ec;
+            const uintmax_t size = fs::file_size(pdb, size_ec);
+            ++result.removed_count;
+            result.removed_size += size_ec ? 0 : size;
+            if (!dry_run)
+            {
+                remove_stored_pdb(pdb);
+            }
+        }
+        return result;
+    }
+
+    fs::path find_store_above(const fs::path& dir)
+    {
+        const fs::path root = Files::find_file_recursively_up(fs::absolute(dir), ".vcpkg-root");
+        if (root.empty())
+        {
+            return fs::path();
+        }
+
+        const fs::path store_dir = root / "installed" / "vcpkg" / "symbols";
+        std::error_code ec;
+        return fs::is_directory(store_dir, ec) ? store_dir : fs::path();
+    }
+
+    fs::path find_pdb(const fs::path& store_dir, const fs::path& image)
+    {
+        COFFFileReader::pdb_reference reference;
+        if (!COFFFileReader::read_pdb_reference(image, reference))
+        {
+            return fs::path();
+        }
+
+        const fs::path pdb = stored_path(store_dir, reference);
+        std::error_code ec;
+        return fs::exists(pdb, ec) ? pdb : fs::path();
+    }
+}}
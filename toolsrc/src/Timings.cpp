@@ -0,0 +1,99 @@
+#include "Timings.h"
+#include "vcpkg_System.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace vcpkg { namespace Timings
+{
+    static std::atomic<bool> g_enabled(false);
+
+    struct timings_state
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, totals> by_name;
+    };
+
+    // Never destroyed: the summary is printed from an atexit handler, which may run after the statics are gone
+    static timings_state& state()
+    {
+        static timings_state* s = new timings_state();
+        return *s;
+    }
+
+    void enable()
+    {
+        g_enabled = true;
+    }
+
+    bool is_enabled()
+    {
+        return g_enabled;
+    }
+
+    void record(const char* name, const std::chrono::nanoseconds elapsed)
+    {
+        timings_state& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        totals& t = s.by_name.emplace(name, totals{name, 0, std::chrono::nanoseconds(0), std::chrono::nanoseconds(0)}).first->second;
+        ++t.count;
+        t.total += elapsed;
+        t.max = std::max(t.max, elapsed);
+    }
+
+    std::vector<totals> get_totals()
+    {
+        std::vector<totals> result;
+        {
+            timings_state& s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            for (auto&& entry : s.by_name)
+            {
+                result.push_back(entry.second);
+            }
+        }
+
+        std::sort(result.begin(), result.end(), [](const totals& left, const totals& right) { return left.total > right.total; });
+        return result;
+    }
+
+    static double to_ms(const std::chrono::nanoseconds duration)
+    {
+        return static_cast<double>(duration.count()) / 1e6;
+    }
+
+    void print_summary()
+    {
+        const std::vector<totals> all = get_totals();
+        if (all.empty())
+        {
+            return;
+        }
+
+        // Totals of code running on several threads at once add up to more than the time the command took
+        System::println("\nTimings (summed over threads):");
+        System::println("  %-32s %8s %12s %12s", "", "count", "total ms", "max ms");
+        for (const totals& t : all)
+        {
+            System::println("  %-32s %8d %12.1f %12.1f", t.name, static_cast<int>(t.count), to_ms(t.total), to_ms(t.max));
+        }
+    }
+
+    scoped_timer::scoped_timer(const char* name) : m_name(name), m_stopwatch(Stopwatch::createUnstarted())
+    {
+        if (g_enabled)
+        {
+            m_stopwatch.start();
+        }
+    }
+
+    scoped_timer::~scoped_timer()
+    {
+        if (m_stopwatch.isRunning())
+        {
+            m_stopwatch.stop();
+            record(m_name, m_stopwatch.elapsed<std::chrono::nanoseconds>());
+        }
+    }
+}}
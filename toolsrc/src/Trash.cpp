@@ -0,0 +1,80 @@
+#include "Trash.h"
+#include "vcpkg_Strings.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <Windows.h>
+
+namespace vcpkg { namespace Trash
+{
+    bool move_to_trash(const vcpkg_paths& paths, const fs::path& directory)
+    {
+        static std::atomic<unsigned> next_id(0);
+
+        std::error_code ec;
+        if (!fs::exists(directory, ec))
+        {
+            return true;
+        }
+
+        fs::create_directories(paths.trash, ec);
+
+        // Unique among the processes sharing the trash, so that none of them moves a directory over another
+        const fs::path destination = paths.trash / Strings::format("%s.%d.%d", directory.filename().string(), static_cast<int>(GetCurrentProcessId()), static_cast<int>(next_id++));
+        fs::rename(directory, destination, ec);
+        return !ec;
+    }
+
+    static void empty_trash(const fs::path trash)
+    {
+        // Background mode lowers the I/O priority of the thread too, so that the deletes give way to the builds' reads and writes
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+        // The trash is listed again until nothing new turned up, as builds keep moving directories into it. What cannot be
+        // deleted, or is being deleted by another process, is tried once and left for the next run.
+        std::set<fs::path> attempted;
+        for (;;)
+        {
+            std::vector<fs::path> entries;
+            std::error_code ec;
+            for (auto it = fs::directory_iterator(trash, ec); !ec && it != fs::directory_iterator(); ++it)
+            {
+                if (attempted.insert(it->path()).second)
+                {
+                    entries.push_back(it->path());
+                }
+            }
+
+            if (entries.empty())
+            {
+                return;
+            }
+
+            for (const fs::path& entry : entries)
+            {
+                fs::remove_all(entry, ec);
+            }
+        }
+    }
+
+    void empty(const vcpkg_paths& paths)
+    {
+        std::error_code ec;
+        for (auto it = fs::directory_iterator(paths.trash, ec); !ec && it != fs::directory_iterator(); ++it)
+        {
+            std::error_code remove_ec;
+            fs::remove_all(it->path(), remove_ec);
+        }
+    }
+
+    void empty_in_background(const vcpkg_paths& paths)
+    {
+        static std::once_flag started;
+        std::call_once(started, [&]()
+            {
+                // Detached: vcpkg exits without waiting for it
+                std::thread(empty_trash, paths.trash).detach();
+            });
+    }
+}}
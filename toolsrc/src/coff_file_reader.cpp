@@ -1,263 +1,806 @@
 #include "coff_file_reader.h"
-#include <iostream>
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
+#include <cctype>
+#include <iterator>
 #include "vcpkg_Checks.h"
+#include "vcpkg_Files.h"
 #include <set>
-#include <fstream>
-
-using namespace std;
 
 namespace vcpkg {namespace COFFFileReader
 {
-    template <class T>
-    static T reinterpret_bytes(const char* data)
+    // A range of bytes inside a file mapped into memory. Headers are parsed in place; every read is bounds checked.
+    struct byte_range
     {
-        return (*reinterpret_cast<const T *>(&data[0]));
+        const char* begin;
+        const char* end;
+
+        size_t size() const
+        {
+            return static_cast<size_t>(end - begin);
+        }
+
+        bool contains(const size_t offset, const size_t length) const
+        {
+            return offset <= size() && length <= size() - offset;
+        }
+
+        byte_range subrange(const size_t offset, const size_t length) const
+        {
+            Checks::check_exit(contains(offset, length), "Unexpected end of file while reading COFF data");
+            return {begin + offset, begin + offset + length};
+        }
+
+        byte_range from(const size_t offset) const
+        {
+            return subrange(offset, size() - std::min(offset, size()));
+        }
+
+        template <class T>
+        T read(const size_t offset) const
+        {
+            const byte_range bytes = subrange(offset, sizeof(T));
+            T value;
+            memcpy(&value, bytes.begin, sizeof(T));
+            return value;
+        }
+    };
+
+    static void verify_equal_strings(const char* expected, const byte_range actual, const char* label)
+    {
+        Checks::check_exit(memcmp(expected, actual.begin, actual.size()) == 0, "Incorrect string (%s) found. Expected: %s but found %s", label, std::string(expected, actual.size()), std::string(actual.begin, actual.end));
     }
 
-    template <class T>
-    static T read_value_from_stream(fstream& fs)
+    static const size_t OFFSET_TO_PE_SIGNATURE_OFFSET = 0x3c;
+    static const char* PE_SIGNATURE = "PE\0\0";
+    static const size_t PE_SIGNATURE_SIZE = 4;
+
+    // Returns the contents of the file following the PE signature
+    static byte_range read_and_verify_PE_signature(const byte_range file)
     {
-        T data;
-        fs.read(reinterpret_cast<char*>(&data), sizeof data);
-        return data;
+        const uint32_t offset_to_PE_signature = file.read<uint32_t>(OFFSET_TO_PE_SIGNATURE_OFFSET);
+        verify_equal_strings(PE_SIGNATURE, file.subrange(offset_to_PE_signature, PE_SIGNATURE_SIZE), "PE_SIGNATURE");
+        return file.from(offset_to_PE_signature + PE_SIGNATURE_SIZE);
     }
 
-    template <class T>
-    static T peek_value_from_stream(fstream& fs)
+    // As read_and_verify_PE_signature, but returns false if the file is not an image
+    static bool try_read_PE_signature(const byte_range file, byte_range& after_signature)
     {
-        fpos_t original_pos = fs.tellg().seekpos();
-        T data;
-        fs.read(reinterpret_cast<char*>(&data), sizeof data);
-        fs.seekg(original_pos);
-        return data;
+        if (!file.contains(OFFSET_TO_PE_SIGNATURE_OFFSET, sizeof(uint32_t)))
+        {
+            return false;
+        }
+
+        const uint32_t offset_to_PE_signature = file.read<uint32_t>(OFFSET_TO_PE_SIGNATURE_OFFSET);
+        if (!file.contains(offset_to_PE_signature, PE_SIGNATURE_SIZE) || memcmp(file.begin + offset_to_PE_signature, PE_SIGNATURE, PE_SIGNATURE_SIZE) != 0)
+        {
+            return false;
+        }
+
+        after_signature = file.from(offset_to_PE_signature + PE_SIGNATURE_SIZE);
+        return true;
     }
 
-    static void verify_equal_strings(const char* expected, const char* actual, int size, const char* label)
+    static size_t align_to(const size_t unaligned_offset, const size_t alignment_size)
     {
-        Checks::check_exit(memcmp(expected, actual, size) == 0, "Incorrect string (%s) found. Expected: %s but found %s", label, expected, actual);
+        return (unaligned_offset + alignment_size - 1) / alignment_size * alignment_size;
     }
 
-    static void read_and_verify_PE_signature(fstream& fs)
+    struct coff_file_header
     {
-        static const size_t OFFSET_TO_PE_SIGNATURE_OFFSET = 0x3c;
+        static const size_t HEADER_SIZE = 20;
 
-        static const char* PE_SIGNATURE = "PE\0\0";
-        static const size_t PE_SIGNATURE_SIZE = 4;
+        explicit coff_file_header(const byte_range bytes) : data(bytes.subrange(0, HEADER_SIZE))
+        {
+        }
 
-        fs.seekg(OFFSET_TO_PE_SIGNATURE_OFFSET, ios_base::beg);
-        const int32_t offset_to_PE_signature = read_value_from_stream<int32_t>(fs);
+        MachineType machineType() const
+        {
+            static const size_t MACHINE_TYPE_OFFSET = 0;
+            return getMachineType(data.read<uint16_t>(MACHINE_TYPE_OFFSET));
+        }
 
-        fs.seekg(offset_to_PE_signature);
-        char signature[PE_SIGNATURE_SIZE];
-        fs.read(signature, PE_SIGNATURE_SIZE);
-        verify_equal_strings(PE_SIGNATURE, signature, PE_SIGNATURE_SIZE, "PE_SIGNATURE");
-        fs.seekg(offset_to_PE_signature + PE_SIGNATURE_SIZE, ios_base::beg);
-    }
+        uint16_t number_of_sections() const
+        {
+            static const size_t NUMBER_OF_SECTIONS_OFFSET = 2;
+            return data.read<uint16_t>(NUMBER_OF_SECTIONS_OFFSET);
+        }
+
+        uint16_t size_of_optional_header() const
+        {
+            static const size_t SIZE_OF_OPTIONAL_HEADER_OFFSET = 16;
+            return data.read<uint16_t>(SIZE_OF_OPTIONAL_HEADER_OFFSET);
+        }
+
+    private:
+        byte_range data;
+    };
 
-    static fpos_t align_to(const fpos_t unaligned_offset, const int alignment_size)
+    struct section_header
     {
-        fpos_t aligned_offset = unaligned_offset - 1;
-        aligned_offset /= alignment_size;
-        aligned_offset += 1;
-        aligned_offset *= alignment_size;
-        return aligned_offset;
+        static const size_t HEADER_SIZE = 40;
+
+        explicit section_header(const byte_range bytes) : data(bytes.subrange(0, HEADER_SIZE))
+        {
+        }
+
+        bool has_name(const char* name) const
+        {
+            static const size_t NAME_SIZE = 8;
+            const size_t length = strlen(name);
+            return length <= NAME_SIZE && memcmp(data.begin, name, length) == 0 && (length == NAME_SIZE || data.begin[length] == '\0');
+        }
+
+        uint32_t virtual_size() const
+        {
+            static const size_t VIRTUAL_SIZE_OFFSET = 8;
+            return data.read<uint32_t>(VIRTUAL_SIZE_OFFSET);
+        }
+
+        uint32_t virtual_address() const
+        {
+            static const size_t VIRTUAL_ADDRESS_OFFSET = 12;
+            return data.read<uint32_t>(VIRTUAL_ADDRESS_OFFSET);
+        }
+
+        uint32_t size_of_raw_data() const
+        {
+            static const size_t SIZE_OF_RAW_DATA_OFFSET = 16;
+            return data.read<uint32_t>(SIZE_OF_RAW_DATA_OFFSET);
+        }
+
+        uint32_t pointer_to_raw_data() const
+        {
+            static const size_t POINTER_TO_RAW_DATA_OFFSET = 20;
+            return data.read<uint32_t>(POINTER_TO_RAW_DATA_OFFSET);
+        }
+
+    private:
+        byte_range data;
+    };
+
+    // The section table follows the COFF header and the optional header
+    static section_header read_section_header(const byte_range after_coff_header, const coff_file_header& header, const size_t index)
+    {
+        return section_header(after_coff_header.from(header.size_of_optional_header() + index * section_header::HEADER_SIZE));
     }
 
-    struct coff_file_header
+    struct optional_header
     {
-        static const size_t HEADER_SIZE = 20;
+        explicit optional_header(const byte_range bytes) : data(bytes)
+        {
+        }
 
-        static coff_file_header read(fstream& fs)
+        bool is_app_container() const
         {
-            coff_file_header ret;
-            ret.data.resize(HEADER_SIZE);
-            fs.read(&ret.data[0], HEADER_SIZE);
-            return ret;
+            // Same offset in PE32 and PE32+
+            static const size_t DLL_CHARACTERISTICS_OFFSET = 70;
+            static const uint16_t IMAGE_DLLCHARACTERISTICS_APPCONTAINER = 0x1000;
+
+            if (data.size() < DLL_CHARACTERISTICS_OFFSET + sizeof(uint16_t))
+            {
+                return false;
+            }
+
+            const uint16_t dll_characteristics = data.read<uint16_t>(DLL_CHARACTERISTICS_OFFSET);
+            return (dll_characteristics & IMAGE_DLLCHARACTERISTICS_APPCONTAINER) != 0;
         }
 
-        static coff_file_header peek(fstream& fs)
+        // Returns the RVA of the data directory at index, or 0 if the image does not have it
+        uint32_t data_directory_rva(const size_t index) const
         {
-            auto original_pos = fs.tellg().seekpos();
-            coff_file_header ret = read(fs);
-            fs.seekg(original_pos);
-            return ret;
+            uint32_t size;
+            const uint32_t rva = data_directory(index, size);
+            return size == 0 ? 0 : rva;
         }
 
-        MachineType machineType() const
+        uint32_t export_table_rva() const
         {
-            static const size_t MACHINE_TYPE_OFFSET = 0;
-            static const size_t MACHINE_TYPE_SIZE = 2;
+            static const size_t EXPORT_TABLE_INDEX = 0;
+            return data_directory_rva(EXPORT_TABLE_INDEX);
+        }
+
+        uint32_t import_table_rva() const
+        {
+            static const size_t IMPORT_TABLE_INDEX = 1;
+            return data_directory_rva(IMPORT_TABLE_INDEX);
+        }
 
-            std::string machine_field_as_string = data.substr(MACHINE_TYPE_OFFSET, MACHINE_TYPE_SIZE);
-            const uint16_t machine = reinterpret_bytes<uint16_t>(machine_field_as_string.c_str());
-            return getMachineType(machine);
+        uint32_t debug_directory_rva(uint32_t& size) const
+        {
+            static const size_t DEBUG_DIRECTORY_INDEX = 6;
+            return data_directory(DEBUG_DIRECTORY_INDEX, size);
+        }
+
+        uint32_t delay_import_table_rva() const
+        {
+            static const size_t DELAY_IMPORT_DESCRIPTOR_INDEX = 13;
+            return data_directory_rva(DELAY_IMPORT_DESCRIPTOR_INDEX);
         }
 
     private:
-        std::string data;
+        // Every data directory is an RVA followed by a size; both are 0 if the image does not have it
+        uint32_t data_directory(const size_t index, uint32_t& size) const
+        {
+            static const size_t MAGIC_OFFSET = 0;
+            static const uint16_t PE32_MAGIC = 0x10b;
+            static const size_t PE32_DATA_DIRECTORIES_OFFSET = 96;
+            static const size_t PE32_PLUS_DATA_DIRECTORIES_OFFSET = 112;
+            static const size_t DATA_DIRECTORY_SIZE = 8;
+
+            size = 0;
+            if (data.size() < sizeof(uint16_t))
+            {
+                return 0;
+            }
+
+            const uint16_t magic = data.read<uint16_t>(MAGIC_OFFSET);
+            const size_t data_directories_offset = magic == PE32_MAGIC ? PE32_DATA_DIRECTORIES_OFFSET : PE32_PLUS_DATA_DIRECTORIES_OFFSET;
+            const size_t number_of_rva_and_sizes_offset = data_directories_offset - sizeof(uint32_t);
+            const size_t directory_offset = data_directories_offset + index * DATA_DIRECTORY_SIZE;
+            if (data.size() < directory_offset + DATA_DIRECTORY_SIZE || data.read<uint32_t>(number_of_rva_and_sizes_offset) <= index)
+            {
+                return 0;
+            }
+
+            size = data.read<uint32_t>(directory_offset + sizeof(uint32_t));
+            return data.read<uint32_t>(directory_offset);
+        }
+
+        byte_range data;
     };
 
     struct archive_member_header
     {
         static const size_t HEADER_SIZE = 60;
 
-        static archive_member_header read(fstream& fs)
+        explicit archive_member_header(const byte_range bytes) : data(bytes.subrange(0, HEADER_SIZE))
         {
             static const size_t HEADER_END_OFFSET = 58;
             static const char* HEADER_END = "`\n";
             static const size_t HEADER_END_SIZE = 2;
 
-            archive_member_header ret;
-            ret.data.resize(HEADER_SIZE);
-            fs.read(&ret.data[0], HEADER_SIZE);
-
-            const std::string header_end = ret.data.substr(HEADER_END_OFFSET, HEADER_END_SIZE);
-            verify_equal_strings(HEADER_END, header_end.c_str(), HEADER_END_SIZE, "LIB HEADER_END");
+            verify_equal_strings(HEADER_END, data.subrange(HEADER_END_OFFSET, HEADER_END_SIZE), "LIB HEADER_END");
+        }
 
-            return ret;
+        bool is_linker_member() const
+        {
+            return data.begin[0] == '/' && data.begin[1] == ' ';
         }
 
-        std::string name() const
+        bool is_longnames_member() const
         {
-            static const size_t HEADER_NAME_OFFSET = 0;
-            static const size_t HEADER_NAME_SIZE = 16;
-            return data.substr(HEADER_NAME_OFFSET, HEADER_NAME_SIZE);
+            return data.begin[0] == '/' && data.begin[1] == '/';
         }
 
-        uint64_t member_size() const
+        size_t member_size() const
         {
             static const size_t HEADER_SIZE_OFFSET = 48;
             static const size_t HEADER_SIZE_FIELD_SIZE = 10;
-            const std::string as_string = data.substr(HEADER_SIZE_OFFSET, HEADER_SIZE_FIELD_SIZE);
-            // This is in ASCII decimal representation
-            const uint64_t value = std::strtoull(as_string.c_str(), nullptr, 10);
+
+            // This is in ASCII decimal representation, padded with spaces
+            size_t value = 0;
+            const byte_range field = data.subrange(HEADER_SIZE_OFFSET, HEADER_SIZE_FIELD_SIZE);
+            for (const char* c = field.begin; c != field.end && *c >= '0' && *c <= '9'; ++c)
+            {
+                value = value * 10 + static_cast<size_t>(*c - '0');
+            }
             return value;
         }
 
-        std::string data;
+    private:
+        byte_range data;
     };
 
     struct import_header
     {
         static const size_t HEADER_SIZE = 20;
 
-        static import_header read(fstream& fs)
+        explicit import_header(const byte_range bytes) : data(bytes.subrange(0, HEADER_SIZE))
         {
             static const size_t SIG1_OFFSET = 0;
             static const uint16_t SIG1 = static_cast<uint16_t>(MachineType::UNKNOWN);
-            static const size_t SIG1_SIZE = 2;
 
             static const size_t SIG2_OFFSET = 2;
             static const uint16_t SIG2 = 0xFFFF;
-            static const size_t SIG2_SIZE = 2;
-
-            import_header ret;
-            ret.data.resize(HEADER_SIZE);
-            fs.read(&ret.data[0], HEADER_SIZE);
 
-            const std::string sig1_as_string = ret.data.substr(SIG1_OFFSET, SIG1_SIZE);
-            const uint16_t sig1 = reinterpret_bytes<uint16_t>(sig1_as_string.c_str());
+            const uint16_t sig1 = data.read<uint16_t>(SIG1_OFFSET);
             Checks::check_exit(sig1 == SIG1, "Sig1 was incorrect. Expected %s but got %s", SIG1, sig1);
 
-            const std::string sig2_as_string = ret.data.substr(SIG2_OFFSET, SIG2_SIZE);
-            const uint16_t sig2 = reinterpret_bytes<uint16_t>(sig2_as_string.c_str());
+            const uint16_t sig2 = data.read<uint16_t>(SIG2_OFFSET);
             Checks::check_exit(sig2 == SIG2, "Sig2 was incorrect. Expected %s but got %s", SIG2, sig2);
-
-            return ret;
-        }
-
-        static import_header peek(fstream& fs)
-        {
-            auto original_pos = fs.tellg().seekpos();
-            import_header ret = read(fs);
-            fs.seekg(original_pos);
-            return ret;
         }
 
         MachineType machineType() const
         {
             static const size_t MACHINE_TYPE_OFFSET = 6;
-            static const size_t MACHINE_TYPE_SIZE = 2;
-
-            std::string machine_field_as_string = data.substr(MACHINE_TYPE_OFFSET, MACHINE_TYPE_SIZE);
-            const uint16_t machine = reinterpret_bytes<uint16_t>(machine_field_as_string.c_str());
-            return getMachineType(machine);
+            return getMachineType(data.read<uint16_t>(MACHINE_TYPE_OFFSET));
         }
 
     private:
-        std::string data;
+        byte_range data;
     };
 
-    static void skip_archive_member(fstream& fs, uint64_t member_size)
+    // Returns the member contents and advances archive to the next member header
+    static byte_range read_archive_member(byte_range& archive, archive_member_header& header)
     {
         static const size_t ALIGNMENT_SIZE = 2;
 
-        const fpos_t new_offset = align_to(member_size, ALIGNMENT_SIZE);
-        fs.seekg(new_offset, ios_base::cur);
+        header = archive_member_header(archive);
+        const byte_range member = archive.subrange(archive_member_header::HEADER_SIZE, header.member_size());
+        archive = archive.from(std::min(archive.size(), archive_member_header::HEADER_SIZE + align_to(header.member_size(), ALIGNMENT_SIZE)));
+        return member;
     }
 
-    static void read_and_verify_archive_file_signature(fstream& fs)
+    static byte_range read_and_verify_archive_file_signature(const byte_range file)
     {
         static const char* FILE_START = "!<arch>\n";
         static const size_t FILE_START_SIZE = 8;
 
-        fs.seekg(fs.beg);
+        verify_equal_strings(FILE_START, file.subrange(0, FILE_START_SIZE), "LIB FILE_START");
+        return file.from(FILE_START_SIZE);
+    }
 
-        char file_start[FILE_START_SIZE];
-        fs.read(file_start, FILE_START_SIZE);
-        verify_equal_strings(FILE_START, file_start, FILE_START_SIZE, "LIB FILE_START");
+    // Translates an RVA into an offset in the file using the section table. Returns false if no section contains it.
+    static bool rva_to_file_offset(const uint32_t rva, const byte_range after_coff_header, const coff_file_header& header, size_t& offset)
+    {
+        for (uint16_t i = 0; i < header.number_of_sections(); ++i)
+        {
+            const section_header section = read_section_header(after_coff_header, header, i);
+            const uint32_t section_size = std::max(section.virtual_size(), section.size_of_raw_data());
+            if (rva < section.virtual_address() || rva >= section.virtual_address() + section_size)
+            {
+                continue;
+            }
+
+            offset = section.pointer_to_raw_data() + (rva - section.virtual_address());
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool has_exports(const byte_range file, const optional_header& opt_header, const byte_range after_coff_header, const coff_file_header& header)
+    {
+        static const size_t NUMBER_OF_FUNCTIONS_OFFSET = 20;
+
+        const uint32_t export_table_rva = opt_header.export_table_rva();
+        size_t export_table_offset;
+        if (export_table_rva == 0 || !rva_to_file_offset(export_table_rva, after_coff_header, header, export_table_offset))
+        {
+            return false;
+        }
+
+        return file.read<uint32_t>(export_table_offset + NUMBER_OF_FUNCTIONS_OFFSET) != 0;
+    }
+
+    static std::string read_c_string(const byte_range file, const size_t offset)
+    {
+        const byte_range rest = file.from(offset);
+        const char* end = std::find(rest.begin, rest.end, '\0');
+        Checks::check_exit(end != rest.end, "Unexpected end of file while reading COFF data");
+        return std::string(rest.begin, end);
+    }
+
+    // Both tables are arrays of fixed size descriptors that end with a zeroed one; only the DLL name RVA is needed here
+    static void read_import_descriptor_names(const byte_range file, const uint32_t table_rva, const size_t descriptor_size, const size_t name_rva_offset,
+                                             const byte_range after_coff_header, const coff_file_header& header, std::vector<std::string>& names)
+    {
+        size_t table_offset;
+        if (table_rva == 0 || !rva_to_file_offset(table_rva, after_coff_header, header, table_offset))
+        {
+            return;
+        }
+
+        for (size_t descriptor = table_offset;; descriptor += descriptor_size)
+        {
+            const uint32_t name_rva = file.read<uint32_t>(descriptor + name_rva_offset);
+            size_t name_offset;
+            if (name_rva == 0 || !rva_to_file_offset(name_rva, after_coff_header, header, name_offset))
+            {
+                return;
+            }
+
+            names.push_back(read_c_string(file, name_offset));
+        }
+    }
+
+    // Extracts the library names of the /DEFAULTLIB options in the contents of a .drectve section
+    static void parse_default_libs(const byte_range directives, std::set<std::string>& default_libs)
+    {
+        static const char* DEFAULTLIB = "/DEFAULTLIB:";
+        static const size_t DEFAULTLIB_SIZE = strlen(DEFAULTLIB);
+
+        auto is_separator = [](const char c) { return c == ' ' || c == '\t' || c == '\0'; };
+
+        const char* cur = directives.begin;
+        while (cur != directives.end)
+        {
+            while (cur != directives.end && is_separator(*cur))
+            {
+                ++cur;
+            }
+
+            // Options are separated by spaces; quotes protect spaces inside an argument
+            const char* option_begin = cur;
+            bool in_quotes = false;
+            for (; cur != directives.end && (in_quotes || !is_separator(*cur)); ++cur)
+            {
+                if (*cur == '"')
+                {
+                    in_quotes = !in_quotes;
+                }
+            }
+
+            const size_t option_size = static_cast<size_t>(cur - option_begin);
+            if (option_size <= DEFAULTLIB_SIZE || _strnicmp(option_begin, DEFAULTLIB, DEFAULTLIB_SIZE) != 0)
+            {
+                continue;
+            }
+
+            std::string lib;
+            std::remove_copy(option_begin + DEFAULTLIB_SIZE, cur, std::back_inserter(lib), '"');
+            if (lib.size() > 4 && _stricmp(lib.c_str() + lib.size() - 4, ".lib") == 0)
+            {
+                lib.resize(lib.size() - 4);
+            }
+            std::transform(lib.begin(), lib.end(), lib.begin(), ::toupper);
+            default_libs.insert(lib);
+        }
+    }
+
+    static void read_section_default_libs(const byte_range member, const byte_range section_table, const size_t number_of_sections, std::set<std::string>& default_libs)
+    {
+        static const char* DRECTVE_SECTION_NAME = ".drectve";
+
+        for (size_t i = 0; i < number_of_sections; ++i)
+        {
+            const section_header section(section_table.from(i * section_header::HEADER_SIZE));
+            if (section.has_name(DRECTVE_SECTION_NAME) && section.size_of_raw_data() != 0)
+            {
+                parse_default_libs(member.subrange(section.pointer_to_raw_data(), section.size_of_raw_data()), default_libs);
+            }
+        }
+    }
+
+    static void read_object_default_libs(const byte_range member, std::set<std::string>& default_libs)
+    {
+        const coff_file_header header(member);
+        const byte_range after_coff_header = member.from(coff_file_header::HEADER_SIZE);
+        read_section_default_libs(member, after_coff_header.from(header.size_of_optional_header()), header.number_of_sections(), default_libs);
+    }
+
+    // Members that start like an import header are import headers (version 0) or anonymous objects: ANON_OBJECT_HEADER,
+    // whose class ID tells what follows. Objects compiled with /bigobj are anonymous objects with their own layout of the
+    // COFF header; the others, like the intermediate code of /GL compiles, have no sections to read.
+    struct anon_object_header
+    {
+        static const size_t VERSION_OFFSET = 4;
+
+        explicit anon_object_header(const byte_range bytes) : data(bytes)
+        {
+        }
+
+        uint16_t version() const
+        {
+            return data.read<uint16_t>(VERSION_OFFSET);
+        }
+
+        bool is_bigobj() const
+        {
+            // {D1BAA1C7-BAEE-4ba9-AF20-FAF66AA4DCB8}, as stored
+            static const char BIGOBJ_CLASS_ID[] = "\xC7\xA1\xBA\xD1\xEE\xBA\xA9\x4B\xAF\x20\xFA\xF6\x6A\xA4\xDC\xB8";
+            static const size_t CLASS_ID_OFFSET = 12;
+            static const size_t CLASS_ID_SIZE = 16;
+            static const uint16_t BIGOBJ_VERSION = 2;
+
+            return version() >= BIGOBJ_VERSION && data.size() >= BIGOBJ_HEADER_SIZE
+                && memcmp(data.subrange(CLASS_ID_OFFSET, CLASS_ID_SIZE).begin, BIGOBJ_CLASS_ID, CLASS_ID_SIZE) == 0;
+        }
+
+        // ANON_OBJECT_HEADER_BIGOBJ: the section table follows the header
+        void read_bigobj_default_libs(std::set<std::string>& default_libs) const
+        {
+            static const size_t NUMBER_OF_SECTIONS_OFFSET = 44;
+
+            const size_t number_of_sections = data.read<uint32_t>(NUMBER_OF_SECTIONS_OFFSET);
+            read_section_default_libs(data, data.from(BIGOBJ_HEADER_SIZE), number_of_sections, default_libs);
+        }
+
+    private:
+        static const size_t BIGOBJ_HEADER_SIZE = 56;
+
+        byte_range data;
+    };
+
+    // Returns false if the file cannot be opened, e.g. when it is empty
+    static bool try_map_file(const fs::path& path, Files::mapped_file& mapping, byte_range& file)
+    {
+        expected<Files::mapped_file> maybe_mapping = Files::mapped_file::open(path);
+        if (maybe_mapping.get() == nullptr)
+        {
+            return false;
+        }
+
+        mapping = std::move(*maybe_mapping.get());
+        file = {mapping.data(), mapping.data() + mapping.size()};
+        return true;
+    }
+
+    static byte_range map_file(const fs::path& path, Files::mapped_file& mapping)
+    {
+        byte_range file;
+        Checks::check_exit(try_map_file(path, mapping, file), "Could not open file %s for reading", path.generic_string());
+        return file;
     }
 
     dll_info read_dll(const fs::path path)
     {
-        std::fstream fs(path, std::ios::in | std::ios::binary | std::ios::ate);
-        Checks::check_exit(fs.is_open(), "Could not open file %s for reading", path.generic_string());
+        Files::mapped_file mapping;
+        const byte_range file = map_file(path, mapping);
 
-        read_and_verify_PE_signature(fs);
-        coff_file_header header = coff_file_header::read(fs);
-        MachineType machine = header.machineType();
-        return {machine};
+        const byte_range after_signature = read_and_verify_PE_signature(file);
+        const coff_file_header header(after_signature);
+        const MachineType machine = header.machineType();
+
+        const byte_range after_coff_header = after_signature.from(coff_file_header::HEADER_SIZE);
+        const optional_header opt_header(after_coff_header.subrange(0, header.size_of_optional_header()));
+
+        return {machine, has_exports(file, opt_header, after_coff_header, header), opt_header.is_app_container()};
     }
 
-    lib_info read_lib(const fs::path path)
+    bool read_pdb_reference(const fs::path path, pdb_reference& reference)
+    {
+        static const size_t DEBUG_DIRECTORY_ENTRY_SIZE = 28;
+        static const size_t TYPE_OFFSET = 12;
+        static const size_t SIZE_OF_DATA_OFFSET = 16;
+        static const size_t POINTER_TO_RAW_DATA_OFFSET = 24;
+        static const uint32_t IMAGE_DEBUG_TYPE_CODEVIEW = 2;
+
+        // "RSDS", the GUID, the age, then the path of the PDB
+        static const char* RSDS_SIGNATURE = "RSDS";
+        static const size_t RSDS_SIGNATURE_SIZE = 4;
+        static const size_t RSDS_GUID_OFFSET = 4;
+        static const size_t RSDS_GUID_SIZE = 16;
+        static const size_t RSDS_AGE_OFFSET = 20;
+        static const size_t RSDS_PATH_OFFSET = 24;
+
+        // Any file may be given, so every read is checked here rather than ending the process on malformed data
+        Files::mapped_file mapping;
+        byte_range file;
+        byte_range after_signature;
+        if (!try_map_file(path, mapping, file) || !try_read_PE_signature(file, after_signature) || !after_signature.contains(0, coff_file_header::HEADER_SIZE))
+        {
+            return false;
+        }
+
+        const coff_file_header header(after_signature);
+        const byte_range after_coff_header = after_signature.from(coff_file_header::HEADER_SIZE);
+        const size_t section_table_size = static_cast<size_t>(header.number_of_sections()) * section_header::HEADER_SIZE;
+        if (!after_coff_header.contains(header.size_of_optional_header(), section_table_size))
+        {
+            return false;
+        }
+        const optional_header opt_header(after_coff_header.subrange(0, header.size_of_optional_header()));
+
+        uint32_t directory_size;
+        const uint32_t directory_rva = opt_header.debug_directory_rva(directory_size);
+        size_t directory_offset;
+        if (directory_rva == 0 || directory_size == 0 || !rva_to_file_offset(directory_rva, after_coff_header, header, directory_offset)
+            || !file.contains(directory_offset, directory_size))
+        {
+            return false;
+        }
+
+        const byte_range directory = file.subrange(directory_offset, directory_size);
+        for (size_t entry = 0; entry + DEBUG_DIRECTORY_ENTRY_SIZE <= directory.size(); entry += DEBUG_DIRECTORY_ENTRY_SIZE)
+        {
+            if (directory.read<uint32_t>(entry + TYPE_OFFSET) != IMAGE_DEBUG_TYPE_CODEVIEW)
+            {
+                continue;
+            }
+
+            const uint32_t record_offset = directory.read<uint32_t>(entry + POINTER_TO_RAW_DATA_OFFSET);
+            const uint32_t record_size = directory.read<uint32_t>(entry + SIZE_OF_DATA_OFFSET);
+            if (!file.contains(record_offset, record_size))
+            {
+                continue;
+            }
+
+            const byte_range record = file.subrange(record_offset, record_size);
+            if (record.size() <= RSDS_PATH_OFFSET || memcmp(record.begin, RSDS_SIGNATURE, RSDS_SIGNATURE_SIZE) != 0)
+            {
+                continue;
+            }
+
+            const byte_range record_path = record.from(RSDS_PATH_OFFSET);
+            const char* path_end = std::find(record_path.begin, record_path.end, '\0');
+            if (path_end == record_path.end)
+            {
+                continue;
+            }
+
+            reference.guid.assign(record.begin + RSDS_GUID_OFFSET, RSDS_GUID_SIZE);
+            reference.age = record.read<uint32_t>(RSDS_AGE_OFFSET);
+            reference.path.assign(record_path.begin, path_end);
+            return true;
+        }
+
+        return false;
+    }
+
+    bool read_pdb_guid(const fs::path path, std::string& guid)
+    {
+        // The superblock: the magic, then the block size, the free block map, the number of blocks, the size of the
+        // stream directory, a reserved field and the block that lists the blocks of the stream directory
+        static const char MSF_MAGIC[] = "Microsoft C/C++ MSF 7.00\r\n\x1a" "DS\0\0";
+        static const size_t SUPERBLOCK_SIZE = 56;
+        static const size_t BLOCK_SIZE_OFFSET = 32;
+        static const size_t DIRECTORY_SIZE_OFFSET = 44;
+        static const size_t BLOCK_MAP_ADDRESS_OFFSET = 52;
+
+        // Stream 1 starts with the version, the signature, the age and the GUID
+        static const size_t PDB_INFO_STREAM = 1;
+        static const size_t PDB_INFO_GUID_OFFSET = 12;
+        static const size_t PDB_INFO_GUID_SIZE = 16;
+        static const uint32_t NIL_STREAM_SIZE = 0xFFFFFFFF;
+
+        expected<Files::mapped_file> maybe_mapping = Files::mapped_file::open(path);
+        const Files::mapped_file* mapping = maybe_mapping.get();
+        if (mapping == nullptr || mapping->size() < SUPERBLOCK_SIZE || memcmp(mapping->data(), MSF_MAGIC, sizeof(MSF_MAGIC)) != 0)
+        {
+            return false;
+        }
+
+        const byte_range file = {mapping->data(), mapping->data() + mapping->size()};
+        const uint32_t block_size = file.read<uint32_t>(BLOCK_SIZE_OFFSET);
+        const uint32_t directory_size = file.read<uint32_t>(DIRECTORY_SIZE_OFFSET);
+        if (block_size < SUPERBLOCK_SIZE || (block_size & (block_size - 1)) != 0)
+        {
+            return false;
+        }
+
+        // Nothing read from the PDB is trusted: a block past the end of the file means it is not a PDB after all
+        auto block_at = [&](const uint32_t index, byte_range& block)
+            {
+                const uint64_t offset = static_cast<uint64_t>(index) * block_size;
+                if (offset >= file.size())
+                    return false;
+                block = {file.begin + offset, file.begin + std::min(static_cast<uint64_t>(file.size()), offset + block_size)};
+                return true;
+            };
+        auto uint32_at = [](const std::string& bytes, const size_t offset, uint32_t& value)
+            {
+                if (offset + sizeof(uint32_t) > bytes.size())
+                    return false;
+                memcpy(&value, bytes.data() + offset, sizeof(uint32_t));
+                return true;
+            };
+
+        byte_range block_map;
+        const size_t directory_block_count = (static_cast<size_t>(directory_size) + block_size - 1) / block_size;
+        if (!block_at(file.read<uint32_t>(BLOCK_MAP_ADDRESS_OFFSET), block_map) || block_map.size() < directory_block_count * sizeof(uint32_t))
+        {
+            return false;
+        }
+
+        std::string directory;
+        for (size_t i = 0; i < directory_block_count; ++i)
+        {
+            byte_range block;
+            if (!block_at(block_map.read<uint32_t>(i * sizeof(uint32_t)), block))
+                return false;
+            directory.append(block.begin, block.end);
+        }
+        directory.resize(std::min(directory.size(), static_cast<size_t>(directory_size)));
+
+        // The number of streams, their sizes, then the blocks of each stream in turn
+        uint32_t stream_count;
+        if (!uint32_at(directory, 0, stream_count) || stream_count <= PDB_INFO_STREAM)
+        {
+            return false;
+        }
+
+        size_t blocks_offset = sizeof(uint32_t) * (1 + static_cast<size_t>(stream_count));
+        uint32_t info_stream_size;
+        for (size_t stream = 0; stream < PDB_INFO_STREAM; ++stream)
+        {
+            uint32_t stream_size;
+            if (!uint32_at(directory, sizeof(uint32_t) * (1 + stream), stream_size))
+                return false;
+            if (stream_size != NIL_STREAM_SIZE)
+                blocks_offset += sizeof(uint32_t) * ((static_cast<size_t>(stream_size) + block_size - 1) / block_size);
+        }
+
+        uint32_t info_stream_block;
+        byte_range info_stream;
+        if (!uint32_at(directory, sizeof(uint32_t) * (1 + PDB_INFO_STREAM), info_stream_size) || info_stream_size == NIL_STREAM_SIZE
+            || info_stream_size < PDB_INFO_GUID_OFFSET + PDB_INFO_GUID_SIZE || !uint32_at(directory, blocks_offset, info_stream_block)
+            || !block_at(info_stream_block, info_stream) || info_stream.size() < PDB_INFO_GUID_OFFSET + PDB_INFO_GUID_SIZE)
+        {
+            return false;
+        }
+
+        guid.assign(info_stream.begin + PDB_INFO_GUID_OFFSET, PDB_INFO_GUID_SIZE);
+        return true;
+    }
+
+    std::vector<std::string> read_dll_imports(const fs::path path)
     {
-        std::fstream fs(path, std::ios::in | std::ios::binary | std::ios::ate);
-        Checks::check_exit(fs.is_open(), "Could not open file %s for reading", path.generic_string());
+        static const size_t IMPORT_DESCRIPTOR_SIZE = 20;
+        static const size_t IMPORT_DESCRIPTOR_NAME_OFFSET = 12;
+        static const size_t DELAY_IMPORT_DESCRIPTOR_SIZE = 32;
+        static const size_t DELAY_IMPORT_DESCRIPTOR_NAME_OFFSET = 4;
+
+        Files::mapped_file mapping;
+        const byte_range file = map_file(path, mapping);
+
+        const byte_range after_signature = read_and_verify_PE_signature(file);
+        const coff_file_header header(after_signature);
+        const byte_range after_coff_header = after_signature.from(coff_file_header::HEADER_SIZE);
+        const optional_header opt_header(after_coff_header.subrange(0, header.size_of_optional_header()));
+
+        std::vector<std::string> names;
+        read_import_descriptor_names(file, opt_header.import_table_rva(), IMPORT_DESCRIPTOR_SIZE, IMPORT_DESCRIPTOR_NAME_OFFSET, after_coff_header, header, names);
+        read_import_descriptor_names(file, opt_header.delay_import_table_rva(), DELAY_IMPORT_DESCRIPTOR_SIZE, DELAY_IMPORT_DESCRIPTOR_NAME_OFFSET, after_coff_header, header, names);
+        return names;
+    }
 
-        read_and_verify_archive_file_signature(fs);
+    lib_info read_lib(const fs::path path)
+    {
+        Files::mapped_file mapping;
+        byte_range archive = read_and_verify_archive_file_signature(map_file(path, mapping));
+        archive_member_header header(archive);
 
         // First Linker Member
-        const archive_member_header first_linker_member_header = archive_member_header::read(fs);
-        Checks::check_exit(first_linker_member_header.name().substr(0, 2) == "/ ", "Could not find proper first linker member");
-        skip_archive_member(fs, first_linker_member_header.member_size());
+        read_archive_member(archive, header);
+        Checks::check_exit(header.is_linker_member(), "Could not find proper first linker member");
 
-        const archive_member_header second_linker_member_header = archive_member_header::read(fs);
-        Checks::check_exit(second_linker_member_header.name().substr(0, 2) == "/ ", "Could not find proper second linker member");
+        const byte_range second_linker_member = read_archive_member(archive, header);
+        Checks::check_exit(header.is_linker_member(), "Could not find proper second linker member");
         // The first 4 bytes contains the number of archive members
-        const uint32_t archive_member_count = peek_value_from_stream<uint32_t>(fs);
-        skip_archive_member(fs, second_linker_member_header.member_size());
+        const uint32_t archive_member_count = second_linker_member.read<uint32_t>(0);
 
-        bool hasLongnameMemberHeader = peek_value_from_stream<uint16_t>(fs) == 0x2F2F;
-        if (hasLongnameMemberHeader)
+        if (archive.size() >= archive_member_header::HEADER_SIZE && archive_member_header(archive).is_longnames_member())
         {
-            const archive_member_header longnames_member_header = archive_member_header::read(fs);
-            skip_archive_member(fs, longnames_member_header.member_size());
+            read_archive_member(archive, header);
         }
 
         std::set<MachineType> machine_types;
+        std::set<std::string> default_libs;
+        bool has_ltcg_objects = false;
         // Next we have the obj and pseudo-object files
         for (uint32_t i = 0; i < archive_member_count; i++)
         {
-            const archive_member_header header = archive_member_header::read(fs);
-            const uint16_t first_two_bytes = peek_value_from_stream<uint16_t>(fs);
+            const byte_range member = read_archive_member(archive, header);
+            const uint16_t first_two_bytes = member.read<uint16_t>(0);
             const bool isImportHeader = getMachineType(first_two_bytes) == MachineType::UNKNOWN;
-            const MachineType machine = isImportHeader ? import_header::peek(fs).machineType() : coff_file_header::peek(fs).machineType();
-            machine_types.insert(machine);
-            skip_archive_member(fs, header.member_size());
+            if (isImportHeader)
+            {
+                // Anonymous objects keep the machine type where import headers do
+                machine_types.insert(import_header(member).machineType());
+                const anon_object_header anon_header(member);
+                if (anon_header.version() == 0)
+                {
+                    continue;
+                }
+                if (anon_header.is_bigobj())
+                {
+                    anon_header.read_bigobj_default_libs(default_libs);
+                }
+                else
+                {
+                    has_ltcg_objects = true;
+                }
+            }
+            else
+            {
+                machine_types.insert(coff_file_header(member).machineType());
+                read_object_default_libs(member, default_libs);
+            }
         }
 
-        return {std::vector<MachineType>(machine_types.cbegin(), machine_types.cend())};
+        return {std::vector<MachineType>(machine_types.cbegin(), machine_types.cend()), std::vector<std::string>(default_libs.cbegin(), default_libs.cend()), has_ltcg_objects};
     }
 }}
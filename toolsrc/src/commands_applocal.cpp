@@ -0,0 +1,119 @@
+#include "vcpkg_Commands.h"
+#include "vcpkg_System.h"
+#include "vcpkg_Strings.h"
+#include "coff_file_reader.h"
+#include "vcpkg_ImportGraph.h"
+#include "SymbolStore.h"
+#include <fstream>
+
+namespace fs = std::tr2::sys;
+
+namespace vcpkg
+{
+    namespace
+    {
+        std::string get_mtime(const fs::path& file, std::error_code& ec)
+        {
+            const auto mtime = fs::last_write_time(file, ec);
+            return ec ? std::string() : std::to_string(mtime.time_since_epoch().count());
+        }
+
+        // Copies source over destination unless destination already carries the same size and timestamp.
+        // copy_file keeps the timestamp of the source, so the next build skips the file.
+        void deploy(const ImportGraph::dll_node& source, const fs::path& destination)
+        {
+            std::error_code ec;
+            const uintmax_t destination_size = fs::file_size(destination, ec);
+            if (!ec && std::to_string(destination_size) == source.size && get_mtime(destination, ec) == source.mtime && !ec)
+            {
+                return;
+            }
+
+            fs::copy_file(source.path, destination, fs::copy_options::overwrite_existing, ec);
+            Checks::check_exit(!ec, "Failed to copy %s to %s: %s", source.path.generic_string(), destination.generic_string(), ec.message());
+        }
+
+        // As deploy, for the PDB of a deployed DLL kept in the symbol store
+        void deploy_pdb(const fs::path& source, const fs::path& destination)
+        {
+            std::error_code ec;
+            const uintmax_t source_size = fs::file_size(source, ec);
+            const std::string source_mtime = get_mtime(source, ec);
+            const uintmax_t destination_size = fs::file_size(destination, ec);
+            if (!ec && destination_size == source_size && get_mtime(destination, ec) == source_mtime && !ec)
+            {
+                return;
+            }
+
+            fs::copy_file(source, destination, fs::copy_options::overwrite_existing, ec);
+            Checks::check_exit(!ec, "Failed to copy %s to %s: %s", source.generic_string(), destination.generic_string(), ec.message());
+        }
+
+        // MSBuild writes its tlogs as UTF-16, so lines are appended in the same encoding
+        void append_to_tlog(const fs::path& tlog_file, const std::vector<fs::path>& deployed)
+        {
+            std::ofstream os(tlog_file, std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+            for (const fs::path& file : deployed)
+            {
+                const std::wstring line = file.wstring() + L"\r\n";
+                os.write(reinterpret_cast<const char*>(line.data()), line.size() * sizeof(wchar_t));
+            }
+        }
+    }
+
+    void applocal_command(const vcpkg_cmd_arguments& args)
+    {
+        static const std::string example = Strings::format(
+            "The arguments should be the built binary and the bin directory of the installed triplet, optionally followed by a tlog file\n%s",
+            create_example_string(R"(applocal bin\app.exe C:\vcpkg\installed\x86-windows\bin)"));
+        args.check_min_arg_count(2, example.c_str());
+        args.check_max_arg_count(3, example.c_str());
+
+        const fs::path target_binary = fs::absolute(args.command_arguments[0]);
+        const fs::path bin_dir = args.command_arguments[1];
+        Checks::check_exit(fs::exists(target_binary), "Could not find %s", target_binary.generic_string());
+
+        const fs::path target_dir = target_binary.parent_path();
+
+        // The graph file is normally written when packages are installed; DLLs it does not cover are parsed here once
+        ImportGraph::graph dlls;
+        bool graph_changed = !ImportGraph::load(bin_dir, dlls);
+        const std::vector<const ImportGraph::dll_node*> needed = ImportGraph::closure(dlls, COFFFileReader::read_dll_imports(target_binary), graph_changed);
+        if (graph_changed)
+        {
+            ImportGraph::store(bin_dir, dlls);
+        }
+
+        // The PDBs of the DLLs are not installed next to them when vcpkg keeps them in its symbol store
+        const fs::path symbol_store = SymbolStore::find_store_above(bin_dir);
+
+        std::vector<fs::path> deployed;
+        for (const ImportGraph::dll_node* dll : needed)
+        {
+            const fs::path destination = target_dir / dll->path.filename();
+            deploy(*dll, destination);
+            deployed.push_back(destination);
+
+            const fs::path pdb = symbol_store.empty() ? fs::path() : SymbolStore::find_pdb(symbol_store, dll->path);
+            if (!pdb.empty())
+            {
+                const fs::path pdb_destination = target_dir / pdb.filename();
+                deploy_pdb(pdb, pdb_destination);
+                deployed.push_back(pdb_destination);
+            }
+        }
+
+        // Printed one per line so vcpkg.targets can pick them up as ReferenceCopyLocalPaths
+        for (const fs::path& file : deployed)
+        {
+            System::println(file.string().c_str());
+        }
+
+        if (args.command_arguments.size() == 3)
+        {
+            append_to_tlog(args.command_arguments[2], deployed);
+        }
+
+        exit(EXIT_SUCCESS);
+    }
+}
@@ -0,0 +1,27 @@
+#include "vcpkg_Commands.h"
+#include "vcpkg_Server.h"
+#include <fstream>
+#include <iostream>
+
+namespace vcpkg
+{
+    void batch_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        static const std::string example = Strings::format(
+            "The argument should be a file of queries such as \"owns --exact x86-windows/bin/zlib1.dll\", one per line, "
+            "or no argument to read them from stdin.\n%s", create_example_string("batch queries.txt"));
+        args.check_max_arg_count(1, example.c_str());
+
+        if (args.command_arguments.empty() || args.command_arguments[0] == "-")
+        {
+            Server::run_batch(paths, std::cin);
+        }
+        else
+        {
+            std::ifstream queries(fs::path(Strings::utf8_to_utf16(args.command_arguments[0])));
+            Checks::check_exit(queries.is_open(), "Error: could not open %s", args.command_arguments[0]);
+            Server::run_batch(paths, queries);
+        }
+        exit(EXIT_SUCCESS);
+    }
+}
@@ -0,0 +1,73 @@
+#include "vcpkg_Commands.h"
+#include "vcpkg_System.h"
+#include "vcpkg_Strings.h"
+#include "vcpkg_Parallel.h"
+#include "coff_file_reader.h"
+#include <atomic>
+
+namespace vcpkg
+{
+    // Internal: copies the PDB of every DLL below the given directories next to the DLL, reading the CodeView record
+    // of each DLL instead of asking dumpbin about them one at a time. As dumpbin /PDBPATH does, the PDB is looked for
+    // where the linker wrote it and then next to the DLL, and only a PDB written with the DLL, with the same GUID, is taken.
+    void internal_copy_pdbs_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        args.check_min_arg_count(1);
+
+        std::vector<fs::path> dlls;
+        for (const std::string& dir : args.command_arguments)
+        {
+            std::error_code ec;
+            for (auto it = fs::recursive_directory_iterator(dir, ec); !ec && it != fs::recursive_directory_iterator(); ++it)
+            {
+                if (fs::is_regular_file(it->status()) && Strings::case_insensitive_ascii_equals(it->path().extension().generic_string(), ".dll"))
+                    dlls.push_back(it->path());
+            }
+        }
+
+        // char rather than bool: the workers write their own elements concurrently
+        std::vector<char> matched(dlls.size(), 0);
+        std::atomic<size_t> failed(0);
+        Parallel::for_each_index(dlls.size(), [&](const size_t i)
+            {
+                COFFFileReader::pdb_reference reference;
+                if (!COFFFileReader::read_pdb_reference(dlls[i], reference))
+                    return;
+
+                const fs::path recorded = Strings::utf8_to_utf16(reference.path);
+                const fs::path next_to_dll = dlls[i].parent_path() / recorded.filename();
+                for (const fs::path& candidate : {recorded, next_to_dll})
+                {
+                    std::string guid;
+                    if (!COFFFileReader::read_pdb_guid(candidate, guid) || guid != reference.guid)
+                        continue;
+
+                    matched[i] = 1;
+                    std::error_code ec;
+                    if (fs::exists(next_to_dll, ec) && fs::equivalent(candidate, next_to_dll, ec))
+                        return;
+
+                    fs::copy_file(candidate, next_to_dll, fs::copy_options::overwrite_existing, ec);
+                    if (ec)
+                    {
+                        System::println(System::color::error, "Error: could not copy %s to %s: %s", candidate.generic_string(), next_to_dll.generic_string(), ec.message());
+                        ++failed;
+                    }
+                    return;
+                }
+            });
+
+        std::string unmatched;
+        for (size_t i = 0; i < dlls.size(); ++i)
+        {
+            if (!matched[i])
+                unmatched.append("    ").append(dlls[i].generic_string()).append("\n");
+        }
+        if (!unmatched.empty())
+        {
+            System::println(System::color::warning, "Warning: Could not find a matching pdb file for:\n%s", unmatched);
+        }
+
+        exit(failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,218 @@
+#include "vcpkg_Commands.h"
+#include "vcpkg.h"
+#include "vcpkg_System.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Input.h"
+#include "vcpkg_info.h"
+#include "Listfile.h"
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <Windows.h>
+
+namespace vcpkg
+{
+    namespace
+    {
+        // Relative to the root of the archive. Lists what was exported, so that an archive can be identified without
+        // extracting it.
+        static const char* const MANIFEST_DIR = "installed/vcpkg/exports";
+
+        // The installed packages among specs and everything they depend on, dependencies before their dependents
+        std::vector<const StatusParagraph*> find_export_closure(const status_snapshot& status_db, const std::vector<package_spec>& specs, const char* example)
+        {
+            std::unordered_map<std::string, size_t> installed;
+            for (size_t i = 0; i < status_db.size(); ++i)
+            {
+                const status_snapshot::entry& entry = status_db[i];
+                if (entry.want == want_t::install && entry.state == install_state_t::installed)
+                    installed[entry.displayname] = i;
+            }
+
+            std::vector<const StatusParagraph*> closure;
+            std::unordered_map<std::string, bool> visited; // displayname -> fully explored
+            std::vector<std::pair<const StatusParagraph*, size_t>> stack; // (package, next dependency to visit)
+
+            auto push = [&](const std::string& displayname, const std::string& needed_by)
+                {
+                    const auto v = visited.find(displayname);
+                    if (v != visited.end())
+                    {
+                        Checks::check_exit(v->second, "Error: dependency cycle through %s", displayname);
+                        return;
+                    }
+
+                    const auto it = installed.find(displayname);
+                    if (it == installed.end())
+                    {
+                        if (needed_by.empty())
+                            System::println(System::color::error, "Error: package %s is not installed", displayname);
+                        else
+                            System::println(System::color::error, "Error: package %s, needed by %s, is not installed", displayname, needed_by);
+                        print_example(example);
+                        exit(EXIT_FAILURE);
+                    }
+
+                    visited.emplace(displayname, false);
+                    stack.emplace_back(&status_db.paragraph(it->second), 0);
+                };
+
+            for (const package_spec& spec : specs)
+            {
+                push(to_string(spec), "");
+                while (!stack.empty())
+                {
+                    const StatusParagraph& pgh = *stack.back().first;
+                    const size_t next = stack.back().second++;
+                    if (next == pgh.package.depends.size())
+                    {
+                        visited[pgh.package.displayname()] = true;
+                        closure.push_back(&pgh);
+                        stack.pop_back();
+                        continue;
+                    }
+
+                    const std::string& dependency = pgh.package.depends[next];
+                    push(dependency + ":" + pgh.package.spec.target_triplet().canonical_name(), pgh.package.displayname());
+                }
+            }
+
+            return closure;
+        }
+
+        // Hard links file into the staging directory, copying it when that is not possible (e.g. across volumes)
+        bool stage_file(const fs::path& file, const fs::path& target)
+        {
+            std::error_code ec;
+            fs::create_directories(target.parent_path(), ec);
+            fs::create_hard_link(file, target, ec);
+            if (!ec)
+                return true;
+            ec.clear();
+            fs::copy_file(file, target, ec);
+            return !ec;
+        }
+
+        std::string current_timestamp()
+        {
+            SYSTEMTIME now;
+            GetLocalTime(&now);
+            return Strings::format("%04d%02d%02d-%02d%02d%02d", now.wYear, now.wMonth, now.wDay, now.wHour, now.wMinute, now.wSecond);
+        }
+    }
+
+    // Packs the installed files of the given packages and of everything they depend on, with their listfiles and, for each
+    // triplet, an import holding the journal records of their paragraphs, into a zip laid out like the vcpkg root.
+    // Extracting it into the root of another vcpkg registers the packages as installed there, with nothing to rebuild or
+    // rewrite.
+    void export_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet)
+    {
+        static const std::string example = create_example_string("export zlib zlib:x64-windows curl boost");
+        args.check_min_arg_count(1, example.c_str());
+
+        const std::vector<package_spec> specs = Input::check_and_get_package_specs(args.command_arguments, default_target_triplet, example.c_str());
+        Input::check_triplets(specs, paths);
+
+        // Nothing may change installed/<triplet> while its files are staged
+        const std::vector<Files::file_lock> triplet_locks = lock_triplets(paths, specs);
+        const status_snapshot status_db = load_status_snapshot(paths);
+        const std::vector<const StatusParagraph*> closure = find_export_closure(status_db, specs, example.c_str());
+
+        const std::string export_name = "vcpkg-export-" + current_timestamp();
+        const fs::path staging_dir = paths.buildtrees / Strings::format("%s.%d.tmp", export_name, static_cast<int>(GetCurrentProcessId()));
+        const fs::path staged_installed = staging_dir / "installed";
+        std::error_code ec;
+        fs::remove_all(staging_dir, ec);
+        fs::create_directories(staged_installed, ec);
+
+        // Where a file below installed/ goes in the staging directory
+        const size_t installed_prefix_length = paths.installed.generic_wstring().size() + 1;
+        auto staged = [&](const fs::path& installed_path) { return staged_installed / installed_path.generic_wstring().substr(installed_prefix_length); };
+
+        auto fail = [&](const std::string& message)
+            {
+                System::println(System::color::error, "Error: %s", message);
+                fs::remove_all(staging_dir, ec);
+                exit(EXIT_FAILURE);
+            };
+
+        size_t file_count = 0;
+        // Imports rather than status files, so that the next vcpkg to load the database of a triplet merges the packages
+        // into the ones already installed where the archive is extracted. Named after the export, they replace no file there.
+        std::map<std::string, std::string> imports; // By triplet name
+        fs::create_directories(staging_dir / MANIFEST_DIR, ec);
+        std::ofstream manifest(staging_dir / MANIFEST_DIR / export_name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        manifest << "Vcpkg-Version: " << Info::version() << "\n";
+        for (const StatusParagraph* pgh : closure)
+        {
+            System::println("Exporting %s", pgh->package.displayname());
+
+            const fs::path listfile = paths.listfile_path(pgh->package);
+            const bool listed = Listfile::for_each_entry(listfile, [&](const std::string& suffix, const Listfile::entry_type type)
+                {
+                    // Directories are listed too, but only files are staged: the archive recreates their directories
+                    if (type == Listfile::entry_type::directory || suffix.back() == '/')
+                        return;
+                    const fs::path file = paths.installed / suffix;
+                    if (!fs::is_regular_file(file, ec))
+                        return;
+
+                    if (!stage_file(file, staged_installed / suffix))
+                        fail(Strings::format("could not stage %s", file.generic_string()));
+                    ++file_count;
+                });
+            if (!listed)
+                fail(Strings::format("could not read %s", listfile.generic_string()));
+
+            if (!stage_file(listfile, staged(listfile)))
+                fail(Strings::format("could not stage %s", listfile.generic_string()));
+
+            for (const fs::path& sidecar : {paths.importsfile_path(pgh->package), paths.hashesfile_path(pgh->package)})
+            {
+                if (fs::exists(sidecar, ec) && !stage_file(sidecar, staged(sidecar)))
+                    fail(Strings::format("could not stage %s", sidecar.generic_string()));
+            }
+
+            imports[pgh->package.spec.target_triplet().canonical_name()] += make_status_journal_record(*pgh);
+            manifest << "Package: " << pgh->package.displayname() << " " << pgh->package.version << "\n";
+        }
+        manifest << "Files: " << file_count << "\n";
+        manifest.close();
+        if (manifest.fail())
+            fail(Strings::format("could not write to %s", staging_dir.generic_string()));
+
+        for (auto&& kv : imports)
+        {
+            const fs::path import_file = staged(paths.status_shard(triplet::from_canonical_name(kv.first)).imports / export_name);
+            fs::create_directories(import_file.parent_path(), ec);
+            std::ofstream import(import_file, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+            import.write(kv.second.data(), kv.second.size());
+            import.close();
+            if (import.fail())
+                fail(Strings::format("could not write to %s", import_file.generic_string()));
+        }
+
+        // Archive next to the final location, then rename, so that a failed export never leaves a partial archive
+        const fs::path archive = paths.root / (export_name + ".zip");
+        const fs::path tmp_archive = paths.root / Strings::format("%s.zip.%d.tmp", export_name, static_cast<int>(GetCurrentProcessId()));
+        const std::wstring cmd = Strings::wformat(LR"(cmake -E tar cf "%s" --format=zip installed)", tmp_archive.wstring());
+        const int exit_code = System::process_execute(cmd, nullptr, staging_dir);
+        fs::remove_all(staging_dir, ec);
+        if (exit_code != 0)
+        {
+            fs::remove(tmp_archive, ec);
+            fail(Strings::format("failed to create %s", archive.generic_string()));
+        }
+
+        fs::rename(tmp_archive, archive, ec);
+        if (ec)
+        {
+            fs::remove(tmp_archive, ec);
+            fail(Strings::format("failed to create %s", archive.generic_string()));
+        }
+
+        System::println(System::color::success, "Exported %d packages (%d files) to %s", closure.size(), file_count, archive.generic_string());
+        System::println("Extract it into the root of a vcpkg to install them there.");
+        exit(EXIT_SUCCESS);
+    }
+}
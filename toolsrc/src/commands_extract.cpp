@@ -0,0 +1,598 @@
+#include "vcpkg_Commands.h"
+#include "vcpkg_System.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Hash.h"
+#include "vcpkg_Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <Windows.h>
+
+namespace vcpkg
+{
+    namespace
+    {
+        // Archives are identified by this many hex digits of their SHA512, which keeps the paths of deep source trees
+        // short enough for MAX_PATH
+        static const size_t KEY_LENGTH = 32;
+
+        // Written into the destination of every cached extraction: "extracted <key>" for each archive extracted there,
+        // then "patched <source path> <key>" once a source tree inside it has the patches of that key applied
+        static const char* const STAMP_FILE = ".vcpkg-extracted";
+
+        struct cached_file
+        {
+            std::string path; // Relative to the cache entry
+            uintmax_t size;
+            std::string mtime;
+        };
+
+        std::string mtime_of(const fs::path& file, std::error_code& ec)
+        {
+            const auto mtime = fs::last_write_time(file, ec);
+            return ec ? std::string() : std::to_string(mtime.time_since_epoch().count());
+        }
+
+        // "<directory>/" or "<size> <mtime> <file>" per line. Hard links from build trees share the size and last write
+        // time of the cached files, so a build that modified a file in place is noticed the next time the entry is used.
+        bool parse_manifest(const std::string& text, std::vector<std::string>& dirs, std::vector<cached_file>& files)
+        {
+            size_t pos = 0;
+            while (pos < text.size())
+            {
+                size_t end = text.find('\n', pos);
+                if (end == std::string::npos)
+                    end = text.size();
+                const std::string line = text.substr(pos, end - pos);
+                pos = end + 1;
+
+                if (!line.empty() && line.back() == '/')
+                {
+                    dirs.push_back(line.substr(0, line.size() - 1));
+                    continue;
+                }
+
+                const size_t size_end = line.find(' ');
+                const size_t mtime_end = size_end == std::string::npos ? std::string::npos : line.find(' ', size_end + 1);
+                if (mtime_end == std::string::npos)
+                {
+                    return false;
+                }
+                try
+                {
+                    files.push_back({line.substr(mtime_end + 1), std::stoull(line.substr(0, size_end)), line.substr(size_end + 1, mtime_end - size_end - 1)});
+                }
+                catch (const std::exception&)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool read_manifest(const fs::path& manifest_file, std::vector<std::string>& dirs, std::vector<cached_file>& files)
+        {
+            const expected<std::string> contents = Files::get_contents(manifest_file);
+            const std::string* text = contents.get();
+            return text != nullptr && parse_manifest(*text, dirs, files);
+        }
+
+        bool is_intact(const fs::path& cache_dir, const std::vector<cached_file>& files)
+        {
+            std::atomic<bool> intact(true);
+            Parallel::for_each_index(files.size(), [&](const size_t i)
+                {
+                    const fs::path file = cache_dir / files[i].path;
+                    std::error_code ec;
+                    if (fs::file_size(file, ec) != files[i].size || ec || mtime_of(file, ec) != files[i].mtime)
+                        intact = false;
+                });
+            return intact;
+        }
+
+        fs::path find_7zip()
+        {
+            wchar_t buf[MAX_PATH];
+            const DWORD length = SearchPathW(nullptr, L"7z.exe", nullptr, MAX_PATH, buf, nullptr);
+            if (length != 0 && length < MAX_PATH)
+            {
+                return fs::path(buf, buf + length);
+            }
+
+            const DWORD program_files_length = GetEnvironmentVariableW(L"ProgramFiles", buf, MAX_PATH);
+            if (program_files_length != 0 && program_files_length < MAX_PATH)
+            {
+                const fs::path installed = fs::path(buf, buf + program_files_length) / "7-Zip" / "7z.exe";
+                if (fs::exists(installed))
+                    return installed;
+            }
+            return fs::path();
+        }
+
+        bool ends_with(const std::wstring& s, const wchar_t* suffix)
+        {
+            const size_t size = wcslen(suffix);
+            return s.size() >= size && _wcsicmp(s.c_str() + s.size() - size, suffix) == 0;
+        }
+
+        // 7-Zip decompresses bzip2 and xz on every core, and gzip faster than cmake; compressed tarballs are decompressed
+        // into a pipe that a second 7-Zip unpacks, so the tar is never written to disk. cmake extracts everything else.
+        bool extract_to(const fs::path& archive, const fs::path& destination)
+        {
+            const std::wstring name = archive.filename().wstring();
+            const fs::path seven_zip = find_7zip();
+            if (!seven_zip.empty())
+            {
+                std::wstring cmd;
+                if (ends_with(name, L".tar.gz") || ends_with(name, L".tgz") || ends_with(name, L".tar.bz2") || ends_with(name, L".tbz2") || ends_with(name, L".tar.xz"))
+                {
+                    cmd = Strings::wformat(LR"(cmd.exe /c ""%s" x -so -mmt=on "%s" | "%s" x -si -ttar -y -bd >NUL")",
+                                           seven_zip.wstring(), archive.wstring(), seven_zip.wstring());
+                }
+                else if (ends_with(name, L".zip") || ends_with(name, L".7z"))
+                {
+                    cmd = Strings::wformat(LR"("%s" x -mmt=on -y -bd "%s")", seven_zip.wstring(), archive.wstring());
+                }
+
+                if (!cmd.empty())
+                {
+                    if (System::process_execute(cmd, nullptr, destination) == 0)
+                        return true;
+
+                    System::println(System::color::warning, "Warning: 7-Zip failed to extract %s; retrying with cmake", archive.generic_string());
+                    std::error_code ec;
+                    fs::remove_all(destination, ec);
+                    fs::create_directories(destination, ec);
+                }
+            }
+
+            const std::wstring cmd = Strings::wformat(LR"(cmake -E tar xjf "%s")", archive.wstring());
+            return System::process_execute(cmd, nullptr, destination) == 0;
+        }
+
+        void append_to_stamp(const fs::path& dir, const std::string& line)
+        {
+            std::ofstream(dir / STAMP_FILE, std::ios_base::out | std::ios_base::binary | std::ios_base::app) << line << "\n";
+        }
+
+        void write_manifest(const fs::path& cache_dir, const fs::path& manifest_file)
+        {
+            const size_t prefix_length = cache_dir.generic_u8string().size() + 1;
+            std::string manifest;
+            for (auto it = fs::recursive_directory_iterator(cache_dir); it != fs::recursive_directory_iterator(); ++it)
+            {
+                const std::string relative = it->path().generic_u8string().substr(prefix_length);
+                std::error_code ec;
+                if (fs::is_directory(it->status()))
+                {
+                    manifest.append(relative).append("/\n");
+                    continue;
+                }
+
+                const uintmax_t size = fs::file_size(it->path(), ec);
+                const std::string mtime = mtime_of(it->path(), ec);
+                Checks::check_exit(!ec, "Error: could not read %s: %s", it->path().generic_string(), ec.message());
+                manifest.append(std::to_string(size)).append(" ").append(mtime).append(" ").append(relative).append("\n");
+            }
+
+            const fs::path tmp_file = manifest_file.parent_path() / Strings::format("%s.%d.tmp", manifest_file.filename().string(), static_cast<int>(GetCurrentProcessId()));
+            std::ofstream(tmp_file, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc) << manifest;
+            std::error_code ec;
+            fs::remove(manifest_file, ec);
+            fs::rename(tmp_file, manifest_file, ec);
+            Checks::check_exit(!ec, "Error: could not write %s: %s", manifest_file.generic_string(), ec.message());
+        }
+    }
+
+    // Internal: extracts a source archive into a directory, through a cache of extracted archives keyed by their
+    // SHA512 under downloads/extracted. The first extraction of an archive fills the cache; every later one, for any
+    // port or triplet, hard links the cached files into the destination instead of decompressing again.
+    void internal_extract_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        args.check_exact_arg_count(2);
+        const fs::path archive = args.command_arguments[0];
+        const fs::path destination = args.command_arguments[1];
+
+        const std::string sha512 = Hash::get_file_hash(archive, L"SHA512").get_or_throw();
+        const fs::path cache_root = paths.downloads / "extracted";
+        const fs::path cache_dir = cache_root / sha512.substr(0, KEY_LENGTH);
+        const fs::path manifest_file = cache_root / (sha512.substr(0, KEY_LENGTH) + ".manifest");
+        std::error_code ec;
+        fs::create_directories(cache_root, ec);
+        const Files::file_lock lock(cache_root / (sha512.substr(0, KEY_LENGTH) + ".lock"), Files::file_lock::mode::exclusive);
+
+        std::vector<std::string> dirs;
+        std::vector<cached_file> files;
+        if (!read_manifest(manifest_file, dirs, files) || !is_intact(cache_dir, files))
+        {
+            System::println("Extracting %s into the source cache", archive.filename().generic_string());
+            fs::remove(manifest_file, ec);
+            fs::remove_all(cache_dir, ec);
+
+            const fs::path tmp_dir = cache_root / Strings::format("%s.%d.tmp", sha512.substr(0, KEY_LENGTH), static_cast<int>(GetCurrentProcessId()));
+            fs::remove_all(tmp_dir, ec);
+            fs::create_directories(tmp_dir, ec);
+            if (!extract_to(archive, tmp_dir))
+            {
+                fs::remove_all(tmp_dir, ec);
+                System::println(System::color::error, "Error: failed to extract %s", archive.generic_string());
+                exit(EXIT_FAILURE);
+            }
+
+            fs::rename(tmp_dir, cache_dir, ec);
+            Checks::check_exit(!ec, "Error: could not move %s to %s: %s", tmp_dir.generic_string(), cache_dir.generic_string(), ec.message());
+            write_manifest(cache_dir, manifest_file);
+
+            dirs.clear();
+            files.clear();
+            Checks::check_exit(read_manifest(manifest_file, dirs, files), "Error: could not read %s", manifest_file.generic_string());
+        }
+
+        // The iterator lists every directory before its contents
+        for (const std::string& dir : dirs)
+        {
+            fs::create_directories(destination / dir, ec);
+        }
+
+        std::atomic<size_t> copied(0);
+        std::atomic<size_t> failed(0);
+        Parallel::for_each_index(files.size(), [&](const size_t i)
+            {
+                const fs::path source = cache_dir / files[i].path;
+                const fs::path target = destination / files[i].path;
+                std::error_code link_ec;
+                fs::remove(target, link_ec);
+                fs::create_hard_link(source, target, link_ec);
+                if (!link_ec)
+                    return;
+
+                // e.g. buildtrees and downloads on different volumes
+                link_ec.clear();
+                fs::copy_file(source, target, link_ec);
+                if (link_ec)
+                    ++failed;
+                else
+                    ++copied;
+            });
+
+        Checks::check_exit(failed == 0, "Error: could not create %d files in %s", failed.load(), destination.generic_string());
+        if (copied != 0)
+        {
+            System::println(System::color::warning, "Warning: %d files were copied from the source cache because they could not be hard linked", copied.load());
+        }
+        append_to_stamp(destination, "extracted " + sha512.substr(0, KEY_LENGTH));
+        exit(EXIT_SUCCESS);
+    }
+
+    namespace
+    {
+        // Lines of the stamp in dir, or of the closest ancestor of dir that has one, below the buildtrees
+        bool find_stamp(const vcpkg_paths& paths, const fs::path& source_path, fs::path& stamp_dir, std::vector<std::string>& lines)
+        {
+            const std::string buildtrees = paths.buildtrees.generic_string();
+            for (fs::path dir = source_path; dir.generic_string().size() > buildtrees.size(); dir = dir.parent_path())
+            {
+                const expected<std::string> contents = Files::get_contents(dir / STAMP_FILE);
+                if (const std::string* text = contents.get())
+                {
+                    stamp_dir = dir;
+                    size_t pos = 0;
+                    while (pos < text->size())
+                    {
+                        size_t end = text->find('\n', pos);
+                        if (end == std::string::npos)
+                            end = text->size();
+                        lines.push_back(text->substr(pos, end - pos));
+                        pos = end + 1;
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Patched files are stored under the same paths as in the extraction, with "D <file>" lines for deleted files
+        struct patched_tree
+        {
+            std::vector<cached_file> files;
+            std::vector<std::string> deleted;
+        };
+
+        bool read_patch_manifest(const fs::path& manifest_file, patched_tree& tree)
+        {
+            const expected<std::string> contents = Files::get_contents(manifest_file);
+            const std::string* text = contents.get();
+            if (text == nullptr)
+            {
+                return false;
+            }
+
+            std::string others;
+            size_t pos = 0;
+            while (pos < text->size())
+            {
+                size_t end = text->find('\n', pos);
+                if (end == std::string::npos)
+                    end = text->size();
+                const std::string line = text->substr(pos, end - pos);
+                pos = end + 1;
+
+                if (line.compare(0, 2, "D ") == 0)
+                    tree.deleted.push_back(line.substr(2));
+                else
+                    others.append(line).append("\n");
+            }
+
+            std::vector<std::string> dirs;
+            return parse_manifest(others, dirs, tree.files);
+        }
+
+        // A file a patch changes, relative to the directory the patch is applied in
+        struct patched_path
+        {
+            bool created;
+            bool deleted;
+        };
+
+        // The path of a "--- " or "+++ " line of a patch without its first component, as git apply -p1 takes it, or an
+        // empty string for /dev/null. Git quotes paths with unusual characters; diff may follow them with a tab and a time.
+        std::string parse_patch_path(const std::string& text)
+        {
+            std::string path;
+            if (!text.empty() && text[0] == '"')
+            {
+                for (size_t i = 1; i < text.size() && text[i] != '"'; ++i)
+                {
+                    if (text[i] == '\\' && i + 1 < text.size())
+                    {
+                        ++i;
+                        path.push_back(text[i] == 't' ? '\t' : text[i] == 'n' ? '\n' : text[i]);
+                    }
+                    else
+                    {
+                        path.push_back(text[i]);
+                    }
+                }
+            }
+            else
+            {
+                path = text.substr(0, text.find('\t'));
+                while (!path.empty() && (path.back() == ' ' || path.back() == '\r'))
+                    path.pop_back();
+            }
+
+            if (path == "/dev/null")
+                return std::string();
+            const size_t slash = path.find('/');
+            return slash == std::string::npos ? path : path.substr(slash + 1);
+        }
+
+        // Adds the files the patch changes to paths; a file created by an earlier patch stays created
+        bool read_patched_paths(const fs::path& patch, std::map<std::string, patched_path>& paths)
+        {
+            const expected<std::string> contents = Files::get_contents(patch);
+            const std::string* text = contents.get();
+            if (text == nullptr)
+            {
+                return false;
+            }
+
+            std::string old_path;
+            bool in_header = false;
+            size_t pos = 0;
+            while (pos < text->size())
+            {
+                size_t end = text->find('\n', pos);
+                if (end == std::string::npos)
+                    end = text->size();
+                const std::string line = text->substr(pos, end - pos);
+                pos = end + 1;
+
+                if (line.compare(0, 4, "--- ") == 0)
+                {
+                    old_path = parse_patch_path(line.substr(4));
+                    in_header = true;
+                }
+                else if (in_header && line.compare(0, 4, "+++ ") == 0)
+                {
+                    const std::string new_path = parse_patch_path(line.substr(4));
+                    const std::string& path = new_path.empty() ? old_path : new_path;
+                    if (path.empty())
+                        return false;
+                    const auto existing = paths.find(path);
+                    const bool created = existing != paths.end() ? existing->second.created : old_path.empty();
+                    paths[path] = {created, new_path.empty()};
+                    in_header = false;
+                }
+                else
+                {
+                    in_header = false;
+                }
+            }
+            return true;
+        }
+    }
+
+    // Internal, for vcpkg_apply_patches:
+    //   internal_patch_cache restore <source path> <patch>...
+    //   internal_patch_cache store <source path> <patch>...
+    // The patched files of a source tree extracted through the source cache are kept under downloads/patched, keyed
+    // by the archives extracted there, the path of the tree and the contents of the patches, in order. restore succeeds
+    // when it brought the tree to the state the patches produce, by hard linking the cached patched files over the
+    // extracted ones; otherwise the caller applies the patches and calls store.
+    // Only the files the patches change are kept, and only if they come from the extractions or the patches: portfiles
+    // copy files of their own into the tree before patching, which the key does not cover, so store leaves a tree whose
+    // patches change such a file uncached.
+    void internal_patch_cache_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        args.check_min_arg_count(2);
+        const std::string& action = args.command_arguments[0];
+        Checks::check_exit(action == "restore" || action == "store", "Error: unknown action %s", action);
+        const fs::path source_path = args.command_arguments[1];
+
+        fs::path stamp_dir;
+        std::vector<std::string> stamp;
+        if (!find_stamp(paths, source_path, stamp_dir, stamp))
+        {
+            // Not extracted through the cache, so there is nothing to key the patches by
+            exit(EXIT_FAILURE);
+        }
+
+        const std::string stamp_generic = stamp_dir.generic_string();
+        const std::string relative_source = source_path.generic_string().substr(std::min(source_path.generic_string().size(), stamp_generic.size() + 1));
+
+        std::vector<std::string> extraction_keys;
+        std::string key_material;
+        for (const std::string& line : stamp)
+        {
+            if (line.compare(0, 10, "extracted ") == 0)
+            {
+                extraction_keys.push_back(line.substr(10));
+                key_material.append(line).append("\n");
+            }
+        }
+        key_material.append(relative_source).append("\n");
+        key_material.append("patched files only\n");
+        for (size_t i = 2; i < args.command_arguments.size(); ++i)
+        {
+            key_material.append(Hash::get_file_hash(args.command_arguments[i], L"SHA512").get_or_throw()).append("\n");
+        }
+        const std::string key = Hash::get_string_hash(key_material, L"SHA512").substr(0, KEY_LENGTH);
+        const std::string patched_line = Strings::format("patched %s %s", relative_source, key);
+
+        const fs::path cache_root = paths.downloads / "patched";
+        const fs::path cache_dir = cache_root / key;
+        const fs::path manifest_file = cache_root / (key + ".manifest");
+        std::error_code ec;
+        fs::create_directories(cache_root, ec);
+        const Files::file_lock lock(cache_root / (key + ".lock"), Files::file_lock::mode::exclusive);
+
+        if (action == "restore")
+        {
+            if (std::find(stamp.cbegin(), stamp.cend(), patched_line) != stamp.cend())
+            {
+                System::println("The patches were already applied");
+                exit(EXIT_SUCCESS);
+            }
+
+            patched_tree tree;
+            if (!read_patch_manifest(manifest_file, tree) || !is_intact(cache_dir, tree.files))
+            {
+                exit(EXIT_FAILURE);
+            }
+
+            for (const std::string& file : tree.deleted)
+            {
+                fs::remove(stamp_dir / file, ec);
+            }
+
+            std::atomic<size_t> failed(0);
+            Parallel::for_each_index(tree.files.size(), [&](const size_t i)
+                {
+                    const fs::path target = stamp_dir / tree.files[i].path;
+                    std::error_code link_ec;
+                    fs::create_directories(target.parent_path(), link_ec);
+                    fs::remove(target, link_ec);
+                    fs::create_hard_link(cache_dir / tree.files[i].path, target, link_ec);
+                    if (link_ec)
+                    {
+                        link_ec.clear();
+                        fs::copy_file(cache_dir / tree.files[i].path, target, link_ec);
+                    }
+                    if (link_ec)
+                        ++failed;
+                });
+            Checks::check_exit(failed == 0, "Error: could not restore %d patched files in %s", failed.load(), source_path.generic_string());
+
+            System::println("Restored %d patched files from the patch cache", tree.files.size());
+            append_to_stamp(stamp_dir, patched_line);
+            exit(EXIT_SUCCESS);
+        }
+
+        // store: the files the patches changed, as they are now
+        std::map<std::string, patched_path> patched;
+        for (size_t i = 2; i < args.command_arguments.size(); ++i)
+        {
+            if (!read_patched_paths(args.command_arguments[i], patched))
+            {
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        std::unordered_map<std::string, bool> extracted;
+        for (const std::string& extraction_key : extraction_keys)
+        {
+            std::vector<std::string> dirs;
+            std::vector<cached_file> files;
+            read_manifest(paths.downloads / "extracted" / (extraction_key + ".manifest"), dirs, files);
+            for (const cached_file& file : files)
+            {
+                extracted[file.path] = true;
+            }
+        }
+
+        const std::string prefix = relative_source.empty() ? std::string() : relative_source + "/";
+        const fs::path tmp_dir = cache_root / Strings::format("%s.%d.tmp", key, static_cast<int>(GetCurrentProcessId()));
+        fs::remove_all(tmp_dir, ec);
+        std::string manifest;
+        for (auto&& kv : patched)
+        {
+            const std::string relative = prefix + kv.first;
+            if (!kv.second.created && extracted.find(relative) == extracted.end())
+            {
+                // Copied in by the portfile, which may change it without changing the key
+                fs::remove_all(tmp_dir, ec);
+                exit(EXIT_FAILURE);
+            }
+
+            const fs::path file = stamp_dir / relative;
+            if (kv.second.deleted)
+            {
+                manifest.append("D ").append(relative).append("\n");
+                continue;
+            }
+
+            const uintmax_t size = fs::file_size(file, ec);
+            const std::string mtime = ec ? std::string() : mtime_of(file, ec);
+            if (ec)
+            {
+                fs::remove_all(tmp_dir, ec);
+                exit(EXIT_FAILURE);
+            }
+
+            // The patched file is new, so linking it does not touch the extraction it replaced
+            const fs::path cached = tmp_dir / relative;
+            fs::create_directories(cached.parent_path(), ec);
+            fs::create_hard_link(file, cached, ec);
+            if (ec)
+            {
+                ec.clear();
+                fs::copy_file(file, cached, ec);
+            }
+            if (ec)
+            {
+                fs::remove_all(tmp_dir, ec);
+                exit(EXIT_FAILURE);
+            }
+            manifest.append(std::to_string(size)).append(" ").append(mtime).append(" ").append(relative).append("\n");
+        }
+
+        fs::remove_all(cache_dir, ec);
+        fs::create_directories(tmp_dir, ec);
+        fs::rename(tmp_dir, cache_dir, ec);
+        if (ec)
+        {
+            fs::remove_all(tmp_dir, ec);
+            exit(EXIT_FAILURE);
+        }
+        const fs::path tmp_manifest = cache_root / Strings::format("%s.manifest.%d.tmp", key, static_cast<int>(GetCurrentProcessId()));
+        std::ofstream(tmp_manifest, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc) << manifest;
+        fs::remove(manifest_file, ec);
+        fs::rename(tmp_manifest, manifest_file, ec);
+
+        append_to_stamp(stamp_dir, patched_line);
+        exit(EXIT_SUCCESS);
+    }
+}
@@ -0,0 +1,54 @@
+#include "vcpkg_Commands.h"
+#include "vcpkg_System.h"
+#include "BuildResources.h"
+#include "DiskBudget.h"
+#include "SymbolStore.h"
+
+namespace vcpkg
+{
+    static const std::string OPTION_DRY_RUN = "--dry-run";
+
+    // Shrinks downloads/, buildtrees/ and packages/ to the budget given, or else to %VCPKG_DISK_BUDGET%, and deletes the
+    // stored PDBs no installed package lists
+    void gc_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        static const std::string example = Strings::format(
+            "The argument should be the size downloads/, buildtrees/ and packages/ may take together, such as 20G.\n%s", create_example_string("gc 20G"));
+        args.check_max_arg_count(1, example.c_str());
+        const std::unordered_set<std::string> options = args.check_and_get_optional_command_arguments({OPTION_DRY_RUN});
+
+        uintmax_t budget = 0;
+        if (!args.command_arguments.empty())
+        {
+            Checks::check_exit(DiskBudget::parse_size(args.command_arguments[0], budget), "Error: %s is not a size\n%s", args.command_arguments[0], example);
+        }
+        else
+        {
+            budget = DiskBudget::get_budget();
+            Checks::check_exit(budget != 0, "Error: no budget was given and VCPKG_DISK_BUDGET is not set\n%s", example);
+        }
+
+        const bool dry_run = options.find(OPTION_DRY_RUN) != options.end();
+        const StatusParagraphs status_db = database_load_check(paths);
+        const DiskBudget::collection result = DiskBudget::collect(paths, status_db, budget, dry_run);
+
+        System::println("downloads/, buildtrees/ and packages/ held %s for a budget of %s", BuildResources::format_bytes(result.total_size), BuildResources::format_bytes(budget));
+        if (result.evicted_count == 0)
+        {
+            System::println(result.total_size <= budget ? "Nothing to remove." : "Everything else is in use by installed packages or running installs.");
+        }
+        else
+        {
+            System::println(System::color::success, "%s %s in %d entries", dry_run ? "Would free" : "Freed",
+                            BuildResources::format_bytes(result.evicted_size), static_cast<int>(result.evicted_count));
+        }
+
+        const SymbolStore::collection symbols = SymbolStore::collect_unlisted_pdbs(paths, dry_run);
+        if (symbols.removed_count != 0)
+        {
+            System::println(System::color::success, "%s %s in %d stored PDBs no package uses", dry_run ? "Would free" : "Freed",
+                            BuildResources::format_bytes(symbols.removed_size), static_cast<int>(symbols.removed_count));
+        }
+        exit(EXIT_SUCCESS);
+    }
+}
@@ -1,46 +1,46 @@
 #include "vcpkg_Commands.h"
 #include "vcpkg_System.h"
+#include "vcpkg_Hash.h"
 
 namespace fs = std::tr2::sys;
 
 namespace vcpkg
 {
-    static void do_file_hash(fs::path const& path, std::wstring const& hashType)
-    {
-        auto cmd_line = Strings::wformat(LR"(CertUtil.exe -hashfile "%s" %s)",
-                                         path.c_str(), hashType.c_str());
-        auto ec_data = System::cmd_execute_and_capture_output(cmd_line);
-        Checks::check_exit(ec_data.exit_code == 0, "Running command:\n   %s\n failed", Strings::utf16_to_utf8(cmd_line));
-
-        std::string const& output = ec_data.output;
-
-        auto start = output.find_first_of("\r\n");
-        Checks::check_exit(start != std::string::npos, "Unexpected output format from command: %s", Strings::utf16_to_utf8(cmd_line));
-
-        auto end = output.find_first_of("\r\n", start + 1);
-        Checks::check_exit(end != std::string::npos, "Unexpected output format from command: %s", Strings::utf16_to_utf8(cmd_line));
-
-        auto hash = output.substr(start, end - start);
-        hash.erase(std::remove_if(hash.begin(), hash.end(), isspace), hash.end());
-        System::println(hash.c_str());
-    }
+    static const std::wstring DEFAULT_HASH_TYPE = L"SHA512";
 
     void hash_command(const vcpkg_cmd_arguments& args)
     {
         static const std::string example = Strings::format(
-            "The argument should be a file path\n%s", create_example_string("hash boost_1_62_0.tar.bz2"));
+            "The arguments should be file paths, optionally followed by a hash algorithm\n%s", create_example_string("hash boost_1_62_0.tar.bz2"));
         args.check_min_arg_count(1, example.c_str());
-        args.check_max_arg_count(2, example.c_str());
 
-        if (args.command_arguments.size() == 1)
+        // "vcpkg hash <file> <alg>" keeps working: a trailing argument that is not a file names the algorithm
+        std::vector<fs::path> files(args.command_arguments.cbegin(), args.command_arguments.cend());
+        std::wstring hash_type = DEFAULT_HASH_TYPE;
+        if (files.size() == 2 && !fs::exists(files.back()))
         {
-            do_file_hash(args.command_arguments[0], L"SHA512");
+            hash_type = Strings::utf8_to_utf16(args.command_arguments.back());
+            files.pop_back();
         }
-        if (args.command_arguments.size() == 2)
+
+        const std::vector<expected<std::string>> hashes = Hash::get_file_hashes(files, hash_type);
+
+        bool failed = false;
+        for (size_t i = 0; i < files.size(); ++i)
         {
-            do_file_hash(args.command_arguments[0], Strings::utf8_to_utf16(args.command_arguments[1]));
+            if (const std::string* hash = hashes[i].get())
+            {
+                if (files.size() == 1)
+                    System::println(hash->c_str());
+                else
+                    System::println("%s  %s", *hash, files[i].generic_string());
+                continue;
+            }
+
+            System::println(System::color::error, "Error: could not hash %s: %s", files[i].generic_string(), hashes[i].error_code().message());
+            failed = true;
         }
 
-        exit(EXIT_SUCCESS);
+        exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
     }
 }
@@ -1,6 +1,7 @@
 #include "vcpkg_Commands.h"
 #include "vcpkg_System.h"
 #include "vcpkg_info.h"
+#include <algorithm>
 
 namespace vcpkg
 {
@@ -46,10 +47,15 @@ namespace vcpkg
     void help_topic_valid_triplet(const vcpkg_paths& paths)
     {
         System::println("Available architecture triplets:");
-        auto it = fs::directory_iterator(paths.triplets);
-        for (; it != fs::directory_iterator(); ++it)
+        std::vector<std::string> names;
+        for (auto&& kv : paths.triplets_catalogue())
         {
-            System::println("  %s", it->path().stem().filename().string());
+            names.push_back(kv.first);
+        }
+        std::sort(names.begin(), names.end());
+        for (const std::string& name : names)
+        {
+            System::println("  %s", name);
         }
     }
 }
@@ -10,18 +10,82 @@
 #include "vcpkg_Input.h"
 #include "vcpkg_Maps.h"
 #include "Paragraphs.h"
+#include "BuildInfo.h"
 #include "vcpkg_info.h"
+#include "vcpkg_BinaryCache.h"
+#include "vcpkg_ImportGraph.h"
+#include "MSBuildProps.h"
+#include "vcpkg_Downloads.h"
+#include "vcpkg_Trace.h"
+#include "BuildDurations.h"
+#include "BuildResources.h"
+#include "vcpkg_BuildProgress.h"
+#include "CompilerCache.h"
+#include "PackageArchive.h"
+#include "PackagesIndex.h"
+#include "Trash.h"
+#include "DiskBudget.h"
+#include "InstallLock.h"
+#include "Stopwatch.h"
+#include "BuildFarm.h"
+#include "SymbolStore.h"
+#include "vcpkg_Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <chrono>
+#include <map>
+#include <set>
+#include <Windows.h>
 
 namespace vcpkg
 {
-    static void create_binary_control_file(const vcpkg_paths& paths, const SourceParagraph& source_paragraph, const triplet& target_triplet)
+    static const std::string OPTION_LINK = "--link";
+    static const std::string OPTION_DRY_RUN = "--dry-run";
+    static const std::string OPTION_TAIL_LOGS = "--tail-logs";
+    static const std::string OPTION_INCREMENTAL = "--incremental";
+    static const std::string OPTION_WATCH = "--watch";
+
+    // vcpkg_configure_cmake keeps the build trees of the ports it configures when VCPKG_INCREMENTAL is set, unless what
+    // they were configured with changed beyond the options of the port, which cmake then applies to the trees it has
+    static void enable_incremental_builds()
+    {
+        _wputenv_s(L"VCPKG_INCREMENTAL", L"ON");
+    }
+
+    // With VCPKG_CLEAN_BUILDTREES set, the build trees of a port are moved to the trash as soon as its package is made,
+    // for machines that build many ports once and have no use for them afterwards
+    static bool clean_buildtrees_after_build()
+    {
+        static const bool enabled = !System::wdupenv_str(L"VCPKG_CLEAN_BUILDTREES").empty();
+        return enabled;
+    }
+
+    static void create_binary_control_file(const vcpkg_paths& paths, const SourceParagraph& source_paragraph, const triplet& target_triplet, const std::string& abi)
     {
         auto bpgh = BinaryParagraph(source_paragraph, target_triplet);
+        bpgh.abi = abi;
         const fs::path binary_control_file = paths.packages / bpgh.dir() / "CONTROL";
         std::ofstream(binary_control_file) << bpgh;
+        PackagesIndex::add_package(paths, bpgh);
     }
 
-    static void build_internal(const package_spec& spec, const vcpkg_paths& paths, const fs::path& port_dir)
+    enum class build_result
+    {
+        SUCCEEDED,
+        BUILD_FAILED,
+        POST_BUILD_CHECKS_FAILED
+    };
+
+    // build_jobs is the share of the machine given to this build; the build helpers split it between the configurations they run concurrently.
+    // What the build script prints goes to output, and usage receives the resources the whole build used.
+    // built, if given, is called as soon as the build script exits, before the post-build checks: its jobs are free again by then.
+    static build_result build_internal(const package_spec& spec, const vcpkg_paths& paths, const fs::path& port_dir, const std::string& abi, const size_t build_jobs,
+                                       BuildProgress::build_output& output, System::resource_usage& usage, const std::function<void()>& built = nullptr)
     {
         auto pghs = Paragraphs::get_paragraphs(port_dir / "CONTROL");
         Checks::check_exit(pghs.size() == 1, "Error: invalid control file");
@@ -29,21 +93,74 @@ namespace vcpkg
 
         const fs::path ports_cmake_script_path = paths.ports_cmake;
         auto&& target_triplet = spec.target_triplet();
-        const std::wstring command = Strings::wformat(LR"("%%VS140COMNTOOLS%%..\..\VC\vcvarsall.bat" %s && cmake -DCMD=BUILD -DPORT=%s -DTARGET_TRIPLET=%s "-DCURRENT_PORT_DIR=%s/." -P "%s")",
-                                                      Strings::utf8_to_utf16(target_triplet.architecture()),
-                                                      Strings::utf8_to_utf16(spec.name()),
-                                                      Strings::utf8_to_utf16(target_triplet.canonical_name()),
-                                                      port_dir.generic_wstring(),
-                                                      ports_cmake_script_path.generic_wstring());
-
-        System::Stopwatch2 timer;
+
+        // vcpkg_execute_required_process appends the duration of each configure/build/install step here
+        const fs::path trace_phases_file = paths.buildtrees / spec.name() / ("trace-phases-" + target_triplet.canonical_name() + ".txt");
+        std::wstring trace_phases_option;
+        if (Trace::is_enabled())
+        {
+            std::error_code ec;
+            fs::remove(trace_phases_file, ec);
+            trace_phases_option = Strings::wformat(LR"( "-DVCPKG_TRACE_PHASES_FILE=%s")", trace_phases_file.generic_wstring());
+        }
+
+        // Checked by Input::check_triplet before anything is built
+        const triplet_properties* properties = paths.find_triplet(target_triplet);
+        Checks::check_exit(properties != nullptr, "Error: invalid triplet: %s", target_triplet);
+
+        const std::wstring cmake_command = Strings::wformat(LR"(cmake -DCMD=BUILD -DPORT=%s -DTARGET_TRIPLET=%s -DHOST_TRIPLET=%s -DTRIPLET_SYSTEM_ARCH=%s -DTRIPLET_SYSTEM_NAME=%s "-DCURRENT_PORT_DIR=%s/." "-DVCPKG_EXE=%s" -DVCPKG_BUILD_JOBS=%s%s -P "%s")",
+                                                            Strings::utf8_to_utf16(spec.name()),
+                                                            Strings::utf8_to_utf16(target_triplet.canonical_name()),
+                                                            Strings::utf8_to_utf16(paths.host_triplet.canonical_name()),
+                                                            Strings::utf8_to_utf16(properties->architecture),
+                                                            Strings::utf8_to_utf16(target_triplet.system()),
+                                                            port_dir.generic_wstring(),
+                                                            System::get_exe_path_of_current_process().generic_wstring(),
+                                                            std::to_wstring(build_jobs),
+                                                            trace_phases_option,
+                                                            ports_cmake_script_path.generic_wstring());
+
+        Stopwatch timer = Stopwatch::createUnstarted();
+        const long long trace_start_us = Trace::now_us();
         timer.start();
-        int return_code = System::cmd_execute(command);
+        // cmake runs in the environment vcvarsall.bat sets up, captured once per architecture, or else behind vcvarsall in cmd.
+        // A header-only port compiles nothing, so its portfile runs in the environment of vcpkg and no toolchain is looked for.
+        // Its output is read through a pipe so that concurrent builds do not write over each other.
+        const std::wstring vcvars_environment = source_paragraph.header_only ? std::wstring() : Environment::get_vcvars_environment(paths, properties->architecture);
+        const std::wstring command = source_paragraph.header_only || !vcvars_environment.empty()
+                                         ? cmake_command
+                                         : Strings::wformat(LR"(cmd.exe /c ""%%VS140COMNTOOLS%%..\..\VC\vcvarsall.bat" %s && %s")", Strings::utf8_to_utf16(properties->architecture), cmake_command);
+        int return_code = System::process_execute(command, [&](const std::string& line) { output.line(line); }, fs::path(), &usage, vcvars_environment);
         timer.stop();
-        TrackMetric("buildtimeus-" + to_string(spec), timer.microseconds());
+        if (built)
+        {
+            built();
+        }
+        TrackMetric("buildtimeus-" + to_string(spec), static_cast<double>(timer.elapsed<std::chrono::microseconds>().count()));
+        Trace::span_args resource_args;
+        if (usage.measured)
+        {
+            TrackMetric("buildcpums-" + to_string(spec), static_cast<double>(usage.cpu_ms));
+            TrackMetric("buildpeakmemorybytes-" + to_string(spec), static_cast<double>(usage.peak_memory_bytes));
+            TrackMetric("buildreadbytes-" + to_string(spec), static_cast<double>(usage.read_bytes));
+            TrackMetric("buildwritebytes-" + to_string(spec), static_cast<double>(usage.write_bytes));
+            resource_args = {
+                {"cpu_ms", usage.cpu_ms},
+                {"peak_memory_bytes", static_cast<long long>(usage.peak_memory_bytes)},
+                {"read_bytes", static_cast<long long>(usage.read_bytes)},
+                {"write_bytes", static_cast<long long>(usage.write_bytes)},
+                {"processes", static_cast<long long>(usage.process_count)}
+            };
+        }
+        if (Trace::is_enabled())
+        {
+            Trace::record_span(to_string(spec) + ":build", "port", trace_start_us, Trace::now_us(), resource_args);
+            Trace::record_cmake_phases(trace_phases_file, to_string(spec));
+        }
 
         if (return_code != 0)
         {
+            output.print_held();
             System::println(System::color::error, "Error: building package %s failed", to_string(spec));
             System::println("Please ensure sure you're using the latest portfiles with `vcpkg update`, then\n"
                             "submit an issue at https://github.com/Microsoft/vcpkg/issues including:\n"
@@ -54,132 +171,1376 @@ namespace vcpkg
                             , to_string(spec), Info::version());
             TrackProperty("error", "build failed");
             TrackProperty("build_error", to_string(spec));
-            exit(EXIT_FAILURE);
+            return build_result::BUILD_FAILED;
         }
 
-        perform_all_checks(spec, paths);
+        {
+            const Trace::scoped_span lint_span(to_string(spec) + ":post_build_lint", "port");
+            if (perform_all_checks(spec, paths, source_paragraph.header_only) != 0)
+            {
+                return build_result::POST_BUILD_CHECKS_FAILED;
+            }
+        }
 
-        create_binary_control_file(paths, source_paragraph, target_triplet);
+        create_binary_control_file(paths, source_paragraph, target_triplet, abi);
+        DiskBudget::record_access(paths, {paths.buildtrees / spec.name()});
 
-        // const fs::path port_buildtrees_dir = paths.buildtrees / spec.name;
-        // delete_directory(port_buildtrees_dir);
+        // The sources in buildtrees/<port>/src are shared with the other triplets of the port, which may be building: only
+        // the build trees of this triplet go
+        if (clean_buildtrees_after_build())
+        {
+            for (const std::string& configuration : {std::string("-rel"), std::string("-dbg")})
+            {
+                Trash::move_to_trash(paths, paths.buildtrees / spec.name() / (target_triplet.canonical_name() + configuration));
+            }
+        }
+        return build_result::SUCCEEDED;
     }
 
-    static void build_internal(const package_spec& spec, const vcpkg_paths& paths)
+    static build_result build_internal(const package_spec& spec, const vcpkg_paths& paths, const std::string& abi, const size_t build_jobs,
+                                       BuildProgress::build_output& output, System::resource_usage& usage, const std::function<void()>& built = nullptr)
     {
-        return build_internal(spec, paths, paths.ports / spec.name());
+        return build_internal(spec, paths, paths.ports / spec.name(), abi, build_jobs, output, usage, built);
     }
 
-    void install_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet)
+    // From the BUILD_INFO of the package just built, in packages/<spec> or in its archive
+    static bool built_as_unity_build(const vcpkg_paths& paths, const package_spec& spec)
     {
-        static const std::string example = create_example_string("install zlib zlib:x64-windows curl boost");
-        args.check_min_arg_count(1, example.c_str());
-        StatusParagraphs status_db = database_load_check(paths);
+        const fs::path build_info_file = paths.build_info_file_path(spec);
+        const expected<std::string> contents = fs::exists(build_info_file)
+                                                   ? Files::get_contents(build_info_file)
+                                                   : PackageArchive::read_file(PackageArchive::archive_path(paths, spec), "BUILD_INFO");
+        const std::string* text = contents.get();
+        if (text == nullptr)
+        {
+            return false;
+        }
 
-        std::vector<package_spec> specs = Input::check_and_get_package_specs(args.command_arguments, default_target_triplet, example.c_str());
-        Input::check_triplets(specs, paths);
-        std::vector<package_spec> install_plan = Dependencies::create_dependency_ordered_install_plan(paths, specs, status_db);
-        Checks::check_exit(!install_plan.empty(), "Install plan cannot be empty");
-        std::string specs_string = to_string(install_plan[0]);
-        for (size_t i = 1; i < install_plan.size(); ++i)
+        const std::vector<std::unordered_map<std::string, std::string>> pghs = Paragraphs::parse_paragraphs(*text);
+        return pghs.size() == 1 && BuildInfo::create(pghs[0]).unity_build;
+    }
+
+    static size_t get_hardware_jobs()
+    {
+        return std::max(size_t(1), static_cast<size_t>(std::thread::hardware_concurrency()));
+    }
+
+    static bool package_matches_abi(const vcpkg_paths& paths, const package_spec& spec, const std::string& abi)
+    {
+        const expected<std::string> control_contents = PackageArchive::read_control_file(paths, spec);
+        if (auto contents = control_contents.get())
         {
-            specs_string.push_back(',');
-            specs_string.append(to_string(install_plan[i]));
+            const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(*contents);
+            if (pghs.size() != 1)
+            {
+                return false;
+            }
+
+            // A package built before ABI hashes were recorded may come from any version of its port, so it is rebuilt
+            const BinaryParagraph bpgh(pghs[0]);
+            return abi.empty() || bpgh.abi == abi;
         }
-        TrackProperty("installplan", specs_string);
-        Environment::ensure_utilities_on_path(paths);
 
-        for (const package_spec& spec : install_plan)
+        return false;
+    }
+
+    static size_t get_job_count(const vcpkg_cmd_arguments& args)
+    {
+        if (args.jobs == nullptr)
         {
-            if (status_db.find_installed(spec.name(), spec.target_triplet()) != status_db.end())
+            return 1;
+        }
+
+        // std::stoi stops at the first character that is not a digit; "3abc" is not a job count
+        int job_count = 0;
+        try
+        {
+            size_t pos = 0;
+            job_count = std::stoi(*args.jobs, &pos);
+            if (pos != args.jobs->size())
             {
-                System::println(System::color::success, "Package %s is already installed", spec);
-                continue;
+                job_count = 0;
+            }
+        }
+        catch (const std::exception&)
+        {
+        }
+
+        Checks::check_exit(job_count > 0, "Error: --jobs expects a positive number, but got %s", *args.jobs);
+        return static_cast<size_t>(job_count);
+    }
+
+    // Runs on a worker thread. Only touches packages/<spec>, buildtrees/<port> and the binary cache; the status database is left to the caller.
+    // build_time_ms is set to how long the port took to build, or -1 if it was not built, and usage to what the build used.
+    // built is called when the port no longer needs its jobs: the checks, caching and compression that follow its build are I/O.
+    // build_remotely, if given, farms the build out, with the jobs given back through built while the farm builds; the port is
+    // only built here when the farm lost it, once reacquire_jobs has returned with the port holding its jobs again.
+    // port_abi, if not empty, is the hash of the port files as they are now, for an abi recorded earlier: the port is only
+    // built if they agree, as its package would otherwise be cached and recorded under a hash it does not have.
+    static build_result build_if_not_cached(const package_spec& spec, const vcpkg_paths& paths, const fs::path& binary_cache_dir, const std::string& abi,
+                                            const std::string& port_abi, const size_t build_jobs,
+                                            BuildProgress::tracker& progress, BuildProgress::build_output& output, long long& build_time_ms,
+                                            System::resource_usage& usage, const std::function<void()>& built,
+                                            const std::function<BuildFarm::remote_result()>& build_remotely = nullptr,
+                                            const std::function<void()>& reacquire_jobs = nullptr)
+    {
+        build_time_ms = -1;
+        usage = {};
+        try
+        {
+            // A port that cannot be built fails on its own, while the installer thread may be writing installed/
+            const Checks::failures_throw failures_throw;
+            if (package_matches_abi(paths, spec, abi))
+            {
+                return build_result::SUCCEEDED;
             }
 
-            fs::path package_path = paths.package_dir(spec);
+            // The archive of an outdated build is not replaced if this build fails
+            std::error_code ec;
+            fs::remove(PackageArchive::archive_path(paths, spec), ec);
 
-            expected<std::string> file_contents = Files::get_contents(package_path / "CONTROL");
+            progress.set_phase(spec, "restoring");
+            if (!binary_cache_dir.empty() && BinaryCache::try_restore(paths, binary_cache_dir, spec, abi))
+            {
+                System::println(System::color::success, "Restored package %s from the binary cache", spec);
+                PackageArchive::compress_package(paths, spec);
+                return build_result::SUCCEEDED;
+            }
 
-            try
+            if (build_remotely)
             {
-                if (file_contents.error_code())
+                // Waiting for the farm takes none of the jobs of this machine
+                progress.set_phase(spec, "building on the farm");
+                built();
+                const BuildFarm::remote_result remote = build_remotely();
+                if (remote == BuildFarm::remote_result::FAILED)
                 {
-                    build_internal(spec, paths);
-                    file_contents = Files::get_contents(package_path / "CONTROL");
-                    if (file_contents.error_code())
-                    {
-                        file_contents.get_or_throw();
-                    }
+                    output.print_held();
+                    System::println(System::color::error, "Error: building package %s on the build farm failed", to_string(spec));
+                    return build_result::BUILD_FAILED;
+                }
+                if (remote == BuildFarm::remote_result::SUCCEEDED && BinaryCache::try_restore(paths, binary_cache_dir, spec, abi))
+                {
+                    System::println(System::color::success, "Restored package %s built on the build farm", spec);
+                    PackageArchive::compress_package(paths, spec);
+                    return build_result::SUCCEEDED;
                 }
+                System::println(System::color::warning, "Warning: the build farm lost the build of %s; building it here", to_string(spec));
+                progress.set_phase(spec, "waiting for a job");
+                reacquire_jobs();
+            }
 
-                auto pghs = Paragraphs::parse_paragraphs(file_contents.get_or_throw());
-                Checks::check_throw(pghs.size() == 1, "multiple paragraphs in control file");
-                install_package(paths, BinaryParagraph(pghs[0]), status_db);
-                System::println(System::color::success, "Package %s is installed", spec);
+            if (!port_abi.empty() && port_abi != abi)
+            {
+                System::println(System::color::error, "Error: the port %s changed since the lock was written; rebuild the lock to build it", to_string(spec));
+                return build_result::BUILD_FAILED;
             }
-            catch (const std::exception& e)
+
+            progress.set_phase(spec, "building");
+            Stopwatch timer = Stopwatch::createStarted();
+            const build_result result = build_internal(spec, paths, abi, build_jobs, output, usage, [&]()
+                {
+                    progress.set_phase(spec, "checking");
+                    built();
+                });
+            timer.stop();
+            if (result == build_result::SUCCEEDED)
             {
-                System::println(System::color::error, "Error: Could not install package %s: %s", spec, e.what());
-                exit(EXIT_FAILURE);
+                build_time_ms = timer.elapsed<std::chrono::milliseconds>().count();
+            }
+            if (result == build_result::SUCCEEDED && !binary_cache_dir.empty())
+            {
+                progress.set_phase(spec, "caching");
+                BinaryCache::store(paths, binary_cache_dir, spec, abi);
             }
+            if (result == build_result::SUCCEEDED && PackageArchive::is_enabled())
+            {
+                progress.set_phase(spec, "compressing");
+                PackageArchive::compress_package(paths, spec);
+            }
+            return result;
+        }
+        catch (const std::exception& e)
+        {
+            System::println(System::color::error, "Error: building package %s failed: %s", to_string(spec), e.what());
+            return build_result::BUILD_FAILED;
+        }
+        catch (const Parallel::task_failed&)
+        {
+            // The message has been printed
+            return build_result::BUILD_FAILED;
         }
-
-        exit(EXIT_SUCCESS);
     }
 
-    void build_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet)
+    static bool install_built_package(const vcpkg_paths& paths, const package_spec& spec, StatusParagraphs& status_db, install_file_mode mode)
     {
-        static const std::string example = create_example_string("build zlib:x64-windows");
+        try
+        {
+            const expected<std::string> file_contents = PackageArchive::read_control_file(paths, spec);
+            const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(file_contents.get_or_throw());
+            Checks::check_throw(pghs.size() == 1, "multiple paragraphs in control file");
+            const BinaryParagraph bpgh(pghs[0]);
+            const std::unordered_set<std::string> stored_pdbs = SymbolStore::is_enabled() ? SymbolStore::store_package_pdbs(paths, bpgh) : std::unordered_set<std::string>();
+            // Headers are never rebuilt in place, so a header-only package can share its files with packages/
+            install_package(paths, bpgh, status_db, bpgh.header_only ? install_file_mode::hard_link : mode, stored_pdbs);
+            ImportGraph::add_package(paths, bpgh, status_db);
+            MSBuildProps::add_package(paths, bpgh, status_db);
+            DiskBudget::record_access(paths, {paths.package_dir(spec)});
+            System::println(System::color::success, "Package %s is installed", spec);
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            System::println(System::color::error, "Error: Could not install package %s: %s", spec, e.what());
+            return false;
+        }
+    }
 
-        // Installing multiple packages leads to unintuitive behavior if one of them depends on another.
-        // Allowing only 1 package for now.
+    // dependents[i] lists the entries of the install plan that depend on install_plan[i]; they all come after it
+    static std::vector<std::vector<size_t>> get_plan_dependents(const std::vector<package_spec>& install_plan, const Graphs::Graph<package_spec>& dependency_graph)
+    {
+        const std::unordered_map<package_spec, std::vector<package_spec>>& dependencies = dependency_graph.adjacency_list();
 
-        args.check_exact_arg_count(1, example.c_str());
-        StatusParagraphs status_db = database_load_check(paths);
+        std::unordered_map<package_spec, size_t> plan_index_of;
+        for (size_t i = 0; i < install_plan.size(); ++i)
+        {
+            plan_index_of.emplace(install_plan[i], i);
+        }
 
-        const package_spec spec = Input::check_and_get_package_spec(args.command_arguments.at(0), default_target_triplet, example.c_str());
-        Input::check_triplet(spec.target_triplet(), paths);
+        std::vector<std::vector<size_t>> dependents(install_plan.size());
+        for (size_t i = 0; i < install_plan.size(); ++i)
+        {
+            for (const package_spec& dep : dependencies.at(install_plan[i]))
+            {
+                dependents[plan_index_of.at(dep)].push_back(i);
+            }
+        }
+        return dependents;
+    }
 
-        // Explicitly load and use the portfile's build dependencies when resolving the build command (instead of a cached package's dependencies).
-        auto first_level_deps = Dependencies::get_unmet_package_build_dependencies(paths, spec);
-        std::vector<package_spec> first_level_deps_specs;
-        for (auto&& dep : first_level_deps)
+    // The recorded build time of each entry of the install plan; 0 for installed packages, and the average of the recorded
+    // times for ports that were never built here, whose number is returned in unknown_count
+    static std::vector<long long> estimate_build_times(const vcpkg_paths& paths, const std::vector<package_spec>& install_plan, const StatusParagraphs& status_db, size_t& unknown_count)
+    {
+        const BuildDurations::duration_map recorded = BuildDurations::load(paths);
+        long long average = 0;
+        for (auto&& kv : recorded)
         {
-            first_level_deps_specs.push_back(package_spec::from_name_and_triplet(dep, spec.target_triplet()).get_or_throw());
+            average += kv.second;
+        }
+        if (!recorded.empty())
+        {
+            average /= static_cast<long long>(recorded.size());
         }
 
-        std::unordered_set<package_spec> unmet_dependencies = Dependencies::get_unmet_dependencies(paths, first_level_deps_specs, status_db);
-        if (!unmet_dependencies.empty())
+        unknown_count = 0;
+        std::vector<long long> build_times(install_plan.size());
+        for (size_t i = 0; i < install_plan.size(); ++i)
         {
-            System::println(System::color::error, "The build command requires all dependencies to be already installed.");
-            System::println("The following dependencies are missing:");
-            System::println("");
-            for (const package_spec& p : unmet_dependencies)
+            const package_spec& spec = install_plan[i];
+            if (status_db.find_installed(spec.name(), spec.target_triplet()) != status_db.end())
             {
-                System::println("    %s", to_string(p));
+                continue;
             }
-            System::println("");
-            exit(EXIT_FAILURE);
-        }
 
-        Environment::ensure_utilities_on_path(paths);
-        build_internal(spec, paths);
-        exit(EXIT_SUCCESS);
+            const auto it = recorded.find(to_string(spec));
+            if (it != recorded.end())
+            {
+                build_times[i] = it->second;
+            }
+            else
+            {
+                build_times[i] = average;
+                ++unknown_count;
+            }
+        }
+        return build_times;
     }
 
-    void build_external_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet)
+    // Builds every package whose dependencies are already installed concurrently, up to job_count at a time.
+    // Installation itself (and therefore every write to the status database) happens on a single installer thread, in completion order.
+    // The console shows the builds in progress; the output of their build scripts is only printed as it comes when
+    // a single build runs at a time or tail_logs is set, which also prints the logs of their build steps.
+    static void execute_install_plan(const vcpkg_paths& paths,
+                                     const std::vector<package_spec>& install_plan,
+                                     const Graphs::Graph<package_spec>& dependency_graph,
+                                     const std::unordered_map<package_spec, std::string>& abis,
+                                     const std::unordered_map<package_spec, std::string>& port_abis,
+                                     StatusParagraphs& status_db,
+                                     const size_t job_count,
+                                     const install_file_mode mode,
+                                     const bool tail_logs)
     {
-        static const std::string example = create_example_string(R"(build_external zlib2 C:\path\to\dir\with\controlfile\)");
-        args.check_exact_arg_count(2, example.c_str());
+        const fs::path binary_cache_dir = BinaryCache::get_cache_dir(paths);
 
-        expected<package_spec> current_spec = package_spec::from_string(args.command_arguments[0], default_target_triplet);
-        if (auto spec = current_spec.get())
+        // Workers print through a single writer thread rather than taking turns at the console
+        const System::async_console console;
+        std::vector<package_spec> specs_to_build;
+        for (const package_spec& spec : install_plan)
         {
-            Input::check_triplet(spec->target_triplet(), paths);
-            Environment::ensure_utilities_on_path(paths);
-            const fs::path port_dir = args.command_arguments.at(1);
-            build_internal(*spec, paths, port_dir);
+            if (status_db.find_installed(spec.name(), spec.target_triplet()) == status_db.end())
+            {
+                specs_to_build.push_back(spec);
+            }
+        }
+        BuildProgress::tracker progress(paths, specs_to_build.size(), tail_logs);
+
+        // The hit rate of the compiler caches the triplets build through is reported for this install alone
+        const std::vector<CompilerCache::compiler_cache> compiler_caches = CompilerCache::find_compiler_caches(paths, specs_to_build);
+        std::vector<CompilerCache::cache_stats> compiler_cache_stats_before;
+        for (const CompilerCache::compiler_cache& cache : compiler_caches)
+        {
+            compiler_cache_stats_before.push_back(CompilerCache::query_stats(cache));
+        }
+        const auto refresh_interval = std::chrono::milliseconds(tail_logs ? 250 : 1000);
+
+        const size_t hardware_jobs = get_hardware_jobs();
+
+        struct finished_build
+        {
+            size_t plan_index;
+            build_result result;
+            long long build_time_ms;
+            System::resource_usage usage;
+        };
+
+        const std::vector<std::vector<size_t>> dependents = get_plan_dependents(install_plan, dependency_graph);
+        std::vector<size_t> unmet_dependency_count(install_plan.size());
+        for (const std::vector<size_t>& of_one : dependents)
+        {
+            for (const size_t dependent : of_one)
+            {
+                ++unmet_dependency_count[dependent];
+            }
+        }
+
+        // Ready ports are started by longest critical path first, estimated from the build times recorded on this machine,
+        // so that long chains of dependencies do not wait behind short leaves; ties keep the install plan order
+        size_t unknown_count;
+        const std::vector<long long> critical_paths = BuildDurations::critical_paths(estimate_build_times(paths, install_plan, status_db, unknown_count), dependents);
+        std::set<std::pair<long long, size_t>> ready; // (-critical path, plan index)
+        for (size_t i = 0; i < install_plan.size(); ++i)
+        {
+            if (unmet_dependency_count[i] == 0)
+            {
+                ready.emplace(-critical_paths[i], i);
+            }
+        }
+
+        auto mark_installed = [&](const size_t plan_index)
+        {
+            for (const size_t dependent : dependents[plan_index])
+            {
+                if (--unmet_dependency_count[dependent] == 0)
+                {
+                    ready.emplace(-critical_paths[dependent], dependent);
+                }
+            }
+        };
+
+        BuildDurations::duration_map measured;
+        BuildResources::resource_map measured_resources;
+
+        // Read once: the status database is only touched by the installer thread from here on
+        std::vector<bool> installed_before(install_plan.size());
+        for (size_t i = 0; i < install_plan.size(); ++i)
+        {
+            installed_before[i] = status_db.find_installed(install_plan[i].name(), install_plan[i].target_triplet()) != status_db.end();
+        }
+
+        std::mutex finished_mutex;
+        std::condition_variable build_finished; // Notified whenever one of the three lists below grows
+        std::vector<size_t> built; // Builds that no longer need their jobs; guarded by finished_mutex
+        std::vector<finished_build> finished; // Guarded by finished_mutex
+        std::vector<std::pair<size_t, bool>> installed; // Plan index and whether it could be installed; guarded by finished_mutex
+        std::vector<size_t> wanting_job; // Builds the farm lost, which need a job again to build here; guarded by finished_mutex
+        std::condition_variable job_granted;
+        std::unordered_set<size_t> granted; // Builds given a job again; guarded by finished_mutex
+        std::vector<std::thread> workers;
+
+        // Installation, and therefore every write to the status database, happens on a thread of its own, in completion
+        // order. Copying a package into installed/ thus overlaps with the builds of the ports that do not depend on it,
+        // while its dependents only become ready once it is installed.
+        std::condition_variable install_queued;
+        std::deque<size_t> to_install; // Guarded by finished_mutex
+        bool no_more_installs = false; // Guarded by finished_mutex
+        std::thread installer([&]()
+            {
+                std::unique_lock<std::mutex> lock(finished_mutex);
+                for (;;)
+                {
+                    install_queued.wait(lock, [&]() { return !to_install.empty() || no_more_installs; });
+                    if (to_install.empty())
+                    {
+                        return;
+                    }
+                    const size_t plan_index = to_install.front();
+                    to_install.pop_front();
+
+                    lock.unlock();
+                    const bool succeeded = install_built_package(paths, install_plan[plan_index], status_db, mode);
+                    lock.lock();
+                    installed.emplace_back(plan_index, succeeded);
+                    build_finished.notify_one();
+                }
+            });
+
+        // Triplets of a port share the sources extracted into buildtrees/<port>/src and are built concurrently; ports.cmake
+        // makes the ones whose portfile cannot share its source tree wait for each other. Other ports are started first,
+        // so a triplet that may have to wait does not hold a job while another port could use it.
+        // A build holds one of the job_count jobs until its build script exits; its checks run after it gave the job back.
+        // With a build farm, each port goes out with the part of the plan it needs: itself, last, and its dependencies
+        const fs::path farm_dir = BuildFarm::get_farm_dir();
+        auto get_farm_plan = [&](const size_t plan_index)
+        {
+            const std::unordered_map<package_spec, std::vector<package_spec>>& dependencies = dependency_graph.adjacency_list();
+            std::unordered_set<package_spec> needed;
+            std::vector<package_spec> to_visit = {install_plan[plan_index]};
+            while (!to_visit.empty())
+            {
+                const package_spec spec = to_visit.back();
+                to_visit.pop_back();
+                if (needed.insert(spec).second)
+                {
+                    to_visit.insert(to_visit.end(), dependencies.at(spec).begin(), dependencies.at(spec).end());
+                }
+            }
+
+            InstallLock::locked_plan farm_plan;
+            for (size_t i = 0; i <= plan_index; ++i)
+            {
+                const package_spec& spec = install_plan[i];
+                if (needed.find(spec) == needed.end())
+                {
+                    continue;
+                }
+                farm_plan.plan.push_back(spec);
+                farm_plan.abis.emplace(spec, abis.at(spec));
+                farm_plan.dependency_graph.add_vertex(spec);
+                for (const package_spec& dependency : dependencies.at(spec))
+                {
+                    farm_plan.dependency_graph.add_edge(spec, dependency);
+                }
+            }
+            return farm_plan;
+        };
+
+        std::unordered_map<std::string, size_t> ports_being_built;
+        std::vector<bool> holds_job(install_plan.size());
+        size_t running = 0;
+        size_t in_flight = 0; // Started, and neither installed nor failed yet
+        size_t remaining = install_plan.size();
+        std::vector<package_spec> failed;
+
+        auto release_job = [&](const size_t plan_index)
+        {
+            if (holds_job[plan_index])
+            {
+                holds_job[plan_index] = false;
+                --running;
+                --ports_being_built[install_plan[plan_index].name()];
+            }
+        };
+
+        // Ports the farm gave back were started before any port still waiting, so they get the jobs that free up first
+        std::deque<size_t> job_requests;
+        auto grant_job_requests = [&]()
+        {
+            while (!job_requests.empty() && running < job_count)
+            {
+                const size_t plan_index = job_requests.front();
+                job_requests.pop_front();
+                ++ports_being_built[install_plan[plan_index].name()];
+                holds_job[plan_index] = true;
+                ++running;
+
+                std::lock_guard<std::mutex> lock(finished_mutex);
+                granted.insert(plan_index);
+                job_granted.notify_all();
+            }
+        };
+
+        while (remaining != 0)
+        {
+            grant_job_requests();
+
+            // The first pass only starts ports that are not being built yet
+            for (int pass = 0; pass != 2; ++pass)
+            {
+                for (auto it = ready.begin(); failed.empty() && it != ready.end() && running < job_count;)
+                {
+                    const size_t plan_index = it->second;
+                    const package_spec& spec = install_plan[plan_index];
+                    if (installed_before[plan_index])
+                    {
+                        System::println(System::color::success, "Package %s is already installed", spec);
+                        ready.erase(it);
+                        --remaining;
+                        mark_installed(plan_index);
+                        // Its dependents may sort before it
+                        it = ready.begin();
+                        continue;
+                    }
+
+                    if (pass == 0 && ports_being_built[spec.name()] != 0)
+                    {
+                        ++it;
+                        continue;
+                    }
+
+                    ++ports_being_built[spec.name()];
+                    holds_job[plan_index] = true;
+                    ++running;
+                    ++in_flight;
+                    it = ready.erase(it);
+
+                    // Each port may use an equal share of the machine between the builds that can run now. A port every
+                    // other one waits for gets all of it; the jobs themselves come from the shared token pool, so the
+                    // ports started later take whatever the earlier ones leave.
+                    const size_t concurrent_builds = std::min(job_count, running + ready.size());
+                    const size_t build_jobs = std::max(size_t(1), hardware_jobs / concurrent_builds);
+                    progress.started(spec);
+                    const InstallLock::locked_plan farm_plan = farm_dir.empty() ? InstallLock::locked_plan() : get_farm_plan(plan_index);
+                    workers.emplace_back([&, plan_index, build_jobs, farm_plan]()
+                        {
+                            const package_spec& spec_to_build = install_plan[plan_index];
+                            const auto abi = abis.find(spec_to_build);
+                            const auto port_abi = port_abis.find(spec_to_build);
+                            BuildProgress::build_output output(job_count == 1 ? std::string() : Strings::format("[%s] ", to_string(spec_to_build)), job_count == 1 || tail_logs);
+                            long long build_time_ms;
+                            System::resource_usage usage;
+                            std::function<BuildFarm::remote_result()> build_remotely;
+                            if (!farm_dir.empty())
+                            {
+                                build_remotely = [&]()
+                                {
+                                    return BuildFarm::build_remotely(paths, farm_dir, farm_plan, [&](const std::string& line) { output.line(line); });
+                                };
+                            }
+                            auto reacquire_jobs = [&]()
+                            {
+                                std::unique_lock<std::mutex> lock(finished_mutex);
+                                wanting_job.push_back(plan_index);
+                                build_finished.notify_one();
+                                job_granted.wait(lock, [&]() { return granted.find(plan_index) != granted.end(); });
+                                granted.erase(plan_index);
+                            };
+                            const build_result result = build_if_not_cached(spec_to_build, paths, binary_cache_dir, abi != abis.end() ? abi->second : std::string(),
+                                                                            port_abi != port_abis.end() ? port_abi->second : std::string(), build_jobs,
+                                                                            progress, output, build_time_ms, usage, [&]()
+                                                                            {
+                                                                                std::lock_guard<std::mutex> lock(finished_mutex);
+                                                                                built.push_back(plan_index);
+                                                                                build_finished.notify_one();
+                                                                            }, build_remotely, reacquire_jobs);
+                            std::lock_guard<std::mutex> lock(finished_mutex);
+                            finished.push_back({plan_index, result, build_time_ms, usage});
+                            build_finished.notify_one();
+                        });
+                }
+            }
+
+            if (in_flight == 0)
+            {
+                Checks::check_exit(!failed.empty() || remaining == 0, "Error: no package in the install plan can be built");
+                break;
+            }
+
+            std::vector<size_t> newly_built;
+            std::vector<finished_build> newly_finished;
+            std::vector<std::pair<size_t, bool>> newly_installed;
+            {
+                std::unique_lock<std::mutex> lock(finished_mutex);
+                while (!build_finished.wait_for(lock, refresh_interval, [&]()
+                    {
+                        return !built.empty() || !finished.empty() || !installed.empty() || !wanting_job.empty();
+                    }))
+                {
+                    lock.unlock();
+                    progress.refresh();
+                    lock.lock();
+                }
+                newly_built.swap(built);
+                newly_finished.swap(finished);
+                newly_installed.swap(installed);
+                job_requests.insert(job_requests.end(), wanting_job.begin(), wanting_job.end());
+                wanting_job.clear();
+            }
+
+            for (const size_t plan_index : newly_built)
+            {
+                release_job(plan_index);
+            }
+
+            std::vector<size_t> newly_to_install;
+            for (const finished_build& build : newly_finished)
+            {
+                const package_spec& spec = install_plan[build.plan_index];
+                release_job(build.plan_index);
+                progress.finished(spec);
+                if (build.build_time_ms >= 0)
+                {
+                    measured[to_string(spec)] = build.build_time_ms;
+                    if (build.usage.measured)
+                    {
+                        measured_resources[to_string(spec)] = {build.build_time_ms, build.usage.cpu_ms, build.usage.peak_memory_bytes, build.usage.read_bytes, build.usage.write_bytes,
+                                                               built_as_unity_build(paths, spec)};
+                    }
+                }
+
+                if (build.result != build_result::SUCCEEDED)
+                {
+                    failed.push_back(spec);
+                    --in_flight;
+                    continue;
+                }
+
+                newly_to_install.push_back(build.plan_index);
+            }
+            if (!newly_to_install.empty())
+            {
+                std::lock_guard<std::mutex> lock(finished_mutex);
+                to_install.insert(to_install.end(), newly_to_install.begin(), newly_to_install.end());
+                install_queued.notify_one();
+            }
+
+            for (auto&& result : newly_installed)
+            {
+                --in_flight;
+                if (!result.second)
+                {
+                    failed.push_back(install_plan[result.first]);
+                    continue;
+                }
+
+                --remaining;
+                mark_installed(result.first);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(finished_mutex);
+            no_more_installs = true;
+            install_queued.notify_one();
+        }
+        installer.join();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        // Let the uploads of freshly built packages finish, even if some other package failed
+        BinaryCache::wait_for_background_transfers();
+        BuildDurations::record(paths, measured);
+        BuildResources::record(paths, measured_resources);
+
+        for (size_t i = 0; i < compiler_caches.size(); ++i)
+        {
+            const CompilerCache::cache_stats after = CompilerCache::query_stats(compiler_caches[i]);
+            if (after.measured)
+            {
+                System::println("Compiler cache %s", CompilerCache::format_stats_since(compiler_caches[i], compiler_cache_stats_before[i], after));
+            }
+        }
+
+        if (!failed.empty())
+        {
+            for (const package_spec& spec : failed)
+            {
+                System::println(System::color::error, "Error: Could not install package %s", spec);
+            }
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Whether specs and everything they depend on are installed, read from the status database without decoding more of it
+    // than the paragraphs of these packages
+    static bool are_installed_with_dependencies(const vcpkg_paths& paths, const std::vector<package_spec>& specs)
+    {
+        const status_snapshot status_db = load_status_snapshot(paths);
+        std::unordered_map<std::string, size_t> installed;
+        for (size_t i = 0; i < status_db.size(); ++i)
+        {
+            const status_snapshot::entry& entry = status_db[i];
+            if (entry.want == want_t::install && entry.state == install_state_t::installed)
+            {
+                installed.emplace(entry.displayname, i);
+            }
+        }
+
+        std::unordered_set<std::string> visited;
+        std::vector<std::string> to_visit;
+        for (const package_spec& spec : specs)
+        {
+            to_visit.push_back(to_string(spec));
+        }
+        while (!to_visit.empty())
+        {
+            const std::string displayname = std::move(to_visit.back());
+            to_visit.pop_back();
+            if (!visited.insert(displayname).second)
+            {
+                continue;
+            }
+
+            const auto it = installed.find(displayname);
+            if (it == installed.end())
+            {
+                return false;
+            }
+
+            const BinaryParagraph& package = status_db.paragraph(it->second).package;
+            for (const std::string& dependency : package.depends)
+            {
+                to_visit.push_back(dependency + ":" + package.spec.target_triplet().canonical_name());
+            }
+        }
+        return true;
+    }
+
+    // The databases an install loads: those of the triplets it locked, which are all it may change
+    static std::vector<triplet> triplets_of(const std::vector<package_spec>& specs)
+    {
+        std::vector<triplet> triplets;
+        for (const package_spec& spec : specs)
+        {
+            triplets.push_back(spec.target_triplet());
+        }
+        return triplets;
+    }
+
+    static void install_locked_plan(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, install_file_mode mode, bool dry_run, bool tail_logs);
+
+    void install_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet)
+    {
+        static const std::string example = create_example_string("install zlib zlib:x64-windows curl boost");
+        const std::unordered_set<std::string> options = args.check_and_get_optional_command_arguments({OPTION_LINK, OPTION_DRY_RUN, OPTION_TAIL_LOGS, OPTION_INCREMENTAL});
+        const install_file_mode mode = options.find(OPTION_LINK) != options.end() ? install_file_mode::hard_link : install_file_mode::copy;
+        const bool dry_run = options.find(OPTION_DRY_RUN) != options.end();
+        const bool tail_logs = options.find(OPTION_TAIL_LOGS) != options.end();
+        if (options.find(OPTION_INCREMENTAL) != options.end())
+        {
+            enable_incremental_builds();
+        }
+
+        if (args.lock_file != nullptr)
+        {
+            static const std::string lock_example = create_example_string("install --lock ci.lock");
+            args.check_exact_arg_count(0, lock_example.c_str());
+            Checks::check_exit(args.write_lock_file == nullptr, "Error: --lock and --write-lock cannot be used together");
+            install_locked_plan(args, paths, mode, dry_run, tail_logs);
+        }
+        args.check_min_arg_count(1, example.c_str());
+
+        std::vector<package_spec> specs = Input::check_and_get_package_specs(args.command_arguments, default_target_triplet, example.c_str());
+
+        // Build scripts install their dependencies at every run, and nearly always find them there: that case is answered
+        // from the status database alone, without locking the triplets, planning, or looking for the build tools
+        if (!dry_run && args.write_lock_file == nullptr && are_installed_with_dependencies(paths, specs))
+        {
+            for (const package_spec& spec : specs)
+            {
+                System::println(System::color::success, "Package %s is already installed", spec);
+            }
+            exit(EXIT_SUCCESS);
+        }
+
+        Input::check_triplets(specs, paths);
+        Trash::empty_in_background(paths);
+
+        // Dependencies share the triplet of their dependent, but for the host tools of ports built for other triplets.
+        // These are all the triplets the plan may install into.
+        std::vector<package_spec> triplet_specs = specs;
+        for (const package_spec& spec : specs)
+        {
+            if (spec.target_triplet() != paths.host_triplet)
+            {
+                Input::check_triplet(paths.host_triplet, paths);
+                triplet_specs.push_back(package_spec::from_name_and_triplet(spec.name(), paths.host_triplet).get_or_throw());
+                break;
+            }
+        }
+        const std::vector<Files::file_lock> triplet_locks = lock_triplets(paths, triplet_specs);
+        StatusParagraphs status_db = database_load_check(paths, triplets_of(triplet_specs));
+        install_specs(args, paths, specs, status_db, mode, dry_run, tail_logs);
+        exit(EXIT_SUCCESS);
+    }
+
+    // What --dry-run prints: the packages to build, with the time they took the last times they were built here, and the
+    // time the whole plan should take with the requested number of jobs
+    static void print_plan_estimate(const vcpkg_paths& paths, const std::vector<package_spec>& install_plan, const Graphs::Graph<package_spec>& dependency_graph, const StatusParagraphs& status_db, const size_t job_count)
+    {
+        size_t unknown_count;
+        const std::vector<long long> build_times = estimate_build_times(paths, install_plan, status_db, unknown_count);
+        const BuildDurations::duration_map recorded = BuildDurations::load(paths);
+
+        System::println("The following packages will be built and installed:");
+        for (size_t i = 0; i < install_plan.size(); ++i)
+        {
+            const package_spec& spec = install_plan[i];
+            if (status_db.find_installed(spec.name(), spec.target_triplet()) != status_db.end())
+            {
+                continue;
+            }
+
+            if (recorded.find(to_string(spec)) != recorded.end())
+                System::println("    %-40s %s", to_string(spec), BuildDurations::format_duration(build_times[i]));
+            else
+                System::println("    %-40s (no recorded build time)", to_string(spec));
+        }
+
+        if (recorded.empty())
+        {
+            System::println("No build times were recorded on this machine yet; the time the plan takes cannot be estimated.");
+            return;
+        }
+
+        const long long makespan = BuildDurations::estimate_makespan(build_times, get_plan_dependents(install_plan, dependency_graph), job_count);
+        System::println("Estimated time with %s job(s): %s", std::to_string(job_count), BuildDurations::format_duration(makespan));
+        if (unknown_count != 0)
+        {
+            System::println("%s package(s) were never built here and are counted with the average recorded build time.", std::to_string(unknown_count));
+        }
+    }
+
+    // Builds and installs what install_plan holds that is not installed yet. The ABI hashes missing from abis are computed.
+    // If locked, abis was recorded earlier, and a port whose files no longer give its recorded hash is not built.
+    static void run_install_plan(const vcpkg_paths& paths, const std::vector<package_spec>& install_plan, const Graphs::Graph<package_spec>& dependency_graph,
+                                 std::unordered_map<package_spec, std::string>& abis, const bool locked, StatusParagraphs& status_db,
+                                 const size_t job_count, const install_file_mode mode, const bool tail_logs)
+    {
+        Environment::ensure_utilities_on_path(paths);
+
+        // Keeps what the plan uses from the collections of other processes until it is done
+        const DiskBudget::pending_plan pending(paths, install_plan);
+
+        std::vector<package_spec> specs_to_build;
+        for (const package_spec& spec : install_plan)
+        {
+            if (status_db.find_installed(spec.name(), spec.target_triplet()) == status_db.end())
+            {
+                specs_to_build.push_back(spec);
+            }
+        }
+
+        // Builds farmed out carry the hashes of their installed dependencies too, which their workers restore
+        const bool farmed_out = !BuildFarm::get_farm_dir().empty();
+        for (const package_spec& spec : farmed_out ? install_plan : specs_to_build)
+        {
+            BinaryCache::compute_abi_hash(paths, spec, abis);
+        }
+
+        // With a lock, abis holds the recorded hashes; the ports to build are hashed again, as they may have changed since
+        std::unordered_map<package_spec, std::string> port_abis;
+        if (locked)
+        {
+            for (const package_spec& spec : specs_to_build)
+            {
+                BinaryCache::compute_abi_hash(paths, spec, port_abis);
+            }
+        }
+
+        const fs::path binary_cache_dir = BinaryCache::get_cache_dir(paths);
+        Checks::check_exit(!farmed_out || !binary_cache_dir.empty(), "Error: VCPKG_BUILD_FARM needs a binary cache shared with the farm (VCPKG_BINARY_CACHE)");
+        if (!binary_cache_dir.empty())
+        {
+            std::vector<std::string> abis_to_fetch;
+            for (const package_spec& spec : specs_to_build)
+            {
+                abis_to_fetch.push_back(abis.at(spec));
+            }
+            BinaryCache::prefetch(paths, binary_cache_dir, abis_to_fetch);
+        }
+
+        // Fetch all sources up front and in parallel rather than one at a time inside each port's build
+        Downloads::prefetch(paths, specs_to_build);
+
+        execute_install_plan(paths, install_plan, dependency_graph, abis, port_abis, status_db, job_count, mode, tail_logs);
+
+        const uintmax_t budget = DiskBudget::get_budget();
+        if (budget != 0)
+        {
+            // status_db only holds the triplets of the plan; the packages of the others must be protected as well
+            DiskBudget::collect(paths, database_load_check(paths), budget, false);
+        }
+    }
+
+    void install_specs(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const std::vector<package_spec>& specs, StatusParagraphs& status_db, const install_file_mode mode, const bool dry_run, const bool tail_logs)
+    {
+        const size_t job_count = get_job_count(args);
+        const Graphs::Graph<package_spec> dependency_graph = Dependencies::create_dependency_graph(paths, specs, status_db);
+        std::vector<package_spec> install_plan = dependency_graph.find_topological_sort();
+        Checks::check_exit(!install_plan.empty(), "Install plan cannot be empty");
+        std::string specs_string = to_string(install_plan[0]);
+        for (size_t i = 1; i < install_plan.size(); ++i)
+        {
+            specs_string.push_back(',');
+            specs_string.append(to_string(install_plan[i]));
+        }
+        TrackProperty("installplan", specs_string);
+
+        // ABI hashes address the binary cache and are recorded in the installed packages, which lets `upgrade` find the ones whose port changed
+        std::unordered_map<package_spec, std::string> abis;
+        if (args.write_lock_file != nullptr)
+        {
+            for (const package_spec& spec : install_plan)
+            {
+                BinaryCache::compute_abi_hash(paths, spec, abis);
+            }
+            InstallLock::write(*args.write_lock_file, install_plan, dependency_graph, abis);
+            System::println("Wrote the install plan to %s", *args.write_lock_file);
+        }
+
+        if (dry_run)
+        {
+            print_plan_estimate(paths, install_plan, dependency_graph, status_db, job_count);
+            return;
+        }
+        run_install_plan(paths, install_plan, dependency_graph, abis, false, status_db, job_count, mode, tail_logs);
+    }
+
+    // install --lock: the recorded plan is run as it is, with the recorded ABI hashes, and nothing is resolved again. A
+    // package missing from the binary cache is only built if its port has not changed since.
+    static void install_locked_plan(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const install_file_mode mode, const bool dry_run, const bool tail_logs)
+    {
+        const size_t job_count = get_job_count(args);
+        InstallLock::locked_plan locked = InstallLock::read(*args.lock_file);
+        Input::check_triplets(locked.plan, paths);
+        Trash::empty_in_background(paths);
+
+        const std::vector<Files::file_lock> triplet_locks = lock_triplets(paths, locked.plan);
+        StatusParagraphs status_db = database_load_check(paths, triplets_of(locked.plan));
+        if (dry_run)
+        {
+            print_plan_estimate(paths, locked.plan, locked.dependency_graph, status_db, job_count);
+            exit(EXIT_SUCCESS);
+        }
+
+        run_install_plan(paths, locked.plan, locked.dependency_graph, locked.abis, true, status_db, job_count, mode, tail_logs);
+        exit(EXIT_SUCCESS);
+    }
+
+    static const char* build_result_name(const build_result result)
+    {
+        switch (result)
+        {
+            case build_result::SUCCEEDED: return "SUCCEEDED";
+            case build_result::BUILD_FAILED: return "BUILD_FAILED";
+            case build_result::POST_BUILD_CHECKS_FAILED: return "POST_BUILD_CHECKS_FAILED";
+            default: Checks::unreachable();
+        }
+    }
+
+    // Every build dependency of every port must be installed already; the ports themselves are not installed, so none of
+    // them may be a dependency of another
+    static bool check_build_dependencies(const vcpkg_paths& paths, const std::vector<package_spec>& specs)
+    {
+        // The host tools of ports built for other triplets are installed for the host triplet
+        std::vector<triplet> triplets = triplets_of(specs);
+        for (const package_spec& spec : specs)
+        {
+            if (spec.target_triplet() != paths.host_triplet)
+            {
+                Input::check_triplet(paths.host_triplet, paths);
+                triplets.push_back(paths.host_triplet);
+                break;
+            }
+        }
+        const StatusParagraphs status_db = database_load_check(paths, triplets);
+
+        // Explicitly load and use the portfiles' build dependencies when resolving the build command (instead of a cached package's dependencies).
+        // The dependencies of all the ports are resolved together, so that a missing one is reported once.
+        std::vector<package_spec> first_level_deps_specs;
+        for (const package_spec& spec : specs)
+        {
+            const Dependencies::port_dependencies port = Dependencies::get_port_dependencies(paths, spec);
+            for (auto&& dep : port.build)
+            {
+                first_level_deps_specs.push_back(package_spec::from_name_and_triplet(dep, spec.target_triplet()).get_or_throw());
+            }
+            first_level_deps_specs.insert(first_level_deps_specs.end(), port.host.begin(), port.host.end());
+        }
+
+        std::unordered_set<package_spec> unmet_dependencies = Dependencies::get_unmet_dependencies(paths, first_level_deps_specs, status_db);
+        if (!unmet_dependencies.empty())
+        {
+            System::println(System::color::error, "The build command requires all dependencies to be already installed.");
+            System::println("The following dependencies are missing:");
+            System::println("");
+            for (const package_spec& p : unmet_dependencies)
+            {
+                System::println("    %s", to_string(p));
+            }
+            System::println("");
+            return false;
+        }
+
+        return true;
+    }
+
+    // Builds each of the ports without installing it, up to job_count at a time, and prints the result of each
+    static bool build_ports(const vcpkg_paths& paths, const std::vector<package_spec>& specs, const size_t job_count)
+    {
+        Environment::ensure_utilities_on_path(paths);
+        const DiskBudget::pending_plan pending(paths, specs);
+        const fs::path binary_cache_dir = BinaryCache::get_cache_dir(paths);
+
+        // Computed up front: the map is shared by the hashes of ports with common dependencies
+        std::unordered_map<package_spec, std::string> abis;
+        for (const package_spec& spec : specs)
+        {
+            BinaryCache::compute_abi_hash(paths, spec, abis);
+        }
+
+        struct spec_build
+        {
+            build_result result = build_result::BUILD_FAILED;
+            long long build_time_ms = 0;
+            System::resource_usage usage{};
+        };
+
+        // Each build runs on a thread of its own, as in an install, and mostly waits on its child processes. The output
+        // of concurrent builds is held and only printed for the ports that fail.
+        const size_t concurrent_builds = std::min(job_count, specs.size());
+        const size_t build_jobs = std::max(size_t(1), get_hardware_jobs() / concurrent_builds);
+        std::vector<spec_build> builds(specs.size());
+        std::atomic<size_t> next(0);
+        {
+            const System::async_console console;
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < concurrent_builds; ++i)
+            {
+                workers.emplace_back([&]()
+                    {
+                        for (size_t index = next++; index < specs.size(); index = next++)
+                        {
+                            const package_spec& spec = specs[index];
+                            const std::string& abi = abis.at(spec);
+                            spec_build& build = builds[index];
+                            BuildProgress::build_output output(concurrent_builds == 1 ? std::string() : Strings::format("[%s] ", to_string(spec)), concurrent_builds == 1);
+                            const Stopwatch timer = Stopwatch::createStarted();
+                            try
+                            {
+                                // A port that cannot be built fails on its own, and the others go on
+                                const Checks::failures_throw failures_throw;
+                                build.result = build_internal(spec, paths, abi, build_jobs, output, build.usage);
+                            }
+                            catch (const std::exception& e)
+                            {
+                                System::println(System::color::error, "Error: building package %s failed: %s", to_string(spec), e.what());
+                            }
+                            catch (const Parallel::task_failed&)
+                            {
+                                // The message has been printed
+                            }
+                            build.build_time_ms = timer.elapsed<std::chrono::milliseconds>().count();
+
+                            if (build.result != build_result::SUCCEEDED)
+                            {
+                                output.print_held();
+                            }
+                            else if (!binary_cache_dir.empty())
+                            {
+                                BinaryCache::store(paths, binary_cache_dir, spec, abi);
+                            }
+                            System::println(build.result == build_result::SUCCEEDED ? System::color::success : System::color::error,
+                                            "Building %s: %s", to_string(spec), build_result_name(build.result));
+                        }
+                    });
+            }
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+        }
+        BinaryCache::wait_for_background_transfers();
+
+        BuildDurations::duration_map measured;
+        BuildResources::resource_map measured_resources;
+        bool all_succeeded = true;
+        System::println("");
+        System::println("Build results:");
+        for (size_t i = 0; i < specs.size(); ++i)
+        {
+            const spec_build& build = builds[i];
+            const std::string spec_name = to_string(specs[i]);
+            System::println(build.result == build_result::SUCCEEDED ? System::color::success : System::color::error,
+                            "    %s: %s in %.1f s", spec_name, build_result_name(build.result), build.build_time_ms / 1000.0);
+            if (build.result == build_result::SUCCEEDED)
+            {
+                measured[spec_name] = build.build_time_ms;
+                if (build.usage.measured)
+                {
+                    measured_resources[spec_name] = {build.build_time_ms, build.usage.cpu_ms, build.usage.peak_memory_bytes, build.usage.read_bytes, build.usage.write_bytes,
+                                                     built_as_unity_build(paths, specs[i])};
+                }
+            }
+            else
+            {
+                all_succeeded = false;
+            }
+        }
+        BuildDurations::record(paths, measured);
+        BuildResources::record(paths, measured_resources);
+        return all_succeeded;
+    }
+
+    // Size and last write time of every file a watched build depends on: those of its port and its triplet file
+    using watched_files = std::map<fs::path, std::pair<uintmax_t, long long>>;
+
+    static watched_files stat_watched_files(const vcpkg_paths& paths, const std::vector<package_spec>& specs)
+    {
+        watched_files files;
+        auto add = [&](const fs::path& file)
+        {
+            std::error_code size_ec;
+            std::error_code time_ec;
+            const uintmax_t size = fs::file_size(file, size_ec);
+            const auto mtime = fs::last_write_time(file, time_ec);
+            files[file] = size_ec || time_ec ? std::make_pair(uintmax_t(0), -1LL) : std::make_pair(size, static_cast<long long>(mtime.time_since_epoch().count()));
+        };
+
+        for (const package_spec& spec : specs)
+        {
+            add(paths.triplets / (spec.target_triplet().canonical_name() + ".cmake"));
+            std::error_code ec;
+            for (auto it = fs::recursive_directory_iterator(paths.port_dir(spec), ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+            {
+                if (fs::is_regular_file(it->status()))
+                {
+                    add(it->path());
+                }
+            }
+        }
+        return files;
+    }
+
+    // Blocks until a file of the ports or of their triplets differs from before, and a moment has passed without further
+    // changes, as editors often write a file in several steps
+    static watched_files wait_for_changes(const vcpkg_paths& paths, const std::vector<package_spec>& specs, const watched_files& before)
+    {
+        std::set<fs::path> dirs = {paths.triplets};
+        for (const package_spec& spec : specs)
+        {
+            dirs.insert(paths.port_dir(spec));
+        }
+
+        std::vector<HANDLE> notifications;
+        for (const fs::path& dir : dirs)
+        {
+            const HANDLE notification = FindFirstChangeNotificationW(dir.wstring().c_str(), dir != paths.triplets,
+                                                                     FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+            Checks::check_exit(notification != INVALID_HANDLE_VALUE, "Error: could not watch %s for changes", dir.generic_string());
+            notifications.push_back(notification);
+        }
+
+        static const DWORD QUIET_PERIOD_MS = 300;
+        watched_files current = before;
+        bool changed = false;
+        for (;;)
+        {
+            const DWORD woken = WaitForMultipleObjects(static_cast<DWORD>(notifications.size()), notifications.data(), FALSE, changed ? QUIET_PERIOD_MS : INFINITE);
+            if (woken == WAIT_TIMEOUT)
+            {
+                break;
+            }
+            Checks::check_exit(woken < WAIT_OBJECT_0 + notifications.size(), "Error: waiting for changes failed");
+            FindNextChangeNotification(notifications[woken - WAIT_OBJECT_0]);
+
+            // Changes to other triplet files, or writes that left a file as it was, do not count
+            current = stat_watched_files(paths, specs);
+            changed = current != before;
+        }
+
+        for (const HANDLE notification : notifications)
+        {
+            FindCloseChangeNotification(notification);
+        }
+        return current;
+    }
+
+    // Builds each of the given ports without installing it, up to --jobs at a time, for validating portfiles.
+    // With --watch, the process stays alive and builds the ports again whenever their port directories or triplet files
+    // change. Watched builds are incremental and keep their build trees, and the sources come from the extraction cache,
+    // so a rebuild only configures again what the change affects and only compiles what is out of date.
+    void build_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet)
+    {
+        static const std::string example = create_example_string("build zlib:x64-windows libpng:x64-windows");
+        args.check_min_arg_count(1, example.c_str());
+        const std::unordered_set<std::string> options = args.check_and_get_optional_command_arguments({OPTION_INCREMENTAL, OPTION_WATCH});
+        const bool watch = options.find(OPTION_WATCH) != options.end();
+        if (watch || options.find(OPTION_INCREMENTAL) != options.end())
+        {
+            enable_incremental_builds();
+        }
+        if (watch)
+        {
+            // The next build of the port needs its trees
+            _wputenv_s(L"VCPKG_CLEAN_BUILDTREES", L"");
+        }
+
+        std::vector<package_spec> specs;
+        std::unordered_set<package_spec> requested;
+        for (const std::string& arg : args.command_arguments)
+        {
+            const package_spec spec = Input::check_and_get_package_spec(arg, default_target_triplet, example.c_str());
+            Input::check_triplet(spec.target_triplet(), paths);
+            if (requested.insert(spec).second)
+            {
+                specs.push_back(spec);
+            }
+        }
+
+        Trash::empty_in_background(paths);
+        const size_t job_count = get_job_count(args);
+        if (!watch)
+        {
+            if (!check_build_dependencies(paths, specs))
+            {
+                exit(EXIT_FAILURE);
+            }
+            exit(build_ports(paths, specs, job_count) ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        watched_files files = stat_watched_files(paths, specs);
+        for (;;)
+        {
+            // A broken CONTROL file or portfile is reported like a failed build, and waits for the next change
+            try
+            {
+                const Checks::failures_throw failures_throw;
+                if (check_build_dependencies(paths, specs))
+                {
+                    build_ports(paths, specs, job_count);
+                }
+            }
+            catch (const std::exception& e)
+            {
+                System::println(System::color::error, "Error: %s", e.what());
+            }
+            catch (const Parallel::task_failed&)
+            {
+                // The message has been printed
+            }
+
+            System::println("");
+            System::println("Watching the ports and their triplet files for changes. Press Ctrl+C to stop.");
+            files = wait_for_changes(paths, specs, files);
+            System::println("");
+        }
+    }
+
+    // Runs the builds queued on %VCPKG_BUILD_FARM% one at a time, each in a child process, until stopped
+    void farm_worker_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        args.check_exact_arg_count(0);
+        const fs::path farm_dir = BuildFarm::get_farm_dir();
+        Checks::check_exit(!farm_dir.empty(), "Error: VCPKG_BUILD_FARM does not name the directory of the build farm");
+        Checks::check_exit(!BinaryCache::get_cache_dir(paths).empty(), "Error: a farm worker needs the binary cache the farm shares (VCPKG_BINARY_CACHE)");
+
+        const std::wstring jobs_option = args.jobs != nullptr ? Strings::wformat(L" --jobs %s", Strings::utf8_to_utf16(*args.jobs)) : std::wstring();
+        System::println("Waiting for builds queued on %s", farm_dir.generic_string());
+        for (;;)
+        {
+            const fs::path build_dir = BuildFarm::claim(farm_dir);
+            if (build_dir.empty())
+            {
+                std::this_thread::sleep_for(std::chrono::seconds(2));
+                continue;
+            }
+
+            System::println("Building %s", build_dir.filename().generic_string());
+            int exit_code;
+            {
+                const BuildFarm::heartbeat alive(build_dir);
+                std::ofstream log(build_dir / "log", std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+                const std::wstring command = Strings::wformat(LR"("%s" --vcpkg-root "%s"%s internal_farm_build "%s")",
+                                                              System::get_exe_path_of_current_process().generic_wstring(),
+                                                              paths.root.generic_wstring(),
+                                                              jobs_option,
+                                                              build_dir.generic_wstring());
+                exit_code = System::process_execute(command, [&](const std::string& line) { log << line << '\n'; });
+            }
+            BuildFarm::finish(farm_dir, build_dir, exit_code == 0);
+            System::println(exit_code == 0 ? System::color::success : System::color::error, "%s %s", exit_code == 0 ? "Built" : "Failed to build",
+                            build_dir.filename().generic_string());
+        }
+    }
+
+    // Builds a claimed build of the farm: its dependencies come from the binary cache and its package goes there
+    void internal_farm_build_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        args.check_exact_arg_count(1);
+        const fs::path build_dir = args.command_arguments[0];
+        InstallLock::locked_plan locked = InstallLock::read(BuildFarm::plan_file(build_dir));
+
+        // The plan is built here rather than farmed out again
+        _wputenv_s(L"VCPKG_BUILD_FARM", L"");
+
+        // The ports come with the build, as the machine that queued it has them
+        vcpkg_paths build_paths = paths;
+        build_paths.ports = build_dir / "ports";
+        Input::check_triplets(locked.plan, build_paths);
+
+        const std::vector<Files::file_lock> triplet_locks = lock_triplets(build_paths, locked.plan);
+        StatusParagraphs status_db = database_load_check(build_paths, triplets_of(locked.plan));
+
+        // Packages of the plan installed here from other ports make way for the ones the plan was hashed with, along with
+        // what depends on them
+        std::vector<package_spec> to_remove;
+        std::unordered_set<package_spec> removed;
+        for (const package_spec& spec : locked.plan)
+        {
+            const auto installed = status_db.find_installed(spec.name(), spec.target_triplet());
+            if (installed != status_db.end() && (*installed)->package.abi != locked.abis.at(spec) && removed.insert(spec).second)
+            {
+                to_remove.push_back(spec);
+            }
+        }
+        for (size_t i = 0; i < to_remove.size(); ++i)
+        {
+            for (const StatusParagraph* dependent : status_db.find_dependents(to_remove[i].name(), to_remove[i].target_triplet()))
+            {
+                if (removed.insert(dependent->package.spec).second)
+                {
+                    to_remove.push_back(dependent->package.spec);
+                }
+            }
+        }
+        if (!to_remove.empty())
+        {
+            deinstall_packages(build_paths, to_remove, status_db);
+        }
+
+        run_install_plan(build_paths, locked.plan, locked.dependency_graph, locked.abis, true, status_db, get_job_count(args), install_file_mode::copy, false);
+
+        // Builds store their packages themselves; a package that was installed here already may not be in the cache yet
+        const package_spec& target = locked.plan.back();
+        if (fs::exists(build_paths.package_dir(target)))
+        {
+            BinaryCache::store(build_paths, BinaryCache::get_cache_dir(build_paths), target, locked.abis.at(target));
+        }
+        BinaryCache::wait_for_background_transfers();
+        exit(EXIT_SUCCESS);
+    }
+
+    void build_external_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet)
+    {
+        static const std::string example = create_example_string(R"(build_external zlib2 C:\path\to\dir\with\controlfile\)");
+        args.check_exact_arg_count(2, example.c_str());
+
+        expected<package_spec> current_spec = package_spec::from_string(args.command_arguments[0], default_target_triplet);
+        if (auto spec = current_spec.get())
+        {
+            Input::check_triplet(spec->target_triplet(), paths);
+            Environment::ensure_utilities_on_path(paths);
+            const fs::path port_dir = args.command_arguments.at(1);
+            BuildProgress::build_output output(std::string(), true);
+            System::resource_usage usage;
+            if (build_internal(*spec, paths, port_dir, std::string(), get_hardware_jobs(), output, usage) != build_result::SUCCEEDED)
+            {
+                exit(EXIT_FAILURE);
+            }
             exit(EXIT_SUCCESS);
         }
 
@@ -9,6 +9,8 @@
 #include "vcpkg_Checks.h"
 #include "vcpkg_System.h"
 #include "vcpkg_Files.h"
+#include "vcpkg.h"
+#include "MSBuildProps.h"
 
 namespace vcpkg
 {
@@ -218,11 +220,17 @@ namespace vcpkg
             System::println(System::color::error, "Error: Failed to copy file: %s -> %s", appdata_src_path.string(), appdata_dst_path.string());
             exit(EXIT_FAILURE);
         }
+        MSBuildProps::write_all(paths, database_load_check(paths));
+
         System::println(System::color::success, "Applied user-wide integration for this vcpkg root.");
         System::println("\n"
             "All C++ projects can now #include any installed libraries.\n"
             "Linking will be handled automatically.\n"
-            "Installing new libraries will make them instantly available.");
+            "Installing new libraries will make them instantly available.\n"
+            "\n"
+            "To link only the libraries a project uses and those they depend on, import the property file of each\n"
+            "package it uses in the project:\n"
+            "    <Import Project=\"$(VcpkgPackageProps)zlib.props\" />");
 
         exit(EXIT_SUCCESS);
     }
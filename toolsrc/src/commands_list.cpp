@@ -2,6 +2,7 @@
 #include "vcpkg.h"
 #include "vcpkg_System.h"
 #include "vcpkglib_helpers.h"
+#include "vcpkg_Server.h"
 
 namespace vcpkg
 {
@@ -13,55 +14,60 @@ namespace vcpkg
                         details::shorten_description(pgh.package.description));
     }
 
-    void list_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    void print_installed_packages(const status_snapshot& status_db, const std::vector<std::string>& command_arguments)
     {
-        static const std::string example = Strings::format(
-            "The argument should be a substring to search for, or no argument to display all installed libraries.\n%s", create_example_string("list png"));
-        args.check_max_arg_count(1, example.c_str());
-
-        const StatusParagraphs status_paragraphs = database_load_check(paths);
-        std::vector<StatusParagraph> installed_packages;
-        for (auto&& pgh : status_paragraphs)
+        // Only the paragraphs that are printed get decoded
+        std::vector<size_t> installed_packages;
+        for (size_t i = 0; i < status_db.size(); ++i)
         {
-            if (pgh->state == install_state_t::not_installed && pgh->want == want_t::purge)
+            if (status_db[i].state == install_state_t::not_installed && status_db[i].want == want_t::purge)
                 continue;
-            installed_packages.push_back(*pgh);
+            installed_packages.push_back(i);
         }
 
         if (installed_packages.empty())
         {
             System::println("No packages are installed. Did you mean `search`?");
-            exit(EXIT_SUCCESS);
+            return;
         }
 
         std::sort(installed_packages.begin(), installed_packages.end(),
-                  [ ]( const StatusParagraph& lhs, const StatusParagraph& rhs ) -> bool
+                  [&]( const size_t lhs, const size_t rhs ) -> bool
                   {
-                      return lhs.package.displayname() < rhs.package.displayname();
+                      return status_db[lhs].displayname < status_db[rhs].displayname;
                   });
 
-        if (args.command_arguments.size() == 0)
+        if (command_arguments.size() == 0)
         {
-            for (const StatusParagraph& status_paragraph : installed_packages)
+            for (const size_t i : installed_packages)
             {
-                do_print(status_paragraph);
+                do_print(status_db.paragraph(i));
             }
         }
         else
         {
             // At this point there is 1 argument
-            for (const StatusParagraph& status_paragraph : installed_packages)
+            const Strings::case_insensitive_ascii_searcher searcher(command_arguments[0]);
+            for (const size_t i : installed_packages)
             {
-                const std::string displayname = status_paragraph.package.displayname();
-                if (Strings::case_insensitive_ascii_find(displayname, args.command_arguments[0]) == displayname.end())
+                if (!searcher.is_found_in(status_db[i].displayname))
                 {
                     continue;
                 }
 
-                do_print(status_paragraph);
+                do_print(status_db.paragraph(i));
             }
         }
+    }
+
+    void list_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        static const std::string example = Strings::format(
+            "The argument should be a substring to search for, or no argument to display all installed libraries.\n%s", create_example_string("list png"));
+        args.check_max_arg_count(1, example.c_str());
+        Server::forward_if_running(paths, args.command, args.command_arguments);
 
+        print_installed_packages(load_status_snapshot(paths), args.command_arguments);
         exit(EXIT_SUCCESS);
     }
 }
@@ -7,13 +7,35 @@ namespace vcpkg
     {
         System::println(
             "Commands:\n"
-            "  vcpkg search [pat]              Search for packages available to be built\n"
+            "  vcpkg search [term...]          Search the names, descriptions and maintainers of the packages\n"
+            "                                  available to be built, best match first\n"
             "  vcpkg install <pkg>             Install a package\n"
+            "  vcpkg install --link <pkg>      Install a package, hard linking its files instead of copying\n"
+            "  vcpkg install --dry-run <pkg>   List the packages that would be built, with an estimate\n"
+            "                                  of how long the build takes\n"
+            "  vcpkg install --tail-logs <pkg> Install a package, printing the logs of its build steps\n"
+            "                                  as they are written\n"
+            "  vcpkg install --incremental <pkg>\n"
+            "                                  Install a package, reusing the build trees of the ports\n"
+            "                                  whose configuration only changed in their options\n"
+            "  vcpkg build --watch <pkg>       Build a package without installing it, and build it again\n"
+            "                                  whenever its port or triplet file changes\n"
+            "  vcpkg install --write-lock <file> <pkg>\n"
+            "                                  Install a package, recording the install plan with the\n"
+            "                                  ABI hash of each package in file\n"
+            "  vcpkg install --lock <file>     Install the plan recorded in file, without resolving\n"
+            "                                  dependencies again\n"
             "  vcpkg remove <pkg>              Uninstall a package. \n"
             "  vcpkg remove --purge <pkg>      Uninstall and delete a package. \n"
             "  vcpkg list                      List installed packages\n"
+            "  vcpkg export <pkg>...           Pack installed packages and their dependencies into a zip\n"
+            "                                  that installs them when extracted into a vcpkg root\n"
+            "  vcpkg verify [pkg...]           Check that the files of installed packages were not modified\n"
+            "                                  or deleted since they were installed\n"
             "  vcpkg update                    Display list of packages for updating\n"
+            "  vcpkg upgrade                   Rebuild the packages whose ports changed, and their dependents\n"
             "  vcpkg hash <file> [alg]         Hash a file by specific algorithm, default SHA512\n"
+            "  vcpkg hash <file>...            Hash several files in parallel with SHA512\n"
             "\n"
             "%s" // Integration help
             "\n"
@@ -22,7 +44,20 @@ namespace vcpkg
             "  vcpkg create <pkg> <url>\n"
             "             [archivename]        Create a new package\n"
             "  vcpkg owns <pat>                Search for files in installed packages\n"
+            "  vcpkg owns --suffix <pat>       Search for installed files whose path ends with pat\n"
+            "  vcpkg owns --exact <path>       Find the package that installed path (e.g. x86-windows/bin/zlib1.dll)\n"
             "  vcpkg cache                     List cached compiled packages\n"
+            "  vcpkg stats [pat]               Show the CPU time, peak memory and I/O of the last build\n"
+            "                                  of each package, and what a unity build gained\n"
+            "  vcpkg gc [size] [--dry-run]     Remove the least recently used downloads, build trees and packages until\n"
+            "                                  they fit in size (default: %%VCPKG_DISK_BUDGET%%), and the stored PDBs\n"
+            "                                  no installed package uses\n"
+            "  vcpkg farm-worker               Build the ports queued on %%VCPKG_BUILD_FARM%% by installs on other machines\n"
+            "  vcpkg server                    Keep the databases loaded and answer list, search, owns and cache\n"
+            "                                  from memory\n"
+            "  vcpkg batch [file]              Answer the list, search, owns and cache queries of file, or of\n"
+            "                                  stdin, one per line, loading the databases once\n"
+            "  vcpkg applocal <exe> <bindir>   Copy the DLLs that exe depends on from an installed bin directory next to it\n"
             "  vcpkg version                   Display version information\n"
             "  vcpkg contact                   Display contact information to send feedback\n"
             "\n"
@@ -37,6 +72,20 @@ namespace vcpkg
             "  --vcpkg-root <path>             Specify the vcpkg root directory\n"
             "                                  (default: %%VCPKG_ROOT%%)\n"
             "\n"
+            "  --scratch-root <path>           Build in <path>/buildtrees and <path>/packages instead of\n"
+            "                                  under the vcpkg root, e.g. on a faster local disk\n"
+            "                                  (default: %%VCPKG_SCRATCH_ROOT%%)\n"
+            "\n"
+            "  --jobs <n>                      Build up to n independent packages at the same time\n"
+            "                                  during install (default: 1)\n"
+            "\n"
+            "  --trace-file <path>             Write a Chrome trace (chrome://tracing) of the phases\n"
+            "                                  of the command, including each port's build steps\n"
+            "\n"
+            "  --timings                       Print the time spent loading the status database, parsing,\n"
+            "                                  resolving dependencies, running processes, installing files\n"
+            "                                  and checking packages when the command exits\n"
+            "\n"
             "For more help (including examples) see the accompanying README.md."
             , INTEGRATE_COMMAND_HELPSTRING);
     }
@@ -65,6 +114,8 @@ namespace vcpkg
         static std::vector<package_name_and_function<command_type_a>> t = {
             {"install", install_command},
             {"remove", remove_command},
+            {"export", export_command},
+            {"verify", verify_command},
             {"build", build_command},
             {"build_external", build_external_command}
         };
@@ -80,11 +131,21 @@ namespace vcpkg
             {"integrate", integrate_command},
             {"owns", owns_command},
             {"update", update_command},
+            {"upgrade", upgrade_command},
+            {"server", server_command},
+            {"batch", batch_command},
             {"edit", edit_command},
             {"create", create_command},
             {"import", import_command},
             {"cache", cache_command},
+            {"stats", stats_command},
+            {"gc", gc_command},
+            {"farm-worker", farm_worker_command},
             {"internal_test", internal_test_command},
+            {"internal_extract", internal_extract_command},
+            {"internal_patch_cache", internal_patch_cache_command},
+            {"internal_copy_pdbs", internal_copy_pdbs_command},
+            {"internal_farm_build", internal_farm_build_command},
             {"portsdiff", portsdiff_command}
         };
         return t;
@@ -96,6 +157,8 @@ namespace vcpkg
             {"version", &version_command},
             {"contact", &contact_command},
             {"hash", &hash_command},
+            {"applocal", &applocal_command},
+            {"internal_run_parallel", &internal_run_parallel_command},
         };
         return t;
     }
@@ -1,32 +1,39 @@
 #include "vcpkg_Commands.h"
 #include "vcpkg_System.h"
 #include "vcpkg.h"
-#include <fstream>
+#include "FilesIndex.h"
+#include "vcpkg_Server.h"
+#include <algorithm>
 
 namespace vcpkg
 {
-    static void search_file(const vcpkg_paths& paths, const std::string& file_substr, const StatusParagraphs& status_db)
-    {
-        std::string line;
+    static const std::string OPTION_EXACT = "--exact";
+    static const std::string OPTION_SUFFIX = "--suffix";
 
-        for (auto&& pgh : status_db)
+    void print_owned_files(const FilesIndex::files_index& index, const std::string& pattern, const std::unordered_set<std::string>& options)
+    {
+        std::vector<FilesIndex::owned_file> found;
+        if (options.find(OPTION_EXACT) != options.end())
         {
-            if (pgh->state != install_state_t::installed)
-                continue;
+            found = index.find_exact(pattern);
+        }
+        else if (options.find(OPTION_SUFFIX) != options.end())
+        {
+            found = index.find_suffix(pattern);
+        }
+        else
+        {
+            found = index.find_substring(pattern);
+        }
 
-            std::fstream listfile(paths.listfile_path(pgh->package));
-            while (std::getline(listfile, line))
-            {
-                if (line.empty())
-                {
-                    continue;
-                }
+        std::sort(found.begin(), found.end(), [](const FilesIndex::owned_file& left, const FilesIndex::owned_file& right)
+                  {
+                      return left.package != right.package ? left.package < right.package : left.path < right.path;
+                  });
 
-                if (line.find(file_substr) != std::string::npos)
-                {
-                    System::println("%s: %s", pgh->package.displayname(), line);
-                }
-            }
+        for (const FilesIndex::owned_file& file : found)
+        {
+            System::println("%s: %s", file.package, file.path);
         }
     }
 
@@ -34,9 +41,14 @@ namespace vcpkg
     {
         static const std::string example = Strings::format("The argument should be a pattern to search for. %s", create_example_string("owns zlib.dll"));
         args.check_exact_arg_count(1, example.c_str());
+        const std::unordered_set<std::string> options = args.check_and_get_optional_command_arguments({OPTION_EXACT, OPTION_SUFFIX});
+
+        std::vector<std::string> forwarded_arguments = args.command_arguments;
+        forwarded_arguments.insert(forwarded_arguments.end(), options.cbegin(), options.cend());
+        Server::forward_if_running(paths, args.command, forwarded_arguments);
 
-        StatusParagraphs status_db = database_load_check(paths);
-        search_file(paths, args.command_arguments[0], status_db);
+        const status_snapshot status_db = load_status_snapshot(paths);
+        print_owned_files(FilesIndex::files_index::load(paths, status_db), args.command_arguments[0], options);
         exit(EXIT_SUCCESS);
     }
 }
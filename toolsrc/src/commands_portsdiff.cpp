@@ -6,8 +6,10 @@
 #include <iostream>
 #include <iomanip>
 #include <set>
-#include "Paragraphs.h"
+#include <fstream>
 #include "SourceParagraph.h"
+#include "Paragraphs.h"
+#include <Windows.h>
 
 namespace vcpkg
 {
@@ -43,48 +45,109 @@ namespace vcpkg
         }
     }
 
-    static std::map<std::string, std::string> read_all_ports(const fs::path& ports_folder_path)
+    struct changed_ports
+    {
+        std::map<std::string, std::string> previous_names_and_versions;
+        std::map<std::string, std::string> current_names_and_versions;
+    };
+
+    static std::string run_git(const vcpkg_paths& paths, const std::wstring& git_arguments)
+    {
+        // Run from the root, so that pathspecs and the paths git prints are relative to it
+        const std::wstring cmd = Strings::wformat(LR"(cmd.exe /c "git --git-dir="%s" %s")", (paths.root / ".git").wstring(), git_arguments);
+        const System::exit_code_and_output result = System::process_execute_and_capture_output(cmd, paths.root);
+        Checks::check_exit(result.exit_code == 0, "Error: git %s failed\n%s", Strings::utf16_to_utf8(git_arguments), result.output);
+        return result.output;
+    }
+
+    // The CONTROL files under the ports directory that differ between the two commits, as paths from the root
+    static std::vector<std::string> find_changed_control_files(const vcpkg_paths& paths, const std::wstring& previous_commit_id, const std::wstring& current_commit_id)
     {
-        std::map<std::string, std::string> names_and_versions;
+        const std::wstring ports_dir_name = paths.ports.filename().wstring();
+        const std::string names = run_git(paths, Strings::wformat(L"diff --name-only --no-renames -z %s %s -- %s", previous_commit_id, current_commit_id, ports_dir_name));
+
+        static const std::string CONTROL_SUFFIX = "/CONTROL";
+        std::vector<std::string> control_files;
+        size_t pos = 0;
+        while (pos < names.size())
+        {
+            size_t end = names.find('\0', pos);
+            if (end == std::string::npos)
+                end = names.size();
+            const std::string name = names.substr(pos, end - pos);
+            pos = end + 1;
+
+            if (name.size() > CONTROL_SUFFIX.size() && name.compare(name.size() - CONTROL_SUFFIX.size(), CONTROL_SUFFIX.size(), CONTROL_SUFFIX) == 0)
+                control_files.push_back(name);
+        }
+        return control_files;
+    }
+
+    // Reads "<commit>:<path>" for every commit and control file from the object store with a single git process. Files
+    // that do not exist in a commit, because the port was added or removed, are left out of its map.
+    static changed_ports read_changed_ports(const vcpkg_paths& paths, const std::wstring& previous_commit_id, const std::wstring& current_commit_id)
+    {
+        const std::vector<std::string> control_files = find_changed_control_files(paths, previous_commit_id, current_commit_id);
+        changed_ports ports;
+        if (control_files.empty())
+        {
+            return ports;
+        }
 
-        for (auto it = fs::directory_iterator(ports_folder_path); it != fs::directory_iterator(); ++it)
+        const std::string commit_ids[] = {Strings::utf16_to_utf8(previous_commit_id), Strings::utf16_to_utf8(current_commit_id)};
+        std::string requests;
+        for (const std::string& commit_id : commit_ids)
         {
-            const fs::path& path = it->path();
+            for (const std::string& control_file : control_files)
+            {
+                requests.append(commit_id).append(":").append(control_file).append("\n");
+            }
+        }
+
+        const fs::path requests_file = paths.buildtrees / Strings::format("portsdiff.%d.tmp", static_cast<int>(GetCurrentProcessId()));
+        std::error_code ec;
+        fs::create_directories(requests_file.parent_path(), ec);
+        std::ofstream(requests_file, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc) << requests;
+        const std::string batch = run_git(paths, Strings::wformat(LR"(cat-file --batch < "%s" 2>NUL)", requests_file.wstring()));
+        fs::remove(requests_file, ec);
 
+        // Each answer is "<sha> blob <size>\n<contents>\n", or "<request> missing\n", in the order of the requests
+        size_t pos = 0;
+        for (size_t i = 0; i < 2 * control_files.size(); ++i)
+        {
+            const size_t header_end = batch.find('\n', pos);
+            Checks::check_exit(header_end != std::string::npos, "Error: unexpected end of the output of git cat-file");
+            const std::string header = batch.substr(pos, header_end - pos);
+            pos = header_end + 1;
+
+            const size_t blob = header.find(" blob ");
+            if (blob == std::string::npos)
+            {
+                continue;
+            }
+
+            const size_t size = std::stoull(header.substr(blob + 6));
+            Checks::check_exit(pos + size <= batch.size(), "Error: unexpected end of the output of git cat-file");
+            const std::string contents = batch.substr(pos, size);
+            pos += size + 1;
+
+            std::map<std::string, std::string>& names_and_versions = i < control_files.size() ? ports.previous_names_and_versions : ports.current_names_and_versions;
             try
             {
-                auto pghs = Paragraphs::get_paragraphs(path / "CONTROL");
+                const std::vector<std::unordered_map<std::string, std::string>> pghs = Paragraphs::parse_paragraphs(contents);
                 if (pghs.empty())
                     continue;
-                auto srcpgh = SourceParagraph(pghs[0]);
+
+                const SourceParagraph srcpgh(pghs[0]);
                 names_and_versions.emplace(srcpgh.name, srcpgh.version);
             }
             catch (std::runtime_error const&)
             {
+                // Not a valid port in that commit, as when reading the ports directory
             }
         }
 
-        return names_and_versions;
-    }
-
-    static std::map<std::string, std::string> read_ports_from_commit(const vcpkg_paths& paths, const std::wstring& git_commit_id)
-    {
-        const fs::path dot_git_dir = paths.root / ".git";
-        const std::wstring ports_dir_name_as_string = paths.ports.filename().native();
-        const fs::path temp_checkout_path = paths.root / Strings::wformat(L"%s-%s", ports_dir_name_as_string, git_commit_id);
-        fs::create_directory(temp_checkout_path);
-        const std::wstring checkout_this_dir = Strings::wformat(LR"(.\%s)", ports_dir_name_as_string); // Must be relative to the root of the repository
-
-        const std::wstring cmd = Strings::wformat(LR"(git --git-dir="%s" --work-tree="%s" checkout %s -f -q -- %s %s & git reset >NUL)",
-                                                  dot_git_dir.native(),
-                                                  temp_checkout_path.native(),
-                                                  git_commit_id,
-                                                  checkout_this_dir,
-                                                  L".vcpkg-root");
-        System::cmd_execute(cmd);
-        std::map<std::string, std::string> names_and_versions = read_all_ports(temp_checkout_path / ports_dir_name_as_string);
-        fs::remove_all(temp_checkout_path);
-        return names_and_versions;
+        return ports;
     }
 
     void portsdiff_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
@@ -95,8 +158,10 @@ namespace vcpkg
         const std::wstring git_commit_id_for_previous_snapshot = Strings::utf8_to_utf16(args.command_arguments.at(0));
         const std::wstring git_commit_id_for_current_snapshot = args.command_arguments.size() < 2 ? L"HEAD" : Strings::utf8_to_utf16(args.command_arguments.at(1));
 
-        const std::map<std::string, std::string> current_names_and_versions = read_ports_from_commit(paths, git_commit_id_for_current_snapshot);
-        const std::map<std::string, std::string> previous_names_and_versions = read_ports_from_commit(paths, git_commit_id_for_previous_snapshot);
+        // Ports whose CONTROL file is the same in both commits cannot have been added, removed or updated
+        const changed_ports changed = read_changed_ports(paths, git_commit_id_for_previous_snapshot, git_commit_id_for_current_snapshot);
+        const std::map<std::string, std::string>& current_names_and_versions = changed.current_names_and_versions;
+        const std::map<std::string, std::string>& previous_names_and_versions = changed.previous_names_and_versions;
 
         // Already sorted, so set_difference can work on std::vector too
         std::vector<std::string> current_ports = Maps::extract_keys(current_names_and_versions);
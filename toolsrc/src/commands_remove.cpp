@@ -2,15 +2,20 @@
 #include "vcpkg.h"
 #include "vcpkg_System.h"
 #include "vcpkg_Input.h"
+#include "PackageArchive.h"
+#include "Trash.h"
 
 namespace vcpkg
 {
     static const std::string OPTION_PURGE = "--purge";
 
-    static void delete_directory(const fs::path& directory)
+    static void delete_directory(const vcpkg_paths& paths, const fs::path& directory)
     {
         std::error_code ec;
-        fs::remove_all(directory, ec);
+        if (!Trash::move_to_trash(paths, directory))
+        {
+            fs::remove_all(directory, ec);
+        }
         if (!ec)
         {
             System::println(System::color::success, "Cleaned up %s", directory.string());
@@ -27,20 +32,25 @@ namespace vcpkg
         args.check_min_arg_count(1, example.c_str());
 
         const std::unordered_set<std::string> options = args.check_and_get_optional_command_arguments({OPTION_PURGE});
-        auto status_db = database_load_check(paths);
 
         std::vector<package_spec> specs = Input::check_and_get_package_specs(args.command_arguments, default_target_triplet, example.c_str());
         Input::check_triplets(specs, paths);
+
+        const std::vector<Files::file_lock> triplet_locks = lock_triplets(paths, specs);
+        auto status_db = database_load_check(paths);
+        Trash::empty_in_background(paths);
         bool alsoRemoveFolderFromPackages = options.find(OPTION_PURGE) != options.end();
 
-        for (const package_spec& spec : specs)
-        {
-            deinstall_package(paths, spec, status_db);
+        deinstall_packages(paths, specs, status_db);
 
-            if (alsoRemoveFolderFromPackages)
+        if (alsoRemoveFolderFromPackages)
+        {
+            for (const package_spec& spec : specs)
             {
                 const fs::path spec_package_dir = paths.packages / spec.dir();
-                delete_directory(spec_package_dir);
+                delete_directory(paths, spec_package_dir);
+                std::error_code ec;
+                fs::remove(PackageArchive::archive_path(paths, spec), ec);
             }
         }
         exit(EXIT_SUCCESS);
@@ -0,0 +1,183 @@
+#include "vcpkg_Commands.h"
+#include "vcpkg_System.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_JobTokens.h"
+#include <algorithm>
+#include <cwchar>
+#include <thread>
+#include <Windows.h>
+
+namespace fs = std::tr2::sys;
+
+namespace vcpkg
+{
+    namespace
+    {
+        // Replaced in the arguments by the number of job tokens the process got
+        static const std::wstring JOBS_PLACEHOLDER = L"@VCPKG_JOBS@";
+
+        // Written by the build helpers of scripts/cmake, one line each: the stdout log, the stderr log, the working
+        // directory, the number of jobs the process could use, then the program and its arguments
+        struct logged_process
+        {
+            fs::path out_log;
+            fs::path err_log;
+            fs::path working_directory;
+            size_t wanted_jobs;
+            std::vector<std::wstring> command;
+        };
+
+        logged_process load_process_file(const fs::path& process_file)
+        {
+            const std::string contents = Files::get_contents(process_file).get_or_throw();
+            std::vector<std::wstring> lines;
+            size_t pos = 0;
+            while (pos < contents.size())
+            {
+                size_t end = contents.find('\n', pos);
+                if (end == std::string::npos)
+                    end = contents.size();
+                std::string line = contents.substr(pos, end - pos);
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                lines.push_back(Strings::utf8_to_utf16(line));
+                pos = end + 1;
+            }
+
+            Checks::check_exit(lines.size() >= 5, "Error: %s does not describe a process", process_file.generic_string());
+            logged_process process;
+            process.out_log = lines[0];
+            process.err_log = lines[1];
+            process.working_directory = lines[2];
+            process.wanted_jobs = std::max<size_t>(1, std::wcstoul(lines[3].c_str(), nullptr, 10));
+            process.command.assign(lines.begin() + 4, lines.end());
+            return process;
+        }
+
+        // Quotes an argument so that CommandLineToArgvW and the CRT give it back unchanged
+        std::wstring quote_argument(const std::wstring& argument)
+        {
+            if (!argument.empty() && argument.find_first_of(L" \t\n\v\"") == std::wstring::npos)
+            {
+                return argument;
+            }
+
+            std::wstring quoted = L"\"";
+            for (auto it = argument.cbegin();; ++it)
+            {
+                size_t backslashes = 0;
+                for (; it != argument.cend() && *it == L'\\'; ++it)
+                {
+                    ++backslashes;
+                }
+
+                if (it == argument.cend())
+                {
+                    quoted.append(backslashes * 2, L'\\');
+                    break;
+                }
+
+                quoted.append(*it == L'"' ? backslashes * 2 + 1 : backslashes, L'\\');
+                quoted.push_back(*it);
+            }
+            quoted.push_back(L'"');
+            return quoted;
+        }
+
+        HANDLE create_log(const fs::path& log)
+        {
+            SECURITY_ATTRIBUTES inheritable = {sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+            return CreateFileW(log.wstring().c_str(), GENERIC_WRITE, FILE_SHARE_READ, &inheritable, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        }
+
+        // Like execute_process(OUTPUT_FILE ERROR_FILE), without going through cmd. Holds its job tokens until the process exits.
+        DWORD run_logged(const logged_process& process)
+        {
+            const JobTokens::token_set tokens = JobTokens::token_set::acquire(process.wanted_jobs);
+            const std::wstring jobs = std::to_wstring(tokens.count());
+
+            std::wstring command_line;
+            for (std::wstring argument : process.command)
+            {
+                for (size_t pos = argument.find(JOBS_PLACEHOLDER); pos != std::wstring::npos; pos = argument.find(JOBS_PLACEHOLDER, pos + jobs.size()))
+                {
+                    argument.replace(pos, JOBS_PLACEHOLDER.size(), jobs);
+                }
+
+                if (!command_line.empty())
+                    command_line.push_back(L' ');
+                command_line += quote_argument(argument);
+            }
+
+            const HANDLE out = create_log(process.out_log);
+            const HANDLE err = create_log(process.err_log);
+            if (out == INVALID_HANDLE_VALUE || err == INVALID_HANDLE_VALUE)
+            {
+                if (out != INVALID_HANDLE_VALUE)
+                    CloseHandle(out);
+                if (err != INVALID_HANDLE_VALUE)
+                    CloseHandle(err);
+                System::println(System::color::error, "Error: could not create %s", process.out_log.generic_string());
+                return EXIT_FAILURE;
+            }
+
+            STARTUPINFOW startup_info = {};
+            startup_info.cb = sizeof(startup_info);
+            startup_info.dwFlags = STARTF_USESTDHANDLES;
+            startup_info.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+            startup_info.hStdOutput = out;
+            startup_info.hStdError = err;
+
+            const std::wstring working_directory = process.working_directory.wstring();
+            PROCESS_INFORMATION process_info = {};
+            const BOOL started = CreateProcessW(nullptr, &command_line[0], nullptr, nullptr, TRUE, 0, nullptr,
+                                                working_directory.empty() ? nullptr : working_directory.c_str(), &startup_info, &process_info);
+            CloseHandle(out);
+            CloseHandle(err);
+            if (!started)
+            {
+                System::println(System::color::error, "Error: could not start %s", Strings::utf16_to_utf8(command_line));
+                return EXIT_FAILURE;
+            }
+
+            DWORD exit_code = EXIT_FAILURE;
+            WaitForSingleObject(process_info.hProcess, INFINITE);
+            GetExitCodeProcess(process_info.hProcess, &exit_code);
+            CloseHandle(process_info.hThread);
+            CloseHandle(process_info.hProcess);
+            return exit_code;
+        }
+    }
+
+    // Internal: runs the processes described by the given files at the same time, and prints the exit code of each
+    // one per line, in order, once all of them have exited. Builds started by vcpkg run all their processes this way,
+    // so that they take their jobs from the shared token pool, and so that the debug and release configurations of
+    // a port can be built concurrently, which CMake cannot do.
+    void internal_run_parallel_command(const vcpkg_cmd_arguments& args)
+    {
+        args.check_min_arg_count(1);
+
+        std::vector<logged_process> processes;
+        for (const std::string& process_file : args.command_arguments)
+        {
+            processes.push_back(load_process_file(process_file));
+        }
+
+        std::vector<DWORD> exit_codes(processes.size(), EXIT_FAILURE);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < processes.size(); ++i)
+        {
+            threads.emplace_back([&, i]() { exit_codes[i] = run_logged(processes[i]); });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (const DWORD exit_code : exit_codes)
+        {
+            System::println("%s", std::to_string(exit_code));
+        }
+        exit(EXIT_SUCCESS);
+    }
+}
@@ -0,0 +1,14 @@
+#include "vcpkg_Commands.h"
+#include "vcpkg_Server.h"
+
+namespace vcpkg
+{
+    void server_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        static const std::string example = Strings::format("The server takes no arguments.\n%s", create_example_string("server"));
+        args.check_exact_arg_count(0, example.c_str());
+
+        Server::run(paths);
+        exit(EXIT_SUCCESS);
+    }
+}
@@ -0,0 +1,90 @@
+#include "vcpkg_Commands.h"
+#include "vcpkg_System.h"
+#include "BuildDurations.h"
+#include "BuildResources.h"
+#include <algorithm>
+
+namespace vcpkg
+{
+    static std::string format_parallelism(const long long cpu_ms, const long long wall_ms)
+    {
+        if (wall_ms <= 0)
+        {
+            return "-";
+        }
+        return Strings::format("%.1fx", static_cast<double>(cpu_ms) / static_cast<double>(wall_ms));
+    }
+
+    // "yes" or "no", with how much faster the last build was than the last one the other way, when there was one
+    static std::string format_unity_build(const BuildResources::build_resources& r)
+    {
+        const char* const mode = r.unity_build ? "yes" : "no";
+        if (r.other_wall_ms <= 0 || r.wall_ms <= 0)
+        {
+            return mode;
+        }
+        const double saved = 100.0 * (1.0 - static_cast<double>(r.wall_ms) / static_cast<double>(r.other_wall_ms));
+        return Strings::format("%s, %.0f%% %s", mode, saved < 0 ? -saved : saved, saved < 0 ? "slower" : "faster");
+    }
+
+    // What the last build of each package on this machine used, the most CPU time first, for sizing build agents
+    void stats_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        static const std::string example = Strings::format(
+            "The argument should be a substring to search for, or no argument to display every package built here.\n%s", create_example_string("stats boost"));
+        args.check_max_arg_count(1, example.c_str());
+
+        const Strings::case_insensitive_ascii_searcher searcher(args.command_arguments.empty() ? std::string() : args.command_arguments[0]);
+        std::vector<std::pair<std::string, BuildResources::build_resources>> builds;
+        for (auto&& kv : BuildResources::load(paths))
+        {
+            if (!searcher.is_found_in(kv.first))
+            {
+                continue;
+            }
+            builds.push_back(kv);
+        }
+
+        if (builds.empty())
+        {
+            System::println("No resource usage was recorded. It is recorded for each package install builds.");
+            exit(EXIT_SUCCESS);
+        }
+
+        std::stable_sort(builds.begin(), builds.end(), [](auto&& left, auto&& right) { return left.second.cpu_ms > right.second.cpu_ms; });
+
+        static const char* const ROW_FORMAT = "%-36s %10s %10s %8s %12s %12s %12s %-18s";
+        System::println(ROW_FORMAT, "Package", "Wall", "CPU", "CPU/wall", "Peak memory", "Read", "Written", "Unity build");
+        BuildResources::build_resources total = {};
+        for (auto&& build : builds)
+        {
+            const BuildResources::build_resources& r = build.second;
+            System::println(ROW_FORMAT, build.first,
+                            BuildDurations::format_duration(r.wall_ms),
+                            BuildDurations::format_duration(r.cpu_ms),
+                            format_parallelism(r.cpu_ms, r.wall_ms),
+                            BuildResources::format_bytes(r.peak_memory_bytes),
+                            BuildResources::format_bytes(r.read_bytes),
+                            BuildResources::format_bytes(r.write_bytes),
+                            format_unity_build(r));
+
+            total.wall_ms += r.wall_ms;
+            total.cpu_ms += r.cpu_ms;
+            total.peak_memory_bytes = std::max(total.peak_memory_bytes, r.peak_memory_bytes);
+            total.read_bytes += r.read_bytes;
+            total.write_bytes += r.write_bytes;
+        }
+
+        // Wall times add up as if the builds ran one after the other; the peak is that of the largest single build
+        System::println("");
+        System::println(ROW_FORMAT, Strings::format("Total (%s packages)", std::to_string(builds.size())),
+                        BuildDurations::format_duration(total.wall_ms),
+                        BuildDurations::format_duration(total.cpu_ms),
+                        format_parallelism(total.cpu_ms, total.wall_ms),
+                        BuildResources::format_bytes(total.peak_memory_bytes),
+                        BuildResources::format_bytes(total.read_bytes),
+                        BuildResources::format_bytes(total.write_bytes),
+                        "");
+        exit(EXIT_SUCCESS);
+    }
+}
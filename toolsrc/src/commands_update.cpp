@@ -2,73 +2,160 @@
 #include "vcpkg.h"
 #include "vcpkg_System.h"
 #include "vcpkg_Files.h"
-#include "Paragraphs.h"
+#include "PortsIndex.h"
 #include "vcpkg_info.h"
+#include "vcpkg_BinaryCache.h"
+#include "PackageArchive.h"
+#include "Trash.h"
+#include <unordered_set>
 
 namespace vcpkg
 {
-    void update_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    static const std::string OPTION_LINK = "--link";
+    static const std::string OPTION_TAIL_LOGS = "--tail-logs";
+
+    struct outdated_package
     {
-        args.check_exact_arg_count(0);
-        System::println("Using local portfile versions. To update the local portfiles, use `git pull`.");
+        package_spec spec;
+        std::string description;
+    };
 
-        auto status_db = database_load_check(paths);
+    struct outdated_packages
+    {
+        std::vector<outdated_package> packages;
+        // Installed before ABI hashes were recorded, so only a version change can be detected for these
+        size_t without_abi_count = 0;
+    };
 
+    // Finds the installed packages whose port would now produce different binaries: a changed Version, or a changed
+    // ABI hash (portfile, patches, triplet, build scripts or a dependency), plus every installed package depending on those.
+    static outdated_packages find_outdated_packages(const vcpkg_paths& paths, StatusParagraphs& status_db)
+    {
         std::unordered_map<std::string, std::string> src_names_to_versions;
+        for (const SourceParagraph& srcpgh : PortsIndex::load_source_paragraphs(paths))
+        {
+            src_names_to_versions.emplace(srcpgh.name, srcpgh.version);
+        }
 
-        auto begin_it = fs::directory_iterator(paths.ports);
-        auto end_it = fs::directory_iterator();
-        for (; begin_it != end_it; ++begin_it)
+        outdated_packages output;
+        std::unordered_map<package_spec, std::string> abis;
+        std::unordered_map<package_spec, std::string> descriptions;
+        std::vector<const BinaryParagraph*> changed;
+        for (auto&& pgh : status_db)
         {
-            const auto& path = begin_it->path();
-            try
+            if (pgh->state != install_state_t::installed)
+                continue;
+            const BinaryParagraph& package = pgh->package;
+            auto it = src_names_to_versions.find(package.spec.name());
+            if (it == src_names_to_versions.end())
             {
-                auto pghs = Paragraphs::get_paragraphs(path / "CONTROL");
-                if (pghs.empty())
-                    continue;
-                auto srcpgh = SourceParagraph(pghs[0]);
-                src_names_to_versions.emplace(srcpgh.name, srcpgh.version);
+                // Package was not installed from portfile
+                continue;
+            }
+
+            if (it->second != package.version)
+            {
+                descriptions.emplace(package.spec, Strings::format("%s -> %s", package.version, it->second));
+                changed.push_back(&package);
             }
-            catch (std::runtime_error const&)
+            else if (package.abi.empty())
             {
+                ++output.without_abi_count;
+            }
+            else
+            {
+                try
+                {
+                    if (BinaryCache::compute_abi_hash(paths, package.spec, abis) != package.abi)
+                    {
+                        descriptions.emplace(package.spec, std::string());
+                        changed.push_back(&package);
+                    }
+                }
+                catch (const std::exception& e)
+                {
+                    System::println(System::color::warning, "Warning: could not check %s for changes: %s", package.displayname(), e.what());
+                }
             }
         }
 
-        std::string packages_list;
-
-        std::vector<std::string> packages_output;
-        for (auto&& pgh : database_load_check(paths))
+        // A changed dependency also changes the ABI hash of its dependents; name the dependency instead of the port files then
+        for (const BinaryParagraph* package : changed)
         {
-            if (pgh->state == install_state_t::not_installed && pgh->want == want_t::purge)
+            std::string& description = descriptions.at(package->spec);
+            if (!description.empty())
                 continue;
-            auto it = src_names_to_versions.find(pgh->package.spec.name());
-            if (it == src_names_to_versions.end())
+            description = "port files changed";
+            for (const std::string& dependency : package->depends)
             {
-                // Package was not installed from portfile
-                continue;
+                const package_spec dependency_spec = package_spec::from_name_and_triplet(dependency, package->spec.target_triplet()).get_or_throw();
+                if (descriptions.find(dependency_spec) != descriptions.end())
+                {
+                    description = Strings::format("rebuilt against %s", to_string(dependency_spec));
+                    break;
+                }
             }
-            if (it->second != pgh->package.version)
+        }
+
+        // Dependents without a recorded ABI hash would not be caught above, so walk the reverse dependencies explicitly
+        std::vector<package_spec> pending;
+        for (const BinaryParagraph* package : changed)
+        {
+            pending.push_back(package->spec);
+        }
+        while (!pending.empty())
+        {
+            const package_spec spec = pending.back();
+            pending.pop_back();
+            for (const StatusParagraph* dependent : status_db.find_dependents(spec.name(), spec.target_triplet()))
             {
-                packages_output.push_back(Strings::format("%-27s %s -> %s",
-                                                          pgh->package.displayname(),
-                                                          pgh->package.version,
-                                                          it->second));
-                packages_list.append(" " + pgh->package.displayname());
+                if (descriptions.emplace(dependent->package.spec, Strings::format("rebuilt against %s", to_string(spec))).second)
+                {
+                    pending.push_back(dependent->package.spec);
+                }
             }
         }
-        std::sort(packages_output.begin(), packages_output.end());
-        if (packages_output.empty())
+
+        for (auto&& description : descriptions)
+        {
+            output.packages.push_back({description.first, description.second});
+        }
+        std::sort(output.packages.begin(), output.packages.end(), [](const outdated_package& left, const outdated_package& right)
+            {
+                return to_string(left.spec) < to_string(right.spec);
+            });
+        return output;
+    }
+
+    static void print_outdated_packages(const outdated_packages& outdated)
+    {
+        for (const outdated_package& package : outdated.packages)
+        {
+            System::println("    %-27s %s", to_string(package.spec), package.description);
+        }
+    }
+
+    void update_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        args.check_exact_arg_count(0);
+        System::println("Using local portfile versions. To update the local portfiles, use `git pull`.");
+
+        auto status_db = database_load_check(paths);
+        const outdated_packages outdated = find_outdated_packages(paths, status_db);
+        if (outdated.packages.empty())
         {
             System::println("No packages need updating.");
         }
         else
         {
-            System::println("The following packages differ from their port versions:");
-            for (auto&& package : packages_output)
-            {
-                System::println("    %s", package.c_str());
-            }
-            System::println("\nTo update these packages, run\n    vcpkg remove --purge <pkgs>...\n    vcpkg install <pkgs>...");
+            System::println("The following packages differ from their ports:");
+            print_outdated_packages(outdated);
+            System::println("\nTo rebuild these packages, run\n    vcpkg upgrade");
+        }
+
+        if (outdated.without_abi_count != 0)
+        {
+            System::println("%d package(s) were installed by an older vcpkg; only version changes can be detected for them.", static_cast<int>(outdated.without_abi_count));
         }
 
         auto version_file = Files::get_contents(paths.root / "toolsrc" / "VERSION.txt");
@@ -93,4 +180,59 @@ namespace vcpkg
 
         exit(EXIT_SUCCESS);
     }
+
+    void upgrade_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths)
+    {
+        args.check_exact_arg_count(0);
+        const std::unordered_set<std::string> options = args.check_and_get_optional_command_arguments({OPTION_LINK, OPTION_TAIL_LOGS});
+        const install_file_mode mode = options.find(OPTION_LINK) != options.end() ? install_file_mode::hard_link : install_file_mode::copy;
+
+        // Any installed package may turn out to be outdated, so every triplet that has one is locked before the real load
+        std::vector<package_spec> installed_specs;
+        {
+            const status_snapshot snapshot = load_status_snapshot(paths);
+            for (size_t i = 0; i < snapshot.size(); ++i)
+            {
+                if (snapshot[i].state == install_state_t::installed)
+                {
+                    installed_specs.push_back(snapshot.paragraph(i).package.spec);
+                }
+            }
+        }
+        const std::vector<Files::file_lock> triplet_locks = lock_triplets(paths, installed_specs);
+
+        auto status_db = database_load_check(paths);
+        const outdated_packages outdated = find_outdated_packages(paths, status_db);
+        if (outdated.packages.empty())
+        {
+            System::println("No packages need rebuilding.");
+            exit(EXIT_SUCCESS);
+        }
+
+        System::println("The following packages will be rebuilt:");
+        print_outdated_packages(outdated);
+
+        std::vector<package_spec> specs;
+        for (const outdated_package& package : outdated.packages)
+        {
+            specs.push_back(package.spec);
+        }
+
+        // Every dependent is part of specs, so nothing outside of them can block the removal
+        deinstall_packages(paths, specs, status_db);
+
+        // Stale packages/ directories from older vcpkg versions carry no ABI hash and would otherwise be reinstalled as is
+        for (const package_spec& spec : specs)
+        {
+            std::error_code ec;
+            if (!Trash::move_to_trash(paths, paths.package_dir(spec)))
+            {
+                fs::remove_all(paths.package_dir(spec), ec);
+            }
+            fs::remove(PackageArchive::archive_path(paths, spec), ec);
+        }
+
+        install_specs(args, paths, specs, status_db, mode, false, options.find(OPTION_TAIL_LOGS) != options.end());
+        exit(EXIT_SUCCESS);
+    }
 }
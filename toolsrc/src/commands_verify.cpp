@@ -0,0 +1,163 @@
+#include "vcpkg_Commands.h"
+#include "vcpkg.h"
+#include "vcpkg_System.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Hash.h"
+#include "vcpkg_Input.h"
+#include "vcpkg_Parallel.h"
+#include "BuildResources.h"
+#include "Stopwatch.h"
+#include <atomic>
+#include <unordered_set>
+
+namespace vcpkg
+{
+    namespace
+    {
+        struct recorded_file
+        {
+            size_t package; // Index in the verified packages
+            std::string path; // Relative to installed/, as in the listfile
+            uint64_t size;
+            std::string xxh64;
+        };
+
+        enum class file_state
+        {
+            intact,
+            missing,
+            modified
+        };
+
+        // Lines the installer wrote as "<xxh64> <size> <path>"; anything else is skipped
+        void parse_hashesfile(const std::string& text, const size_t package, std::vector<recorded_file>& files)
+        {
+            size_t pos = 0;
+            while (pos < text.size())
+            {
+                size_t end = text.find('\n', pos);
+                if (end == std::string::npos)
+                    end = text.size();
+                const size_t hash_end = text.find(' ', pos);
+                const size_t size_end = hash_end < end ? text.find(' ', hash_end + 1) : std::string::npos;
+                if (hash_end - pos == 16 && size_end < end)
+                {
+                    try
+                    {
+                        const uint64_t size = std::stoull(text.substr(hash_end + 1, size_end - hash_end - 1));
+                        files.push_back({package, text.substr(size_end + 1, end - size_end - 1), size, text.substr(pos, 16)});
+                    }
+                    catch (const std::exception&)
+                    {
+                    }
+                }
+                pos = end + 1;
+            }
+        }
+    }
+
+    // Checks that every file installed by the given packages, or by all installed packages, still has the size and
+    // hash recorded when it was installed. Files are hashed in parallel straight out of their mappings, and a file
+    // whose size changed is reported without being read.
+    void verify_command(const vcpkg_cmd_arguments& args, const vcpkg_paths& paths, const triplet& default_target_triplet)
+    {
+        static const std::string example = create_example_string("verify zlib zlib:x64-windows curl boost");
+        const std::vector<package_spec> specs = Input::check_and_get_package_specs(args.command_arguments, default_target_triplet, example.c_str());
+        Input::check_triplets(specs, paths);
+
+        std::unordered_set<std::string> wanted;
+        for (const package_spec& spec : specs)
+        {
+            wanted.insert(to_string(spec));
+        }
+
+        const Stopwatch timer = Stopwatch::createStarted();
+        const status_snapshot status_db = load_status_snapshot(paths);
+        std::vector<const StatusParagraph*> packages;
+        for (size_t i = 0; i < status_db.size(); ++i)
+        {
+            const status_snapshot::entry& entry = status_db[i];
+            if (entry.state != install_state_t::installed || (!wanted.empty() && wanted.erase(entry.displayname) == 0))
+                continue;
+            packages.push_back(&status_db.paragraph(i));
+        }
+
+        if (!wanted.empty())
+        {
+            System::println(System::color::error, "Error: package %s is not installed", *wanted.begin());
+            print_example(example.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        std::vector<recorded_file> files;
+        size_t unrecorded_package_count = 0;
+        for (size_t package = 0; package < packages.size(); ++package)
+        {
+            const expected<std::string> text = Files::get_contents(paths.hashesfile_path(packages[package]->package));
+            if (const std::string* t = text.get())
+            {
+                parse_hashesfile(*t, package, files);
+            }
+            else
+            {
+                System::println(System::color::warning, "Warning: %s was installed without recording hashes; reinstall it to verify it",
+                                packages[package]->package.displayname());
+                ++unrecorded_package_count;
+            }
+        }
+
+        std::vector<file_state> states(files.size(), file_state::intact);
+        std::atomic<uint64_t> hashed_bytes(0);
+        Parallel::for_each_index(files.size(), [&](const size_t i)
+            {
+                const recorded_file& file = files[i];
+                const fs::path installed_file = paths.installed / file.path;
+
+                std::error_code ec;
+                const uintmax_t size = fs::file_size(installed_file, ec);
+                if (ec)
+                {
+                    states[i] = file_state::missing;
+                    return;
+                }
+                if (size != file.size)
+                {
+                    states[i] = file_state::modified;
+                    return;
+                }
+
+                const expected<Hash::file_digest> digest = Hash::get_file_xxh64(installed_file);
+                const Hash::file_digest* d = digest.get();
+                if (d == nullptr)
+                {
+                    states[i] = file_state::missing;
+                    return;
+                }
+                hashed_bytes += d->size;
+                if (d->size != file.size || d->xxh64 != file.xxh64)
+                    states[i] = file_state::modified;
+            });
+
+        size_t problem_count = 0;
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            if (states[i] == file_state::intact)
+                continue;
+
+            ++problem_count;
+            System::println(System::color::error, "%s: %s %s", packages[files[i].package]->package.displayname(),
+                            states[i] == file_state::missing ? "missing" : "modified", files[i].path);
+        }
+
+        System::println("Verified %d files (%s) of %d packages in %s", files.size(), BuildResources::format_bytes(hashed_bytes.load()),
+                        packages.size() - unrecorded_package_count, timer.toString());
+        if (problem_count != 0)
+        {
+            System::println(System::color::error, "%d installed files are missing or were modified. Reinstall the packages that own them.", problem_count);
+            exit(EXIT_FAILURE);
+        }
+
+        System::println(System::color::success, "All installed files are intact");
+        exit(EXIT_SUCCESS);
+    }
+}
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <memory>
 #include <cassert>
+#include <future>
 #include "vcpkg_Commands.h"
 #include "metrics.h"
 #include <Shlobj.h>
@@ -13,6 +14,9 @@
 #include "vcpkg_Input.h"
 #include "Paragraphs.h"
 #include "vcpkg_info.h"
+#include "vcpkg_Trace.h"
+#include "Stopwatch.h"
+#include "Timings.h"
 
 using namespace vcpkg;
 
@@ -60,6 +64,13 @@ static void inner(const vcpkg_cmd_arguments& args)
 
     Checks::check_exit(!vcpkg_root_dir.empty(), "Error: Could not detect vcpkg-root.");
 
+    // Through the environment, so that the portfiles vcpkg runs use the same scratch directories
+    if (args.scratch_root_dir != nullptr)
+    {
+        const fs::path scratch_root_dir = fs::absolute(Strings::utf8_to_utf16(*args.scratch_root_dir));
+        _wputenv_s(L"VCPKG_SCRATCH_ROOT", scratch_root_dir.native().c_str());
+    }
+
     const expected<vcpkg_paths> expected_paths = vcpkg_paths::create(vcpkg_root_dir);
     Checks::check_exit(!expected_paths.error_code(), "Error: Invalid vcpkg root directory %s: %s", vcpkg_root_dir.string(), expected_paths.error_code().message());
     const vcpkg_paths paths = expected_paths.get_or_throw();
@@ -154,7 +165,11 @@ static void loadConfig()
     }
 }
 
-static System::Stopwatch2 g_timer;
+static Stopwatch g_timer = Stopwatch::createUnstarted();
+
+// The config file is read on its own thread, and only when metrics are reported, so that commands do not wait for it.
+// Defined before the atexit handler is registered, so it is still alive when the handler waits for it.
+static std::future<void> g_config_loaded;
 
 static std::string trim_path_from_command_line(const std::string& full_command_line)
 {
@@ -188,15 +203,27 @@ int wmain(const int argc, const wchar_t* const* const argv)
     atexit([]()
         {
             g_timer.stop();
-            TrackMetric("elapsed_us", g_timer.microseconds());
+            TrackMetric("elapsed_us", static_cast<double>(g_timer.elapsed<std::chrono::microseconds>().count()));
+            if (Timings::is_enabled())
+            {
+                for (const Timings::totals& t : Timings::get_totals())
+                {
+                    TrackMetric("timingus-" + t.name, static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(t.total).count()));
+                }
+                Timings::print_summary();
+            }
+            if (g_config_loaded.valid())
+            {
+                g_config_loaded.wait();
+            }
             Flush();
+            Trace::flush();
         });
 
     TrackProperty("version", Info::version());
 
     const std::string trimmed_command_line = trim_path_from_command_line(Strings::utf16_to_utf8(GetCommandLineW()));
     TrackProperty("cmdline", trimmed_command_line);
-    loadConfig();
 
     const vcpkg_cmd_arguments args = vcpkg_cmd_arguments::create_from_command_line(argc, argv);
 
@@ -205,6 +232,21 @@ int wmain(const int argc, const wchar_t* const* const argv)
     if (args.sendmetrics != opt_bool::unspecified)
         SetSendMetrics(args.sendmetrics == opt_bool::enabled);
 
+    if (ShouldReportMetrics())
+    {
+        g_config_loaded = std::async(std::launch::async, loadConfig);
+    }
+
+    if (args.timings == opt_bool::enabled)
+    {
+        Timings::enable();
+    }
+
+    if (args.trace_file != nullptr)
+    {
+        Trace::enable(fs::absolute(Strings::utf8_to_utf16(*args.trace_file)));
+    }
+
     if (args.debug != opt_bool::unspecified)
     {
         g_debugging = (args.debug == opt_bool::enabled);
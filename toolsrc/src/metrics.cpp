@@ -11,8 +11,12 @@
 #include <winhttp.h>
 #include <fstream>
 #include <filesystem>
+#include <mutex>
 #include "vcpkg_Strings.h"
 #include "vcpkg_System.h"
+#include "vcpkg_Gzip.h"
+#include <algorithm>
+#include <iterator>
 
 namespace fs = std::tr2::sys;
 
@@ -160,7 +164,8 @@ namespace vcpkg
 
     struct MetricMessage
     {
-        std::string user_id = GenerateRandomUUID();
+        // Set from the config file, which is only read when metrics are reported
+        std::string user_id;
         std::string user_timestamp;
         std::string timestamp = GetCurrentDateTime();
         std::string properties;
@@ -223,6 +228,7 @@ namespace vcpkg
     };
 
     static MetricMessage g_metricmessage;
+    static std::mutex g_metricmessage_mutex; // Builds may report metrics from worker threads
     static bool g_should_send_metrics =
 #if defined(NDEBUG) && (DISABLE_METRICS == 0)
 true
@@ -237,8 +243,14 @@ true
         return DISABLE_METRICS == 0;
     }
 
+    bool ShouldReportMetrics()
+    {
+        return g_should_send_metrics || g_should_print_metrics;
+    }
+
     void SetUserInformation(const std::string& user_id, const std::string& first_use_time)
     {
+        std::lock_guard<std::mutex> lock(g_metricmessage_mutex);
         g_metricmessage.user_id = user_id;
         g_metricmessage.user_timestamp = first_use_time;
     }
@@ -261,6 +273,7 @@ true
 
     void TrackMetric(const std::string& name, double value)
     {
+        std::lock_guard<std::mutex> lock(g_metricmessage_mutex);
         g_metricmessage.TrackMetric(name, value);
     }
 
@@ -277,15 +290,18 @@ true
                 return static_cast<char>(ch);
             });
 
+        std::lock_guard<std::mutex> lock(g_metricmessage_mutex);
         g_metricmessage.TrackProperty(name, converted_value);
     }
 
     void TrackProperty(const std::string& name, const std::string& value)
     {
+        std::lock_guard<std::mutex> lock(g_metricmessage_mutex);
         g_metricmessage.TrackProperty(name, value);
     }
 
-    void Upload(const std::string& payload)
+    // Returns whether the server accepted the request
+    static bool post(const std::string& payload, const std::wstring& hdrs)
     {
         HINTERNET hSession = nullptr, hConnect = nullptr, hRequest = nullptr;
         BOOL bResults = FALSE;
@@ -311,7 +327,6 @@ true
         {
             if (MAXDWORD <= payload.size())
                 abort();
-            std::wstring hdrs = L"Content-Type: application/json\r\n";
             bResults = WinHttpSendRequest(hRequest,
                                           hdrs.c_str(), static_cast<DWORD>(hdrs.size()),
                                           (void*)&payload[0], static_cast<DWORD>(payload.size()), static_cast<DWORD>(payload.size()),
@@ -367,6 +382,100 @@ true
             WinHttpCloseHandle(hConnect);
         if (hSession)
             WinHttpCloseHandle(hSession);
+        return bResults && http_code == 200;
+    }
+
+    void Upload(const std::string& payload)
+    {
+        post(payload, L"Content-Type: application/json\r\n");
+    }
+
+    // Events older than the newest ones are dropped past this, so that a machine that cannot reach the server does not fill its disk
+    static const size_t MAX_SPOOLED_EVENTS = 10000;
+    static const size_t MAX_BATCH_EVENTS = 500;
+    static const wchar_t* const SPOOLED_EVENT_EXTENSION = L".json";
+
+    void UploadSpool(const fs::path& spool_dir)
+    {
+        // Spooled events are named after the time they were written, so the names sort from oldest to newest
+        std::vector<fs::path> events;
+        std::error_code ec;
+        for (auto it = fs::directory_iterator(spool_dir, ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+        {
+            if (it->path().extension() == SPOOLED_EVENT_EXTENSION)
+            {
+                events.push_back(it->path());
+            }
+        }
+        std::sort(events.begin(), events.end());
+        if (events.size() > MAX_SPOOLED_EVENTS)
+        {
+            const size_t dropped = events.size() - MAX_SPOOLED_EVENTS;
+            for (size_t i = 0; i < dropped; ++i)
+            {
+                fs::remove(events[i], ec);
+            }
+            events.erase(events.begin(), events.begin() + dropped);
+        }
+
+        const std::wstring claimed_extension = Strings::wformat(L".sending-%s", std::to_wstring(GetCurrentProcessId()));
+        for (size_t first = 0; first < events.size(); first += MAX_BATCH_EVENTS)
+        {
+            // Another uploader may be sending the same files; whoever renames a file first sends it
+            std::vector<fs::path> claimed;
+            std::string batch = "[";
+            for (size_t i = first; i < events.size() && i < first + MAX_BATCH_EVENTS; ++i)
+            {
+                fs::path claimed_event = events[i];
+                claimed_event += claimed_extension;
+                fs::rename(events[i], claimed_event, ec);
+                if (ec)
+                {
+                    continue;
+                }
+                claimed.push_back(claimed_event);
+
+                // Each one holds a JSON array of events
+                std::ifstream is(claimed_event, std::ios_base::in | std::ios_base::binary);
+                const std::string event((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+                const size_t open = event.find('[');
+                const size_t close = event.rfind(']');
+                if (open == std::string::npos || close == std::string::npos || close <= open + 1)
+                {
+                    continue;
+                }
+                if (batch.size() > 1)
+                {
+                    batch.push_back(',');
+                }
+                batch.append(event, open + 1, close - open - 1);
+            }
+            batch.push_back(']');
+            if (claimed.empty())
+            {
+                continue;
+            }
+
+            const bool sent = batch.size() <= 2 || post(Gzip::compress(batch), L"Content-Type: application/json\r\nContent-Encoding: gzip\r\n");
+            for (const fs::path& claimed_event : claimed)
+            {
+                if (sent)
+                {
+                    fs::remove(claimed_event, ec);
+                }
+                else
+                {
+                    fs::path event = claimed_event;
+                    event.replace_extension();
+                    fs::rename(claimed_event, event, ec);
+                }
+            }
+            if (!sent)
+            {
+                // Kept for the next upload
+                return;
+            }
+        }
     }
 
     static fs::path get_bindir()
@@ -378,21 +487,88 @@ true
         return fs::path(buf, buf + bytes);
     }
 
+    // At most one uploader is started in this interval, whatever the number of vcpkg invocations. Everything they
+    // spooled in between goes in the batch of the next one.
+    static const long long UPLOAD_INTERVAL_100NS = 10LL * 60 * 1000 * 1000 * 10;
+
+    static long long get_current_file_time()
+    {
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        return static_cast<long long>(ULARGE_INTEGER{{now.dwLowDateTime, now.dwHighDateTime}}.QuadPart);
+    }
+
+    // Whether this process takes the next upload: the time of the last one is the last write time of spool_dir/last-upload
+    static bool claim_upload(const fs::path& spool_dir, const long long now)
+    {
+        const fs::path stamp = spool_dir / "last-upload";
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (GetFileAttributesExW(stamp.wstring().c_str(), GetFileExInfoStandard, &attributes))
+        {
+            const long long last_upload = static_cast<long long>(ULARGE_INTEGER{{attributes.ftLastWriteTime.dwLowDateTime, attributes.ftLastWriteTime.dwHighDateTime}}.QuadPart);
+            if (now - last_upload < UPLOAD_INTERVAL_100NS)
+            {
+                return false;
+            }
+        }
+
+        std::ofstream(stamp, std::ios_base::out | std::ios_base::trunc);
+        return true;
+    }
+
     void Flush()
     {
-        std::string payload = g_metricmessage.format_event_data_template();
+        if (!ShouldReportMetrics())
+            return;
+
+        std::string payload;
+        {
+            std::lock_guard<std::mutex> lock(g_metricmessage_mutex);
+            payload = g_metricmessage.format_event_data_template();
+        }
         if (g_should_print_metrics)
             std::cerr << payload << "\n";
         if (!g_should_send_metrics)
             return;
 
-        // Upload(payload);
-
         wchar_t temp_folder[MAX_PATH];
         GetTempPathW(MAX_PATH, temp_folder);
 
         const fs::path temp_folder_path = temp_folder;
         const fs::path temp_folder_path_exe = temp_folder_path / "vcpkgmetricsuploader.exe";
+        const fs::path spool_dir = temp_folder_path / "vcpkg-metrics";
+
+        // Appending to the spool is all most invocations do: nothing is started and nothing goes over the network
+        const long long now = get_current_file_time();
+        std::string spooled_name = std::to_string(now);
+        spooled_name.insert(0, 20 - std::min<size_t>(20, spooled_name.size()), '0');
+        spooled_name += "-" + std::to_string(GetCurrentProcessId());
+        std::error_code ec;
+        fs::create_directories(spool_dir, ec);
+        const fs::path tmp_path = spool_dir / (spooled_name + ".tmp");
+        const fs::path spooled_path = spool_dir / (spooled_name + ".json");
+        {
+            std::ofstream os(tmp_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+            os << payload;
+            os.flush();
+            if (os.fail())
+            {
+                os.close();
+                fs::remove(tmp_path, ec);
+                return;
+            }
+        }
+        fs::rename(tmp_path, spooled_path, ec);
+        if (ec)
+        {
+            fs::remove(tmp_path, ec);
+            return;
+        }
+
+        if (!claim_upload(spool_dir, now))
+        {
+            return;
+        }
 
         if (true)
         {
@@ -410,16 +586,22 @@ true
                     return L"";
                 }();
 
-            std::error_code ec;
-            fs::copy_file(exe_path, temp_folder_path_exe, fs::copy_options::skip_existing, ec);
+            // An uploader left by an older vcpkg may not know the spool, so it is replaced by a newer one. While it runs it
+            // cannot be, and this upload waits for the next invocation.
+            fs::copy_file(exe_path, temp_folder_path_exe, fs::copy_options::update_existing, ec);
             if (ec)
                 return;
         }
 
-        const fs::path vcpkg_metrics_txt_path = temp_folder_path / ("vcpkg" + GenerateRandomUUID() + ".txt");
-        std::ofstream(vcpkg_metrics_txt_path) << payload;
-
-        const std::wstring cmdLine = Strings::wformat(L"start %s %s", temp_folder_path_exe.native(), vcpkg_metrics_txt_path.native());
-        System::cmd_execute(cmdLine);
+        // Started directly rather than through "cmd /c start", and left running after vcpkg exits
+        std::wstring cmdLine = Strings::wformat(LR"("%s" "%s")", temp_folder_path_exe.native(), spool_dir.native());
+        STARTUPINFOW startup_info = {};
+        startup_info.cb = sizeof(startup_info);
+        PROCESS_INFORMATION process_info = {};
+        if (CreateProcessW(temp_folder_path_exe.wstring().c_str(), &cmdLine[0], nullptr, nullptr, FALSE, DETACHED_PROCESS | CREATE_NO_WINDOW, nullptr, nullptr, &startup_info, &process_info))
+        {
+            CloseHandle(process_info.hThread);
+            CloseHandle(process_info.hProcess);
+        }
     }
 }
@@ -1,8 +1,39 @@
 #include "package_spec.h"
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace vcpkg
 {
+    struct package_spec::interned
+    {
+        std::string name;
+        triplet target_triplet;
+        std::string display_name; // <name>:<triplet>
+        size_t hash;
+    };
+
+    // Keyed by display name; entries are never removed, so the pointers handed out stay valid for the life of the process
+    const package_spec::interned* package_spec::intern(const std::string& name, const triplet& target_triplet)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::unique_ptr<package_spec::interned>> table;
+
+        std::string display_name = Strings::format("%s:%s", name, target_triplet);
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<package_spec::interned>& entry = table[display_name];
+        if (!entry)
+        {
+            entry = std::make_unique<package_spec::interned>();
+            entry->name = name;
+            entry->target_triplet = target_triplet;
+            entry->hash = std::hash<std::string>()(display_name);
+            entry->display_name = std::move(display_name);
+        }
+        return entry.get();
+    }
+
     static bool is_valid_package_spec_char(char c)
     {
         return (c == '-') || isdigit(c) || (isalpha(c) && islower(c));
@@ -34,30 +65,40 @@ namespace vcpkg
             return std::error_code(package_spec_parse_result::INVALID_CHARACTERS);
         }
 
-        package_spec p;
-        p.m_name = name;
-        p.m_target_triplet = target_triplet;
-        return p;
+        return package_spec(intern(name, target_triplet));
+    }
+
+    package_spec::package_spec() : m_data(intern(std::string(), triplet()))
+    {
+    }
+
+    package_spec::package_spec(const interned* data) : m_data(data)
+    {
     }
 
     const std::string& package_spec::name() const
     {
-        return this->m_name;
+        return this->m_data->name;
     }
 
     const triplet& package_spec::target_triplet() const
     {
-        return this->m_target_triplet;
+        return this->m_data->target_triplet;
     }
 
     std::string package_spec::dir() const
     {
-        return Strings::format("%s_%s", this->m_name, this->m_target_triplet);
+        return Strings::format("%s_%s", this->m_data->name, this->m_data->target_triplet);
+    }
+
+    size_t package_spec::hash_code() const
+    {
+        return this->m_data->hash;
     }
 
     std::string to_string(const package_spec& spec)
     {
-        return Strings::format("%s:%s", spec.name(), spec.target_triplet());
+        return spec.m_data->display_name;
     }
 
     std::string to_printf_arg(const package_spec& spec)
@@ -67,7 +108,8 @@ namespace vcpkg
 
     bool operator==(const package_spec& left, const package_spec& right)
     {
-        return left.name() == right.name() && left.target_triplet() == right.target_triplet();
+        // Equal specs are the same interned entry
+        return &left.name() == &right.name();
     }
 
     std::ostream& operator<<(std::ostream& os, const package_spec& spec)
@@ -6,7 +6,17 @@
 #include "vcpkg_System.h"
 #include "coff_file_reader.h"
 #include "BuildInfo.h"
-#include <regex>
+#include "Timings.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include "vcpkg_Files.h"
+#include "vcpkg_Hash.h"
+#include "vcpkg_Parallel.h"
+#include <Windows.h>
 
 namespace fs = std::tr2::sys;
 
@@ -18,8 +28,6 @@ namespace vcpkg
         ERROR_DETECTED = 1
     };
 
-    static const fs::path DUMPBIN_EXE = R"(%VS140COMNTOOLS%\..\..\VC\bin\dumpbin.exe)";
-
     namespace
     {
         void print_vector_of_files(const std::vector<fs::path>& paths)
@@ -32,33 +40,315 @@ namespace vcpkg
             System::println("");
         }
 
-        template <class Pred>
-        void recursive_find_matching_paths_in_dir(const fs::path& dir, const Pred predicate, std::vector<fs::path>* output)
+        // A single recursive scan of packages/<spec>, shared by all checks instead of each re-walking the tree
+        class package_tree
         {
-            std::copy_if(fs::recursive_directory_iterator(dir), fs::recursive_directory_iterator(), std::back_inserter(*output), predicate);
-        }
+        public:
+            explicit package_tree(const fs::path& root) : root(root)
+            {
+                const size_t root_length = root.generic_string().size() + 1; // The +1 is needed to remove the "/"
+                for (auto it = fs::recursive_directory_iterator(root); it != fs::recursive_directory_iterator(); ++it)
+                {
+                    entry e;
+                    e.path = it->path();
+                    e.relative = e.path.generic_string().erase(0, root_length);
+                    e.is_directory = fs::is_directory(e.path);
+                    e.is_empty_directory = e.is_directory;
+                    entries.push_back(std::move(e));
+                }
 
-        template <class Pred>
-        std::vector<fs::path> recursive_find_matching_paths_in_dir(const fs::path& dir, const Pred predicate)
+                // Entries are in pre-order, so a directory with contents is immediately followed by its first child
+                for (size_t i = 0; i + 1 < entries.size(); ++i)
+                {
+                    if (entries[i].is_directory && is_inside(entries[i + 1].relative, entries[i].relative))
+                    {
+                        entries[i].is_empty_directory = false;
+                    }
+                }
+            }
+
+            // subdir is relative to the package root and uses '/' separators; an empty subdir means the whole package
+            template <class Pred>
+            void find_matching_paths(const std::string& subdir, const Pred predicate, std::vector<fs::path>* output) const
+            {
+                for (const entry& e : entries)
+                {
+                    if (is_inside(e.relative, subdir) && predicate(e))
+                    {
+                        output->push_back(e.path);
+                    }
+                }
+            }
+
+            template <class Pred>
+            std::vector<fs::path> find_matching_paths(const std::string& subdir, const Pred predicate) const
+            {
+                std::vector<fs::path> v;
+                find_matching_paths(subdir, predicate, &v);
+                return v;
+            }
+
+            void find_files_with_extension(const std::string& subdir, const std::string& extension, std::vector<fs::path>* output) const
+            {
+                find_matching_paths(subdir, [&extension](const entry& current)
+                                    {
+                                        return !current.is_directory && current.path.extension() == extension;
+                                    }, output);
+            }
+
+            std::vector<fs::path> find_files_with_extension(const std::string& subdir, const std::string& extension) const
+            {
+                std::vector<fs::path> v;
+                find_files_with_extension(subdir, extension, &v);
+                return v;
+            }
+
+            struct entry
+            {
+                fs::path path;
+                std::string relative;
+                bool is_directory;
+                bool is_empty_directory;
+            };
+
+            fs::path root;
+
+        private:
+            static bool is_inside(const std::string& relative, const std::string& subdir)
+            {
+                if (subdir.empty())
+                {
+                    return true;
+                }
+
+                return relative.size() > subdir.size() && relative[subdir.size()] == '/' && _strnicmp(relative.c_str(), subdir.c_str(), subdir.size()) == 0;
+            }
+
+            std::vector<entry> entries;
+        };
+
+        struct lib_file
         {
-            std::vector<fs::path> v;
-            recursive_find_matching_paths_in_dir(dir, predicate, &v);
-            return v;
+            fs::path path;
+            COFFFileReader::lib_info info;
+        };
+
+        struct dll_file
+        {
+            fs::path path;
+            COFFFileReader::dll_info info;
+        };
+
+        // What was read out of the binaries checked by earlier builds, by size and XXH64 of their contents. A port rebuilt
+        // without changes produces the same binaries, which are then checked without being parsed again.
+        // One line per binary: "lib\t<key>\t<machine types>\t<default libs>\t<has LTCG objects>" or
+        // "dll\t<key>\t<machine type>\t<has exports>\t<is app container>".
+        class binary_info_cache
+        {
+        public:
+            explicit binary_info_cache(const fs::path& file) : file(file)
+            {
+                const expected<std::string> contents = Files::get_contents(file);
+                if (contents.get() == nullptr)
+                {
+                    return;
+                }
+
+                std::istringstream lines(*contents.get());
+                std::string line;
+                while (std::getline(lines, line))
+                {
+                    if (parse_line(line))
+                    {
+                        this->lines.push_back(line);
+                    }
+                }
+            }
+
+            // Returns an empty key when the file cannot be read
+            static std::string get_key(const fs::path& binary)
+            {
+                const expected<Hash::file_digest> digest = Hash::get_file_xxh64(binary);
+                return digest.get() != nullptr ? Strings::format("%s-%s", std::to_string(digest.get()->size), digest.get()->xxh64) : std::string();
+            }
+
+            bool find(const std::string& key, COFFFileReader::lib_info& info) const
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                const auto it = this->libs.find(key);
+                if (it == this->libs.end())
+                {
+                    return false;
+                }
+                info = it->second;
+                return true;
+            }
+
+            bool find(const std::string& key, COFFFileReader::dll_info& info) const
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                const auto it = this->dlls.find(key);
+                if (it == this->dlls.end())
+                {
+                    return false;
+                }
+                info = it->second;
+                return true;
+            }
+
+            void add(const std::string& key, const COFFFileReader::lib_info& info)
+            {
+                std::string machine_types;
+                for (const MachineType machine_type : info.machine_types)
+                {
+                    machine_types.append(machine_types.empty() ? "" : ",").append(std::to_string(static_cast<uint16_t>(machine_type)));
+                }
+                std::string default_libs;
+                for (const std::string& default_lib : info.default_libs)
+                {
+                    default_libs.append(default_libs.empty() ? "" : "|").append(default_lib);
+                }
+
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->libs.emplace(key, info);
+                this->lines.push_back(Strings::format("lib\t%s\t%s\t%s\t%d", key, machine_types, default_libs, info.has_ltcg_objects ? 1 : 0));
+                this->changed = true;
+            }
+
+            void add(const std::string& key, const COFFFileReader::dll_info& info)
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->dlls.emplace(key, info);
+                this->lines.push_back(Strings::format("dll\t%s\t%d\t%d\t%d", key, static_cast<int>(info.machine_type), info.has_exports ? 1 : 0, info.is_app_container ? 1 : 0));
+                this->changed = true;
+            }
+
+            // Keeps the most recent entries. Concurrent builds may each write their own version; the last one wins, and
+            // the binaries the others added are parsed again next time.
+            void save() const
+            {
+                static const size_t MAX_ENTRIES = 20000;
+                static std::atomic<int> tmp_counter(0);
+
+                if (!this->changed)
+                {
+                    return;
+                }
+
+                std::string contents;
+                for (size_t i = this->lines.size() > MAX_ENTRIES ? this->lines.size() - MAX_ENTRIES : 0; i < this->lines.size(); ++i)
+                {
+                    contents.append(this->lines[i]).push_back('\n');
+                }
+
+                std::error_code ec;
+                const fs::path tmp_file = this->file.parent_path() / Strings::format("%s.%d.%d.tmp", this->file.filename().string(), static_cast<int>(GetCurrentProcessId()), ++tmp_counter);
+                {
+                    std::ofstream os(tmp_file, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+                    os << contents;
+                    if (!os.flush())
+                    {
+                        os.close();
+                        fs::remove(tmp_file, ec);
+                        return;
+                    }
+                }
+                fs::rename(tmp_file, this->file, ec);
+                if (ec)
+                {
+                    fs::remove(tmp_file, ec);
+                }
+            }
+
+        private:
+            static std::vector<std::string> split(const std::string& s, const char separator)
+            {
+                std::vector<std::string> parts;
+                std::istringstream stream(s);
+                std::string part;
+                while (std::getline(stream, part, separator))
+                {
+                    parts.push_back(part);
+                }
+                if (!s.empty() && s.back() == separator)
+                {
+                    parts.push_back(std::string());
+                }
+                return parts;
+            }
+
+            bool parse_line(const std::string& line)
+            {
+                const std::vector<std::string> fields = split(line, '\t');
+                try
+                {
+                    // Lines without the LTCG field were written before /bigobj members were read, and are dropped
+                    if (fields.size() == 5 && fields[0] == "lib")
+                    {
+                        COFFFileReader::lib_info info;
+                        info.has_ltcg_objects = fields[4] == "1";
+                        for (const std::string& machine_type : split(fields[2], ','))
+                        {
+                            info.machine_types.push_back(static_cast<MachineType>(std::stoul(machine_type)));
+                        }
+                        if (!fields[3].empty())
+                        {
+                            info.default_libs = split(fields[3], '|');
+                        }
+                        this->libs[fields[1]] = std::move(info);
+                        return true;
+                    }
+                    if (fields.size() == 5 && fields[0] == "dll")
+                    {
+                        const COFFFileReader::dll_info info = {static_cast<MachineType>(std::stoul(fields[2])), fields[3] == "1", fields[4] == "1"};
+                        this->dlls[fields[1]] = info;
+                        return true;
+                    }
+                }
+                catch (const std::exception&)
+                {
+                }
+                return false;
+            }
+
+            fs::path file;
+            mutable std::mutex mutex;
+            std::unordered_map<std::string, COFFFileReader::lib_info> libs;
+            std::unordered_map<std::string, COFFFileReader::dll_info> dlls;
+            std::vector<std::string> lines;
+            bool changed = false;
+        };
+
+        // Binaries are parsed on a pool of threads; the checks then walk the results in the original order
+        template <class File, class Info>
+        std::vector<File> read_binaries(const std::vector<fs::path>& binaries, binary_info_cache& cache, Info (*read)(const fs::path))
+        {
+            std::vector<File> output(binaries.size());
+            Parallel::for_each_index(binaries.size(), [&](const size_t i)
+                                     {
+                                         const std::string key = binary_info_cache::get_key(binaries[i]);
+                                         Info info;
+                                         if (key.empty() || !cache.find(key, info))
+                                         {
+                                             info = read(binaries[i]);
+                                             if (!key.empty())
+                                             {
+                                                 cache.add(key, info);
+                                             }
+                                         }
+                                         output[i] = {binaries[i], info};
+                                     });
+            return output;
         }
 
-        void recursive_find_files_with_extension_in_dir(const fs::path& dir, const std::string& extension, std::vector<fs::path>* output)
+        std::vector<lib_file> read_libs(const std::vector<fs::path>& libs, binary_info_cache& cache)
         {
-            recursive_find_matching_paths_in_dir(dir, [&extension](const fs::path& current)
-                                                 {
-                                                     return !fs::is_directory(current) && current.extension() == extension;
-                                                 }, output);
+            return read_binaries<lib_file, COFFFileReader::lib_info>(libs, cache, &COFFFileReader::read_lib);
         }
 
-        std::vector<fs::path> recursive_find_files_with_extension_in_dir(const fs::path& dir, const std::string& extension)
+        std::vector<dll_file> read_dlls(const std::vector<fs::path>& dlls, binary_info_cache& cache)
         {
-            std::vector<fs::path> v;
-            recursive_find_files_with_extension_in_dir(dir, extension, &v);
-            return v;
+            return read_binaries<dll_file, COFFFileReader::dll_info>(dlls, cache, &COFFFileReader::read_dll);
         }
     }
 
@@ -74,15 +364,12 @@ namespace vcpkg
         return lint_status::SUCCESS;
     }
 
-    static lint_status check_for_files_in_debug_include_directory(const package_spec& spec, const vcpkg_paths& paths)
+    static lint_status check_for_files_in_debug_include_directory(const package_tree& tree)
     {
-        const fs::path debug_include_dir = paths.packages / spec.dir() / "debug" / "include";
-        std::vector<fs::path> files_found;
-
-        recursive_find_matching_paths_in_dir(debug_include_dir, [&](const fs::path& current)
-                                             {
-                                                 return !fs::is_directory(current) && current.extension() != ".ifc";
-                                             }, &files_found);
+        const std::vector<fs::path> files_found = tree.find_matching_paths("debug/include", [](const package_tree::entry& current)
+                                                                           {
+                                                                               return !current.is_directory && current.path.extension() != ".ifc";
+                                                                           });
 
         if (!files_found.empty())
         {
@@ -120,14 +407,13 @@ namespace vcpkg
         return lint_status::SUCCESS;
     }
 
-    static lint_status check_for_misplaced_cmake_files(const package_spec& spec, const vcpkg_paths& paths)
+    static lint_status check_for_misplaced_cmake_files(const package_spec& spec, const package_tree& tree)
     {
-        const fs::path current_packages_dir = paths.packages / spec.dir();
         std::vector<fs::path> misplaced_cmake_files;
-        recursive_find_files_with_extension_in_dir(current_packages_dir / "cmake", ".cmake", &misplaced_cmake_files);
-        recursive_find_files_with_extension_in_dir(current_packages_dir / "debug" / "cmake", ".cmake", &misplaced_cmake_files);
-        recursive_find_files_with_extension_in_dir(current_packages_dir / "lib" / "cmake", ".cmake", &misplaced_cmake_files);
-        recursive_find_files_with_extension_in_dir(current_packages_dir / "debug" / "lib" / "cmake", ".cmake", &misplaced_cmake_files);
+        tree.find_files_with_extension("cmake", ".cmake", &misplaced_cmake_files);
+        tree.find_files_with_extension("debug/cmake", ".cmake", &misplaced_cmake_files);
+        tree.find_files_with_extension("lib/cmake", ".cmake", &misplaced_cmake_files);
+        tree.find_files_with_extension("debug/lib/cmake", ".cmake", &misplaced_cmake_files);
 
         if (!misplaced_cmake_files.empty())
         {
@@ -151,11 +437,11 @@ namespace vcpkg
         return lint_status::SUCCESS;
     }
 
-    static lint_status check_for_dlls_in_lib_dirs(const package_spec& spec, const vcpkg_paths& paths)
+    static lint_status check_for_dlls_in_lib_dirs(const package_tree& tree)
     {
         std::vector<fs::path> dlls;
-        recursive_find_files_with_extension_in_dir(paths.packages / spec.dir() / "lib", ".dll", &dlls);
-        recursive_find_files_with_extension_in_dir(paths.packages / spec.dir() / "debug" / "lib", ".dll", &dlls);
+        tree.find_files_with_extension("lib", ".dll", &dlls);
+        tree.find_files_with_extension("debug/lib", ".dll", &dlls);
 
         if (!dlls.empty())
         {
@@ -216,11 +502,11 @@ namespace vcpkg
         return lint_status::ERROR_DETECTED;
     }
 
-    static lint_status check_for_exes(const package_spec& spec, const vcpkg_paths& paths)
+    static lint_status check_for_exes(const package_tree& tree)
     {
         std::vector<fs::path> exes;
-        recursive_find_files_with_extension_in_dir(paths.packages / spec.dir() / "bin", ".exe", &exes);
-        recursive_find_files_with_extension_in_dir(paths.packages / spec.dir() / "debug" / "bin", ".exe", &exes);
+        tree.find_files_with_extension("bin", ".exe", &exes);
+        tree.find_files_with_extension("debug/bin", ".exe", &exes);
 
         if (!exes.empty())
         {
@@ -232,18 +518,14 @@ namespace vcpkg
         return lint_status::SUCCESS;
     }
 
-    static lint_status check_exports_of_dlls(const std::vector<fs::path>& dlls)
+    static lint_status check_exports_of_dlls(const std::vector<dll_file>& dlls)
     {
         std::vector<fs::path> dlls_with_no_exports;
-        for (const fs::path& dll : dlls)
+        for (const dll_file& dll : dlls)
         {
-            const std::wstring cmd_line = Strings::wformat(LR"("%s" /exports "%s")", DUMPBIN_EXE.native(), dll.native());
-            System::exit_code_and_output ec_data = System::cmd_execute_and_capture_output(cmd_line);
-            Checks::check_exit(ec_data.exit_code == 0, "Running command:\n   %s\n failed", Strings::utf16_to_utf8(cmd_line));
-
-            if (ec_data.output.find("ordinal hint RVA      name") == std::string::npos)
+            if (!dll.info.has_exports)
             {
-                dlls_with_no_exports.push_back(dll);
+                dlls_with_no_exports.push_back(dll.path);
             }
         }
 
@@ -258,7 +540,7 @@ namespace vcpkg
         return lint_status::SUCCESS;
     }
 
-    static lint_status check_uwp_bit_of_dlls(const std::string& expected_system_name, const std::vector<fs::path>& dlls)
+    static lint_status check_uwp_bit_of_dlls(const std::string& expected_system_name, const std::vector<dll_file>& dlls)
     {
         if (expected_system_name != "uwp")
         {
@@ -266,15 +548,11 @@ namespace vcpkg
         }
 
         std::vector<fs::path> dlls_with_improper_uwp_bit;
-        for (const fs::path& dll : dlls)
+        for (const dll_file& dll : dlls)
         {
-            const std::wstring cmd_line = Strings::wformat(LR"("%s" /headers "%s")", DUMPBIN_EXE.native(), dll.native());
-            System::exit_code_and_output ec_data = System::cmd_execute_and_capture_output(cmd_line);
-            Checks::check_exit(ec_data.exit_code == 0, "Running command:\n   %s\n failed", Strings::utf16_to_utf8(cmd_line));
-
-            if (ec_data.output.find("App Container") == std::string::npos)
+            if (!dll.info.is_app_container)
             {
-                dlls_with_improper_uwp_bit.push_back(dll);
+                dlls_with_improper_uwp_bit.push_back(dll.path);
             }
         }
 
@@ -324,19 +602,18 @@ namespace vcpkg
         }
     }
 
-    static lint_status check_dll_architecture(const std::string& expected_architecture, const std::vector<fs::path>& files)
+    static lint_status check_dll_architecture(const std::string& expected_architecture, const std::vector<dll_file>& files)
     {
         std::vector<file_and_arch> binaries_with_invalid_architecture;
 
-        for (const fs::path& file : files)
+        for (const dll_file& file : files)
         {
-            Checks::check_exit(file.extension() == ".dll", "The file extension was not .dll: %s", file.generic_string());
-            COFFFileReader::dll_info info = COFFFileReader::read_dll(file);
-            const std::string actual_architecture = get_actual_architecture(info.machine_type);
+            Checks::check_exit(file.path.extension() == ".dll", "The file extension was not .dll: %s", file.path.generic_string());
+            const std::string actual_architecture = get_actual_architecture(file.info.machine_type);
 
             if (expected_architecture != actual_architecture)
             {
-                binaries_with_invalid_architecture.push_back({file, actual_architecture});
+                binaries_with_invalid_architecture.push_back({file.path, actual_architecture});
             }
         }
 
@@ -349,20 +626,19 @@ namespace vcpkg
         return lint_status::SUCCESS;
     }
 
-    static lint_status check_lib_architecture(const std::string& expected_architecture, const std::vector<fs::path>& files)
+    static lint_status check_lib_architecture(const std::string& expected_architecture, const std::vector<lib_file>& files)
     {
         std::vector<file_and_arch> binaries_with_invalid_architecture;
 
-        for (const fs::path& file : files)
+        for (const lib_file& file : files)
         {
-            Checks::check_exit(file.extension() == ".lib", "The file extension was not .lib: %s", file.generic_string());
-            COFFFileReader::lib_info info = COFFFileReader::read_lib(file);
-            Checks::check_exit(info.machine_types.size() == 1, "Found more than 1 architecture in file %s", file.generic_string());
+            Checks::check_exit(file.path.extension() == ".lib", "The file extension was not .lib: %s", file.path.generic_string());
+            Checks::check_exit(file.info.machine_types.size() == 1, "Found more than 1 architecture in file %s", file.path.generic_string());
 
-            const std::string actual_architecture = get_actual_architecture(info.machine_types.at(0));
+            const std::string actual_architecture = get_actual_architecture(file.info.machine_types.at(0));
             if (expected_architecture != actual_architecture)
             {
-                binaries_with_invalid_architecture.push_back({file, actual_architecture});
+                binaries_with_invalid_architecture.push_back({file.path, actual_architecture});
             }
         }
 
@@ -417,16 +693,16 @@ namespace vcpkg
         return lint_status::ERROR_DETECTED;
     }
 
-    static lint_status check_no_subdirectories(const fs::path& dir)
+    static lint_status check_no_subdirectories(const package_tree& tree, const std::string& subdir)
     {
-        const std::vector<fs::path> subdirectories = recursive_find_matching_paths_in_dir(dir, [&](const fs::path& current)
-                                                                                          {
-                                                                                              return fs::is_directory(current);
-                                                                                          });
+        const std::vector<fs::path> subdirectories = tree.find_matching_paths(subdir, [](const package_tree::entry& current)
+                                                                              {
+                                                                                  return current.is_directory;
+                                                                              });
 
         if (!subdirectories.empty())
         {
-            System::println(System::color::warning, "Directory %s should have no subdirectories", dir.generic_string());
+            System::println(System::color::warning, "Directory %s should have no subdirectories", (tree.root / subdir).generic_string());
             System::println("The following subdirectories were found: ");
             print_vector_of_files(subdirectories);
             return lint_status::ERROR_DETECTED;
@@ -466,16 +742,16 @@ namespace vcpkg
         return lint_status::ERROR_DETECTED;
     }
 
-    static lint_status check_no_empty_folders(const fs::path& dir)
+    static lint_status check_no_empty_folders(const package_tree& tree)
     {
-        const std::vector<fs::path> empty_directories = recursive_find_matching_paths_in_dir(dir, [](const fs::path& current)
-                                                                                             {
-                                                                                                 return fs::is_directory(current) && fs::is_empty(current);
-                                                                                             });
+        const std::vector<fs::path> empty_directories = tree.find_matching_paths("", [](const package_tree::entry& current)
+                                                                                 {
+                                                                                     return current.is_empty_directory;
+                                                                                 });
 
         if (!empty_directories.empty())
         {
-            System::println(System::color::warning, "There should be no empty directories in %s", dir.generic_string());
+            System::println(System::color::warning, "There should be no empty directories in %s", tree.root.generic_string());
             System::println("The following empty directories were found: ");
             print_vector_of_files(empty_directories);
             System::println(System::color::warning, "If a directory should be populated but is not, this might indicate an error in the portfile.\n"
@@ -499,13 +775,13 @@ namespace vcpkg
         std::vector<fs::path> files;
     };
 
-    static lint_status check_crt_linkage_of_libs(const BuildType& expected_build_type, const std::vector<fs::path>& libs)
+    static lint_status check_crt_linkage_of_libs(const BuildType& expected_build_type, const std::vector<lib_file>& libs)
     {
-        static const std::regex DEBUG_STATIC_CRT(R"(/DEFAULTLIB:LIBCMTD)");
-        static const std::regex DEBUG_DYNAMIC_CRT(R"(/DEFAULTLIB:MSVCRTD)");
+        static const std::string DEBUG_STATIC_CRT = "LIBCMTD";
+        static const std::string DEBUG_DYNAMIC_CRT = "MSVCRTD";
 
-        static const std::regex RELEASE_STATIC_CRT(R"(/DEFAULTLIB:LIBCMT[^D])");
-        static const std::regex RELEASE_DYNAMIC_CRT(R"(/DEFAULTLIB:MSVCRT[^D])");
+        static const std::string RELEASE_STATIC_CRT = "LIBCMT";
+        static const std::string RELEASE_DYNAMIC_CRT = "MSVCRT";
 
         lint_status output_status = lint_status::SUCCESS;
 
@@ -517,22 +793,29 @@ namespace vcpkg
         BuildInfo_and_files libs_with_release_static_crt(BuildType::RELEASE_STATIC);
         BuildInfo_and_files libs_with_release_dynamic_crt(BuildType::RELEASE_DYNAMIC);
 
-        for (const fs::path& lib : libs)
+        for (const lib_file& lib_and_info : libs)
         {
-            const std::wstring cmd_line = Strings::wformat(LR"("%s" /directives "%s")", DUMPBIN_EXE.native(), lib.native());
-            System::exit_code_and_output ec_data = System::cmd_execute_and_capture_output(cmd_line);
-            Checks::check_exit(ec_data.exit_code == 0, "Running command:\n   %s\n failed", Strings::utf16_to_utf8(cmd_line));
+            const fs::path& lib = lib_and_info.path;
+            const std::vector<std::string>& default_libs = lib_and_info.info.default_libs;
+            auto has_default_lib = [&](const std::string& name)
+            {
+                return std::binary_search(default_libs.cbegin(), default_libs.cend(), name);
+            };
 
-            bool found_debug_static_crt = std::regex_search(ec_data.output.cbegin(), ec_data.output.cend(), DEBUG_STATIC_CRT);
-            bool found_debug_dynamic_crt = std::regex_search(ec_data.output.cbegin(), ec_data.output.cend(), DEBUG_DYNAMIC_CRT);
-            bool found_release_static_crt = std::regex_search(ec_data.output.cbegin(), ec_data.output.cend(), RELEASE_STATIC_CRT);
-            bool found_release_dynamic_crt = std::regex_search(ec_data.output.cbegin(), ec_data.output.cend(), RELEASE_DYNAMIC_CRT);
+            bool found_debug_static_crt = has_default_lib(DEBUG_STATIC_CRT);
+            bool found_debug_dynamic_crt = has_default_lib(DEBUG_DYNAMIC_CRT);
+            bool found_release_static_crt = has_default_lib(RELEASE_STATIC_CRT);
+            bool found_release_dynamic_crt = has_default_lib(RELEASE_DYNAMIC_CRT);
 
             const size_t crts_found_count = found_debug_static_crt + found_debug_dynamic_crt + found_release_static_crt + found_release_dynamic_crt;
 
             if (crts_found_count == 0)
             {
-                libs_with_no_crts.push_back(lib);
+                // The directives of objects compiled with /GL are not readable, so their crt linkage is not known
+                if (!lib_and_info.info.has_ltcg_objects)
+                {
+                    libs_with_no_crts.push_back(lib);
+                }
                 continue;
             }
 
@@ -604,64 +887,64 @@ namespace vcpkg
         left += static_cast<size_t>(right);
     }
 
-    void perform_all_checks(const package_spec& spec, const vcpkg_paths& paths)
+    // The libs and DLLs of the package: their architecture, CRT linkage, exports and whether both configurations are there
+    static size_t check_binaries(const package_spec& spec, const vcpkg_paths& paths, const package_tree& tree)
     {
-        System::println("-- Performing post-build validation");
-
         BuildInfo build_info = read_build_info(paths.build_info_file_path(spec));
 
         size_t error_count = 0;
-        error_count += check_for_files_in_include_directory(spec, paths);
-        error_count += check_for_files_in_debug_include_directory(spec, paths);
-        error_count += check_for_files_in_debug_share_directory(spec, paths);
-        error_count += check_folder_lib_cmake(spec, paths);
-        error_count += check_for_misplaced_cmake_files(spec, paths);
-        error_count += check_folder_debug_lib_cmake(spec, paths);
-        error_count += check_for_dlls_in_lib_dirs(spec, paths);
-        error_count += check_for_copyright_file(spec, paths);
-        error_count += check_for_exes(spec, paths);
 
-        const std::vector<fs::path> debug_libs = recursive_find_files_with_extension_in_dir(paths.packages / spec.dir() / "debug" / "lib", ".lib");
-        const std::vector<fs::path> release_libs = recursive_find_files_with_extension_in_dir(paths.packages / spec.dir() / "lib", ".lib");
+        const std::vector<fs::path> debug_libs = tree.find_files_with_extension("debug/lib", ".lib");
+        const std::vector<fs::path> release_libs = tree.find_files_with_extension("lib", ".lib");
 
-        error_count += check_matching_debug_and_release_binaries(debug_libs, release_libs);
+        // A triplet with VCPKG_BUILD_TYPE builds only one configuration, which has nothing to match
+        const bool has_both_configurations = build_info.build_type.empty();
+        if (has_both_configurations)
+        {
+            error_count += check_matching_debug_and_release_binaries(debug_libs, release_libs);
+        }
 
         std::vector<fs::path> libs;
         libs.insert(libs.cend(), debug_libs.cbegin(), debug_libs.cend());
         libs.insert(libs.cend(), release_libs.cbegin(), release_libs.cend());
 
-        error_count += check_lib_architecture(spec.target_triplet().architecture(), libs);
+        binary_info_cache cache(paths.vcpkg_dir_lint_cache);
+        const std::vector<lib_file> lib_files = read_libs(libs, cache);
+        error_count += check_lib_architecture(spec.target_triplet().architecture(), lib_files);
 
         switch (linkage_type_value_of(build_info.library_linkage))
         {
             case LinkageType::DYNAMIC:
                 {
-                    const std::vector<fs::path> debug_dlls = recursive_find_files_with_extension_in_dir(paths.packages / spec.dir() / "debug" / "bin", ".dll");
-                    const std::vector<fs::path> release_dlls = recursive_find_files_with_extension_in_dir(paths.packages / spec.dir() / "bin", ".dll");
+                    const std::vector<fs::path> debug_dlls = tree.find_files_with_extension("debug/bin", ".dll");
+                    const std::vector<fs::path> release_dlls = tree.find_files_with_extension("bin", ".dll");
 
-                    error_count += check_matching_debug_and_release_binaries(debug_dlls, release_dlls);
+                    if (has_both_configurations)
+                    {
+                        error_count += check_matching_debug_and_release_binaries(debug_dlls, release_dlls);
+                    }
 
                     std::vector<fs::path> dlls;
                     dlls.insert(dlls.cend(), debug_dlls.cbegin(), debug_dlls.cend());
                     dlls.insert(dlls.cend(), release_dlls.cbegin(), release_dlls.cend());
 
-                    error_count += check_exports_of_dlls(dlls);
-                    error_count += check_uwp_bit_of_dlls(spec.target_triplet().system(), dlls);
-                    error_count += check_dll_architecture(spec.target_triplet().architecture(), dlls);
+                    const std::vector<dll_file> dll_files = read_dlls(dlls, cache);
+                    error_count += check_exports_of_dlls(dll_files);
+                    error_count += check_uwp_bit_of_dlls(spec.target_triplet().system(), dll_files);
+                    error_count += check_dll_architecture(spec.target_triplet().architecture(), dll_files);
                     break;
                 }
             case LinkageType::STATIC:
                 {
-                    std::vector<fs::path> dlls;
-                    recursive_find_files_with_extension_in_dir(paths.packages / spec.dir(), ".dll", &dlls);
+                    const std::vector<fs::path> dlls = tree.find_files_with_extension("", ".dll");
                     error_count += check_no_dlls_present(dlls);
 
                     error_count += check_bin_folders_are_not_present_in_static_build(spec, paths);
 
-#if 0
-                    error_count += check_crt_linkage_of_libs(BuildType::value_of(ConfigurationType::DEBUG, linkage_type_value_of(build_info.crt_linkage)), debug_libs);
-                    error_count += check_crt_linkage_of_libs(BuildType::value_of(ConfigurationType::RELEASE, linkage_type_value_of(build_info.crt_linkage)), release_libs);
-#endif
+                    const std::vector<lib_file> debug_lib_files(lib_files.cbegin(), lib_files.cbegin() + debug_libs.size());
+                    const std::vector<lib_file> release_lib_files(lib_files.cbegin() + debug_libs.size(), lib_files.cend());
+                    error_count += check_crt_linkage_of_libs(BuildType::value_of(ConfigurationType::DEBUG, linkage_type_value_of(build_info.crt_linkage)), debug_lib_files);
+                    error_count += check_crt_linkage_of_libs(BuildType::value_of(ConfigurationType::RELEASE, linkage_type_value_of(build_info.crt_linkage)), release_lib_files);
                     break;
                 }
             case LinkageType::UNKNOWN:
@@ -673,20 +956,69 @@ namespace vcpkg
             default:
                 Checks::unreachable();
         }
+        cache.save();
+        return error_count;
+    }
+
+    static lint_status check_no_binaries_present(const package_tree& tree)
+    {
+        std::vector<fs::path> binaries;
+        tree.find_files_with_extension("", ".lib", &binaries);
+        tree.find_files_with_extension("", ".dll", &binaries);
+
+        if (!binaries.empty())
+        {
+            System::println(System::color::warning, "The port is marked Header-Only, but the following binaries were found:");
+            print_vector_of_files(binaries);
+            return lint_status::ERROR_DETECTED;
+        }
+
+        return lint_status::SUCCESS;
+    }
+
+    size_t perform_all_checks(const package_spec& spec, const vcpkg_paths& paths, const bool header_only)
+    {
+        const Timings::scoped_timer timer("perform_all_checks");
+        System::println("-- Performing post-build validation");
+
+        const package_tree tree(paths.packages / spec.dir());
+
+        size_t error_count = 0;
+        error_count += check_for_files_in_include_directory(spec, paths);
+        error_count += check_for_files_in_debug_include_directory(tree);
+        error_count += check_for_files_in_debug_share_directory(spec, paths);
+        error_count += check_folder_lib_cmake(spec, paths);
+        error_count += check_for_misplaced_cmake_files(spec, tree);
+        error_count += check_folder_debug_lib_cmake(spec, paths);
+        error_count += check_for_dlls_in_lib_dirs(tree);
+        error_count += check_for_copyright_file(spec, paths);
+        error_count += check_for_exes(tree);
+
+        // Nothing of a header-only port was compiled, and its build info is never looked at
+        if (header_only)
+        {
+            error_count += check_no_binaries_present(tree);
+        }
+        else
+        {
+            error_count += check_binaries(spec, paths, tree);
+        }
+
 #if 0
-        error_count += check_no_subdirectories(paths.packages / spec.dir() / "lib");
-        error_count += check_no_subdirectories(paths.packages / spec.dir() / "debug" / "lib");
+        error_count += check_no_subdirectories(tree, "lib");
+        error_count += check_no_subdirectories(tree, "debug/lib");
 #endif
 
-        error_count += check_no_empty_folders(paths.packages / spec.dir());
+        error_count += check_no_empty_folders(tree);
 
         if (error_count != 0)
         {
             const fs::path portfile = paths.ports / spec.name() / "portfile.cmake";
             System::println(System::color::error, "Found %u error(s). Please correct the portfile:\n    %s", error_count, portfile.string());
-            exit(EXIT_FAILURE);
+            return error_count;
         }
 
         System::println("-- Performing post-build validation done");
+        return error_count;
     }
 }
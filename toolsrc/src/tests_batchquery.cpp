@@ -0,0 +1,61 @@
+#include "CppUnitTest.h"
+#include "BatchQuery.h"
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    TEST_CLASS(BatchQueryTests)
+    {
+    public:
+        TEST_METHOD(split_query_at_spaces_and_tabs)
+        {
+            const std::vector<std::string> words = BatchQuery::split_query("  owns\tzlib.h   --suffix\r");
+            Assert::AreEqual(size_t(3), words.size());
+            Assert::AreEqual(std::string("owns"), words[0]);
+            Assert::AreEqual(std::string("zlib.h"), words[1]);
+            Assert::AreEqual(std::string("--suffix"), words[2]);
+            Assert::IsTrue(BatchQuery::split_query(" \t ").empty());
+        }
+
+        TEST_METHOD(split_query_quotes_group_words)
+        {
+            const std::vector<std::string> words = BatchQuery::split_query(R"(owns "C:/Program Files/x86 include/zlib.h" search"ing" "")");
+            Assert::AreEqual(size_t(4), words.size());
+            Assert::AreEqual(std::string("owns"), words[0]);
+            Assert::AreEqual(std::string("C:/Program Files/x86 include/zlib.h"), words[1]);
+            Assert::AreEqual(std::string("searching"), words[2]);
+            Assert::AreEqual(std::string(), words[3]);
+        }
+
+        TEST_METHOD(find_invalid_option)
+        {
+            Assert::AreEqual(std::string(), BatchQuery::find_invalid_option({"owns", "zlib.h", "--exact"}));
+            Assert::AreEqual(std::string(), BatchQuery::find_invalid_option({"owns", "--suffix", "zlib.h"}));
+            Assert::AreEqual(std::string("--recurse"), BatchQuery::find_invalid_option({"owns", "zlib.h", "--recurse"}));
+            Assert::AreEqual(std::string("--exact"), BatchQuery::find_invalid_option({"search", "zlib", "--exact"}));
+            Assert::AreEqual(std::string(), BatchQuery::find_invalid_option({"list", "-x86"}));
+            Assert::AreEqual(std::string(), BatchQuery::find_invalid_option({}));
+        }
+
+        TEST_METHOD(format_result_counts_lines)
+        {
+            Assert::AreEqual(std::string("ok 0\n"), BatchQuery::format_result("ok", ""));
+            Assert::AreEqual(std::string("ok 2\nzlib:x86-windows\nzlib:x64-windows\n"),
+                             BatchQuery::format_result("ok", "zlib:x86-windows\nzlib:x64-windows\n"));
+            Assert::AreEqual(std::string("error 1\nfoo is not a query\n"), BatchQuery::format_result("error", "foo is not a query\n"));
+        }
+
+        TEST_METHOD(format_result_terminates_last_line)
+        {
+            Assert::AreEqual(std::string("ok 2\nzlib:x86-windows\nzlib:x64-windows\n"),
+                             BatchQuery::format_result("ok", "zlib:x86-windows\nzlib:x64-windows"));
+            Assert::AreEqual(std::string("error 1\nfailed\n"), BatchQuery::format_result("error", "failed"));
+        }
+    };
+}
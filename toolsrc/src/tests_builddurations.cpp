@@ -0,0 +1,46 @@
+#include "CppUnitTest.h"
+#include "BuildDurations.h"
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    TEST_CLASS(BuildDurationsTests)
+    {
+    public:
+        // 0 -> 1 -> 3 and 0 -> 2: the chain through 1 is the long one
+        TEST_METHOD(critical_paths_follow_longest_chain)
+        {
+            const std::vector<long long> durations = {10, 50, 20, 30};
+            const std::vector<std::vector<size_t>> dependents = {{1, 2}, {3}, {}, {}};
+            auto v = BuildDurations::critical_paths(durations, dependents);
+            Assert::AreEqual(size_t(4), v.size());
+            Assert::AreEqual(90LL, v[0]);
+            Assert::AreEqual(80LL, v[1]);
+            Assert::AreEqual(20LL, v[2]);
+            Assert::AreEqual(30LL, v[3]);
+        }
+
+        TEST_METHOD(makespan_starts_critical_path_first)
+        {
+            // Plan order would start the short leaves 0 and 1 before 2, which 3 waits for
+            const std::vector<long long> durations = {10, 10, 40, 40};
+            const std::vector<std::vector<size_t>> dependents = {{}, {}, {3}, {}};
+            Assert::AreEqual(80LL, BuildDurations::estimate_makespan(durations, dependents, 2));
+            Assert::AreEqual(100LL, BuildDurations::estimate_makespan(durations, dependents, 1));
+            Assert::AreEqual(80LL, BuildDurations::estimate_makespan(durations, dependents, 8));
+        }
+
+        TEST_METHOD(format_duration)
+        {
+            Assert::AreEqual("3s", BuildDurations::format_duration(3400).c_str());
+            Assert::AreEqual("2m 03s", BuildDurations::format_duration(123000).c_str());
+            Assert::AreEqual("1h 02m 03s", BuildDurations::format_duration(3723000).c_str());
+        }
+    };
+}
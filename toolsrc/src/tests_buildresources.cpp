@@ -0,0 +1,24 @@
+#include "CppUnitTest.h"
+#include "BuildResources.h"
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    TEST_CLASS(BuildResourcesTests)
+    {
+    public:
+        TEST_METHOD(format_bytes)
+        {
+            Assert::AreEqual("512 B", BuildResources::format_bytes(512).c_str());
+            Assert::AreEqual("1.5 KiB", BuildResources::format_bytes(1536).c_str());
+            Assert::AreEqual("20.0 MiB", BuildResources::format_bytes(20ULL * 1024 * 1024).c_str());
+            Assert::AreEqual("3.0 GiB", BuildResources::format_bytes(3ULL * 1024 * 1024 * 1024).c_str());
+        }
+    };
+}
@@ -0,0 +1,63 @@
+#include "CppUnitTest.h"
+#include "CompilerCache.h"
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    TEST_CLASS(CompilerCacheTests)
+    {
+    public:
+        TEST_METHOD(parse_clcache_stats)
+        {
+            const auto stats = CompilerCache::parse_stats("clcache statistics:\r\n"
+                                                          "  current cache dir         : C:\\vcpkg\\downloads\\compiler-cache\r\n"
+                                                          "  cache entries             : 12\r\n"
+                                                          "  cache hits                : 40\r\n"
+                                                          "  cache misses\r\n"
+                                                          "    total                      : 10\r\n"
+                                                          "    evicted                    : 0\r\n");
+            Assert::IsTrue(stats.measured);
+            Assert::AreEqual(40LL, stats.hits);
+            Assert::AreEqual(10LL, stats.misses);
+        }
+
+        TEST_METHOD(parse_sccache_stats)
+        {
+            const auto stats = CompilerCache::parse_stats("Compile requests                     50\n"
+                                                          "Cache hits                           30\n"
+                                                          "Cache hits (C/C++)                   30\n"
+                                                          "Cache misses                         20\n"
+                                                          "Cache hits rate                  60.00 %\n");
+            Assert::IsTrue(stats.measured);
+            Assert::AreEqual(30LL, stats.hits);
+            Assert::AreEqual(20LL, stats.misses);
+        }
+
+        TEST_METHOD(parse_ccache_stats)
+        {
+            const auto stats = CompilerCache::parse_stats("cache hit (direct)                     5\n"
+                                                          "cache hit (preprocessed)               2\n"
+                                                          "cache miss                             3\n"
+                                                          "cache hit rate                     70.00 %\n");
+            Assert::AreEqual(7LL, stats.hits);
+            Assert::AreEqual(3LL, stats.misses);
+            Assert::IsFalse(CompilerCache::parse_stats("clcache: unknown option").measured);
+        }
+
+        TEST_METHOD(parse_stats_ignores_malformed_counters)
+        {
+            // Too large for a long long, and a non-ASCII superscript two after the digits
+            const auto stats = CompilerCache::parse_stats("Cache hits                           99999999999999999999\n"
+                                                          "Cache hits                           3\xb2\n"
+                                                          "Cache misses                         4\n");
+            Assert::AreEqual(0LL, stats.hits);
+            Assert::AreEqual(4LL, stats.misses);
+        }
+    };
+}
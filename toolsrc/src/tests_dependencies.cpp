@@ -1,6 +1,9 @@
 #include "CppUnitTest.h"
 #include "SourceParagraph.h"
+#include "BinaryParagraph.h"
 #include "triplet.h"
+#include "vcpkg_Graphs.h"
+#include <sstream>
 
 #pragma comment(lib,"version")
 #pragma comment(lib,"winhttp")
@@ -35,5 +38,66 @@ namespace UnitTest1
             Assert::AreEqual("libB", v2[0].c_str());
             Assert::AreEqual("libC", v2[1].c_str());
         }
+
+        TEST_METHOD(header_only_carries_into_binary_paragraph)
+        {
+            const SourceParagraph spgh({{"Source", "libA"}, {"Version", "1.0"}, {"Header-Only", "yes"}});
+            Assert::IsTrue(spgh.header_only);
+            Assert::IsFalse(SourceParagraph({{"Source", "libB"}, {"Version", "1.0"}}).header_only);
+
+            const BinaryParagraph bpgh(spgh, triplet::X86_WINDOWS);
+            Assert::IsTrue(bpgh.header_only);
+
+            std::ostringstream os;
+            os << bpgh;
+            Assert::AreNotEqual(std::string::npos, os.str().find("Header-Only: yes\n"));
+        }
+    };
+
+    TEST_CLASS(GraphTests)
+    {
+    public:
+        TEST_METHOD(topological_sort_is_deterministic)
+        {
+            Graphs::Graph<int> graph;
+            graph.add_vertex(5);
+            graph.add_edge(1, 2);
+            graph.add_edge(1, 3);
+            graph.add_edge(3, 2);
+            graph.add_edge(4, 1);
+            const std::vector<int> expected = {5, 2, 3, 1, 4};
+            Assert::IsTrue(expected == graph.find_topological_sort());
+        }
+
+        TEST_METHOD(topological_sort_of_deep_chain)
+        {
+            Graphs::Graph<int> graph;
+            for (int i = 0; i < 100000; ++i)
+            {
+                graph.add_edge(i, i + 1);
+            }
+            const std::vector<int> sorted = graph.find_topological_sort();
+            Assert::AreEqual(size_t(100001), sorted.size());
+            Assert::AreEqual(100000, sorted.front());
+            Assert::AreEqual(0, sorted.back());
+        }
+
+        TEST_METHOD(topological_sort_reports_cycle)
+        {
+            Graphs::Graph<int> graph;
+            graph.add_edge(0, 1);
+            graph.add_edge(1, 2);
+            graph.add_edge(2, 3);
+            graph.add_edge(3, 1);
+            try
+            {
+                graph.find_topological_sort();
+                Assert::Fail();
+            }
+            catch (const std::runtime_error& e)
+            {
+                Assert::AreEqual("cycle in graph: 1 -> 2 -> 3 -> 1", e.what());
+            }
+        }
     };
 }
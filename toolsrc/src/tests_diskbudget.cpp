@@ -0,0 +1,45 @@
+#include "CppUnitTest.h"
+#include "DiskBudget.h"
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    TEST_CLASS(DiskBudgetTests)
+    {
+    public:
+        TEST_METHOD(parse_size)
+        {
+            uintmax_t bytes = 0;
+            Assert::IsTrue(DiskBudget::parse_size("512", bytes));
+            Assert::AreEqual(uintmax_t(512), bytes);
+            Assert::IsTrue(DiskBudget::parse_size("20G", bytes));
+            Assert::AreEqual(uintmax_t(20) * 1024 * 1024 * 1024, bytes);
+            Assert::IsTrue(DiskBudget::parse_size("1.5mb", bytes));
+            Assert::AreEqual(uintmax_t(3) * 512 * 1024, bytes);
+            Assert::IsFalse(DiskBudget::parse_size("20X", bytes));
+            Assert::IsFalse(DiskBudget::parse_size("G", bytes));
+        }
+
+        TEST_METHOD(select_evictions_least_recently_used_first)
+        {
+            std::vector<DiskBudget::entry> entries(4);
+            entries[0].size = 40; entries[0].last_access = 3;
+            entries[1].size = 30; entries[1].last_access = 1; entries[1].is_protected = true;
+            entries[2].size = 20; entries[2].last_access = 2;
+            entries[3].size = 10; entries[3].last_access = 4;
+
+            const std::vector<size_t> evictions = DiskBudget::select_evictions(entries, 50);
+            Assert::AreEqual(size_t(2), evictions.size());
+            Assert::AreEqual(size_t(2), evictions[0]);
+            Assert::AreEqual(size_t(0), evictions[1]);
+
+            Assert::IsTrue(DiskBudget::select_evictions(entries, 100).empty());
+        }
+    };
+}
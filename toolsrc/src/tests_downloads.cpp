@@ -0,0 +1,95 @@
+#include "CppUnitTest.h"
+#include "vcpkg_Downloads.h"
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    TEST_CLASS(PortfileParsing)
+    {
+    public:
+        TEST_METHOD(parse_cmake_commands_quoted_arguments_and_comments)
+        {
+            const std::vector<Downloads::cmake_command> commands = Downloads::parse_cmake_commands(
+                "# a comment (with parentheses)\n"
+                "SET(VERSION \"1.2.8\") # a trailing comment\n"
+                "#[[ a bracket comment\n"
+                "message(ignored) ]]\n"
+                "message(STATUS \"quoted \\\"argument\\\" with spaces\" unquoted)\n");
+
+            Assert::AreEqual(size_t(2), commands.size());
+            Assert::AreEqual(std::string("set"), commands[0].name);
+            Assert::AreEqual(size_t(2), commands[0].arguments.size());
+            Assert::AreEqual(std::string("VERSION"), commands[0].arguments[0]);
+            Assert::AreEqual(std::string("1.2.8"), commands[0].arguments[1]);
+            Assert::AreEqual(std::string("message"), commands[1].name);
+            Assert::AreEqual(size_t(3), commands[1].arguments.size());
+            Assert::AreEqual(std::string("STATUS"), commands[1].arguments[0]);
+            Assert::AreEqual(std::string("quoted \"argument\" with spaces"), commands[1].arguments[1]);
+            Assert::AreEqual(std::string("unquoted"), commands[1].arguments[2]);
+        }
+
+        TEST_METHOD(parse_cmake_commands_bracket_arguments)
+        {
+            const std::vector<Downloads::cmake_command> commands = Downloads::parse_cmake_commands(
+                "file(WRITE out.txt [[\n"
+                "first line\n"
+                "]] [=[contains ]] and \"quotes\"]=])\n");
+
+            Assert::AreEqual(size_t(1), commands.size());
+            Assert::AreEqual(std::string("file"), commands[0].name);
+            Assert::AreEqual(size_t(4), commands[0].arguments.size());
+            Assert::AreEqual(std::string("out.txt"), commands[0].arguments[1]);
+            Assert::AreEqual(std::string("first line\n"), commands[0].arguments[2]);
+            Assert::AreEqual(std::string("contains ]] and \"quotes\""), commands[0].arguments[3]);
+        }
+
+        TEST_METHOD(parse_distfiles_multiple_urls)
+        {
+            const std::vector<Downloads::distfile> files = Downloads::parse_distfiles(
+                "set(VERSION 1.2.8)\n"
+                "vcpkg_download_distfile(ARCHIVE\n"
+                "    URLS \"http://zlib.net/zlib-${VERSION}.tar.gz\" \"https://mirror.example/zlib-${VERSION}.tar.gz\"\n"
+                "    FILENAME \"zlib-${VERSION}.tar.gz\"\n"
+                "    SHA512 [[0123abcd]]\n"
+                ")\n");
+
+            Assert::AreEqual(size_t(1), files.size());
+            Assert::AreEqual(size_t(2), files[0].urls.size());
+            Assert::AreEqual(std::string("http://zlib.net/zlib-1.2.8.tar.gz"), files[0].urls[0]);
+            Assert::AreEqual(std::string("https://mirror.example/zlib-1.2.8.tar.gz"), files[0].urls[1]);
+            Assert::AreEqual(std::string("zlib-1.2.8.tar.gz"), files[0].filename);
+            Assert::AreEqual(std::string("0123abcd"), files[0].sha512);
+        }
+
+        TEST_METHOD(parse_distfiles_skips_unresolved_variables)
+        {
+            const std::vector<Downloads::distfile> files = Downloads::parse_distfiles(
+                "set(ARCHIVE_NAME ${SOURCE_VERSION}.zip)\n"
+                "vcpkg_download_distfile(ARCHIVE URLS \"https://example.com/${SOURCE_VERSION}.zip\" FILENAME a.zip SHA512 01)\n"
+                "vcpkg_download_distfile(ARCHIVE URLS https://example.com/b.zip FILENAME ${ARCHIVE_NAME} SHA512 02)\n"
+                "vcpkg_download_distfile(ARCHIVE URLS https://example.com/c.zip FILENAME c.zip SHA512 03)\n");
+
+            Assert::AreEqual(size_t(1), files.size());
+            Assert::AreEqual(std::string("c.zip"), files[0].filename);
+            Assert::AreEqual(std::string("03"), files[0].sha512);
+        }
+
+        TEST_METHOD(parse_distfiles_skips_commented_and_incomplete_calls)
+        {
+            const std::vector<Downloads::distfile> files = Downloads::parse_distfiles(
+                "# vcpkg_download_distfile(ARCHIVE URLS https://example.com/a.zip FILENAME a.zip SHA512 01)\n"
+                "#[=[\n"
+                "vcpkg_download_distfile(ARCHIVE URLS https://example.com/b.zip FILENAME b.zip SHA512 02)\n"
+                "]=]\n"
+                "vcpkg_download_distfile(ARCHIVE URLS https://example.com/c.zip FILENAME c.zip)\n");
+
+            Assert::AreEqual(size_t(0), files.size());
+        }
+    };
+}
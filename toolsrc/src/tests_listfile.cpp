@@ -0,0 +1,91 @@
+#include "CppUnitTest.h"
+#include "Listfile.h"
+#include <fstream>
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    TEST_CLASS(ListfileTests)
+    {
+    public:
+        TEST_METHOD_INITIALIZE(create_directory)
+        {
+            root = fs::temp_directory_path() / "vcpkg-tests-listfile";
+            std::error_code ec;
+            fs::remove_all(root, ec);
+            fs::create_directories(root, ec);
+            listfile = root / "zlib_1.2.8_x86-windows.list";
+        }
+
+        TEST_METHOD_CLEANUP(remove_directory)
+        {
+            std::error_code ec;
+            fs::remove_all(root, ec);
+        }
+
+        TEST_METHOD(compact_listfile_round_trip)
+        {
+            const std::vector<Listfile::listed_entry> entries = {
+                {"x86-windows/", Listfile::entry_type::directory},
+                {"x86-windows/include", Listfile::entry_type::directory},
+                {"x86-windows/include/zconf.h", Listfile::entry_type::file},
+                {"x86-windows/include/zlib.h", Listfile::entry_type::file},
+                {"x86-windows/share/zlib/copyright", Listfile::entry_type::file},
+            };
+            Assert::IsTrue(Listfile::write(listfile, entries));
+
+            std::vector<Listfile::listed_entry> read;
+            Assert::IsTrue(Listfile::for_each_entry(listfile, [&](const std::string& path, Listfile::entry_type type) { read.push_back({path, type}); }));
+
+            Assert::AreEqual(entries.size(), read.size());
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                Assert::AreEqual(entries[i].path.c_str(), read[i].path.c_str());
+                Assert::IsTrue(entries[i].type == read[i].type);
+            }
+        }
+
+        TEST_METHOD(text_listfile_with_crlf)
+        {
+            std::ofstream(listfile, std::ios_base::binary | std::ios_base::trunc) << "x86-windows/\r\nx86-windows/include\r\n\r\nx86-windows/include/zlib.h";
+
+            std::vector<std::string> read;
+            Assert::IsTrue(Listfile::for_each_entry(listfile, [&](const std::string& path, Listfile::entry_type type)
+                {
+                    Assert::IsTrue(type == Listfile::entry_type::unknown);
+                    read.push_back(path);
+                }));
+
+            Assert::AreEqual(size_t(3), read.size());
+            Assert::AreEqual("x86-windows/", read[0].c_str());
+            Assert::AreEqual("x86-windows/include", read[1].c_str());
+            Assert::AreEqual("x86-windows/include/zlib.h", read[2].c_str());
+        }
+
+        TEST_METHOD(truncated_compact_listfile_fails)
+        {
+            Assert::IsTrue(Listfile::write(listfile, {{"x86-windows/", Listfile::entry_type::directory}, {"x86-windows/include/zlib.h", Listfile::entry_type::file}}));
+
+            std::string bytes;
+            {
+                std::ifstream in(listfile, std::ios_base::binary);
+                bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            }
+            std::ofstream(listfile, std::ios_base::binary | std::ios_base::trunc) << bytes.substr(0, bytes.size() - 1);
+
+            size_t calls = 0;
+            Assert::IsFalse(Listfile::for_each_entry(listfile, [&](const std::string&, Listfile::entry_type) { ++calls; }));
+            Assert::AreEqual(size_t(1), calls);
+        }
+
+    private:
+        fs::path root;
+        fs::path listfile;
+    };
+}
@@ -0,0 +1,139 @@
+#include "CppUnitTest.h"
+#include "PackageArchive.h"
+#include <fstream>
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    static void write_file(const fs::path& file, const std::string& contents)
+    {
+        std::ofstream(file, std::ios_base::binary | std::ios_base::trunc).write(contents.data(), contents.size());
+    }
+
+    static std::string read_whole_file(const fs::path& file)
+    {
+        std::ifstream in(file, std::ios_base::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    TEST_CLASS(PackageArchiveTests)
+    {
+    public:
+        TEST_METHOD_INITIALIZE(create_package)
+        {
+            root = fs::temp_directory_path() / "vcpkg-tests-packagearchive";
+            std::error_code ec;
+            fs::remove_all(root, ec);
+            fs::create_directories(root / "zlib_x86-windows" / "include", ec);
+            fs::create_directories(root / "zlib_x86-windows" / "share" / "zlib", ec);
+
+            header.clear();
+            for (int i = 0; i < 200; ++i)
+            {
+                header += "#define ZLIB_CONSTANT_" + std::to_string(i) + " " + std::to_string(i * 3) + "\n";
+            }
+            write_file(root / "zlib_x86-windows" / "CONTROL", "Package: zlib\nVersion: 1.2.8\nArchitecture: x86-windows\n");
+            write_file(root / "zlib_x86-windows" / "include" / "zlib.h", header);
+            write_file(root / "zlib_x86-windows" / "share" / "zlib" / "copyright", std::string());
+            archive = root / "zlib_x86-windows.pack";
+        }
+
+        TEST_METHOD_CLEANUP(remove_package)
+        {
+            std::error_code ec;
+            fs::remove_all(root, ec);
+        }
+
+        TEST_METHOD(pack_then_read_every_file)
+        {
+            Assert::IsTrue(PackageArchive::pack(root / "zlib_x86-windows", archive));
+
+            const expected<PackageArchive::reader> opened = PackageArchive::reader::open(archive);
+            const PackageArchive::reader* r = opened.get();
+            Assert::IsNotNull(r);
+            Assert::AreEqual(size_t(6), r->entries().size());
+
+            // Directories come before their contents
+            for (size_t i = 0; i < r->entries().size(); ++i)
+            {
+                const PackageArchive::entry& e = r->entries()[i];
+                const size_t separator = e.path.rfind('/');
+                if (separator == std::string::npos)
+                    continue;
+                const std::string parent = e.path.substr(0, separator);
+                bool parent_before = false;
+                for (size_t j = 0; j < i; ++j)
+                {
+                    parent_before |= r->entries()[j].is_directory && r->entries()[j].path == parent;
+                }
+                Assert::IsTrue(parent_before);
+            }
+
+            const PackageArchive::entry* e = r->find("include/zlib.h");
+            Assert::IsNotNull(e);
+            Assert::AreEqual(1, static_cast<int>(e->method));
+            std::string contents;
+            Assert::IsTrue(r->read(*e, contents));
+            Assert::IsTrue(header == contents);
+
+            e = r->find("share/zlib/copyright");
+            Assert::IsNotNull(e);
+            Assert::AreEqual(0, static_cast<int>(e->method));
+            Assert::IsTrue(r->read(*e, contents));
+            Assert::IsTrue(contents.empty());
+
+            Assert::IsNull(r->find("include"));
+            Assert::IsNull(r->find("lib/zlib.lib"));
+
+            const expected<std::string> control = PackageArchive::read_file(archive, "CONTROL");
+            Assert::IsNotNull(control.get());
+            Assert::AreEqual("Package: zlib\nVersion: 1.2.8\nArchitecture: x86-windows\n", control.get()->c_str());
+        }
+
+        TEST_METHOD(corrupt_file_fails_its_checksum)
+        {
+            Assert::IsTrue(PackageArchive::pack(root / "zlib_x86-windows", archive));
+            std::string bytes = read_whole_file(archive);
+
+            // The data of the files comes first, so the first byte belongs to a file that is not empty
+            bytes[0] ^= 0x20;
+            write_file(archive, bytes);
+
+            const expected<PackageArchive::reader> opened = PackageArchive::reader::open(archive);
+            const PackageArchive::reader* r = opened.get();
+            Assert::IsNotNull(r);
+            size_t failures = 0;
+            for (const PackageArchive::entry& e : r->entries())
+            {
+                std::string contents;
+                if (!e.is_directory && !r->read(e, contents))
+                    ++failures;
+            }
+            Assert::AreEqual(size_t(1), failures);
+        }
+
+        TEST_METHOD(truncated_archive_does_not_open)
+        {
+            Assert::IsTrue(PackageArchive::pack(root / "zlib_x86-windows", archive));
+            const std::string bytes = read_whole_file(archive);
+
+            for (const size_t size : {bytes.size() - 1, bytes.size() / 2, size_t(0)})
+            {
+                write_file(archive, bytes.substr(0, size));
+                Assert::IsNull(PackageArchive::reader::open(archive).get());
+                Assert::IsNull(PackageArchive::read_file(archive, "CONTROL").get());
+            }
+        }
+
+    private:
+        fs::path root;
+        fs::path archive;
+        std::string header;
+    };
+}
@@ -0,0 +1,35 @@
+#include "CppUnitTest.h"
+#include "package_spec.h"
+#include "triplet.h"
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    TEST_CLASS(PackageSpecTests)
+    {
+    public:
+        TEST_METHOD(interned_specs_compare_equal)
+        {
+            const package_spec a = package_spec::from_string("zlib:X64-Windows", triplet::X86_WINDOWS).get_or_throw();
+            const package_spec b = package_spec::from_name_and_triplet("zlib", triplet::X64_WINDOWS).get_or_throw();
+            Assert::IsTrue(a == b);
+            Assert::AreEqual(std::hash<package_spec>()(a), std::hash<package_spec>()(b));
+            Assert::AreEqual("zlib:x64-windows", to_string(a).c_str());
+            Assert::AreEqual("zlib_x64-windows", a.dir().c_str());
+            Assert::IsFalse(a == package_spec::from_name_and_triplet("zlib", triplet::X86_WINDOWS).get_or_throw());
+        }
+
+        TEST_METHOD(triplet_components)
+        {
+            Assert::AreEqual("x64", triplet::X64_UWP.architecture().c_str());
+            Assert::AreEqual("uwp", triplet::X64_UWP.system().c_str());
+            Assert::IsTrue(triplet::from_canonical_name("ARM-UWP") == triplet::ARM_UWP);
+        }
+    };
+}
@@ -1,6 +1,9 @@
 #include "CppUnitTest.h"
 #include "Paragraphs.h"
 #include "BinaryParagraph.h"
+#include "vcpkg_Gzip.h"
+#include "vcpkg_Hash.h"
+#include "PortsIndex.h"
 
 #pragma comment(lib,"version")
 #pragma comment(lib,"winhttp")
@@ -267,6 +270,40 @@ namespace UnitTest1
             Assert::AreEqual("v4", pghs[1]["f4"].c_str());
         }
 
+        TEST_METHOD(parse_paragraph_views_multiline_crlf_fields)
+        {
+            const char* str =
+                "f1: simple\r\n"
+                " f1\r\n"
+                "f2: v2\r\n"
+                "\r\n"
+                "f3: v3";
+            const vcpkg::Paragraphs::parsed_paragraphs pghs = vcpkg::Paragraphs::parse_paragraph_views(str);
+            Assert::AreEqual(size_t(2), pghs.size());
+            Assert::AreEqual("simple\n f1", pghs[0].find("f1")->to_string().c_str());
+            Assert::AreEqual("v2", pghs[0].find("f2")->to_string().c_str());
+            Assert::IsTrue(pghs[0].find("f3") == nullptr);
+            Assert::AreEqual("v3", pghs[1].find("f3")->to_string().c_str());
+        }
+
+        TEST_METHOD(BinaryParagraph_construct_from_view)
+        {
+            const vcpkg::Paragraphs::parsed_paragraphs pghs = vcpkg::Paragraphs::parse_paragraph_views(
+                "Package: zlib\n"
+                "Version: 1.2.8\n"
+                "Depends: a, b\n"
+                "Architecture: x86-windows\n"
+                "Multi-Arch: same\n");
+            Assert::AreEqual(size_t(1), pghs.size());
+
+            vcpkg::BinaryParagraph pgh(pghs[0]);
+            Assert::AreEqual("zlib", pgh.spec.name().c_str());
+            Assert::AreEqual("1.2.8", pgh.version.c_str());
+            Assert::AreEqual("x86-windows", pgh.spec.target_triplet().canonical_name().c_str());
+            Assert::AreEqual(size_t(2), pgh.depends.size());
+            Assert::AreEqual("b", pgh.depends[1].c_str());
+        }
+
         TEST_METHOD(BinaryParagraph_serialize_min)
         {
             std::stringstream ss;
@@ -361,7 +398,212 @@ namespace UnitTest1
         }
     };
 
+    TEST_CLASS(StringsTests)
+    {
+    public:
+        TEST_METHOD(case_insensitive_ascii_find_ignores_case)
+        {
+            const std::string s = "x86-windows/include/ZLIB.h";
+            Assert::IsTrue(vcpkg::Strings::case_insensitive_ascii_find(s, "zlib") == s.begin() + 20);
+            Assert::IsTrue(vcpkg::Strings::case_insensitive_ascii_find(s, "Include/z") == s.begin() + 12);
+            Assert::IsTrue(vcpkg::Strings::case_insensitive_ascii_find(s, "zlib.hpp") == s.end());
+        }
+
+        TEST_METHOD(case_insensitive_ascii_searcher_checks_every_candidate)
+        {
+            // Longer than a vector of candidates, with a partial match straddling its end
+            const vcpkg::Strings::case_insensitive_ascii_searcher searcher("Debug/bin");
+            Assert::IsTrue(searcher.is_found_in("x64-windows/debug/lib/x64-windows/DEBUG/BIN/zlibd1.dll"));
+            Assert::IsFalse(searcher.is_found_in("x64-windows/debug/lib/x64-windows/debug/bi"));
+            Assert::IsTrue(vcpkg::Strings::case_insensitive_ascii_searcher("").is_found_in(""));
+        }
+
+        TEST_METHOD(case_insensitive_ascii_equals)
+        {
+            Assert::IsTrue(vcpkg::Strings::case_insensitive_ascii_equals("Control", "CONTROL"));
+            Assert::IsFalse(vcpkg::Strings::case_insensitive_ascii_equals("CONTROLS", "CONTROL"));
+        }
+    };
+
     TEST_CLASS(Metrics)
     {
     };
+
+    TEST_CLASS(SearchIndexTests)
+    {
+    public:
+        static vcpkg::PortsIndex::search_index make_index()
+        {
+            std::vector<vcpkg::SourceParagraph> ports;
+            ports.emplace_back(std::unordered_map<std::string, std::string>{{"Source", "zlib"}, {"Version", "1.2.8"}, {"Description", "A compression library"}});
+            ports.emplace_back(std::unordered_map<std::string, std::string>{{"Source", "libpng"}, {"Version", "1.6.24"}, {"Description", "PNG reference library, uses zlib"}});
+            ports.emplace_back(std::unordered_map<std::string, std::string>{{"Source", "png-tools"}, {"Version", "1"}, {"Description", "Utilities"}});
+            ports.emplace_back(std::unordered_map<std::string, std::string>{{"Source", "curl"}, {"Version", "7.51.0"}, {"Description", "A library for transferring data with URLs"}});
+            return vcpkg::PortsIndex::search_index(std::move(ports));
+        }
+
+        static std::string names(const std::vector<const vcpkg::SourceParagraph*>& found)
+        {
+            std::string out;
+            for (const vcpkg::SourceParagraph* pgh : found)
+            {
+                out += pgh->name + " ";
+            }
+            return out;
+        }
+
+        TEST_METHOD(names_rank_above_descriptions)
+        {
+            const auto index = make_index();
+            Assert::AreEqual("zlib libpng ", names(index.search({"ZLIB"})).c_str());
+            Assert::AreEqual("png-tools libpng ", names(index.search({"png"})).c_str());
+        }
+
+        TEST_METHOD(words_match_by_prefix)
+        {
+            const auto index = make_index();
+            Assert::AreEqual("curl ", names(index.search({"transfer"})).c_str());
+            Assert::AreEqual("", names(index.search({"ransfer"})).c_str());
+        }
+
+        TEST_METHOD(every_term_must_match)
+        {
+            const auto index = make_index();
+            Assert::AreEqual("curl libpng zlib ", names(index.search({"library"})).c_str());
+            Assert::AreEqual("zlib ", names(index.search({"compression", "library"})).c_str());
+        }
+    };
+
+    TEST_CLASS(HashTests)
+    {
+    public:
+        TEST_METHOD(xxh64_reference_values)
+        {
+            Assert::AreEqual("ef46db3751d8e999", vcpkg::Hash::get_string_xxh64("").c_str());
+            Assert::AreEqual("44bc2cf5ad770999", vcpkg::Hash::get_string_xxh64("abc").c_str());
+            // Longer than one 32-byte stripe
+            Assert::AreEqual("fbcea83c8a378bf1", vcpkg::Hash::get_string_xxh64("Nobody inspects the spammish repetition").c_str());
+        }
+    };
+
+    TEST_CLASS(GzipTests)
+    {
+    public:
+        TEST_METHOD(crc32_check_value)
+        {
+            Assert::AreEqual(uint32_t(0xCBF43926), vcpkg::Gzip::crc32("123456789"));
+        }
+
+        TEST_METHOD(compress_frames_the_data)
+        {
+            const std::string data = "vcpkg";
+            const std::string gz = vcpkg::Gzip::compress(data);
+            Assert::IsTrue(gz.size() > 18);
+            Assert::AreEqual('\x1f', gz[0]);
+            Assert::AreEqual('\x8b', gz[1]);
+            Assert::AreEqual('\x08', gz[2]);
+
+            const auto le32_at = [&](const size_t pos)
+                {
+                    uint32_t v = 0;
+                    for (size_t i = 0; i < 4; ++i)
+                        v |= uint32_t(static_cast<uint8_t>(gz[pos + i])) << (8 * i);
+                    return v;
+                };
+            Assert::AreEqual(vcpkg::Gzip::crc32(data), le32_at(gz.size() - 8));
+            Assert::AreEqual(uint32_t(data.size()), le32_at(gz.size() - 4));
+        }
+
+        TEST_METHOD(compress_shrinks_repetitive_events)
+        {
+            std::string batch;
+            for (int i = 0; i < 100; ++i)
+            {
+                batch += R"({"ver": 1, "name": "Microsoft.ApplicationInsights.Event", "data": {"baseType": "EventData"}},)";
+            }
+            Assert::IsTrue(vcpkg::Gzip::compress(batch).size() * 10 < batch.size());
+        }
+
+        TEST_METHOD(inflate_reverses_deflate)
+        {
+            std::string data;
+            for (int i = 0; i < 300; ++i)
+            {
+                data += "Package: port" + std::to_string(i % 7) + "\nVersion: 1." + std::to_string(i % 3) + "\n\n";
+            }
+            data.push_back('\0');
+            data.push_back('\xff');
+
+            for (const std::string& input : {std::string(), std::string("a"), data})
+            {
+                const std::string deflated = vcpkg::Gzip::deflate(input);
+                std::string out = "replaced";
+                Assert::IsTrue(vcpkg::Gzip::inflate(deflated.data(), deflated.size(), out));
+                Assert::IsTrue(input == out);
+            }
+        }
+
+        TEST_METHOD(inflate_reads_what_compress_frames)
+        {
+            const std::string data = "vcpkg vcpkg vcpkg vcpkg";
+            const std::string gz = vcpkg::Gzip::compress(data);
+
+            // A 10-byte header and an 8-byte trailer around the deflate stream
+            std::string out;
+            Assert::IsTrue(vcpkg::Gzip::inflate(gz.data() + 10, gz.size() - 18, out));
+            Assert::AreEqual(data.c_str(), out.c_str());
+        }
+
+        TEST_METHOD(inflate_stored_blocks)
+        {
+            // A stored block, then a last one that is empty
+            const std::string stream("\x00\x05\x00\xfa\xffvcpkg\x01\x00\x00\xff\xff", 15);
+            std::string out;
+            Assert::IsTrue(vcpkg::Gzip::inflate(stream.data(), stream.size(), out));
+            Assert::AreEqual("vcpkg", out.c_str());
+        }
+
+        TEST_METHOD(inflate_dynamic_block)
+        {
+            // zlib's output for the data below, with dynamic codes and back references
+            const std::string stream(
+                "\x9d\xc9\xb7\x01\x00\x20\x08\x00\xb0\x5b\xb1\x63\x45\xec\x5e\xef\x0f\x66\x0d\x08\xa9\xb4\xb1\x0e\x7d\x88\x29"
+                "\x17\xaa\xdc\xfa\x98\x6b\x9f\x0b\x1f\x73\xcf\x5e\x73\xf4\xc6\x95\x4a\x4e\x31\x78\x74\xd6\x68\x25\x05\xfc\xcc\x03", 55);
+            Assert::AreEqual(2, (static_cast<uint8_t>(stream[0]) >> 1) & 3);
+
+            std::string data;
+            for (int i = 0; i < 3; ++i)
+                data += "abcdefghijklmnopqrstuvwxyz";
+            for (int i = 0; i < 3; ++i)
+                data += "zyxwvutsrqponmlkjihgfedcba";
+
+            std::string out;
+            Assert::IsTrue(vcpkg::Gzip::inflate(stream.data(), stream.size(), out));
+            Assert::IsTrue(data == out);
+        }
+
+        TEST_METHOD(inflate_rejects_corrupt_streams)
+        {
+            std::string out;
+            const auto inflates = [&](const std::string& stream) { return vcpkg::Gzip::inflate(stream.data(), stream.size(), out); };
+
+            Assert::IsFalse(inflates(std::string()));
+            // Block type 3 is reserved
+            Assert::IsFalse(inflates(std::string("\x07", 1)));
+            // The length of a stored block does not match its complement
+            Assert::IsFalse(inflates(std::string("\x01\x05\x00\xfa\xfevcpkg", 10)));
+            // A stored block shorter than its length
+            Assert::IsFalse(inflates(std::string("\x01\x05\x00\xfa\xffvcp", 8)));
+
+            // Cut anywhere, a stream never reaches the end of its last block
+            const std::string deflated = vcpkg::Gzip::deflate("the quick brown fox jumps over the lazy dog; the lazy dog sleeps");
+            for (size_t size = 0; size < deflated.size(); ++size)
+            {
+                Assert::IsFalse(inflates(deflated.substr(0, size)));
+            }
+
+            // A back reference to before the start: fixed codes, length 3 (code 257 = 0000001), distance 1 (code 0 = 00000)
+            Assert::IsFalse(inflates(std::string("\x03\x02\x00", 3)));
+        }
+    };
 }
@@ -0,0 +1,66 @@
+#include "CppUnitTest.h"
+#include "vcpkg_Parallel.h"
+#include "vcpkg_Checks.h"
+#include <atomic>
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    TEST_CLASS(ParallelTests)
+    {
+    public:
+        TEST_METHOD(tasks_run_after_their_predecessors)
+        {
+            std::atomic<int> completed(0);
+            int seen_by_last = -1;
+            Parallel::task_group group;
+            const Parallel::task first = group.run([&]() { ++completed; });
+            const Parallel::task second = group.run([&]() { ++completed; }, Parallel::lane::io);
+            group.run([&]() { seen_by_last = completed; }, Parallel::lane::cpu, {first, second});
+            group.wait();
+            Assert::AreEqual(2, seen_by_last);
+        }
+
+        // How many indices start before the failure is seen depends on scheduling; only the rethrow is certain
+        TEST_METHOD(first_failure_is_rethrown)
+        {
+            try
+            {
+                Parallel::for_each_index(100000, [&](const size_t i)
+                    {
+                        if (i == 0)
+                        {
+                            throw std::runtime_error("failed");
+                        }
+                    });
+                Assert::Fail();
+            }
+            catch (const std::runtime_error& e)
+            {
+                Assert::AreEqual("failed", e.what());
+            }
+        }
+
+        TEST_METHOD(failures_throw_to_the_waiting_thread)
+        {
+            const Checks::failures_throw failures_throw;
+            Parallel::task_group group;
+            group.run([]() { Checks::exit_with_message("Error: failed"); });
+            try
+            {
+                group.wait();
+                Assert::Fail();
+            }
+            catch (const Parallel::task_failed&)
+            {
+            }
+            Assert::IsTrue(Checks::failures_throw_on_this_thread());
+        }
+    };
+}
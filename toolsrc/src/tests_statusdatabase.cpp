@@ -0,0 +1,156 @@
+#include "CppUnitTest.h"
+#include "vcpkg.h"
+#include "Paragraphs.h"
+#include <fstream>
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    static StatusParagraph make_installed_paragraph(const std::string& name, const std::string& version)
+    {
+        StatusParagraph pgh;
+        pgh.package.spec = package_spec::from_name_and_triplet(name, triplet::X86_WINDOWS).get_or_throw();
+        pgh.package.version = version;
+        pgh.want = want_t::install;
+        pgh.state = install_state_t::installed;
+        return pgh;
+    }
+
+    TEST_CLASS(StatusJournalTests)
+    {
+    public:
+        TEST_METHOD(intact_journal_is_read_whole)
+        {
+            const std::string journal = make_status_journal_record(make_installed_paragraph("zlib", "1.2.8")) +
+                                        make_status_journal_record(make_installed_paragraph("curl", "7.51"));
+
+            std::string paragraphs;
+            Assert::IsTrue(parse_status_journal(journal, paragraphs));
+
+            const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(std::move(paragraphs));
+            Assert::AreEqual(size_t(2), pghs.size());
+            Assert::AreEqual("zlib", StatusParagraph(pghs[0]).package.spec.name().c_str());
+            Assert::AreEqual("7.51", StatusParagraph(pghs[1]).package.version.c_str());
+        }
+
+        TEST_METHOD(empty_journal_is_intact)
+        {
+            std::string paragraphs;
+            Assert::IsTrue(parse_status_journal(std::string(), paragraphs));
+            Assert::IsTrue(paragraphs.empty());
+        }
+
+        TEST_METHOD(truncated_last_record_is_skipped)
+        {
+            const std::string first = make_status_journal_record(make_installed_paragraph("zlib", "1.2.8"));
+            const std::string second = make_status_journal_record(make_installed_paragraph("curl", "7.51"));
+
+            // Cut in the payload, then in the header
+            for (const size_t cut : {second.size() - 1, size_t(3)})
+            {
+                std::string paragraphs;
+                Assert::IsFalse(parse_status_journal(first + second.substr(0, cut), paragraphs));
+
+                const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(std::move(paragraphs));
+                Assert::AreEqual(size_t(1), pghs.size());
+                Assert::AreEqual("zlib", StatusParagraph(pghs[0]).package.spec.name().c_str());
+            }
+        }
+
+        TEST_METHOD(checksum_mismatch_stops_reading)
+        {
+            const std::string first = make_status_journal_record(make_installed_paragraph("zlib", "1.2.8"));
+            std::string second = make_status_journal_record(make_installed_paragraph("curl", "7.51"));
+            const std::string third = make_status_journal_record(make_installed_paragraph("openssl", "1.0.2"));
+
+            // Same size, so only the checksum can tell
+            const size_t version = second.find("7.51");
+            Assert::AreNotEqual(std::string::npos, version);
+            second[version] = '8';
+
+            std::string paragraphs;
+            Assert::IsFalse(parse_status_journal(first + second + third, paragraphs));
+
+            const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(std::move(paragraphs));
+            Assert::AreEqual(size_t(1), pghs.size());
+            Assert::AreEqual("zlib", StatusParagraph(pghs[0]).package.spec.name().c_str());
+        }
+    };
+
+    TEST_CLASS(StatusDatabaseTests)
+    {
+    public:
+        TEST_METHOD_INITIALIZE(create_root)
+        {
+            root = fs::temp_directory_path() / "vcpkg-tests-statusdatabase";
+            std::error_code ec;
+            fs::remove_all(root, ec);
+            fs::create_directories(root, ec);
+            paths = vcpkg_paths::create(root).get_or_throw();
+
+            shard = paths.status_shard(triplet::X86_WINDOWS);
+            fs::create_directories(shard.info, ec);
+            write_file(shard.status_file, "Package: zlib\nVersion: 1.2.8\nArchitecture: x86-windows\nMulti-Arch: same\nStatus: install ok installed\n");
+        }
+
+        TEST_METHOD_CLEANUP(remove_root)
+        {
+            std::error_code ec;
+            fs::remove_all(root, ec);
+        }
+
+        // As extracting the export of an older version into a tree that was split already leaves it
+        TEST_METHOD(legacy_updates_merge_into_existing_database)
+        {
+            std::error_code ec;
+            fs::create_directories(paths.vcpkg_dir_updates, ec);
+            write_file(paths.vcpkg_dir_updates / "0", "Package: curl\nVersion: 7.51\nArchitecture: x86-windows\nMulti-Arch: same\nStatus: install ok installed\n");
+
+            const StatusParagraphs status_db = database_load_check(paths);
+            Assert::IsTrue(status_db.find_installed("zlib", triplet::X86_WINDOWS) != status_db.end());
+            Assert::IsTrue(status_db.find_installed("curl", triplet::X86_WINDOWS) != status_db.end());
+            Assert::IsFalse(fs::exists(paths.vcpkg_dir_updates));
+
+            // Written into the status file of the triplet, not only returned
+            const StatusParagraphs reloaded = database_load_check(paths);
+            Assert::IsTrue(reloaded.find_installed("zlib", triplet::X86_WINDOWS) != reloaded.end());
+            Assert::IsTrue(reloaded.find_installed("curl", triplet::X86_WINDOWS) != reloaded.end());
+        }
+
+        // As extracting an export leaves it
+        TEST_METHOD(imports_merge_into_existing_database)
+        {
+            std::error_code ec;
+            fs::create_directories(shard.imports, ec);
+            write_file(shard.imports / "vcpkg-export-20170101-120000", make_status_journal_record(make_installed_paragraph("curl", "7.51")));
+
+            // Readers see the import before any load folds it in
+            Assert::AreEqual(size_t(2), load_status_snapshot(paths).size());
+
+            const StatusParagraphs status_db = database_load_check(paths, {triplet::X86_WINDOWS});
+            Assert::IsTrue(status_db.find_installed("zlib", triplet::X86_WINDOWS) != status_db.end());
+            Assert::IsTrue(status_db.find_installed("curl", triplet::X86_WINDOWS) != status_db.end());
+            Assert::IsFalse(fs::exists(shard.imports / "vcpkg-export-20170101-120000"));
+
+            const StatusParagraphs reloaded = database_load_check(paths);
+            Assert::IsTrue(reloaded.find_installed("zlib", triplet::X86_WINDOWS) != reloaded.end());
+            Assert::IsTrue(reloaded.find_installed("curl", triplet::X86_WINDOWS) != reloaded.end());
+        }
+
+    private:
+        static void write_file(const fs::path& file, const std::string& contents)
+        {
+            std::ofstream(file, std::ios_base::binary | std::ios_base::trunc).write(contents.data(), contents.size());
+        }
+
+        fs::path root;
+        vcpkg_paths paths;
+        status_database_files shard;
+    };
+}
@@ -0,0 +1,122 @@
+#include "CppUnitTest.h"
+#include "StatusParagraphs.h"
+#include "StatusSnapshot.h"
+#include <sstream>
+
+#pragma comment(lib,"version")
+#pragma comment(lib,"winhttp")
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace vcpkg;
+
+namespace UnitTest1
+{
+    static std::unique_ptr<StatusParagraph> make_status_paragraph(const std::string& name, const triplet& target_triplet, want_t want, const std::vector<std::string>& depends = {})
+    {
+        auto pgh = std::make_unique<StatusParagraph>();
+        pgh->package.spec = package_spec::from_name_and_triplet(name, target_triplet).get_or_throw();
+        pgh->package.version = "1.0";
+        pgh->package.depends = depends;
+        pgh->want = want;
+        pgh->state = install_state_t::installed;
+        return pgh;
+    }
+
+    TEST_CLASS(StatusParagraphsTests)
+    {
+    public:
+        TEST_METHOD(find_by_name_and_triplet)
+        {
+            StatusParagraphs status_db;
+            status_db.insert(make_status_paragraph("zlib", triplet::X86_WINDOWS, want_t::install));
+            status_db.insert(make_status_paragraph("zlib", triplet::X64_WINDOWS, want_t::purge));
+            status_db.insert(make_status_paragraph("curl", triplet::X86_WINDOWS, want_t::install));
+
+            Assert::IsTrue(status_db.find("zlib", triplet::X86_WINDOWS) != status_db.end());
+            Assert::IsTrue(status_db.find("zlib", triplet::X64_WINDOWS) != status_db.end());
+            Assert::IsTrue(status_db.find("zlib", triplet::ARM_UWP) == status_db.end());
+            Assert::IsTrue(status_db.find("openssl", triplet::X86_WINDOWS) == status_db.end());
+
+            Assert::IsTrue(status_db.find_installed("zlib", triplet::X86_WINDOWS) != status_db.end());
+            Assert::IsTrue(status_db.find_installed("zlib", triplet::X64_WINDOWS) == status_db.end());
+            Assert::AreEqual("curl", (*status_db.find("curl", triplet::X86_WINDOWS))->package.spec.name().c_str());
+        }
+
+        TEST_METHOD(insert_replaces_in_place)
+        {
+            StatusParagraphs status_db;
+            status_db.insert(make_status_paragraph("zlib", triplet::X86_WINDOWS, want_t::install));
+            status_db.insert(make_status_paragraph("curl", triplet::X86_WINDOWS, want_t::install));
+            status_db.insert(make_status_paragraph("zlib", triplet::X86_WINDOWS, want_t::purge));
+
+            Assert::AreEqual(size_t(2), static_cast<size_t>(std::distance(status_db.begin(), status_db.end())));
+            Assert::IsTrue((*status_db.find("zlib", triplet::X86_WINDOWS))->want == want_t::purge);
+
+            // Serialization keeps insertion order
+            std::ostringstream out;
+            out << status_db;
+            const std::string text = out.str();
+            Assert::IsTrue(text.find("Package: zlib") < text.find("Package: curl"));
+        }
+
+        TEST_METHOD(later_duplicates_take_precedence_on_load)
+        {
+            std::vector<std::unique_ptr<StatusParagraph>> pghs;
+            pghs.push_back(make_status_paragraph("zlib", triplet::X86_WINDOWS, want_t::install));
+            pghs.push_back(make_status_paragraph("zlib", triplet::X86_WINDOWS, want_t::purge));
+            StatusParagraphs status_db(std::move(pghs));
+
+            Assert::IsTrue((*status_db.find("zlib", triplet::X86_WINDOWS))->want == want_t::purge);
+        }
+
+        TEST_METHOD(find_dependents_by_triplet)
+        {
+            StatusParagraphs status_db;
+            status_db.insert(make_status_paragraph("zlib", triplet::X86_WINDOWS, want_t::install));
+            status_db.insert(make_status_paragraph("libpng", triplet::X86_WINDOWS, want_t::install, {"zlib"}));
+            status_db.insert(make_status_paragraph("curl", triplet::X64_WINDOWS, want_t::install, {"zlib"}));
+            status_db.insert(make_status_paragraph("freetype", triplet::X86_WINDOWS, want_t::purge, {"zlib"}));
+
+            const std::vector<const StatusParagraph*> dependents = status_db.find_dependents("zlib", triplet::X86_WINDOWS);
+            Assert::AreEqual(size_t(1), dependents.size());
+            Assert::AreEqual("libpng", dependents[0]->package.spec.name().c_str());
+
+            Assert::IsTrue(status_db.find_dependents("libpng", triplet::X86_WINDOWS).empty());
+        }
+
+        TEST_METHOD(find_dependents_follows_replaced_paragraphs)
+        {
+            StatusParagraphs status_db;
+            status_db.insert(make_status_paragraph("zlib", triplet::X86_WINDOWS, want_t::install));
+            status_db.insert(make_status_paragraph("bzip2", triplet::X86_WINDOWS, want_t::install));
+            status_db.insert(make_status_paragraph("boost", triplet::X86_WINDOWS, want_t::install, {"zlib"}));
+            status_db.insert(make_status_paragraph("boost", triplet::X86_WINDOWS, want_t::install, {"bzip2"}));
+
+            Assert::IsTrue(status_db.find_dependents("zlib", triplet::X86_WINDOWS).empty());
+            Assert::AreEqual(size_t(1), status_db.find_dependents("bzip2", triplet::X86_WINDOWS).size());
+        }
+    };
+
+    TEST_CLASS(StatusSnapshotTests)
+    {
+    public:
+        TEST_METHOD(later_sources_replace_earlier_paragraphs)
+        {
+            std::vector<Paragraphs::parsed_paragraphs> sources;
+            sources.push_back(Paragraphs::parse_paragraph_views(
+                "Package: zlib\nVersion: 1.2.8\nArchitecture: x86-windows\nMulti-Arch: same\nStatus: install ok installed\n\n"
+                "Package: curl\nVersion: 7.51\nArchitecture: x86-windows\nMulti-Arch: same\nStatus: install ok installed\n"));
+            sources.push_back(Paragraphs::parse_paragraph_views(
+                "Package: zlib\nVersion: 1.2.8\nArchitecture: x86-windows\nMulti-Arch: same\nStatus: purge ok not-installed\n"));
+            const status_snapshot snapshot(std::move(sources));
+
+            Assert::AreEqual(size_t(2), snapshot.size());
+            Assert::AreEqual("zlib:x86-windows", snapshot[0].displayname.c_str());
+            Assert::IsTrue(snapshot[0].want == want_t::purge);
+            Assert::IsTrue(snapshot[0].state == install_state_t::not_installed);
+            Assert::IsTrue(snapshot[1].state == install_state_t::installed);
+            Assert::AreEqual("7.51", snapshot.paragraph(1).package.version.c_str());
+        }
+    };
+}
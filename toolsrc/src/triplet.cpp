@@ -1,9 +1,40 @@
 #include "triplet.h"
 #include "vcpkg_Checks.h"
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace vcpkg
 {
+    struct triplet::interned
+    {
+        std::string canonical_name;
+        std::string architecture;
+        std::string system;
+        size_t hash;
+    };
+
+    // Entries are never removed, so the pointers handed out stay valid for the life of the process
+    const triplet::interned* triplet::intern(const std::string& canonical_name)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::unique_ptr<triplet::interned>> table;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<triplet::interned>& entry = table[canonical_name];
+        if (!entry)
+        {
+            entry = std::make_unique<triplet::interned>();
+            entry->canonical_name = canonical_name;
+            const size_t dash = canonical_name.find('-');
+            entry->architecture = canonical_name.substr(0, dash);
+            entry->system = dash == std::string::npos ? std::string() : canonical_name.substr(dash + 1);
+            entry->hash = std::hash<std::string>()(canonical_name);
+        }
+        return entry.get();
+    }
+
     const triplet triplet::X86_WINDOWS = from_canonical_name("x86-windows");
     const triplet triplet::X64_WINDOWS = from_canonical_name("x64-windows");
     const triplet triplet::X86_UWP = from_canonical_name("x86-uwp");
@@ -22,7 +53,8 @@ namespace vcpkg
 
     bool operator==(const triplet& left, const triplet& right)
     {
-        return left.canonical_name() == right.canonical_name();
+        // Equal names are the same interned entry
+        return &left.canonical_name() == &right.canonical_name();
     }
 
     bool operator!=(const triplet& left, const triplet& right)
@@ -43,25 +75,34 @@ namespace vcpkg
         auto it = std::find(s.cbegin(), s.cend(), '-');
         Checks::check_exit(it != s.cend(), "Invalid triplet: %s", triplet_as_string);
 
-        triplet t;
-        t.m_canonical_name = s;
-        return t;
+        return triplet(intern(s));
+    }
+
+    triplet::triplet() : m_data(intern(std::string()))
+    {
+    }
+
+    triplet::triplet(const interned* data) : m_data(data)
+    {
     }
 
     const std::string& triplet::canonical_name() const
     {
-        return this->m_canonical_name;
+        return this->m_data->canonical_name;
+    }
+
+    const std::string& triplet::architecture() const
+    {
+        return this->m_data->architecture;
     }
 
-    std::string triplet::architecture() const
+    const std::string& triplet::system() const
     {
-        auto it = std::find(this->m_canonical_name.cbegin(), this->m_canonical_name.cend(), '-');
-        return std::string(this->m_canonical_name.cbegin(), it);
+        return this->m_data->system;
     }
 
-    std::string triplet::system() const
+    size_t triplet::hash_code() const
     {
-        auto it = std::find(this->m_canonical_name.cbegin(), this->m_canonical_name.cend(), '-');
-        return std::string(it + 1, this->m_canonical_name.cend());
+        return this->m_data->hash;
     }
 }
@@ -5,13 +5,30 @@
 #include <functional>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <filesystem>
 #include <vector>
 #include <cassert>
+#include <sstream>
+#include <algorithm>
+#include <mutex>
+#include <map>
 #include "vcpkg_Files.h"
 #include "vcpkg_System.h"
 #include "Paragraphs.h"
+#include "Timings.h"
+#include "vcpkg_Graphs.h"
+#include "vcpkg_Parallel.h"
+#include "vcpkg_Trace.h"
+#include "FilesIndex.h"
+#include "vcpkg_Hash.h"
+#include "PackageArchive.h"
+#include "StatusBinarySnapshot.h"
+#include "Listfile.h"
+#include "MSBuildProps.h"
+#include "CMakeIndex.h"
+#include "SymbolStore.h"
 #include <regex>
 
 using namespace vcpkg;
@@ -39,88 +56,482 @@ namespace
     }
 }
 
-static StatusParagraphs load_current_database(const fs::path& vcpkg_dir_status_file, const fs::path& vcpkg_dir_status_file_old)
+static StatusParagraphs load_current_database(const status_database_files& db)
 {
-    if (!fs::exists(vcpkg_dir_status_file))
+    const fs::path status_file_old = db.dir / "status-old";
+    if (!fs::exists(db.status_file))
     {
-        if (!fs::exists(vcpkg_dir_status_file_old))
+        if (!fs::exists(status_file_old))
         {
             // no status file, use empty db
             return StatusParagraphs();
         }
 
-        fs::rename(vcpkg_dir_status_file_old, vcpkg_dir_status_file);
+        fs::rename(status_file_old, db.status_file);
     }
 
-    auto text = Files::get_contents(vcpkg_dir_status_file).get_or_throw();
-    auto pghs = Paragraphs::parse_paragraphs(text);
+    auto text = Files::get_contents(db.status_file).get_or_throw();
+    const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(std::move(text));
 
     std::vector<std::unique_ptr<StatusParagraph>> status_pghs;
-    for (auto&& p : pghs)
+    status_pghs.reserve(pghs.size());
+    for (size_t i = 0; i < pghs.size(); ++i)
     {
-        status_pghs.push_back(std::make_unique<StatusParagraph>(p));
+        status_pghs.push_back(std::make_unique<StatusParagraph>(pghs[i]));
     }
 
     return StatusParagraphs(std::move(status_pghs));
 }
 
-StatusParagraphs vcpkg::database_load_check(const vcpkg_paths& paths)
+// The journal is rewritten into the status file once it grows past this size
+static const uintmax_t STATUS_JOURNAL_COMPACTION_THRESHOLD = 1024 * 1024;
+
+static uint32_t crc32(const char* data, const size_t size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc ^= static_cast<unsigned char>(data[i]);
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+bool vcpkg::parse_status_journal(const std::string& journal, std::string& paragraphs)
 {
-    auto updates_dir = paths.vcpkg_dir_updates;
+    size_t pos = 0;
+    while (pos < journal.size())
+    {
+        const size_t header_end = journal.find('\n', pos);
+        if (header_end == std::string::npos || journal[pos] != 'R')
+        {
+            return false;
+        }
 
+        const std::string header = journal.substr(pos, header_end - pos);
+        unsigned long long payload_size = 0;
+        unsigned long checksum = 0;
+        char* parse_end = nullptr;
+        payload_size = strtoull(header.c_str() + 1, &parse_end, 10);
+        checksum = strtoul(parse_end, &parse_end, 16);
+
+        const size_t payload_begin = header_end + 1;
+        if (*parse_end != '\0' || payload_size > journal.size() - payload_begin)
+        {
+            return false;
+        }
+
+        const char* payload = journal.data() + payload_begin;
+        const size_t size = static_cast<size_t>(payload_size);
+        if (crc32(payload, size) != checksum)
+        {
+            return false;
+        }
+
+        paragraphs.append(payload, size).push_back('\n');
+        pos = payload_begin + size;
+    }
+
+    return true;
+}
+
+static bool read_status_journal(const fs::path& journal_file, std::string& paragraphs)
+{
+    const expected<std::string> contents = Files::get_contents(journal_file);
+    const std::string* text = contents.get();
+    return text == nullptr || parse_status_journal(*text, paragraphs);
+}
+
+static bool replay_status_journal(const fs::path& journal_file, StatusParagraphs& status_db)
+{
+    std::string paragraphs;
+    const bool intact = read_status_journal(journal_file, paragraphs);
+
+    const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(std::move(paragraphs));
+    for (size_t i = 0; i < pghs.size(); ++i)
+    {
+        status_db.insert(std::make_unique<StatusParagraph>(pghs[i]));
+    }
+
+    return intact;
+}
+
+// Reads the journals in imports_dir into paragraphs, in name order, and returns their paths
+static std::vector<fs::path> read_status_imports(const fs::path& imports_dir, std::string& paragraphs)
+{
+    std::vector<fs::path> imports;
     std::error_code ec;
-    fs::create_directory(paths.installed, ec);
-    fs::create_directory(paths.vcpkg_dir, ec);
-    fs::create_directory(paths.vcpkg_dir_info, ec);
-    fs::create_directory(updates_dir, ec);
+    for (auto it = fs::directory_iterator(imports_dir, ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+    {
+        if (fs::is_regular_file(it->status()))
+        {
+            imports.push_back(it->path());
+        }
+    }
+    std::sort(imports.begin(), imports.end());
 
-    const fs::path& status_file = paths.vcpkg_dir_status_file;
-    const fs::path status_file_old = status_file.parent_path() / "status-old";
-    const fs::path status_file_new = status_file.parent_path() / "status-new";
+    for (const fs::path& file : imports)
+    {
+        // An import is extracted whole; one that is not still yields its intact records
+        read_status_journal(file, paragraphs);
+    }
+    return imports;
+}
 
-    StatusParagraphs current_status_db = load_current_database(status_file, status_file_old);
+static std::vector<fs::path> replay_status_imports(const fs::path& imports_dir, StatusParagraphs& status_db)
+{
+    std::string paragraphs;
+    std::vector<fs::path> imports = read_status_imports(imports_dir, paragraphs);
 
-    auto b = fs::directory_iterator(updates_dir);
-    auto e = fs::directory_iterator();
-    if (b == e)
+    const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(std::move(paragraphs));
+    for (size_t i = 0; i < pghs.size(); ++i)
     {
-        // updates directory is empty, control file is up-to-date.
-        return current_status_db;
+        status_db.insert(std::make_unique<StatusParagraph>(pghs[i]));
     }
+    return imports;
+}
 
-    for (; b != e; ++b)
+// Returns true if the directory holds any update file, including an incomplete one that is skipped
+static bool read_legacy_updates(const fs::path& updates_dir, std::vector<Paragraphs::parsed_paragraphs>& updates)
+{
+    if (!fs::exists(updates_dir))
+    {
+        return false;
+    }
+
+    bool found_updates = false;
+    for (auto b = fs::directory_iterator(updates_dir); b != fs::directory_iterator(); ++b)
     {
         if (!fs::is_regular_file(b->status()))
             continue;
+        found_updates = true;
         if (b->path().filename() == "incomplete")
             continue;
 
         auto text = Files::get_contents(b->path()).get_or_throw();
-        auto pghs = Paragraphs::parse_paragraphs(text);
-        for (auto&& p : pghs)
+        updates.push_back(Paragraphs::parse_paragraph_views(std::move(text)));
+    }
+
+    return found_updates;
+}
+
+static bool apply_legacy_updates(const fs::path& updates_dir, StatusParagraphs& status_db)
+{
+    std::vector<Paragraphs::parsed_paragraphs> updates;
+    const bool found_updates = read_legacy_updates(updates_dir, updates);
+    for (const Paragraphs::parsed_paragraphs& pghs : updates)
+    {
+        for (size_t i = 0; i < pghs.size(); ++i)
         {
-            current_status_db.insert(std::make_unique<StatusParagraph>(p));
+            status_db.insert(std::make_unique<StatusParagraph>(pghs[i]));
         }
     }
 
-    std::fstream(status_file_new, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc) << current_status_db;
+    return found_updates;
+}
 
-    if (fs::exists(status_file_old))
-        fs::remove(status_file_old);
-    if (fs::exists(status_file))
-        fs::rename(status_file, status_file_old);
-    fs::rename(status_file_new, status_file);
-    fs::remove(status_file_old);
+static void compact_status_database(const status_database_files& db, const StatusParagraphs& status_db)
+{
+    std::ostringstream contents;
+    contents << status_db;
 
-    b = fs::directory_iterator(updates_dir);
-    for (; b != e; ++b)
+    // The journal is discarded below, so the new status file must be on disk first
+    std::error_code ec = Files::write_contents_atomically(db.status_file, contents.str(), Files::durability::flushed);
+    Checks::check_exit(!ec, "Error: could not write %s: %s", db.status_file.generic_string(), ec.message());
+    fs::remove(db.dir / "status-old", ec); // Left by versions that replaced the status file in two renames
+    StatusBinarySnapshot::write(db, status_db);
+
+    fs::remove(db.status_journal, ec);
+}
+
+Files::file_lock vcpkg::lock_status_database(const vcpkg_paths& paths, Files::file_lock::mode m)
+{
+    std::error_code ec;
+    fs::create_directory(paths.installed, ec);
+    fs::create_directory(paths.vcpkg_dir, ec);
+    return Files::file_lock(paths.vcpkg_dir_status_lock, m);
+}
+
+std::vector<Files::file_lock> vcpkg::lock_triplets(const vcpkg_paths& paths, const std::vector<package_spec>& specs)
+{
+    // A fixed order keeps two processes that need overlapping triplets from each holding what the other waits for
+    std::map<std::string, triplet> triplets;
+    for (const package_spec& spec : specs)
     {
-        if (!fs::is_regular_file(b->status()))
+        triplets.emplace(spec.target_triplet().canonical_name(), spec.target_triplet());
+    }
+
+    std::error_code ec;
+    fs::create_directory(paths.installed, ec);
+    fs::create_directory(paths.vcpkg_dir, ec);
+
+    std::vector<Files::file_lock> locks;
+    for (auto&& kv : triplets)
+    {
+        locks.emplace_back(paths.triplet_lock_path(kv.second), Files::file_lock::mode::exclusive);
+    }
+    return locks;
+}
+
+static Files::file_lock lock_status_shard(const status_database_files& db, Files::file_lock::mode m)
+{
+    std::error_code ec;
+    fs::create_directories(db.info, ec);
+    return Files::file_lock(db.status_lock, m);
+}
+
+// The triplets that have a database, in name order
+static std::vector<triplet> get_shard_triplets(const vcpkg_paths& paths)
+{
+    std::vector<triplet> triplets;
+    std::error_code ec;
+    for (auto it = fs::directory_iterator(paths.vcpkg_dir_shards, ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+    {
+        if (fs::is_directory(it->status()))
+        {
+            triplets.push_back(triplet::from_canonical_name(it->path().filename().generic_u8string()));
+        }
+    }
+    std::sort(triplets.begin(), triplets.end(), [](const triplet& left, const triplet& right) { return left.canonical_name() < right.canonical_name(); });
+    return triplets;
+}
+
+// Reads the database of one triplet, whose lock the caller holds exclusively: the status file, then its journal and imports.
+// journal_intact is false if the journal ends in a torn record; imports receives the imported journals that were read.
+static StatusParagraphs read_shard(const status_database_files& db, bool& journal_intact, std::vector<fs::path>& imports)
+{
+    if (!fs::exists(db.status_file) && !fs::exists(db.dir / "status-old"))
+    {
+        StatusBinarySnapshot::restore_status_file(db);
+    }
+
+    StatusParagraphs status_db = load_current_database(db);
+
+    // The binary snapshot mirrors the status file alone, so it is brought up to date before the journal is applied
+    if (!StatusBinarySnapshot::snapshot::open(db).get())
+    {
+        StatusBinarySnapshot::write(db, status_db);
+    }
+
+    journal_intact = replay_status_journal(db.status_journal, status_db);
+    imports = replay_status_imports(db.imports, status_db);
+    return status_db;
+}
+
+// Splits the single database of older versions into the databases of the triplets it holds, moving the listfiles along.
+// The old files are only removed once the status-split marker records that every new database is written, so a split
+// interrupted before that is done again from the start and one interrupted after it only finishes removing them.
+static void split_legacy_database(const vcpkg_paths& paths)
+{
+    const status_database_files legacy = paths.legacy_status_database();
+    const fs::path split_marker = legacy.dir / "status-split";
+    const auto has_legacy_files = [&]()
+    {
+        return fs::exists(legacy.status_file) || fs::exists(legacy.dir / "status-old") || fs::exists(legacy.status_journal) ||
+               fs::exists(legacy.status_snapshot) || fs::exists(paths.vcpkg_dir_updates) || fs::exists(split_marker);
+    };
+    if (!has_legacy_files())
+    {
+        return;
+    }
+
+    const Files::file_lock lock = lock_status_database(paths, Files::file_lock::mode::exclusive);
+    if (!has_legacy_files())
+    {
+        // Split by another process while this one waited
+        return;
+    }
+
+    std::error_code ec;
+    if (!fs::exists(split_marker))
+    {
+        if (!fs::exists(legacy.status_file) && !fs::exists(legacy.dir / "status-old"))
+        {
+            StatusBinarySnapshot::restore_status_file(legacy);
+        }
+
+        StatusParagraphs legacy_db = load_current_database(legacy);
+        apply_legacy_updates(paths.vcpkg_dir_updates, legacy_db);
+        replay_status_journal(legacy.status_journal, legacy_db);
+
+        // In the order of the old status file, which each new one keeps
+        std::map<std::string, StatusParagraphs> shards;
+        for (auto it = legacy_db.end(); it != legacy_db.begin();)
+        {
+            --it;
+            shards[(*it)->package.spec.target_triplet().canonical_name()].insert(std::move(*it));
+        }
+
+        // A triplet may have a database already, e.g. when an export of an older version was extracted into a tree that
+        // was split before: the legacy records go on top of it, as the most recent ones
+        for (auto&& kv : shards)
+        {
+            const status_database_files db = paths.status_shard(triplet::from_canonical_name(kv.first));
+            const Files::file_lock shard_lock = lock_status_shard(db, Files::file_lock::mode::exclusive);
+            bool journal_intact;
+            std::vector<fs::path> imports;
+            StatusParagraphs merged = read_shard(db, journal_intact, imports);
+            for (auto it = kv.second.end(); it != kv.second.begin();)
+            {
+                --it;
+                merged.insert(std::move(*it));
+            }
+            compact_status_database(db, merged);
+            for (const fs::path& file : imports)
+            {
+                fs::remove(file, ec);
+            }
+        }
+
+        // Listfiles are named <name>_<version>_<triplet>.<extension>, and triplet names hold no underscore
+        std::vector<fs::path> listfiles;
+        for (auto it = fs::directory_iterator(legacy.info, ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+        {
+            listfiles.push_back(it->path());
+        }
+        for (const fs::path& listfile : listfiles)
+        {
+            const std::string stem = listfile.stem().generic_u8string();
+            const size_t separator = stem.rfind('_');
+            if (separator == std::string::npos)
+            {
+                continue;
+            }
+
+            const status_database_files db = paths.status_shard(triplet::from_canonical_name(stem.substr(separator + 1)));
+            fs::create_directories(db.info, ec);
+            fs::rename(listfile, db.info / listfile.filename(), ec);
+        }
+
+        std::ofstream(split_marker, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    }
+
+    for (const fs::path& file : {legacy.status_file, legacy.dir / "status-old", legacy.status_journal, legacy.status_snapshot})
+    {
+        fs::remove(file, ec);
+    }
+    fs::remove_all(paths.vcpkg_dir_updates, ec);
+    fs::remove(legacy.info, ec); // Left in place when something other than a listfile is in it
+    fs::remove(split_marker, ec);
+}
+
+// Loads the database of one triplet, compacting it when its journal has grown large or ends in a torn record, or when
+// it has imports
+static StatusParagraphs load_shard(const status_database_files& db)
+{
+    if (!fs::exists(db.dir))
+    {
+        return StatusParagraphs();
+    }
+
+    // Exclusive, so a compaction below rewrites everything every other process has written so far
+    const Files::file_lock lock = lock_status_shard(db, Files::file_lock::mode::exclusive);
+
+    bool journal_intact;
+    std::vector<fs::path> imports;
+    StatusParagraphs status_db = read_shard(db, journal_intact, imports);
+
+    const uintmax_t journal_size = fs::exists(db.status_journal) ? fs::file_size(db.status_journal) : 0;
+
+    // A torn record must not stay in front of new appends, so it forces a compaction as well
+    if (!journal_intact || journal_size > STATUS_JOURNAL_COMPACTION_THRESHOLD || !imports.empty())
+    {
+        compact_status_database(db, status_db);
+
+        // Only those that were read: another may have been extracted meanwhile
+        std::error_code ec;
+        for (const fs::path& file : imports)
+        {
+            fs::remove(file, ec);
+        }
+    }
+
+    return status_db;
+}
+
+static StatusParagraphs load_shards(const vcpkg_paths& paths, const std::vector<triplet>& triplets)
+{
+    const Trace::scoped_span span("database_load_check", "vcpkg");
+    const Timings::scoped_timer timer("database_load_check");
+
+    std::unordered_set<triplet> loaded;
+    StatusParagraphs status_db;
+    for (const triplet& t : triplets)
+    {
+        if (!loaded.insert(t).second)
+        {
             continue;
-        fs::remove(b->path());
+        }
+
+        StatusParagraphs shard = load_shard(paths.status_shard(t));
+        for (auto it = shard.end(); it != shard.begin();)
+        {
+            --it;
+            status_db.insert(std::move(*it));
+        }
     }
 
-    return current_status_db;
+    return status_db;
+}
+
+StatusParagraphs vcpkg::database_load_check(const vcpkg_paths& paths)
+{
+    // The triplets are listed once the split has created the databases of those that were in the legacy one
+    split_legacy_database(paths);
+    return load_shards(paths, get_shard_triplets(paths));
+}
+
+StatusParagraphs vcpkg::database_load_check(const vcpkg_paths& paths, const std::vector<triplet>& triplets)
+{
+    split_legacy_database(paths);
+    return load_shards(paths, triplets);
+}
+
+status_snapshot vcpkg::load_status_snapshot(const vcpkg_paths& paths)
+{
+    const Trace::scoped_span span("load_status_snapshot", "vcpkg");
+    const Timings::scoped_timer timer("load_status_snapshot");
+
+    split_legacy_database(paths);
+
+    std::vector<StatusBinarySnapshot::snapshot> bases;
+    std::vector<Paragraphs::parsed_paragraphs> sources;
+    for (const triplet& t : get_shard_triplets(paths))
+    {
+        const status_database_files db = paths.status_shard(t);
+        const Files::file_lock lock = lock_status_shard(db, Files::file_lock::mode::shared);
+
+        // The status file is mapped through its binary snapshot when it has an up to date one, and parsed otherwise.
+        // A compaction interrupted after moving the status file aside leaves the same data in status-old.
+        expected<StatusBinarySnapshot::snapshot> base = StatusBinarySnapshot::snapshot::open(db);
+        if (StatusBinarySnapshot::snapshot* mapped = base.get())
+        {
+            bases.push_back(std::move(*mapped));
+        }
+        else
+        {
+            for (const fs::path& file : {db.status_file, db.dir / "status-old"})
+            {
+                expected<std::string> contents = Files::get_contents(file);
+                if (std::string* text = contents.get())
+                {
+                    sources.push_back(Paragraphs::parse_paragraph_views(std::move(*text)));
+                    break;
+                }
+            }
+        }
+
+        // A torn record at the end is skipped here; the next writer compacts it away, along with the imports
+        std::string journal_paragraphs;
+        read_status_journal(db.status_journal, journal_paragraphs);
+        read_status_imports(db.imports, journal_paragraphs);
+        sources.push_back(Paragraphs::parse_paragraph_views(std::move(journal_paragraphs)));
+    }
+
+    return status_snapshot(std::move(bases), std::move(sources));
 }
 
 static std::string get_fullpkgname_from_listfile(const fs::path& path)
@@ -130,42 +541,96 @@ static std::string get_fullpkgname_from_listfile(const fs::path& path)
     return ret;
 }
 
+std::string vcpkg::make_status_journal_record(const StatusParagraph& p)
+{
+    std::ostringstream payload_stream;
+    payload_stream << p;
+    const std::string payload = payload_stream.str();
+
+    return Strings::format("R %d %08x\n", static_cast<int>(payload.size()), static_cast<int>(crc32(payload.data(), payload.size()))) + payload;
+}
+
+// Appends the records of each triplet to the journal of its database with a single write and flush. Records never name a
+// file, so processes updating a database at the same time cannot overwrite each other's updates.
+static void write_updates(const vcpkg_paths& paths, const std::vector<const StatusParagraph*>& pghs)
+{
+    std::map<std::string, std::string> records; // By triplet name
+    for (const StatusParagraph* p : pghs)
+    {
+        records[p->package.spec.target_triplet().canonical_name()] += make_status_journal_record(*p);
+    }
+
+    for (auto&& kv : records)
+    {
+        const status_database_files db = paths.status_shard(triplet::from_canonical_name(kv.first));
+        const Files::file_lock lock = lock_status_shard(db, Files::file_lock::mode::exclusive);
+        std::fstream journal(db.status_journal, std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+        journal.write(kv.second.data(), kv.second.size());
+        journal.flush();
+        Checks::check_exit(!journal.fail(), "Error: failed to write to %s", db.status_journal.generic_string());
+    }
+}
+
 static void write_update(const vcpkg_paths& paths, const StatusParagraph& p)
 {
-    static int update_id = 0;
-    auto my_update_id = update_id++;
-    auto tmp_update_filename = paths.vcpkg_dir_updates / "incomplete";
-    auto update_filename = paths.vcpkg_dir_updates / std::to_string(my_update_id);
-    std::fstream fs(tmp_update_filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
-    fs << p;
-    fs.close();
-    fs::rename(tmp_update_filename, update_filename);
+    write_updates(paths, {&p});
 }
 
-static void install_and_write_listfile(const vcpkg_paths& paths, const BinaryParagraph& bpgh)
+// One "<xxh64> <size> <path>" line per installed file, with the path as in the listfile, read back by vcpkg verify.
+// The files were just written, so hashing them reads them back from the file cache.
+static void write_hashesfile(const vcpkg_paths& paths, const BinaryParagraph& bpgh, const fs::path& installed_triplet_dir,
+                             const std::vector<std::pair<fs::path, std::string>>& files)
 {
-    std::fstream listfile(paths.listfile_path(bpgh), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    const Trace::scoped_span span(to_string(bpgh.spec) + ":write_hashesfile", "port");
 
-    auto package_prefix_path = paths.package_dir(bpgh.spec);
-    auto prefix_length = package_prefix_path.native().size();
+    std::vector<std::string> lines(files.size());
+    Parallel::for_each_index(files.size(), [&](size_t i)
+    {
+        const expected<Hash::file_digest> digest = Hash::get_file_xxh64(installed_triplet_dir / files[i].second);
+        if (const Hash::file_digest* d = digest.get())
+        {
+            lines[i] = Strings::format("%s %s %s/%s\n", d->xxh64, std::to_string(d->size), bpgh.spec.target_triplet().canonical_name(), files[i].second);
+        }
+    });
 
-    const triplet& target_triplet = bpgh.spec.target_triplet();
-    const std::string& target_triplet_as_string = target_triplet.canonical_name();
-    std::error_code ec;
-    fs::create_directory(paths.installed / target_triplet_as_string, ec);
-    listfile << target_triplet << "\n";
+    std::string hashesfile;
+    for (const std::string& line : lines)
+    {
+        hashesfile += line;
+    }
+
+    // The hashes only serve vcpkg verify, so the install goes on without them; verify then asks for a reinstall rather
+    // than checking the files against the hashes of an earlier install
+    const fs::path hashesfile_path = paths.hashesfile_path(bpgh);
+    const std::error_code ec = Files::write_contents_atomically(hashesfile_path, hashesfile);
+    if (ec)
+    {
+        std::error_code remove_ec;
+        fs::remove(hashesfile_path, remove_ec);
+        System::println(System::color::warning, "Warning: could not write %s: %s", hashesfile_path.generic_string(), ec.message());
+    }
+}
 
+// Copies (or links) the files of packages/<spec> into installed_triplet_dir; dirs and files receive what was installed, as
+// paths relative to it, and files the source of each one
+static void install_files_from_directory(const fs::path& package_prefix_path, const fs::path& installed_triplet_dir, install_file_mode mode,
+                                         const std::unordered_set<std::string>& skipped_files,
+                                         std::vector<std::string>& dirs, std::vector<std::pair<fs::path, std::string>>& files)
+{
+    const Timings::scoped_timer timer("install_files");
+    // Walk the package first; the iterator visits every directory before its contents
+    const size_t prefix_length = package_prefix_path.generic_u8string().size();
+    std::error_code ec;
     for (auto it = fs::recursive_directory_iterator(package_prefix_path); it != fs::recursive_directory_iterator(); ++it)
     {
-        const auto& filename = it->path().filename();
-        if (fs::is_regular_file(it->status()) && (_stricmp(filename.generic_string().c_str(), "CONTROL") == 0 || _stricmp(filename.generic_string().c_str(), "BUILD_INFO") == 0))
+        const std::string filename = it->path().filename().string();
+        if (fs::is_regular_file(it->status()) && (Strings::case_insensitive_ascii_equals(filename, "CONTROL") || Strings::case_insensitive_ascii_equals(filename, "BUILD_INFO")))
         {
             // Do not copy the control file
             continue;
         }
 
         auto suffix = it->path().generic_u8string().substr(prefix_length + 1);
-        auto target = paths.installed / target_triplet_as_string / suffix;
 
         auto status = it->status(ec);
         if (ec)
@@ -175,22 +640,14 @@ static void install_and_write_listfile(const vcpkg_paths& paths, const BinaryPar
         }
         if (fs::is_directory(status))
         {
-            fs::create_directory(target, ec);
-            if (ec)
-            {
-                System::println(System::color::error, "failed: %s: %s", target.u8string(), ec.message());
-            }
-
-            listfile << target_triplet << "/" << suffix << "\n";
+            dirs.push_back(std::move(suffix));
         }
         else if (fs::is_regular_file(status))
         {
-            fs::copy_file(*it, target, ec);
-            if (ec)
+            if (skipped_files.find(suffix) == skipped_files.end())
             {
-                System::println(System::color::error, "failed: %s: %s", target.u8string(), ec.message());
+                files.emplace_back(it->path(), std::move(suffix));
             }
-            listfile << target_triplet << "/" << suffix << "\n";
         }
         else if (!fs::status_known(status))
         {
@@ -200,10 +657,148 @@ static void install_and_write_listfile(const vcpkg_paths& paths, const BinaryPar
             System::println(System::color::error, "failed: %s: cannot handle file type", it->path().u8string());
     }
 
-    listfile.close();
+    for (const std::string& suffix : dirs)
+    {
+        auto target = installed_triplet_dir / suffix;
+        fs::create_directory(target, ec);
+        if (ec)
+        {
+            System::println(System::color::error, "failed: %s: %s", target.u8string(), ec.message());
+        }
+    }
+
+    Parallel::for_each_index(files.size(), [&](size_t i)
+    {
+        std::error_code copy_ec;
+        auto target = installed_triplet_dir / files[i].second;
+        if (mode == install_file_mode::hard_link)
+        {
+            fs::create_hard_link(files[i].first, target, copy_ec);
+            if (!copy_ec)
+            {
+                return;
+            }
+            copy_ec.clear();
+        }
+        fs::copy_file(files[i].first, target, copy_ec);
+        if (copy_ec)
+        {
+            System::println(System::color::error, "failed: %s: %s", target.u8string(), copy_ec.message());
+        }
+    }, Parallel::lane::io);
+}
+
+// As install_files_from_directory, for a package kept compressed: every file is decompressed straight into its place
+static void install_files_from_archive(const fs::path& archive, const fs::path& installed_triplet_dir,
+                                       std::vector<std::string>& dirs, std::vector<std::pair<fs::path, std::string>>& files)
+{
+    const Timings::scoped_timer timer("install_files");
+    const expected<PackageArchive::reader> opened = PackageArchive::reader::open(archive);
+    Checks::check_throw(opened.get() != nullptr, "cannot read %s: %s", archive.generic_string(), opened.error_code().message());
+    const PackageArchive::reader& reader = *opened.get();
+
+    std::vector<const PackageArchive::entry*> file_entries;
+    for (const PackageArchive::entry& e : reader.entries())
+    {
+        const std::string filename = fs::path(e.path).filename().string();
+        if (e.is_directory)
+        {
+            dirs.push_back(e.path);
+        }
+        else if (!Strings::case_insensitive_ascii_equals(filename, "CONTROL") && !Strings::case_insensitive_ascii_equals(filename, "BUILD_INFO"))
+        {
+            file_entries.push_back(&e);
+            files.emplace_back(archive, e.path);
+        }
+    }
+
+    std::error_code ec;
+    for (const std::string& suffix : dirs)
+    {
+        auto target = installed_triplet_dir / suffix;
+        fs::create_directory(target, ec);
+        if (ec)
+        {
+            System::println(System::color::error, "failed: %s: %s", target.u8string(), ec.message());
+        }
+    }
+
+    Parallel::for_each_index(file_entries.size(), [&](size_t i)
+    {
+        auto target = installed_triplet_dir / file_entries[i]->path;
+        std::string contents;
+        if (!reader.read(*file_entries[i], contents))
+        {
+            System::println(System::color::error, "failed: %s: corrupt package archive %s", target.u8string(), archive.generic_string());
+            return;
+        }
+
+        std::ofstream out(target, std::ios_base::binary | std::ios_base::trunc);
+        out.write(contents.data(), contents.size());
+        out.close();
+        if (out.fail())
+        {
+            System::println(System::color::error, "failed: %s: cannot write the file", target.u8string());
+        }
+    });
 }
 
-void vcpkg::install_package(const vcpkg_paths& paths, const BinaryParagraph& binary_paragraph, StatusParagraphs& status_db)
+static void install_and_write_listfile(const vcpkg_paths& paths, const BinaryParagraph& bpgh, install_file_mode mode, const std::unordered_set<std::string>& skipped_files)
+{
+    const Trace::scoped_span span(to_string(bpgh.spec) + ":install_and_write_listfile", "port");
+    const Timings::scoped_timer timer("install_and_write_listfile");
+
+    auto package_prefix_path = paths.package_dir(bpgh.spec);
+
+    const triplet& target_triplet = bpgh.spec.target_triplet();
+    const std::string& target_triplet_as_string = target_triplet.canonical_name();
+    const fs::path installed_triplet_dir = paths.installed / target_triplet_as_string;
+    std::error_code ec;
+    fs::create_directory(installed_triplet_dir, ec);
+
+    std::vector<std::string> dirs;
+    std::vector<std::pair<fs::path, std::string>> files;
+    const fs::path archive = PackageArchive::archive_path(paths, bpgh.spec);
+    if (!fs::exists(package_prefix_path) && fs::exists(archive))
+    {
+        install_files_from_archive(archive, installed_triplet_dir, dirs, files);
+    }
+    else
+    {
+        install_files_from_directory(package_prefix_path, installed_triplet_dir, mode, skipped_files, dirs, files);
+    }
+
+    write_hashesfile(paths, bpgh, installed_triplet_dir, files);
+
+    std::vector<Listfile::listed_entry> entries;
+    entries.reserve(dirs.size() + files.size() + 1);
+    entries.push_back({target_triplet_as_string, Listfile::entry_type::directory});
+    for (const std::string& dir : dirs)
+    {
+        entries.push_back({target_triplet_as_string + "/" + dir, Listfile::entry_type::directory});
+    }
+    for (auto&& file : files)
+    {
+        entries.push_back({target_triplet_as_string + "/" + file.second, Listfile::entry_type::file});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Listfile::listed_entry& left, const Listfile::listed_entry& right) { return left.path < right.path; });
+
+    const fs::path listfile = paths.listfile_path(bpgh);
+    Checks::check_throw(Listfile::write(listfile, entries), "could not write %s", listfile.generic_string());
+
+    std::vector<std::string> listed_paths;
+    listed_paths.reserve(entries.size());
+    for (Listfile::listed_entry& entry : entries)
+    {
+        listed_paths.push_back(std::move(entry.path));
+    }
+
+    FilesIndex::add_package_files(paths, bpgh, listed_paths);
+    CMakeIndex::add_package(paths, bpgh, listed_paths);
+}
+
+void vcpkg::install_package(const vcpkg_paths& paths, const BinaryParagraph& binary_paragraph, StatusParagraphs& status_db, install_file_mode mode,
+                            const std::unordered_set<std::string>& skipped_files)
 {
     StatusParagraph spgh;
     spgh.package = binary_paragraph;
@@ -219,7 +814,7 @@ void vcpkg::install_package(const vcpkg_paths& paths, const BinaryParagraph& bin
     write_update(paths, spgh);
     status_db.insert(std::make_unique<StatusParagraph>(spgh));
 
-    install_and_write_listfile(paths, spgh.package);
+    install_and_write_listfile(paths, spgh.package, mode, skipped_files);
 
     spgh.state = install_state_t::installed;
     write_update(paths, spgh);
@@ -245,27 +840,131 @@ static deinstall_plan deinstall_package_plan(
         return deinstall_plan::not_installed;
     }
 
-    auto& pkg = (*package_it)->package;
+    const package_spec& spec = (*package_it)->package.spec;
+    dependencies_out = status_db.find_dependents(spec.name(), spec.target_triplet());
+
+    if (!dependencies_out.empty())
+        return deinstall_plan::dependencies_not_satisfied;
 
-    for (auto&& inst_pkg : status_db)
+    return deinstall_plan::should_deinstall;
+}
+
+// Deletes the listed file; returns true if the entry is a directory, to be pruned once every file is gone
+static bool remove_listed_entry(const fs::path& target)
+{
+    std::error_code ec;
+    auto status = fs::status(target, ec);
+    if (ec)
     {
-        if (inst_pkg->want != want_t::install)
-            continue;
-        if (inst_pkg->package.spec.target_triplet() != pkg.spec.target_triplet())
+        System::println(System::color::error, "failed: %s", ec.message());
+        return false;
+    }
+
+    if (fs::is_directory(status))
+    {
+        return true;
+    }
+
+    if (fs::is_regular_file(status))
+    {
+        fs::remove(target, ec);
+        if (ec)
+        {
+            System::println(System::color::error, "failed: %s: %s", target.u8string(), ec.message());
+        }
+    }
+    else if (!fs::status_known(status))
+    {
+        System::println(System::color::warning, "Warning: unknown status: %s", target.u8string());
+    }
+    else
+    {
+        System::println(System::color::warning, "Warning: %s: cannot handle file type", target.u8string());
+    }
+
+    return false;
+}
+
+// Removes the files of all the packages in one pass: the files are deleted concurrently,
+// directories shared between packages are pruned once at the end, and each status transition
+// is written for all packages with a single journal flush.
+static void remove_packages(const vcpkg_paths& paths, const std::vector<StatusParagraph*>& pkgs)
+{
+    std::vector<fs::path> targets;
+    for (const StatusParagraph* pkg : pkgs)
+    {
+        const fs::path listfile = paths.listfile_path(pkg->package);
+        std::error_code ec;
+        // An install that failed before writing the listfile has nothing listed to remove
+        if (pkg->state == install_state_t::half_installed && !fs::exists(listfile, ec))
             continue;
 
-        const auto& deps = inst_pkg->package.depends;
+        const bool listed = Listfile::for_each_entry(listfile, [&](const std::string& suffix, Listfile::entry_type)
+            {
+                targets.push_back(paths.installed / suffix);
+            });
+        Checks::check_exit(listed, "Error: could not read %s, which lists the files of %s", listfile.generic_string(), pkg->package.displayname());
+    }
+
+    std::vector<const StatusParagraph*> updates(pkgs.begin(), pkgs.end());
+    for (StatusParagraph* pkg : pkgs)
+    {
+        pkg->want = want_t::purge;
+        pkg->state = install_state_t::half_installed;
+    }
+    write_updates(paths, updates);
+
+    std::vector<fs::path> dirs_touched;
+    std::mutex dirs_touched_mutex;
+    Parallel::for_each_index(targets.size(), [&](size_t i)
+    {
+        if (remove_listed_entry(targets[i]))
+        {
+            std::lock_guard<std::mutex> lock(dirs_touched_mutex);
+            dirs_touched.push_back(targets[i]);
+        }
+    }, Parallel::lane::io);
+
+    // A directory sorts before everything inside it, so pruning in descending order removes children first
+    std::sort(dirs_touched.begin(), dirs_touched.end());
+    dirs_touched.erase(std::unique(dirs_touched.begin(), dirs_touched.end()), dirs_touched.end());
 
-        if (std::find(deps.begin(), deps.end(), pkg.spec.name()) != deps.end())
+    auto b = dirs_touched.rbegin();
+    auto e = dirs_touched.rend();
+    for (; b != e; ++b)
+    {
+        const fs::path& dir = *b;
+        if (fs::directory_iterator(dir) == fs::directory_iterator())
         {
-            dependencies_out.push_back(inst_pkg.get());
+            std::error_code ec;
+            fs::remove(dir, ec);
+            if (ec)
+            {
+                System::println(System::color::error, "failed: %s", ec.message());
+            }
         }
     }
 
-    if (!dependencies_out.empty())
-        return deinstall_plan::dependencies_not_satisfied;
+    std::vector<const BinaryParagraph*> removed;
+    for (StatusParagraph* pkg : pkgs)
+    {
+        std::error_code ec;
+        fs::remove(paths.listfile_path(pkg->package), ec);
+        fs::remove(paths.importsfile_path(pkg->package), ec);
+        fs::remove(paths.hashesfile_path(pkg->package), ec);
+        MSBuildProps::remove_package(paths, pkg->package);
+        pkg->state = install_state_t::not_installed;
+        removed.push_back(&pkg->package);
+    }
+    FilesIndex::remove_package_files(paths, removed);
+    CMakeIndex::remove_packages(paths, removed);
+    SymbolStore::remove_package_pdbs(paths, removed);
+    write_updates(paths, updates);
 
-    return deinstall_plan::should_deinstall;
+    for (const StatusParagraph* pkg : pkgs)
+    {
+        System::println(System::color::success, "Package %s was successfully removed", pkg->package.displayname());
+    }
 }
 
 void vcpkg::deinstall_package(const vcpkg_paths& paths, const package_spec& spec, StatusParagraphs& status_db)
@@ -299,73 +998,70 @@ void vcpkg::deinstall_package(const vcpkg_paths& paths, const package_spec& spec
             Checks::unreachable();
     }
 
-    pkg.want = want_t::purge;
-    pkg.state = install_state_t::half_installed;
-    write_update(paths, pkg);
+    remove_packages(paths, {&pkg});
+}
+
 
-    std::fstream listfile(paths.listfile_path(pkg.package), std::ios_base::in | std::ios_base::binary);
-    if (listfile)
+void vcpkg::deinstall_packages(const vcpkg_paths& paths, const std::vector<package_spec>& specs, StatusParagraphs& status_db)
+{
+    std::unordered_set<package_spec> requested;
+    std::vector<package_spec> installed_specs;
+    for (const package_spec& spec : specs)
     {
-        std::vector<fs::path> dirs_touched;
-        std::string suffix;
-        while (std::getline(listfile, suffix))
+        auto it = status_db.find(spec.name(), spec.target_triplet());
+        if (it == status_db.end() || (*it)->state == install_state_t::not_installed)
         {
-            if (!suffix.empty() && suffix.back() == '\r')
-                suffix.pop_back();
-
-            std::error_code ec;
+            System::println(System::color::success, "Package %s is not installed", spec);
+            continue;
+        }
 
-            auto target = paths.installed / suffix;
+        if (requested.insert(spec).second)
+        {
+            installed_specs.push_back(spec);
+        }
+    }
 
-            auto status = fs::status(target, ec);
-            if (ec)
-            {
-                System::println(System::color::error, "failed: %s", ec.message());
-                continue;
-            }
+    // Edges go from a package to the packages that depend on it, so the topological sort puts dependents first
+    Graphs::Graph<package_spec> graph;
+    bool dependencies_satisfied = true;
+    for (const package_spec& spec : installed_specs)
+    {
+        graph.add_vertex(spec);
 
-            if (fs::is_directory(status))
-            {
-                dirs_touched.push_back(target);
-            }
-            else if (fs::is_regular_file(status))
-            {
-                fs::remove(target, ec);
-                if (ec)
-                {
-                    System::println(System::color::error, "failed: %s: %s", target.u8string(), ec.message());
-                }
-            }
-            else if (!fs::status_known(status))
+        std::vector<const StatusParagraph*> blocking;
+        for (const StatusParagraph* dependent : status_db.find_dependents(spec.name(), spec.target_triplet()))
+        {
+            if (requested.find(dependent->package.spec) != requested.end())
             {
-                System::println(System::color::warning, "Warning: unknown status: %s", target.u8string());
+                graph.add_edge(spec, dependent->package.spec);
             }
             else
             {
-                System::println(System::color::warning, "Warning: %s: cannot handle file type", target.u8string());
+                blocking.push_back(dependent);
             }
         }
 
-        auto b = dirs_touched.rbegin();
-        auto e = dirs_touched.rend();
-        for (; b != e; ++b)
+        if (!blocking.empty())
         {
-            if (fs::directory_iterator(*b) == fs::directory_iterator())
+            dependencies_satisfied = false;
+            System::println(System::color::error, "Error: Cannot remove package %s:", spec);
+            for (auto&& dep : blocking)
             {
-                std::error_code ec;
-                fs::remove(*b, ec);
-                if (ec)
-                {
-                    System::println(System::color::error, "failed: %s", ec.message());
-                }
+                System::println("  %s depends on %s", dep->package.displayname(), spec);
             }
         }
+    }
 
-        listfile.close();
-        fs::remove(paths.listfile_path(pkg.package));
+    if (!dependencies_satisfied)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<StatusParagraph*> pkgs;
+    for (const package_spec& spec : graph.find_topological_sort())
+    {
+        pkgs.push_back(status_db.find(spec.name(), spec.target_triplet())->get());
     }
 
-    pkg.state = install_state_t::not_installed;
-    write_update(paths, pkg);
-    System::println(System::color::success, "Package %s was successfully removed", pkg.package.displayname());
+    remove_packages(paths, pkgs);
 }
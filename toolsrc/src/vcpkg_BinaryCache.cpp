@@ -0,0 +1,376 @@
+#include "vcpkg_BinaryCache.h"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <vector>
+#include "Trash.h"
+#include "vcpkg_Dependencies.h"
+#include "vcpkg_Downloads.h"
+#include "vcpkg_Environment.h"
+#include "vcpkg_Hash.h"
+#include "vcpkg_Parallel.h"
+#include "vcpkg_System.h"
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+namespace vcpkg {namespace BinaryCache
+{
+    static const std::wstring ABI_HASH_TYPE = L"SHA256";
+
+    static void append_file_hash(std::string& manifest, const std::string& label, const fs::path& file)
+    {
+        const expected<std::string> hash = Hash::get_file_hash(file, ABI_HASH_TYPE);
+        manifest.append(Strings::format("%s %s\n", label, hash.get_or_throw()));
+    }
+
+    static void append_directory_hashes(std::string& manifest, const std::string& label, const fs::path& dir, const bool recursive)
+    {
+        std::vector<fs::path> files;
+        const size_t prefix_length = dir.generic_u8string().size() + 1;
+        if (recursive)
+        {
+            for (auto it = fs::recursive_directory_iterator(dir); it != fs::recursive_directory_iterator(); ++it)
+            {
+                if (fs::is_regular_file(it->status()))
+                    files.push_back(it->path());
+            }
+        }
+        else
+        {
+            for (auto it = fs::directory_iterator(dir); it != fs::directory_iterator(); ++it)
+            {
+                if (fs::is_regular_file(it->status()))
+                    files.push_back(it->path());
+            }
+        }
+
+        // Directory iteration order is not guaranteed, so sort to keep the manifest stable
+        std::sort(files.begin(), files.end());
+        const std::vector<expected<std::string>> hashes = Hash::get_file_hashes(files, ABI_HASH_TYPE);
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            manifest.append(Strings::format("%s %s %s\n", label, files[i].generic_u8string().substr(prefix_length), hashes[i].get_or_throw()));
+        }
+    }
+
+    // Shared caches that archives are fetched from on a local miss and uploaded to after a build
+    struct remote_cache
+    {
+        std::string url;         // %VCPKG_BINARY_CACHE_URL%: <url>/<abi>.zip is read with GET and written with PUT
+        std::wstring nuget_feed; // %VCPKG_BINARY_CACHE_NUGET%: one package per ABI hash, see nuget_id()
+
+        bool empty() const
+        {
+            return this->url.empty() && this->nuget_feed.empty();
+        }
+    };
+
+    static const remote_cache& get_remote_cache()
+    {
+        static const remote_cache remote = []()
+            {
+                remote_cache r;
+                r.url = Strings::utf16_to_utf8(System::wdupenv_str(L"VCPKG_BINARY_CACHE_URL"));
+                while (!r.url.empty() && r.url.back() == '/')
+                {
+                    r.url.pop_back();
+                }
+                r.nuget_feed = System::wdupenv_str(L"VCPKG_BINARY_CACHE_NUGET");
+                // A key on the command line of nuget push is visible to every process on the machine; the one NuGet
+                // keeps encrypted for the feed is used instead
+                if (!r.nuget_feed.empty() && !System::wdupenv_str(L"VCPKG_BINARY_CACHE_NUGET_APIKEY").empty())
+                {
+                    System::println(System::color::warning, "Warning: VCPKG_BINARY_CACHE_NUGET_APIKEY is ignored; store the key once with\n"
+                                    "    nuget setapikey <key> -Source %s", Strings::utf16_to_utf8(r.nuget_feed));
+                }
+                return r;
+            }();
+        return remote;
+    }
+
+    static std::mutex transfers_mutex;
+    static std::unordered_map<std::string, std::shared_future<bool>> remote_fetches; // Guarded by transfers_mutex
+
+    // Never destroyed: the process may exit while transfers run
+    static Parallel::task_group& background_transfers()
+    {
+        static Parallel::task_group* group = new Parallel::task_group();
+        return *group;
+    }
+
+    static void run_in_background(std::function<void()> f)
+    {
+        background_transfers().run(std::move(f), Parallel::lane::io);
+    }
+
+    fs::path get_cache_dir(const vcpkg_paths& paths)
+    {
+        const fs::path cache_dir = System::wdupenv_str(L"VCPKG_BINARY_CACHE");
+        if (cache_dir.empty() && !get_remote_cache().empty())
+        {
+            return paths.downloads / "binarycache";
+        }
+        return cache_dir;
+    }
+
+    const std::string& compute_abi_hash(const vcpkg_paths& paths, const package_spec& spec, std::unordered_map<package_spec, std::string>& abi_cache)
+    {
+        auto it = abi_cache.find(spec);
+        if (it != abi_cache.end())
+        {
+            return it->second;
+        }
+
+        std::string manifest;
+        append_directory_hashes(manifest, "port", paths.port_dir(spec), true);
+        append_file_hash(manifest, "triplet", paths.triplets / (spec.target_triplet().canonical_name() + ".cmake"));
+        append_file_hash(manifest, "script ports.cmake", paths.ports_cmake);
+        append_directory_hashes(manifest, "script cmake", paths.ports_cmake.parent_path() / "cmake", false);
+
+        Dependencies::port_dependencies dependencies = Dependencies::get_port_dependencies(paths, spec);
+        std::sort(dependencies.build.begin(), dependencies.build.end());
+        for (const std::string& dependency : dependencies.build)
+        {
+            const package_spec dependency_spec = package_spec::from_name_and_triplet(dependency, spec.target_triplet()).get_or_throw();
+            manifest.append(Strings::format("dependency %s %s\n", dependency, compute_abi_hash(paths, dependency_spec, abi_cache)));
+        }
+        for (const package_spec& host_dependency : dependencies.host)
+        {
+            manifest.append(Strings::format("host dependency %s %s\n", to_string(host_dependency), compute_abi_hash(paths, host_dependency, abi_cache)));
+        }
+
+        return abi_cache.emplace(spec, Hash::get_string_hash(manifest, ABI_HASH_TYPE)).first->second;
+    }
+
+    static fs::path archive_path(const fs::path& cache_dir, const std::string& abi)
+    {
+        return cache_dir / abi.substr(0, 2) / (abi + ".zip");
+    }
+
+    // NuGet identifies packages by id and version; the ABI hash already determines the contents, so the version is fixed
+    static std::string nuget_id(const std::string& abi)
+    {
+        return "vcpkg-abi-" + abi;
+    }
+
+    static const std::string NUGET_VERSION = "1.0.0";
+
+    static void ensure_nuget_on_path(const vcpkg_paths& paths)
+    {
+        static std::once_flag once;
+        std::call_once(once, [&]() { Environment::ensure_nuget_on_path(paths); });
+    }
+
+    static bool download_from_nuget(const fs::path& archive, const std::string& abi)
+    {
+        const std::wstring& feed = get_remote_cache().nuget_feed;
+        const fs::path work_dir = archive.parent_path() / Strings::format("%s.%d.nuget", abi, static_cast<int>(GetCurrentProcessId()));
+        std::error_code ec;
+        fs::remove_all(work_dir, ec);
+
+        // -ExcludeVersion extracts the package to <work_dir>/<id>/, where the archive is stored at the root
+        const std::wstring cmd = Strings::wformat(LR"(nuget.exe install %s -Version %s -Source "%s" -OutputDirectory "%s" -ExcludeVersion -NonInteractive)",
+                                                  Strings::utf8_to_utf16(nuget_id(abi)), Strings::utf8_to_utf16(NUGET_VERSION), feed, work_dir.wstring());
+        const fs::path extracted_archive = work_dir / nuget_id(abi) / archive.filename();
+        bool success = System::process_execute(cmd, nullptr) == 0 && fs::exists(extracted_archive);
+        if (success)
+        {
+            fs::rename(extracted_archive, archive, ec);
+            success = fs::exists(archive);
+        }
+
+        fs::remove_all(work_dir, ec);
+        return success;
+    }
+
+    static bool upload_to_nuget(const std::string& display_name, const fs::path& archive, const std::string& abi)
+    {
+        const remote_cache& remote = get_remote_cache();
+        const fs::path work_dir = archive.parent_path() / Strings::format("%s.%d.nuget", abi, static_cast<int>(GetCurrentProcessId()));
+        std::error_code ec;
+        fs::remove_all(work_dir, ec);
+        fs::create_directories(work_dir, ec);
+
+        const fs::path nuspec_file = work_dir / "package.nuspec";
+        std::ofstream(nuspec_file) << Strings::format(R"(<?xml version="1.0" encoding="utf-8"?>
+<package>
+    <metadata>
+        <id>%s</id>
+        <version>%s</version>
+        <authors>vcpkg</authors>
+        <description>Binary cache entry for %s</description>
+    </metadata>
+    <files>
+        <file src="%s" target="" />
+    </files>
+</package>
+)", nuget_id(abi), NUGET_VERSION, display_name, archive.generic_u8string());
+
+        const fs::path nupkg = work_dir / Strings::format("%s.%s.nupkg", nuget_id(abi), NUGET_VERSION);
+        const std::wstring pack_cmd = Strings::wformat(LR"(nuget.exe pack "%s" -OutputDirectory "%s" -NoDefaultExcludes -NonInteractive)", nuspec_file.wstring(), work_dir.wstring());
+        // Without -ApiKey, push uses the key stored for the feed by nuget setapikey, or its credential provider
+        const std::wstring push_cmd = Strings::wformat(LR"(nuget.exe push "%s" -Source "%s" -NonInteractive)", nupkg.wstring(), remote.nuget_feed);
+        const bool success = System::process_execute(pack_cmd, nullptr) == 0 && System::process_execute(push_cmd, nullptr) == 0;
+
+        fs::remove_all(work_dir, ec);
+        return success;
+    }
+
+    static bool download_from_remote(const fs::path& archive, const std::string& abi)
+    {
+        std::error_code ec;
+        fs::create_directories(archive.parent_path(), ec);
+
+        const remote_cache& remote = get_remote_cache();
+        if (!remote.url.empty() && Downloads::download_file(Strings::format("%s/%s", remote.url, archive.filename().generic_u8string()), archive))
+        {
+            return true;
+        }
+
+        return !remote.nuget_feed.empty() && download_from_nuget(archive, abi);
+    }
+
+    static void upload_to_remote(const std::string& display_name, const fs::path& archive, const std::string& abi)
+    {
+        const remote_cache& remote = get_remote_cache();
+        if (!remote.url.empty() && !Downloads::upload_file(Strings::format("%s/%s", remote.url, archive.filename().generic_u8string()), archive))
+        {
+            System::println(System::color::warning, "Warning: failed to upload %s to the binary cache at %s", display_name, remote.url);
+        }
+
+        if (!remote.nuget_feed.empty() && !upload_to_nuget(display_name, archive, abi))
+        {
+            System::println(System::color::warning, "Warning: failed to upload %s to the NuGet feed %s", display_name, Strings::utf16_to_utf8(remote.nuget_feed));
+        }
+    }
+
+    // Brings the archive for abi from the remote cache into cache_dir. Concurrent calls for the same abi share a single transfer.
+    static bool fetch_remote_archive(const fs::path& cache_dir, const std::string& abi)
+    {
+        std::promise<bool> promise;
+        std::shared_future<bool> pending;
+        {
+            std::lock_guard<std::mutex> lock(transfers_mutex);
+            const auto it = remote_fetches.find(abi);
+            if (it != remote_fetches.end())
+            {
+                pending = it->second;
+            }
+            else
+            {
+                remote_fetches.emplace(abi, promise.get_future().share());
+            }
+        }
+
+        if (pending.valid())
+        {
+            return pending.get();
+        }
+
+        const fs::path archive = archive_path(cache_dir, abi);
+        const bool result = fs::exists(archive) || download_from_remote(archive, abi);
+        promise.set_value(result);
+        return result;
+    }
+
+    void prefetch(const vcpkg_paths& paths, const fs::path& cache_dir, const std::vector<std::string>& abis)
+    {
+        if (get_remote_cache().empty() || abis.empty())
+        {
+            return;
+        }
+
+        if (!get_remote_cache().nuget_feed.empty())
+        {
+            ensure_nuget_on_path(paths);
+        }
+
+        for (const std::string& abi : abis)
+        {
+            run_in_background([cache_dir, abi]() { fetch_remote_archive(cache_dir, abi); });
+        }
+    }
+
+    bool try_restore(const vcpkg_paths& paths, const fs::path& cache_dir, const package_spec& spec, const std::string& abi)
+    {
+        const fs::path archive = archive_path(cache_dir, abi);
+        if (!fs::exists(archive) && (get_remote_cache().empty() || !fetch_remote_archive(cache_dir, abi)))
+        {
+            return false;
+        }
+
+        const fs::path package_dir = paths.package_dir(spec);
+        std::error_code ec;
+        if (!Trash::move_to_trash(paths, package_dir))
+        {
+            fs::remove_all(package_dir, ec);
+        }
+        fs::create_directories(package_dir, ec);
+
+        const std::wstring cmd = Strings::wformat(LR"(cmake -E tar xf "%s")", archive.wstring());
+        if (System::process_execute(cmd, nullptr, package_dir) != 0 || !fs::exists(package_dir / "CONTROL"))
+        {
+            System::println(System::color::warning, "Warning: failed to restore %s from %s; building from source", to_string(spec), archive.generic_string());
+            fs::remove_all(package_dir, ec);
+            return false;
+        }
+
+        return true;
+    }
+
+    void store(const vcpkg_paths& paths, const fs::path& cache_dir, const package_spec& spec, const std::string& abi)
+    {
+        const fs::path archive = archive_path(cache_dir, abi);
+        if (fs::exists(archive))
+        {
+            return;
+        }
+
+        std::error_code ec;
+        fs::create_directories(archive.parent_path(), ec);
+
+        const fs::path package_dir = paths.package_dir(spec);
+        std::wstring entries;
+        for (auto it = fs::directory_iterator(package_dir); it != fs::directory_iterator(); ++it)
+        {
+            entries.append(Strings::wformat(LR"( "%s")", it->path().filename().wstring()));
+        }
+
+        // Archive next to the final location, then rename, so that concurrent readers never observe a partial archive
+        const fs::path tmp_archive = archive.parent_path() / Strings::format("%s.%d.tmp", abi, static_cast<int>(GetCurrentProcessId()));
+        const std::wstring cmd = Strings::wformat(LR"(cmake -E tar cf "%s" --format=zip%s)", tmp_archive.wstring(), entries);
+        if (System::process_execute(cmd, nullptr, package_dir) != 0)
+        {
+            System::println(System::color::warning, "Warning: failed to store %s in the binary cache at %s", to_string(spec), cache_dir.generic_string());
+            fs::remove(tmp_archive, ec);
+            return;
+        }
+
+        fs::rename(tmp_archive, archive, ec);
+        if (ec)
+        {
+            // Another machine stored the same ABI first
+            fs::remove(tmp_archive, ec);
+            return;
+        }
+
+        const remote_cache& remote = get_remote_cache();
+        if (!remote.empty())
+        {
+            if (!remote.nuget_feed.empty())
+            {
+                ensure_nuget_on_path(paths);
+            }
+
+            const std::string display_name = to_string(spec);
+            run_in_background([display_name, archive, abi]() { upload_to_remote(display_name, archive, abi); });
+        }
+    }
+
+    void wait_for_background_transfers()
+    {
+        background_transfers().wait();
+    }
+}}
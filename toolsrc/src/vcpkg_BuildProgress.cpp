@@ -0,0 +1,214 @@
+#include "vcpkg_BuildProgress.h"
+#include "vcpkg_System.h"
+#include "BuildDurations.h"
+#include <algorithm>
+#include <fstream>
+
+namespace vcpkg {namespace BuildProgress
+{
+    build_output::build_output(std::string prefix, const bool live) : prefix(std::move(prefix)), live(live)
+    {
+    }
+
+    void build_output::line(const std::string& text)
+    {
+        if (live)
+            System::println("%s%s", this->prefix, text);
+        else
+            this->held.push_back(text);
+    }
+
+    void build_output::print_held()
+    {
+        for (const std::string& text : this->held)
+        {
+            System::println("%s%s", this->prefix, text);
+        }
+        this->held.clear();
+    }
+
+    static bool ends_with(const std::string& s, const std::string& suffix)
+    {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // The files of buildtrees/<port> that belong to the build of spec: "<step>-<triplet>-<configuration or number><suffix>"
+    static std::vector<std::string> files_of(const vcpkg_paths& paths, const package_spec& spec, const std::string& suffix)
+    {
+        const std::string triplet_part = '-' + spec.target_triplet().canonical_name() + '-';
+        std::vector<std::string> names;
+        std::error_code ec;
+        for (auto it = fs::directory_iterator(paths.buildtrees / spec.name(), ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+        {
+            const std::string name = it->path().filename().string();
+            if (!ends_with(name, suffix))
+            {
+                continue;
+            }
+
+            // The last part tells x64-windows from x64-windows-static
+            const std::string stem = name.substr(0, name.size() - suffix.size());
+            const size_t triplet_pos = stem.find('-');
+            if (triplet_pos != std::string::npos
+                && stem.compare(triplet_pos, triplet_part.size(), triplet_part) == 0
+                && stem.find('-', triplet_pos + triplet_part.size()) == std::string::npos)
+            {
+                names.push_back(name);
+            }
+        }
+        return names;
+    }
+
+    tracker::tracker(const vcpkg_paths& paths, const size_t total, const bool tail_logs)
+        : paths(paths), total(total), tail_logs(tail_logs), finished_count(0)
+    {
+    }
+
+    void tracker::started(const package_spec& spec)
+    {
+        running_build build{spec, std::chrono::steady_clock::now(), {}};
+
+        // What the logs held before this build is not part of it; the steps truncate them when they start again
+        if (this->tail_logs)
+        {
+            for (const std::string& suffix : {std::string("-out.log"), std::string("-err.log")})
+            {
+                for (const std::string& name : files_of(this->paths, spec, suffix))
+                {
+                    std::error_code ec;
+                    const uintmax_t size = fs::file_size(this->paths.buildtrees / spec.name() / name, ec);
+                    build.log_offsets[name] = ec ? 0 : size;
+                }
+            }
+        }
+
+        this->running.emplace(to_string(spec), std::move(build));
+        refresh();
+    }
+
+    void tracker::set_phase(const package_spec& spec, const std::string& phase)
+    {
+        std::lock_guard<std::mutex> lock(this->phases_mutex);
+        this->phases[to_string(spec)] = phase;
+    }
+
+    void tracker::finished(const package_spec& spec)
+    {
+        const auto it = this->running.find(to_string(spec));
+        if (it != this->running.end())
+        {
+            if (this->tail_logs)
+            {
+                tail_logs_of(it->second, true);
+            }
+            this->running.erase(it);
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->phases_mutex);
+            this->phases.erase(to_string(spec));
+        }
+        ++this->finished_count;
+        refresh();
+    }
+
+    // vcpkg_execute_required_process leaves <logname>.process in buildtrees/<port> while the step runs
+    std::vector<std::string> tracker::current_steps(const running_build& build) const
+    {
+        static const std::string PROCESS_FILE_SUFFIX = ".process";
+        std::vector<std::string> steps = files_of(this->paths, build.spec, PROCESS_FILE_SUFFIX);
+        for (std::string& step : steps)
+        {
+            step.resize(step.size() - PROCESS_FILE_SUFFIX.size());
+        }
+        return steps;
+    }
+
+    void tracker::tail_logs_of(running_build& build, const bool last_time)
+    {
+        for (const std::string& suffix : {std::string("-out.log"), std::string("-err.log")})
+        {
+            for (const std::string& name : files_of(this->paths, build.spec, suffix))
+            {
+                const fs::path log = this->paths.buildtrees / build.spec.name() / name;
+                std::error_code ec;
+                const uintmax_t size = fs::file_size(log, ec);
+                uintmax_t& offset = build.log_offsets[name];
+                if (ec || size == offset)
+                {
+                    continue;
+                }
+                if (size < offset)
+                {
+                    offset = 0;
+                }
+
+                std::ifstream is(log, std::ios_base::in | std::ios_base::binary);
+                is.seekg(static_cast<std::streamoff>(offset));
+                std::string appended(static_cast<size_t>(size - offset), '\0');
+                is.read(&appended[0], static_cast<std::streamsize>(appended.size()));
+                appended.resize(static_cast<size_t>(is.gcount()));
+
+                // A line still being written is printed with the next refresh, unless the build is over
+                size_t whole_lines = appended.rfind('\n');
+                whole_lines = whole_lines == std::string::npos ? 0 : whole_lines + 1;
+                if (last_time && !appended.empty())
+                {
+                    if (appended.back() != '\n')
+                        appended.push_back('\n');
+                    whole_lines = appended.size();
+                }
+                offset += std::min<uintmax_t>(whole_lines, size - offset);
+
+                const std::string prefix = Strings::format("[%s %s] ", to_string(build.spec), name.substr(0, name.size() - suffix.size()));
+                size_t pos = 0;
+                while (pos < whole_lines)
+                {
+                    const size_t end = appended.find('\n', pos);
+                    std::string line = appended.substr(pos, end - pos);
+                    if (!line.empty() && line.back() == '\r')
+                        line.pop_back();
+                    System::println("%s%s", prefix, line);
+                    pos = end + 1;
+                }
+            }
+        }
+    }
+
+    void tracker::refresh()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::string status = Strings::format("[%s/%s]", std::to_string(this->finished_count), std::to_string(this->total));
+        for (auto&& kv : this->running)
+        {
+            running_build& build = kv.second;
+            if (this->tail_logs)
+            {
+                tail_logs_of(build, false);
+            }
+
+            const std::vector<std::string> steps = current_steps(build);
+            std::string phase;
+            for (const std::string& step : steps)
+            {
+                if (!phase.empty())
+                    phase.push_back(',');
+                phase += step;
+            }
+            if (phase.empty())
+            {
+                std::lock_guard<std::mutex> lock(this->phases_mutex);
+                const auto it = this->phases.find(kv.first);
+                phase = it != this->phases.end() ? it->second : "starting";
+            }
+
+            const long long elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - build.start).count();
+            status += Strings::format(" %s %s %s |", kv.first, phase, BuildDurations::format_duration(elapsed_ms));
+        }
+        if (status.back() == '|')
+        {
+            status.pop_back();
+            status.pop_back();
+        }
+        System::set_status_line(status);
+    }
+}}
@@ -2,9 +2,27 @@
 
 #include <stdexcept>
 #include "vcpkg_System.h"
+#include "vcpkg_Parallel.h"
 
 namespace vcpkg {namespace Checks
 {
+    static thread_local bool t_failures_throw = false;
+
+    failures_throw::failures_throw() : m_previous(t_failures_throw)
+    {
+        t_failures_throw = true;
+    }
+
+    failures_throw::~failures_throw()
+    {
+        t_failures_throw = m_previous;
+    }
+
+    bool failures_throw_on_this_thread()
+    {
+        return t_failures_throw;
+    }
+
     void unreachable()
     {
         System::println(System::color::error, "Error: Unreachable code was reached");
@@ -17,6 +35,11 @@ namespace vcpkg {namespace Checks
     void exit_with_message(const char* errorMessage)
     {
         System::println(System::color::error, errorMessage);
+        if (Parallel::on_pool_thread() || t_failures_throw)
+        {
+            // Stops the other tasks of the group before the process exits, or lets the caller carry on
+            throw Parallel::task_failed();
+        }
         exit(EXIT_FAILURE);
     }
 
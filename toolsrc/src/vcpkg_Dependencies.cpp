@@ -8,15 +8,36 @@
 #include "vcpkg_Maps.h"
 #include "vcpkg_Files.h"
 #include "Paragraphs.h"
+#include "vcpkg_Trace.h"
+#include "Timings.h"
+#include "vcpkg_Parallel.h"
+#include "PackageArchive.h"
+#include "PackagesIndex.h"
 
 namespace vcpkg { namespace Dependencies
 {
+    static std::vector<package_spec> to_package_specs(const std::vector<std::string>& names, const triplet& t)
+    {
+        std::vector<package_spec> specs;
+        for (const std::string& name : names)
+        {
+            specs.push_back(package_spec::from_name_and_triplet(name, t).get_or_throw());
+        }
+        return specs;
+    }
+
     // TODO: Refactoring between this function and install_package
-    static std::vector<std::string> get_single_level_unmet_dependencies(const vcpkg_paths& paths, const package_spec& spec)
+    // A package that is built already only needs its own dependencies; one that is built from its port also needs the tools it runs
+    static std::vector<package_spec> get_single_level_unmet_dependencies(const vcpkg_paths& paths, const PackagesIndex::packages_index& packages, const package_spec& spec)
     {
+        if (const BinaryParagraph* recorded = packages.find(paths, spec))
+        {
+            return to_package_specs(recorded->depends, spec.target_triplet());
+        }
+
         const fs::path packages_dir_control_file_path = paths.package_dir(spec) / "CONTROL";
 
-        auto control_contents_maybe = Files::get_contents(packages_dir_control_file_path);
+        auto control_contents_maybe = PackageArchive::read_control_file(paths, spec);
         if (auto control_contents = control_contents_maybe.get())
         {
             std::vector<std::unordered_map<std::string, std::string>> pghs;
@@ -28,53 +49,76 @@ namespace vcpkg { namespace Dependencies
             {
             }
             Checks::check_exit(pghs.size() == 1, "Invalid control file at %s", packages_dir_control_file_path.string());
-            return BinaryParagraph(pghs[0]).depends;
+            return to_package_specs(BinaryParagraph(pghs[0]).depends, spec.target_triplet());
         }
 
-        return get_unmet_package_build_dependencies(paths, spec);
+        const port_dependencies port = get_port_dependencies(paths, spec);
+        std::vector<package_spec> dependencies = to_package_specs(port.build, spec.target_triplet());
+        dependencies.insert(dependencies.end(), port.host.begin(), port.host.end());
+        return dependencies;
     }
 
+    // Resolves one level of dependencies at a time: the CONTROL files of a whole level are read concurrently, which hides
+    // the latency of slow (e.g. network) roots, then merged into the graph in level order so the result stays deterministic
     static Graphs::Graph<package_spec> build_dependency_graph(const vcpkg_paths& paths, const std::vector<package_spec>& specs, const StatusParagraphs& status_db)
     {
-        std::vector<package_spec> examine_stack(specs);
-        std::unordered_set<package_spec> was_examined; // Examine = we have checked its immediate (non-recursive) dependencies
-        Graphs::Graph<package_spec> graph;
-        graph.add_vertices(examine_stack);
+        const Trace::scoped_span span("build_dependency_graph", "vcpkg");
+        const Timings::scoped_timer timer("build_dependency_graph");
 
-        while (!examine_stack.empty())
+        std::unordered_set<package_spec> was_queued; // Queued = its immediate (non-recursive) dependencies are or will be checked
+        std::vector<package_spec> level;
+        for (const package_spec& spec : specs)
         {
-            const package_spec spec = examine_stack.back();
-            examine_stack.pop_back();
-
-            if (was_examined.find(spec) != was_examined.end())
+            if (was_queued.insert(spec).second)
             {
-                continue;
+                level.push_back(spec);
             }
+        }
 
-            std::vector<std::string> dependencies_as_string = get_single_level_unmet_dependencies(paths, spec);
+        Graphs::Graph<package_spec> graph;
+        graph.add_vertices(level);
 
-            for (const std::string& dep_as_string : dependencies_as_string)
-            {
-                const package_spec current_dep = package_spec::from_name_and_triplet(dep_as_string, spec.target_triplet()).get_or_throw();
-                auto it = status_db.find(current_dep.name(), current_dep.target_triplet());
-                if (it != status_db.end() && (*it)->want == want_t::install)
+        const PackagesIndex::packages_index packages = PackagesIndex::packages_index::load(paths);
+
+        while (!level.empty())
+        {
+            std::vector<std::vector<package_spec>> dependencies(level.size());
+            Parallel::for_each_index(level.size(), [&](const size_t i)
                 {
-                    continue;
-                }
+                    dependencies[i] = get_single_level_unmet_dependencies(paths, packages, level[i]);
+                });
 
-                graph.add_edge(spec, current_dep);
-                if (was_examined.find(current_dep) == was_examined.end())
+            std::vector<package_spec> next_level;
+            for (size_t i = 0; i < level.size(); ++i)
+            {
+                const package_spec& spec = level[i];
+                for (const package_spec& current_dep : dependencies[i])
                 {
-                    examine_stack.push_back(std::move(current_dep));
+                    auto it = status_db.find(current_dep.name(), current_dep.target_triplet());
+                    if (it != status_db.end() && (*it)->want == want_t::install)
+                    {
+                        continue;
+                    }
+
+                    graph.add_edge(spec, current_dep);
+                    if (was_queued.insert(current_dep).second)
+                    {
+                        next_level.push_back(current_dep);
+                    }
                 }
             }
 
-            was_examined.insert(spec);
+            level.swap(next_level);
         }
 
         return graph;
     }
 
+    Graphs::Graph<package_spec> create_dependency_graph(const vcpkg_paths& paths, const std::vector<package_spec>& specs, const StatusParagraphs& status_db)
+    {
+        return build_dependency_graph(paths, specs, status_db);
+    }
+
     std::vector<package_spec> create_dependency_ordered_install_plan(const vcpkg_paths& paths, const std::vector<package_spec>& specs, const StatusParagraphs& status_db)
     {
         return build_dependency_graph(paths, specs, status_db).find_topological_sort();
@@ -86,7 +130,7 @@ namespace vcpkg { namespace Dependencies
         return Maps::extract_key_set(dependency_graph.adjacency_list());
     }
 
-    std::vector<std::string> get_unmet_package_build_dependencies(const vcpkg_paths& paths, const package_spec& spec)
+    static SourceParagraph load_source_paragraph(const vcpkg_paths& paths, const package_spec& spec)
     {
         const fs::path ports_dir_control_file_path = paths.port_dir(spec) / "CONTROL";
         auto control_contents_maybe = Files::get_contents(ports_dir_control_file_path);
@@ -101,9 +145,27 @@ namespace vcpkg { namespace Dependencies
             {
             }
             Checks::check_exit(pghs.size() == 1, "Invalid control file at %s", ports_dir_control_file_path.string());
-            return filter_dependencies(SourceParagraph(pghs[0]).depends, spec.target_triplet());
+            return SourceParagraph(pghs[0]);
         }
 
         Checks::exit_with_message("Could not find package named %s", spec);
     }
+
+    port_dependencies get_port_dependencies(const vcpkg_paths& paths, const package_spec& spec)
+    {
+        const SourceParagraph source_paragraph = load_source_paragraph(paths, spec);
+
+        port_dependencies dependencies;
+        dependencies.build = filter_dependencies(source_paragraph.depends, spec.target_triplet());
+        for (const std::string& name : filter_dependencies(source_paragraph.host_depends, spec.target_triplet()))
+        {
+            const package_spec host_dependency = package_spec::from_name_and_triplet(name, paths.host_triplet).get_or_throw();
+            // A port building its own tools for the host triplet runs them from its build tree
+            if (!(host_dependency == spec))
+            {
+                dependencies.host.push_back(host_dependency);
+            }
+        }
+        return dependencies;
+    }
 }}
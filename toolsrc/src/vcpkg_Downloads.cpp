@@ -0,0 +1,680 @@
+#include "vcpkg_Downloads.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "DiskBudget.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Hash.h"
+#include "vcpkg_Parallel.h"
+#include "vcpkg_System.h"
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <winhttp.h>
+
+namespace vcpkg {namespace Downloads
+{
+    std::vector<cmake_command> parse_cmake_commands(const std::string& contents)
+    {
+        std::vector<cmake_command> commands;
+        size_t i = 0;
+        const size_t n = contents.size();
+
+        // At "[[" or "[=*[", moves i past it and returns true, with level set to the number of '='
+        auto open_bracket = [&](size_t& level)
+        {
+            size_t j = i + 1;
+            while (j < n && contents[j] == '=')
+                ++j;
+            if (i >= n || contents[i] != '[' || j >= n || contents[j] != '[')
+            {
+                return false;
+            }
+            level = j - i - 1;
+            i = j + 1;
+            return true;
+        };
+
+        // The contents of a bracket argument or comment up to its closing "]=*]", which i is moved past. As in CMake, a
+        // newline right after the opening bracket is not part of it.
+        auto read_bracket = [&](const size_t level)
+        {
+            if (contents.compare(i, 2, "\r\n") == 0)
+                i += 2;
+            else if (i < n && contents[i] == '\n')
+                ++i;
+
+            const std::string close = "]" + std::string(level, '=') + "]";
+            const size_t end = std::min(contents.find(close, i), n);
+            std::string bracket = contents.substr(i, end - i);
+            i = std::min(end + close.size(), n);
+            return bracket;
+        };
+
+        auto skip_whitespace_and_comments = [&]()
+        {
+            size_t level;
+            while (i < n)
+            {
+                if (isspace(static_cast<unsigned char>(contents[i])))
+                {
+                    ++i;
+                }
+                else if (contents[i] == '#')
+                {
+                    ++i;
+                    if (open_bracket(level))
+                    {
+                        read_bracket(level);
+                        continue;
+                    }
+                    while (i < n && contents[i] != '\n')
+                        ++i;
+                }
+                else
+                {
+                    return;
+                }
+            }
+        };
+
+        while (i < n)
+        {
+            skip_whitespace_and_comments();
+            const size_t name_begin = i;
+            while (i < n && (isalnum(static_cast<unsigned char>(contents[i])) || contents[i] == '_'))
+                ++i;
+            if (i == name_begin)
+            {
+                ++i;
+                continue;
+            }
+
+            cmake_command command;
+            command.name = Strings::ascii_to_lowercase(contents.substr(name_begin, i - name_begin));
+            skip_whitespace_and_comments();
+            if (i >= n || contents[i] != '(')
+            {
+                continue;
+            }
+            ++i;
+
+            int depth = 0;
+            while (i < n)
+            {
+                skip_whitespace_and_comments();
+                if (i >= n)
+                {
+                    break;
+                }
+
+                if (contents[i] == ')')
+                {
+                    ++i;
+                    if (depth == 0)
+                        break;
+                    --depth;
+                    continue;
+                }
+
+                std::string argument;
+                size_t level;
+                if (open_bracket(level))
+                {
+                    argument = read_bracket(level);
+                }
+                else if (contents[i] == '"')
+                {
+                    for (++i; i < n && contents[i] != '"'; ++i)
+                    {
+                        if (contents[i] == '\\' && i + 1 < n)
+                            ++i;
+                        argument.push_back(contents[i]);
+                    }
+                    ++i;
+                }
+                else
+                {
+                    for (; i < n && !isspace(static_cast<unsigned char>(contents[i])) && contents[i] != '#'; ++i)
+                    {
+                        if (contents[i] == '(')
+                        {
+                            ++depth;
+                        }
+                        else if (contents[i] == ')')
+                        {
+                            if (depth == 0)
+                                break;
+                            --depth;
+                        }
+                        argument.push_back(contents[i]);
+                    }
+                }
+                command.arguments.push_back(std::move(argument));
+            }
+
+            commands.push_back(std::move(command));
+        }
+
+        return commands;
+    }
+
+    namespace
+    {
+        // Returns false if s refers to a variable that is not known
+        bool expand_variables(const std::unordered_map<std::string, std::string>& variables, std::string& s)
+        {
+            for (size_t begin = s.find("${"); begin != std::string::npos; begin = s.find("${", begin))
+            {
+                const size_t end = s.find('}', begin);
+                if (end == std::string::npos)
+                {
+                    return false;
+                }
+
+                const auto it = variables.find(s.substr(begin + 2, end - begin - 2));
+                if (it == variables.end())
+                {
+                    return false;
+                }
+
+                s.replace(begin, end - begin + 1, it->second);
+                begin += it->second.size();
+            }
+
+            return true;
+        }
+
+        fs::path downloaded_file_path(const vcpkg_paths& paths, const distfile& file)
+        {
+            return paths.downloads / file.filename;
+        }
+
+        fs::path verified_stamp_path(const vcpkg_paths& paths, const distfile& file)
+        {
+            return paths.downloads / (file.filename + ".verified");
+        }
+
+        // Formatted like string(TIMESTAMP) with "%Y-%m-%dT%H:%M:%S" UTC so the cmake scripts can compare it
+        std::string get_last_write_time(const fs::path& file)
+        {
+            WIN32_FILE_ATTRIBUTE_DATA attributes;
+            SYSTEMTIME time;
+            if (!GetFileAttributesExW(file.wstring().c_str(), GetFileExInfoStandard, &attributes) || !FileTimeToSystemTime(&attributes.ftLastWriteTime, &time))
+            {
+                return std::string();
+            }
+
+            return Strings::format("%04d-%02d-%02dT%02d:%02d:%02d", static_cast<int>(time.wYear), static_cast<int>(time.wMonth), static_cast<int>(time.wDay),
+                                   static_cast<int>(time.wHour), static_cast<int>(time.wMinute), static_cast<int>(time.wSecond));
+        }
+
+        // "<sha512> <last write time> <size>". The size catches a rewrite within the second of the last write time.
+        std::string make_verified_stamp(const vcpkg_paths& paths, const distfile& file)
+        {
+            const fs::path path = downloaded_file_path(paths, file);
+            std::error_code ec;
+            const uintmax_t size = fs::file_size(path, ec);
+            return Strings::format("%s %s %s\n", file.sha512, get_last_write_time(path), ec ? std::string() : std::to_string(size));
+        }
+
+        // What vcpkg_download_distfile.cmake writes, as CMake cannot read the size of a file
+        std::string make_script_verified_stamp(const vcpkg_paths& paths, const distfile& file)
+        {
+            return Strings::format("%s %s\n", file.sha512, get_last_write_time(downloaded_file_path(paths, file)));
+        }
+
+        void write_verified_stamp(const vcpkg_paths& paths, const distfile& file)
+        {
+            std::ofstream(verified_stamp_path(paths, file), std::ios::binary | std::ios::trunc) << make_verified_stamp(paths, file);
+        }
+
+        bool file_has_hash(const fs::path& path, const std::string& sha512)
+        {
+            const expected<std::string> hash = Hash::get_file_hash(path, L"SHA512");
+            return hash.get() != nullptr && *hash.get() == sha512;
+        }
+
+        class internet_handle
+        {
+        public:
+            internet_handle() : handle(nullptr)
+            {
+            }
+
+            explicit internet_handle(HINTERNET handle) : handle(handle)
+            {
+            }
+
+            internet_handle(internet_handle&& other) : handle(other.handle)
+            {
+                other.handle = nullptr;
+            }
+
+            internet_handle& operator=(internet_handle&& other)
+            {
+                std::swap(this->handle, other.handle);
+                return *this;
+            }
+
+            internet_handle(const internet_handle&) = delete;
+            internet_handle& operator=(const internet_handle&) = delete;
+
+            ~internet_handle()
+            {
+                if (this->handle != nullptr)
+                    WinHttpCloseHandle(this->handle);
+            }
+
+            HINTERNET get() const
+            {
+                return this->handle;
+            }
+
+        private:
+            HINTERNET handle;
+        };
+
+        // Shared by all downloads for the lifetime of the process; requests abandoned by a mirror race may still be using it
+        HINTERNET get_session()
+        {
+            static const HINTERNET session = WinHttpOpen(L"vcpkg/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+            return session;
+        }
+
+        struct http_response
+        {
+            internet_handle connection;
+            internet_handle request;
+            DWORD status_code = 0;
+        };
+
+        // Connects to the host of url and opens (but does not send) a request for its path
+        bool open_request(const wchar_t* verb, const std::string& url, http_response& response)
+        {
+            const std::wstring wide_url = Strings::utf8_to_utf16(url);
+            URL_COMPONENTS components = {};
+            components.dwStructSize = sizeof(components);
+            components.dwHostNameLength = static_cast<DWORD>(-1);
+            components.dwUrlPathLength = static_cast<DWORD>(-1);
+            components.dwExtraInfoLength = static_cast<DWORD>(-1);
+            if (get_session() == nullptr || !WinHttpCrackUrl(wide_url.c_str(), 0, 0, &components))
+            {
+                return false;
+            }
+
+            const std::wstring host(components.lpszHostName, components.dwHostNameLength);
+            const std::wstring path = std::wstring(components.lpszUrlPath, components.dwUrlPathLength) + std::wstring(components.lpszExtraInfo, components.dwExtraInfoLength);
+
+            response.connection = internet_handle(WinHttpConnect(get_session(), host.c_str(), components.nPort, 0));
+            if (response.connection.get() == nullptr)
+            {
+                return false;
+            }
+
+            const DWORD flags = components.nScheme == INTERNET_SCHEME_HTTPS ? WINHTTP_FLAG_SECURE : 0;
+            response.request = internet_handle(WinHttpOpenRequest(response.connection.get(), verb, path.c_str(), nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags));
+            return response.request.get() != nullptr;
+        }
+
+        bool receive_response(http_response& response)
+        {
+            if (!WinHttpReceiveResponse(response.request.get(), nullptr))
+            {
+                return false;
+            }
+
+            DWORD size = sizeof(response.status_code);
+            return WinHttpQueryHeaders(response.request.get(), WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &response.status_code, &size, WINHTTP_NO_HEADER_INDEX) != FALSE;
+        }
+
+        // Sends a GET for url, asking for the bytes from resume_from onwards, and waits for the response headers
+        bool send_get_request(const std::string& url, const unsigned long long resume_from, http_response& response)
+        {
+            if (!open_request(L"GET", url, response))
+            {
+                return false;
+            }
+
+            const std::wstring headers = resume_from == 0 ? std::wstring() : Strings::wformat(L"Range: bytes=%s-\r\n", std::to_wstring(resume_from));
+            if (!WinHttpSendRequest(response.request.get(), headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : headers.c_str(), static_cast<DWORD>(headers.size()), WINHTTP_NO_REQUEST_DATA, 0, 0, 0))
+            {
+                return false;
+            }
+
+            return receive_response(response);
+        }
+
+        struct mirror_race
+        {
+            std::mutex mutex;
+            std::condition_variable finished;
+            size_t finished_count = 0;
+            size_t winner = SIZE_MAX;
+            http_response winner_response;
+        };
+
+        // Requests the file from every candidate mirror at once and returns the index of the first one to answer with
+        // the file, or SIZE_MAX. The slower requests are left to complete in the background and are then discarded.
+        size_t race_mirrors(const std::vector<std::string>& urls, const std::vector<size_t>& candidates, const unsigned long long resume_from, http_response& response)
+        {
+            const std::shared_ptr<mirror_race> race = std::make_shared<mirror_race>();
+            for (const size_t candidate : candidates)
+            {
+                const std::string url = urls[candidate];
+                std::thread([race, candidate, url, resume_from]()
+                    {
+                        http_response r;
+                        const bool success = send_get_request(url, resume_from, r) && (r.status_code == 200 || r.status_code == 206);
+                        std::lock_guard<std::mutex> lock(race->mutex);
+                        if (success && race->winner == SIZE_MAX)
+                        {
+                            race->winner = candidate;
+                            race->winner_response = std::move(r);
+                        }
+                        ++race->finished_count;
+                        race->finished.notify_all();
+                    }).detach();
+            }
+
+            std::unique_lock<std::mutex> lock(race->mutex);
+            race->finished.wait(lock, [&]() { return race->winner != SIZE_MAX || race->finished_count == candidates.size(); });
+            response = std::move(race->winner_response);
+            return race->winner;
+        }
+
+        // Appends the response body to partial_file, or replaces it if the server ignored the range request. If hash is
+        // set, it receives the whole file: the bytes of an earlier attempt are read back first, and the body as it arrives.
+        bool receive_body(http_response& response, const fs::path& partial_file, Hash::streaming_hash* hash)
+        {
+            const bool resumed = response.status_code == 206;
+            if (hash != nullptr && resumed)
+            {
+                std::ifstream earlier(partial_file, std::ios::binary);
+                std::vector<char> buffer(1024 * 1024);
+                while (earlier)
+                {
+                    earlier.read(buffer.data(), buffer.size());
+                    hash->add_bytes(buffer.data(), static_cast<size_t>(earlier.gcount()));
+                }
+            }
+
+            std::ofstream output(partial_file, std::ios::binary | std::ios::out | (resumed ? std::ios::app : std::ios::trunc));
+            if (!output)
+            {
+                return false;
+            }
+
+            std::vector<char> buffer(1024 * 64);
+            for (;;)
+            {
+                DWORD bytes_read = 0;
+                if (!WinHttpReadData(response.request.get(), buffer.data(), static_cast<DWORD>(buffer.size()), &bytes_read))
+                {
+                    return false;
+                }
+
+                if (bytes_read == 0)
+                {
+                    return static_cast<bool>(output.flush());
+                }
+
+                output.write(buffer.data(), bytes_read);
+                if (hash != nullptr)
+                {
+                    hash->add_bytes(buffer.data(), bytes_read);
+                }
+            }
+        }
+    }
+
+    std::vector<distfile> parse_distfiles(const std::string& portfile_contents)
+    {
+        std::vector<distfile> output;
+        std::unordered_map<std::string, std::string> variables;
+
+        for (const cmake_command& command : parse_cmake_commands(portfile_contents))
+        {
+            if (command.name == "set" && command.arguments.size() == 2)
+            {
+                std::string value = command.arguments[1];
+                if (expand_variables(variables, value))
+                {
+                    variables[command.arguments[0]] = value;
+                }
+                continue;
+            }
+
+            if (command.name != "vcpkg_download_distfile")
+            {
+                continue;
+            }
+
+            distfile file;
+            bool resolved = true;
+            std::vector<std::string>* current_list = nullptr;
+            std::string* current_value = nullptr;
+            for (size_t i = 1; i < command.arguments.size(); ++i)
+            {
+                const std::string& argument = command.arguments[i];
+                if (argument == "URLS")
+                {
+                    current_list = &file.urls;
+                    current_value = nullptr;
+                    continue;
+                }
+                if (argument == "FILENAME" || argument == "SHA512")
+                {
+                    current_list = nullptr;
+                    current_value = argument == "FILENAME" ? &file.filename : &file.sha512;
+                    continue;
+                }
+
+                std::string value = argument;
+                resolved = resolved && expand_variables(variables, value);
+                if (current_list != nullptr)
+                {
+                    current_list->push_back(std::move(value));
+                }
+                else if (current_value != nullptr)
+                {
+                    *current_value = std::move(value);
+                    current_value = nullptr;
+                }
+            }
+
+            if (resolved && !file.urls.empty() && !file.filename.empty() && !file.sha512.empty())
+            {
+                output.push_back(std::move(file));
+            }
+        }
+
+        return output;
+    }
+
+    bool is_verified(const vcpkg_paths& paths, const distfile& file)
+    {
+        const expected<std::string> stamp = Files::get_contents(verified_stamp_path(paths, file));
+        return stamp.get() != nullptr && fs::exists(downloaded_file_path(paths, file))
+               && (*stamp.get() == make_verified_stamp(paths, file) || *stamp.get() == make_script_verified_stamp(paths, file));
+    }
+
+    bool download(const vcpkg_paths& paths, const distfile& file)
+    {
+        const fs::path target = downloaded_file_path(paths, file);
+        const fs::path partial_file = paths.downloads / (file.filename + ".part");
+
+        std::vector<size_t> candidates;
+        for (size_t i = 0; i < file.urls.size(); ++i)
+        {
+            candidates.push_back(i);
+        }
+
+        while (!candidates.empty())
+        {
+            std::error_code ec;
+            const unsigned long long resume_from = fs::exists(partial_file) ? fs::file_size(partial_file, ec) : 0;
+
+            http_response response;
+            const size_t winner = race_mirrors(file.urls, candidates, ec ? 0 : resume_from, response);
+            if (winner == SIZE_MAX)
+            {
+                break;
+            }
+
+            candidates.erase(std::find(candidates.begin(), candidates.end(), winner));
+            System::println("-- Downloading %s...", file.urls[winner]);
+            Hash::streaming_hash hash(L"SHA512");
+            if (!receive_body(response, partial_file, &hash))
+            {
+                // The partial file is kept so the next mirror can continue where this one stopped
+                System::println(System::color::warning, "-- Downloading %s... Failed", file.urls[winner]);
+                continue;
+            }
+
+            if (hash.get_hash() != file.sha512)
+            {
+                System::println(System::color::warning, "-- Downloading %s... Failed. The file does not have the expected hash.", file.urls[winner]);
+                fs::remove(partial_file, ec);
+                continue;
+            }
+
+            fs::remove(target, ec);
+            fs::rename(partial_file, target, ec);
+            if (ec)
+            {
+                break;
+            }
+
+            write_verified_stamp(paths, file);
+            System::println("-- Downloading %s... OK", file.urls[winner]);
+            return true;
+        }
+
+        System::println(System::color::warning, "-- Failed to download %s", file.filename);
+        return false;
+    }
+
+    bool download_file(const std::string& url, const fs::path& destination)
+    {
+        http_response response;
+        if (!send_get_request(url, 0, response) || response.status_code != 200)
+        {
+            return false;
+        }
+
+        std::error_code ec;
+        const fs::path partial_file = destination.parent_path() / Strings::format("%s.%d.part", destination.filename().generic_u8string(), static_cast<int>(GetCurrentProcessId()));
+        if (!receive_body(response, partial_file, nullptr))
+        {
+            fs::remove(partial_file, ec);
+            return false;
+        }
+
+        fs::rename(partial_file, destination, ec);
+        if (ec)
+        {
+            fs::remove(partial_file, ec);
+            return fs::exists(destination);
+        }
+
+        return true;
+    }
+
+    bool upload_file(const std::string& url, const fs::path& file)
+    {
+        std::error_code ec;
+        const uintmax_t size = fs::file_size(file, ec);
+        std::ifstream input(file, std::ios::binary);
+        if (ec || !input || size > MAXDWORD)
+        {
+            return false;
+        }
+
+        http_response response;
+        if (!open_request(L"PUT", url, response)
+            || !WinHttpSendRequest(response.request.get(), WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, static_cast<DWORD>(size), 0))
+        {
+            return false;
+        }
+
+        std::vector<char> buffer(1024 * 64);
+        while (input)
+        {
+            input.read(buffer.data(), buffer.size());
+            const DWORD bytes_to_write = static_cast<DWORD>(input.gcount());
+            DWORD bytes_written = 0;
+            if (bytes_to_write != 0 && !WinHttpWriteData(response.request.get(), buffer.data(), bytes_to_write, &bytes_written))
+            {
+                return false;
+            }
+        }
+
+        return receive_response(response) && response.status_code >= 200 && response.status_code < 300;
+    }
+
+    void prefetch(const vcpkg_paths& paths, const std::vector<package_spec>& specs)
+    {
+        std::unordered_set<std::string> ports;
+        std::unordered_set<std::string> filenames;
+        std::vector<distfile> files;
+        std::vector<fs::path> used_files;
+        for (const package_spec& spec : specs)
+        {
+            if (!ports.insert(spec.name()).second)
+            {
+                continue;
+            }
+
+            const expected<std::string> portfile = Files::get_contents(paths.ports / spec.name() / "portfile.cmake");
+            if (portfile.get() == nullptr)
+            {
+                continue;
+            }
+
+            for (distfile& file : parse_distfiles(*portfile.get()))
+            {
+                if (!filenames.insert(file.filename).second)
+                {
+                    continue;
+                }
+
+                used_files.push_back(downloaded_file_path(paths, file));
+                if (!is_verified(paths, file))
+                {
+                    files.push_back(std::move(file));
+                }
+            }
+        }
+        DiskBudget::record_access(paths, used_files);
+
+        if (files.empty())
+        {
+            return;
+        }
+
+        std::error_code ec;
+        fs::create_directory(paths.downloads, ec);
+
+        System::println("-- Fetching %d distfile(s)", static_cast<int>(files.size()));
+        // Downloads wait on the network: on the I/O lane, they neither hold the computation threads nor are capped by them
+        Parallel::for_each_index(files.size(), [&](const size_t i)
+            {
+                const distfile& file = files[i];
+                if (!fs::exists(downloaded_file_path(paths, file)))
+                {
+                    download(paths, file);
+                }
+                else if (file_has_hash(downloaded_file_path(paths, file), file.sha512))
+                {
+                    // Downloaded by an older vcpkg; hashing here still takes it off the builds' critical path
+                    write_verified_stamp(paths, file);
+                }
+            }, Parallel::lane::io);
+    }
+}}
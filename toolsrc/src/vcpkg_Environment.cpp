@@ -1,9 +1,18 @@
 #include <regex>
+#include <algorithm>
 #include <array>
+#include <cwctype>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
 #include "vcpkg_Environment.h"
 #include "vcpkg_Commands.h"
 #include "metrics.h"
 #include "vcpkg_System.h"
+#include "vcpkg_Files.h"
+#include <Windows.h>
 
 namespace vcpkg {namespace Environment
 {
@@ -12,27 +21,131 @@ namespace vcpkg {namespace Environment
     static const fs::path default_git_installation_dir = "C:/Program Files/git/cmd";
     static const fs::path default_git_installation_dir_x86 = "C:/Program Files (x86)/git/cmd";
 
-    static void ensure_on_path(const std::array<int, 3>& version, const wchar_t* version_check_cmd, const wchar_t* install_cmd)
+    using tool_version = std::array<int, 3>;
+
+    // What the version of a tool was found to be, and the size and time of the executable it was asked of
+    struct tool_record
+    {
+        uintmax_t size;
+        long long last_write_time;
+        tool_version version;
+    };
+
+    // installed/vcpkg/tool-versions holds one "<size> <last write time> <major>.<minor>.<patch> <executable>" line per tool,
+    // so that the version of a tool is only asked again once its executable changed
+    static std::map<std::string, tool_record> load_tool_records(const vcpkg_paths& paths)
     {
-        System::exit_code_and_output ec_data = System::cmd_execute_and_capture_output(version_check_cmd);
-        if (ec_data.exit_code == 0)
+        std::map<std::string, tool_record> records;
+        const expected<std::string> contents = Files::get_contents(paths.vcpkg_dir_tool_versions);
+        if (const std::string* text = contents.get())
         {
-            // version check
-            std::regex re(R"###((\d+)\.(\d+)\.(\d+))###");
-            std::match_results<std::string::const_iterator> match;
-            auto found = std::regex_search(ec_data.output, match, re);
-            if (found)
+            std::istringstream is(*text);
+            for (std::string line; std::getline(is, line);)
             {
-                int d1 = atoi(match[1].str().c_str());
-                int d2 = atoi(match[2].str().c_str());
-                int d3 = atoi(match[3].str().c_str());
-                if (d1 > version[0] || (d1 == version[0] && d2 > version[1]) || (d1 == version[0] && d2 == version[1] && d3 >= version[2]))
+                std::istringstream fields(line);
+                tool_record record;
+                char dot1, dot2, space;
+                std::string executable;
+                if (fields >> record.size >> record.last_write_time >> record.version[0] >> dot1 >> record.version[1] >> dot2 >> record.version[2]
+                    && fields.get(space) && std::getline(fields, executable) && !executable.empty())
                 {
-                    // satisfactory version found
-                    return;
+                    records[executable] = record;
                 }
             }
         }
+        return records;
+    }
+
+    static void store_tool_records(const vcpkg_paths& paths, const std::map<std::string, tool_record>& records)
+    {
+        const fs::path& file = paths.vcpkg_dir_tool_versions;
+        std::ostringstream os;
+        for (auto&& kv : records)
+        {
+            const tool_record& record = kv.second;
+            os << record.size << ' ' << record.last_write_time << ' '
+                << record.version[0] << '.' << record.version[1] << '.' << record.version[2] << ' ' << kv.first << '\n';
+        }
+
+        // Only a shortcut: losing to a concurrent vcpkg means asking the tool once more next time
+        Files::write_contents_atomically(file, os.str());
+    }
+
+    // The executable CreateProcess would start for tool, or an empty path
+    static fs::path find_on_path(const wchar_t* tool)
+    {
+        wchar_t buf[MAX_PATH];
+        const DWORD length = SearchPathW(nullptr, tool, L".exe", MAX_PATH, buf, nullptr);
+        if (length == 0 || length >= MAX_PATH)
+        {
+            return fs::path();
+        }
+        return fs::path(buf, buf + length);
+    }
+
+    static bool is_at_least(const tool_version& found, const tool_version& wanted)
+    {
+        return found[0] > wanted[0] || (found[0] == wanted[0] && found[1] > wanted[1]) || (found[0] == wanted[0] && found[1] == wanted[1] && found[2] >= wanted[2]);
+    }
+
+    // Runs version_check_cmd unless the executable tool resolves to is the one whose version is on record
+    static bool has_version(const vcpkg_paths& paths, const wchar_t* tool, const tool_version& version, const wchar_t* version_check_cmd)
+    {
+        static std::mutex records_mutex;
+        std::lock_guard<std::mutex> lock(records_mutex);
+
+        const fs::path executable = find_on_path(tool);
+        std::error_code ec;
+        tool_record found = {};
+        if (!executable.empty())
+        {
+            found.size = fs::file_size(executable, ec);
+            if (!ec)
+                found.last_write_time = fs::last_write_time(executable, ec).time_since_epoch().count();
+        }
+
+        std::map<std::string, tool_record> records = load_tool_records(paths);
+        const std::string key = executable.generic_string();
+        if (!executable.empty() && !ec)
+        {
+            const auto it = records.find(key);
+            if (it != records.end() && it->second.size == found.size && it->second.last_write_time == found.last_write_time)
+            {
+                return is_at_least(it->second.version, version);
+            }
+        }
+
+        System::exit_code_and_output ec_data = System::process_execute_and_capture_output(version_check_cmd);
+        if (ec_data.exit_code != 0)
+        {
+            return false;
+        }
+
+        // version check
+        std::regex re(R"###((\d+)\.(\d+)\.(\d+))###");
+        std::match_results<std::string::const_iterator> match;
+        auto found_version = std::regex_search(ec_data.output, match, re);
+        if (!found_version)
+        {
+            return false;
+        }
+
+        found.version = {atoi(match[1].str().c_str()), atoi(match[2].str().c_str()), atoi(match[3].str().c_str())};
+        if (!executable.empty() && !ec)
+        {
+            records[key] = found;
+            store_tool_records(paths, records);
+        }
+        return is_at_least(found.version, version);
+    }
+
+    static void ensure_on_path(const vcpkg_paths& paths, const wchar_t* tool, const tool_version& version, const wchar_t* version_check_cmd, const wchar_t* install_cmd)
+    {
+        if (has_version(paths, tool, version, version_check_cmd))
+        {
+            // satisfactory version found
+            return;
+        }
 
         auto rc = System::cmd_execute(install_cmd);
         if (rc)
@@ -54,9 +167,9 @@ namespace vcpkg {namespace Environment
                                                        default_git_installation_dir_x86.native());
         _wputenv_s(L"PATH", path_buf.c_str());
 
-        static constexpr std::array<int, 3> git_version = {2,0,0};
+        static constexpr tool_version git_version = {2,0,0};
         // TODO: switch out ExecutionPolicy Bypass with "Remove Mark Of The Web" code and restore RemoteSigned
-        ensure_on_path(git_version, L"git --version 2>&1", L"powershell -ExecutionPolicy Bypass scripts\\fetchDependency.ps1 -Dependency git");
+        ensure_on_path(paths, L"git", git_version, L"git --version", L"powershell -ExecutionPolicy Bypass scripts\\fetchDependency.ps1 -Dependency git");
     }
 
     void ensure_cmake_on_path(const vcpkg_paths& paths)
@@ -69,9 +182,9 @@ namespace vcpkg {namespace Environment
                                                        default_cmake_installation_dir_x86.native());
         _wputenv_s(L"PATH", path_buf.c_str());
 
-        static constexpr std::array<int, 3> cmake_version = {3,5,0};
+        static constexpr tool_version cmake_version = {3,5,0};
         // TODO: switch out ExecutionPolicy Bypass with "Remove Mark Of The Web" code and restore RemoteSigned
-        ensure_on_path(cmake_version, L"cmake --version 2>&1", L"powershell -ExecutionPolicy Bypass scripts\\fetchDependency.ps1 -Dependency cmake");
+        ensure_on_path(paths, L"cmake", cmake_version, L"cmake --version", L"powershell -ExecutionPolicy Bypass scripts\\fetchDependency.ps1 -Dependency cmake");
     }
 
     void ensure_nuget_on_path(const vcpkg_paths& paths)
@@ -79,8 +192,212 @@ namespace vcpkg {namespace Environment
         const std::wstring path_buf = Strings::wformat(L"%s;%s", paths.downloads.native(), System::wdupenv_str(L"PATH"));
         _wputenv_s(L"PATH", path_buf.c_str());
 
-        static constexpr std::array<int, 3> nuget_version = {1,0,0};
+        static constexpr tool_version nuget_version = {1,0,0};
         // TODO: switch out ExecutionPolicy Bypass with "Remove Mark Of The Web" code and restore RemoteSigned
-        ensure_on_path(nuget_version, L"nuget 2>&1", L"powershell -ExecutionPolicy Bypass scripts\\fetchDependency.ps1 -Dependency nuget");
+        ensure_on_path(paths, L"nuget", nuget_version, L"nuget", L"powershell -ExecutionPolicy Bypass scripts\\fetchDependency.ps1 -Dependency nuget");
+    }
+
+    // What vcvarsall did to one variable: set it to value, or put value in front of what it was (e.g. PATH)
+    struct vcvars_change
+    {
+        std::wstring name;
+        bool prepend;
+        std::wstring value;
+    };
+
+    // By uppercase variable name, as names are not case sensitive
+    using vcvars_changes = std::map<std::wstring, vcvars_change>;
+
+    static std::wstring to_upper(std::wstring s)
+    {
+        std::transform(s.begin(), s.end(), s.begin(), [](const wchar_t c) { return static_cast<wchar_t>(std::towupper(c)); });
+        return s;
+    }
+
+    // The variables of this process, by uppercase name, skipping the hidden "=C:" style ones
+    static std::map<std::wstring, std::pair<std::wstring, std::wstring>> current_variables(std::vector<std::wstring>* hidden = nullptr)
+    {
+        std::map<std::wstring, std::pair<std::wstring, std::wstring>> variables;
+        wchar_t* const block = GetEnvironmentStringsW();
+        if (block == nullptr)
+        {
+            return variables;
+        }
+
+        for (const wchar_t* entry = block; *entry != L'\0'; entry += wcslen(entry) + 1)
+        {
+            const wchar_t* const equals = wcschr(entry + 1, L'=');
+            if (entry[0] == L'=' || equals == nullptr)
+            {
+                if (hidden != nullptr)
+                    hidden->push_back(entry);
+                continue;
+            }
+            const std::wstring name(entry, equals);
+            variables[to_upper(name)] = {name, equals + 1};
+        }
+        FreeEnvironmentStringsW(block);
+        return variables;
+    }
+
+    // installed/vcpkg/vcvars/<architecture> holds "<size> <last write time> <vcvarsall.bat>" on its first line, then one
+    // "set NAME=VALUE" or "prepend NAME=VALUE" line per variable vcvarsall changed, in UTF-8
+    static bool load_vcvars_changes(const fs::path& file, const std::string& stamp, vcvars_changes& changes)
+    {
+        const expected<std::string> contents = Files::get_contents(file);
+        const std::string* text = contents.get();
+        if (text == nullptr)
+        {
+            return false;
+        }
+
+        std::istringstream is(*text);
+        std::string line;
+        if (!std::getline(is, line) || line != stamp)
+        {
+            return false;
+        }
+
+        while (std::getline(is, line))
+        {
+            const size_t space = line.find(' ');
+            const size_t equals = line.find('=', space);
+            if (space == std::string::npos || equals == std::string::npos)
+            {
+                return false;
+            }
+
+            const std::string kind = line.substr(0, space);
+            vcvars_change change;
+            change.name = Strings::utf8_to_utf16(line.substr(space + 1, equals - space - 1));
+            change.prepend = kind == "prepend";
+            change.value = Strings::utf8_to_utf16(line.substr(equals + 1));
+            if (change.name.empty() || (!change.prepend && kind != "set"))
+            {
+                return false;
+            }
+            changes[to_upper(change.name)] = std::move(change);
+        }
+        return true;
+    }
+
+    static void store_vcvars_changes(const fs::path& file, const std::string& stamp, const vcvars_changes& changes)
+    {
+        std::ostringstream os;
+        os << stamp << '\n';
+        for (auto&& kv : changes)
+        {
+            const vcvars_change& change = kv.second;
+            os << (change.prepend ? "prepend " : "set ") << Strings::utf16_to_utf8(change.name) << '=' << Strings::utf16_to_utf8(change.value) << '\n';
+        }
+
+        // Only a shortcut: losing to a concurrent vcpkg means running vcvarsall once more next time
+        Files::write_contents_atomically(file, os.str());
+    }
+
+    // Runs vcvarsall and compares what "set" prints afterwards with the environment it started from
+    static bool capture_vcvars_changes(const fs::path& vcvarsall, const std::string& architecture, vcvars_changes& changes)
+    {
+        // cmd /u writes the output of set in UTF-16
+        const std::wstring command = Strings::wformat(LR"(cmd.exe /u /c ""%s" %s >nul 2>&1 && set")", vcvarsall.native(), Strings::utf8_to_utf16(architecture));
+        const auto before = current_variables();
+        const System::exit_code_and_output result = System::process_execute_and_capture_output(command);
+        if (result.exit_code != 0)
+        {
+            return false;
+        }
+
+        const std::wstring output(reinterpret_cast<const wchar_t*>(result.output.data()), result.output.size() / sizeof(wchar_t));
+        std::wistringstream lines(output);
+        for (std::wstring line; std::getline(lines, line);)
+        {
+            if (!line.empty() && line.back() == L'\r')
+                line.pop_back();
+            const size_t equals = line.find(L'=');
+            if (equals == 0 || equals == std::wstring::npos)
+                continue;
+
+            vcvars_change change;
+            change.name = line.substr(0, equals);
+            const std::wstring value = line.substr(equals + 1);
+            const std::wstring key = to_upper(change.name);
+            const auto it = before.find(key);
+            if (it != before.end() && it->second.second == value)
+                continue;
+
+            const std::wstring& old_value = it != before.end() ? it->second.second : std::wstring();
+            change.prepend = !old_value.empty() && value.size() > old_value.size() && value.compare(value.size() - old_value.size(), old_value.size(), old_value) == 0;
+            change.value = change.prepend ? value.substr(0, value.size() - old_value.size()) : value;
+            changes[key] = std::move(change);
+        }
+        return !changes.empty();
+    }
+
+    std::wstring get_vcvars_environment(const vcpkg_paths& paths, const std::string& architecture)
+    {
+        static std::mutex cache_mutex;
+        static std::map<std::string, vcvars_changes> cache; // By architecture; empty when vcvarsall failed
+        const std::wstring vs_tools = System::wdupenv_str(L"VS140COMNTOOLS");
+        if (vs_tools.empty())
+        {
+            return std::wstring();
+        }
+
+        std::unique_lock<std::mutex> lock(cache_mutex);
+        auto found = cache.find(architecture);
+        if (found == cache.end())
+        {
+            // Concurrent builds for the architecture wait for the first one to capture it, rather than all running vcvarsall
+            const fs::path vcvarsall = fs::path(vs_tools) / ".." / ".." / "VC" / "vcvarsall.bat";
+            std::error_code ec;
+            const uintmax_t size = fs::file_size(vcvarsall, ec);
+            const long long last_write_time = ec ? 0 : fs::last_write_time(vcvarsall, ec).time_since_epoch().count();
+            vcvars_changes changes;
+            if (!ec)
+            {
+                const std::string stamp = Strings::format("%llu %lld %s", static_cast<unsigned long long>(size), last_write_time, vcvarsall.generic_u8string());
+                const fs::path file = paths.vcpkg_dir_vcvars / architecture;
+                if (!load_vcvars_changes(file, stamp, changes))
+                {
+                    changes.clear();
+                    if (capture_vcvars_changes(vcvarsall, architecture, changes))
+                        store_vcvars_changes(file, stamp, changes);
+                    else
+                        changes.clear();
+                }
+            }
+            found = cache.emplace(architecture, std::move(changes)).first;
+        }
+        const vcvars_changes changes = found->second;
+        lock.unlock();
+
+        if (changes.empty())
+        {
+            return std::wstring();
+        }
+
+        // CreateProcess wants the variables sorted by name without regard to case; the hidden ones start with '=' and go first
+        std::vector<std::wstring> hidden;
+        auto variables = current_variables(&hidden);
+        for (auto&& kv : changes)
+        {
+            const vcvars_change& change = kv.second;
+            auto& variable = variables[kv.first];
+            if (variable.first.empty())
+                variable.first = change.name;
+            variable.second = change.prepend ? change.value + variable.second : change.value;
+        }
+
+        std::wstring block;
+        for (const std::wstring& entry : hidden)
+        {
+            block.append(entry).push_back(L'\0');
+        }
+        for (auto&& kv : variables)
+        {
+            block.append(kv.second.first).append(1, L'=').append(kv.second.second).push_back(L'\0');
+        }
+        block.push_back(L'\0');
+        return block;
     }
 }}
@@ -1,7 +1,9 @@
 #include "vcpkg_Files.h"
-#include <fstream>
+#include "vcpkg_Parallel.h"
+#include <algorithm>
 #include <filesystem>
 #include <regex>
+#include <Windows.h>
 
 namespace fs = std::tr2::sys;
 
@@ -21,27 +23,103 @@ namespace vcpkg {namespace Files
 
     expected<std::string> get_contents(const fs::path& file_path) noexcept
     {
-        std::fstream file_stream(file_path, std::ios_base::in | std::ios_base::binary);
-        if (file_stream.fail())
+        const HANDLE file = CreateFileW(file_path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
         {
-            return std::errc::no_such_file_or_directory;
+            return std::error_code(GetLastError(), std::system_category());
         }
 
-        file_stream.seekg(0, file_stream.end);
-        auto length = file_stream.tellg();
-        file_stream.seekg(0, file_stream.beg);
+        // Sized once, then read straight into the string, without the seeks and copies of a stream
+        std::error_code ec;
+        std::string output;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            ec = std::error_code(GetLastError(), std::system_category());
+        }
+        else if (static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX)
+        {
+            ec = std::make_error_code(std::errc::file_too_large);
+        }
+        else
+        {
+            output.resize(static_cast<size_t>(size.QuadPart));
+            size_t offset = 0;
+            while (offset < output.size())
+            {
+                const DWORD chunk = static_cast<DWORD>(std::min(output.size() - offset, size_t(1) << 30));
+                DWORD read = 0;
+                if (!ReadFile(file, &output[offset], chunk, &read, nullptr))
+                {
+                    ec = std::error_code(GetLastError(), std::system_category());
+                    break;
+                }
+                if (read == 0)
+                {
+                    // Truncated since it was sized
+                    output.resize(offset);
+                    break;
+                }
+                offset += read;
+            }
+        }
 
-        if (length > SIZE_MAX)
+        CloseHandle(file);
+        if (ec)
         {
-            return std::errc::file_too_large;
+            return ec;
         }
+        return std::move(output);
+    }
 
-        std::string output;
-        output.resize(static_cast<size_t>(length));
-        file_stream.read(&output[0], length);
-        file_stream.close();
+    std::vector<expected<std::string>> get_contents_of_all(const std::vector<fs::path>& file_paths)
+    {
+        std::vector<expected<std::string>> contents(file_paths.size(), expected<std::string>(std::string()));
+        Parallel::for_each_index(file_paths.size(), [&](const size_t i) { contents[i] = get_contents(file_paths[i]); }, Parallel::lane::io);
+        return contents;
+    }
 
-        return std::move(output);
+    std::error_code write_contents_atomically(const fs::path& file_path, const std::string& contents, const durability d) noexcept
+    {
+        std::error_code ec;
+        fs::create_directories(file_path.parent_path(), ec);
+
+        fs::path tmp_file = file_path;
+        tmp_file += Strings::wformat(L".%s.tmp", std::to_wstring(GetCurrentProcessId()));
+        const HANDLE file = CreateFileW(tmp_file.wstring().c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return std::error_code(GetLastError(), std::system_category());
+        }
+
+        size_t offset = 0;
+        while (!ec && offset < contents.size())
+        {
+            const DWORD chunk = static_cast<DWORD>(std::min(contents.size() - offset, size_t(1) << 30));
+            DWORD written = 0;
+            if (!WriteFile(file, contents.data() + offset, chunk, &written, nullptr))
+            {
+                ec = std::error_code(GetLastError(), std::system_category());
+            }
+            offset += written;
+        }
+        if (!ec && d == durability::flushed && !FlushFileBuffers(file))
+        {
+            ec = std::error_code(GetLastError(), std::system_category());
+        }
+        CloseHandle(file);
+
+        const DWORD move_flags = MOVEFILE_REPLACE_EXISTING | (d == durability::flushed ? MOVEFILE_WRITE_THROUGH : 0);
+        if (!ec && !MoveFileExW(tmp_file.wstring().c_str(), file_path.wstring().c_str(), move_flags))
+        {
+            ec = std::error_code(GetLastError(), std::system_category());
+        }
+        if (ec)
+        {
+            DeleteFileW(tmp_file.wstring().c_str());
+        }
+        return ec;
     }
 
     fs::path find_file_recursively_up(const fs::path& starting_dir, const std::string& filename)
@@ -58,4 +136,144 @@ namespace vcpkg {namespace Files
 
         return current_dir;
     }
+
+    expected<mapped_file> mapped_file::open(const fs::path& file_path) noexcept
+    {
+        mapped_file file;
+        file.m_file = CreateFileW(file_path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file.m_file == INVALID_HANDLE_VALUE)
+        {
+            file.m_file = nullptr;
+            return std::error_code(GetLastError(), std::system_category());
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file.m_file, &size))
+        {
+            return std::error_code(GetLastError(), std::system_category());
+        }
+
+        if (static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX)
+        {
+            return std::errc::file_too_large;
+        }
+
+        file.m_size = static_cast<size_t>(size.QuadPart);
+        if (file.m_size == 0)
+        {
+            // Empty files cannot be mapped
+            return std::move(file);
+        }
+
+        file.m_mapping = CreateFileMappingW(file.m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (file.m_mapping == nullptr)
+        {
+            return std::error_code(GetLastError(), std::system_category());
+        }
+
+        file.m_data = static_cast<const char*>(MapViewOfFile(file.m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (file.m_data == nullptr)
+        {
+            return std::error_code(GetLastError(), std::system_category());
+        }
+
+        return std::move(file);
+    }
+
+    mapped_file::mapped_file(mapped_file&& other) noexcept
+        : m_file(other.m_file), m_mapping(other.m_mapping), m_data(other.m_data), m_size(other.m_size)
+    {
+        other.m_file = nullptr;
+        other.m_mapping = nullptr;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+
+    mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            std::swap(m_file, other.m_file);
+            std::swap(m_mapping, other.m_mapping);
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+        }
+        return *this;
+    }
+
+    mapped_file::~mapped_file()
+    {
+        close();
+    }
+
+    void mapped_file::close() noexcept
+    {
+        if (m_data != nullptr)
+        {
+            UnmapViewOfFile(m_data);
+            m_data = nullptr;
+        }
+        if (m_mapping != nullptr)
+        {
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+        if (m_file != nullptr)
+        {
+            CloseHandle(m_file);
+            m_file = nullptr;
+        }
+        m_size = 0;
+    }
+
+    file_lock::file_lock(const fs::path& lock_file, mode m)
+    {
+        m_file = CreateFileW(lock_file.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            m_file = nullptr;
+            Checks::exit_with_message("Error: failed to open the lock file %s", lock_file.generic_string());
+        }
+
+        // The whole file is locked, including the bytes past its end, since the lock file stays empty
+        OVERLAPPED overlapped = {};
+        const DWORD flags = m == mode::exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0;
+        if (!LockFileEx(m_file, flags, 0, MAXDWORD, MAXDWORD, &overlapped))
+        {
+            release();
+            Checks::exit_with_message("Error: failed to lock %s", lock_file.generic_string());
+        }
+    }
+
+    file_lock::file_lock(file_lock&& other) noexcept : m_file(other.m_file)
+    {
+        other.m_file = nullptr;
+    }
+
+    file_lock& file_lock::operator=(file_lock&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            std::swap(m_file, other.m_file);
+        }
+        return *this;
+    }
+
+    file_lock::~file_lock()
+    {
+        release();
+    }
+
+    void file_lock::release() noexcept
+    {
+        if (m_file != nullptr)
+        {
+            // Closing the handle drops the lock
+            CloseHandle(m_file);
+            m_file = nullptr;
+        }
+    }
 }}
@@ -0,0 +1,474 @@
+#include "vcpkg_Gzip.h"
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace vcpkg {namespace Gzip
+{
+    static constexpr size_t WINDOW_SIZE = 32768;
+    static constexpr size_t MIN_MATCH = 3;
+    static constexpr size_t MAX_MATCH = 258;
+    static constexpr size_t MAX_CHAIN = 64;
+    static constexpr size_t HASH_BITS = 15;
+
+    static const uint16_t LENGTH_BASE[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t LENGTH_EXTRA[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const uint16_t DISTANCE_BASE[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const uint8_t DISTANCE_EXTRA[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    namespace
+    {
+        // Deflate packs bits from the least significant one up, except Huffman codes, which start with their most significant bit
+        class bit_writer
+        {
+        public:
+            explicit bit_writer(std::string& out) : out(out), buffer(0), count(0)
+            {
+            }
+
+            void bits(const uint32_t value, const int length)
+            {
+                this->buffer |= value << this->count;
+                this->count += length;
+                while (this->count >= 8)
+                {
+                    this->out.push_back(static_cast<char>(this->buffer & 0xFF));
+                    this->buffer >>= 8;
+                    this->count -= 8;
+                }
+            }
+
+            void huffman(const uint32_t code, const int length)
+            {
+                uint32_t reversed = 0;
+                for (int i = 0; i < length; ++i)
+                {
+                    reversed |= ((code >> i) & 1) << (length - 1 - i);
+                }
+                bits(reversed, length);
+            }
+
+            void finish()
+            {
+                if (this->count > 0)
+                {
+                    this->out.push_back(static_cast<char>(this->buffer & 0xFF));
+                }
+                this->buffer = 0;
+                this->count = 0;
+            }
+
+        private:
+            std::string& out;
+            uint32_t buffer;
+            int count;
+        };
+
+        void write_literal_or_length_symbol(bit_writer& writer, const uint32_t symbol)
+        {
+            if (symbol < 144)
+                writer.huffman(0x30 + symbol, 8);
+            else if (symbol < 256)
+                writer.huffman(0x190 + symbol - 144, 9);
+            else if (symbol < 280)
+                writer.huffman(symbol - 256, 7);
+            else
+                writer.huffman(0xC0 + symbol - 280, 8);
+        }
+
+        void write_match(bit_writer& writer, const size_t length, const size_t distance)
+        {
+            size_t length_code = 28;
+            while (LENGTH_BASE[length_code] > length)
+            {
+                --length_code;
+            }
+            write_literal_or_length_symbol(writer, static_cast<uint32_t>(257 + length_code));
+            writer.bits(static_cast<uint32_t>(length - LENGTH_BASE[length_code]), LENGTH_EXTRA[length_code]);
+
+            size_t distance_code = 29;
+            while (DISTANCE_BASE[distance_code] > distance)
+            {
+                --distance_code;
+            }
+            writer.huffman(static_cast<uint32_t>(distance_code), 5);
+            writer.bits(static_cast<uint32_t>(distance - DISTANCE_BASE[distance_code]), DISTANCE_EXTRA[distance_code]);
+        }
+
+        void write_le32(std::string& out, const uint32_t value)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+    }
+
+    uint32_t crc32(const std::string& data)
+    {
+        static const std::array<uint32_t, 256> table = []()
+            {
+                std::array<uint32_t, 256> t;
+                for (uint32_t n = 0; n < 256; ++n)
+                {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; ++k)
+                    {
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    }
+                    t[n] = c;
+                }
+                return t;
+            }();
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (const char c : data)
+        {
+            crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    std::string deflate(const std::string& data)
+    {
+        std::string out;
+        bit_writer writer(out);
+        writer.bits(1, 1); // Last block
+        writer.bits(1, 2); // Fixed Huffman codes
+
+        // head[h] is the latest position whose next three bytes hash to h and prev[p % WINDOW_SIZE] the one before p
+        const size_t no_position = static_cast<size_t>(-1);
+        std::vector<size_t> head(size_t(1) << HASH_BITS, no_position);
+        std::vector<size_t> prev(WINDOW_SIZE, no_position);
+        const auto hash_at = [&](const size_t pos)
+            {
+                const uint32_t v = static_cast<uint8_t>(data[pos]) << 16 | static_cast<uint8_t>(data[pos + 1]) << 8 | static_cast<uint8_t>(data[pos + 2]);
+                return (v * 2654435761u) >> (32 - HASH_BITS);
+            };
+        const auto insert = [&](const size_t pos)
+            {
+                if (pos + MIN_MATCH <= data.size())
+                {
+                    const uint32_t h = hash_at(pos);
+                    prev[pos % WINDOW_SIZE] = head[h];
+                    head[h] = pos;
+                }
+            };
+
+        size_t pos = 0;
+        while (pos < data.size())
+        {
+            size_t best_length = 0;
+            size_t best_distance = 0;
+            if (pos + MIN_MATCH <= data.size())
+            {
+                const size_t max_length = std::min(MAX_MATCH, data.size() - pos);
+                size_t candidate = head[hash_at(pos)];
+                for (size_t chain = 0; candidate != no_position && pos - candidate <= WINDOW_SIZE && chain < MAX_CHAIN; ++chain)
+                {
+                    size_t length = 0;
+                    while (length < max_length && data[candidate + length] == data[pos + length])
+                    {
+                        ++length;
+                    }
+                    if (length > best_length)
+                    {
+                        best_length = length;
+                        best_distance = pos - candidate;
+                        if (length == max_length)
+                            break;
+                    }
+
+                    const size_t before = prev[candidate % WINDOW_SIZE];
+                    if (before == no_position || before >= candidate)
+                        break;
+                    candidate = before;
+                }
+            }
+
+            if (best_length >= MIN_MATCH)
+            {
+                write_match(writer, best_length, best_distance);
+                for (size_t i = 0; i < best_length; ++i)
+                {
+                    insert(pos + i);
+                }
+                pos += best_length;
+            }
+            else
+            {
+                write_literal_or_length_symbol(writer, static_cast<uint8_t>(data[pos]));
+                insert(pos);
+                ++pos;
+            }
+        }
+
+        write_literal_or_length_symbol(writer, 256); // End of block
+        writer.finish();
+        return out;
+    }
+
+    std::string compress(const std::string& data)
+    {
+        // ID1 ID2, deflate, no flags, no modification time, no extra flags, unknown OS
+        std::string out = {'\x1f', '\x8b', '\x08', '\0', '\0', '\0', '\0', '\0', '\0', '\xff'};
+        out.append(deflate(data));
+        write_le32(out, crc32(data));
+        write_le32(out, static_cast<uint32_t>(data.size()));
+        return out;
+    }
+
+    namespace
+    {
+        class bit_reader
+        {
+        public:
+            bit_reader(const char* data, const size_t size) : data(data), size(size), pos(0), buffer(0), count(0), overrun(false)
+            {
+            }
+
+            // Reading past the end yields zeros and sets overrun, which the caller checks once per block
+            uint32_t bits(const int length)
+            {
+                while (this->count < length)
+                {
+                    if (this->pos == this->size)
+                    {
+                        this->overrun = true;
+                        return 0;
+                    }
+                    this->buffer |= static_cast<uint32_t>(static_cast<uint8_t>(this->data[this->pos++])) << this->count;
+                    this->count += 8;
+                }
+                const uint32_t value = this->buffer & ((uint32_t(1) << length) - 1);
+                this->buffer >>= length;
+                this->count -= length;
+                return value;
+            }
+
+            // Stored blocks start on a byte boundary; the bits left in the buffer never make up a whole byte
+            void align()
+            {
+                this->buffer = 0;
+                this->count = 0;
+            }
+
+            const char* data;
+            size_t size;
+            size_t pos;
+            uint32_t buffer;
+            int count;
+            bool overrun;
+        };
+
+        // A canonical Huffman code: how many codes there are of each length, and the symbols in code order
+        struct huffman_code
+        {
+            uint16_t count[16];
+            uint16_t symbol[288];
+        };
+
+        bool build_huffman_code(huffman_code& code, const uint8_t* lengths, const size_t symbol_count)
+        {
+            std::fill(std::begin(code.count), std::end(code.count), uint16_t(0));
+            for (size_t s = 0; s < symbol_count; ++s)
+            {
+                ++code.count[lengths[s]];
+            }
+            code.count[0] = 0;
+
+            int left = 1;
+            for (int length = 1; length < 16; ++length)
+            {
+                left <<= 1;
+                left -= code.count[length];
+                if (left < 0)
+                    return false; // More codes than there is room for
+            }
+
+            uint16_t offsets[16];
+            offsets[1] = 0;
+            for (int length = 1; length < 15; ++length)
+            {
+                offsets[length + 1] = offsets[length] + code.count[length];
+            }
+            for (size_t s = 0; s < symbol_count; ++s)
+            {
+                if (lengths[s] != 0)
+                    code.symbol[offsets[lengths[s]]++] = static_cast<uint16_t>(s);
+            }
+            return true;
+        }
+
+        // Returns -1 for a bit sequence that is not a code
+        int decode_symbol(bit_reader& reader, const huffman_code& code)
+        {
+            int bits = 0;
+            int first = 0;
+            int index = 0;
+            for (int length = 1; length < 16; ++length)
+            {
+                bits |= static_cast<int>(reader.bits(1));
+                const int count = code.count[length];
+                if (bits - first < count)
+                    return code.symbol[index + bits - first];
+                index += count;
+                first = (first + count) << 1;
+                bits <<= 1;
+            }
+            return -1;
+        }
+
+        bool inflate_codes(bit_reader& reader, const huffman_code& literals, const huffman_code& distances, std::string& out)
+        {
+            for (;;)
+            {
+                const int symbol = decode_symbol(reader, literals);
+                if (symbol < 0 || reader.overrun)
+                    return false;
+                if (symbol < 256)
+                {
+                    out.push_back(static_cast<char>(symbol));
+                    continue;
+                }
+                if (symbol == 256)
+                    return true;
+
+                const int length_code = symbol - 257;
+                if (length_code >= 29)
+                    return false;
+                const size_t length = LENGTH_BASE[length_code] + reader.bits(LENGTH_EXTRA[length_code]);
+
+                const int distance_code = decode_symbol(reader, distances);
+                if (distance_code < 0 || distance_code >= 30)
+                    return false;
+                const size_t distance = DISTANCE_BASE[distance_code] + reader.bits(DISTANCE_EXTRA[distance_code]);
+                if (distance > out.size() || reader.overrun)
+                    return false;
+
+                // The match may overlap the bytes it produces
+                for (size_t i = 0; i < length; ++i)
+                {
+                    out.push_back(out[out.size() - distance]);
+                }
+            }
+        }
+
+        bool inflate_dynamic_block(bit_reader& reader, std::string& out)
+        {
+            static const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+            const size_t literal_count = reader.bits(5) + 257;
+            const size_t distance_count = reader.bits(5) + 1;
+            const size_t code_length_count = reader.bits(4) + 4;
+            if (literal_count > 286 || distance_count > 30)
+                return false;
+
+            uint8_t lengths[286 + 30] = {};
+            for (size_t i = 0; i < code_length_count; ++i)
+            {
+                lengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(reader.bits(3));
+            }
+            huffman_code code_lengths;
+            if (!build_huffman_code(code_lengths, lengths, 19))
+                return false;
+
+            std::fill(std::begin(lengths), std::end(lengths), uint8_t(0));
+            for (size_t i = 0; i < literal_count + distance_count;)
+            {
+                const int symbol = decode_symbol(reader, code_lengths);
+                if (symbol < 0 || reader.overrun)
+                    return false;
+                if (symbol < 16)
+                {
+                    lengths[i++] = static_cast<uint8_t>(symbol);
+                    continue;
+                }
+
+                uint8_t repeated = 0;
+                size_t repeat;
+                if (symbol == 16)
+                {
+                    if (i == 0)
+                        return false;
+                    repeated = lengths[i - 1];
+                    repeat = 3 + reader.bits(2);
+                }
+                else if (symbol == 17)
+                    repeat = 3 + reader.bits(3);
+                else
+                    repeat = 11 + reader.bits(7);
+
+                if (i + repeat > literal_count + distance_count)
+                    return false;
+                while (repeat-- != 0)
+                {
+                    lengths[i++] = repeated;
+                }
+            }
+            if (lengths[256] == 0)
+                return false; // No end of block code
+
+            huffman_code literals;
+            huffman_code distances;
+            return build_huffman_code(literals, lengths, literal_count)
+                && build_huffman_code(distances, lengths + literal_count, distance_count)
+                && inflate_codes(reader, literals, distances, out);
+        }
+    }
+
+    bool inflate(const char* data, const size_t size, std::string& out)
+    {
+        static const std::pair<huffman_code, huffman_code> fixed_codes = []()
+            {
+                uint8_t lengths[288];
+                std::fill(lengths, lengths + 144, uint8_t(8));
+                std::fill(lengths + 144, lengths + 256, uint8_t(9));
+                std::fill(lengths + 256, lengths + 280, uint8_t(7));
+                std::fill(lengths + 280, lengths + 288, uint8_t(8));
+                std::pair<huffman_code, huffman_code> codes;
+                build_huffman_code(codes.first, lengths, 288);
+                std::fill(lengths, lengths + 30, uint8_t(5));
+                build_huffman_code(codes.second, lengths, 30);
+                return codes;
+            }();
+
+        out.clear();
+        bit_reader reader(data, size);
+        bool last_block;
+        do
+        {
+            last_block = reader.bits(1) != 0;
+            const uint32_t type = reader.bits(2);
+            bool ok;
+            if (type == 0)
+            {
+                reader.align();
+                if (reader.size - reader.pos < 4)
+                    return false;
+                const uint8_t* header = reinterpret_cast<const uint8_t*>(reader.data + reader.pos);
+                const size_t length = header[0] | header[1] << 8;
+                const size_t complement = header[2] | header[3] << 8;
+                reader.pos += 4;
+                ok = length == (~complement & 0xFFFF) && reader.size - reader.pos >= length;
+                if (ok)
+                {
+                    out.append(reader.data + reader.pos, length);
+                    reader.pos += length;
+                }
+            }
+            else if (type == 1)
+                ok = inflate_codes(reader, fixed_codes.first, fixed_codes.second, out);
+            else if (type == 2)
+                ok = inflate_dynamic_block(reader, out);
+            else
+                ok = false;
+
+            if (!ok || reader.overrun)
+                return false;
+        } while (!last_block);
+        return true;
+    }
+}}
@@ -0,0 +1,345 @@
+#include "vcpkg_Hash.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "vcpkg_Files.h"
+#include "vcpkg_Parallel.h"
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <bcrypt.h>
+
+#pragma comment(lib, "bcrypt")
+
+namespace fs = std::tr2::sys;
+
+namespace vcpkg {namespace Hash
+{
+    namespace
+    {
+        class hasher
+        {
+        public:
+            explicit hasher(const std::wstring& hash_type)
+            {
+                NTSTATUS status = BCryptOpenAlgorithmProvider(&this->algorithm, hash_type.c_str(), nullptr, 0);
+                Checks::check_throw(BCRYPT_SUCCESS(status), "Unknown hash algorithm: %s", Strings::utf16_to_utf8(hash_type));
+
+                ULONG hash_length = 0;
+                ULONG bytes_written = 0;
+                BCryptGetProperty(this->algorithm, BCRYPT_HASH_LENGTH, reinterpret_cast<PUCHAR>(&hash_length), sizeof(hash_length), &bytes_written, 0);
+                this->hash_buffer.resize(hash_length);
+
+                status = BCryptCreateHash(this->algorithm, &this->hash, nullptr, 0, nullptr, 0, 0);
+                Checks::check_throw(BCRYPT_SUCCESS(status), "Failed to initialize hash algorithm: %s", Strings::utf16_to_utf8(hash_type));
+            }
+
+            hasher(const hasher&) = delete;
+            hasher& operator=(const hasher&) = delete;
+
+            ~hasher()
+            {
+                if (this->hash != nullptr)
+                    BCryptDestroyHash(this->hash);
+                if (this->algorithm != nullptr)
+                    BCryptCloseAlgorithmProvider(this->algorithm, 0);
+            }
+
+            void add_bytes(const void* data, const size_t size)
+            {
+                BCryptHashData(this->hash, static_cast<PUCHAR>(const_cast<void*>(data)), static_cast<ULONG>(size), 0);
+            }
+
+            std::string get_hash()
+            {
+                BCryptFinishHash(this->hash, this->hash_buffer.data(), static_cast<ULONG>(this->hash_buffer.size()), 0);
+
+                static const char HEX_DIGITS[] = "0123456789abcdef";
+                std::string output;
+                output.reserve(this->hash_buffer.size() * 2);
+                for (const UCHAR byte : this->hash_buffer)
+                {
+                    output.push_back(HEX_DIGITS[byte >> 4]);
+                    output.push_back(HEX_DIGITS[byte & 0xF]);
+                }
+                return output;
+            }
+
+        private:
+            BCRYPT_ALG_HANDLE algorithm = nullptr;
+            BCRYPT_HASH_HANDLE hash = nullptr;
+            std::vector<UCHAR> hash_buffer;
+        };
+
+        // Streaming XXH64, as specified at https://github.com/Cyan4973/xxHash
+        class xxh64_hasher
+        {
+        public:
+            void add_bytes(const void* data, size_t size)
+            {
+                const unsigned char* p = static_cast<const unsigned char*>(data);
+                this->total_size += size;
+
+                if (this->buffered != 0)
+                {
+                    const size_t taken = std::min(size, sizeof(this->buffer) - this->buffered);
+                    memcpy(this->buffer + this->buffered, p, taken);
+                    this->buffered += taken;
+                    p += taken;
+                    size -= taken;
+                    if (this->buffered < sizeof(this->buffer))
+                        return;
+                    consume_stripe(this->buffer);
+                    this->buffered = 0;
+                }
+
+                for (; size >= sizeof(this->buffer); p += sizeof(this->buffer), size -= sizeof(this->buffer))
+                {
+                    consume_stripe(p);
+                }
+
+                memcpy(this->buffer, p, size);
+                this->buffered = size;
+            }
+
+            std::string get_hash() const
+            {
+                uint64_t h;
+                if (this->total_size >= sizeof(this->buffer))
+                {
+                    h = rotl(this->v[0], 1) + rotl(this->v[1], 7) + rotl(this->v[2], 12) + rotl(this->v[3], 18);
+                    for (const uint64_t lane : this->v)
+                    {
+                        h = (h ^ round(0, lane)) * P1 + P4;
+                    }
+                }
+                else
+                {
+                    h = P5;
+                }
+                h += this->total_size;
+
+                const unsigned char* p = this->buffer;
+                size_t remaining = this->buffered;
+                for (; remaining >= 8; p += 8, remaining -= 8)
+                {
+                    h = rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+                }
+                if (remaining >= 4)
+                {
+                    h = rotl(h ^ (read32(p) * P1), 23) * P2 + P3;
+                    p += 4;
+                    remaining -= 4;
+                }
+                for (; remaining != 0; ++p, --remaining)
+                {
+                    h = rotl(h ^ (*p * P5), 11) * P1;
+                }
+
+                h ^= h >> 33;
+                h *= P2;
+                h ^= h >> 29;
+                h *= P3;
+                h ^= h >> 32;
+
+                static const char HEX_DIGITS[] = "0123456789abcdef";
+                std::string output(16, '0');
+                for (size_t i = 16; i-- != 0; h >>= 4)
+                {
+                    output[i] = HEX_DIGITS[h & 0xF];
+                }
+                return output;
+            }
+
+        private:
+            static const uint64_t P1 = 11400714785074694791ULL;
+            static const uint64_t P2 = 14029467366897019727ULL;
+            static const uint64_t P3 = 1609587929392839161ULL;
+            static const uint64_t P4 = 9650029242287828579ULL;
+            static const uint64_t P5 = 2870177450012600261ULL;
+
+            static uint64_t rotl(const uint64_t x, const int r)
+            {
+                return (x << r) | (x >> (64 - r));
+            }
+
+            // Little-endian, like every target of vcpkg
+            static uint64_t read64(const unsigned char* p)
+            {
+                uint64_t x;
+                memcpy(&x, p, sizeof(x));
+                return x;
+            }
+
+            static uint64_t read32(const unsigned char* p)
+            {
+                uint32_t x;
+                memcpy(&x, p, sizeof(x));
+                return x;
+            }
+
+            static uint64_t round(uint64_t acc, const uint64_t input)
+            {
+                acc += input * P2;
+                return rotl(acc, 31) * P1;
+            }
+
+            void consume_stripe(const unsigned char* p)
+            {
+                for (size_t lane = 0; lane < 4; ++lane)
+                {
+                    this->v[lane] = round(this->v[lane], read64(p + 8 * lane));
+                }
+            }
+
+            uint64_t v[4] = {P1 + P2, P2, 0, 0 - P1};
+            unsigned char buffer[32];
+            size_t buffered = 0;
+            uint64_t total_size = 0;
+        };
+    }
+
+    struct streaming_hash::impl
+    {
+        explicit impl(const std::wstring& hash_type) : h(hash_type)
+        {
+        }
+
+        hasher h;
+    };
+
+    streaming_hash::streaming_hash(const std::wstring& hash_type) : m_impl(std::make_unique<impl>(hash_type))
+    {
+    }
+
+    streaming_hash::~streaming_hash() = default;
+
+    void streaming_hash::add_bytes(const void* data, const size_t size)
+    {
+        m_impl->h.add_bytes(data, size);
+    }
+
+    std::string streaming_hash::get_hash()
+    {
+        return m_impl->h.get_hash();
+    }
+
+    std::string get_string_hash(const std::string& s, const std::wstring& hash_type)
+    {
+        hasher h(hash_type);
+        h.add_bytes(s.data(), s.size());
+        return h.get_hash();
+    }
+
+    expected<std::string> get_file_hash(const fs::path& path, const std::wstring& hash_type) noexcept
+    {
+        // Hashing straight out of a mapping avoids copying the file through a stream buffer.
+        // The stream is kept for files that cannot be mapped, e.g. multi-GB archives in a 32-bit process.
+        expected<Files::mapped_file> mapping = Files::mapped_file::open(path);
+        if (const Files::mapped_file* file = mapping.get())
+        {
+            try
+            {
+                static const size_t CHUNK_SIZE = 64 * 1024 * 1024;
+                hasher h(hash_type);
+                for (size_t offset = 0; offset < file->size(); offset += CHUNK_SIZE)
+                {
+                    h.add_bytes(file->data() + offset, std::min(CHUNK_SIZE, file->size() - offset));
+                }
+
+                return h.get_hash();
+            }
+            catch (const std::exception&)
+            {
+                return std::errc::invalid_argument;
+            }
+        }
+
+        std::fstream file_stream(path, std::ios_base::in | std::ios_base::binary);
+        if (file_stream.fail())
+        {
+            return std::errc::no_such_file_or_directory;
+        }
+
+        try
+        {
+            hasher h(hash_type);
+            std::vector<char> buffer(1024 * 1024);
+            do
+            {
+                file_stream.read(buffer.data(), buffer.size());
+                h.add_bytes(buffer.data(), static_cast<size_t>(file_stream.gcount()));
+            }
+            while (file_stream);
+
+            return h.get_hash();
+        }
+        catch (const std::exception&)
+        {
+            return std::errc::invalid_argument;
+        }
+    }
+
+    std::vector<expected<std::string>> get_file_hashes(const std::vector<fs::path>& paths, const std::wstring& hash_type)
+    {
+        std::vector<expected<std::string>> hashes(paths.size(), std::string());
+        Parallel::for_each_index(paths.size(), [&](const size_t i)
+            {
+                hashes[i] = get_file_hash(paths[i], hash_type);
+            });
+        return hashes;
+    }
+
+    std::string get_string_xxh64(const std::string& s)
+    {
+        xxh64_hasher h;
+        h.add_bytes(s.data(), s.size());
+        return h.get_hash();
+    }
+
+    expected<file_digest> get_file_xxh64(const fs::path& path) noexcept
+    {
+        // Mapped like get_file_hash, and streamed when the file cannot be mapped
+        expected<Files::mapped_file> mapping = Files::mapped_file::open(path);
+        if (const Files::mapped_file* file = mapping.get())
+        {
+            try
+            {
+                xxh64_hasher h;
+                h.add_bytes(file->data(), file->size());
+                return file_digest{file->size(), h.get_hash()};
+            }
+            catch (const std::exception&)
+            {
+                return std::errc::invalid_argument;
+            }
+        }
+
+        std::fstream file_stream(path, std::ios_base::in | std::ios_base::binary);
+        if (file_stream.fail())
+        {
+            return std::errc::no_such_file_or_directory;
+        }
+
+        try
+        {
+            xxh64_hasher h;
+            uint64_t size = 0;
+            std::vector<char> buffer(1024 * 1024);
+            do
+            {
+                file_stream.read(buffer.data(), buffer.size());
+                const size_t read = static_cast<size_t>(file_stream.gcount());
+                h.add_bytes(buffer.data(), read);
+                size += read;
+            }
+            while (file_stream);
+
+            return file_digest{size, h.get_hash()};
+        }
+        catch (const std::exception&)
+        {
+            return std::errc::invalid_argument;
+        }
+    }
+}}
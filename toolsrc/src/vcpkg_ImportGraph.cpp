@@ -0,0 +1,273 @@
+#include "vcpkg_ImportGraph.h"
+#include "coff_file_reader.h"
+#include "Listfile.h"
+#include "Paragraphs.h"
+#include "SourceParagraph.h"
+#include "vcpkglib_helpers.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include <fstream>
+#include <set>
+#include <sstream>
+
+namespace vcpkg {namespace ImportGraph
+{
+    // Sits next to the DLLs it describes, so the debug and release bin directories each keep their own
+    static const char* GRAPH_FILENAME = ".vcpkg-applocal";
+
+    // Bump when the layout of a graph entry changes; a graph file with another version is discarded
+    static const std::string GRAPH_VERSION = "1";
+
+    // Bin directories of a triplet, relative to installed/<triplet>
+    static const std::vector<std::string> BIN_DIRS = {"bin", "debug/bin"};
+
+    namespace GraphField
+    {
+        static const std::string GRAPH_VERSION = "Applocal-Cache-Version";
+        static const std::string DLL = "Dll";
+        static const std::string SIZE = "Size";
+        static const std::string MTIME = "Mtime";
+        static const std::string IMPORTS = "Imports";
+    }
+
+    static std::string get_mtime(const fs::path& file, std::error_code& ec)
+    {
+        const auto mtime = fs::last_write_time(file, ec);
+        return ec ? std::string() : std::to_string(mtime.time_since_epoch().count());
+    }
+
+    static bool is_dll(const fs::path& path)
+    {
+        return Strings::ascii_to_lowercase(path.extension().string()) == ".dll";
+    }
+
+    static graph scan_bin_dir(const fs::path& bin_dir)
+    {
+        graph dlls;
+        std::error_code ec;
+        for (auto it = fs::directory_iterator(bin_dir, ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+        {
+            const fs::path& path = it->path();
+            if (!is_dll(path))
+            {
+                continue;
+            }
+
+            dll_node node;
+            node.path = path;
+            std::error_code file_ec;
+            node.size = std::to_string(fs::file_size(path, file_ec));
+            node.mtime = get_mtime(path, file_ec);
+            if (file_ec)
+            {
+                continue;
+            }
+
+            dlls.emplace(Strings::ascii_to_lowercase(path.filename().string()), std::move(node));
+        }
+        return dlls;
+    }
+
+    bool load(const fs::path& bin_dir, graph& dlls)
+    {
+        dlls = scan_bin_dir(bin_dir);
+
+        const expected<std::string> contents = Files::get_contents(bin_dir / GRAPH_FILENAME);
+        const std::string* text = contents.get();
+        if (text == nullptr)
+        {
+            return false;
+        }
+
+        try
+        {
+            std::vector<std::unordered_map<std::string, std::string>> pghs = Paragraphs::parse_paragraphs(*text);
+            if (pghs.empty() || details::optional_field(pghs[0], GraphField::GRAPH_VERSION) != GRAPH_VERSION)
+            {
+                return false;
+            }
+
+            for (size_t i = 1; i < pghs.size(); ++i)
+            {
+                const std::unordered_map<std::string, std::string>& fields = pghs[i];
+                const auto it = dlls.find(details::optional_field(fields, GraphField::DLL));
+                if (it == dlls.end() || it->second.size != details::optional_field(fields, GraphField::SIZE) ||
+                    it->second.mtime != details::optional_field(fields, GraphField::MTIME))
+                {
+                    continue;
+                }
+
+                it->second.imports = parse_depends(details::optional_field(fields, GraphField::IMPORTS));
+                it->second.has_imports = true;
+            }
+        }
+        catch (std::runtime_error const&)
+        {
+            for (auto&& kv : dlls)
+            {
+                kv.second.imports.clear();
+                kv.second.has_imports = false;
+            }
+            return false;
+        }
+
+        return true;
+    }
+
+    // The graph file only saves parsing time: failing to write it is not an error
+    void store(const fs::path& bin_dir, const graph& dlls)
+    {
+        std::ostringstream os;
+        os << GraphField::GRAPH_VERSION << ": " << GRAPH_VERSION << "\n";
+        for (auto&& kv : dlls)
+        {
+            const dll_node& node = kv.second;
+            if (!node.has_imports)
+            {
+                continue;
+            }
+
+            os << "\n";
+            os << GraphField::DLL << ": " << kv.first << "\n";
+            os << GraphField::SIZE << ": " << node.size << "\n";
+            os << GraphField::MTIME << ": " << node.mtime << "\n";
+            if (!node.imports.empty())
+            {
+                os << GraphField::IMPORTS << ": " << Strings::join(node.imports, ", ") << "\n";
+            }
+        }
+
+        // Builds run applocal concurrently: each process writes its own temporary file, which replaces the graph whole
+        Files::write_contents_atomically(bin_dir / GRAPH_FILENAME, os.str());
+    }
+
+    std::vector<const dll_node*> closure(graph& dlls, const std::vector<std::string>& roots, bool& changed)
+    {
+        // Imports that are not in dlls are system DLLs or come from elsewhere, and are not followed
+        std::vector<std::string> pending(roots.crbegin(), roots.crend());
+        std::set<std::string> visited;
+        std::vector<const dll_node*> needed;
+        while (!pending.empty())
+        {
+            const std::string name = Strings::ascii_to_lowercase(pending.back());
+            pending.pop_back();
+
+            const auto it = dlls.find(name);
+            if (it == dlls.end() || !visited.insert(name).second)
+            {
+                continue;
+            }
+
+            dll_node& node = it->second;
+            if (!node.has_imports)
+            {
+                node.imports = COFFFileReader::read_dll_imports(node.path);
+                node.has_imports = true;
+                changed = true;
+            }
+
+            needed.push_back(&node);
+            pending.insert(pending.end(), node.imports.crbegin(), node.imports.crend());
+        }
+        return needed;
+    }
+
+    // One line per DLL, "<bin dir>/<dll>: <import>, <import>", with the bin dir relative to installed/<triplet>
+    static void write_importsfile(const vcpkg_paths& paths, const BinaryParagraph& pgh)
+    {
+        const std::string triplet_prefix = pgh.spec.target_triplet().canonical_name() + "/";
+        const fs::path installed_triplet_dir = paths.installed / pgh.spec.target_triplet().canonical_name();
+
+        std::map<std::string, std::set<std::string>> bin_dir_contents;
+        for (const std::string& bin_dir : BIN_DIRS)
+        {
+            std::set<std::string>& names = bin_dir_contents[bin_dir];
+            for (auto&& kv : scan_bin_dir(installed_triplet_dir / bin_dir))
+            {
+                names.insert(kv.first);
+            }
+        }
+
+        std::ofstream os(paths.importsfile_path(pgh), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        Listfile::for_each_entry(paths.listfile_path(pgh), [&](const std::string& line, const Listfile::entry_type type)
+        {
+            if (type == Listfile::entry_type::directory || line.compare(0, triplet_prefix.size(), triplet_prefix) != 0)
+            {
+                return;
+            }
+
+            const fs::path relative_path = line.substr(triplet_prefix.size());
+            const auto bin_dir = bin_dir_contents.find(relative_path.parent_path().generic_string());
+            if (bin_dir == bin_dir_contents.end() || !is_dll(relative_path))
+            {
+                return;
+            }
+
+            std::vector<std::string> resolved;
+            for (const std::string& import : COFFFileReader::read_dll_imports(installed_triplet_dir / relative_path))
+            {
+                if (bin_dir->second.count(Strings::ascii_to_lowercase(import)) != 0)
+                {
+                    resolved.push_back(import);
+                }
+            }
+
+            os << relative_path.generic_string() << ": " << Strings::join(resolved, ", ") << "\n";
+        });
+    }
+
+    void add_package(const vcpkg_paths& paths, const BinaryParagraph& pgh, const StatusParagraphs& status_db)
+    {
+        write_importsfile(paths, pgh);
+
+        const triplet& target_triplet = pgh.spec.target_triplet();
+        const fs::path installed_triplet_dir = paths.installed / target_triplet.canonical_name();
+
+        // Start from the graph files so DLLs of packages installed without an imports file keep what applocal learned
+        std::map<std::string, graph> graphs;
+        for (const std::string& bin_dir : BIN_DIRS)
+        {
+            load(installed_triplet_dir / bin_dir, graphs[bin_dir]);
+        }
+
+        for (const std::unique_ptr<StatusParagraph>& pkg : status_db)
+        {
+            if (pkg->state != install_state_t::installed || pkg->package.spec.target_triplet() != target_triplet)
+            {
+                continue;
+            }
+
+            std::ifstream importsfile(paths.importsfile_path(pkg->package), std::ios_base::in | std::ios_base::binary);
+            std::string line;
+            while (std::getline(importsfile, line))
+            {
+                const size_t separator = line.find(": ");
+                if (separator == std::string::npos)
+                {
+                    continue;
+                }
+
+                const fs::path relative_path = line.substr(0, separator);
+                const auto bin_dir = graphs.find(relative_path.parent_path().generic_string());
+                if (bin_dir == graphs.end())
+                {
+                    continue;
+                }
+
+                const auto node = bin_dir->second.find(Strings::ascii_to_lowercase(relative_path.filename().string()));
+                if (node == bin_dir->second.end())
+                {
+                    continue;
+                }
+
+                node->second.imports = parse_depends(line.substr(separator + 2));
+                node->second.has_imports = true;
+            }
+        }
+
+        for (auto&& kv : graphs)
+        {
+            store(installed_triplet_dir / kv.first, kv.second);
+        }
+    }
+}}
@@ -0,0 +1,65 @@
+#include "vcpkg_JobTokens.h"
+#include "vcpkg_Checks.h"
+#include <algorithm>
+#include <thread>
+#include <Windows.h>
+
+namespace vcpkg {namespace JobTokens
+{
+    // A named semaphore lives as long as some process has it open: the pool starts full again once no vcpkg runs
+    static const wchar_t* SEMAPHORE_NAME = L"vcpkg-job-tokens";
+
+    static HANDLE open_pool()
+    {
+        const LONG pool_size = static_cast<LONG>(std::max(1u, std::thread::hardware_concurrency()));
+        const HANDLE semaphore = CreateSemaphoreW(nullptr, pool_size, pool_size, SEMAPHORE_NAME);
+        Checks::check_exit(semaphore != nullptr, "Error: could not open the job token pool (error %d)", static_cast<int>(GetLastError()));
+        return semaphore;
+    }
+
+    token_set token_set::acquire(const size_t wanted)
+    {
+        const HANDLE semaphore = open_pool();
+        WaitForSingleObject(semaphore, INFINITE);
+
+        size_t count = 1;
+        while (count < wanted && WaitForSingleObject(semaphore, 0) == WAIT_OBJECT_0)
+        {
+            ++count;
+        }
+        return token_set(semaphore, count);
+    }
+
+    token_set::token_set(token_set&& other) noexcept : m_semaphore(other.m_semaphore), m_count(other.m_count)
+    {
+        other.m_semaphore = nullptr;
+        other.m_count = 0;
+    }
+
+    token_set& token_set::operator=(token_set&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            std::swap(m_semaphore, other.m_semaphore);
+            std::swap(m_count, other.m_count);
+        }
+        return *this;
+    }
+
+    token_set::~token_set()
+    {
+        release();
+    }
+
+    void token_set::release() noexcept
+    {
+        if (m_semaphore != nullptr)
+        {
+            ReleaseSemaphore(m_semaphore, static_cast<LONG>(m_count), nullptr);
+            CloseHandle(m_semaphore);
+            m_semaphore = nullptr;
+            m_count = 0;
+        }
+    }
+}}
@@ -0,0 +1,358 @@
+#include "vcpkg_Parallel.h"
+#include "vcpkg_Checks.h"
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace vcpkg { namespace Parallel
+{
+    namespace details
+    {
+        struct group_state
+        {
+            std::atomic<size_t> pending{0}; // Tasks run and not completed yet, including those waiting for others
+            std::atomic<bool> cancelled{false};
+            std::mutex error_mutex;
+            std::exception_ptr error; // Guarded by error_mutex
+        };
+
+        struct task_node
+        {
+            std::function<void()> f;
+            lane l;
+            std::shared_ptr<group_state> group;
+            std::atomic<size_t> unmet_count{0}; // Tasks to complete before this one is queued, plus one until run() returns
+
+            std::mutex mutex;
+            bool done = false;                                 // Guarded by mutex
+            std::vector<std::shared_ptr<task_node>> successors; // Guarded by mutex
+        };
+    }
+
+    using node_ptr = std::shared_ptr<details::task_node>;
+
+    static const int OUTSIDE_POOL = -1;
+    static const int IO_THREAD = -2;
+    // The queue of the computation thread this is, IO_THREAD, or OUTSIDE_POOL
+    static thread_local int t_worker = OUTSIDE_POOL;
+
+    struct work_queue
+    {
+        std::mutex mutex;
+        std::deque<node_ptr> tasks;
+    };
+
+    class pool
+    {
+    public:
+        pool()
+        {
+            const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+            cpu_workers = std::max(size_t(1), cores - 1);
+            io_workers = std::max(size_t(4), cores);
+
+            // One more queue, shared by the threads outside the pool
+            for (size_t i = 0; i <= cpu_workers; ++i)
+            {
+                cpu_queues.push_back(std::make_unique<work_queue>());
+            }
+
+            // Detached: a thread may exit the process while tasks run
+            for (size_t i = 0; i < cpu_workers; ++i)
+            {
+                std::thread([this, i]() { run_cpu_worker(static_cast<int>(i)); }).detach();
+            }
+            for (size_t i = 0; i < io_workers; ++i)
+            {
+                std::thread([this]() { run_io_worker(); }).detach();
+            }
+        }
+
+        size_t own_queue() const
+        {
+            return t_worker >= 0 ? static_cast<size_t>(t_worker) : cpu_workers;
+        }
+
+        void submit(node_ptr node)
+        {
+            if (node->l == lane::io)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(io_queue.mutex);
+                    io_queue.tasks.push_back(std::move(node));
+                    ++queued_io;
+                }
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                io_wake.notify_one();
+                return;
+            }
+
+            {
+                work_queue& queue = *cpu_queues[own_queue()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(std::move(node));
+                ++queued_cpu;
+            }
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            cpu_wake.notify_one();
+        }
+
+        // The newest task of the own queue, for its data is likely still in the cache, else the oldest of another
+        node_ptr take_cpu_task()
+        {
+            const size_t own = own_queue();
+            for (size_t k = 0; k < cpu_queues.size(); ++k)
+            {
+                work_queue& queue = *cpu_queues[(own + k) % cpu_queues.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty())
+                {
+                    continue;
+                }
+
+                node_ptr node;
+                if (k == 0)
+                {
+                    node = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else
+                {
+                    node = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                --queued_cpu;
+                return node;
+            }
+            return nullptr;
+        }
+
+        void execute(const node_ptr& node)
+        {
+            details::group_state& group = *node->group;
+            if (!group.cancelled)
+            {
+                try
+                {
+                    node->f();
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(group.error_mutex);
+                    if (!group.error)
+                    {
+                        group.error = std::current_exception();
+                    }
+                    group.cancelled = true;
+                }
+            }
+            node->f = nullptr;
+
+            std::vector<node_ptr> ready;
+            {
+                std::lock_guard<std::mutex> lock(node->mutex);
+                node->done = true;
+                for (node_ptr& successor : node->successors)
+                {
+                    if (--successor->unmet_count == 0)
+                    {
+                        ready.push_back(std::move(successor));
+                    }
+                }
+                node->successors.clear();
+            }
+            for (node_ptr& successor : ready)
+            {
+                submit(std::move(successor));
+            }
+
+            // The successors counted in pending already, so the group cannot look complete in between
+            if (--group.pending == 0)
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                cpu_wake.notify_all();
+            }
+        }
+
+        // Runs computation tasks until group has no pending task
+        void help_until_complete(const details::group_state& group)
+        {
+            while (group.pending != 0)
+            {
+                const node_ptr node = take_cpu_task();
+                if (node)
+                {
+                    execute(node);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                cpu_wake.wait(lock, [&]() { return group.pending == 0 || queued_cpu != 0; });
+            }
+        }
+
+        size_t cpu_workers;
+        size_t io_workers;
+
+    private:
+        void run_cpu_worker(const int index)
+        {
+            t_worker = index;
+            for (;;)
+            {
+                const node_ptr node = take_cpu_task();
+                if (node)
+                {
+                    execute(node);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                cpu_wake.wait(lock, [&]() { return queued_cpu != 0; });
+            }
+        }
+
+        void run_io_worker()
+        {
+            t_worker = IO_THREAD;
+            for (;;)
+            {
+                node_ptr node;
+                {
+                    std::lock_guard<std::mutex> lock(io_queue.mutex);
+                    if (!io_queue.tasks.empty())
+                    {
+                        node = std::move(io_queue.tasks.front());
+                        io_queue.tasks.pop_front();
+                        --queued_io;
+                    }
+                }
+                if (node)
+                {
+                    execute(node);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                io_wake.wait(lock, [&]() { return queued_io != 0; });
+            }
+        }
+
+        std::vector<std::unique_ptr<work_queue>> cpu_queues;
+        work_queue io_queue;
+        // Changed under the lock of a queue and read under sleep_mutex, so a thread going to sleep cannot miss a task
+        std::atomic<size_t> queued_cpu{0};
+        std::atomic<size_t> queued_io{0};
+
+        std::mutex sleep_mutex;
+        std::condition_variable cpu_wake; // Also notified whenever a group completes
+        std::condition_variable io_wake;
+    };
+
+    // Never destroyed, as its threads are never joined
+    static pool& get_pool()
+    {
+        static pool* p = new pool();
+        return *p;
+    }
+
+    size_t concurrency(const lane l)
+    {
+        const pool& p = get_pool();
+        return l == lane::io ? p.io_workers : p.cpu_workers;
+    }
+
+    bool on_pool_thread()
+    {
+        return t_worker != OUTSIDE_POOL;
+    }
+
+    task_group::task_group() : m_state(std::make_shared<details::group_state>())
+    {
+    }
+
+    task_group::~task_group()
+    {
+        get_pool().help_until_complete(*m_state);
+    }
+
+    task task_group::run(std::function<void()> f, const lane l, const std::vector<task>& after)
+    {
+        auto node = std::make_shared<details::task_node>();
+        node->f = std::move(f);
+        node->l = l;
+        node->group = m_state;
+        node->unmet_count = after.size() + 1;
+        ++m_state->pending;
+
+        for (const task& predecessor : after)
+        {
+            if (!predecessor.m_node)
+            {
+                --node->unmet_count;
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(predecessor.m_node->mutex);
+            if (predecessor.m_node->done)
+            {
+                --node->unmet_count;
+            }
+            else
+            {
+                predecessor.m_node->successors.push_back(node);
+            }
+        }
+
+        if (--node->unmet_count == 0)
+        {
+            get_pool().submit(node);
+        }
+
+        task t;
+        t.m_node = std::move(node);
+        return t;
+    }
+
+    void task_group::cancel()
+    {
+        m_state->cancelled = true;
+    }
+
+    bool task_group::is_cancelled() const
+    {
+        return m_state->cancelled;
+    }
+
+    void task_group::wait()
+    {
+        get_pool().help_until_complete(*m_state);
+
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(m_state->error_mutex);
+            error.swap(m_state->error);
+        }
+        if (!error)
+        {
+            return;
+        }
+
+        try
+        {
+            std::rethrow_exception(error);
+        }
+        catch (const task_failed&)
+        {
+            // The message has been printed by the task
+            if (!on_pool_thread() && !Checks::failures_throw_on_this_thread())
+            {
+                exit(EXIT_FAILURE);
+            }
+            throw;
+        }
+    }
+}}
@@ -0,0 +1,362 @@
+#include "vcpkg_Server.h"
+#include "BatchQuery.h"
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include "vcpkg_Commands.h"
+#include "vcpkg_Parallel.h"
+#include "vcpkg_Strings.h"
+#include "vcpkg_System.h"
+#include "PortsIndex.h"
+#include "PackagesIndex.h"
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+namespace vcpkg {namespace Server
+{
+    // Bump when the layout of requests or replies changes; a server only answers requests of its own version
+    static const std::string PROTOCOL_VERSION = "vcpkg-server 1";
+    static const std::string REPLY_OK = "ok\n";
+
+    static const DWORD PIPE_BUFFER_SIZE = 64 * 1024;
+    static const DWORD CONNECT_TIMEOUT_MS = 2000;
+
+    // One server per vcpkg root. FNV-1a of the lowercased root rather than std::hash, which may differ between builds.
+    static std::wstring pipe_name(const vcpkg_paths& paths)
+    {
+        const std::string root = Strings::ascii_to_lowercase(fs::absolute(paths.root).generic_string());
+        uint64_t hash = 14695981039346656037ull;
+        for (const char c : root)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return LR"(\\.\pipe\vcpkg-)" + std::to_wstring(hash);
+    }
+
+    static bool write_message(HANDLE pipe, const std::string& message)
+    {
+        DWORD written = 0;
+        return WriteFile(pipe, message.data(), static_cast<DWORD>(message.size()), &written, nullptr) && written == message.size();
+    }
+
+    static bool read_message(HANDLE pipe, std::string& message)
+    {
+        char buffer[4096];
+        for (;;)
+        {
+            DWORD read = 0;
+            const BOOL done = ReadFile(pipe, buffer, sizeof(buffer), &read, nullptr);
+            message.append(buffer, read);
+            if (done)
+            {
+                return true;
+            }
+            if (GetLastError() != ERROR_MORE_DATA)
+            {
+                return false;
+            }
+        }
+    }
+
+    namespace
+    {
+        // Signals every change to the files below a directory, so cached data is only reloaded when it can be stale
+        class directory_watch
+        {
+        public:
+            explicit directory_watch(const fs::path& dir)
+            {
+                static const DWORD FILTER = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+                handle = FindFirstChangeNotificationW(dir.wstring().c_str(), TRUE, FILTER);
+            }
+
+            directory_watch(const directory_watch&) = delete;
+            directory_watch& operator=(const directory_watch&) = delete;
+
+            ~directory_watch()
+            {
+                if (handle != INVALID_HANDLE_VALUE)
+                {
+                    FindCloseChangeNotification(handle);
+                }
+            }
+
+            // Rearms the watch before returning true, so a change made while the caller reloads is seen next time
+            bool changed()
+            {
+                if (handle == INVALID_HANDLE_VALUE)
+                {
+                    return true;
+                }
+                if (WaitForSingleObject(handle, 0) != WAIT_OBJECT_0)
+                {
+                    return false;
+                }
+                FindNextChangeNotification(handle);
+                return true;
+            }
+
+        private:
+            HANDLE handle;
+        };
+
+        class loaded_state
+        {
+        public:
+            explicit loaded_state(const vcpkg_paths& paths) : paths(paths), installed_watch(paths.vcpkg_dir), ports_watch(paths.ports), packages_watch(paths.packages)
+            {
+            }
+
+            const status_snapshot& status_db()
+            {
+                if (installed_watch.changed() || !loaded_status_db)
+                {
+                    loaded_files_index.reset();
+                    loaded_status_db = std::make_unique<status_snapshot>(load_status_snapshot(paths));
+                }
+                return *loaded_status_db;
+            }
+
+            const FilesIndex::files_index& files_index()
+            {
+                const status_snapshot& db = status_db();
+                if (!loaded_files_index)
+                {
+                    loaded_files_index = std::make_unique<FilesIndex::files_index>(FilesIndex::files_index::load(paths, db));
+                }
+                return *loaded_files_index;
+            }
+
+            const PortsIndex::search_index& ports_index()
+            {
+                if (ports_watch.changed() || !loaded_ports_index)
+                {
+                    loaded_ports_index = std::make_unique<PortsIndex::search_index>(PortsIndex::load_source_paragraphs(paths));
+                }
+                return *loaded_ports_index;
+            }
+
+            const std::vector<BinaryParagraph>& cached_packages()
+            {
+                if (packages_watch.changed() || !loaded_cached_packages)
+                {
+                    loaded_cached_packages = std::make_unique<std::vector<BinaryParagraph>>(PackagesIndex::load_binary_paragraphs(paths));
+                }
+                return *loaded_cached_packages;
+            }
+
+        private:
+            const vcpkg_paths& paths;
+            directory_watch installed_watch;
+            directory_watch ports_watch;
+            directory_watch packages_watch;
+            std::unique_ptr<status_snapshot> loaded_status_db;
+            std::unique_ptr<FilesIndex::files_index> loaded_files_index;
+            std::unique_ptr<PortsIndex::search_index> loaded_ports_index;
+            std::unique_ptr<std::vector<BinaryParagraph>> loaded_cached_packages;
+        };
+    }
+
+    // Prints the output of the command from the loaded state. Returns false, printing nothing, for the other commands.
+    static bool answer(const vcpkg_cmd_arguments& args, loaded_state& state)
+    {
+        if (args.command == "list")
+        {
+            print_installed_packages(state.status_db(), args.command_arguments);
+        }
+        else if (args.command == "search")
+        {
+            print_available_packages(state.ports_index(), args.command_arguments);
+        }
+        else if (args.command == "owns" && args.command_arguments.size() == 1)
+        {
+            print_owned_files(state.files_index(), args.command_arguments[0], args.check_and_get_optional_command_arguments({"--exact", "--suffix"}));
+        }
+        else if (args.command == "cache" && args.command_arguments.size() <= 1)
+        {
+            print_cached_packages(state.cached_packages(), args.command_arguments);
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    // Runs the command with the output of the print functions redirected into the reply. Arguments were already
+    // validated by the client. An empty reply tells the client to run the command itself.
+    static std::string handle_request(const std::string& request, loaded_state& state)
+    {
+        std::vector<std::string> lines;
+        std::istringstream is(request);
+        for (std::string line; std::getline(is, line);)
+        {
+            lines.push_back(std::move(line));
+        }
+        if (lines.size() < 2 || lines[0] != PROTOCOL_VERSION)
+        {
+            return std::string();
+        }
+
+        // The server outlives the queries it answers: a check that would exit fails only this one
+        const Checks::failures_throw failures_throw;
+        std::ostringstream output;
+        std::streambuf* const console = std::cout.rdbuf(output.rdbuf());
+        bool served;
+        try
+        {
+            const vcpkg_cmd_arguments args = vcpkg_cmd_arguments::create_from_arg_sequence(lines.data() + 1, lines.data() + lines.size());
+            served = answer(args, state);
+        }
+        catch (const std::exception& e)
+        {
+            std::cout.rdbuf(console);
+            System::println(System::color::error, "Error: %s failed: %s", lines[1], e.what());
+            return std::string();
+        }
+        catch (const Parallel::task_failed&)
+        {
+            // The error was printed into the output; it goes to the console of the server, and the client runs the
+            // command itself to report it
+            std::cout.rdbuf(console);
+            std::cout << output.str();
+            return std::string();
+        }
+        std::cout.rdbuf(console);
+
+        return served ? REPLY_OK + output.str() : std::string();
+    }
+
+    void run(const vcpkg_paths& paths)
+    {
+        const std::wstring name = pipe_name(paths);
+        HANDLE pipe = CreateNamedPipeW(name.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                       PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                       1, PIPE_BUFFER_SIZE, PIPE_BUFFER_SIZE, 0, nullptr);
+        Checks::check_exit(pipe != INVALID_HANDLE_VALUE, "Could not create %s. Is a server already running for this vcpkg root?", Strings::utf16_to_utf8(name));
+
+        loaded_state state(paths);
+        System::println("Serving list, search, owns and cache for %s. Press Ctrl+C to stop.", paths.root.generic_string());
+
+        // Clients are answered one at a time; each request is a single message
+        for (;;)
+        {
+            if (!ConnectNamedPipe(pipe, nullptr) && GetLastError() != ERROR_PIPE_CONNECTED)
+            {
+                DisconnectNamedPipe(pipe);
+                continue;
+            }
+
+            std::string request;
+            if (read_message(pipe, request))
+            {
+                write_message(pipe, handle_request(request, state));
+                FlushFileBuffers(pipe);
+            }
+            DisconnectNamedPipe(pipe);
+        }
+    }
+
+    static void print_result(const std::string& status, const std::string& output)
+    {
+        std::cout << BatchQuery::format_result(status, output);
+        std::cout.flush();
+    }
+
+    void run_batch(const vcpkg_paths& paths, std::istream& queries)
+    {
+        loaded_state state(paths);
+        for (std::string query; std::getline(queries, query);)
+        {
+            const std::vector<std::string> words = BatchQuery::split_query(query);
+            if (words.empty())
+            {
+                continue;
+            }
+
+            const std::string invalid_option = BatchQuery::find_invalid_option(words);
+            if (!invalid_option.empty())
+            {
+                print_result("error", Strings::format("%s does not take the option %s\n", words[0], invalid_option));
+                continue;
+            }
+
+            const Checks::failures_throw failures_throw;
+            std::ostringstream output;
+            std::streambuf* const console = std::cout.rdbuf(output.rdbuf());
+            bool answered;
+            std::string error;
+            try
+            {
+                const vcpkg_cmd_arguments args = vcpkg_cmd_arguments::create_from_arg_sequence(words.data(), words.data() + words.size());
+                answered = answer(args, state);
+            }
+            catch (const std::exception& e)
+            {
+                answered = false;
+                error = e.what();
+            }
+            catch (const Parallel::task_failed&)
+            {
+                // The error was printed into the output
+                answered = false;
+                error = output.str();
+                while (!error.empty() && error.back() == '\n')
+                {
+                    error.pop_back();
+                }
+            }
+            std::cout.rdbuf(console);
+
+            if (answered)
+            {
+                print_result("ok", output.str());
+            }
+            else if (!error.empty())
+            {
+                print_result("error", Strings::format("%s failed: %s\n", words[0], error));
+            }
+            else
+            {
+                print_result("error", Strings::format("%s is not a query, or not with these arguments: the queries are list, search, owns and cache\n", words[0]));
+            }
+        }
+    }
+
+    void forward_if_running(const vcpkg_paths& paths, const std::string& command, const std::vector<std::string>& arguments)
+    {
+        std::string request = PROTOCOL_VERSION + "\n" + command + "\n";
+        for (const std::string& argument : arguments)
+        {
+            if (argument.find('\n') != std::string::npos)
+            {
+                return;
+            }
+            request += argument + "\n";
+        }
+
+        const std::wstring name = pipe_name(paths);
+        HANDLE pipe = CreateFileW(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (pipe == INVALID_HANDLE_VALUE && GetLastError() == ERROR_PIPE_BUSY && WaitNamedPipeW(name.c_str(), CONNECT_TIMEOUT_MS))
+        {
+            pipe = CreateFileW(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        }
+        if (pipe == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        DWORD mode = PIPE_READMODE_MESSAGE;
+        std::string reply;
+        const bool answered = SetNamedPipeHandleState(pipe, &mode, nullptr, nullptr) && write_message(pipe, request) && read_message(pipe, reply);
+        CloseHandle(pipe);
+        if (!answered || reply.compare(0, REPLY_OK.size(), REPLY_OK) != 0)
+        {
+            return;
+        }
+
+        std::cout << reply.substr(REPLY_OK.size());
+        exit(EXIT_SUCCESS);
+    }
+}}
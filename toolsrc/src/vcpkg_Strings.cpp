@@ -1,10 +1,16 @@
 #include "vcpkg_Strings.h"
 
 #include <cstdarg>
+#include <cstring>
 #include <algorithm>
 #include <codecvt>
 #include <iterator>
 
+#if defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#include <intrin.h>
+#endif
+
 namespace vcpkg {namespace Strings {namespace details
 {
     std::string format_internal(const char* fmtstr, ...)
@@ -48,20 +54,100 @@ namespace vcpkg {namespace Strings
         return conversion.to_bytes(w);
     }
 
+    static char fold_ascii_case(const char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    // Compares size bytes of text, folded to lowercase, with the already lowercase pattern
+    static bool matches_at(const char* text, const char* lowercase_pattern, const size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (fold_ascii_case(text[i]) != lowercase_pattern[i])
+                return false;
+        }
+        return true;
+    }
+
+    case_insensitive_ascii_searcher::case_insensitive_ascii_searcher(const std::string& pattern) : lowercase_pattern(ascii_to_lowercase(pattern))
+    {
+    }
+
+    const char* case_insensitive_ascii_searcher::find(const char* begin, const char* end) const
+    {
+        const size_t pattern_size = lowercase_pattern.size();
+        if (pattern_size == 0)
+        {
+            return begin;
+        }
+        if (static_cast<size_t>(end - begin) < pattern_size)
+        {
+            return end;
+        }
+
+        // Candidates are the positions holding the first byte of the pattern in either case; the rest is compared there
+        const char first_lower = lowercase_pattern[0];
+        const char first_upper = first_lower >= 'a' && first_lower <= 'z' ? static_cast<char>(first_lower - ('a' - 'A')) : first_lower;
+        const char* const pattern = lowercase_pattern.data();
+        const char* const last_start = end - pattern_size;
+        const char* it = begin;
+
+#if defined(_M_X64) || defined(_M_IX86)
+        // SSE2 is part of x64, and the default target of the x86 compiler: test 16 candidates per instruction
+        const __m128i lower = _mm_set1_epi8(first_lower);
+        const __m128i upper = _mm_set1_epi8(first_upper);
+        while (last_start - it >= 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+            unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, lower), _mm_cmpeq_epi8(chunk, upper))));
+            while (mask != 0)
+            {
+                unsigned long bit;
+                _BitScanForward(&bit, mask);
+                if (matches_at(it + bit + 1, pattern + 1, pattern_size - 1))
+                    return it + bit;
+                mask &= mask - 1;
+            }
+            it += 16;
+        }
+#endif
+
+        for (; it <= last_start; ++it)
+        {
+            if ((*it == first_lower || *it == first_upper) && matches_at(it + 1, pattern + 1, pattern_size - 1))
+                return it;
+        }
+        return end;
+    }
+
     std::string::const_iterator case_insensitive_ascii_find(const std::string& s, const std::string& pattern)
     {
-        std::string pattern_as_lower_case;
-        std::transform(pattern.begin(), pattern.end(), back_inserter(pattern_as_lower_case), tolower);
-        return search(s.begin(), s.end(), pattern_as_lower_case.begin(), pattern_as_lower_case.end(), [](const char a, const char b)
-                      {
-                          return tolower(a) == b;
-                      });
+        const char* const found = case_insensitive_ascii_searcher(pattern).find(s.data(), s.data() + s.size());
+        return s.begin() + (found - s.data());
+    }
+
+    bool case_insensitive_ascii_equals(const std::string& left, const char* right)
+    {
+        const size_t size = strlen(right);
+        if (left.size() != size)
+            return false;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (fold_ascii_case(left[i]) != fold_ascii_case(right[i]))
+                return false;
+        }
+        return true;
     }
 
     std::string ascii_to_lowercase(const std::string& input)
     {
         std::string output = input;
-        std::transform(output.begin(), output.end(), output.begin(), ::tolower);
+        for (char& c : output)
+        {
+            c = fold_ascii_case(c);
+        }
         return output;
     }
 
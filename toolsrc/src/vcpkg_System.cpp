@@ -1,7 +1,13 @@
 #include "vcpkg_System.h"
+#include "Timings.h"
 #include <iostream>
 #include <Windows.h>
 #include <regex>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include <vector>
 
 namespace fs = std::tr2::sys;
 
@@ -18,6 +24,9 @@ namespace vcpkg {namespace System
 
     int cmd_execute(const wchar_t* cmd_line)
     {
+        // The child writes to the console directly
+        flush_console();
+
         // Basically we are wrapping it in quotes
         const std::wstring& actual_cmd_line = Strings::wformat(LR"###("%s")###", cmd_line);
         int exit_code = _wsystem(actual_cmd_line.c_str());
@@ -26,55 +35,363 @@ namespace vcpkg {namespace System
 
     exit_code_and_output cmd_execute_and_capture_output(const wchar_t* cmd_line)
     {
-        const std::wstring& actual_cmd_line = Strings::wformat(LR"###("%s")###", cmd_line);
+        // What _wpopen runs, read through the same pipe as process_execute
+        const std::wstring& actual_cmd_line = Strings::wformat(LR"###(cmd.exe /c "%s")###", cmd_line);
+        const exit_code_and_output result = process_execute_and_capture_output(actual_cmd_line);
+        return {result.exit_code == -1 ? 1 : result.exit_code, result.output};
+    }
+
+    // Calls on_chunk with the output of the child until it closes its end of the pipe
+    static int run_piped(const std::wstring& command_line, const fs::path& working_directory, const std::function<void(const char*, size_t)>& on_chunk, resource_usage* usage,
+                         const std::wstring& environment)
+    {
+        const Timings::scoped_timer timer("process_execute");
+        SECURITY_ATTRIBUTES inheritable = {sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+        HANDLE read_end = nullptr;
+        HANDLE write_end = nullptr;
+        if (!CreatePipe(&read_end, &write_end, &inheritable, 0))
+        {
+            return -1;
+        }
+        SetHandleInformation(read_end, HANDLE_FLAG_INHERIT, 0);
+
+        const HANDLE nul = CreateFileW(L"NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, &inheritable, OPEN_EXISTING, 0, nullptr);
+
+        // Without an explicit list, a child would also inherit the pipes of the children other threads are starting, and
+        // their readers would not see the end of the output until it exited too
+        HANDLE inherited[] = {write_end, nul};
+        SIZE_T attribute_list_size = 0;
+        InitializeProcThreadAttributeList(nullptr, 1, 0, &attribute_list_size);
+        std::vector<char> attribute_list_buffer(attribute_list_size);
+        const auto attribute_list = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attribute_list_buffer.data());
+        const bool have_attribute_list = nul != INVALID_HANDLE_VALUE
+            && InitializeProcThreadAttributeList(attribute_list, 1, 0, &attribute_list_size)
+            && UpdateProcThreadAttribute(attribute_list, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited, sizeof(inherited), nullptr, nullptr);
+
+        STARTUPINFOEXW startup_info = {};
+        startup_info.StartupInfo.cb = sizeof(startup_info);
+        startup_info.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+        startup_info.StartupInfo.hStdInput = nul;
+        startup_info.StartupInfo.hStdOutput = write_end;
+        startup_info.StartupInfo.hStdError = write_end;
+        startup_info.lpAttributeList = attribute_list;
+
+        std::wstring mutable_command_line = command_line;
+        const std::wstring directory = working_directory.wstring();
+        PROCESS_INFORMATION process_info = {};
+        // The child starts suspended so that it is in the job before it can start anything itself
+        const DWORD creation_flags = EXTENDED_STARTUPINFO_PRESENT | CREATE_NO_WINDOW | CREATE_UNICODE_ENVIRONMENT | (usage != nullptr ? CREATE_SUSPENDED : 0);
+        const BOOL started = have_attribute_list
+            && CreateProcessW(nullptr, &mutable_command_line[0], nullptr, nullptr, TRUE, creation_flags,
+                              environment.empty() ? nullptr : const_cast<wchar_t*>(environment.c_str()),
+                              directory.empty() ? nullptr : directory.c_str(), &startup_info.StartupInfo, &process_info);
+        const HANDLE job = started && usage != nullptr ? CreateJobObjectW(nullptr, nullptr) : nullptr;
+        if (usage != nullptr)
+        {
+            *usage = {};
+            usage->measured = job != nullptr && AssignProcessToJobObject(job, process_info.hProcess);
+        }
+        if (started && usage != nullptr)
+        {
+            ResumeThread(process_info.hThread);
+        }
+
+        if (have_attribute_list)
+            DeleteProcThreadAttributeList(attribute_list);
+        // Only the child may hold the write end now, so ReadFile fails once the child is gone
+        CloseHandle(write_end);
+        if (nul != INVALID_HANDLE_VALUE)
+            CloseHandle(nul);
+        if (!started)
+        {
+            CloseHandle(read_end);
+            return -1;
+        }
+        CloseHandle(process_info.hThread);
+
+        std::vector<char> chunk(64 * 1024);
+        DWORD bytes_read = 0;
+        while (ReadFile(read_end, chunk.data(), static_cast<DWORD>(chunk.size()), &bytes_read, nullptr) && bytes_read != 0)
+        {
+            on_chunk(chunk.data(), bytes_read);
+        }
+        CloseHandle(read_end);
+
+        DWORD exit_code = static_cast<DWORD>(-1);
+        WaitForSingleObject(process_info.hProcess, INFINITE);
+        GetExitCodeProcess(process_info.hProcess, &exit_code);
+        CloseHandle(process_info.hProcess);
 
+        if (job != nullptr)
+        {
+            if (usage->measured)
+            {
+                JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION accounting = {};
+                JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+                if (QueryInformationJobObject(job, JobObjectBasicAndIoAccountingInformation, &accounting, sizeof(accounting), nullptr))
+                {
+                    // In units of 100ns
+                    usage->cpu_ms = (accounting.BasicInfo.TotalUserTime.QuadPart + accounting.BasicInfo.TotalKernelTime.QuadPart) / 10000;
+                    usage->read_bytes = accounting.IoInfo.ReadTransferCount;
+                    usage->write_bytes = accounting.IoInfo.WriteTransferCount;
+                    usage->process_count = accounting.BasicInfo.TotalProcesses;
+                }
+                if (QueryInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits), nullptr))
+                {
+                    usage->peak_memory_bytes = limits.PeakJobMemoryUsed;
+                }
+            }
+            CloseHandle(job);
+        }
+        return static_cast<int>(exit_code);
+    }
+
+    int process_execute(const std::wstring& command_line, const std::function<void(const std::string&)>& on_line, const fs::path& working_directory, resource_usage* usage,
+                        const std::wstring& environment)
+    {
+        // Holds the start of a line whose end has not been read yet
+        std::string partial_line;
+        const int exit_code = run_piped(command_line, working_directory, [&](const char* data, const size_t size)
+            {
+                if (!on_line)
+                    return;
+
+                const char* const end = data + size;
+                for (const char* newline; (newline = std::find(data, end, '\n')) != end; data = newline + 1)
+                {
+                    partial_line.append(data, newline);
+                    if (!partial_line.empty() && partial_line.back() == '\r')
+                        partial_line.pop_back();
+                    on_line(partial_line);
+                    partial_line.clear();
+                }
+                partial_line.append(data, end);
+            }, usage, environment);
+
+        if (on_line && !partial_line.empty())
+        {
+            on_line(partial_line);
+        }
+        return exit_code;
+    }
+
+    exit_code_and_output process_execute_and_capture_output(const std::wstring& command_line, const fs::path& working_directory)
+    {
         std::string output;
-        char buf[1024];
-        auto pipe = _wpopen(actual_cmd_line.c_str(), L"r");
-        if (pipe == nullptr)
+        const int exit_code = run_piped(command_line, working_directory, [&](const char* data, const size_t size)
+            {
+                output.append(data, size);
+            }, nullptr, std::wstring());
+        return {exit_code, std::move(output)};
+    }
+
+    namespace
+    {
+        struct console_message
+        {
+            bool colored;
+            color c;
+            std::string text;
+            bool newline;
+        };
+
+        struct console_state
+        {
+            std::mutex mutex;
+            std::condition_variable wake_writer;
+            std::condition_variable written;
+
+            size_t async_count = 0;
+            bool stopping = false;
+            bool writing = false;
+            std::vector<console_message> queue;
+            std::string status_line;
+            bool status_changed = false;
+            bool hide_status = false;
+            std::thread writer;
+        };
+
+        // Never destroyed: a worker thread may still print while the process exits
+        console_state& console()
+        {
+            static console_state* state = new console_state();
+            return *state;
+        }
+
+        void write_message(const HANDLE console_handle, const WORD original_color, const console_message& message)
+        {
+            if (message.colored)
+            {
+                std::cout.flush();
+                SetConsoleTextAttribute(console_handle, static_cast<int>(message.c) | (original_color & 0xF0));
+                std::cout << message.text;
+                std::cout.flush();
+                SetConsoleTextAttribute(console_handle, original_color);
+            }
+            else
+            {
+                std::cout << message.text;
+            }
+
+            if (message.newline)
+            {
+                std::cout << "\n";
+            }
+        }
+
+        // The only thread writing to the console while an async_console exists
+        void run_console_writer(console_state& state)
+        {
+            const HANDLE console_handle = GetStdHandle(STD_OUTPUT_HANDLE);
+            CONSOLE_SCREEN_BUFFER_INFO info{};
+            const bool is_console = GetConsoleScreenBufferInfo(console_handle, &info) != 0;
+            const size_t width = is_console && info.dwSize.X > 1 ? static_cast<size_t>(info.dwSize.X - 1) : 0;
+            size_t shown_status_length = 0;
+
+            std::unique_lock<std::mutex> lock(state.mutex);
+            for (;;)
+            {
+                state.wake_writer.wait(lock, [&]() { return !state.queue.empty() || state.status_changed || state.hide_status || state.stopping; });
+                std::vector<console_message> messages;
+                messages.swap(state.queue);
+                const bool stopping = state.stopping;
+                const bool show_status = is_console && !state.hide_status && !stopping;
+                const std::string status_line = state.status_line.substr(0, width);
+                const bool redraw = !messages.empty() || state.status_changed || !show_status;
+                state.status_changed = false;
+                state.hide_status = false;
+                state.writing = true;
+                lock.unlock();
+
+                if (redraw && shown_status_length != 0)
+                {
+                    std::cout << '\r' << std::string(shown_status_length, ' ') << '\r';
+                    shown_status_length = 0;
+                }
+                for (const console_message& message : messages)
+                {
+                    write_message(console_handle, info.wAttributes, message);
+                }
+                if (redraw && show_status && !status_line.empty())
+                {
+                    std::cout << status_line;
+                    shown_status_length = status_line.size();
+                }
+                std::cout.flush();
+
+                lock.lock();
+                state.writing = false;
+                state.written.notify_all();
+                // Once more if the last batch put the status line back on the screen
+                if (stopping && state.queue.empty())
+                {
+                    return;
+                }
+            }
+        }
+
+        void write(const bool colored, const color c, std::string text, const bool newline)
+        {
+            console_state& state = console();
+            std::unique_lock<std::mutex> lock(state.mutex);
+            if (state.async_count != 0)
+            {
+                state.queue.push_back({colored, c, std::move(text), newline});
+                state.wake_writer.notify_one();
+                return;
+            }
+
+            // When the last async_console is going away, its writer may still be writing out the queue
+            state.written.wait(lock, [&]() { return state.queue.empty() && !state.writing; });
+            CONSOLE_SCREEN_BUFFER_INFO info{};
+            const HANDLE console_handle = GetStdHandle(STD_OUTPUT_HANDLE);
+            if (colored)
+            {
+                GetConsoleScreenBufferInfo(console_handle, &info);
+            }
+            write_message(console_handle, info.wAttributes, {colored, c, std::move(text), newline});
+        }
+    }
+
+    async_console::async_console()
+    {
+        console_state& state = console();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.async_count++ != 0)
+        {
+            return;
+        }
+
+        static std::once_flag flush_at_exit;
+        std::call_once(flush_at_exit, []() { atexit(flush_console); });
+        state.stopping = false;
+        state.writer = std::thread(run_console_writer, std::ref(state));
+    }
+
+    async_console::~async_console()
+    {
+        console_state& state = console();
+        std::thread writer;
         {
-            return {1, output};
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (--state.async_count != 0)
+            {
+                return;
+            }
+
+            state.stopping = true;
+            state.status_line.clear();
+            state.wake_writer.notify_one();
+            writer.swap(state.writer);
         }
-        while (fgets(buf, 1024, pipe))
+        writer.join();
+    }
+
+    void set_status_line(const std::string& line)
+    {
+        console_state& state = console();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.async_count == 0 || state.status_line == line)
         {
-            output.append(buf);
+            return;
         }
-        if (!feof(pipe))
+
+        state.status_line = line;
+        state.status_changed = true;
+        state.wake_writer.notify_one();
+    }
+
+    void flush_console()
+    {
+        console_state& state = console();
+        std::unique_lock<std::mutex> lock(state.mutex);
+        if (state.async_count != 0 && state.writer.get_id() != std::this_thread::get_id())
         {
-            return {1, output};
+            state.hide_status = true;
+            state.wake_writer.notify_one();
+            state.written.wait(lock, [&]() { return state.queue.empty() && !state.writing && !state.hide_status; });
         }
-        auto ec = _pclose(pipe);
-        return {ec, output};
+        std::cout.flush();
     }
 
     void print(const char* message)
     {
-        std::cout << message;
+        write(false, color::success, message, false);
     }
 
     void println(const char* message)
     {
-        print(message);
-        std::cout << "\n";
+        write(false, color::success, message, true);
     }
 
     void print(color c, const char* message)
     {
-        HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-
-        CONSOLE_SCREEN_BUFFER_INFO consoleScreenBufferInfo{};
-        GetConsoleScreenBufferInfo(hConsole, &consoleScreenBufferInfo);
-        auto original_color = consoleScreenBufferInfo.wAttributes;
-
-        SetConsoleTextAttribute(hConsole, static_cast<int>(c) | (original_color & 0xF0));
-        std::cout << message;
-        SetConsoleTextAttribute(hConsole, original_color);
+        write(true, c, message, false);
     }
 
     void println(color c, const char* message)
     {
-        print(c, message);
-        std::cout << "\n";
+        write(true, c, message, true);
     }
 
     std::wstring wdupenv_str(const wchar_t* varname) noexcept
@@ -89,23 +406,4 @@ namespace vcpkg {namespace System
         }
         return ret;
     }
-
-    void Stopwatch2::start()
-    {
-        static_assert(sizeof(start_time) == sizeof(LARGE_INTEGER), "");
-
-        QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&start_time));
-    }
-
-    void Stopwatch2::stop()
-    {
-        QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&end_time));
-        QueryPerformanceFrequency(reinterpret_cast<LARGE_INTEGER*>(&freq));
-    }
-
-    double Stopwatch2::microseconds() const
-    {
-        return (reinterpret_cast<const LARGE_INTEGER*>(&end_time)->QuadPart -
-            reinterpret_cast<const LARGE_INTEGER*>(&start_time)->QuadPart) * 1000000.0 / reinterpret_cast<const LARGE_INTEGER*>(&freq)->QuadPart;
-    }
 }}
@@ -0,0 +1,216 @@
+#include "vcpkg_Trace.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Strings.h"
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vcpkg { namespace Trace
+{
+    struct trace_event
+    {
+        std::string name;
+        std::string category;
+        long long start_us;
+        long long end_us;
+        size_t thread;
+        span_args args;
+    };
+
+    struct trace_state
+    {
+        std::mutex mutex;
+        bool enabled = false;
+        fs::path trace_file;
+        std::chrono::steady_clock::time_point start;
+        long long start_unix_us = 0;
+        std::vector<trace_event> events;
+        std::unordered_map<std::thread::id, size_t> thread_numbers;
+    };
+
+    static trace_state& state()
+    {
+        static trace_state s;
+        return s;
+    }
+
+    // Chrome shows one row per tid; small consecutive numbers keep the rows in order of first use
+    static size_t current_thread_number(trace_state& s)
+    {
+        auto it = s.thread_numbers.emplace(std::this_thread::get_id(), s.thread_numbers.size() + 1).first;
+        return it->second;
+    }
+
+    static void append_json_string(std::string& out, const std::string& value)
+    {
+        out.push_back('"');
+        for (const char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out.push_back('\\');
+                out.push_back(c);
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out.append(Strings::format("\\u%04x", static_cast<int>(c)));
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+        out.push_back('"');
+    }
+
+    // string(TIMESTAMP) has no epoch format in CMake 3.5, so the phases are written as calendar times
+    static bool parse_utc_time(const std::string& s, long long* seconds_since_epoch)
+    {
+        std::tm tm = {};
+        if (sscanf_s(s.c_str(), "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6)
+        {
+            return false;
+        }
+
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        *seconds_since_epoch = _mkgmtime(&tm);
+        return *seconds_since_epoch != -1;
+    }
+
+    void enable(const fs::path& trace_file)
+    {
+        trace_state& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.enabled = true;
+        s.trace_file = trace_file;
+        s.start = std::chrono::steady_clock::now();
+        s.start_unix_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    bool is_enabled()
+    {
+        trace_state& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.enabled;
+    }
+
+    long long now_us()
+    {
+        trace_state& s = state();
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s.start).count();
+    }
+
+    void record_span(const std::string& name, const std::string& category, const long long start_us, const long long end_us)
+    {
+        record_span(name, category, start_us, end_us, span_args());
+    }
+
+    void record_span(const std::string& name, const std::string& category, const long long start_us, const long long end_us, const span_args& args)
+    {
+        trace_state& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (!s.enabled)
+        {
+            return;
+        }
+
+        s.events.push_back({name, category, start_us, end_us, current_thread_number(s), args});
+    }
+
+    void record_cmake_phases(const fs::path& phases_file, const std::string& port)
+    {
+        const expected<std::string> contents = Files::get_contents(phases_file);
+        if (!contents.get())
+        {
+            return;
+        }
+
+        const long long start_unix_us = [] {
+            trace_state& s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            return s.start_unix_us;
+        }();
+
+        std::istringstream lines(*contents.get());
+        std::string phase;
+        std::string start;
+        std::string end;
+        long long start_s;
+        long long end_s;
+        while (lines >> phase >> start >> end)
+        {
+            if (!parse_utc_time(start, &start_s) || !parse_utc_time(end, &end_s))
+            {
+                continue;
+            }
+
+            record_span(port + ":" + phase, "port", start_s * 1000000 - start_unix_us, end_s * 1000000 - start_unix_us);
+        }
+    }
+
+    void flush()
+    {
+        trace_state& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (!s.enabled)
+        {
+            return;
+        }
+
+        std::string json = "{\"traceEvents\":[\n";
+        for (size_t i = 0; i < s.events.size(); ++i)
+        {
+            const trace_event& e = s.events[i];
+            json.append("{\"name\":");
+            append_json_string(json, e.name);
+            json.append(",\"cat\":");
+            append_json_string(json, e.category);
+            json.append(Strings::format(",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%s,\"dur\":%s",
+                                        static_cast<int>(e.thread),
+                                        std::to_string(e.start_us),
+                                        std::to_string(e.end_us - e.start_us)));
+            if (!e.args.empty())
+            {
+                json.append(",\"args\":{");
+                for (size_t j = 0; j < e.args.size(); ++j)
+                {
+                    if (j != 0)
+                        json.push_back(',');
+                    append_json_string(json, e.args[j].first);
+                    json.push_back(':');
+                    json.append(std::to_string(e.args[j].second));
+                }
+                json.push_back('}');
+            }
+            json.push_back('}');
+            json.append(i + 1 == s.events.size() ? "\n" : ",\n");
+        }
+        json.append("],\"displayTimeUnit\":\"ms\"}\n");
+
+        std::ofstream(s.trace_file, std::ios::binary | std::ios::trunc) << json;
+    }
+
+    scoped_span::scoped_span(const std::string& name, const std::string& category) : m_start_us(-1)
+    {
+        if (is_enabled())
+        {
+            m_name = name;
+            m_category = category;
+            m_start_us = now_us();
+        }
+    }
+
+    scoped_span::~scoped_span()
+    {
+        if (m_start_us >= 0)
+        {
+            record_span(m_name, m_category, m_start_us, now_us());
+        }
+    }
+}}
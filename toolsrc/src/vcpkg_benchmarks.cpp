@@ -0,0 +1,700 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <vector>
+#include "vcpkg.h"
+#include "coff_file_reader.h"
+#include "FilesIndex.h"
+#include "Paragraphs.h"
+#include "PortsIndex.h"
+#include "post_build_lint.h"
+#include "StatusParagraphs.h"
+#include "Stopwatch.h"
+#include "vcpkg_Checks.h"
+#include "vcpkg_Dependencies.h"
+#include "vcpkg_Files.h"
+#include "vcpkg_Graphs.h"
+#include "vcpkg_info.h"
+#include "vcpkg_Strings.h"
+#include "vcpkg_System.h"
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+// Measures the hot paths of vcpkg on synthetic inputs and reports the timings as JSON, so that releases can be compared.
+// The workflow/ benchmarks run the steps of install, remove, list, search and owns on a synthetic vcpkg root; building
+// is left out, as it measures cmake and the compiler rather than vcpkg. --baseline compares the medians with the JSON
+// of an earlier run.
+//   vcpkgbench [--filter <substring>] [--output <file.json>] [--baseline <file.json>]
+
+namespace fs = std::tr2::sys;
+using namespace vcpkg;
+
+namespace
+{
+    // Results are accumulated here so the optimizer cannot drop the measured work
+    volatile size_t g_sink = 0;
+
+    struct benchmark_result
+    {
+        std::string name;
+        size_t iterations;
+        long long min_ns;
+        long long median_ns;
+        long long mean_ns;
+    };
+
+    class benchmark_runner
+    {
+    public:
+        explicit benchmark_runner(std::string filter) : filter(std::move(filter))
+        {
+        }
+
+        bool is_selected(const std::string& name) const
+        {
+            return this->filter.empty() || name.find(this->filter) != std::string::npos;
+        }
+
+        // setup() runs before every iteration and is not part of the measurement
+        void run(const std::string& name, const std::function<void()>& setup, const std::function<size_t()>& f)
+        {
+            static const size_t MIN_ITERATIONS = 3;
+            static const size_t MAX_ITERATIONS = 1000;
+            static const std::chrono::milliseconds MIN_TOTAL_TIME(500);
+
+            if (!is_selected(name))
+            {
+                return;
+            }
+
+            std::vector<long long> samples;
+            std::chrono::nanoseconds total(0);
+            while (samples.size() < MIN_ITERATIONS || (total < MIN_TOTAL_TIME && samples.size() < MAX_ITERATIONS))
+            {
+                setup();
+                Stopwatch stopwatch = Stopwatch::createStarted();
+                g_sink += f();
+                stopwatch.stop();
+
+                const std::chrono::nanoseconds elapsed = stopwatch.elapsed<std::chrono::nanoseconds>();
+                total += elapsed;
+                samples.push_back(elapsed.count());
+            }
+
+            std::sort(samples.begin(), samples.end());
+            const benchmark_result result = {name, samples.size(), samples.front(), samples[samples.size() / 2], total.count() / static_cast<long long>(samples.size())};
+            System::println("%-48s %6d iterations %12.3f ms median", name, static_cast<int>(result.iterations), static_cast<double>(result.median_ns) / 1e6);
+            this->results.push_back(result);
+        }
+
+        void run(const std::string& name, const std::function<size_t()>& f)
+        {
+            run(name, []() {}, f);
+        }
+
+        const std::vector<benchmark_result>& get_results() const
+        {
+            return this->results;
+        }
+
+        std::string to_json() const
+        {
+            std::string json = Strings::format("{\n  \"version\": \"%s\",\n  \"benchmarks\": [", Info::version());
+            for (size_t i = 0; i < this->results.size(); ++i)
+            {
+                const benchmark_result& r = this->results[i];
+                json.append(Strings::format("%s\n    {\"name\": \"%s\", \"iterations\": %d, \"min_ns\": %s, \"median_ns\": %s, \"mean_ns\": %s}",
+                                            i == 0 ? "" : ",", r.name, static_cast<int>(r.iterations), std::to_string(r.min_ns), std::to_string(r.median_ns), std::to_string(r.mean_ns)));
+            }
+            json.append("\n  ]\n}\n");
+            return json;
+        }
+
+    private:
+        std::string filter;
+        std::vector<benchmark_result> results;
+    };
+
+    // Deterministic, so that every run measures the same inputs
+    class lcg
+    {
+    public:
+        uint32_t next(const uint32_t bound)
+        {
+            this->state = this->state * 1103515245u + 12345u;
+            return (this->state >> 8) % bound;
+        }
+
+    private:
+        uint32_t state = 1;
+    };
+
+    std::string make_status_paragraph(const size_t i, const char* version)
+    {
+        std::string depends;
+        if (i > 0)
+        {
+            depends = Strings::format("Depends: port%d, port%d\n", static_cast<int>(i / 2), static_cast<int>(i / 3));
+        }
+
+        return Strings::format("Package: port%d\n"
+                               "Version: %s\n"
+                               "%s"
+                               "Architecture: x86-windows\n"
+                               "Multi-Arch: same\n"
+                               "Description: Synthetic package number %d used for benchmarking\n"
+                               "Status: install ok installed\n"
+                               "\n",
+                               static_cast<int>(i), version, depends, static_cast<int>(i));
+    }
+
+    std::string make_status_file(const size_t count)
+    {
+        std::string text;
+        for (size_t i = 0; i < count; ++i)
+        {
+            text.append(make_status_paragraph(i, "1.0"));
+        }
+        return text;
+    }
+
+    std::vector<std::unique_ptr<StatusParagraph>> make_status_paragraphs(const std::string& text)
+    {
+        const Paragraphs::parsed_paragraphs pghs = Paragraphs::parse_paragraph_views(text);
+        std::vector<std::unique_ptr<StatusParagraph>> output;
+        for (size_t i = 0; i < pghs.size(); ++i)
+        {
+            output.push_back(std::make_unique<StatusParagraph>(pghs[i]));
+        }
+        return output;
+    }
+
+    // A journal record as install and remove write it, of the status paragraph in text
+    std::string make_journal_record(const std::string& text)
+    {
+        return vcpkg::make_status_journal_record(*make_status_paragraphs(text).at(0));
+    }
+
+    // Ports are spread over 16 layers and depend on up to 3 ports of earlier layers, like a real port tree
+    Graphs::Graph<package_spec> make_port_graph(const size_t count)
+    {
+        const size_t layer_width = std::max(size_t(1), count / 16);
+        std::vector<package_spec> specs;
+        for (size_t i = 0; i < count; ++i)
+        {
+            specs.push_back(package_spec::from_name_and_triplet(Strings::format("port%d", static_cast<int>(i)), triplet::X86_WINDOWS).get_or_throw());
+        }
+
+        lcg random;
+        Graphs::Graph<package_spec> graph;
+        for (size_t i = 0; i < count; ++i)
+        {
+            graph.add_vertex(specs[i]);
+            const size_t layer_begin = i / layer_width * layer_width;
+            for (int dependency = 0; dependency < 3 && layer_begin != 0; ++dependency)
+            {
+                graph.add_edge(specs[i], specs[random.next(static_cast<uint32_t>(layer_begin))]);
+            }
+        }
+        return graph;
+    }
+
+    void append_archive_member(std::string& archive, const char* name, const std::string& contents)
+    {
+        archive.append(Strings::format("%-16s%-12s%-6s%-6s%-8s%-10d`\n", name, "0", "", "", "0", static_cast<int>(contents.size())));
+        archive.append(contents);
+        if (contents.size() % 2 != 0)
+        {
+            archive.push_back('\n');
+        }
+    }
+
+    template <class T>
+    void append_le(std::string& s, const T value)
+    {
+        s.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // An x64 import library: alternating objects with a .drectve section and short import members
+    void write_synthetic_lib(const fs::path& path, const size_t member_count)
+    {
+        static const uint16_t AMD64 = 0x8664;
+        static const std::string DIRECTIVES = R"( /DEFAULTLIB:"MSVCRT" /DEFAULTLIB:"OLDNAMES" )";
+
+        std::string object;
+        append_le<uint16_t>(object, AMD64);
+        append_le<uint16_t>(object, 1); // Number of sections
+        append_le<uint32_t>(object, 0);
+        append_le<uint32_t>(object, 0);
+        append_le<uint32_t>(object, 0);
+        append_le<uint16_t>(object, 0); // Size of optional header
+        append_le<uint16_t>(object, 0);
+        object.append(".drectve", 8);
+        append_le<uint32_t>(object, 0);
+        append_le<uint32_t>(object, 0);
+        append_le<uint32_t>(object, static_cast<uint32_t>(DIRECTIVES.size()));
+        append_le<uint32_t>(object, 20 + 40); // Raw data follows the section table
+        object.append(16, '\0');
+        object.append(DIRECTIVES);
+
+        std::string import_member;
+        append_le<uint16_t>(import_member, 0);
+        append_le<uint16_t>(import_member, 0xFFFF);
+        append_le<uint16_t>(import_member, 0);
+        append_le<uint16_t>(import_member, AMD64);
+        import_member.append(12, '\0');
+        import_member.append("symbol\0library.dll\0", 19);
+
+        std::string second_linker_member;
+        append_le<uint32_t>(second_linker_member, static_cast<uint32_t>(member_count));
+        second_linker_member.append(member_count * sizeof(uint32_t), '\0');
+        append_le<uint32_t>(second_linker_member, 0); // Number of symbols
+
+        std::string archive = "!<arch>\n";
+        append_archive_member(archive, "/", std::string(4, '\0'));
+        append_archive_member(archive, "/", second_linker_member);
+        for (size_t i = 0; i < member_count; ++i)
+        {
+            append_archive_member(archive, "member.obj/", i % 2 == 0 ? object : import_member);
+        }
+
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(archive.data(), archive.size());
+    }
+
+    void write_file(const fs::path& path, const std::string& contents)
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(contents.data(), contents.size());
+    }
+
+    void run_paragraph_benchmarks(benchmark_runner& runner)
+    {
+        for (const size_t count : {1000, 10000, 100000})
+        {
+            const std::string text = make_status_file(count);
+            runner.run(Strings::format("parse_paragraphs/%d", static_cast<int>(count)), [&]() { return Paragraphs::parse_paragraphs(text).size(); });
+            runner.run(Strings::format("parse_paragraph_views/%d", static_cast<int>(count)), [&]() { return Paragraphs::parse_paragraph_views(text).size(); });
+        }
+    }
+
+    void run_status_db_benchmarks(benchmark_runner& runner)
+    {
+        for (const size_t count : {1000, 10000, 100000})
+        {
+            const std::string text = make_status_file(count);
+
+            std::vector<std::unique_ptr<StatusParagraph>> pghs;
+            runner.run(Strings::format("StatusParagraphs::insert/%d", static_cast<int>(count)),
+                       [&]() { pghs = make_status_paragraphs(text); },
+                       [&]()
+                       {
+                           StatusParagraphs status_db;
+                           for (auto& pgh : pghs)
+                           {
+                               status_db.insert(std::move(pgh));
+                           }
+                           return static_cast<size_t>(std::distance(status_db.begin(), status_db.end()));
+                       });
+
+            if (!runner.is_selected(Strings::format("StatusParagraphs::find/%d", static_cast<int>(count))))
+            {
+                continue;
+            }
+
+            const StatusParagraphs status_db(make_status_paragraphs(text));
+            std::vector<std::string> names;
+            for (size_t i = 0; i < count; ++i)
+            {
+                names.push_back(Strings::format("port%d", static_cast<int>(i)));
+            }
+            runner.run(Strings::format("StatusParagraphs::find/%d", static_cast<int>(count)), [&]()
+                       {
+                           size_t found = 0;
+                           for (const std::string& name : names)
+                           {
+                               found += status_db.find(name, triplet::X86_WINDOWS) != status_db.end();
+                           }
+                           return found;
+                       });
+        }
+    }
+
+    void run_database_load_benchmarks(benchmark_runner& runner, const fs::path& scratch_dir)
+    {
+        static const size_t INSTALLED_COUNT = 1000;
+
+        const fs::path root = scratch_dir / "root";
+        std::error_code ec;
+        fs::create_directories(root, ec);
+        const vcpkg_paths paths = vcpkg_paths::create(root).get_or_throw();
+        const status_database_files db = paths.status_shard(triplet::X86_WINDOWS);
+        fs::create_directories(db.info, ec);
+        const std::string status_text = make_status_file(INSTALLED_COUNT);
+
+        // Journal records are replayed on every load until the journal grows large enough to be compacted
+        for (const size_t count : {100, 1000, 4000})
+        {
+            const std::string name = Strings::format("database_load_check/journal-%d", static_cast<int>(count));
+            if (!runner.is_selected(name))
+            {
+                continue;
+            }
+
+            std::string journal;
+            for (size_t i = 0; i < count; ++i)
+            {
+                journal.append(make_journal_record(make_status_paragraph(i % INSTALLED_COUNT, "2.0")));
+            }
+
+            write_file(db.status_file, status_text);
+            write_file(db.status_journal, journal);
+            runner.run(name, [&]()
+                       {
+                           const StatusParagraphs status_db = database_load_check(paths);
+                           return static_cast<size_t>(std::distance(status_db.begin(), status_db.end()));
+                       });
+            fs::remove(db.status_journal, ec);
+        }
+
+        // The database of an older vcpkg version, with its update files, is split into the databases of the triplets on the
+        // first load, so it is recreated before every load
+        for (const size_t count : {100, 1000})
+        {
+            const std::string name = Strings::format("database_load_check/legacy-updates-%d", static_cast<int>(count));
+            runner.run(name,
+                       [&]()
+                       {
+                           fs::create_directories(paths.vcpkg_dir_updates, ec);
+                           write_file(paths.vcpkg_dir_status_file, status_text);
+                           for (size_t i = 0; i < count; ++i)
+                           {
+                               write_file(paths.vcpkg_dir_updates / Strings::format("%010d", static_cast<int>(i)), make_status_paragraph(i % INSTALLED_COUNT, "2.0"));
+                           }
+                       },
+                       [&]()
+                       {
+                           const StatusParagraphs status_db = database_load_check(paths);
+                           return static_cast<size_t>(std::distance(status_db.begin(), status_db.end()));
+                       });
+        }
+    }
+
+    void run_graph_benchmarks(benchmark_runner& runner)
+    {
+        for (const size_t count : {1000, 10000, 100000})
+        {
+            const std::string name = Strings::format("Graph::find_topological_sort/%d", static_cast<int>(count));
+            if (!runner.is_selected(name))
+            {
+                continue;
+            }
+
+            const Graphs::Graph<package_spec> graph = make_port_graph(count);
+            runner.run(name, [&]() { return graph.find_topological_sort().size(); });
+        }
+    }
+
+    void run_coff_benchmarks(benchmark_runner& runner, const fs::path& scratch_dir)
+    {
+        for (const size_t count : {1000, 20000})
+        {
+            const std::string name = Strings::format("COFFFileReader::read_lib/%d", static_cast<int>(count));
+            if (!runner.is_selected(name))
+            {
+                continue;
+            }
+
+            const fs::path lib = scratch_dir / Strings::format("synthetic%d.lib", static_cast<int>(count));
+            write_synthetic_lib(lib, count);
+            runner.run(name, [&]() { return COFFFileReader::read_lib(lib).default_libs.size(); });
+        }
+    }
+
+    // Each port depends on up to two ports before it
+    std::vector<std::string> make_workflow_depends(const size_t i)
+    {
+        std::vector<std::string> depends;
+        if (i > 0)
+        {
+            depends.push_back(Strings::format("port%d", static_cast<int>(i / 2)));
+        }
+        if (i > 2 && i / 3 != i / 2)
+        {
+            depends.push_back(Strings::format("port%d", static_cast<int>(i / 3)));
+        }
+        return depends;
+    }
+
+    std::string join(const std::vector<std::string>& names)
+    {
+        std::string joined;
+        for (const std::string& name : names)
+        {
+            joined.append(joined.empty() ? "" : ", ").append(name);
+        }
+        return joined;
+    }
+
+    // A vcpkg root holding count ports, each with a trivial portfile, and the package install would have built for each
+    // of them: a CONTROL file, a BUILD_INFO file and files_per_package headers
+    vcpkg_paths make_workflow_root(const fs::path& root, const size_t count, const size_t files_per_package)
+    {
+        std::error_code ec;
+        fs::remove_all(root, ec);
+        fs::create_directories(root, ec);
+        const vcpkg_paths paths = vcpkg_paths::create(root).get_or_throw();
+        fs::create_directories(paths.vcpkg_dir, ec);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const std::string name = Strings::format("port%d", static_cast<int>(i));
+            const std::vector<std::string> depends = make_workflow_depends(i);
+            const std::string description = Strings::format("Synthetic port number %d used for benchmarking", static_cast<int>(i));
+
+            const fs::path port_dir = paths.ports / name;
+            fs::create_directories(port_dir, ec);
+            write_file(port_dir / "CONTROL", Strings::format("Source: %s\nVersion: 1.0\nDescription: %s\n%s", name, description,
+                                                            depends.empty() ? "" : "Build-Depends: " + join(depends) + "\n"));
+            write_file(port_dir / "portfile.cmake", "file(INSTALL ${CMAKE_CURRENT_LIST_DIR}/CONTROL DESTINATION ${CURRENT_PACKAGES_DIR}/share/${PORT} RENAME copyright)\n");
+
+            const fs::path package_dir = paths.package_dir(package_spec::from_name_and_triplet(name, triplet::X86_WINDOWS).get_or_throw());
+            fs::create_directories(package_dir / "include" / name, ec);
+            fs::create_directories(package_dir / "share" / name, ec);
+            write_file(package_dir / "CONTROL", Strings::format("Package: %s\nVersion: 1.0\n%sArchitecture: x86-windows\nMulti-Arch: same\nDescription: %s\n", name,
+                                                               depends.empty() ? "" : "Depends: " + join(depends) + "\n", description));
+            write_file(package_dir / "BUILD_INFO", "CRTLinkage: dynamic\nLibraryLinkage: dynamic\n");
+            write_file(package_dir / "share" / name / "copyright", description + "\n");
+            for (size_t file = 0; file < files_per_package; ++file)
+            {
+                write_file(package_dir / "include" / name / Strings::format("header%d.h", static_cast<int>(file)), "#pragma once\n");
+            }
+        }
+        return paths;
+    }
+
+    std::vector<BinaryParagraph> load_built_packages(const vcpkg_paths& paths, const size_t count)
+    {
+        std::vector<BinaryParagraph> packages;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const package_spec spec = package_spec::from_name_and_triplet(Strings::format("port%d", static_cast<int>(i)), triplet::X86_WINDOWS).get_or_throw();
+            const std::string control = Files::get_contents(paths.package_dir(spec) / "CONTROL").get_or_throw();
+            packages.emplace_back(Paragraphs::parse_paragraph_views(control)[0]);
+        }
+        return packages;
+    }
+
+    // Starts from an empty installed/ and installs packages, which are in dependency order
+    StatusParagraphs install_all(const vcpkg_paths& paths, const std::vector<BinaryParagraph>& packages)
+    {
+        std::error_code ec;
+        fs::remove_all(paths.installed, ec);
+        fs::create_directories(paths.vcpkg_dir, ec);
+        StatusParagraphs status_db = database_load_check(paths);
+        for (const BinaryParagraph& package : packages)
+        {
+            install_package(paths, package, status_db);
+        }
+        return status_db;
+    }
+
+    void run_workflow_benchmarks(benchmark_runner& runner, const fs::path& scratch_dir)
+    {
+        static const size_t FILES_PER_PACKAGE = 50;
+
+        for (const size_t count : {100, 400})
+        {
+            const std::string suffix = Strings::format("/%d", static_cast<int>(count));
+            static const char* const NAMES[] = {"workflow/create_dependency_graph", "workflow/install", "workflow/perform_all_checks", "workflow/remove",
+                                                "workflow/database_load_check", "workflow/list", "workflow/search", "workflow/owns"};
+            if (std::none_of(std::begin(NAMES), std::end(NAMES), [&](const char* name) { return runner.is_selected(name + suffix); }))
+            {
+                continue;
+            }
+
+            const vcpkg_paths paths = make_workflow_root(scratch_dir / Strings::format("workflow%d", static_cast<int>(count)), count, FILES_PER_PACKAGE);
+            const std::vector<BinaryParagraph> packages = load_built_packages(paths, count);
+            std::vector<package_spec> specs;
+            for (const BinaryParagraph& package : packages)
+            {
+                specs.push_back(package.spec);
+            }
+
+            // Every port, with nothing installed yet and every package built
+            runner.run("workflow/create_dependency_graph" + suffix, [&]()
+                       {
+                           return Dependencies::create_dependency_graph(paths, specs, StatusParagraphs()).find_topological_sort().size();
+                       });
+
+            // The copies into installed/, the listfiles, the hashes files and the status database updates
+            StatusParagraphs status_db;
+            runner.run("workflow/install" + suffix,
+                       [&]()
+                       {
+                           std::error_code ec;
+                           fs::remove_all(paths.installed, ec);
+                           fs::create_directories(paths.vcpkg_dir, ec);
+                           status_db = database_load_check(paths);
+                       },
+                       [&]()
+                       {
+                           for (const BinaryParagraph& package : packages)
+                           {
+                               install_package(paths, package, status_db);
+                           }
+                           return packages.size();
+                       });
+
+            runner.run("workflow/perform_all_checks" + suffix, [&]()
+                       {
+                           size_t error_count = 0;
+                           for (const package_spec& spec : specs)
+                           {
+                               error_count += perform_all_checks(spec, paths);
+                           }
+                           return error_count;
+                       });
+
+            runner.run("workflow/remove" + suffix,
+                       [&]() { status_db = install_all(paths, packages); },
+                       [&]()
+                       {
+                           deinstall_packages(paths, specs, status_db);
+                           return specs.size();
+                       });
+
+            // The read-only commands run against everything installed
+            if (!runner.is_selected("workflow/database_load_check" + suffix) && !runner.is_selected("workflow/list" + suffix) &&
+                !runner.is_selected("workflow/search" + suffix) && !runner.is_selected("workflow/owns" + suffix))
+            {
+                continue;
+            }
+            status_db = install_all(paths, packages);
+
+            runner.run("workflow/database_load_check" + suffix, [&]()
+                       {
+                           const StatusParagraphs loaded = database_load_check(paths);
+                           return static_cast<size_t>(std::distance(loaded.begin(), loaded.end()));
+                       });
+
+            // What list prints, without printing it
+            runner.run("workflow/list" + suffix, [&]()
+                       {
+                           const status_snapshot snapshot = load_status_snapshot(paths);
+                           size_t version_sizes = 0;
+                           for (size_t i = 0; i < snapshot.size(); ++i)
+                           {
+                               version_sizes += snapshot.paragraph(i).package.version.size();
+                           }
+                           return version_sizes;
+                       });
+
+            runner.run("workflow/search" + suffix, [&]()
+                       {
+                           const PortsIndex::search_index index(PortsIndex::load_source_paragraphs(paths));
+                           return index.search({"port1"}).size() + index.search({"synthetic", "benchmarking"}).size();
+                       });
+
+            runner.run("workflow/owns" + suffix, [&]()
+                       {
+                           const FilesIndex::files_index index = FilesIndex::files_index::load(paths, load_status_snapshot(paths));
+                           return index.find_substring("header1").size() + index.find_exact("x86-windows/include/port1/header0.h").size();
+                       });
+        }
+    }
+
+    // The median of every benchmark of a JSON file written by an earlier run, by name
+    std::map<std::string, long long> read_baseline(const std::string& file)
+    {
+        const expected<std::string> contents = Files::get_contents(file);
+        Checks::check_exit(contents.get() != nullptr, "Error: could not read the baseline %s", file);
+
+        static const std::string NAME = "{\"name\": \"";
+        static const std::string MEDIAN = "\"median_ns\": ";
+        std::map<std::string, long long> medians;
+        const std::string& json = *contents.get();
+        for (size_t pos = json.find(NAME); pos != std::string::npos; pos = json.find(NAME, pos))
+        {
+            pos += NAME.size();
+            const size_t name_end = json.find('"', pos);
+            const size_t median = json.find(MEDIAN, name_end);
+            if (name_end == std::string::npos || median == std::string::npos)
+            {
+                break;
+            }
+            medians[json.substr(pos, name_end - pos)] = std::stoll(json.substr(median + MEDIAN.size()));
+        }
+        return medians;
+    }
+}
+
+int wmain(const int argc, const wchar_t* const* const argv)
+{
+    std::string filter;
+    std::string output_file;
+    std::string baseline_file;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = Strings::utf16_to_utf8(argv[i]);
+        Checks::check_exit(i + 1 < argc && (arg == "--filter" || arg == "--output" || arg == "--baseline"),
+                           "Usage: vcpkgbench [--filter <substring>] [--output <file.json>] [--baseline <file.json>]");
+        (arg == "--filter" ? filter : arg == "--output" ? output_file : baseline_file) = Strings::utf16_to_utf8(argv[++i]);
+    }
+    const std::map<std::string, long long> baseline = baseline_file.empty() ? std::map<std::string, long long>() : read_baseline(baseline_file);
+
+    const fs::path scratch_dir = fs::temp_directory_path() / Strings::format("vcpkgbench-%d", static_cast<int>(GetCurrentProcessId()));
+    std::error_code ec;
+    fs::create_directories(scratch_dir, ec);
+
+    benchmark_runner runner(filter);
+    run_paragraph_benchmarks(runner);
+    run_status_db_benchmarks(runner);
+    run_database_load_benchmarks(runner, scratch_dir);
+    run_graph_benchmarks(runner);
+    run_coff_benchmarks(runner, scratch_dir);
+    run_workflow_benchmarks(runner, scratch_dir);
+
+    fs::remove_all(scratch_dir, ec);
+
+    if (!baseline.empty())
+    {
+        System::println("\nMedian compared with %s:", baseline_file);
+        for (const benchmark_result& result : runner.get_results())
+        {
+            const auto before = baseline.find(result.name);
+            if (before == baseline.end() || before->second == 0)
+            {
+                System::println("%-48s %12s", result.name, "new");
+                continue;
+            }
+            // Changes within 10% are usually noise
+            const double change = (static_cast<double>(result.median_ns) / static_cast<double>(before->second) - 1.0) * 100.0;
+            const std::string line = Strings::format("%-48s %+11.1f%%", result.name, change);
+            if (change > 10.0)
+            {
+                System::println(System::color::error, line.c_str());
+            }
+            else if (change < -10.0)
+            {
+                System::println(System::color::success, line.c_str());
+            }
+            else
+            {
+                System::println(line.c_str());
+            }
+        }
+    }
+
+    if (output_file.empty())
+    {
+        System::print(runner.to_json().c_str());
+    }
+    else
+    {
+        std::ofstream(output_file, std::ios::binary | std::ios::trunc) << runner.to_json();
+        System::println("Results written to %s", output_file);
+    }
+
+    return 0;
+}
@@ -88,12 +88,42 @@ namespace vcpkg
                     parse_value(arg_begin, arg_end, "--vcpkg-root", args.vcpkg_root_dir);
                     continue;
                 }
+                if (arg == "--scratch-root")
+                {
+                    ++arg_begin;
+                    parse_value(arg_begin, arg_end, "--scratch-root", args.scratch_root_dir);
+                    continue;
+                }
                 if (arg == "--triplet")
                 {
                     ++arg_begin;
                     parse_value(arg_begin, arg_end, "--triplet", args.target_triplet);
                     continue;
                 }
+                if (arg == "--jobs")
+                {
+                    ++arg_begin;
+                    parse_value(arg_begin, arg_end, "--jobs", args.jobs);
+                    continue;
+                }
+                if (arg == "--trace-file")
+                {
+                    ++arg_begin;
+                    parse_value(arg_begin, arg_end, "--trace-file", args.trace_file);
+                    continue;
+                }
+                if (arg == "--lock")
+                {
+                    ++arg_begin;
+                    parse_value(arg_begin, arg_end, "--lock", args.lock_file);
+                    continue;
+                }
+                if (arg == "--write-lock")
+                {
+                    ++arg_begin;
+                    parse_value(arg_begin, arg_end, "--write-lock", args.write_lock_file);
+                    continue;
+                }
                 if (arg == "--debug")
                 {
                     parse_switch(opt_bool::enabled, "debug", args.debug);
@@ -109,6 +139,11 @@ namespace vcpkg
                     parse_switch(opt_bool::enabled, "printmetrics", args.printmetrics);
                     continue;
                 }
+                if (arg == "--timings")
+                {
+                    parse_switch(opt_bool::enabled, "timings", args.timings);
+                    continue;
+                }
                 if (arg == "--no-sendmetrics")
                 {
                     parse_switch(opt_bool::disabled, "sendmetrics", args.sendmetrics);
@@ -20,6 +20,13 @@ WinMain(
 
     szArgList = CommandLineToArgvW(GetCommandLineW(), &argCount);
 
-    Checks::check_exit(argCount == 2, "Requires exactly one argument, the path to the payload file");
-    Upload(Files::get_contents(szArgList[1]).get_or_throw());
+    Checks::check_exit(argCount == 2, "Requires exactly one argument, the spool directory or the path to a payload file");
+    const fs::path argument = szArgList[1];
+    if (fs::is_directory(argument))
+    {
+        UploadSpool(argument);
+        return 0;
+    }
+
+    Upload(Files::get_contents(argument).get_or_throw());
 }
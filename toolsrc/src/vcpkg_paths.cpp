@@ -1,9 +1,11 @@
 #include <filesystem>
+#include <algorithm>
 #include "expected.h"
 #include "vcpkg_paths.h"
 #include "metrics.h"
 #include "vcpkg_System.h"
 #include "package_spec.h"
+#include "vcpkg_Files.h"
 
 namespace vcpkg
 {
@@ -26,22 +28,59 @@ namespace vcpkg
             exit(EXIT_FAILURE);
         }
 
-        paths.packages = paths.root / "packages";
-        paths.buildtrees = paths.root / "buildtrees";
+        // Builds write and delete a lot in the scratch directories, which %VCPKG_SCRATCH_ROOT% may move off the root, e.g.
+        // onto a local disk when the root is on a network share. The trash goes along: directories are renamed into it.
+        // What outlives a build is copied out of them, into installed/ or the binary cache.
+        const std::wstring scratch_root_env = System::wdupenv_str(L"VCPKG_SCRATCH_ROOT");
+        const fs::path scratch_root = scratch_root_env.empty() ? paths.root : fs::absolute(scratch_root_env);
+
+        paths.packages = scratch_root / "packages";
+        paths.buildtrees = scratch_root / "buildtrees";
         paths.downloads = paths.root / "downloads";
         paths.ports = paths.root / "ports";
         paths.installed = paths.root / "installed";
         paths.triplets = paths.root / "triplets";
+        paths.trash = scratch_root / "trash";
 
         paths.buildsystems = paths.root / "scripts" / "buildsystems";
         paths.buildsystems_msbuild_targets = paths.buildsystems / "msbuild" / "vcpkg.targets";
 
         paths.vcpkg_dir = paths.installed / "vcpkg";
+        paths.vcpkg_dir_shards = paths.vcpkg_dir / "triplets";
         paths.vcpkg_dir_status_file = paths.vcpkg_dir / "status";
+        paths.vcpkg_dir_status_journal = paths.vcpkg_dir / "status-journal";
+        paths.vcpkg_dir_status_lock = paths.vcpkg_dir / "status-lock";
+        paths.vcpkg_dir_status_snapshot = paths.vcpkg_dir / "status.bin";
+        paths.vcpkg_dir_ports_index = paths.vcpkg_dir / "ports-index";
+        paths.vcpkg_dir_files_index = paths.vcpkg_dir / "files-index";
+        paths.vcpkg_dir_packages_index = paths.vcpkg_dir / "packages-index";
+        paths.vcpkg_dir_packages_index_lock = paths.vcpkg_dir / "packages-index-lock";
         paths.vcpkg_dir_info = paths.vcpkg_dir / "info";
         paths.vcpkg_dir_updates = paths.vcpkg_dir / "updates";
+        paths.vcpkg_dir_build_durations = paths.vcpkg_dir / "build-durations";
+        paths.vcpkg_dir_build_resources = paths.vcpkg_dir / "build-resources";
+        paths.vcpkg_dir_lint_cache = paths.vcpkg_dir / "lint-cache";
+        paths.vcpkg_dir_tool_versions = paths.vcpkg_dir / "tool-versions";
+        paths.vcpkg_dir_vcvars = paths.vcpkg_dir / "vcvars";
+        paths.vcpkg_dir_access_log = paths.vcpkg_dir / "access-log";
+        paths.vcpkg_dir_plans = paths.vcpkg_dir / "plans";
+        paths.vcpkg_dir_msbuild = paths.vcpkg_dir / "msbuild";
+        paths.vcpkg_dir_symbols = paths.vcpkg_dir / "symbols";
+        paths.vcpkg_dir_symbols_lock = paths.vcpkg_dir / "symbols-lock";
 
         paths.ports_cmake = paths.root / "scripts" / "ports.cmake";
+
+        const std::wstring host_triplet_env = System::wdupenv_str(L"VCPKG_HOST_TRIPLET");
+        if (!host_triplet_env.empty())
+        {
+            paths.host_triplet = triplet::from_canonical_name(Strings::utf16_to_utf8(host_triplet_env));
+        }
+        else
+        {
+            // PROCESSOR_ARCHITEW6432 is only set for a 32-bit process on 64-bit Windows
+            const bool is_64_bit_machine = System::wdupenv_str(L"PROCESSOR_ARCHITECTURE") == L"AMD64" || System::wdupenv_str(L"PROCESSOR_ARCHITEW6432") == L"AMD64";
+            paths.host_triplet = is_64_bit_machine ? triplet::X64_WINDOWS : triplet::X86_WINDOWS;
+        }
         return paths;
     }
 
@@ -62,21 +101,130 @@ namespace vcpkg
 
     fs::path vcpkg_paths::listfile_path(const BinaryParagraph& pgh) const
     {
-        return this->vcpkg_dir_info / (pgh.fullstem() + ".list");
+        return this->status_shard(pgh.spec.target_triplet()).info / (pgh.fullstem() + ".list");
     }
 
-    bool vcpkg_paths::is_valid_triplet(const triplet& t) const
+    fs::path vcpkg_paths::importsfile_path(const BinaryParagraph& pgh) const
+    {
+        return this->status_shard(pgh.spec.target_triplet()).info / (pgh.fullstem() + ".imports");
+    }
+
+    fs::path vcpkg_paths::hashesfile_path(const BinaryParagraph& pgh) const
+    {
+        return this->status_shard(pgh.spec.target_triplet()).info / (pgh.fullstem() + ".hashes");
+    }
+
+    fs::path vcpkg_paths::symbolsfile_path(const BinaryParagraph& pgh) const
+    {
+        return this->status_shard(pgh.spec.target_triplet()).info / (pgh.fullstem() + ".symbols");
+    }
+
+    fs::path vcpkg_paths::triplet_lock_path(const triplet& t) const
+    {
+        return this->vcpkg_dir / (t.canonical_name() + ".lock");
+    }
+
+    status_database_files vcpkg_paths::status_shard(const triplet& t) const
+    {
+        status_database_files db;
+        db.dir = this->vcpkg_dir_shards / t.canonical_name();
+        db.status_file = db.dir / "status";
+        db.status_journal = db.dir / "status-journal";
+        db.status_lock = db.dir / "status-lock";
+        db.status_snapshot = db.dir / "status.bin";
+        db.info = db.dir / "info";
+        db.imports = db.dir / "imports";
+        return db;
+    }
+
+    status_database_files vcpkg_paths::legacy_status_database() const
     {
-        auto it = fs::directory_iterator(this->triplets);
-        for (; it != fs::directory_iterator(); ++it)
+        status_database_files db;
+        db.dir = this->vcpkg_dir;
+        db.status_file = this->vcpkg_dir_status_file;
+        db.status_journal = this->vcpkg_dir_status_journal;
+        db.status_lock = this->vcpkg_dir_status_lock;
+        db.status_snapshot = this->vcpkg_dir_status_snapshot;
+        db.info = this->vcpkg_dir_info;
+        return db;
+    }
+
+    // Only understands the plain set(<VAR> <value>) lines the triplet files are made of
+    static triplet_properties parse_triplet_file(const fs::path& triplet_file, const std::string& canonical_name)
+    {
+        triplet_properties properties;
+        properties.architecture = canonical_name.substr(0, canonical_name.find('-'));
+
+        const expected<std::string> contents = Files::get_contents(triplet_file);
+        const std::string* text = contents.get();
+        if (text == nullptr)
         {
-            std::string triplet_file_name = it->path().stem().generic_u8string();
-            if (t.canonical_name() == triplet_file_name) // TODO: fuzzy compare
+            return properties;
+        }
+
+        size_t pos = 0;
+        while ((pos = text->find("set(", pos)) != std::string::npos)
+        {
+            pos += 4;
+            const size_t end = text->find(')', pos);
+            if (end == std::string::npos)
+                break;
+
+            const std::string statement = text->substr(pos, end - pos);
+            const size_t space = statement.find_first_of(" \t");
+            if (space != std::string::npos)
             {
-                //t.value = triplet_file_name; // NOTE: uncomment when implementing fuzzy compare
-                return true;
+                const std::string variable = statement.substr(0, space);
+                std::string value = statement.substr(statement.find_first_not_of(" \t", space));
+                if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+                    value = value.substr(1, value.size() - 2);
+
+                if (variable == "VCPKG_TARGET_ARCHITECTURE")
+                    properties.architecture = value;
+                else if (variable == "VCPKG_CMAKE_SYSTEM_NAME")
+                    properties.cmake_system_name = value;
+                else if (variable == "VCPKG_CRT_LINKAGE")
+                    properties.crt_linkage = value;
+                else if (variable == "VCPKG_LIBRARY_LINKAGE")
+                    properties.library_linkage = value;
+                else if (variable == "VCPKG_COMPILER_CACHE")
+                    properties.compiler_cache = value;
+                else if (variable == "VCPKG_COMPILER_CACHE_DIR")
+                    properties.compiler_cache_dir = value;
             }
+            pos = end;
         }
-        return false;
+        return properties;
+    }
+
+    const triplet_catalogue& vcpkg_paths::triplets_catalogue() const
+    {
+        lazy_triplet_catalogue& lazy = *this->m_triplet_catalogue;
+        std::call_once(lazy.once, [&]()
+            {
+                std::error_code ec;
+                for (auto it = fs::directory_iterator(this->triplets, ec); !ec && it != fs::directory_iterator(); ++it)
+                {
+                    if (it->path().extension() != ".cmake")
+                        continue;
+
+                    std::string canonical_name = it->path().stem().generic_u8string();
+                    std::transform(canonical_name.begin(), canonical_name.end(), canonical_name.begin(), ::tolower);
+                    lazy.catalogue.emplace(canonical_name, parse_triplet_file(it->path(), canonical_name));
+                }
+            });
+        return lazy.catalogue;
+    }
+
+    const triplet_properties* vcpkg_paths::find_triplet(const triplet& t) const
+    {
+        const triplet_catalogue& catalogue = this->triplets_catalogue();
+        const auto it = catalogue.find(t.canonical_name()); // TODO: fuzzy compare
+        return it != catalogue.end() ? &it->second : nullptr;
+    }
+
+    bool vcpkg_paths::is_valid_triplet(const triplet& t) const
+    {
+        return this->find_triplet(t) != nullptr;
     }
 }
@@ -46,6 +46,24 @@ namespace vcpkg {namespace details
         return value;
     }
 
+    std::string optional_field(const Paragraphs::paragraph_view& fields, const std::string& fieldname)
+    {
+        const Paragraphs::text_range* value = fields.find(fieldname);
+        if (value == nullptr)
+        {
+            return std::string();
+        }
+
+        return value->to_string();
+    }
+
+    std::string required_field(const Paragraphs::paragraph_view& fields, const std::string& fieldname)
+    {
+        const Paragraphs::text_range* value = fields.find(fieldname);
+        Checks::check_exit(value != nullptr, "Required field not present: %s", fieldname);
+        return value->to_string();
+    }
+
     std::string shorten_description(const std::string& desc)
     {
         auto simple_desc = std::regex_replace(desc.substr(0, 49), std::regex("\\n( |\\t)?"), "");